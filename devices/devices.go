@@ -1,25 +1,8 @@
-//go:build darwin && cgo
-
 package devices
 
-/*
-#cgo CFLAGS: -x objective-c
-#cgo LDFLAGS: -framework Foundation -framework CoreAudio -framework AudioToolbox -framework CoreMIDI -framework AVFoundation
-#include "native/devices.m"
-#include <stdlib.h>
-
-// Function declarations
-char* getAudioDevices(void);
-char* getMIDIDevices(void);
-int countAudioDevices(void);
-int countMIDIDevices(void);
-*/
-import "C"
 import (
-	"encoding/json"
 	"fmt"
 	"io"
-	"unsafe"
 )
 
 // JSON logging control
@@ -360,85 +343,3 @@ type AudioDeviceResult struct {
 	DeviceCount         int           `json:"deviceCount"`
 	TotalDevicesScanned int           `json:"totalDevicesScanned"`
 }
-
-// GetAudio returns all audio devices with unified input/output capabilities
-func GetAudio() (AudioDevices, error) {
-	result := C.getAudioDevices()
-	defer C.free(unsafe.Pointer(result))
-
-	jsonStr := C.GoString(result)
-
-	// JSON logging when enabled
-	logJSON("AudioDevices", jsonStr)
-
-	var deviceResult AudioDeviceResult
-	if err := json.Unmarshal([]byte(jsonStr), &deviceResult); err != nil {
-		return nil, fmt.Errorf("failed to parse device result: %v", err)
-	}
-
-	if !deviceResult.Success {
-		return nil, fmt.Errorf("core audio error (%d): %s", deviceResult.ErrorCode, deviceResult.Error)
-	}
-
-	return AudioDevices(deviceResult.Devices), nil
-}
-
-// GetMIDI returns all MIDI devices with unified input/output capabilities
-func GetMIDI() (MIDIDevices, error) {
-	cDeviceList := C.getMIDIDevices()
-	defer C.free(unsafe.Pointer(cDeviceList))
-
-	jsonData := C.GoString(cDeviceList)
-
-	// JSON logging when enabled
-	logJSON("MIDIDevices", jsonData)
-
-	// Parse JSON response consistently with audio devices
-	var deviceResult MIDIDeviceResult
-	if err := json.Unmarshal([]byte(jsonData), &deviceResult); err != nil {
-		return nil, fmt.Errorf("failed to parse MIDI response: %v", err)
-	}
-	if !deviceResult.Success {
-		if deviceResult.Error == "" {
-			deviceResult.Error = "unknown error"
-		}
-		return nil, fmt.Errorf("MIDI enumeration failed (%d): %s", deviceResult.ErrorCode, deviceResult.Error)
-	}
-	return MIDIDevices(deviceResult.Devices), nil
-}
-
-// GetAudioDeviceCount returns the number of audio devices without full enumeration
-// This is much faster than GetAudio() when you only need the count for change detection
-func GetAudioDeviceCount() (int, error) {
-	count := int(C.countAudioDevices())
-	if count < 0 {
-		return 0, fmt.Errorf("failed to get audio device count")
-	}
-	return count, nil
-}
-
-// GetMIDIDeviceCount returns the number of MIDI devices without full enumeration
-// This is much faster than GetMIDI() when you only need the count for change detection
-func GetMIDIDeviceCount() (int, error) {
-	count := int(C.countMIDIDevices())
-	if count < 0 {
-		return 0, fmt.Errorf("failed to get MIDI device count")
-	}
-	return count, nil
-}
-
-// GetDeviceCounts returns both audio and MIDI device counts in a single call
-// Useful for hotplug detection when you need to check both device types quickly
-func GetDeviceCounts() (audioCount, midiCount int, err error) {
-	audioCount = int(C.countAudioDevices())
-	if audioCount < 0 {
-		return 0, 0, fmt.Errorf("failed to get audio device count")
-	}
-
-	midiCount = int(C.countMIDIDevices())
-	if midiCount < 0 {
-		return 0, 0, fmt.Errorf("failed to get MIDI device count")
-	}
-
-	return audioCount, midiCount, nil
-}
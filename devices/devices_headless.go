@@ -0,0 +1,53 @@
+//go:build !darwin || !cgo
+
+package devices
+
+// Without Core Audio there is no hardware to enumerate. The headless backend
+// (native/headless) renders into memory, so it is exposed as a single virtual
+// output device that NewEngine accepts like any other.
+
+// HeadlessDeviceUID identifies the virtual render device on non-macOS builds.
+const HeadlessDeviceUID = "macaudio.headless"
+
+func headlessDevice() AudioDevice {
+	return AudioDevice{
+		Device: Device{
+			Name:     "Headless Render",
+			UID:      HeadlessDeviceUID,
+			IsOnline: true,
+		},
+		DeviceID:             0,
+		InputChannelCount:    0,
+		OutputChannelCount:   2,
+		IsDefaultOutput:      true,
+		SupportedSampleRates: []int{48000},
+		SupportedBitDepths:   []int{32},
+		DeviceType:           "virtual",
+		TransportType:        "virtual",
+	}
+}
+
+// GetAudio returns the virtual headless render device
+func GetAudio() (AudioDevices, error) {
+	return AudioDevices{headlessDevice()}, nil
+}
+
+// GetMIDI returns no devices; CoreMIDI is not available
+func GetMIDI() (MIDIDevices, error) {
+	return MIDIDevices{}, nil
+}
+
+// GetAudioDeviceCount returns the number of audio devices (always 1)
+func GetAudioDeviceCount() (int, error) {
+	return 1, nil
+}
+
+// GetMIDIDeviceCount returns the number of MIDI devices (always 0)
+func GetMIDIDeviceCount() (int, error) {
+	return 0, nil
+}
+
+// GetDeviceCounts returns both audio and MIDI device counts in a single call
+func GetDeviceCounts() (audioCount, midiCount int, err error) {
+	return 1, 0, nil
+}
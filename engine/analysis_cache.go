@@ -0,0 +1,70 @@
+package engine
+
+/*
+#include "../native/macaudio.h"
+#include <stdlib.h>
+*/
+import "C"
+import (
+	"fmt"
+	"unsafe"
+)
+
+// =============================================================================
+// Public API - Persistent analysis cache
+// =============================================================================
+
+// AnalysisCacheStats describes the open analysis cache
+type AnalysisCacheStats struct {
+	Entries   int   `json:"entries"`
+	Bytes     int64 `json:"bytes"`
+	MaxBytes  int64 `json:"maxBytes"`
+	Hits      int64 `json:"hits"` // Since the cache was opened
+	Misses    int64 `json:"misses"`
+	Evictions int64 `json:"evictions"`
+}
+
+// OpenAnalysisCache keeps file analysis in directory across sessions, for all
+// engines in the process. Entries are keyed by file content (SHA-256), with
+// each path's hash remembered for its size and modification time, so moved or
+// copied files hit and edited files miss. While open, playback channels answer
+// GetFileInfo, whole-file AnalyzeRMS and AnalyzeLoudness, and BuildPeaks from
+// the cache and store what they compute. The least recently used entries are
+// evicted to keep the directory under maxBytes. Opening again moves the cache.
+func OpenAnalysisCache(directory string, maxBytes int64) error {
+	cDirectory := C.CString(directory)
+	defer C.free(unsafe.Pointer(cDirectory))
+	if errorStr := C.analysis_cache_open(cDirectory, C.int64_t(maxBytes)); errorStr != nil {
+		return fmt.Errorf("failed to open analysis cache: %s", C.GoString(errorStr))
+	}
+	return nil
+}
+
+// CloseAnalysisCache stops using the cache; its files stay on disk
+func CloseAnalysisCache() {
+	C.analysis_cache_close()
+}
+
+// GetAnalysisCacheStats reports the cache's size and hit rate
+func GetAnalysisCacheStats() (AnalysisCacheStats, error) {
+	var stats C.AnalysisCacheStats
+	if errorStr := C.analysis_cache_get_stats(&stats); errorStr != nil {
+		return AnalysisCacheStats{}, fmt.Errorf("failed to get analysis cache stats: %s", C.GoString(errorStr))
+	}
+	return AnalysisCacheStats{
+		Entries:   int(stats.entries),
+		Bytes:     int64(stats.bytes),
+		MaxBytes:  int64(stats.maxBytes),
+		Hits:      int64(stats.hits),
+		Misses:    int64(stats.misses),
+		Evictions: int64(stats.evictions),
+	}, nil
+}
+
+// ClearAnalysisCache deletes every entry
+func ClearAnalysisCache() error {
+	if errorStr := C.analysis_cache_clear(); errorStr != nil {
+		return fmt.Errorf("failed to clear analysis cache: %s", C.GoString(errorStr))
+	}
+	return nil
+}
@@ -7,6 +7,7 @@ package engine
 import "C"
 import (
 	"errors"
+	"fmt"
 	"unsafe"
 
 	"github.com/shaban/macaudio/devices"
@@ -97,6 +98,8 @@ type PlaybackOptions struct {
 	Rate     float32 `json:"rate"`  // 0.25x to 1.25x
 	Pitch    float32 `json:"pitch"` // ±12 semitones
 
+	PitchShift PitchShiftOptions `json:"pitchShift"` // Quality and formant preservation of the pitch shift unit
+
 	// Native player instance (not serialized)
 	playerPtr unsafe.Pointer `json:"-"`
 }
@@ -239,10 +242,22 @@ func (e *Engine) DestroyChannel(index int) error {
 		// The channel might not have had a bus allocated yet
 	}
 
+	// Release the player; this also drops its reference to shared decoded audio
+	if channel.PlaybackOptions != nil && channel.PlaybackOptions.playerPtr != nil {
+		C.audioplayer_destroy((*C.AudioPlayer)(channel.PlaybackOptions.playerPtr))
+		channel.PlaybackOptions.playerPtr = nil
+	}
+
 	// TODO: Disconnect channel from mixer bus
-	// TODO: Clean up channel resources (playerPtr, mixerNodePtr, etc.)
+	// TODO: Clean up remaining channel resources (mixerNodePtr, etc.)
 
 	// Remove channel from slice
 	e.Channels = append(e.Channels[:index], e.Channels[index+1:]...)
+
+	// The slowest path may have gone with it; the channel is already gone, so
+	// a failure here only leaves the remaining paths as they were
+	if _, err := e.CompensateLatency(); err != nil {
+		fmt.Printf("⚠️  Latency compensation after removing channel %d failed: %v\n", index, err)
+	}
 	return nil
 }
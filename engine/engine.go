@@ -1,7 +1,7 @@
 package engine
 
 /*
-#cgo CFLAGS: -x objective-c -fobjc-arc
+#cgo darwin CFLAGS: -x objective-c -fobjc-arc
 #cgo LDFLAGS: -L${SRCDIR}/.. -lmacaudio -Wl,-rpath,${SRCDIR}/..
 #include "../native/macaudio.h"
 #include <stdlib.h>
@@ -0,0 +1,118 @@
+package engine
+
+/*
+#include "../native/macaudio.h"
+#include <stdlib.h>
+*/
+import "C"
+import (
+	"context"
+	"errors"
+	"fmt"
+	"unsafe"
+)
+
+// =============================================================================
+// Public API - Batch file analysis
+// =============================================================================
+
+// FileAnalysis is one file's result from AnalyzeFiles
+type FileAnalysis struct {
+	Index      int       `json:"index"` // Position in the requested paths
+	Path       string    `json:"path"`
+	Err        error     `json:"-"`
+	Cached     bool      `json:"cached"` // Served from the analysis cache
+	SampleRate float64   `json:"sampleRate"`
+	Channels   int       `json:"channels"`
+	Frames     int64     `json:"frames"`
+	Duration   float64   `json:"duration"` // Seconds
+	RMS        float64   `json:"rms"`      // Average of the channels' RMS
+	Peak       float64   `json:"peak"`     // Absolute sample peak of any channel
+	Loudness   *Loudness `json:"loudness,omitempty"`
+}
+
+// FileAnalysisOptions configures AnalyzeFiles
+type FileAnalysisOptions struct {
+	Workers  int  `json:"workers"`  // 0 uses every core
+	Loudness bool `json:"loudness"` // Also measure EBU R128 loudness
+}
+
+// AnalyzeFiles decodes and meters paths on a bounded worker pool, without an
+// engine or player. Results arrive on the channel in completion order, one per
+// path; a file that cannot be read reports Err and the rest continue. The
+// channel closes when every file is done or ctx is cancelled. With the
+// analysis cache open, known files are answered from it and new results are
+// stored.
+func AnalyzeFiles(ctx context.Context, paths []string, opts *FileAnalysisOptions) (<-chan FileAnalysis, error) {
+	if opts == nil {
+		opts = &FileAnalysisOptions{}
+	}
+	flags := 0
+	if opts.Loudness {
+		flags |= C.FILE_ANALYSIS_LOUDNESS
+	}
+
+	// The batch copies the paths
+	cPaths := make([]*C.char, len(paths)+1)
+	for i, path := range paths {
+		cPaths[i] = C.CString(path)
+	}
+	var batch *C.FileAnalysisBatch
+	errorStr := C.file_analysis_start((**C.char)(unsafe.Pointer(&cPaths[0])), C.int(len(paths)), C.int(opts.Workers),
+		C.int(flags), &batch)
+	for _, cPath := range cPaths[:len(paths)] {
+		C.free(unsafe.Pointer(cPath))
+	}
+	if errorStr != nil {
+		return nil, fmt.Errorf("failed to start file analysis: %s", C.GoString(errorStr))
+	}
+
+	results := make(chan FileAnalysis)
+	go func() {
+		defer close(results)
+		defer C.file_analysis_destroy(batch)
+		var buffer [64]C.FileAnalysisResult
+		for {
+			n := int(C.file_analysis_next(batch, &buffer[0], C.int(len(buffer)), 50))
+			if n < 0 {
+				return
+			}
+			for i := 0; i < n; i++ {
+				select {
+				case results <- fileAnalysisFromC(&buffer[i], opts.Loudness):
+				case <-ctx.Done():
+					return
+				}
+			}
+			if ctx.Err() != nil {
+				return
+			}
+		}
+	}()
+	return results, nil
+}
+
+func fileAnalysisFromC(result *C.FileAnalysisResult, withLoudness bool) FileAnalysis {
+	analysis := FileAnalysis{
+		Index: int(result.index),
+		Path:  C.GoString(result.path),
+	}
+	if result.error != nil {
+		analysis.Err = errors.New(C.GoString(result.error))
+		return analysis
+	}
+	analysis.Cached = bool(result.cached)
+	analysis.SampleRate = float64(result.sampleRate)
+	analysis.Channels = int(result.channelCount)
+	analysis.Frames = int64(result.frames)
+	if analysis.SampleRate > 0 {
+		analysis.Duration = float64(analysis.Frames) / analysis.SampleRate
+	}
+	analysis.RMS = float64(result.rms)
+	analysis.Peak = float64(result.peak)
+	if withLoudness {
+		loudness := loudnessFromC(&result.loudness)
+		analysis.Loudness = &loudness
+	}
+	return analysis
+}
@@ -0,0 +1,195 @@
+package engine
+
+/*
+#include "../native/macaudio.h"
+*/
+import "C"
+import (
+	"errors"
+	"fmt"
+	"unsafe"
+)
+
+// =============================================================================
+// Public API - Latency compensation
+// =============================================================================
+
+// ChannelLatency is one channel's path to the main mixer
+type ChannelLatency struct {
+	Latency     int  `json:"latency"`     // Frames its nodes report, summed
+	Delay       int  `json:"delay"`       // Compensating frames added on its last connection
+	Compensated bool `json:"compensated"` // False for channels not wired to the main mixer, like inputs
+}
+
+// LatencyCompensation is how far the channels are held back so they reach the
+// main mixer sample-aligned: each compensated channel's Latency plus Delay
+// is the engine's Latency.
+//
+// Players, mixers and samplers add nothing. A playback channel's time and
+// pitch units report what they hold: the pitch unit's FFT size while it
+// shifts (see GetPitchShiftOptions) and the stretch window while the rate is
+// not 1 (see RateLatency), none while they are routed around.
+type LatencyCompensation struct {
+	Latency  int              `json:"latency"`  // Frames of the slowest path
+	Total    int              `json:"total"`    // Delay frames across all channels
+	Channels []ChannelLatency `json:"channels"` // In the order of Engine.Channels
+}
+
+// latencyPath is the nodes a channel's audio runs through on the way to the
+// main mixer, and the connection its compensating delay sits on
+type latencyPath struct {
+	nodes  []unsafe.Pointer
+	source unsafe.Pointer // nil when the channel has no path
+	mixer  unsafe.Pointer
+	bus    int
+}
+
+// LatencyCompensation reports the channels' path latencies and the delays
+// currently compensating them
+func (e *Engine) LatencyCompensation() (LatencyCompensation, error) {
+	var compensation LatencyCompensation
+	compensation.Channels = make([]ChannelLatency, len(e.Channels))
+	for i, channel := range e.Channels {
+		path, err := e.channelLatencyPath(channel)
+		if err != nil {
+			return compensation, err
+		}
+		if path.source == nil {
+			continue
+		}
+		latency, err := path.latency()
+		if err != nil {
+			return compensation, err
+		}
+		var delay C.int
+		if errorStr := C.audiomixer_get_input_delay_for_connection(path.source, path.mixer, C.int(path.bus), &delay); errorStr != nil {
+			return compensation, fmt.Errorf("failed to get compensating delay: %s", C.GoString(errorStr))
+		}
+		compensation.Channels[i] = ChannelLatency{Latency: latency, Delay: int(delay), Compensated: true}
+		compensation.Latency = max(compensation.Latency, latency+int(delay))
+		compensation.Total += int(delay)
+	}
+	return compensation, nil
+}
+
+// CompensateLatency delays every channel's path to that of the slowest, so
+// they all reach the main mixer sample-aligned. Creating and destroying
+// channels does this already; call it again once a channel's pitch or rate
+// has been heard, as the units report their latency from then on.
+func (e *Engine) CompensateLatency() (LatencyCompensation, error) {
+	paths := make([]latencyPath, len(e.Channels))
+	latencies := make([]int, len(e.Channels))
+	slowest := 0
+	for i, channel := range e.Channels {
+		path, err := e.channelLatencyPath(channel)
+		if err != nil {
+			return LatencyCompensation{}, err
+		}
+		if path.source == nil {
+			continue
+		}
+		if latencies[i], err = path.latency(); err != nil {
+			return LatencyCompensation{}, err
+		}
+		paths[i] = path
+		slowest = max(slowest, latencies[i])
+	}
+
+	for i, path := range paths {
+		if path.source == nil {
+			continue
+		}
+		if err := path.setDelay(slowest - latencies[i]); err != nil {
+			return LatencyCompensation{}, fmt.Errorf("channel %d: %w", i, err)
+		}
+	}
+	return e.LatencyCompensation()
+}
+
+// channelLatencyPath finds a channel's path. A playback channel's delay goes
+// ahead of its channel mixer, whose volume and pan the main mixer applies;
+// a sampler feeds the main mixer itself.
+func (e *Engine) channelLatencyPath(channel *Channel) (latencyPath, error) {
+	switch {
+	case channel.IsPlayback() && channel.PlaybackOptions.playerPtr != nil && channel.mixerNodePtr != nil:
+		playerPtr := (*C.AudioPlayer)(channel.PlaybackOptions.playerPtr)
+		var enabled C.bool
+		if errorStr := C.audioplayer_is_time_pitch_effects_enabled(playerPtr, &enabled); errorStr != nil {
+			return latencyPath{}, errors.New("failed to check time/pitch effects: " + C.GoString(errorStr))
+		}
+		if !enabled {
+			return latencyPath{}, nil // The player is not wired up
+		}
+		nodeResult := C.audioplayer_get_node_ptr(playerPtr)
+		if nodeResult.error != nil {
+			return latencyPath{}, errors.New("failed to get player node: " + C.GoString(nodeResult.error))
+		}
+		timeStretchResult := C.audioplayer_get_time_stretch_node_ptr(playerPtr)
+		if timeStretchResult.error != nil {
+			return latencyPath{}, errors.New("failed to get time stretch node: " + C.GoString(timeStretchResult.error))
+		}
+		timePitchResult := C.audioplayer_get_time_pitch_node_ptr(playerPtr)
+		if timePitchResult.error != nil {
+			return latencyPath{}, errors.New("failed to get time/pitch node: " + C.GoString(timePitchResult.error))
+		}
+		return latencyPath{
+			nodes:  []unsafe.Pointer{nodeResult.result, timeStretchResult.result, timePitchResult.result, channel.mixerNodePtr},
+			source: timePitchResult.result,
+			mixer:  channel.mixerNodePtr,
+			bus:    0,
+		}, nil
+
+	case channel.IsSampler() && channel.SamplerOptions.samplerPtr != nil:
+		busIndex, err := e.GetChannelBus(channel)
+		if err != nil {
+			return latencyPath{}, err
+		}
+		mixerResult := C.audioengine_main_mixer_node(e.nativeEngine)
+		if mixerResult.error != nil {
+			return latencyPath{}, errors.New("failed to get main mixer: " + C.GoString(mixerResult.error))
+		}
+		samplerNode := (*C.AudioSampler)(channel.SamplerOptions.samplerPtr).samplerNode
+		return latencyPath{
+			nodes:  []unsafe.Pointer{samplerNode},
+			source: samplerNode,
+			mixer:  mixerResult.result,
+			bus:    busIndex,
+		}, nil
+	}
+	return latencyPath{}, nil
+}
+
+// setChannelDelay holds one channel back by `frames`, whatever its latency
+func (e *Engine) setChannelDelay(channel *Channel, frames int) error {
+	path, err := e.channelLatencyPath(channel)
+	if err != nil {
+		return err
+	}
+	if path.source == nil {
+		return errors.New("channel is not wired to the main mixer")
+	}
+	return path.setDelay(frames)
+}
+
+func (p latencyPath) setDelay(frames int) error {
+	if frames > C.MIXER_MAX_INPUT_DELAY {
+		return fmt.Errorf("%d frames of delay needed, more than %d", frames, C.MIXER_MAX_INPUT_DELAY)
+	}
+	if errorStr := C.audiomixer_set_input_delay_for_connection(p.source, p.mixer, C.int(p.bus), C.int(frames)); errorStr != nil {
+		return fmt.Errorf("failed to set compensating delay: %s", C.GoString(errorStr))
+	}
+	return nil
+}
+
+// latency sums what the path's nodes report
+func (p latencyPath) latency() (int, error) {
+	total := 0
+	for _, node := range p.nodes {
+		var frames C.int
+		if errorStr := C.audionode_get_latency(node, &frames); errorStr != nil {
+			return 0, fmt.Errorf("failed to get node latency: %s", C.GoString(errorStr))
+		}
+		total += int(frames)
+	}
+	return total, nil
+}
@@ -0,0 +1,45 @@
+package engine
+
+/*
+#include "../native/macaudio.h"
+*/
+import "C"
+import "fmt"
+
+// =============================================================================
+// Public API - Loop regions
+// =============================================================================
+
+// LoopRegion is a span of a playback channel's file to repeat
+type LoopRegion struct {
+	Start     int64   `json:"start"`     // First file frame of the loop
+	End       int64   `json:"end"`       // File frame playback wraps at
+	Crossfade float64 `json:"crossfade"` // Seconds of the audio before Start blended in ahead of End (0 to 10)
+}
+
+// SetLoop makes the channel wrap from region.End back to region.Start every
+// time its file plays through End, inside the render cycle, so the loop runs
+// for hours without a gap or a call from Go. A Crossfade needs that many
+// seconds of audio before Start. Playhead().Loops counts the wraps.
+func (c *Channel) SetLoop(region LoopRegion) error {
+	playerPtr, err := c.nativePlayer()
+	if err != nil {
+		return err
+	}
+	if errorStr := C.audioplayer_set_loop(playerPtr, C.int64_t(region.Start), C.int64_t(region.End), C.double(region.Crossfade)); errorStr != nil {
+		return fmt.Errorf("failed to set loop: %s", C.GoString(errorStr))
+	}
+	return nil
+}
+
+// ClearLoop lets playback run on past the loop end
+func (c *Channel) ClearLoop() error {
+	playerPtr, err := c.nativePlayer()
+	if err != nil {
+		return err
+	}
+	if errorStr := C.audioplayer_clear_loop(playerPtr); errorStr != nil {
+		return fmt.Errorf("failed to clear loop: %s", C.GoString(errorStr))
+	}
+	return nil
+}
@@ -0,0 +1,121 @@
+package engine
+
+/*
+#include "../native/macaudio.h"
+*/
+import "C"
+import (
+	"errors"
+	"fmt"
+	"math"
+	"unsafe"
+)
+
+// =============================================================================
+// Public API - Loudness (EBU R128)
+// =============================================================================
+
+// LoudnessSilence is reported for loudness values while there is not enough
+// (or only silent) audio to measure
+const LoudnessSilence = float64(C.LOUDNESS_SILENCE_LUFS)
+
+// Loudness is an EBU R128 measurement: loudness in LUFS, range in LU, and
+// 4x-oversampled true peak as linear amplitude
+type Loudness struct {
+	Momentary        float64                      `json:"momentary"` // 400 ms window
+	ShortTerm        float64                      `json:"shortTerm"` // 3 s window
+	Integrated       float64                      `json:"integrated"`
+	Range            float64                      `json:"range"`
+	MaxMomentary     float64                      `json:"maxMomentary"`
+	MaxShortTerm     float64                      `json:"maxShortTerm"`
+	TruePeak         float32                      `json:"truePeak"` // Highest of all channels
+	ChannelCount     int                          `json:"channelCount"`
+	ChannelTruePeaks [TapMeterMaxChannels]float32 `json:"channelTruePeaks"`
+	Frames           int64                        `json:"frames"`
+}
+
+// TruePeakDB returns the true peak in dBTP
+func (l Loudness) TruePeakDB() float64 {
+	return 20 * math.Log10(float64(l.TruePeak))
+}
+
+func loudnessFromC(metrics *C.LoudnessMetrics) Loudness {
+	l := Loudness{
+		Momentary:    float64(metrics.momentary),
+		ShortTerm:    float64(metrics.shortTerm),
+		Integrated:   float64(metrics.integrated),
+		Range:        float64(metrics.loudnessRange),
+		MaxMomentary: float64(metrics.maxMomentary),
+		MaxShortTerm: float64(metrics.maxShortTerm),
+		TruePeak:     float32(metrics.truePeak),
+		ChannelCount: int(metrics.channelCount),
+		Frames:       int64(metrics.frames),
+	}
+	for c := range l.ChannelTruePeaks {
+		l.ChannelTruePeaks[c] = float32(metrics.channelTruePeak[c])
+	}
+	return l
+}
+
+// MeasureLoudness measures planar float32 audio (`channels` equal-length
+// planes back to back) with the same meter taps and file analysis use. Six
+// channels are taken as 5.1 (L R C LFE Ls Rs).
+func MeasureLoudness(planar []float32, channels int, sampleRate float64) (Loudness, error) {
+	if channels <= 0 || channels > TapMeterMaxChannels {
+		return Loudness{}, fmt.Errorf("channel count must be 1-%d", TapMeterMaxChannels)
+	}
+	if len(planar)%channels != 0 {
+		return Loudness{}, errors.New("planar data length must be a multiple of the channel count")
+	}
+	if sampleRate <= 0 {
+		return Loudness{}, errors.New("sample rate must be positive")
+	}
+	frames := len(planar) / channels
+	if frames == 0 {
+		return Loudness{}, errors.New("no audio to measure")
+	}
+
+	var metrics C.LoudnessMetrics
+	C.loudness_measure_planar((*C.float)(unsafe.Pointer(&planar[0])), C.int(channels), C.int(frames), C.double(sampleRate), &metrics)
+	return loudnessFromC(&metrics), nil
+}
+
+// EnableLoudness turns the tap's loudness meter on (starting a fresh
+// measurement) or off. The meter runs on the audio thread alongside the tap.
+func (h TapHandle) EnableLoudness(enabled bool) error {
+	if errorStr := C.tap_enable_loudness(C.TapHandle(h), C.bool(enabled)); errorStr != nil {
+		return fmt.Errorf("failed to enable loudness on tap %#x: %s", uint32(h), C.GoString(errorStr))
+	}
+	return nil
+}
+
+// ResetLoudness restarts the tap's integrated loudness, range, maxima and true peak
+func (h TapHandle) ResetLoudness() error {
+	if errorStr := C.tap_reset_loudness(C.TapHandle(h)); errorStr != nil {
+		return fmt.Errorf("failed to reset loudness on tap %#x: %s", uint32(h), C.GoString(errorStr))
+	}
+	return nil
+}
+
+// Loudness returns the tap's loudness since it was enabled or reset
+func (h TapHandle) Loudness() (Loudness, error) {
+	var metrics C.LoudnessMetrics
+	if errorStr := C.tap_get_loudness(C.TapHandle(h), &metrics); errorStr != nil {
+		return Loudness{}, fmt.Errorf("failed to read loudness on tap %#x: %s", uint32(h), C.GoString(errorStr))
+	}
+	return loudnessFromC(&metrics), nil
+}
+
+// AnalyzeLoudness measures a segment of a playback channel's file
+func (c *Channel) AnalyzeLoudness(startTime, duration float64) (Loudness, error) {
+	playerPtr, err := c.nativePlayer()
+	if err != nil {
+		return Loudness{}, err
+	}
+
+	var metrics C.LoudnessMetrics
+	if errorStr := C.audioplayer_analyze_loudness(playerPtr, C.double(startTime), C.double(duration), &metrics); errorStr != nil {
+		return Loudness{}, fmt.Errorf("failed to analyze loudness: %s", C.GoString(errorStr))
+	}
+	return loudnessFromC(&metrics), nil
+}
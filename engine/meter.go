@@ -0,0 +1,76 @@
+package engine
+
+/*
+#include "../native/macaudio.h"
+*/
+import "C"
+import (
+	"errors"
+	"unsafe"
+)
+
+// =============================================================================
+// Public API - Metering
+// =============================================================================
+
+// ChannelLevels holds one channel's levels from the native metering kernel
+type ChannelLevels struct {
+	RMS          float32 `json:"rms"`
+	Peak         float32 `json:"peak"`         // Absolute peak
+	SumOfSquares float64 `json:"sumOfSquares"` // For combining blocks: RMS = sqrt(Σ / frames)
+	Clips        int     `json:"clips"`        // Samples at or beyond full scale
+}
+
+// MeasureLevels meters planar float32 audio with the same vectorized kernel
+// used by taps and file analysis. `planar` holds `channels` equal-length
+// planes back to back (channel c starts at c*len(planar)/channels).
+func MeasureLevels(planar []float32, channels int) ([]ChannelLevels, error) {
+	levels := make([]ChannelLevels, channels)
+	if err := MeasureLevelsInto(levels, planar); err != nil {
+		return nil, err
+	}
+	return levels, nil
+}
+
+// MeasureLevelsInto is MeasureLevels writing into a caller-owned slice, one
+// entry per channel, so hot paths don't allocate.
+func MeasureLevelsInto(levels []ChannelLevels, planar []float32) error {
+	channels := len(levels)
+	if channels <= 0 {
+		return errors.New("channel count must be positive")
+	}
+	if len(planar)%channels != 0 {
+		return errors.New("planar data length must be a multiple of the channel count")
+	}
+	frames := len(planar) / channels
+	if frames == 0 {
+		for i := range levels {
+			levels[i] = ChannelLevels{}
+		}
+		return nil
+	}
+
+	var stats [C.TAP_METER_MAX_CHANNELS]C.MeterChannelStats
+	for first := 0; first < channels; first += len(stats) {
+		count := channels - first
+		if count > len(stats) {
+			count = len(stats)
+		}
+		data := (*C.float)(unsafe.Pointer(&planar[first*frames]))
+		C.meter_measure_planar(data, C.int(count), C.int(frames), &stats[0])
+		for c := 0; c < count; c++ {
+			levels[first+c] = ChannelLevels{
+				RMS:          float32(stats[c].rms),
+				Peak:         float32(stats[c].peak),
+				SumOfSquares: float64(stats[c].sumOfSquares),
+				Clips:        int(stats[c].clipCount),
+			}
+		}
+	}
+	return nil
+}
+
+// MeterKernel reports which metering kernel this CPU uses ("avx2", "sse2", "neon" or "scalar")
+func MeterKernel() string {
+	return C.GoString(C.meter_kernel_name())
+}
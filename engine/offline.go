@@ -0,0 +1,189 @@
+package engine
+
+/*
+#include "../native/macaudio.h"
+#include <stdlib.h>
+*/
+import "C"
+import (
+	"bufio"
+	"errors"
+	"io"
+	"os"
+	"time"
+	"unsafe"
+)
+
+// =============================================================================
+// Public API - Offline Rendering
+// =============================================================================
+
+// SampleLayout selects how RenderOffline lays out float32 samples
+type SampleLayout int
+
+const (
+	// Interleaved writes frames as L R L R ...
+	Interleaved SampleLayout = iota
+	// Planar writes each block channel by channel (BufferSize samples of L, then R)
+	Planar
+)
+
+// offlineChannelCount is the bounce width: the main mixer is stereo
+const offlineChannelCount = 2
+
+// OfflineRenderOptions configures RenderOffline. A nil options value renders
+// interleaved with no per-block callback.
+type OfflineRenderOptions struct {
+	Layout SampleLayout
+
+	// BeforeBlock, if set, runs before each block is rendered with the frame
+	// position of the block's first sample. Use it to sequence sampler notes
+	// or parameter changes with block accuracy.
+	BeforeBlock func(frame int64)
+}
+
+// OfflineRenderStats reports what RenderOffline produced and how fast
+type OfflineRenderStats struct {
+	Frames     int64         // Frames rendered per channel
+	SampleRate int           // Render sample rate (Engine.SampleRate)
+	Channels   int           // Channels per frame
+	Elapsed    time.Duration // Wall-clock time spent rendering and writing
+
+	// RealtimeFactor is rendered audio duration divided by wall-clock time
+	// (e.g. 40 means one minute of audio took 1.5 seconds).
+	RealtimeFactor float64
+}
+
+// RenderOffline bounces the whole graph (playback channels, sampler channels,
+// master volume) for `duration` without a device, as fast as the CPU allows,
+// and writes raw native-endian float32 PCM to sink.
+//
+// The engine is switched to manual rendering at Engine.SampleRate with blocks
+// of Engine.BufferSize frames. Every playback channel starts from the top of
+// its file. Afterwards playback channels are stopped, realtime rendering is
+// restored and the engine is restarted if it was running before.
+func (e *Engine) RenderOffline(duration time.Duration, sink io.Writer, opts *OfflineRenderOptions) (*OfflineRenderStats, error) {
+	if e.nativeEngine == nil {
+		return nil, errors.New("engine is not initialized")
+	}
+	if sink == nil {
+		return nil, errors.New("sink cannot be nil")
+	}
+	if duration <= 0 {
+		return nil, errors.New("duration must be positive")
+	}
+	if e.SampleRate <= 0 || e.BufferSize <= 0 {
+		return nil, errors.New("engine sample rate and buffer size must be positive")
+	}
+	if opts == nil {
+		opts = &OfflineRenderOptions{}
+	}
+
+	wasRunning := e.IsRunning()
+	if wasRunning {
+		e.Stop()
+	}
+
+	errorStr := C.audioengine_enable_manual_rendering(e.nativeEngine, C.double(e.SampleRate), C.int(offlineChannelCount), C.int(e.BufferSize))
+	if errorStr != nil {
+		e.restartAfterOffline(wasRunning)
+		return nil, errors.New("failed to enable manual rendering: " + C.GoString(errorStr))
+	}
+
+	stats, err := e.renderManual(duration, sink, opts)
+
+	e.stopPlaybackChannels()
+	e.Stop()
+	if errorStr := C.audioengine_disable_manual_rendering(e.nativeEngine); errorStr != nil && err == nil {
+		err = errors.New("failed to disable manual rendering: " + C.GoString(errorStr))
+	}
+	e.restartAfterOffline(wasRunning)
+
+	return stats, err
+}
+
+// RenderOfflineToFile is RenderOffline writing into a newly created file at path
+func (e *Engine) RenderOfflineToFile(duration time.Duration, path string, opts *OfflineRenderOptions) (*OfflineRenderStats, error) {
+	if err := ValidateFilePath(path); err != nil {
+		return nil, err
+	}
+
+	file, err := os.Create(path)
+	if err != nil {
+		return nil, errors.New("failed to create output file: " + err.Error())
+	}
+
+	writer := bufio.NewWriterSize(file, 1<<20)
+	stats, err := e.RenderOffline(duration, writer, opts)
+	if err == nil {
+		err = writer.Flush()
+	}
+	if closeErr := file.Close(); err == nil {
+		err = closeErr
+	}
+	return stats, err
+}
+
+// renderManual starts the armed engine, starts playback and pulls blocks into sink
+func (e *Engine) renderManual(duration time.Duration, sink io.Writer, opts *OfflineRenderOptions) (*OfflineRenderStats, error) {
+	if errorStr := C.audioengine_start(e.nativeEngine); errorStr != nil {
+		return nil, errors.New("failed to start manual rendering: " + C.GoString(errorStr))
+	}
+
+	for _, channel := range e.Channels {
+		if channel != nil && channel.IsPlayback() && channel.PlaybackOptions.playerPtr != nil {
+			if err := channel.Play(); err != nil {
+				return nil, err
+			}
+		}
+	}
+
+	totalFrames := int64(duration.Seconds()*float64(e.SampleRate) + 0.5)
+	block := make([]float32, e.BufferSize*offlineChannelCount)
+	// The block is handed to the writer without copying
+	blockBytes := unsafe.Slice((*byte)(unsafe.Pointer(&block[0])), len(block)*4)
+	interleaved := C.bool(opts.Layout == Interleaved)
+
+	stats := &OfflineRenderStats{SampleRate: e.SampleRate, Channels: offlineChannelCount}
+	start := time.Now()
+	for stats.Frames < totalFrames {
+		frames := e.BufferSize
+		if remaining := totalFrames - stats.Frames; remaining < int64(frames) {
+			frames = int(remaining)
+		}
+		if opts.BeforeBlock != nil {
+			opts.BeforeBlock(stats.Frames)
+		}
+
+		errorStr := C.audioengine_render_offline(e.nativeEngine, (*C.float)(unsafe.Pointer(&block[0])), C.int(frames), interleaved)
+		if errorStr != nil {
+			return stats, errors.New("offline render failed: " + C.GoString(errorStr))
+		}
+		if _, err := sink.Write(blockBytes[:frames*offlineChannelCount*4]); err != nil {
+			return stats, errors.New("failed to write rendered audio: " + err.Error())
+		}
+		stats.Frames += int64(frames)
+	}
+
+	stats.Elapsed = time.Since(start)
+	if stats.Elapsed > 0 {
+		stats.RealtimeFactor = duration.Seconds() / stats.Elapsed.Seconds()
+	}
+	return stats, nil
+}
+
+// stopPlaybackChannels stops every player so nothing keeps sounding after a bounce
+func (e *Engine) stopPlaybackChannels() {
+	for _, channel := range e.Channels {
+		if channel != nil && channel.IsPlayback() && channel.PlaybackOptions.playerPtr != nil {
+			C.audioplayer_stop((*C.AudioPlayer)(channel.PlaybackOptions.playerPtr))
+		}
+	}
+}
+
+// restartAfterOffline restores realtime rendering if the engine was running before
+func (e *Engine) restartAfterOffline(wasRunning bool) {
+	if wasRunning {
+		C.audioengine_start(e.nativeEngine)
+	}
+}
@@ -0,0 +1,53 @@
+package engine
+
+/*
+#include "../native/macaudio.h"
+*/
+import "C"
+import "fmt"
+
+// =============================================================================
+// Public API - Shared decoded-audio cache
+// =============================================================================
+
+// PCMCacheStats describes the shared decoded-audio cache
+type PCMCacheStats struct {
+	Entries     int   `json:"entries"`
+	InUse       int   `json:"inUse"` // Entries referenced by at least one channel
+	Bytes       int64 `json:"bytes"`
+	BudgetBytes int64 `json:"budgetBytes"`
+	Hits        int64 `json:"hits"` // Loads answered from the cache
+	Misses      int64 `json:"misses"`
+	Evictions   int64 `json:"evictions"`
+}
+
+// SetPCMCacheBudget turns on the process-wide decoded-audio cache: playback
+// channels on the same file (alt takes, layered effects) share one read-only
+// copy of its decoded PCM instead of each decoding their own. Copies are keyed
+// by path, size, modification time and decoded format, and reference counted
+// by the channels using them. Unused copies are evicted, least recently used
+// first, while the total is over budgetBytes; copies in use never are. A
+// budget of 0 turns the cache off and frees every unused copy.
+func SetPCMCacheBudget(budgetBytes int64) error {
+	if errorStr := C.pcm_cache_set_budget(C.int64_t(budgetBytes)); errorStr != nil {
+		return fmt.Errorf("failed to set PCM cache budget: %s", C.GoString(errorStr))
+	}
+	return nil
+}
+
+// GetPCMCacheStats reports the cache's size and hit rate
+func GetPCMCacheStats() (PCMCacheStats, error) {
+	var stats C.PcmCacheStats
+	if errorStr := C.pcm_cache_get_stats(&stats); errorStr != nil {
+		return PCMCacheStats{}, fmt.Errorf("failed to get PCM cache stats: %s", C.GoString(errorStr))
+	}
+	return PCMCacheStats{
+		Entries:     int(stats.entries),
+		InUse:       int(stats.inUse),
+		Bytes:       int64(stats.bytes),
+		BudgetBytes: int64(stats.budgetBytes),
+		Hits:        int64(stats.hits),
+		Misses:      int64(stats.misses),
+		Evictions:   int64(stats.evictions),
+	}, nil
+}
@@ -0,0 +1,103 @@
+package engine
+
+/*
+#include "../native/macaudio.h"
+*/
+import "C"
+import (
+	"errors"
+	"fmt"
+	"unsafe"
+)
+
+// =============================================================================
+// Public API - Waveform overview
+// =============================================================================
+
+// PeakColumn is the min, max and RMS of one channel over one display column
+type PeakColumn struct {
+	Min float32 `json:"min"`
+	Max float32 `json:"max"`
+	RMS float32 `json:"rms"`
+}
+
+// PeaksStatus reports the progress of a channel's waveform overview
+type PeaksStatus struct {
+	Building   bool    `json:"building"` // Requested and not failed
+	Ready      bool    `json:"ready"`    // Peaks can be queried
+	Cached     bool    `json:"cached"`   // Loaded from the .peaks file
+	Progress   float64 `json:"progress"` // 0..1
+	Channels   int     `json:"channels"`
+	SampleRate float64 `json:"sampleRate"`
+	Frames     int64   `json:"frames"`
+	Error      string  `json:"error,omitempty"`
+}
+
+// BuildPeaks starts building the loaded file's waveform overview on a
+// background thread; poll PeaksStatus for progress. With persist the overview
+// is saved as "<file>.peaks" and reused while the file is unchanged. Loading
+// another file discards it.
+func (c *Channel) BuildPeaks(persist bool) error {
+	playerPtr, err := c.nativePlayer()
+	if err != nil {
+		return err
+	}
+	if errorStr := C.audioplayer_build_peaks(playerPtr, C.bool(persist)); errorStr != nil {
+		return fmt.Errorf("failed to build peaks: %s", C.GoString(errorStr))
+	}
+	return nil
+}
+
+// PeaksStatus reports whether the overview is building, ready or failed
+func (c *Channel) PeaksStatus() (PeaksStatus, error) {
+	playerPtr, err := c.nativePlayer()
+	if err != nil {
+		return PeaksStatus{}, err
+	}
+	var status C.PeaksStatus
+	if errorStr := C.audioplayer_get_peaks_status(playerPtr, &status); errorStr != nil {
+		return PeaksStatus{}, fmt.Errorf("failed to get peaks status: %s", C.GoString(errorStr))
+	}
+	result := PeaksStatus{
+		Building:   bool(status.building),
+		Ready:      bool(status.ready),
+		Cached:     bool(status.cached),
+		Progress:   float64(status.progress),
+		Channels:   int(status.channelCount),
+		SampleRate: float64(status.sampleRate),
+		Frames:     int64(status.frames),
+	}
+	if status.error != nil {
+		result.Error = C.GoString(status.error)
+	}
+	return result, nil
+}
+
+// Peaks splits [startTime, startTime+duration) into columns equal spans and
+// returns columns*Channels values, column-major (column i, channel ch at
+// i*Channels+ch). It reads only the overview, never audio, so it is cheap at
+// any zoom. dst is reused when it has room.
+func (c *Channel) Peaks(startTime, duration float64, columns int, dst []PeakColumn) ([]PeakColumn, error) {
+	status, err := c.PeaksStatus()
+	if err != nil {
+		return nil, err
+	}
+	if columns <= 0 {
+		return nil, errors.New("columns must be positive")
+	}
+	n := columns * status.Channels
+	if cap(dst) < n {
+		dst = make([]PeakColumn, n)
+	}
+	dst = dst[:n]
+	if n == 0 {
+		return nil, errors.New("peaks not built")
+	}
+
+	playerPtr, _ := c.nativePlayer()
+	if errorStr := C.audioplayer_get_peaks(playerPtr, C.double(startTime), C.double(duration), C.int(columns),
+		(*C.PeakColumn)(unsafe.Pointer(&dst[0])), C.int(n)); errorStr != nil {
+		return nil, fmt.Errorf("failed to get peaks: %s", C.GoString(errorStr))
+	}
+	return dst, nil
+}
@@ -0,0 +1,107 @@
+package engine
+
+/*
+#include "../native/macaudio.h"
+*/
+import "C"
+import (
+	"errors"
+	"fmt"
+)
+
+// =============================================================================
+// Public API - Pitch shifting
+// =============================================================================
+
+// PitchShiftQuality selects the phase vocoder's FFT size and overlap: larger
+// FFTs resolve low voices better, more overlap smears transients less, and
+// both cost more
+type PitchShiftQuality int
+
+const (
+	PitchShiftLow    PitchShiftQuality = C.PITCH_SHIFT_QUALITY_LOW    // 1024-point FFT, 4x overlap
+	PitchShiftMedium PitchShiftQuality = C.PITCH_SHIFT_QUALITY_MEDIUM // 2048, 4x
+	PitchShiftHigh   PitchShiftQuality = C.PITCH_SHIFT_QUALITY_HIGH   // 2048, 8x
+	PitchShiftBest   PitchShiftQuality = C.PITCH_SHIFT_QUALITY_BEST   // 4096, 8x
+)
+
+// PitchShiftOptions configures a pitch shifter. The zero value is medium
+// quality without formant preservation.
+type PitchShiftOptions struct {
+	Quality          PitchShiftQuality `json:"quality"`
+	FFTSize          int               `json:"fftSize"`          // 0 for the quality's own, else a power of two from 512 to 8192
+	PreserveFormants bool              `json:"preserveFormants"` // Keep the spectral envelope in place, for voices
+}
+
+func (o PitchShiftOptions) native() C.PitchShiftOptions {
+	return C.PitchShiftOptions{quality: C.int(o.Quality), fftSize: C.int(o.FFTSize), preserveFormants: C.bool(o.PreserveFormants)}
+}
+
+// PitchShifter shifts planar float audio by up to two octaves either way
+// without changing its duration, with a phase-locked phase vocoder. Output
+// runs Latency frames behind the input; at 0 cents it is the input delayed.
+// A pitch shifter is not safe for concurrent use.
+type PitchShifter struct {
+	SampleRate float64
+	Channels   int
+	Options    PitchShiftOptions
+	FFTSize    int
+	Hop        int    // Frames between analyses; a new shift applies from the next one
+	Latency    int    // Frames
+	Kernel     string // "avx2", "sse2", "neon" or "scalar"
+
+	shifter *C.PitchShifter
+}
+
+// NewPitchShifter builds a pitch shifter for `channels` planes at sampleRate
+func NewPitchShifter(sampleRate float64, channels int, options PitchShiftOptions) (*PitchShifter, error) {
+	var shifter *C.PitchShifter
+	var info C.PitchShiftInfo
+	cOptions := options.native()
+	if errorStr := C.pitchshift_create(C.double(sampleRate), C.int(channels), &cOptions, &shifter, &info); errorStr != nil {
+		return nil, fmt.Errorf("failed to create pitch shifter: %s", C.GoString(errorStr))
+	}
+	return &PitchShifter{
+		SampleRate: sampleRate,
+		Channels:   channels,
+		Options:    options,
+		FFTSize:    int(info.fftSize),
+		Hop:        int(info.hop),
+		Latency:    int(info.latency),
+		Kernel:     C.GoString(info.kernel),
+		shifter:    shifter,
+	}, nil
+}
+
+// Process shifts the planes in `in` (channel c at in[c*n:], n = len(in) /
+// Channels) by `cents` into the planes of `out`, of the same length. Blocks
+// may be any size, and each may have a shift of its own.
+func (p *PitchShifter) Process(in, out []float32, cents float32) error {
+	if p.shifter == nil {
+		return errors.New("pitch shifter is closed")
+	}
+	if len(in)%p.Channels != 0 || len(out) != len(in) {
+		return fmt.Errorf("expected input and output of the same whole number of %d channel planes, got %d and %d samples", p.Channels, len(in), len(out))
+	}
+	if len(in) == 0 {
+		return nil
+	}
+	C.pitchshift_process(p.shifter, floatPointer(in), floatPointer(out), C.int(len(in)/p.Channels), C.float(cents))
+	return nil
+}
+
+// Reset forgets the signal so far, ready to shift a new one
+func (p *PitchShifter) Reset() {
+	if p.shifter != nil {
+		C.pitchshift_reset(p.shifter)
+	}
+}
+
+// Close frees the pitch shifter
+func (p *PitchShifter) Close() {
+	if p.shifter == nil {
+		return
+	}
+	C.pitchshift_destroy(p.shifter)
+	p.shifter = nil
+}
@@ -8,6 +8,7 @@ import "C"
 import (
 	"errors"
 	"fmt"
+	"time"
 	"unsafe"
 )
 
@@ -81,6 +82,13 @@ func (e *Engine) CreatePlaybackChannel(filePath string) (*Channel, error) {
 		return nil, errors.New("failed to get time/pitch node: " + C.GoString(timePitchResult.error))
 	}
 
+	// Get the time stretch node that carries the playback rate
+	timeStretchResult := C.audioplayer_get_time_stretch_node_ptr(playerPtr)
+	if timeStretchResult.error != nil {
+		C.audioplayer_destroy(playerPtr)
+		return nil, errors.New("failed to get time stretch node: " + C.GoString(timeStretchResult.error))
+	}
+
 	// Create a dedicated mixer node for this channel
 	channelMixerResult := C.audioengine_create_mixer_node(e.nativeEngine)
 	if channelMixerResult.error != nil {
@@ -104,17 +112,29 @@ func (e *Engine) CreatePlaybackChannel(filePath string) (*Channel, error) {
 		return nil, errors.New("failed to attach time/pitch unit to engine: " + C.GoString(errorStr))
 	}
 
+	errorStr = C.audioengine_attach(e.nativeEngine, timeStretchResult.result)
+	if errorStr != nil {
+		C.audioplayer_destroy(playerPtr)
+		return nil, errors.New("failed to attach time stretch unit to engine: " + C.GoString(errorStr))
+	}
+
 	errorStr = C.audioengine_attach(e.nativeEngine, channelMixerResult.result)
 	if errorStr != nil {
 		C.audioplayer_destroy(playerPtr)
 		return nil, errors.New("failed to attach channel mixer to engine: " + C.GoString(errorStr))
 	}
 
-	// Connect audio graph: Player → TimePitch → ChannelMixer
-	errorStr = C.audioengine_connect(e.nativeEngine, nodeResult.result, timePitchResult.result, 0, 0)
+	// Connect audio graph: Player → TimeStretch → PitchShift → ChannelMixer
+	errorStr = C.audioengine_connect(e.nativeEngine, nodeResult.result, timeStretchResult.result, 0, 0)
 	if errorStr != nil {
 		C.audioplayer_destroy(playerPtr)
-		return nil, errors.New("failed to connect player to time/pitch unit: " + C.GoString(errorStr))
+		return nil, errors.New("failed to connect player to time stretch unit: " + C.GoString(errorStr))
+	}
+
+	errorStr = C.audioengine_connect(e.nativeEngine, timeStretchResult.result, timePitchResult.result, 0, 0)
+	if errorStr != nil {
+		C.audioplayer_destroy(playerPtr)
+		return nil, errors.New("failed to connect time stretch unit to time/pitch unit: " + C.GoString(errorStr))
 	}
 
 	errorStr = C.audioengine_connect(e.nativeEngine, timePitchResult.result, channelMixerResult.result, 0, 0)
@@ -159,9 +179,28 @@ func (e *Engine) CreatePlaybackChannel(filePath string) (*Channel, error) {
 	}
 
 	e.Channels = append(e.Channels, channel)
+
+	// Line the new path up with the others at the main mixer
+	if _, err := e.CompensateLatency(); err != nil {
+		e.DestroyChannel(len(e.Channels) - 1)
+		return nil, err
+	}
 	return channel, nil
 }
 
+// nativePlayer returns the playback channel's native player
+func (c *Channel) nativePlayer() (*C.AudioPlayer, error) {
+	if !c.IsPlayback() {
+		return nil, errors.New("channel is not a playback channel")
+	}
+
+	if c.PlaybackOptions.playerPtr == nil {
+		return nil, errors.New("no native player available")
+	}
+
+	return (*C.AudioPlayer)(c.PlaybackOptions.playerPtr), nil
+}
+
 // PlayChannel starts playback for a playback channel
 func (c *Channel) Play() error {
 	if !c.IsPlayback() {
@@ -181,6 +220,29 @@ func (c *Channel) Play() error {
 	return nil
 }
 
+// Seek moves playback to timeSeconds into the file. While the channel plays,
+// the jump happens in place at the next render cycle, landing on the exact
+// sample and fading the old position out over crossfadeSeconds (0 to 0.1);
+// otherwise playback starts there. On macOS the player is stopped and
+// restarted at the target instead, so the jump is not crossfaded.
+func (c *Channel) Seek(timeSeconds, crossfadeSeconds float64) error {
+	if !c.IsPlayback() {
+		return errors.New("channel is not a playback channel")
+	}
+
+	if c.PlaybackOptions.playerPtr == nil {
+		return errors.New("no native player available")
+	}
+
+	playerPtr := (*C.AudioPlayer)(c.PlaybackOptions.playerPtr)
+	errorStr := C.audioplayer_seek(playerPtr, C.double(timeSeconds), C.double(crossfadeSeconds))
+	if errorStr != nil {
+		return errors.New("failed to seek: " + C.GoString(errorStr))
+	}
+
+	return nil
+}
+
 // EnableTimePitchEffects enables time/pitch processing for this playback channel
 func (c *Channel) EnableTimePitchEffects() error {
 	if !c.IsPlayback() {
@@ -219,7 +281,9 @@ func (c *Channel) DisableTimePitchEffects() error {
 	return nil
 }
 
-// SetPlaybackRate sets the playback rate (0.25x to 1.25x, normal = 1.0)
+// SetPlaybackRate sets the playback rate (0.25x to 1.25x, normal = 1.0).
+// The channel's time stretch unit applies it from its next 10 ms grain
+// without changing pitch; see RateLatency.
 func (c *Channel) SetPlaybackRate(rate float32) error {
 	if !c.IsPlayback() {
 		return errors.New("channel is not a playback channel")
@@ -268,6 +332,28 @@ func (c *Channel) GetPlaybackRate() (float32, error) {
 	return float32(rate), nil
 }
 
+// RateLatency reports how far the channel's time stretch unit has read
+// ahead of what is heard: the audio it pulled from the player but has not
+// played yet, which bounds how late a rate change or seek is heard. The
+// channel's path reports it to latency compensation (see CompensateLatency).
+func (c *Channel) RateLatency() (time.Duration, error) {
+	if !c.IsPlayback() {
+		return 0, errors.New("channel is not a playback channel")
+	}
+
+	if c.PlaybackOptions.playerPtr == nil {
+		return 0, errors.New("no native player available")
+	}
+
+	var seconds C.double
+	playerPtr := (*C.AudioPlayer)(c.PlaybackOptions.playerPtr)
+	errorStr := C.audioplayer_get_time_stretch_latency(playerPtr, &seconds)
+	if errorStr != nil {
+		return 0, errors.New("failed to get rate latency: " + C.GoString(errorStr))
+	}
+	return time.Duration(float64(seconds) * float64(time.Second)), nil
+}
+
 // SetPitch sets the pitch shift in semitones (-12 to +12, normal = 0)
 func (c *Channel) SetPitch(pitch float32) error {
 	if !c.IsPlayback() {
@@ -322,3 +408,211 @@ func (c *Channel) GetPitch() (float32, error) {
 	c.PlaybackOptions.Pitch = pitchInSemitones
 	return pitchInSemitones, nil
 }
+
+// SetPitchShiftOptions chooses the quality, FFT size and formant preservation
+// of the channel's pitch shift unit. It may be called while playing: the
+// formant switch applies from the next block, and a new quality or FFT size
+// restarts the unit, dropping what it holds.
+func (c *Channel) SetPitchShiftOptions(options PitchShiftOptions) error {
+	if !c.IsPlayback() {
+		return errors.New("channel is not a playback channel")
+	}
+
+	if c.PlaybackOptions.playerPtr == nil {
+		return errors.New("no native player available")
+	}
+
+	cOptions := options.native()
+	playerPtr := (*C.AudioPlayer)(c.PlaybackOptions.playerPtr)
+	errorStr := C.audioplayer_set_pitch_shift_options(playerPtr, &cOptions)
+	if errorStr != nil {
+		return errors.New("failed to set pitch shift options: " + C.GoString(errorStr))
+	}
+
+	c.PlaybackOptions.PitchShift = options
+	return nil
+}
+
+// GetPitchShiftOptions returns the pitch shift unit's options and its latency
+// in frames at the engine's sample rate, which holds at any pitch while the
+// unit is not routed around (see Elision). The channel's path reports it to
+// latency compensation while the unit shifts (see CompensateLatency).
+func (c *Channel) GetPitchShiftOptions() (PitchShiftOptions, int, error) {
+	if !c.IsPlayback() {
+		return PitchShiftOptions{}, 0, errors.New("channel is not a playback channel")
+	}
+
+	if c.PlaybackOptions.playerPtr == nil {
+		return PitchShiftOptions{}, 0, errors.New("no native player available")
+	}
+
+	var cOptions C.PitchShiftOptions
+	var info C.PitchShiftInfo
+	playerPtr := (*C.AudioPlayer)(c.PlaybackOptions.playerPtr)
+	errorStr := C.audioplayer_get_pitch_shift_options(playerPtr, &cOptions, &info)
+	if errorStr != nil {
+		return PitchShiftOptions{}, 0, errors.New("failed to get pitch shift options: " + C.GoString(errorStr))
+	}
+
+	options := PitchShiftOptions{
+		Quality:          PitchShiftQuality(cOptions.quality),
+		FFTSize:          int(cOptions.fftSize),
+		PreserveFormants: bool(cOptions.preserveFormants),
+	}
+	c.PlaybackOptions.PitchShift = options
+	return options, int(info.latency), nil
+}
+
+// SetResampleQuality chooses how a file at another sample rate than the
+// engine is converted to it, while playing and in offline renders alike; the
+// default is ResampleMedium. It may be called while playing.
+func (c *Channel) SetResampleQuality(quality ResampleQuality) error {
+	if !c.IsPlayback() {
+		return errors.New("channel is not a playback channel")
+	}
+
+	if c.PlaybackOptions.playerPtr == nil {
+		return errors.New("no native player available")
+	}
+
+	playerPtr := (*C.AudioPlayer)(c.PlaybackOptions.playerPtr)
+	errorStr := C.audioplayer_set_resampler_quality(playerPtr, C.int(quality))
+	if errorStr != nil {
+		return errors.New("failed to set resample quality: " + C.GoString(errorStr))
+	}
+	return nil
+}
+
+// GetResampleQuality returns the quality of the channel's file-rate conversion
+func (c *Channel) GetResampleQuality() (ResampleQuality, error) {
+	if !c.IsPlayback() {
+		return 0, errors.New("channel is not a playback channel")
+	}
+
+	if c.PlaybackOptions.playerPtr == nil {
+		return 0, errors.New("no native player available")
+	}
+
+	var quality C.int
+	playerPtr := (*C.AudioPlayer)(c.PlaybackOptions.playerPtr)
+	errorStr := C.audioplayer_get_resampler_quality(playerPtr, &quality)
+	if errorStr != nil {
+		return 0, errors.New("failed to get resample quality: " + C.GoString(errorStr))
+	}
+	return ResampleQuality(quality), nil
+}
+
+// ChannelElision reports which of a channel's nodes passed their last render
+// cycle through as they were, routed around: the time stretch at rate 1, the
+// pitch shift at 0 cents, and the channel mixer at unity volume and centre
+// pan. A unit routed around adds no latency, and comes back in as soon as its
+// parameter changes.
+type ChannelElision struct {
+	TimeStretch bool `json:"timeStretch"`
+	PitchShift  bool `json:"pitchShift"`
+	Mixer       bool `json:"mixer"`
+}
+
+// Elision reports which of the channel's nodes are being routed around
+func (c *Channel) Elision() (ChannelElision, error) {
+	var elision ChannelElision
+	if c.mixerNodePtr == nil {
+		return elision, errors.New("no mixer node available for this channel")
+	}
+
+	var elided C.bool
+	if errorStr := C.audionode_is_elided(c.mixerNodePtr, &elided); errorStr != nil {
+		return elision, errors.New("failed to get mixer elision: " + C.GoString(errorStr))
+	}
+	elision.Mixer = bool(elided)
+
+	if !c.IsPlayback() || c.PlaybackOptions.playerPtr == nil {
+		return elision, nil
+	}
+	playerPtr := (*C.AudioPlayer)(c.PlaybackOptions.playerPtr)
+	var enabled C.bool
+	if errorStr := C.audioplayer_is_time_pitch_effects_enabled(playerPtr, &enabled); errorStr != nil {
+		return elision, errors.New("failed to check time/pitch effects: " + C.GoString(errorStr))
+	}
+	if !enabled {
+		return elision, nil
+	}
+
+	timeStretchResult := C.audioplayer_get_time_stretch_node_ptr(playerPtr)
+	if timeStretchResult.error != nil {
+		return elision, errors.New("failed to get time stretch node: " + C.GoString(timeStretchResult.error))
+	}
+	if errorStr := C.audionode_is_elided(timeStretchResult.result, &elided); errorStr != nil {
+		return elision, errors.New("failed to get time stretch elision: " + C.GoString(errorStr))
+	}
+	elision.TimeStretch = bool(elided)
+
+	timePitchResult := C.audioplayer_get_time_pitch_node_ptr(playerPtr)
+	if timePitchResult.error != nil {
+		return elision, errors.New("failed to get time/pitch node: " + C.GoString(timePitchResult.error))
+	}
+	if errorStr := C.audionode_is_elided(timePitchResult.result, &elided); errorStr != nil {
+		return elision, errors.New("failed to get pitch shift elision: " + C.GoString(errorStr))
+	}
+	elision.PitchShift = bool(elided)
+	return elision, nil
+}
+
+// FileInfo describes the file loaded into a playback channel
+type FileInfo struct {
+	SampleRate float64 `json:"sampleRate"`
+	Channels   int     `json:"channels"`
+	Duration   float64 `json:"duration"` // Seconds
+	Format     string  `json:"format"`
+}
+
+// GetFileInfo returns the loaded file's format and duration
+func (c *Channel) GetFileInfo() (FileInfo, error) {
+	if !c.IsPlayback() {
+		return FileInfo{}, errors.New("channel is not a playback channel")
+	}
+
+	if c.PlaybackOptions.playerPtr == nil {
+		return FileInfo{}, errors.New("no native player available")
+	}
+
+	var sampleRate, duration C.double
+	var channels C.int
+	var format *C.char
+	playerPtr := (*C.AudioPlayer)(c.PlaybackOptions.playerPtr)
+	if errorStr := C.audioplayer_get_file_info(playerPtr, &sampleRate, &channels, &format); errorStr != nil {
+		return FileInfo{}, errors.New("failed to get file info: " + C.GoString(errorStr))
+	}
+	if errorStr := C.audioplayer_get_duration(playerPtr, &duration); errorStr != nil {
+		return FileInfo{}, errors.New("failed to get duration: " + C.GoString(errorStr))
+	}
+
+	return FileInfo{
+		SampleRate: float64(sampleRate),
+		Channels:   int(channels),
+		Duration:   float64(duration),
+		Format:     C.GoString(format),
+	}, nil
+}
+
+// AnalyzeRMS returns the RMS of a segment of the loaded file (average of the
+// channels) and the number of frames analyzed
+func (c *Channel) AnalyzeRMS(startTime, duration float64) (float64, int, error) {
+	if !c.IsPlayback() {
+		return 0.0, 0, errors.New("channel is not a playback channel")
+	}
+
+	if c.PlaybackOptions.playerPtr == nil {
+		return 0.0, 0, errors.New("no native player available")
+	}
+
+	var rms C.double
+	var frames C.int
+	playerPtr := (*C.AudioPlayer)(c.PlaybackOptions.playerPtr)
+	errorStr := C.audioplayer_analyze_file_segment(playerPtr, C.double(startTime), C.double(duration), &rms, &frames)
+	if errorStr != nil {
+		return 0.0, 0, errors.New("failed to analyze file segment: " + C.GoString(errorStr))
+	}
+
+	return float64(rms), int(frames), nil
+}
@@ -0,0 +1,58 @@
+package engine
+
+/*
+#include "../native/macaudio.h"
+*/
+import "C"
+import "fmt"
+
+// =============================================================================
+// Public API - Playhead
+// =============================================================================
+
+// Playhead is where a playback channel is in its file, as published by the
+// render thread at HostTime. It follows play-from-time and seeks, and the
+// playback rate of the time stretch unit.
+type Playhead struct {
+	Position float64 `json:"position"` // Seconds into the file heard at HostTime
+	Frame    int64   `json:"frame"`    // The same in file frames
+	Rate     float64 `json:"rate"`     // File seconds per second of output
+	Loops    int64   `json:"loops"`    // Wraps around the loop region since play or the last seek
+	HostTime uint64  `json:"hostTime"` // HostTime() clock, nanoseconds
+	Playing  bool    `json:"playing"`
+}
+
+// HostTime reads the monotonic clock of Playhead.HostTime in nanoseconds
+func HostTime() uint64 {
+	return uint64(C.playhead_host_time())
+}
+
+// At extrapolates the position to hostTime (from HostTime), for smooth
+// display between render cycles
+func (p Playhead) At(hostTime uint64) float64 {
+	if !p.Playing || hostTime <= p.HostTime {
+		return p.Position
+	}
+	return p.Position + float64(hostTime-p.HostTime)/1e9*p.Rate
+}
+
+// Playhead returns the channel's latest published position. It takes no
+// locks, so it can be polled at display rate.
+func (c *Channel) Playhead() (Playhead, error) {
+	playerPtr, err := c.nativePlayer()
+	if err != nil {
+		return Playhead{}, err
+	}
+	var state C.PlayheadState
+	if errorStr := C.audioplayer_get_playhead(playerPtr, &state); errorStr != nil {
+		return Playhead{}, fmt.Errorf("failed to get playhead: %s", C.GoString(errorStr))
+	}
+	return Playhead{
+		Position: float64(state.position),
+		Frame:    int64(state.frame),
+		Rate:     float64(state.rate),
+		Loops:    int64(state.loops),
+		HostTime: uint64(state.hostTime),
+		Playing:  bool(state.playing),
+	}, nil
+}
@@ -0,0 +1,99 @@
+package engine
+
+/*
+#include <stdlib.h>
+#include "../native/macaudio.h"
+*/
+import "C"
+import (
+	"fmt"
+	"unsafe"
+)
+
+// =============================================================================
+// Public API - Gapless queue
+// =============================================================================
+
+// QueueItem is a file, or a segment of one, to play after everything the
+// channel has scheduled
+type QueueItem struct {
+	Path      string  `json:"path"`
+	Start     float64 `json:"start"`     // Seconds into the file
+	Duration  float64 `json:"duration"`  // Seconds to play, 0 = to the end
+	Crossfade float64 `json:"crossfade"` // Seconds of overlap with the previous item (0 to 10), 0 = butt splice; macOS only splices
+}
+
+// QueueStatus reports a playback channel's queue
+type QueueStatus struct {
+	Pending int   `json:"pending"` // Items queued and not started
+	Current int64 `json:"current"` // Id of the item playing, 0 for the channel's own file or nothing
+	Played  int64 `json:"played"`  // Items finished or skipped
+}
+
+// Enqueue decodes item and schedules it behind everything the channel plays,
+// returning its id. It starts on the sample after the previous item ends (or
+// fades in under its last Crossfade seconds) without any call from Go, so a
+// playlist stays gapless however late the next Enqueue comes, as long as it
+// comes before the current item ends. Queue before or after Play; items
+// follow whatever was scheduled when they were queued. On macOS an item with
+// a Crossfade is rejected.
+func (c *Channel) Enqueue(item QueueItem) (int64, error) {
+	playerPtr, err := c.nativePlayer()
+	if err != nil {
+		return 0, err
+	}
+	if err := ValidateFilePath(item.Path); err != nil {
+		return 0, err
+	}
+
+	cPath := C.CString(item.Path)
+	defer C.free(unsafe.Pointer(cPath))
+	var id C.int64_t
+	if errorStr := C.audioplayer_queue_file(playerPtr, cPath, C.double(item.Start), C.double(item.Duration), C.double(item.Crossfade), &id); errorStr != nil {
+		return 0, fmt.Errorf("failed to queue file: %s", C.GoString(errorStr))
+	}
+	return int64(id), nil
+}
+
+// ClearQueue drops every queued item that has not started
+func (c *Channel) ClearQueue() error {
+	playerPtr, err := c.nativePlayer()
+	if err != nil {
+		return err
+	}
+	if errorStr := C.audioplayer_queue_clear(playerPtr); errorStr != nil {
+		return fmt.Errorf("failed to clear queue: %s", C.GoString(errorStr))
+	}
+	return nil
+}
+
+// Skip ends whatever is playing at the next render cycle and goes on with the
+// next item, fading the old one out over crossfadeSeconds (0 to 0.1). On
+// macOS the old one is cut off instead, as with Seek.
+func (c *Channel) Skip(crossfadeSeconds float64) error {
+	playerPtr, err := c.nativePlayer()
+	if err != nil {
+		return err
+	}
+	if errorStr := C.audioplayer_queue_skip(playerPtr, C.double(crossfadeSeconds)); errorStr != nil {
+		return fmt.Errorf("failed to skip: %s", C.GoString(errorStr))
+	}
+	return nil
+}
+
+// QueueStatus reports what is queued and playing
+func (c *Channel) QueueStatus() (QueueStatus, error) {
+	playerPtr, err := c.nativePlayer()
+	if err != nil {
+		return QueueStatus{}, err
+	}
+	var status C.PlayerQueueStatus
+	if errorStr := C.audioplayer_queue_get_status(playerPtr, &status); errorStr != nil {
+		return QueueStatus{}, fmt.Errorf("failed to get queue status: %s", C.GoString(errorStr))
+	}
+	return QueueStatus{
+		Pending: int(status.pending),
+		Current: int64(status.current),
+		Played:  int64(status.played),
+	}, nil
+}
@@ -0,0 +1,162 @@
+package engine
+
+/*
+#include "../native/macaudio.h"
+*/
+import "C"
+import (
+	"errors"
+	"fmt"
+	"math"
+	"unsafe"
+)
+
+// =============================================================================
+// Public API - Sample-rate conversion
+// =============================================================================
+
+// ResampleQuality selects the converter's filter: longer filters have a
+// deeper stopband and a passband reaching closer to Nyquist, at more cost
+type ResampleQuality int
+
+const (
+	ResampleLow    ResampleQuality = C.RESAMPLER_QUALITY_LOW    // 16 taps, 60 dB stopband
+	ResampleMedium ResampleQuality = C.RESAMPLER_QUALITY_MEDIUM // 48 taps, 90 dB
+	ResampleHigh   ResampleQuality = C.RESAMPLER_QUALITY_HIGH   // 96 taps, 110 dB
+	ResampleBest   ResampleQuality = C.RESAMPLER_QUALITY_BEST   // 192 taps, 130 dB
+)
+
+// Resampler converts planar float audio between two sample rates with a
+// polyphase windowed-sinc filter, in blocks of any size. Output frame j is the
+// input at j * InputRate / OutputRate, with no filter delay to compensate.
+// A resampler is not safe for concurrent use.
+type Resampler struct {
+	InputRate    float64
+	OutputRate   float64
+	Channels     int
+	Quality      ResampleQuality
+	Taps         int    // Filter length in input frames
+	Phases       int    // Coefficient rows
+	Interpolated bool   // True when the rates have no short exact cycle
+	Kernel       string // "avx2", "sse2", "neon" or "scalar"
+
+	resampler *C.Resampler
+}
+
+// NewResampler builds a converter; the rates must be within 32:1 of each other
+func NewResampler(inputRate, outputRate float64, channels int, quality ResampleQuality) (*Resampler, error) {
+	var resampler *C.Resampler
+	var info C.ResamplerInfo
+	if errorStr := C.resampler_create(C.double(inputRate), C.double(outputRate), C.int(channels), C.int(quality), &resampler, &info); errorStr != nil {
+		return nil, fmt.Errorf("failed to create resampler: %s", C.GoString(errorStr))
+	}
+	return &Resampler{
+		InputRate:    inputRate,
+		OutputRate:   outputRate,
+		Channels:     channels,
+		Quality:      quality,
+		Taps:         int(info.taps),
+		Phases:       int(info.phases),
+		Interpolated: bool(info.interpolated),
+		Kernel:       C.GoString(info.kernel),
+		resampler:    resampler,
+	}, nil
+}
+
+// OutputFrames is the length of inputFrames converted in full
+func (r *Resampler) OutputFrames(inputFrames int) int {
+	return int(math.Ceil(float64(inputFrames) * r.OutputRate / r.InputRate))
+}
+
+func (r *Resampler) planes(buffer []float32, what string) (int, error) {
+	if r.resampler == nil {
+		return 0, errors.New("resampler is closed")
+	}
+	if len(buffer)%r.Channels != 0 {
+		return 0, fmt.Errorf("%s holds %d samples, not a whole number of %d channel planes", what, len(buffer), r.Channels)
+	}
+	return len(buffer) / r.Channels, nil
+}
+
+func floatPointer(buffer []float32) *C.float {
+	if len(buffer) == 0 {
+		return nil
+	}
+	return (*C.float)(unsafe.Pointer(&buffer[0]))
+}
+
+// Process converts the planes in `in` (channel c at in[c*n:], n = len(in) /
+// Channels) into the planes of `out`, laid out the same way. It stops when
+// the input is used up or the output is full; the input frames not consumed
+// must be passed again.
+func (r *Resampler) Process(in, out []float32) (consumed, produced int, err error) {
+	inputFrames, err := r.planes(in, "input")
+	if err != nil {
+		return 0, 0, err
+	}
+	capacity, err := r.planes(out, "output")
+	if err != nil {
+		return 0, 0, err
+	}
+	if inputFrames == 0 || capacity == 0 {
+		return 0, 0, nil
+	}
+	var cConsumed, cProduced C.int
+	C.resampler_process(r.resampler, floatPointer(in), C.int(inputFrames), floatPointer(out), C.int(capacity), &cConsumed, &cProduced)
+	return int(cConsumed), int(cProduced), nil
+}
+
+// Drain writes the frames still in the filter once the input has ended,
+// returning 0 when there are none left
+func (r *Resampler) Drain(out []float32) (int, error) {
+	capacity, err := r.planes(out, "output")
+	if err != nil || capacity == 0 {
+		return 0, err
+	}
+	var produced C.int
+	C.resampler_drain(r.resampler, floatPointer(out), C.int(capacity), &produced)
+	return int(produced), nil
+}
+
+// Reset forgets the signal so far, ready to convert a new one
+func (r *Resampler) Reset() {
+	if r.resampler != nil {
+		C.resampler_reset(r.resampler)
+	}
+}
+
+// Convert resets the resampler and converts `in` in full, returning planes of
+// OutputFrames(len(in) / Channels) frames
+func (r *Resampler) Convert(in []float32) ([]float32, error) {
+	inputFrames, err := r.planes(in, "input")
+	if err != nil {
+		return nil, err
+	}
+	r.Reset()
+	frames := r.OutputFrames(inputFrames)
+	out := make([]float32, frames*r.Channels)
+	if frames == 0 {
+		return out, nil
+	}
+	var consumed, produced C.int
+	C.resampler_process(r.resampler, floatPointer(in), C.int(inputFrames), floatPointer(out), C.int(frames), &consumed, &produced)
+	// The tail comes out of the filter in planes of its own
+	written := int(produced)
+	if rest := frames - written; rest > 0 {
+		tail := make([]float32, rest*r.Channels)
+		C.resampler_drain(r.resampler, floatPointer(tail), C.int(rest), &produced)
+		for c := 0; c < r.Channels; c++ {
+			copy(out[c*frames+written:(c+1)*frames], tail[c*rest:c*rest+int(produced)])
+		}
+	}
+	return out, nil
+}
+
+// Close frees the resampler
+func (r *Resampler) Close() {
+	if r.resampler == nil {
+		return
+	}
+	C.resampler_destroy(r.resampler)
+	r.resampler = nil
+}
@@ -52,6 +52,12 @@ func (e *Engine) CreateSamplerChannel() (*Channel, error) {
 	// Add to engine's channel list
 	e.Channels = append(e.Channels, channel)
 
+	// Line the new path up with the others at the main mixer
+	if _, err := e.CompensateLatency(); err != nil {
+		e.DestroyChannel(len(e.Channels) - 1)
+		return nil, err
+	}
+
 	return channel, nil
 }
 
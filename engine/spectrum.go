@@ -0,0 +1,253 @@
+package engine
+
+/*
+#include "../native/macaudio.h"
+*/
+import "C"
+import (
+	"errors"
+	"fmt"
+	"sync/atomic"
+	"unsafe"
+)
+
+// =============================================================================
+// Public API - Spectrum analysis
+// =============================================================================
+
+// SpectrumFloorDB is the lowest level a spectrum reports
+const SpectrumFloorDB = float32(C.SPECTRUM_FLOOR_DB)
+
+// SpectrumWindow selects the analysis window
+type SpectrumWindow int
+
+const (
+	// HannWindow is a good default: narrow main lobe, -31 dB first sidelobe
+	HannWindow SpectrumWindow = C.SPECTRUM_WINDOW_HANN
+	// BlackmanHarrisWindow trades a wider main lobe for -92 dB sidelobes
+	BlackmanHarrisWindow SpectrumWindow = C.SPECTRUM_WINDOW_BLACKMAN_HARRIS
+)
+
+// SpectrumScale selects how FFT bins are reported
+type SpectrumScale int
+
+const (
+	// LinearSpectrum reports FFTSize/2 bins from DC
+	LinearSpectrum SpectrumScale = C.SPECTRUM_SCALE_LINEAR
+	// LogSpectrum reports Bands log-spaced bands from MinFrequency to MaxFrequency
+	LogSpectrum SpectrumScale = C.SPECTRUM_SCALE_LOG
+	// OctaveSpectrum reports 1/BandsPerOctave octave bands centred on 1 kHz
+	OctaveSpectrum SpectrumScale = C.SPECTRUM_SCALE_OCTAVE
+)
+
+// SpectrumConfig describes a spectrum analysis. Values are dB relative to
+// full scale: a full-scale sine reads 0 dB in its bin or band.
+type SpectrumConfig struct {
+	FFTSize        int            `json:"fftSize"` // Power of two, 256-16384
+	Overlap        int            `json:"overlap"` // 1, 2, 4 or 8 windows per FFTSize frames
+	Window         SpectrumWindow `json:"window"`
+	Scale          SpectrumScale  `json:"scale"`
+	Bands          int            `json:"bands"`          // LogSpectrum
+	BandsPerOctave int            `json:"bandsPerOctave"` // OctaveSpectrum
+	MinFrequency   float64        `json:"minFrequency"`   // Band range in Hz
+	MaxFrequency   float64        `json:"maxFrequency"`   // Clamped to Nyquist
+}
+
+// DefaultSpectrumConfig returns 2048 points, 4x overlap, Hann window, linear bins
+func DefaultSpectrumConfig() SpectrumConfig {
+	return SpectrumConfig{
+		FFTSize:        2048,
+		Overlap:        4,
+		Window:         HannWindow,
+		Scale:          LinearSpectrum,
+		Bands:          64,
+		BandsPerOctave: 3,
+		MinFrequency:   20,
+		MaxFrequency:   20000,
+	}
+}
+
+func (c *SpectrumConfig) toC() C.SpectrumConfig {
+	return C.SpectrumConfig{
+		fftSize:        C.int(c.FFTSize),
+		overlap:        C.int(c.Overlap),
+		window:         C.int(c.Window),
+		scale:          C.int(c.Scale),
+		bandCount:      C.int(c.Bands),
+		bandsPerOctave: C.int(c.BandsPerOctave),
+		minFrequency:   C.double(c.MinFrequency),
+		maxFrequency:   C.double(c.MaxFrequency),
+	}
+}
+
+// SpectrumPlan computes spectra of sample windows offline. The window,
+// twiddle and band tables are built once, and Process does not allocate.
+// A plan is not safe for concurrent use.
+type SpectrumPlan struct {
+	FFTSize     int
+	Bins        int       // Values per spectrum
+	Frequencies []float32 // Centre frequency of each bin or band (Hz), native memory
+
+	plan *C.SpectrumPlan
+}
+
+// NewSpectrumPlan builds a plan; config may be nil for DefaultSpectrumConfig
+func NewSpectrumPlan(config *SpectrumConfig, sampleRate float64) (*SpectrumPlan, error) {
+	if config == nil {
+		defaults := DefaultSpectrumConfig()
+		config = &defaults
+	}
+
+	cConfig := config.toC()
+	var plan *C.SpectrumPlan
+	var bins C.int
+	var frequencies *C.float
+	if errorStr := C.spectrum_plan_create(&cConfig, C.double(sampleRate), &plan, &bins, &frequencies); errorStr != nil {
+		return nil, fmt.Errorf("failed to create spectrum plan: %s", C.GoString(errorStr))
+	}
+	return &SpectrumPlan{
+		FFTSize:     config.FFTSize,
+		Bins:        int(bins),
+		Frequencies: unsafe.Slice((*float32)(unsafe.Pointer(frequencies)), int(bins)),
+		plan:        plan,
+	}, nil
+}
+
+// Process writes the spectrum of FFTSize samples into out (Bins values)
+func (p *SpectrumPlan) Process(samples, out []float32) error {
+	if p.plan == nil {
+		return errors.New("spectrum plan is closed")
+	}
+	if len(samples) < p.FFTSize || len(out) < p.Bins {
+		return fmt.Errorf("need %d samples and room for %d values", p.FFTSize, p.Bins)
+	}
+	C.spectrum_plan_process(p.plan, (*C.float)(unsafe.Pointer(&samples[0])), (*C.float)(unsafe.Pointer(&out[0])))
+	return nil
+}
+
+// Close frees the plan. Frequencies must not be used afterwards.
+func (p *SpectrumPlan) Close() {
+	if p.plan == nil {
+		return
+	}
+	C.spectrum_plan_destroy(p.plan)
+	p.plan = nil
+	p.Frequencies = nil
+}
+
+// EnableSpectrum starts the tap's spectrum analyzer (config nil for
+// DefaultSpectrumConfig). It runs on its own worker thread reading the tap's
+// PCM ring, so it costs the audio thread nothing. Changing the configuration
+// fails while a SpectrumView is open.
+func (h TapHandle) EnableSpectrum(config *SpectrumConfig) error {
+	var cConfig *C.SpectrumConfig
+	if config != nil {
+		converted := config.toC()
+		cConfig = &converted
+	}
+	if errorStr := C.tap_enable_spectrum(C.TapHandle(h), C.bool(true), cConfig); errorStr != nil {
+		return fmt.Errorf("failed to enable spectrum on tap %#x: %s", uint32(h), C.GoString(errorStr))
+	}
+	return nil
+}
+
+// DisableSpectrum stops the analyzer; open views keep their last snapshot
+func (h TapHandle) DisableSpectrum() error {
+	if errorStr := C.tap_enable_spectrum(C.TapHandle(h), C.bool(false), nil); errorStr != nil {
+		return fmt.Errorf("failed to disable spectrum on tap %#x: %s", uint32(h), C.GoString(errorStr))
+	}
+	return nil
+}
+
+// SpectrumView maps a tap's double-buffered spectrum snapshots. Snapshots are
+// read in place: the analyzer writes the other buffer while one is being read,
+// and Valid reports whether it came round to the one being read meanwhile.
+type SpectrumView struct {
+	Channels    int
+	Bins        int
+	FFTSize     int
+	HopSize     int
+	SampleRate  float64
+	Frequencies []float32 // Centre frequency of each bin or band (Hz), native memory
+
+	view      C.SpectrumView
+	buffers   [2][]float32
+	positions *[2]int64
+	published *uint64
+	writing   *uint64
+}
+
+// SpectrumSnapshot is one published spectrum, viewed in place
+type SpectrumSnapshot struct {
+	Seq      uint64 // Increases with every published snapshot; 0 if none yet
+	Position int64  // Absolute tap frame just past the analyzed window
+
+	view *SpectrumView
+	data []float32
+}
+
+// OpenSpectrum maps the tap's spectrum snapshots. Close the view to release
+// the mapping; it stays valid after the tap is removed.
+func (h TapHandle) OpenSpectrum() (*SpectrumView, error) {
+	v := &SpectrumView{}
+	if errorStr := C.tap_get_spectrum(C.TapHandle(h), &v.view); errorStr != nil {
+		return nil, fmt.Errorf("failed to open spectrum on tap %#x: %s", uint32(h), C.GoString(errorStr))
+	}
+	v.Channels = int(v.view.channelCount)
+	v.Bins = int(v.view.binCount)
+	v.FFTSize = int(v.view.fftSize)
+	v.HopSize = int(v.view.hopSize)
+	v.SampleRate = float64(v.view.sampleRate)
+	v.Frequencies = unsafe.Slice((*float32)(unsafe.Pointer(v.view.frequencies)), v.Bins)
+	for i := range v.buffers {
+		v.buffers[i] = unsafe.Slice((*float32)(unsafe.Pointer(v.view.data[i])), v.Channels*v.Bins)
+	}
+	v.positions = (*[2]int64)(unsafe.Pointer(v.view.positions))
+	v.published = (*uint64)(unsafe.Pointer(v.view.published))
+	v.writing = (*uint64)(unsafe.Pointer(v.view.writing))
+	return v, nil
+}
+
+// Latest returns the newest snapshot without copying (Seq 0 if none yet)
+func (v *SpectrumView) Latest() SpectrumSnapshot {
+	if v.published == nil {
+		return SpectrumSnapshot{view: v}
+	}
+	seq := atomic.LoadUint64(v.published)
+	if seq == 0 {
+		return SpectrumSnapshot{view: v}
+	}
+	return SpectrumSnapshot{Seq: seq, Position: v.positions[seq&1], view: v, data: v.buffers[seq&1]}
+}
+
+// Valid reports whether the snapshot was still intact after it was read. If
+// not, the values seen may be torn and the caller should take Latest again.
+func (s SpectrumSnapshot) Valid() bool {
+	v := s.view
+	if s.Seq == 0 || v.writing == nil {
+		return false
+	}
+	return atomic.LoadUint64(v.writing) < s.Seq+2
+}
+
+// Channel returns the dB values of channel c (Bins values, native memory)
+func (s SpectrumSnapshot) Channel(c int) []float32 {
+	bins := s.view.Bins
+	if s.data == nil || c < 0 || c >= s.view.Channels {
+		return nil
+	}
+	return s.data[c*bins : (c+1)*bins : (c+1)*bins]
+}
+
+// Close releases the mapping. Snapshot slices must not be used afterwards.
+func (v *SpectrumView) Close() {
+	if v.published == nil {
+		return
+	}
+	C.tap_release_spectrum(&v.view)
+	v.published = nil
+	v.writing = nil
+	v.positions = nil
+	v.buffers = [2][]float32{}
+	v.Frequencies = nil
+}
@@ -0,0 +1,81 @@
+package engine
+
+/*
+#include "../native/macaudio.h"
+*/
+import "C"
+import "fmt"
+
+// =============================================================================
+// Public API - Streaming playback
+// =============================================================================
+
+// StreamingOptions sizes a playback channel's read-ahead
+type StreamingOptions struct {
+	BufferFrames int `json:"bufferFrames"` // Frames per buffer, 0 = 16384
+	BufferCount  int `json:"bufferCount"`  // Read-ahead depth in buffers, 0 = 8
+}
+
+// StreamingStats reports a playback channel's read-ahead
+type StreamingStats struct {
+	Enabled        bool  `json:"enabled"`
+	BufferFrames   int   `json:"bufferFrames"`
+	BufferCount    int   `json:"bufferCount"`
+	Ready          int   `json:"ready"` // Buffers decoded and not yet played
+	DecodedFrames  int64 `json:"decodedFrames"`
+	Underruns      int64 `json:"underruns"` // Render cycles that ran out of decoded audio
+	UnderrunFrames int64 `json:"underrunFrames"`
+	Mapped         bool  `json:"mapped"` // Decoding straight from a memory-mapped WAV/AIFF
+}
+
+// EnableStreaming plays the channel's file through a fixed pool of buffers
+// that an I/O thread decodes ahead, instead of handing the whole file to the
+// player. Memory stays at BufferCount*BufferFrames frames per channel however
+// long the file is. Enabling again resizes the pool; both stop playback.
+func (c *Channel) EnableStreaming(opts *StreamingOptions) error {
+	playerPtr, err := c.nativePlayer()
+	if err != nil {
+		return err
+	}
+	if opts == nil {
+		opts = &StreamingOptions{}
+	}
+	if errorStr := C.audioplayer_set_streaming(playerPtr, true, C.int(opts.BufferFrames), C.int(opts.BufferCount)); errorStr != nil {
+		return fmt.Errorf("failed to enable streaming: %s", C.GoString(errorStr))
+	}
+	return nil
+}
+
+// DisableStreaming goes back to scheduling the whole file; stops playback
+func (c *Channel) DisableStreaming() error {
+	playerPtr, err := c.nativePlayer()
+	if err != nil {
+		return err
+	}
+	if errorStr := C.audioplayer_set_streaming(playerPtr, false, 0, 0); errorStr != nil {
+		return fmt.Errorf("failed to disable streaming: %s", C.GoString(errorStr))
+	}
+	return nil
+}
+
+// StreamingStats reports buffer fill and underruns since streaming was enabled
+func (c *Channel) StreamingStats() (StreamingStats, error) {
+	playerPtr, err := c.nativePlayer()
+	if err != nil {
+		return StreamingStats{}, err
+	}
+	var stats C.StreamingStats
+	if errorStr := C.audioplayer_get_streaming_stats(playerPtr, &stats); errorStr != nil {
+		return StreamingStats{}, fmt.Errorf("failed to get streaming stats: %s", C.GoString(errorStr))
+	}
+	return StreamingStats{
+		Enabled:        bool(stats.enabled),
+		BufferFrames:   int(stats.bufferFrames),
+		BufferCount:    int(stats.bufferCount),
+		Ready:          int(stats.ready),
+		DecodedFrames:  int64(stats.decodedFrames),
+		Underruns:      int64(stats.underruns),
+		UnderrunFrames: int64(stats.underrunFrames),
+		Mapped:         bool(stats.mapped),
+	}, nil
+}
@@ -0,0 +1,406 @@
+package engine
+
+/*
+#include <stdlib.h>
+#include "../native/macaudio.h"
+*/
+import "C"
+import (
+	"bytes"
+	"errors"
+	"fmt"
+	"sync/atomic"
+	"unsafe"
+)
+
+// =============================================================================
+// Public API - Taps
+// =============================================================================
+
+// TapHandle identifies an installed tap by its slot in the native tap table.
+// Handle calls skip the key lookup, and a handle goes stale once its tap is
+// removed (calls then fail instead of reaching a newer tap in the same slot).
+type TapHandle uint32
+
+// InvalidTapHandle is never returned for an installed tap
+const InvalidTapHandle TapHandle = C.TAP_INVALID_HANDLE
+
+// InstallTap taps output bus `bus` of a native node (for example
+// GetMainMixerNode) under `key`. Keys are global and must be unique.
+func (e *Engine) InstallTap(key string, node unsafe.Pointer, bus int) (TapHandle, error) {
+	if e.nativeEngine == nil {
+		return InvalidTapHandle, errors.New("engine not initialized")
+	}
+	if node == nil {
+		return InvalidTapHandle, errors.New("node pointer is nil")
+	}
+
+	cKey := C.CString(key)
+	defer C.free(unsafe.Pointer(cKey))
+
+	var handle C.TapHandle
+	if errorStr := C.tap_install(e.nativeEngine.engine, node, C.int(bus), cKey, &handle); errorStr != nil {
+		return InvalidTapHandle, fmt.Errorf("failed to install tap %q: %s", key, C.GoString(errorStr))
+	}
+	return TapHandle(handle), nil
+}
+
+// LookupTap returns the handle of the tap installed under `key`
+func LookupTap(key string) (TapHandle, error) {
+	cKey := C.CString(key)
+	defer C.free(unsafe.Pointer(cKey))
+
+	var handle C.TapHandle
+	if errorStr := C.tap_lookup(cKey, &handle); errorStr != nil {
+		return InvalidTapHandle, fmt.Errorf("failed to look up tap %q: %s", key, C.GoString(errorStr))
+	}
+	return TapHandle(handle), nil
+}
+
+// Remove removes the tap. Open TapStreams stay readable until closed.
+func (h TapHandle) Remove() error {
+	if errorStr := C.tap_remove_handle(C.TapHandle(h)); errorStr != nil {
+		return fmt.Errorf("failed to remove tap %#x: %s", uint32(h), C.GoString(errorStr))
+	}
+	return nil
+}
+
+// Levels fills `levels` with the tap's newest metering block
+func (h TapHandle) Levels(levels *TapLevels) error {
+	var metrics C.TapMetrics
+	if errorStr := C.tap_get_metrics_handle(C.TapHandle(h), &metrics); errorStr != nil {
+		levels.Found = false
+		return fmt.Errorf("failed to read tap %#x: %s", uint32(h), C.GoString(errorStr))
+	}
+	levels.Handle = h
+	levels.Found = true
+	levels.fill(&metrics)
+	return nil
+}
+
+// OpenStream maps the tap's PCM ring; see Engine.OpenTapStream
+func (h TapHandle) OpenStream() (*TapStream, error) {
+	s := &TapStream{}
+	if errorStr := C.tap_get_ring_handle(C.TapHandle(h), &s.ring); errorStr != nil {
+		return nil, fmt.Errorf("failed to open stream on tap %#x: %s", uint32(h), C.GoString(errorStr))
+	}
+	s.mapRing()
+	return s, nil
+}
+
+// RemoveTap removes the tap installed under `key`. Open TapStreams stay
+// readable (they just stop advancing) until closed.
+func (e *Engine) RemoveTap(key string) error {
+	cKey := C.CString(key)
+	defer C.free(unsafe.Pointer(cKey))
+
+	if errorStr := C.tap_remove(cKey); errorStr != nil {
+		return fmt.Errorf("failed to remove tap %q: %s", key, C.GoString(errorStr))
+	}
+	return nil
+}
+
+// TapMeterMaxChannels is how many channels each tap meters
+const TapMeterMaxChannels = C.TAP_METER_MAX_CHANNELS
+
+// TapLevels is the newest metering block of one tap
+type TapLevels struct {
+	Key          string                             `json:"key"`
+	Handle       TapHandle                          `json:"handle"`
+	Found        bool                               `json:"found"`
+	SampleTime   int64                              `json:"sampleTime"` // Render sample time of the block
+	HostTime     uint64                             `json:"hostTime"`
+	Frames       int                                `json:"frames"`
+	RMS          float32                            `json:"rms"`  // Channel 0
+	Peak         float32                            `json:"peak"` // Channel 0
+	ChannelCount int                                `json:"channelCount"`
+	Channels     [TapMeterMaxChannels]ChannelLevels `json:"channels"`
+}
+
+// TapMeter polls many taps with one cgo call per Poll. Keys are converted to C
+// strings once and the result slice is reused, so steady-state polling does
+// not allocate. A TapMeter is not safe for concurrent use.
+type TapMeter struct {
+	all     bool
+	handles []C.TapHandle
+	cKeys   []*C.char // View of keyArray
+	raw     []C.TapMetrics
+	found   []C.bool
+	keyBuf  []byte
+	levels  []TapLevels
+
+	// Native key array passed as-is: an &cKeys[0] argument makes cgo allocate per call
+	keyArray **C.char
+
+	// Out-parameters of tap_get_metrics_all; fields so cgo doesn't heap-allocate them per poll
+	count, keyBytes C.int
+}
+
+// NewTapMeter meters the given taps, or every installed tap when no keys are given
+func NewTapMeter(keys ...string) *TapMeter {
+	m := &TapMeter{all: len(keys) == 0}
+	if m.all {
+		return m
+	}
+
+	array := C.malloc(C.size_t(len(keys)) * C.size_t(unsafe.Sizeof((*C.char)(nil))))
+	m.keyArray = (**C.char)(array)
+	m.cKeys = unsafe.Slice(m.keyArray, len(keys))
+	m.raw = make([]C.TapMetrics, len(keys))
+	m.found = make([]C.bool, len(keys))
+	m.levels = make([]TapLevels, len(keys))
+	for i, key := range keys {
+		m.cKeys[i] = C.CString(key)
+		m.levels[i].Key = key
+	}
+	return m
+}
+
+// NewTapHandleMeter meters taps by handle, skipping key lookups entirely
+func NewTapHandleMeter(handles ...TapHandle) *TapMeter {
+	m := &TapMeter{
+		handles: make([]C.TapHandle, len(handles)),
+		raw:     make([]C.TapMetrics, len(handles)),
+		found:   make([]C.bool, len(handles)),
+		levels:  make([]TapLevels, len(handles)),
+	}
+	for i, handle := range handles {
+		m.handles[i] = C.TapHandle(handle)
+		m.levels[i].Handle = handle
+	}
+	return m
+}
+
+// Close frees the meter's native key strings
+func (m *TapMeter) Close() {
+	for i, cKey := range m.cKeys {
+		C.free(unsafe.Pointer(cKey))
+		m.cKeys[i] = nil
+	}
+	C.free(unsafe.Pointer(m.keyArray))
+	m.keyArray = nil
+	m.cKeys = nil
+}
+
+// Poll fetches the newest metrics of every metered tap. The returned slice is
+// owned by the meter and overwritten by the next Poll.
+func (m *TapMeter) Poll() ([]TapLevels, error) {
+	if m.all {
+		return m.pollAll()
+	}
+
+	switch {
+	case len(m.handles) > 0:
+		C.tap_get_metrics_handles(&m.handles[0], C.int(len(m.handles)), &m.raw[0], &m.found[0])
+	case len(m.cKeys) > 0:
+		C.tap_get_metrics_batch(m.keyArray, C.int(len(m.cKeys)), &m.raw[0], &m.found[0])
+	default:
+		return m.levels[:0], nil
+	}
+	for i := range m.levels {
+		m.levels[i].Found = bool(m.found[i])
+		m.levels[i].fill(&m.raw[i])
+	}
+	return m.levels, nil
+}
+
+func (m *TapMeter) pollAll() ([]TapLevels, error) {
+	for {
+		var metricsPtr *C.TapMetrics
+		var handlesPtr *C.TapHandle
+		var keyPtr *C.char
+		if len(m.raw) > 0 {
+			metricsPtr = &m.raw[0]
+			handlesPtr = &m.handles[0]
+		}
+		if len(m.keyBuf) > 0 {
+			keyPtr = (*C.char)(unsafe.Pointer(&m.keyBuf[0]))
+		}
+
+		if errorStr := C.tap_get_metrics_all(metricsPtr, handlesPtr, C.int(len(m.raw)), keyPtr, C.int(len(m.keyBuf)), &m.count, &m.keyBytes); errorStr != nil {
+			return nil, fmt.Errorf("failed to poll taps: %s", C.GoString(errorStr))
+		}
+
+		count, keyBytes := m.count, m.keyBytes
+		// Taps were added since the last poll: grow with headroom and retry
+		if int(count) > len(m.raw) || int(keyBytes) > len(m.keyBuf) {
+			if int(count) > len(m.raw) {
+				m.raw = make([]C.TapMetrics, 2*int(count))
+				m.handles = make([]C.TapHandle, 2*int(count))
+			}
+			if int(keyBytes) > len(m.keyBuf) {
+				m.keyBuf = make([]byte, 2*int(keyBytes))
+			}
+			continue
+		}
+
+		if cap(m.levels) < int(count) {
+			m.levels = make([]TapLevels, int(count), cap(m.raw))
+		}
+		m.levels = m.levels[:count]
+
+		keys := m.keyBuf[:keyBytes]
+		for i := range m.levels {
+			end := bytes.IndexByte(keys, 0)
+			// Comparing against the previous key avoids a string allocation
+			if m.levels[i].Key != string(keys[:end]) {
+				m.levels[i].Key = string(keys[:end])
+			}
+			keys = keys[end+1:]
+			m.levels[i].Handle = TapHandle(m.handles[i])
+			m.levels[i].Found = true
+			m.levels[i].fill(&m.raw[i])
+		}
+		return m.levels, nil
+	}
+}
+
+func (l *TapLevels) fill(metrics *C.TapMetrics) {
+	l.SampleTime = int64(metrics.sampleTime)
+	l.HostTime = uint64(metrics.hostTime)
+	l.Frames = int(metrics.frameLength)
+	l.RMS = float32(metrics.rms)
+	l.Peak = float32(metrics.peak)
+	l.ChannelCount = int(metrics.channelCount)
+	for c := range l.Channels {
+		stats := &metrics.channels[c]
+		l.Channels[c] = ChannelLevels{
+			RMS:          float32(stats.rms),
+			Peak:         float32(stats.peak),
+			SumOfSquares: float64(stats.sumOfSquares),
+			Clips:        int(stats.clipCount),
+		}
+	}
+}
+
+// TapStream reads a tap's PCM straight out of its native ring buffer. The
+// ring is mapped once as a []float32, and the producer's write index is read
+// with an atomic load, so streaming costs no cgo call or copy per block.
+//
+// A TapStream is single-reader: use it from one goroutine at a time.
+type TapStream struct {
+	Channels   int
+	SampleRate float64
+
+	ring     C.TapRing
+	samples  []float32 // Channels planes of capacity frames, native memory
+	written  *int64    // Producer's published frame count
+	capacity int64
+	readable int64
+	cursor   int64 // Next frame to read
+	dropped  int64 // Frames skipped because the reader fell behind
+}
+
+// TapBlock is a run of unread frames, viewed in place inside the ring
+type TapBlock struct {
+	Start  int64 // Absolute frame index of the first frame
+	Frames int
+
+	stream *TapStream
+}
+
+// OpenTapStream maps the PCM ring of the tap under `key`. Reading starts at
+// the newest published frame. Close the stream to release the mapping.
+func (e *Engine) OpenTapStream(key string) (*TapStream, error) {
+	cKey := C.CString(key)
+	defer C.free(unsafe.Pointer(cKey))
+
+	s := &TapStream{}
+	if errorStr := C.tap_get_ring(cKey, &s.ring); errorStr != nil {
+		return nil, fmt.Errorf("failed to open tap stream %q: %s", key, C.GoString(errorStr))
+	}
+	s.mapRing()
+	return s, nil
+}
+
+func (s *TapStream) mapRing() {
+	s.Channels = int(s.ring.channelCount)
+	s.SampleRate = float64(s.ring.sampleRate)
+	s.capacity = int64(s.ring.capacity)
+	s.readable = int64(s.ring.readable)
+	s.samples = unsafe.Slice((*float32)(unsafe.Pointer(s.ring.data)), s.Channels*int(s.capacity))
+	s.written = (*int64)(unsafe.Pointer(s.ring.writeIndex))
+	s.cursor = atomic.LoadInt64(s.written)
+}
+
+// Close releases the ring mapping. Slices from earlier TapBlocks must not be
+// used afterwards.
+func (s *TapStream) Close() {
+	if s.samples == nil {
+		return
+	}
+	C.tap_release_ring(&s.ring)
+	s.samples = nil
+	s.written = nil
+}
+
+// Position returns the absolute frame index of the next frame to read
+func (s *TapStream) Position() int64 {
+	return s.cursor
+}
+
+// Dropped returns how many frames were skipped because the reader fell more
+// than the ring's readable window behind the producer
+func (s *TapStream) Dropped() int64 {
+	return s.dropped
+}
+
+// Available returns how many frames can be read right now
+func (s *TapStream) Available() int {
+	if s.samples == nil {
+		return 0
+	}
+	written := atomic.LoadInt64(s.written)
+	if s.cursor < written-s.readable {
+		return int(s.readable)
+	}
+	return int(written - s.cursor)
+}
+
+// Next returns up to maxFrames unread frames without copying. If the reader
+// fell behind, the frames that were overwritten are counted in Dropped and
+// skipped. Call Commit once done with the block.
+func (s *TapStream) Next(maxFrames int) TapBlock {
+	if s.samples == nil || maxFrames <= 0 {
+		return TapBlock{Start: s.cursor, stream: s}
+	}
+
+	written := atomic.LoadInt64(s.written)
+	if oldest := written - s.readable; s.cursor < oldest {
+		s.dropped += oldest - s.cursor
+		s.cursor = oldest
+	}
+	frames := written - s.cursor
+	if frames > int64(maxFrames) {
+		frames = int64(maxFrames)
+	}
+	return TapBlock{Start: s.cursor, Frames: int(frames), stream: s}
+}
+
+// Commit consumes a block from Next. It reports false when the producer
+// overwrote part of the block while it was being read, in which case the
+// samples seen may be torn and should be discarded.
+func (s *TapStream) Commit(block TapBlock) bool {
+	if s.samples == nil {
+		return false
+	}
+	s.cursor = block.Start + int64(block.Frames)
+	return atomic.LoadInt64(s.written)-s.readable <= block.Start
+}
+
+// Channel returns channel c of the block as up to two slices into the ring
+// (the second is non-empty only when the block wraps around the ring end)
+func (b TapBlock) Channel(c int) (first, second []float32) {
+	s := b.stream
+	if b.Frames == 0 || s.samples == nil || c < 0 || c >= s.Channels {
+		return nil, nil
+	}
+
+	plane := s.samples[int64(c)*s.capacity : int64(c+1)*s.capacity]
+	offset := b.Start & (s.capacity - 1)
+	end := offset + int64(b.Frames)
+	if end <= s.capacity {
+		return plane[offset:end:end], nil
+	}
+	return plane[offset:], plane[:end-s.capacity]
+}
@@ -0,0 +1,160 @@
+package engine
+
+/*
+#include "../native/macaudio.h"
+#include <stdlib.h>
+*/
+import "C"
+import (
+	"fmt"
+	"unsafe"
+)
+
+// =============================================================================
+// Public API - Pre-rendered rate/pitch variants
+// =============================================================================
+
+// VariantCrossfade is how long SetPlaybackRate and SetPitch take to move
+// between a pre-rendered variant and the live time/pitch units
+const VariantCrossfade = C.AUDIOPLAYER_VARIANT_CROSSFADE
+
+// DefaultVariantCacheBudget is the variant cache's memory budget until
+// SetVariantCache changes it
+const DefaultVariantCacheBudget = C.VARIANT_CACHE_DEFAULT_BUDGET
+
+// Variant is a rate/pitch combination to pre-render, in the units of
+// SetPlaybackRate and SetPitch
+type Variant struct {
+	Rate  float32 `json:"rate"`
+	Pitch float32 `json:"pitch"` // Semitones
+}
+
+// VariantsStatus reports a playback channel's variants
+type VariantsStatus struct {
+	Requested int    `json:"requested"` // Variants of the last PrepareVariants, not counting unity
+	Ready     int    `json:"ready"`     // Of those, cached in memory now
+	Pending   int    `json:"pending"`   // Still being loaded or rendered
+	Failed    int    `json:"failed"`
+	Active    bool   `json:"active"` // Playing a variant rather than running the live units
+	Error     string `json:"error,omitempty"`
+}
+
+// VariantCacheOptions sets the variant cache's budgets
+type VariantCacheOptions struct {
+	BudgetBytes     int64  `json:"budgetBytes"`     // Memory for variants not being played
+	Directory       string `json:"directory"`       // Empty keeps variants in memory only
+	DiskBudgetBytes int64  `json:"diskBudgetBytes"` // Required with a directory
+}
+
+// VariantCacheStats describes the variant cache
+type VariantCacheStats struct {
+	Entries         int   `json:"entries"` // In memory
+	InUse           int   `json:"inUse"`   // Being played
+	Bytes           int64 `json:"bytes"`
+	BudgetBytes     int64 `json:"budgetBytes"`
+	DiskEntries     int   `json:"diskEntries"`
+	DiskBytes       int64 `json:"diskBytes"`
+	DiskBudgetBytes int64 `json:"diskBudgetBytes"`
+	Hits            int64 `json:"hits"` // Switches and prepared variants found in memory
+	Misses          int64 `json:"misses"`
+	DiskHits        int64 `json:"diskHits"` // Read back from the directory instead of rendered
+	Renders         int64 `json:"renders"`
+	Evictions       int64 `json:"evictions"`
+}
+
+// PrepareVariants renders the channel's file at each rate/pitch combination
+// on up to `workers` background threads (0 for one per core), replacing any
+// earlier request; poll VariantsStatus for progress. Once a combination is
+// cached, SetPlaybackRate and SetPitch switch to its variant within one render
+// cycle, crossfading over VariantCrossfade, and the time/pitch units stand
+// idle while it plays; other settings run the units live. Variants follow the
+// channel's pitch shift options at the time, so set those first. Streaming
+// channels and channels with queued files always run the units live. On macOS
+// it returns an error: the player node cannot switch onto a variant in place.
+// Loading another file discards the request.
+func (c *Channel) PrepareVariants(variants []Variant, workers int) error {
+	playerPtr, err := c.nativePlayer()
+	if err != nil {
+		return err
+	}
+	for i, variant := range variants {
+		if err := ValidateRate(variant.Rate); err != nil {
+			return fmt.Errorf("variant %d: %w", i, err)
+		}
+		if err := ValidatePitch(variant.Pitch); err != nil {
+			return fmt.Errorf("variant %d: %w", i, err)
+		}
+	}
+	cVariants := make([]C.PlayerVariant, len(variants)+1) // Never empty, for the pointer
+	for i, variant := range variants {
+		cVariants[i] = C.PlayerVariant{rate: C.float(variant.Rate), cents: C.float(variant.Pitch * 100.0)}
+	}
+	if errorStr := C.audioplayer_prepare_variants(playerPtr, &cVariants[0], C.int(len(variants)), C.int(workers)); errorStr != nil {
+		return fmt.Errorf("failed to prepare variants: %s", C.GoString(errorStr))
+	}
+	return nil
+}
+
+// VariantsStatus reports how far PrepareVariants got and whether a variant
+// is playing
+func (c *Channel) VariantsStatus() (VariantsStatus, error) {
+	playerPtr, err := c.nativePlayer()
+	if err != nil {
+		return VariantsStatus{}, err
+	}
+	var status C.PlayerVariantsStatus
+	if errorStr := C.audioplayer_get_variants_status(playerPtr, &status); errorStr != nil {
+		return VariantsStatus{}, fmt.Errorf("failed to get variants status: %s", C.GoString(errorStr))
+	}
+	result := VariantsStatus{
+		Requested: int(status.requested),
+		Ready:     int(status.ready),
+		Pending:   int(status.pending),
+		Failed:    int(status.failed),
+		Active:    bool(status.active),
+	}
+	if status.error != nil {
+		result.Error = C.GoString(status.error)
+	}
+	return result, nil
+}
+
+// SetVariantCache sets the process-wide variant cache's budgets. Variants are
+// shared by every channel on the same file and settings. Those not being
+// played are evicted from memory, least recently used first, while the total
+// is over BudgetBytes. With a Directory, rendered variants are also stored
+// there by file content and read back instead of rendered again, and the
+// least recently used are deleted to keep it under DiskBudgetBytes.
+func SetVariantCache(options VariantCacheOptions) error {
+	var cDirectory *C.char
+	if options.Directory != "" {
+		cDirectory = C.CString(options.Directory)
+		defer C.free(unsafe.Pointer(cDirectory))
+	}
+	if errorStr := C.variant_cache_configure(C.int64_t(options.BudgetBytes), cDirectory, C.int64_t(options.DiskBudgetBytes)); errorStr != nil {
+		return fmt.Errorf("failed to configure variant cache: %s", C.GoString(errorStr))
+	}
+	return nil
+}
+
+// GetVariantCacheStats reports the variant cache's size and hit rate
+func GetVariantCacheStats() (VariantCacheStats, error) {
+	var stats C.VariantCacheStats
+	if errorStr := C.variant_cache_get_stats(&stats); errorStr != nil {
+		return VariantCacheStats{}, fmt.Errorf("failed to get variant cache stats: %s", C.GoString(errorStr))
+	}
+	return VariantCacheStats{
+		Entries:         int(stats.entries),
+		InUse:           int(stats.inUse),
+		Bytes:           int64(stats.bytes),
+		BudgetBytes:     int64(stats.budgetBytes),
+		DiskEntries:     int(stats.diskEntries),
+		DiskBytes:       int64(stats.diskBytes),
+		DiskBudgetBytes: int64(stats.diskBudgetBytes),
+		Hits:            int64(stats.hits),
+		Misses:          int64(stats.misses),
+		DiskHits:        int64(stats.diskHits),
+		Renders:         int64(stats.renders),
+		Evictions:       int64(stats.evictions),
+	}, nil
+}
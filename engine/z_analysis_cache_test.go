@@ -0,0 +1,180 @@
+package engine
+
+import (
+	"math"
+	"os"
+	"path/filepath"
+	"testing"
+)
+
+func openTestAnalysisCache(t *testing.T, maxBytes int64) {
+	t.Helper()
+	if err := OpenAnalysisCache(filepath.Join(t.TempDir(), "cache"), maxBytes); err != nil {
+		t.Fatalf("OpenAnalysisCache failed: %v", err)
+	}
+	t.Cleanup(CloseAnalysisCache)
+}
+
+func analysisCacheStats(t *testing.T) AnalysisCacheStats {
+	t.Helper()
+	stats, err := GetAnalysisCacheStats()
+	if err != nil {
+		t.Fatalf("GetAnalysisCacheStats failed: %v", err)
+	}
+	return stats
+}
+
+// analyzeWholeFile runs every cached analysis on a channel's whole file
+func analyzeWholeFile(t *testing.T, channel *Channel) (float64, Loudness, []PeakColumn, PeaksStatus) {
+	t.Helper()
+	info, err := channel.GetFileInfo()
+	if err != nil {
+		t.Fatalf("GetFileInfo failed: %v", err)
+	}
+	rms, _, err := channel.AnalyzeRMS(0, info.Duration)
+	if err != nil {
+		t.Fatalf("AnalyzeRMS failed: %v", err)
+	}
+	loudness, err := channel.AnalyzeLoudness(0, info.Duration)
+	if err != nil {
+		t.Fatalf("AnalyzeLoudness failed: %v", err)
+	}
+	if err := channel.BuildPeaks(false); err != nil {
+		t.Fatalf("BuildPeaks failed: %v", err)
+	}
+	status := waitPeaks(t, channel)
+	peaks, err := channel.Peaks(0, info.Duration, 32, nil)
+	if err != nil {
+		t.Fatalf("Peaks failed: %v", err)
+	}
+	return rms, loudness, peaks, status
+}
+
+func TestAnalysisCacheReuseAndInvalidation(t *testing.T) {
+	engine, cleanup := CreateTestEngine(t, DefaultTestEngineConfig())
+	defer cleanup()
+	openTestAnalysisCache(t, 1<<20)
+
+	path := WriteTestWAV(t, 48000, 2.0, 1000)
+	channel, err := engine.CreatePlaybackChannel(path)
+	if err != nil {
+		t.Fatalf("CreatePlaybackChannel failed: %v", err)
+	}
+	rms, loudness, peaks, status := analyzeWholeFile(t, channel)
+	if stats := analysisCacheStats(t); stats.Hits != 0 || stats.Entries != 1 {
+		t.Fatalf("Expected one new entry and no hits, got %+v", stats)
+	}
+	if status.Cached || math.Abs(rms-0.3536) > 0.01 {
+		t.Errorf("Expected computed results, got rms %.4f, cached peaks %v", rms, status.Cached)
+	}
+
+	// The same content under another name is served from the cache
+	data, err := os.ReadFile(path)
+	if err != nil {
+		t.Fatal(err)
+	}
+	copied := filepath.Join(t.TempDir(), "copy.wav")
+	if err := os.WriteFile(copied, data, 0o644); err != nil {
+		t.Fatal(err)
+	}
+	copy, err := engine.CreatePlaybackChannel(copied)
+	if err != nil {
+		t.Fatalf("CreatePlaybackChannel failed: %v", err)
+	}
+	before := analysisCacheStats(t)
+	cachedRMS, cachedLoudness, cachedPeaks, cachedStatus := analyzeWholeFile(t, copy)
+	after := analysisCacheStats(t)
+	if after.Hits-before.Hits != 3 || !cachedStatus.Cached || after.Entries != 1 {
+		t.Errorf("Expected RMS, loudness and peaks from the cache, got %+v -> %+v (peaks cached %v)",
+			before, after, cachedStatus.Cached)
+	}
+	if cachedRMS != rms || cachedLoudness != loudness {
+		t.Errorf("Cached analysis differs: rms %.6f vs %.6f, loudness %+v vs %+v", cachedRMS, rms, cachedLoudness, loudness)
+	}
+	for i := range peaks {
+		if peaks[i] != cachedPeaks[i] {
+			t.Fatalf("Cached peak column %d differs: %+v vs %+v", i, cachedPeaks[i], peaks[i])
+		}
+	}
+
+	// A reopened path is known by its alias, so its format is a hit at load
+	reopened, err := engine.CreatePlaybackChannel(path)
+	if err != nil {
+		t.Fatalf("CreatePlaybackChannel failed: %v", err)
+	}
+	if stats := analysisCacheStats(t); stats.Hits != after.Hits+1 {
+		t.Errorf("Expected a hit loading a known path, got %+v", stats)
+	}
+	if info, err := reopened.GetFileInfo(); err != nil || info.Duration != 2.0 || info.Channels != 1 || info.SampleRate != 48000 {
+		t.Errorf("Unexpected cached file info %+v (%v)", info, err)
+	}
+
+	// Rewriting the file changes its size and mtime, so nothing stale is served
+	changed := WriteTestWAV(t, 48000, 3.0, 440)
+	data, err = os.ReadFile(changed)
+	if err != nil {
+		t.Fatal(err)
+	}
+	if err := os.WriteFile(copied, data, 0o644); err != nil {
+		t.Fatal(err)
+	}
+	edited, err := engine.CreatePlaybackChannel(copied)
+	if err != nil {
+		t.Fatalf("CreatePlaybackChannel failed: %v", err)
+	}
+	if info, err := edited.GetFileInfo(); err != nil || info.Duration != 3.0 {
+		t.Errorf("Expected the edited file's 3 s duration, got %+v (%v)", info, err)
+	}
+	_, _, _, editedStatus := analyzeWholeFile(t, edited)
+	if stats := analysisCacheStats(t); editedStatus.Cached || stats.Entries != 2 {
+		t.Errorf("Expected the edited file to get its own entry, got %+v (peaks cached %v)", stats, editedStatus.Cached)
+	}
+	t.Logf("✅ Copy served from cache, edit invalidated: %+v", analysisCacheStats(t))
+}
+
+func TestAnalysisCacheEviction(t *testing.T) {
+	engine, cleanup := CreateTestEngine(t, DefaultTestEngineConfig())
+	defer cleanup()
+
+	// Room for two entries with their 1 s peak pyramids (about 2.7 kB each)
+	openTestAnalysisCache(t, 6000)
+	var paths []string
+	for _, frequency := range []float64{220, 330, 440} {
+		path := WriteTestWAV(t, 48000, 1.0, frequency)
+		channel, err := engine.CreatePlaybackChannel(path)
+		if err != nil {
+			t.Fatalf("CreatePlaybackChannel failed: %v", err)
+		}
+		analyzeWholeFile(t, channel)
+		paths = append(paths, path)
+	}
+	stats := analysisCacheStats(t)
+	if stats.Evictions != 1 || stats.Entries != 2 || stats.Bytes > stats.MaxBytes {
+		t.Fatalf("Expected one eviction leaving two entries under the cap, got %+v", stats)
+	}
+
+	// The least recently used (first) file was evicted; the others still hit
+	for i, path := range paths {
+		channel, err := engine.CreatePlaybackChannel(path)
+		if err != nil {
+			t.Fatalf("CreatePlaybackChannel failed: %v", err)
+		}
+		before := analysisCacheStats(t)
+		loudness, err := channel.AnalyzeLoudness(0, 1)
+		if err != nil {
+			t.Fatalf("AnalyzeLoudness failed: %v", err)
+		}
+		hit := analysisCacheStats(t).Hits > before.Hits
+		if hit != (i > 0) || math.Abs(loudness.Integrated+9.03) > 1 { // 1 s is short for the 400 ms gating blocks
+			t.Errorf("File %d: expected hit=%v, got %v (%.2f LUFS)", i, i > 0, hit, loudness.Integrated)
+		}
+	}
+
+	if err := ClearAnalysisCache(); err != nil {
+		t.Fatalf("ClearAnalysisCache failed: %v", err)
+	}
+	if stats := analysisCacheStats(t); stats.Entries != 0 || stats.Bytes != 0 {
+		t.Errorf("Expected an empty cache after clearing, got %+v", stats)
+	}
+	t.Logf("✅ LRU eviction kept %d of 3 entries under %d bytes", stats.Entries, stats.MaxBytes)
+}
@@ -0,0 +1,160 @@
+package engine
+
+import (
+	"fmt"
+	"io"
+	"math"
+	"testing"
+	"time"
+)
+
+func TestElisionIdentityChannel(t *testing.T) {
+	engine, cleanup := CreateTestEngine(t, DefaultTestEngineConfig())
+	rate := engine.SampleRate
+	cleanup()
+
+	// A stereo file at rate 1 and 0 cents: from the first cycle on every node
+	// of the channel is routed around, and what comes out is the file itself
+	path := writeTestPCM(t, "float", rate, rate)
+	samples := BounceTestChannel(t, path, 0.5, BounceHooks{Before: func(channel *Channel, block int) {
+		elision, err := channel.Elision()
+		if err != nil {
+			t.Fatalf("Elision failed: %v", err)
+		}
+		if block > 0 && elision != (ChannelElision{TimeStretch: true, PitchShift: true, Mixer: true}) {
+			t.Fatalf("Block %d: expected every node routed around, got %+v", block, elision)
+		}
+		if latency, err := channel.RateLatency(); err != nil || (block > 0 && latency != 0) {
+			t.Fatalf("Block %d: expected no rate latency, got %v (%v)", block, latency, err)
+		}
+	}}).Samples
+	for k, sample := range samples {
+		if want := float32(0.5 * math.Sin(2*math.Pi*440*float64(k)/float64(rate))); sample != want {
+			t.Fatalf("Frame %d: expected the file's %.6f, got %.6f", k, want, sample)
+		}
+	}
+	t.Logf("✅ Identity channel passed %d frames through unchanged", len(samples))
+
+	// A mono file is upmixed, which the channel mixer has to do itself
+	mono := WriteTestWAV(t, rate, 1.0, 440)
+	BounceTestChannel(t, mono, 0.1, BounceHooks{Before: func(channel *Channel, block int) {
+		elision, err := channel.Elision()
+		if err != nil {
+			t.Fatalf("Elision failed: %v", err)
+		}
+		if block > 0 && (elision.Mixer || !elision.TimeStretch || !elision.PitchShift) {
+			t.Fatalf("Block %d: expected only the mono channel's time units routed around, got %+v", block, elision)
+		}
+	}})
+}
+
+func TestElisionRestoresUnits(t *testing.T) {
+	engine, cleanup := CreateTestEngine(t, DefaultTestEngineConfig())
+	sampleRate, blockSize := float64(engine.SampleRate), engine.BufferSize
+	cleanup()
+	path := WriteTestWAV(t, engine.SampleRate, 6.0, 440)
+
+	// A fifth up for a while, then a slower rate, each followed by identity
+	// again: a unit comes back in the block its parameter leaves identity and
+	// is routed around again within a second, once the shift has wound down
+	// and it has played out what it holds
+	type span struct {
+		from, to int
+		pitch    float32
+		rate     float32
+	}
+	second := int(sampleRate) / blockSize
+	spans := []span{{20, 60, 7, 1}, {60 + 2*second, 100 + 2*second, 0, 0.75}}
+	elided := map[int]ChannelElision{}
+	seconds := float64(spans[1].to+second*3/2) * float64(blockSize) / sampleRate
+	samples := BounceTestChannel(t, path, seconds, BounceHooks{Before: func(channel *Channel, block int) {
+		pitch, rate := float32(0), float32(1)
+		for _, s := range spans {
+			if block >= s.from && block < s.to {
+				pitch, rate = s.pitch, s.rate
+			}
+		}
+		if err := channel.SetPitch(pitch); err != nil {
+			t.Fatalf("SetPitch failed: %v", err)
+		}
+		if err := channel.SetPlaybackRate(rate); err != nil {
+			t.Fatalf("SetPlaybackRate failed: %v", err)
+		}
+		elision, err := channel.Elision()
+		if err != nil {
+			t.Fatalf("Elision failed: %v", err)
+		}
+		elided[block-1] = elision
+	}}).Samples
+	for _, s := range spans {
+		in := func(block int) bool {
+			if s.pitch != 0 {
+				return !elided[block].PitchShift
+			}
+			return !elided[block].TimeStretch
+		}
+		for block := s.from; block < s.to; block++ {
+			if !in(block) {
+				t.Fatalf("Block %d: expected the unit back in, got %+v", block, elided[block])
+			}
+		}
+		back := s.to
+		for back < s.to+second && in(back) {
+			back++
+		}
+		if in(back) {
+			t.Fatalf("Block %d: expected the unit routed around again, got %+v", back, elided[back])
+		}
+		t.Logf("Pitch %.0f, rate %.2f: routed around again %d blocks after returning to identity", s.pitch, s.rate, back-s.to)
+	}
+
+	// Level holds and no step is steeper than the fifth's own
+	const window = 1024
+	for at := 2 * window; at+window <= len(samples); at += window {
+		power := 0.0
+		for _, sample := range samples[at : at+window] {
+			power += float64(sample) * float64(sample)
+		}
+		if level := math.Sqrt(2 * power / window); level < 0.4 || level > 0.6 {
+			t.Fatalf("Frame %d: expected the tone near 0.5, got %.4f", at, level)
+		}
+	}
+	if step, slope := maxStep(samples, 0, len(samples)), 0.5*2*math.Pi*440*math.Pow(2, 7.0/12)/sampleRate; step > 1.1*slope {
+		t.Fatalf("Step of %.4f, the fifth's steepest is %.4f", step, slope)
+	}
+	t.Logf("✅ Units came back in and were routed around again over %d frames without a click", len(samples))
+}
+
+func BenchmarkElision(b *testing.B) {
+	// A full mixer of stems routed around at rate 1 and 0 cents, against a
+	// rate just off unity that keeps every time unit in; %core/voice is the
+	// share of one core each voice takes
+	const voices = 8
+	for _, rate := range []float32{1.0, 1.01} {
+		b.Run(fmt.Sprintf("rate-%.2f", rate), func(b *testing.B) {
+			engine, cleanup := CreateTestEngine(b, DefaultTestEngineConfig())
+			defer cleanup()
+			path := WriteTestWAV(b, engine.SampleRate, 12.0, 440)
+			for i := 0; i < voices; i++ {
+				channel, err := engine.CreatePlaybackChannel(path)
+				if err != nil {
+					b.Fatalf("CreatePlaybackChannel failed: %v", err)
+				}
+				if err := channel.SetPlaybackRate(rate); err != nil {
+					b.Fatalf("SetPlaybackRate failed: %v", err)
+				}
+			}
+
+			b.ResetTimer()
+			var factor float64
+			for i := 0; i < b.N; i++ {
+				stats, err := engine.RenderOffline(8*time.Second, io.Discard, nil)
+				if err != nil {
+					b.Fatalf("RenderOffline failed: %v", err)
+				}
+				factor = stats.RealtimeFactor
+			}
+			b.ReportMetric(100/factor/voices, "%core/voice")
+		})
+	}
+}
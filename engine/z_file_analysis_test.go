@@ -0,0 +1,131 @@
+package engine
+
+import (
+	"context"
+	"math"
+	"path/filepath"
+	"testing"
+)
+
+func collectFileAnalysis(t *testing.T, paths []string, opts *FileAnalysisOptions) []FileAnalysis {
+	t.Helper()
+	results, err := AnalyzeFiles(context.Background(), paths, opts)
+	if err != nil {
+		t.Fatalf("AnalyzeFiles failed: %v", err)
+	}
+	byIndex := make([]FileAnalysis, len(paths))
+	seen := make([]bool, len(paths))
+	for result := range results {
+		if seen[result.Index] {
+			t.Fatalf("File %d reported twice", result.Index)
+		}
+		seen[result.Index] = true
+		byIndex[result.Index] = result
+	}
+	for i := range seen {
+		if !seen[i] {
+			t.Fatalf("File %d was never reported", i)
+		}
+	}
+	return byIndex
+}
+
+func TestAnalyzeFiles(t *testing.T) {
+	openTestAnalysisCache(t, 1<<20)
+
+	var paths []string
+	for _, frequency := range []float64{220, 330, 440, 550, 660} {
+		paths = append(paths, WriteTestWAV(t, 48000, 1.0, frequency))
+	}
+	paths = append(paths, filepath.Join(t.TempDir(), "missing.wav"))
+
+	results := collectFileAnalysis(t, paths, &FileAnalysisOptions{Workers: 3, Loudness: true})
+	for i, result := range results {
+		if result.Path != paths[i] {
+			t.Errorf("File %d: expected path %s, got %s", i, paths[i], result.Path)
+		}
+		if i == len(paths)-1 {
+			if result.Err == nil {
+				t.Error("Expected an error for the missing file")
+			}
+			continue
+		}
+		if result.Err != nil {
+			t.Fatalf("File %d failed: %v", i, result.Err)
+		}
+		if result.Cached || result.Channels != 1 || result.Frames != 48000 || result.Duration != 1.0 ||
+			math.Abs(result.RMS-0.3536) > 0.01 || math.Abs(result.Peak-0.5) > 0.01 {
+			t.Errorf("File %d: unexpected analysis %+v", i, result)
+		}
+		if result.Loudness == nil || math.Abs(result.Loudness.Integrated+9.03) > 1 {
+			t.Errorf("File %d: unexpected loudness %+v", i, result.Loudness)
+		}
+	}
+
+	// A second pass is answered from the cache with identical results
+	before := analysisCacheStats(t)
+	again := collectFileAnalysis(t, paths[:5], &FileAnalysisOptions{Loudness: true})
+	if hits := analysisCacheStats(t).Hits - before.Hits; hits != 5 {
+		t.Errorf("Expected 5 cache hits, got %d", hits)
+	}
+	for i, result := range again {
+		if !result.Cached || result.RMS != results[i].RMS || result.Peak != results[i].Peak ||
+			*result.Loudness != *results[i].Loudness {
+			t.Errorf("File %d: cached analysis differs: %+v vs %+v", i, result, results[i])
+		}
+	}
+	t.Logf("✅ Analyzed %d files on 3 workers, reused all from the cache", len(paths)-1)
+}
+
+func TestAnalyzeFilesCancel(t *testing.T) {
+	path := WriteTestWAV(t, 48000, 2.0, 1000)
+	paths := make([]string, 200)
+	for i := range paths {
+		paths[i] = path
+	}
+
+	ctx, cancel := context.WithCancel(context.Background())
+	defer cancel()
+	results, err := AnalyzeFiles(ctx, paths, &FileAnalysisOptions{Workers: 2})
+	if err != nil {
+		t.Fatalf("AnalyzeFiles failed: %v", err)
+	}
+	received := 0
+	for range results {
+		received++
+		if received == 3 {
+			cancel()
+		}
+	}
+	if received < 3 || received == len(paths) {
+		t.Errorf("Expected cancellation to stop the batch early, got %d of %d results", received, len(paths))
+	}
+
+	if results, err := AnalyzeFiles(context.Background(), nil, nil); err != nil {
+		t.Errorf("Expected an empty batch to succeed, got %v", err)
+	} else if _, ok := <-results; ok {
+		t.Error("Expected an empty batch to report nothing")
+	}
+	t.Logf("✅ Cancelled after %d of %d files", received, len(paths))
+}
+
+func BenchmarkAnalyzeFiles(b *testing.B) {
+	paths := make([]string, 32)
+	for i := range paths {
+		paths[i] = WriteTestWAV(b, 48000, 10.0, 100+float64(i)*10)
+	}
+
+	// One op meters 32 ten-second files on every core
+	b.ResetTimer()
+	for i := 0; i < b.N; i++ {
+		results, err := AnalyzeFiles(context.Background(), paths, nil)
+		if err != nil {
+			b.Fatal(err)
+		}
+		for result := range results {
+			if result.Err != nil {
+				b.Fatal(result.Err)
+			}
+		}
+	}
+}
@@ -0,0 +1,179 @@
+//go:build !darwin || !cgo
+
+package engine
+
+import (
+	"math"
+	"testing"
+	"time"
+)
+
+// Tests for the portable headless backend (native/headless). They run on any
+// platform without Core Audio and exercise the same C ABI as the macOS build.
+
+func TestHeadlessEngineLifecycle(t *testing.T) {
+	engine, cleanup := CreateTestEngine(t, DefaultTestEngineConfig())
+	defer cleanup()
+
+	if engine.GetMainMixerNode() == nil {
+		t.Fatal("Expected main mixer node")
+	}
+	if err := engine.SetMasterVolume(0.5); err != nil {
+		t.Fatalf("SetMasterVolume failed: %v", err)
+	}
+	if got := engine.GetMasterVolume(); got != 0.5 {
+		t.Errorf("Expected master volume 0.5, got %f", got)
+	}
+
+	if err := engine.Start(); err != nil {
+		t.Fatalf("Start failed: %v", err)
+	}
+	if !engine.IsRunning() {
+		t.Error("Expected engine to be running after Start")
+	}
+	engine.Pause()
+	if engine.IsRunning() {
+		t.Error("Expected engine to be paused")
+	}
+	engine.Stop()
+	t.Logf("✅ Headless engine lifecycle works")
+}
+
+func TestHeadlessPlaybackChannel(t *testing.T) {
+	engine, cleanup := CreateTestEngine(t, DefaultTestEngineConfig())
+	defer cleanup()
+
+	path := WriteTestWAV(t, 44100, 0.5, 440)
+	channel, err := engine.CreatePlaybackChannel(path)
+	if err != nil {
+		t.Fatalf("CreatePlaybackChannel failed: %v", err)
+	}
+
+	if err := engine.Start(); err != nil {
+		t.Fatalf("Start failed: %v", err)
+	}
+	if err := channel.Play(); err != nil {
+		t.Fatalf("Play failed: %v", err)
+	}
+
+	if err := channel.SetPlaybackRate(1.25); err != nil {
+		t.Fatalf("SetPlaybackRate failed: %v", err)
+	}
+	if rate, err := channel.GetPlaybackRate(); err != nil || rate != 1.25 {
+		t.Errorf("Expected rate 1.25, got %f (err %v)", rate, err)
+	}
+	if err := channel.SetPitch(-3); err != nil {
+		t.Fatalf("SetPitch failed: %v", err)
+	}
+	if pitch, err := channel.GetPitch(); err != nil || pitch != -3 {
+		t.Errorf("Expected pitch -3, got %f (err %v)", pitch, err)
+	}
+
+	time.Sleep(100 * time.Millisecond)
+	t.Logf("✅ Headless playback channel renders with rate/pitch")
+}
+
+func TestHeadlessUnsupportedFile(t *testing.T) {
+	engine, cleanup := CreateTestEngine(t, DefaultTestEngineConfig())
+	defer cleanup()
+
+	// Compressed formats need Core Audio; the headless reader is WAV/AIFF only
+	if _, err := engine.CreatePlaybackChannel("idea.m4a"); err == nil {
+		t.Error("Expected error loading m4a in headless backend")
+	}
+}
+
+func TestHeadlessSamplerChannel(t *testing.T) {
+	engine, cleanup := CreateTestEngine(t, DefaultTestEngineConfig())
+	defer cleanup()
+
+	channel, err := engine.CreateSamplerChannel()
+	if err != nil {
+		t.Fatalf("CreateSamplerChannel failed: %v", err)
+	}
+	if err := engine.Start(); err != nil {
+		t.Fatalf("Start failed: %v", err)
+	}
+	if err := channel.PlayNote(60, 100, 50*time.Millisecond); err != nil {
+		t.Fatalf("PlayNote failed: %v", err)
+	}
+	if err := channel.StartNote(128, 100); err == nil {
+		t.Error("Expected error for out-of-range note")
+	}
+	t.Logf("✅ Headless sampler channel plays notes")
+}
+
+func TestSeekStreamingCrossfade(t *testing.T) {
+	engine, cleanup := CreateTestEngine(t, DefaultTestEngineConfig())
+	rate, blockSize := engine.SampleRate, engine.BufferSize
+	cleanup()
+
+	// The jump skips part of a cycle, so without a crossfade it clicks
+	path := WriteTestWAV(t, rate, 1.0, 441)
+	reference := BounceTestChannel(t, path, 1.0, BounceHooks{}).Samples
+	const atBlock = 20
+	const crossfade = 0.005
+	streaming := enableStreaming(t, StreamingOptions{BufferFrames: 1024, BufferCount: 3})
+	hard := BounceTestChannel(t, path, 1.0, BounceHooks{Setup: streaming, Before: seekAt(t, atBlock, 0.5, 0)}).Samples
+	bounce := BounceTestChannel(t, path, 1.0, BounceHooks{Setup: streaming, Before: seekAt(t, atBlock, 0.5, crossfade)})
+	faded := bounce.Samples
+	if bounce.Streaming.Underruns != 0 {
+		t.Errorf("Expected the preroll to cover the restart, got %+v", bounce.Streaming)
+	}
+
+	seekFrame, target, fade := atBlock*blockSize, rate/2, int(crossfade*float64(rate)+0.5)
+	hardJump := findJump(hard, reference, seekFrame, target, blockSize, 2048)
+	fadedJump := findJump(faded, reference, seekFrame, target, blockSize, 2048+fade)
+	if hardJump < 0 || fadedJump != hardJump {
+		t.Fatalf("Expected both seeks to land on the target at the same block, got %d and %d", hardJump, fadedJump)
+	}
+
+	// The crossfade takes the edge off the jump
+	hardStep := maxStep(hard, hardJump-2048, hardJump+2048+fade)
+	fadedStep := maxStep(faded, fadedJump-2048, fadedJump+2048+fade)
+	if fadedStep >= hardStep {
+		t.Errorf("Expected the crossfade to smooth the jump: step %f, %f without", fadedStep, hardStep)
+	}
+
+	if err := (&Channel{}).Seek(0.5, 0); err == nil {
+		t.Error("Expected an error seeking a non-playback channel")
+	}
+	t.Logf("✅ Streamed seek crossfaded over %d frames (step %.3f, %.3f hard): %+v", fade, fadedStep, hardStep, bounce.Streaming)
+}
+
+func TestQueueCrossfade(t *testing.T) {
+	engine, cleanup := CreateTestEngine(t, DefaultTestEngineConfig())
+	rate := engine.SampleRate
+	cleanup()
+
+	first := WriteTestWAV(t, rate, 1.0, 441)
+	second := WriteTestWAV(t, rate, 1.0, 882)
+	reference := BounceTestChannel(t, second, 1.0, BounceHooks{}).Samples
+
+	const crossfade = 0.1
+	queued := BounceTestChannel(t, first, 1.5, BounceHooks{Before: func(channel *Channel, block int) {
+		if block == 0 {
+			if _, err := channel.Enqueue(QueueItem{Path: second, Crossfade: crossfade}); err != nil {
+				t.Fatalf("Enqueue failed: %v", err)
+			}
+		}
+	}}).Samples
+
+	// The second file starts crossfade seconds before the first ends...
+	fadeStart := rate - int(crossfade*float64(rate)+0.5)
+	if !matches(queued, reference, rate+2048, len(queued), -fadeStart) {
+		t.Fatalf("Expected the second file from frame %d on", fadeStart)
+	}
+	// ...and the level holds through the equal-power overlap
+	const window = 512
+	for from := rate / 2; from+window <= rate*5/4; from += window {
+		sum := 0.0
+		for _, sample := range queued[from : from+window] {
+			sum += float64(sample) * float64(sample)
+		}
+		if rms := math.Sqrt(sum / window); rms < 0.25 {
+			t.Fatalf("Expected a steady level through the crossfade, got RMS %.3f at frame %d", rms, from)
+		}
+	}
+	t.Logf("✅ Second file faded in over %.0f ms from frame %d", crossfade*1000, fadeStart)
+}
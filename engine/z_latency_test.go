@@ -0,0 +1,114 @@
+package engine
+
+import (
+	"bytes"
+	"io"
+	"math"
+	"testing"
+	"time"
+)
+
+func TestLatencyCompensationAligned(t *testing.T) {
+	engine, cleanup := CreateTestEngine(t, DefaultTestEngineConfig())
+	defer cleanup()
+	path := WriteTestWAV(t, engine.SampleRate, 1.0, 440)
+
+	// Routed around, the time and pitch units hold nothing, so a fresh
+	// playback channel reaches the main mixer with nothing to make up, like a
+	// sampler
+	playback, err := engine.CreatePlaybackChannel(path)
+	if err != nil {
+		t.Fatalf("CreatePlaybackChannel failed: %v", err)
+	}
+	if _, err := engine.CreateSamplerChannel(); err != nil {
+		t.Fatalf("CreateSamplerChannel failed: %v", err)
+	}
+	compensation, err := engine.LatencyCompensation()
+	if err != nil {
+		t.Fatalf("LatencyCompensation failed: %v", err)
+	}
+	if compensation.Latency != 0 || compensation.Total != 0 || len(compensation.Channels) != 2 {
+		t.Fatalf("Expected two aligned channels without delay, got %+v", compensation)
+	}
+	for i, channel := range compensation.Channels {
+		if channel != (ChannelLatency{Compensated: true}) {
+			t.Fatalf("Channel %d: expected no latency or delay, got %+v", i, channel)
+		}
+	}
+
+	// Once the pitch is heard the channel's path reports the pitch unit's FFT
+	// size, and compensating holds the sampler back by as much
+	if err := playback.SetPitch(3); err != nil {
+		t.Fatalf("SetPitch failed: %v", err)
+	}
+	if _, err := engine.RenderOffline(100*time.Millisecond, io.Discard, nil); err != nil {
+		t.Fatalf("RenderOffline failed: %v", err)
+	}
+	_, fftLatency, err := playback.GetPitchShiftOptions()
+	if err != nil {
+		t.Fatalf("GetPitchShiftOptions failed: %v", err)
+	}
+	if compensation, err = engine.CompensateLatency(); err != nil {
+		t.Fatalf("CompensateLatency failed: %v", err)
+	}
+	want := []ChannelLatency{{Latency: fftLatency, Compensated: true}, {Delay: fftLatency, Compensated: true}}
+	if compensation.Latency != fftLatency || compensation.Total != fftLatency ||
+		compensation.Channels[0] != want[0] || compensation.Channels[1] != want[1] {
+		t.Fatalf("Expected the sampler delayed by the %d frame pitch latency, got %+v", fftLatency, compensation)
+	}
+	t.Logf("✅ Playback and sampler channels aligned at the main mixer: %+v", compensation)
+}
+
+func TestLatencyCompensationDelay(t *testing.T) {
+	engine, cleanup := CreateTestEngine(t, DefaultTestEngineConfig())
+	defer cleanup()
+	rate := engine.SampleRate
+	channel, err := engine.CreatePlaybackChannel(writeTestPCM(t, "float", rate, rate))
+	if err != nil {
+		t.Fatalf("CreatePlaybackChannel failed: %v", err)
+	}
+
+	// A delay that is not a whole number of blocks comes out as the file that
+	// many frames late, to the bit, and is what the engine reports
+	const delay = 333
+	if err := engine.setChannelDelay(channel, delay); err != nil {
+		t.Fatalf("setChannelDelay failed: %v", err)
+	}
+	compensation, err := engine.LatencyCompensation()
+	if err != nil {
+		t.Fatalf("LatencyCompensation failed: %v", err)
+	}
+	if compensation.Latency != delay || compensation.Total != delay || compensation.Channels[0].Delay != delay {
+		t.Fatalf("Expected %d frames of delay reported, got %+v", delay, compensation)
+	}
+
+	mixed := false
+	opts := &OfflineRenderOptions{BeforeBlock: func(frame int64) {
+		if elision, err := channel.Elision(); err == nil && frame > 0 && !elision.Mixer {
+			mixed = true
+		}
+	}}
+	var out bytes.Buffer
+	stats, err := engine.RenderOffline(500*time.Millisecond, &out, opts)
+	if err != nil {
+		t.Fatalf("RenderOffline failed: %v", err)
+	}
+	for k, sample := range DecodeChannel(out.Bytes(), stats.Channels, 0) {
+		want := float32(0)
+		if k >= delay {
+			want = float32(0.5 * math.Sin(2*math.Pi*440*float64(k-delay)/float64(rate)))
+		}
+		if sample != want {
+			t.Fatalf("Frame %d: expected %.6f, got %.6f", k, want, sample)
+		}
+	}
+	if !mixed {
+		t.Fatal("Expected the channel mixer to stop routing around a delayed input")
+	}
+
+	// Compensating again finds nothing to make up and takes the delay out
+	if compensation, err = engine.CompensateLatency(); err != nil || compensation.Total != 0 {
+		t.Fatalf("Expected CompensateLatency to clear the delay, got %+v (%v)", compensation, err)
+	}
+	t.Logf("✅ %d frames of delay came out %d frames late, bit-exact", delay, delay)
+}
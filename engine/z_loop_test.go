@@ -0,0 +1,137 @@
+package engine
+
+import (
+	"math"
+	"testing"
+)
+
+func setLoop(t *testing.T, region LoopRegion) func(*Channel) {
+	return func(channel *Channel) {
+		if err := channel.SetLoop(region); err != nil {
+			t.Fatalf("SetLoop(%+v) failed: %v", region, err)
+		}
+	}
+}
+
+func TestLoopIsSeamless(t *testing.T) {
+	engine, cleanup := CreateTestEngine(t, DefaultTestEngineConfig())
+	rate := engine.SampleRate
+	cleanup()
+
+	// A 100 frame period and a loop of whole periods: looping the region is
+	// the same as playing on, so any dropped or repeated frame shows
+	frequency := float64(rate) / 100
+	region := LoopRegion{Start: int64(rate/1000) * 100, End: int64(rate/1000)*100 + int64(rate/400)*100}
+	reference := BounceTestChannel(t, WriteTestWAV(t, rate, 2.5, frequency), 2.0, BounceHooks{}).Samples
+	bounce := BounceTestChannel(t, WriteTestWAV(t, rate, 0.5, frequency), 2.0, BounceHooks{Setup: setLoop(t, region)})
+	looped, playhead, at := bounce.Samples, bounce.Playheads[len(bounce.Playheads)-1], bounce.LastFrame
+
+	if !matches(looped, reference, 2048, len(looped), 0) {
+		t.Fatal("Expected the loop to wrap without a gap")
+	}
+	// At rate 1 output frame k was file frame k before the loop; the playhead
+	// counts the wraps since and stays inside the region
+	length := region.End - region.Start
+	passed := int64(at) - region.Start
+	loops, frame := passed/length, region.Start+passed%length
+	if playhead.Loops != loops || math.Abs(float64(playhead.Frame-frame)) > float64(engine.BufferSize) {
+		t.Errorf("Expected %d wraps and frame %d, got %+v", loops, frame, playhead)
+	}
+	t.Logf("✅ Looped %d frames %d times without a gap, playhead at frame %d", length, playhead.Loops, playhead.Frame)
+}
+
+func TestLoopCrossfade(t *testing.T) {
+	engine, cleanup := CreateTestEngine(t, DefaultTestEngineConfig())
+	rate := engine.SampleRate
+	cleanup()
+
+	// A quarter period short: a hard wrap jumps in phase
+	path := WriteTestWAV(t, rate, 0.5, float64(rate)/100)
+	hard := LoopRegion{Start: int64(rate) / 10, End: int64(rate)/10 + int64(rate/400)*100 - 25}
+	crossfaded := hard
+	crossfaded.Crossfade = 0.05
+
+	clicked := BounceTestChannel(t, path, 1.0, BounceHooks{Setup: setLoop(t, hard)}).Samples
+	smooth := BounceTestChannel(t, path, 1.0, BounceHooks{Setup: setLoop(t, crossfaded)}).Samples
+	if step := maxStep(clicked, 2048, len(clicked)); step < 0.3 {
+		t.Fatalf("Expected the hard wrap to jump, got steps of %f", step)
+	}
+	// A sine at 100 frames per period moves at most 0.5 * 2pi / 100 per frame
+	if step := maxStep(smooth, 2048, len(smooth)); step > 0.04 {
+		t.Fatalf("Expected the crossfaded wrap to stay smooth, got steps of %f", step)
+	}
+	// Every pass through the region is the same
+	length := int(crossfaded.End - crossfaded.Start)
+	if !matches(smooth, smooth, int(crossfaded.Start)+2048, len(smooth)-length, length) {
+		t.Fatal("Expected each pass to repeat the last")
+	}
+
+	// Streaming reads the loop start from its preroll, with the same result
+	streamed := BounceTestChannel(t, path, 1.0, BounceHooks{Setup: func(channel *Channel) {
+		enableStreaming(t, StreamingOptions{BufferFrames: 1000, BufferCount: 2})(channel)
+		setLoop(t, crossfaded)(channel)
+	}}).Samples
+	if !matches(streamed, smooth, 0, len(smooth), 0) {
+		t.Fatal("Expected the streamed loop to match the loop from memory")
+	}
+	t.Logf("✅ %.0f ms crossfade smoothed the wrap of a %d frame loop", crossfaded.Crossfade*1000, length)
+}
+
+func TestLoopClear(t *testing.T) {
+	engine, cleanup := CreateTestEngine(t, DefaultTestEngineConfig())
+	rate, blockSize := engine.SampleRate, engine.BufferSize
+	cleanup()
+
+	path := WriteTestWAV(t, rate, 0.5, 441)
+	region := LoopRegion{Start: int64(rate) / 10, End: int64(rate) / 5}
+	looped := BounceTestChannel(t, path, 1.5, BounceHooks{Setup: setLoop(t, region), Before: func(channel *Channel, block int) {
+		if block == rate/blockSize {
+			if err := channel.ClearLoop(); err != nil {
+				t.Fatalf("ClearLoop failed: %v", err)
+			}
+		}
+	}}).Samples
+
+	// Still looping a second in, then on to the end of the file and silence
+	if step := maxStep(looped, rate-1000, rate); step == 0 {
+		t.Fatal("Expected playback while the loop was set")
+	}
+	if step := maxStep(looped, rate+rate/2-1000, len(looped)); step != 0 {
+		t.Errorf("Expected the file to play out after ClearLoop, got steps of %f", step)
+	}
+	t.Logf("✅ ClearLoop let playback run on past frame %d", region.End)
+}
+
+func TestLoopValidation(t *testing.T) {
+	engine, cleanup := CreateTestEngine(t, DefaultTestEngineConfig())
+	defer cleanup()
+	path := WriteTestWAV(t, 44100, 1.0, 440)
+	channel, err := engine.CreatePlaybackChannel(path)
+	if err != nil {
+		t.Fatalf("CreatePlaybackChannel failed: %v", err)
+	}
+
+	for _, region := range []LoopRegion{
+		{Start: -1, End: 100},
+		{Start: 100, End: 100},
+		{Start: 0, End: 44101},
+		{Start: 1000, End: 2000, Crossfade: -0.01},
+		{Start: 1000, End: 2000, Crossfade: 0.1},   // More than the audio before Start
+		{Start: 10000, End: 10100, Crossfade: 0.1}, // More than the loop
+		{Start: 10000, End: 20000, Crossfade: 11},
+	} {
+		if err := channel.SetLoop(region); err == nil {
+			t.Errorf("Expected SetLoop(%+v) to fail", region)
+		}
+	}
+	if err := channel.SetLoop(LoopRegion{Start: 10000, End: 20000, Crossfade: 0.1}); err != nil {
+		t.Errorf("SetLoop failed: %v", err)
+	}
+	if err := (&Channel{}).SetLoop(LoopRegion{End: 100}); err == nil {
+		t.Error("Expected an error looping a non-playback channel")
+	}
+	if err := channel.ClearLoop(); err != nil {
+		t.Errorf("ClearLoop failed: %v", err)
+	}
+	t.Logf("✅ SetLoop validates its region")
+}
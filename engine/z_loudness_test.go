@@ -0,0 +1,199 @@
+package engine
+
+import (
+	"bytes"
+	"encoding/binary"
+	"fmt"
+	"math"
+	"testing"
+	"time"
+)
+
+// sinePlanar returns `channels` identical planes of a sine at `dbfs` peak level
+func sinePlanar(channels int, sampleRate, seconds, frequency, dbfs, phase float64) []float32 {
+	frames := int(sampleRate * seconds)
+	amplitude := math.Pow(10, dbfs/20)
+	planar := make([]float32, channels*frames)
+	for i := 0; i < frames; i++ {
+		sample := float32(amplitude * math.Sin(2*math.Pi*frequency*float64(i)/sampleRate+phase))
+		for c := 0; c < channels; c++ {
+			planar[c*frames+i] = sample
+		}
+	}
+	return planar
+}
+
+// concatPlanar joins planar buffers with the same channel count in time
+func concatPlanar(channels int, parts ...[]float32) []float32 {
+	total := 0
+	for _, part := range parts {
+		total += len(part)
+	}
+	out := make([]float32, 0, total)
+	for c := 0; c < channels; c++ {
+		for _, part := range parts {
+			frames := len(part) / channels
+			out = append(out, part[c*frames:(c+1)*frames]...)
+		}
+	}
+	return out
+}
+
+func TestLoudnessReferenceSine(t *testing.T) {
+	// EBU Tech 3341 case 1: stereo 1 kHz at -23 dBFS reads -23.0 LUFS
+	for _, rate := range []float64{44100, 48000, 96000} {
+		l, err := MeasureLoudness(sinePlanar(2, rate, 20, 1000, -23, 0), 2, rate)
+		if err != nil {
+			t.Fatalf("MeasureLoudness failed: %v", err)
+		}
+		for name, value := range map[string]float64{"integrated": l.Integrated, "momentary": l.Momentary, "short-term": l.ShortTerm} {
+			if math.Abs(value+23) > 0.1 {
+				t.Errorf("%.0f Hz: %s loudness %.2f LUFS, want -23.0", rate, name, value)
+			}
+		}
+		if l.Range > 0.2 {
+			t.Errorf("%.0f Hz: steady sine should have no loudness range, got %.2f LU", rate, l.Range)
+		}
+	}
+}
+
+func TestLoudnessGatingAndRange(t *testing.T) {
+	const rate = 48000
+
+	// Silence is gated out of the integrated value
+	gated, err := MeasureLoudness(concatPlanar(2, sinePlanar(2, rate, 10, 1000, -23, 0), make([]float32, 2*rate*10)), 2, rate)
+	if err != nil {
+		t.Fatalf("MeasureLoudness failed: %v", err)
+	}
+	if math.Abs(gated.Integrated+23) > 0.1 {
+		t.Errorf("Expected silence to be gated (-23 LUFS), got %.2f", gated.Integrated)
+	}
+	if gated.Momentary != LoudnessSilence {
+		t.Errorf("Expected silent momentary loudness at the end, got %.2f", gated.Momentary)
+	}
+
+	// EBU Tech 3342 case 1: 20 s at -20 LUFS then 20 s at -30 LUFS is 10 LU of range
+	ranged, err := MeasureLoudness(concatPlanar(2, sinePlanar(2, rate, 20, 1000, -20, 0), sinePlanar(2, rate, 20, 1000, -30, 0)), 2, rate)
+	if err != nil {
+		t.Fatalf("MeasureLoudness failed: %v", err)
+	}
+	if math.Abs(ranged.Range-10) > 1 {
+		t.Errorf("Expected loudness range 10 ±1 LU, got %.2f", ranged.Range)
+	}
+	if math.Abs(ranged.MaxShortTerm+20) > 0.2 {
+		t.Errorf("Expected max short-term -20 LUFS, got %.2f", ranged.MaxShortTerm)
+	}
+	t.Logf("✅ Gated integrated %.2f LUFS, range %.2f LU", gated.Integrated, ranged.Range)
+}
+
+func TestLoudnessTruePeak(t *testing.T) {
+	// A quarter-rate sine 45° off the sample grid: samples peak at 0.707 of the waveform
+	const rate = 48000
+	planar := sinePlanar(1, rate, 1, rate/4, -6.02, math.Pi/4)
+	var samplePeak float32
+	for _, s := range planar {
+		samplePeak = float32(math.Max(float64(samplePeak), math.Abs(float64(s))))
+	}
+
+	l, err := MeasureLoudness(planar, 1, rate)
+	if err != nil {
+		t.Fatalf("MeasureLoudness failed: %v", err)
+	}
+	if math.Abs(float64(l.TruePeak)-0.5) > 0.03 || l.ChannelTruePeaks[0] != l.TruePeak {
+		t.Errorf("Expected true peak ~0.5 (sample peak %.3f), got %.3f", samplePeak, l.TruePeak)
+	}
+	t.Logf("✅ True peak %.2f dBTP vs sample peak %.2f dBFS", l.TruePeakDB(), 20*math.Log10(float64(samplePeak)))
+}
+
+func TestLoudnessOnTapAndFile(t *testing.T) {
+	engine, cleanup := CreateTestEngine(t, DefaultTestEngineConfig())
+	defer cleanup()
+
+	channel, err := engine.CreatePlaybackChannel(WriteTestWAV(t, 48000, 4.0, 1000))
+	if err != nil {
+		t.Fatalf("CreatePlaybackChannel failed: %v", err)
+	}
+
+	// File analysis: mono 1 kHz at 0.5 peak is 20·log10(0.5) - 3.01 ≈ -9.03 LUFS
+	file, err := channel.AnalyzeLoudness(0, 4)
+	if err != nil {
+		t.Fatalf("AnalyzeLoudness failed: %v", err)
+	}
+	if math.Abs(file.Integrated+9.03) > 0.15 {
+		t.Errorf("Expected file loudness -9.03 LUFS, got %.2f", file.Integrated)
+	}
+
+	handle, err := engine.InstallTap("loudness", engine.GetMainMixerNode(), 0)
+	if err != nil {
+		t.Fatalf("InstallTap failed: %v", err)
+	}
+	defer handle.Remove()
+	if _, err := handle.Loudness(); err == nil {
+		t.Error("Expected error before loudness is enabled")
+	}
+	if err := handle.EnableLoudness(true); err != nil {
+		t.Fatalf("EnableLoudness failed: %v", err)
+	}
+
+	// The tap's streaming meter must agree with a one-shot measurement of the bounce
+	var out bytes.Buffer
+	stats, err := engine.RenderOffline(3*time.Second, &out, &OfflineRenderOptions{Layout: Planar})
+	if err != nil {
+		t.Fatalf("RenderOffline failed: %v", err)
+	}
+	tapped, err := handle.Loudness()
+	if err != nil {
+		t.Fatalf("Loudness failed: %v", err)
+	}
+	if tapped.Frames != stats.Frames {
+		t.Errorf("Expected the tap meter to see %d frames, got %d", stats.Frames, tapped.Frames)
+	}
+
+	// Planar blocks are channel-major per block; regroup into whole planes
+	raw := out.Bytes()
+	block := int(engine.BufferSize)
+	planar := make([]float32, int(stats.Frames)*stats.Channels)
+	for frame := 0; frame < int(stats.Frames); frame += block {
+		n := min(block, int(stats.Frames)-frame)
+		for c := 0; c < stats.Channels; c++ {
+			for i := 0; i < n; i++ {
+				offset := (frame*stats.Channels + c*n + i) * 4
+				planar[c*int(stats.Frames)+frame+i] = math.Float32frombits(binary.NativeEndian.Uint32(raw[offset:]))
+			}
+		}
+	}
+	bounce, err := MeasureLoudness(planar, stats.Channels, float64(stats.SampleRate))
+	if err != nil {
+		t.Fatalf("MeasureLoudness failed: %v", err)
+	}
+	if math.Abs(tapped.Integrated-bounce.Integrated) > 0.05 || math.Abs(float64(tapped.TruePeak-bounce.TruePeak)) > 1e-3 {
+		t.Errorf("Tap meter %.2f LUFS / %.3f TP, bounce %.2f LUFS / %.3f TP",
+			tapped.Integrated, tapped.TruePeak, bounce.Integrated, bounce.TruePeak)
+	}
+
+	if err := handle.ResetLoudness(); err != nil {
+		t.Fatalf("ResetLoudness failed: %v", err)
+	}
+	t.Logf("✅ File %.2f LUFS, tap %.2f LUFS (bounce %.2f)", file.Integrated, tapped.Integrated, bounce.Integrated)
+}
+
+func BenchmarkLoudness(b *testing.B) {
+	// Realtime factor of one meter on one core, i.e. how many meters a core sustains.
+	// Long buffers amortize the per-call setup and histogram readout.
+	const rate, seconds = 48000, 10
+	for _, channels := range []int{1, 2, 6} {
+		b.Run(fmt.Sprintf("%dch", channels), func(b *testing.B) {
+			planar := sinePlanar(channels, rate, seconds, 997, -18, 0)
+			b.SetBytes(int64(len(planar) * 4))
+			b.ResetTimer()
+			for i := 0; i < b.N; i++ {
+				if _, err := MeasureLoudness(planar, channels, rate); err != nil {
+					b.Fatal(err)
+				}
+			}
+			if elapsed := b.Elapsed().Seconds(); elapsed > 0 {
+				b.ReportMetric(float64(b.N)*seconds/elapsed, "meters/core")
+			}
+		})
+	}
+}
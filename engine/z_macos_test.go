@@ -0,0 +1,66 @@
+//go:build darwin && cgo
+
+package engine
+
+import "testing"
+
+// Tests for where the macOS backend falls short of the headless one, as
+// native/macaudio.h describes; the headless side is in z_headless_test.go.
+
+func TestMacOSSeekRestarts(t *testing.T) {
+	engine, cleanup := CreateTestEngine(t, DefaultTestEngineConfig())
+	rate, blockSize := engine.SampleRate, engine.BufferSize
+	cleanup()
+
+	// The player node is rescheduled from the target, which it still lands
+	// on, and a crossfade is accepted but leaves the jump as it was
+	path := WriteTestWAV(t, rate, 1.0, 441)
+	reference := BounceTestChannel(t, path, 1.0, BounceHooks{}).Samples
+	const atBlock = 20
+	hard := BounceTestChannel(t, path, 1.0, BounceHooks{Before: seekAt(t, atBlock, 0.5, 0)}).Samples
+	faded := BounceTestChannel(t, path, 1.0, BounceHooks{Before: seekAt(t, atBlock, 0.5, 0.005)}).Samples
+	if jump := findJump(faded, reference, atBlock*blockSize, rate/2, blockSize, 2048); jump < 0 {
+		t.Fatal("Output never continued from the target frame")
+	}
+	if !matches(faded, hard, 0, min(len(faded), len(hard)), 0) {
+		t.Fatal("Expected the crossfade not to change a macOS seek")
+	}
+	t.Logf("✅ Seek restarted the player at the target without a crossfade")
+}
+
+func TestMacOSQueueRejectsCrossfade(t *testing.T) {
+	engine, cleanup := CreateTestEngine(t, DefaultTestEngineConfig())
+	defer cleanup()
+	path := WriteTestWAV(t, engine.SampleRate, 1.0, 440)
+	channel, err := engine.CreatePlaybackChannel(path)
+	if err != nil {
+		t.Fatalf("CreatePlaybackChannel failed: %v", err)
+	}
+
+	// The node plays queued items back to back and cannot overlap them
+	if _, err := channel.Enqueue(QueueItem{Path: path, Crossfade: 0.1}); err == nil {
+		t.Fatal("Expected Enqueue with a crossfade to fail on macOS")
+	}
+	if _, err := channel.Enqueue(QueueItem{Path: path}); err != nil {
+		t.Fatalf("Enqueue without a crossfade failed: %v", err)
+	}
+	t.Logf("✅ Queued items splice and refuse a crossfade")
+}
+
+func TestMacOSVariantsUnsupported(t *testing.T) {
+	engine, cleanup := CreateTestEngine(t, DefaultTestEngineConfig())
+	defer cleanup()
+	channel, err := engine.CreatePlaybackChannel(WriteTestWAV(t, engine.SampleRate, 1.0, 440))
+	if err != nil {
+		t.Fatalf("CreatePlaybackChannel failed: %v", err)
+	}
+
+	// Nothing is rendered that the player could never switch to
+	if err := channel.PrepareVariants([]Variant{{Rate: 0.75}}, 0); err == nil {
+		t.Fatal("Expected PrepareVariants to fail on macOS")
+	}
+	if status, err := channel.VariantsStatus(); err != nil || status != (VariantsStatus{}) {
+		t.Fatalf("Expected no variants, got %+v (%v)", status, err)
+	}
+	t.Logf("✅ Variants refused, the units run live")
+}
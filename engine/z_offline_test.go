@@ -0,0 +1,174 @@
+package engine
+
+import (
+	"bytes"
+	"encoding/binary"
+	"io"
+	"math"
+	"os"
+	"path/filepath"
+	"testing"
+	"time"
+
+	"github.com/shaban/macaudio/devices"
+)
+
+// rmsOfFloat32PCM decodes native-endian float32 bytes and returns their RMS
+func rmsOfFloat32PCM(t *testing.T, data []byte) float64 {
+	t.Helper()
+	if len(data)%4 != 0 {
+		t.Fatalf("PCM length %d is not a multiple of 4", len(data))
+	}
+	var sum float64
+	for i := 0; i < len(data); i += 4 {
+		sample := float64(math.Float32frombits(binary.NativeEndian.Uint32(data[i:])))
+		sum += sample * sample
+	}
+	return math.Sqrt(sum / float64(len(data)/4))
+}
+
+func TestRenderOfflinePlayback(t *testing.T) {
+	engine, cleanup := CreateTestEngine(t, DefaultTestEngineConfig())
+	defer cleanup()
+
+	path := WriteTestWAV(t, 44100, 1.0, 440)
+	if _, err := engine.CreatePlaybackChannel(path); err != nil {
+		t.Fatalf("CreatePlaybackChannel failed: %v", err)
+	}
+
+	for _, layout := range []SampleLayout{Interleaved, Planar} {
+		var out bytes.Buffer
+		stats, err := engine.RenderOffline(500*time.Millisecond, &out, &OfflineRenderOptions{Layout: layout})
+		if err != nil {
+			t.Fatalf("RenderOffline(layout %d) failed: %v", layout, err)
+		}
+
+		expectedFrames := int64(engine.SampleRate / 2)
+		if stats.Frames != expectedFrames {
+			t.Errorf("Expected %d frames, got %d", expectedFrames, stats.Frames)
+		}
+		if got, want := out.Len(), int(expectedFrames)*stats.Channels*4; got != want {
+			t.Errorf("Expected %d bytes, got %d", want, got)
+		}
+		if rms := rmsOfFloat32PCM(t, out.Bytes()); rms < 0.05 {
+			t.Errorf("Expected audible bounce, got RMS %f", rms)
+		}
+		t.Logf("✅ Layout %d: %d frames at %.1fx realtime", layout, stats.Frames, stats.RealtimeFactor)
+	}
+
+	if engine.IsRunning() {
+		t.Error("Engine should stay stopped after offline render when it was stopped before")
+	}
+}
+
+func TestRenderOfflineMasterVolume(t *testing.T) {
+	engine, cleanup := CreateTestEngine(t, DefaultTestEngineConfig())
+	defer cleanup()
+
+	path := WriteTestWAV(t, 44100, 1.0, 440)
+	if _, err := engine.CreatePlaybackChannel(path); err != nil {
+		t.Fatalf("CreatePlaybackChannel failed: %v", err)
+	}
+
+	render := func(volume float32) float64 {
+		if err := engine.SetMasterVolume(volume); err != nil {
+			t.Fatalf("SetMasterVolume failed: %v", err)
+		}
+		var out bytes.Buffer
+		if _, err := engine.RenderOffline(250*time.Millisecond, &out, nil); err != nil {
+			t.Fatalf("RenderOffline failed: %v", err)
+		}
+		return rmsOfFloat32PCM(t, out.Bytes())
+	}
+
+	full := render(1.0)
+	half := render(0.5)
+	if ratio := half / full; math.Abs(ratio-0.5) > 0.05 {
+		t.Errorf("Expected master volume 0.5 to halve RMS, got ratio %f", ratio)
+	}
+}
+
+func TestRenderOfflineSamplerAndFile(t *testing.T) {
+	engine, cleanup := CreateTestEngine(t, DefaultTestEngineConfig())
+	defer cleanup()
+
+	sampler, err := engine.CreateSamplerChannel()
+	if err != nil {
+		t.Fatalf("CreateSamplerChannel failed: %v", err)
+	}
+
+	noteOn := false
+	opts := &OfflineRenderOptions{
+		Layout: Interleaved,
+		BeforeBlock: func(frame int64) {
+			if !noteOn {
+				sampler.StartNote(69, 127)
+				noteOn = true
+			}
+		},
+	}
+
+	path := filepath.Join(t.TempDir(), "bounce.f32")
+	stats, err := engine.RenderOfflineToFile(200*time.Millisecond, path, opts)
+	if err != nil {
+		t.Fatalf("RenderOfflineToFile failed: %v", err)
+	}
+
+	data, err := os.ReadFile(path)
+	if err != nil {
+		t.Fatalf("Failed to read bounce: %v", err)
+	}
+	if int64(len(data)) != stats.Frames*int64(stats.Channels)*4 {
+		t.Errorf("File size %d does not match %d frames", len(data), stats.Frames)
+	}
+	if rms := rmsOfFloat32PCM(t, data); rms == 0 {
+		t.Error("Expected sampler note in bounce, got silence")
+	}
+}
+
+func TestRenderOfflineValidation(t *testing.T) {
+	engine, cleanup := CreateTestEngine(t, DefaultTestEngineConfig())
+	defer cleanup()
+
+	if _, err := engine.RenderOffline(0, &bytes.Buffer{}, nil); err == nil {
+		t.Error("Expected error for zero duration")
+	}
+	if _, err := engine.RenderOffline(time.Second, nil, nil); err == nil {
+		t.Error("Expected error for nil sink")
+	}
+}
+
+func BenchmarkRenderOffline(b *testing.B) {
+	audioDevices, err := devices.GetAudio()
+	if err != nil {
+		b.Fatalf("Failed to get audio devices: %v", err)
+	}
+	outputs := audioDevices.Outputs()
+	if len(outputs) == 0 {
+		b.Skip("No output devices available")
+	}
+	engine, err := NewEngine(&outputs[0], 0, 512)
+	if err != nil {
+		b.Fatalf("Failed to create engine: %v", err)
+	}
+	defer engine.Destroy()
+
+	// Four 10 s stems through the full player -> stretch -> pitch shift -> mixer chain
+	path := WriteTestWAV(b, 44100, 10.0, 440)
+	for i := 0; i < 4; i++ {
+		if _, err := engine.CreatePlaybackChannel(path); err != nil {
+			b.Fatalf("CreatePlaybackChannel failed: %v", err)
+		}
+	}
+
+	b.ResetTimer()
+	var factor float64
+	for i := 0; i < b.N; i++ {
+		stats, err := engine.RenderOffline(10*time.Second, io.Discard, nil)
+		if err != nil {
+			b.Fatalf("RenderOffline failed: %v", err)
+		}
+		factor = stats.RealtimeFactor
+	}
+	b.ReportMetric(factor, "x-realtime")
+}
@@ -0,0 +1,102 @@
+package engine
+
+import (
+	"bytes"
+	"testing"
+	"time"
+)
+
+func pcmCacheStats(t *testing.T) PCMCacheStats {
+	t.Helper()
+	stats, err := GetPCMCacheStats()
+	if err != nil {
+		t.Fatalf("GetPCMCacheStats failed: %v", err)
+	}
+	return stats
+}
+
+func TestPCMCacheSharesDecodedFile(t *testing.T) {
+	path := WriteTestWAV(t, 44100, 1.0, 440)
+	reference := BounceTestChannel(t, path, 1.0, BounceHooks{})
+
+	if err := SetPCMCacheBudget(64 << 20); err != nil {
+		t.Fatalf("SetPCMCacheBudget failed: %v", err)
+	}
+	t.Cleanup(func() { SetPCMCacheBudget(0) })
+	before := pcmCacheStats(t)
+
+	engine, cleanup := CreateTestEngine(t, DefaultTestEngineConfig())
+	defer cleanup()
+	const takes = 8
+	for i := 0; i < takes; i++ {
+		if _, err := engine.CreatePlaybackChannel(path); err != nil {
+			t.Fatalf("CreatePlaybackChannel %d failed: %v", i, err)
+		}
+	}
+
+	// One decode, shared by every channel
+	stats := pcmCacheStats(t)
+	if misses := stats.Misses - before.Misses; misses != 1 {
+		t.Errorf("Expected 1 miss, got %d", misses)
+	}
+	if hits := stats.Hits - before.Hits; hits != takes-1 {
+		t.Errorf("Expected %d hits, got %d", takes-1, hits)
+	}
+	if stats.Entries != before.Entries+1 || stats.InUse != before.InUse+1 || stats.Bytes-before.Bytes != 44100*4 {
+		t.Errorf("Expected one shared entry of one second, got %+v (before %+v)", stats, before)
+	}
+
+	// Channels play the shared copy exactly like a private one
+	shared := BounceTestChannel(t, path, 1.0, BounceHooks{})
+	if !bytes.Equal(reference.Output, shared.Output) {
+		t.Error("Bounce from the shared copy differs")
+	}
+	t.Logf("✅ %d channels share one decoded copy: %+v", takes, stats)
+}
+
+func TestPCMCacheEvictsColdEntries(t *testing.T) {
+	if err := SetPCMCacheBudget(44100 * 4); err != nil {
+		t.Fatalf("SetPCMCacheBudget failed: %v", err)
+	}
+	t.Cleanup(func() { SetPCMCacheBudget(0) })
+
+	engine, cleanup := CreateTestEngine(t, DefaultTestEngineConfig())
+	defer cleanup()
+	first := WriteTestWAV(t, 44100, 1.0, 440)
+	second := WriteTestWAV(t, 44100, 1.0, 880)
+	if _, err := engine.CreatePlaybackChannel(first); err != nil {
+		t.Fatalf("CreatePlaybackChannel failed: %v", err)
+	}
+	before := pcmCacheStats(t)
+
+	// Still referenced, so a second file pushes the total over budget without evicting it
+	if _, err := engine.CreatePlaybackChannel(second); err != nil {
+		t.Fatalf("CreatePlaybackChannel failed: %v", err)
+	}
+	if stats := pcmCacheStats(t); stats.Evictions != before.Evictions || stats.Bytes <= stats.BudgetBytes {
+		t.Errorf("Expected both entries kept while in use, got %+v", stats)
+	}
+
+	// Releasing the first channel makes its entry cold, and over budget it goes
+	if err := engine.DestroyChannel(len(engine.Channels) - 2); err != nil {
+		t.Fatalf("DestroyChannel failed: %v", err)
+	}
+	stats := pcmCacheStats(t)
+	if stats.Evictions != before.Evictions+1 || stats.Entries != before.Entries {
+		t.Errorf("Expected the released entry evicted, got %+v (before %+v)", stats, before)
+	}
+
+	// The surviving channel still plays its copy
+	if err := engine.Start(); err != nil {
+		t.Fatalf("Start failed: %v", err)
+	}
+	if err := engine.Channels[len(engine.Channels)-1].Play(); err != nil {
+		t.Fatalf("Play failed: %v", err)
+	}
+	time.Sleep(50 * time.Millisecond)
+
+	if err := SetPCMCacheBudget(-1); err == nil {
+		t.Error("Expected an error for a negative budget")
+	}
+	t.Logf("✅ Evicted the cold entry only: %+v", stats)
+}
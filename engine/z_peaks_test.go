@@ -0,0 +1,114 @@
+package engine
+
+import (
+	"math"
+	"os"
+	"testing"
+	"time"
+)
+
+// waitPeaks polls until the channel's overview is ready
+func waitPeaks(t testing.TB, channel *Channel) PeaksStatus {
+	t.Helper()
+	for deadline := time.Now().Add(5 * time.Second); time.Now().Before(deadline); time.Sleep(2 * time.Millisecond) {
+		status, err := channel.PeaksStatus()
+		if err != nil {
+			t.Fatalf("PeaksStatus failed: %v", err)
+		}
+		if status.Error != "" {
+			t.Fatalf("Peaks build failed: %s", status.Error)
+		}
+		if status.Ready {
+			return status
+		}
+	}
+	t.Fatal("Timed out waiting for peaks")
+	return PeaksStatus{}
+}
+
+func TestPeaksPyramid(t *testing.T) {
+	engine, cleanup := CreateTestEngine(t, DefaultTestEngineConfig())
+	defer cleanup()
+
+	path := WriteTestWAV(t, 48000, 10.0, 1000)
+	channel, err := engine.CreatePlaybackChannel(path)
+	if err != nil {
+		t.Fatalf("CreatePlaybackChannel failed: %v", err)
+	}
+	if _, err := channel.Peaks(0, 1, 10, nil); err == nil {
+		t.Error("Expected error querying peaks before they are built")
+	}
+	if err := channel.BuildPeaks(true); err != nil {
+		t.Fatalf("BuildPeaks failed: %v", err)
+	}
+	status := waitPeaks(t, channel)
+	if status.Cached || status.Progress != 1 || status.Channels != 1 || status.Frames != 480000 {
+		t.Errorf("Unexpected status after building: %+v", status)
+	}
+
+	// Every column of a 0.5 peak sine spans -0.5..0.5 with RMS 0.5/√2, at any zoom
+	for _, zoom := range []struct {
+		start, duration float64
+		columns         int
+	}{{0, 10, 800}, {2.5, 0.1, 100}, {9.99, 0.01, 2}} {
+		columns, err := channel.Peaks(zoom.start, zoom.duration, zoom.columns, nil)
+		if err != nil {
+			t.Fatalf("Peaks failed: %v", err)
+		}
+		if len(columns) != zoom.columns {
+			t.Fatalf("Expected %d columns, got %d", zoom.columns, len(columns))
+		}
+		for i, column := range columns {
+			if math.Abs(float64(column.Min)+0.5) > 0.01 || math.Abs(float64(column.Max)-0.5) > 0.01 ||
+				math.Abs(float64(column.RMS)-0.3536) > 0.01 {
+				t.Fatalf("Column %d of %.2fs@%.2fs: %+v", i, zoom.duration, zoom.start, column)
+			}
+		}
+	}
+
+	// The persisted overview is reused by another player of the same file
+	if _, err := os.Stat(path + ".peaks"); err != nil {
+		t.Fatalf("Expected a .peaks file: %v", err)
+	}
+	reused, err := engine.CreatePlaybackChannel(path)
+	if err != nil {
+		t.Fatalf("CreatePlaybackChannel failed: %v", err)
+	}
+	if err := reused.BuildPeaks(true); err != nil {
+		t.Fatalf("BuildPeaks failed: %v", err)
+	}
+	if status := waitPeaks(t, reused); !status.Cached {
+		t.Error("Expected peaks loaded from the .peaks file")
+	}
+	built, _ := channel.Peaks(1, 3, 64, nil)
+	cached, _ := reused.Peaks(1, 3, 64, nil)
+	for i := range built {
+		if built[i] != cached[i] {
+			t.Fatalf("Column %d differs between built and cached peaks: %+v vs %+v", i, built[i], cached[i])
+		}
+	}
+	t.Logf("✅ Peaks built, queried at three zooms and reused from %s.peaks", path)
+}
+
+func BenchmarkPeaks(b *testing.B) {
+	engine, cleanup := CreateTestEngine(b, DefaultTestEngineConfig())
+	defer cleanup()
+
+	channel, err := engine.CreatePlaybackChannel(WriteTestWAV(b, 48000, 60.0, 1000))
+	if err != nil {
+		b.Fatal(err)
+	}
+	if err := channel.BuildPeaks(false); err != nil {
+		b.Fatal(err)
+	}
+	waitPeaks(b, channel)
+
+	// One op is a full-width 1920-column redraw of the whole minute
+	columns := make([]PeakColumn, 1920)
+	b.ResetTimer()
+	for i := 0; i < b.N; i++ {
+		if _, err := channel.Peaks(0, 60, 1920, columns); err != nil {
+			b.Fatal(err)
+		}
+	}
+}
@@ -0,0 +1,292 @@
+package engine
+
+import (
+	"fmt"
+	"math"
+	"testing"
+)
+
+var pitchShiftQualities = []PitchShiftQuality{PitchShiftLow, PitchShiftMedium, PitchShiftHigh, PitchShiftBest}
+
+// shiftPlanes runs planar audio through p in blocks of `block` frames, with the
+// shift of each block from cents
+func shiftPlanes(tb testing.TB, p *PitchShifter, in []float32, block int, cents func(block int) float32) []float32 {
+	tb.Helper()
+	frames := len(in) / p.Channels
+	out := make([]float32, len(in))
+	planeIn, planeOut := make([]float32, p.Channels*block), make([]float32, p.Channels*block)
+	for at, index := 0, 0; at < frames; at, index = at+block, index+1 {
+		n := min(block, frames-at)
+		for c := 0; c < p.Channels; c++ {
+			copy(planeIn[c*n:(c+1)*n], in[c*frames+at:c*frames+at+n])
+		}
+		if err := p.Process(planeIn[:p.Channels*n], planeOut[:p.Channels*n], cents(index)); err != nil {
+			tb.Fatalf("Process failed: %v", err)
+		}
+		for c := 0; c < p.Channels; c++ {
+			copy(out[c*frames+at:c*frames+at+n], planeOut[c*n:(c+1)*n])
+		}
+	}
+	return out
+}
+
+func TestPitchShiftTone(t *testing.T) {
+	const rate = 48000.0
+	in := sinePlanes(2, 2*rate, rate, 440, 0.5)
+	for _, quality := range pitchShiftQualities {
+		p, err := NewPitchShifter(rate, 2, PitchShiftOptions{Quality: quality})
+		if err != nil {
+			t.Fatalf("NewPitchShifter failed: %v", err)
+		}
+		// Overlap sets the floor: 4x leaves more of the neighbouring frames' phase
+		// error in the mix than 8x does
+		limit := -45.0
+		if p.FFTSize/p.Hop == 8 {
+			limit = -75.0
+		}
+		worst := math.Inf(-1)
+		for _, cents := range []float32{-1200, -500, 350, 700, 1200} {
+			p.Reset()
+			out := shiftPlanes(t, p, in, 512, func(int) float32 { return cents })
+			frequency := 440 * math.Pow(2, float64(cents)/1200)
+			from := p.Latency + int(rate)/2
+			amplitude, _, thdn := sineFit(out, rate, frequency, from, from+16384)
+			if math.Abs(amplitude-0.5) > 0.005 || thdn > limit {
+				t.Fatalf("Quality %d, %+.0f cents: expected %.1f Hz at 0.5, got %.4f with THD+N %.1f dB",
+					quality, cents, frequency, amplitude, thdn)
+			}
+			// The second plane keeps its own level
+			if amplitude, _, _ := sineFit(out[len(out)/2:], rate, frequency, from, from+16384); math.Abs(amplitude-0.25) > 0.003 {
+				t.Fatalf("Quality %d, %+.0f cents: expected the second plane at 0.25, got %.4f", quality, cents, amplitude)
+			}
+			worst = math.Max(worst, thdn)
+		}
+		t.Logf("✅ Quality %d (%d-point FFT, hop %d, %s): THD+N at most %.1f dB", quality, p.FFTSize, p.Hop, p.Kernel, worst)
+		p.Close()
+	}
+}
+
+func TestPitchShiftUnityIsDelay(t *testing.T) {
+	const rate = 48000.0
+	p, err := NewPitchShifter(rate, 1, PitchShiftOptions{Quality: PitchShiftHigh, PreserveFormants: true})
+	if err != nil {
+		t.Fatalf("NewPitchShifter failed: %v", err)
+	}
+	defer p.Close()
+
+	// Noise shifted for a second, then left at 0 cents: once the shift has
+	// wound back out the output is the input Latency frames late, to rounding
+	in := make([]float32, 4*int(rate))
+	seed := uint32(1)
+	for i := range in {
+		seed = seed*1664525 + 1013904223
+		in[i] = float32(int32(seed)) / (1 << 32)
+	}
+	for pass, shifted := range []int{0, int(rate)} {
+		p.Reset()
+		out := shiftPlanes(t, p, in, 480, func(block int) float32 {
+			if block*480 < shifted {
+				return 300
+			}
+			return 0
+		})
+		settled := shifted
+		if shifted > 0 {
+			settled += 2 * int(rate)
+		}
+		for i := max(settled, p.Latency); i < len(in); i++ {
+			if math.Abs(float64(out[i]-in[i-p.Latency])) > 1e-6 {
+				t.Fatalf("Pass %d, frame %d: expected %g delayed by %d frames, got %g", pass, i, in[i-p.Latency], p.Latency, out[i])
+			}
+		}
+	}
+	t.Logf("✅ 0 cents is a delay of %d frames, also after a shift", p.Latency)
+}
+
+func TestPitchShiftPreservesFormants(t *testing.T) {
+	// A 200 Hz voice with a formant at 1 kHz, up a fifth: with formants kept,
+	// each harmonic under the formant takes the envelope's level at its new
+	// frequency instead of carrying its old level up with it
+	const rate, fundamental, cents = 48000.0, 200.0, 700.0
+	envelope := func(frequency float64) float64 {
+		return 0.1 * math.Exp(-0.5*math.Pow((frequency-1000)/400, 2))
+	}
+	in := make([]float32, 2*int(rate))
+	for k := 1; float64(k)*fundamental < 4000; k++ {
+		tone := sinePlanes(1, len(in), rate, float64(k)*fundamental, envelope(float64(k)*fundamental))
+		for i := range in {
+			in[i] += tone[i]
+		}
+	}
+	ratio := math.Pow(2, cents/1200)
+	for _, preserve := range []bool{true, false} {
+		p, err := NewPitchShifter(rate, 1, PitchShiftOptions{Quality: PitchShiftBest, PreserveFormants: preserve})
+		if err != nil {
+			t.Fatalf("NewPitchShifter failed: %v", err)
+		}
+		out := shiftPlanes(t, p, in, 512, func(int) float32 { return cents })
+		from := p.Latency + int(rate)/2
+		worst := 0.0
+		for k := 1; float64(k)*fundamental*ratio < 4000; k++ {
+			frequency := float64(k) * fundamental * ratio
+			if envelope(frequency) < 0.25*envelope(1000) {
+				continue
+			}
+			amplitude, _, _ := sineFit(out, rate, frequency, from, from+24000)
+			worst = math.Max(worst, math.Abs(20*math.Log10(amplitude/envelope(frequency))))
+		}
+		p.Close()
+		if preserve && worst > 2 {
+			t.Fatalf("Expected the harmonics within 2 dB of the formant, missed by %.1f dB", worst)
+		}
+		if !preserve && worst < 4 {
+			t.Fatalf("Expected the formant to move without preservation, harmonics within %.1f dB of it", worst)
+		}
+		t.Logf("✅ Formants preserved %v: harmonics at most %.1f dB off the envelope", preserve, worst)
+	}
+}
+
+func TestPitchShiftChannel(t *testing.T) {
+	engine, cleanup := CreateTestEngine(t, DefaultTestEngineConfig())
+	sampleRate := float64(engine.SampleRate)
+	path := WriteTestWAV(t, engine.SampleRate, 3.0, 440)
+	cleanup()
+
+	// A steady fifth up through the channel, at its default options and at the
+	// cheapest, stays a clean tone at the file's level
+	for _, options := range []*PitchShiftOptions{nil, {Quality: PitchShiftLow, FFTSize: 512}} {
+		samples := BounceTestChannel(t, path, 1.5, BounceHooks{Setup: func(channel *Channel) {
+			if options != nil {
+				if err := channel.SetPitchShiftOptions(*options); err != nil {
+					t.Fatalf("SetPitchShiftOptions failed: %v", err)
+				}
+			}
+			if err := channel.SetPitch(7); err != nil {
+				t.Fatalf("SetPitch failed: %v", err)
+			}
+		}}).Samples
+		frequency := 440 * math.Pow(2, 7.0/12)
+		from := len(samples) / 3
+		amplitude, _, thdn := sineFit(samples, sampleRate, frequency, from, len(samples))
+		if math.Abs(amplitude-0.5) > 0.01 || thdn > -40 {
+			t.Fatalf("Options %+v: expected %.1f Hz at 0.5, got %.4f with THD+N %.1f dB", options, frequency, amplitude, thdn)
+		}
+		t.Logf("✅ Options %+v: +7 semitones at %.4f, THD+N %.1f dB", options, amplitude, thdn)
+	}
+
+	// A new shift every block, sweeping an octave each way: the level holds and
+	// no step is steeper than the highest tone's own
+	sweep := func(block int) float32 {
+		step := block % 48
+		return float32(min(step, 48-step)-12) / 2
+	}
+	samples := BounceTestChannel(t, path, 2.0, BounceHooks{Before: func(channel *Channel, block int) {
+		if err := channel.SetPitch(sweep(block)); err != nil {
+			t.Fatalf("SetPitch(%.1f) failed: %v", sweep(block), err)
+		}
+	}}).Samples
+	const window = 1024
+	from := len(samples) / 4
+	for at := from; at+window <= len(samples); at += window {
+		power := 0.0
+		for _, sample := range samples[at : at+window] {
+			power += float64(sample) * float64(sample)
+		}
+		if level := math.Sqrt(2 * power / window); level < 0.4 || level > 0.6 {
+			t.Fatalf("Frame %d: expected the sweep near 0.5, got %.4f", at, level)
+		}
+	}
+	if step, slope := maxStep(samples, from, len(samples)), 0.5*2*math.Pi*880/sampleRate; step > 1.1*slope {
+		t.Fatalf("Sweep: step of %.4f, the highest tone's steepest is %.4f", step, slope)
+	}
+	t.Logf("✅ Pitch changed every block over %d frames without a click", len(samples))
+}
+
+func TestPitchShiftValidation(t *testing.T) {
+	engine, cleanup := CreateTestEngine(t, DefaultTestEngineConfig())
+	defer cleanup()
+	channel, err := engine.CreatePlaybackChannel(WriteTestWAV(t, engine.SampleRate, 1.0, 440))
+	if err != nil {
+		t.Fatalf("CreatePlaybackChannel failed: %v", err)
+	}
+	options, latency, err := channel.GetPitchShiftOptions()
+	if err != nil || options.Quality != PitchShiftMedium || latency != 2048 {
+		t.Fatalf("Expected medium quality with 2048 frames of latency by default, got %+v, %d, %v", options, latency, err)
+	}
+	want := PitchShiftOptions{Quality: PitchShiftBest, FFTSize: 1024, PreserveFormants: true}
+	if err := channel.SetPitchShiftOptions(want); err != nil {
+		t.Fatalf("SetPitchShiftOptions failed: %v", err)
+	}
+	if options, latency, err = channel.GetPitchShiftOptions(); err != nil || options != want || latency != 1024 {
+		t.Fatalf("Expected %+v with 1024 frames of latency, got %+v, %d, %v", want, options, latency, err)
+	}
+	if channel.PlaybackOptions.PitchShift != want {
+		t.Errorf("Expected the channel to keep %+v, got %+v", want, channel.PlaybackOptions.PitchShift)
+	}
+	for _, bad := range []PitchShiftOptions{{Quality: 7}, {FFTSize: 1000}, {FFTSize: 256}, {FFTSize: 16384}} {
+		if err := channel.SetPitchShiftOptions(bad); err == nil {
+			t.Errorf("Expected an error for %+v", bad)
+		}
+		if _, err := NewPitchShifter(48000, 2, bad); err == nil {
+			t.Errorf("Expected NewPitchShifter to reject %+v", bad)
+		}
+	}
+	for _, channels := range []int{0, 65} {
+		if _, err := NewPitchShifter(48000, channels, PitchShiftOptions{}); err == nil {
+			t.Errorf("Expected an error for %d channels", channels)
+		}
+	}
+	if _, err := NewPitchShifter(0, 2, PitchShiftOptions{}); err == nil {
+		t.Error("Expected an error for a sample rate of 0")
+	}
+
+	sampler, err := engine.CreateSamplerChannel()
+	if err != nil {
+		t.Fatalf("CreateSamplerChannel failed: %v", err)
+	}
+	if err := sampler.SetPitchShiftOptions(PitchShiftOptions{}); err == nil {
+		t.Error("Expected an error for the pitch shift options of a sampler channel")
+	}
+
+	p, err := NewPitchShifter(48000, 2, PitchShiftOptions{})
+	if err != nil {
+		t.Fatalf("NewPitchShifter failed: %v", err)
+	}
+	if err := p.Process(make([]float32, 3), make([]float32, 3), 0); err == nil {
+		t.Error("Expected an error for a partial plane")
+	}
+	if err := p.Process(make([]float32, 4), make([]float32, 2), 0); err == nil {
+		t.Error("Expected an error for mismatched buffers")
+	}
+	p.Close()
+	if err := p.Process(make([]float32, 4), make([]float32, 4), 0); err == nil {
+		t.Error("Expected an error processing with a closed pitch shifter")
+	}
+	t.Log("✅ Pitch shift options validate the quality, FFT size and channel")
+}
+
+func BenchmarkPitchShift(b *testing.B) {
+	// One op shifts ten seconds of a stereo stem at 48 kHz in 512-frame blocks,
+	// moving the shift every block; %core/16stems is the share of one core the
+	// target load of sixteen such stems takes in realtime
+	const rate, seconds, block, stems = 48000.0, 10, 512, 16
+	in := sinePlanes(2, seconds*rate, rate, 220, 0.5)
+	for _, quality := range pitchShiftQualities {
+		for _, formants := range []bool{false, true} {
+			b.Run(fmt.Sprintf("q%d/formants-%v", quality, formants), func(b *testing.B) {
+				p, err := NewPitchShifter(rate, 2, PitchShiftOptions{Quality: quality, PreserveFormants: formants})
+				if err != nil {
+					b.Fatal(err)
+				}
+				defer p.Close()
+				b.ResetTimer()
+				for i := 0; i < b.N; i++ {
+					p.Reset()
+					shiftPlanes(b, p, in, block, func(block int) float32 { return 300 + float32(block%100) })
+				}
+				perSecond := b.Elapsed().Seconds() / float64(b.N) / seconds
+				b.ReportMetric(100*perSecond*stems, "%core/16stems")
+			})
+		}
+	}
+}
@@ -0,0 +1,85 @@
+package engine
+
+import (
+	"math"
+	"testing"
+	"time"
+)
+
+func TestPlayheadFollowsRate(t *testing.T) {
+	engine, cleanup := CreateTestEngine(t, DefaultTestEngineConfig())
+	sampleRate, blockSize := engine.SampleRate, engine.BufferSize
+	cleanup()
+	path := WriteTestWAV(t, sampleRate, 3.0, 440)
+	for _, rate := range []float32{1.0, 0.5} {
+		trace := BounceTestChannel(t, path, 1.0, BounceHooks{Setup: setRate(t, rate)}).Playheads
+
+		// Block n starts after n blocks of output, which cover n*blockSize*rate file frames
+		tolerance := 2 * float64(blockSize) / float64(sampleRate)
+		for n := 8; n < len(trace); n++ {
+			expected := float64(n*blockSize) / float64(sampleRate) * float64(rate)
+			if !trace[n].Playing || math.Abs(trace[n].Position-expected) > tolerance {
+				t.Fatalf("Rate %.1f, block %d: expected %.4fs, got %+v", rate, n, expected, trace[n])
+			}
+			if trace[n].Rate != float64(rate) || trace[n].Position < trace[n-1].Position {
+				t.Fatalf("Rate %.1f, block %d: expected a steady playhead, got %+v after %+v", rate, n, trace[n], trace[n-1])
+			}
+		}
+		t.Logf("✅ Rate %.1f: playhead at %.3fs after one second", rate, trace[len(trace)-1].Position)
+	}
+}
+
+func TestPlayheadFollowsSeek(t *testing.T) {
+	engine, cleanup := CreateTestEngine(t, DefaultTestEngineConfig())
+	sampleRate, blockSize := engine.SampleRate, engine.BufferSize
+	cleanup()
+	const seekBlock = 30
+	path := WriteTestWAV(t, sampleRate, 3.0, 440)
+	trace := BounceTestChannel(t, path, 1.0, BounceHooks{Before: seekAt(t, seekBlock, 2.0, 0)}).Playheads
+
+	// Never before the target once the jump is applied, then on from there
+	tolerance := 2 * float64(blockSize) / float64(sampleRate)
+	for n := seekBlock + 1; n < len(trace); n++ {
+		elapsed := float64((n-seekBlock)*blockSize) / float64(sampleRate)
+		if trace[n].Position < 2.0 || trace[n].Position > 2.0+elapsed+tolerance {
+			t.Fatalf("Block %d: expected 2.0s to %.4fs, got %+v", n, 2.0+elapsed, trace[n])
+		}
+	}
+	last := trace[len(trace)-1]
+	if expected := 2.0 + float64((len(trace)-1-seekBlock)*blockSize)/float64(sampleRate); math.Abs(last.Position-expected) > 0.1 {
+		t.Errorf("Expected about %.3fs at the end, got %+v", expected, last)
+	}
+	t.Logf("✅ Playhead jumped to the seek target and ran on to %.3fs", last.Position)
+}
+
+func TestPlayheadRealtime(t *testing.T) {
+	engine, cleanup := CreateTestEngine(t, DefaultTestEngineConfig())
+	defer cleanup()
+	channel, err := engine.CreatePlaybackChannel(WriteTestWAV(t, 44100, 2.0, 440))
+	if err != nil {
+		t.Fatalf("CreatePlaybackChannel failed: %v", err)
+	}
+	if playhead, err := channel.Playhead(); err != nil || playhead.Playing || playhead.Position != 0 {
+		t.Fatalf("Expected a stopped playhead at 0, got %+v (%v)", playhead, err)
+	}
+	if err := engine.Start(); err != nil {
+		t.Fatalf("Start failed: %v", err)
+	}
+	if err := channel.Seek(1.0, 0); err != nil {
+		t.Fatalf("Seek failed: %v", err)
+	}
+	time.Sleep(200 * time.Millisecond)
+
+	playhead, err := channel.Playhead()
+	if err != nil {
+		t.Fatalf("Playhead failed: %v", err)
+	}
+	if !playhead.Playing || playhead.Position < 1.0 || playhead.Position > 1.5 {
+		t.Fatalf("Expected playback shortly after 1.0s, got %+v", playhead)
+	}
+	// Extrapolation between cycles moves forward with the clock
+	if now := HostTime(); now < playhead.HostTime || playhead.At(now+uint64(10*time.Millisecond)) <= playhead.Position {
+		t.Errorf("Expected %+v to extrapolate forward from %d", playhead, now)
+	}
+	t.Logf("✅ Realtime playhead at %.3fs from file second 1.0", playhead.Position)
+}
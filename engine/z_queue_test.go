@@ -0,0 +1,126 @@
+package engine
+
+import "testing"
+
+func TestQueueIsGapless(t *testing.T) {
+	engine, cleanup := CreateTestEngine(t, DefaultTestEngineConfig())
+	rate, blockSize := engine.SampleRate, engine.BufferSize
+	cleanup()
+
+	// A whole number of cycles per second, so one second twice is two seconds
+	oneSecond := WriteTestWAV(t, rate, 1.0, 441)
+	reference := BounceTestChannel(t, WriteTestWAV(t, rate, 2.0, 441), 1.5, BounceHooks{}).Samples
+
+	var id int64
+	var during QueueStatus
+	queued := BounceTestChannel(t, oneSecond, 1.5, BounceHooks{Before: func(channel *Channel, block int) {
+		var err error
+		switch {
+		case block == 0:
+			if id, err = channel.Enqueue(QueueItem{Path: oneSecond}); err != nil {
+				t.Fatalf("Enqueue failed: %v", err)
+			}
+		case block == (rate+rate/4)/blockSize:
+			if during, err = channel.QueueStatus(); err != nil {
+				t.Fatalf("QueueStatus failed: %v", err)
+			}
+		}
+	}}).Samples
+
+	// One frame of gap or overlap would shift everything after the join
+	if !matches(queued, reference, 2048, len(queued), 0) {
+		t.Fatal("Expected the queued file to continue the first on the next frame")
+	}
+	if during.Current != id || during.Pending != 0 {
+		t.Errorf("Expected item %d playing with nothing pending, got %+v", id, during)
+	}
+	t.Logf("✅ Queued item %d joined at frame %d without a gap: %+v", id, rate, during)
+}
+
+func TestQueueSkipAndClear(t *testing.T) {
+	engine, cleanup := CreateTestEngine(t, DefaultTestEngineConfig())
+	rate, blockSize := engine.SampleRate, engine.BufferSize
+	cleanup()
+
+	first := WriteTestWAV(t, rate, 1.0, 441)
+	second := WriteTestWAV(t, rate, 0.5, 882)
+	reference := BounceTestChannel(t, second, 0.5, BounceHooks{}).Samples
+
+	const skipBlock = 10
+	var secondID int64
+	var afterSkip, afterClear QueueStatus
+	queued := BounceTestChannel(t, first, 1.0, BounceHooks{Before: func(channel *Channel, block int) {
+		var err error
+		switch block {
+		case 0:
+			if secondID, err = channel.Enqueue(QueueItem{Path: second}); err != nil {
+				t.Fatalf("Enqueue failed: %v", err)
+			}
+			if _, err = channel.Enqueue(QueueItem{Path: first, Start: 0.25}); err != nil {
+				t.Fatalf("Enqueue failed: %v", err)
+			}
+		case skipBlock:
+			if err = channel.Skip(0); err != nil {
+				t.Fatalf("Skip failed: %v", err)
+			}
+		case skipBlock + 2:
+			afterSkip, _ = channel.QueueStatus()
+			if err = channel.ClearQueue(); err != nil {
+				t.Fatalf("ClearQueue failed: %v", err)
+			}
+			afterClear, _ = channel.QueueStatus()
+		}
+	}}).Samples
+
+	if afterSkip.Current != secondID || afterSkip.Pending != 1 || afterClear.Pending != 0 || afterClear.Current != secondID {
+		t.Fatalf("Expected item %d playing with one then none pending, got %+v and %+v", secondID, afterSkip, afterClear)
+	}
+	// The second file starts where the player was at the skip (the time and
+	// pitch units may pull it ahead of the output) and nothing follows it
+	skipFrame := -1
+	for jump := skipBlock * blockSize; jump < skipBlock*blockSize+4*2048 && skipFrame < 0; jump++ {
+		if matches(queued, reference, jump+2048, jump+len(reference), -jump) {
+			skipFrame = jump
+		}
+	}
+	if skipFrame < 0 {
+		t.Fatal("Expected the second file to start after the skip")
+	}
+	if step := maxStep(queued, skipFrame+len(reference)+2048, len(queued)); step != 0 {
+		t.Errorf("Expected silence after the cleared queue, got steps of %f", step)
+	}
+	t.Logf("✅ Skipped to item %d at frame %d and cleared the rest: %+v", secondID, skipFrame, afterClear)
+}
+
+func TestQueueValidation(t *testing.T) {
+	engine, cleanup := CreateTestEngine(t, DefaultTestEngineConfig())
+	defer cleanup()
+	path := WriteTestWAV(t, 44100, 1.0, 440)
+	channel, err := engine.CreatePlaybackChannel(path)
+	if err != nil {
+		t.Fatalf("CreatePlaybackChannel failed: %v", err)
+	}
+
+	for _, item := range []QueueItem{
+		{Path: ""},
+		{Path: path + ".missing"},
+		{Path: path, Start: -1},
+		{Path: path, Start: 2},
+		{Path: path, Crossfade: -0.1},
+		{Path: path, Crossfade: 11},
+	} {
+		if _, err := channel.Enqueue(item); err == nil {
+			t.Errorf("Expected Enqueue(%+v) to fail", item)
+		}
+	}
+	if err := channel.Skip(0); err == nil {
+		t.Error("Expected Skip with nothing scheduled to fail")
+	}
+	if _, err := (&Channel{}).Enqueue(QueueItem{Path: path}); err == nil {
+		t.Error("Expected an error queueing on a non-playback channel")
+	}
+	if status, err := channel.QueueStatus(); err != nil || status != (QueueStatus{}) {
+		t.Errorf("Expected an empty queue, got %+v (%v)", status, err)
+	}
+	t.Logf("✅ Enqueue validates its arguments")
+}
@@ -0,0 +1,327 @@
+package engine
+
+import (
+	"fmt"
+	"math"
+	"math/rand"
+	"testing"
+)
+
+// The common conversions, each way where both are in use
+var resamplerPairs = [][2]float64{
+	{44100, 48000}, {48000, 44100}, {44100, 88200}, {88200, 44100},
+	{48000, 96000}, {96000, 48000}, {44100, 96000}, {96000, 44100},
+	{48000, 192000}, {192000, 48000}, {192000, 44100},
+}
+
+var resamplerQualities = []ResampleQuality{ResampleLow, ResampleMedium, ResampleHigh, ResampleBest}
+
+// Worst THD+N each preset may reach on a 1 kHz tone
+var resamplerTHDN = map[ResampleQuality]float64{ResampleLow: -65, ResampleMedium: -100, ResampleHigh: -120, ResampleBest: -130}
+
+// sinePlanes returns `channels` planes of `frames` frames of a sine, each
+// channel at amplitude/(c+1) so a mixed-up channel shows
+func sinePlanes(channels, frames int, rate, frequency, amplitude float64) []float32 {
+	planes := make([]float32, channels*frames)
+	for c := 0; c < channels; c++ {
+		for i := 0; i < frames; i++ {
+			planes[c*frames+i] = float32(amplitude / float64(c+1) * math.Sin(2*math.Pi*frequency*float64(i)/rate))
+		}
+	}
+	return planes
+}
+
+// sineFit fits a*sin + b*cos at `frequency` to samples[from:to] by least
+// squares, returning the fitted amplitude, the phase against a sine starting
+// at sample 0 and the THD+N (residual over fit, in dB)
+func sineFit(samples []float32, rate, frequency float64, from, to int) (amplitude, phase, thdn float64) {
+	var ss, sc, cc, ys, yc float64
+	for i := from; i < to; i++ {
+		s, c := math.Sincos(2 * math.Pi * frequency * float64(i) / rate)
+		y := float64(samples[i])
+		ss, sc, cc, ys, yc = ss+s*s, sc+s*c, cc+c*c, ys+y*s, yc+y*c
+	}
+	det := ss*cc - sc*sc
+	a, b := (ys*cc-yc*sc)/det, (yc*ss-ys*sc)/det
+	residual, fitted := 0.0, 0.0
+	for i := from; i < to; i++ {
+		s, c := math.Sincos(2 * math.Pi * frequency * float64(i) / rate)
+		fit := a*s + b*c
+		residual += (float64(samples[i]) - fit) * (float64(samples[i]) - fit)
+		fitted += fit * fit
+	}
+	return math.Hypot(a, b), math.Atan2(b, a), 10 * math.Log10(residual/fitted)
+}
+
+// resampleTone converts half a second of a stereo 1 kHz tone at -6 dBFS and
+// fits channel 0 away from the ends
+func resampleTone(tb testing.TB, r *Resampler) (amplitude, phase, thdn float64) {
+	tb.Helper()
+	frames := int(r.InputRate) / 2
+	out, err := r.Convert(sinePlanes(r.Channels, frames, r.InputRate, 1000, 0.5))
+	if err != nil {
+		tb.Fatalf("Convert failed: %v", err)
+	}
+	outFrames := r.OutputFrames(frames)
+	if len(out) != outFrames*r.Channels {
+		tb.Fatalf("Expected %d frames per channel, got %d samples", outFrames, len(out))
+	}
+	edge := r.Taps * int(r.OutputRate) / int(r.InputRate)
+	amplitude, phase, thdn = sineFit(out, r.OutputRate, 1000, edge+100, outFrames-edge-100)
+	if second, _, _ := sineFit(out[outFrames:], r.OutputRate, 1000, edge+100, outFrames-edge-100); math.Abs(second-amplitude/2) > 1e-3 {
+		tb.Fatalf("Expected channel 1 at half of channel 0's %.4f, got %.4f", amplitude, second)
+	}
+	return amplitude, phase, thdn
+}
+
+func TestResamplerConversions(t *testing.T) {
+	for _, quality := range resamplerQualities {
+		worst := math.Inf(-1)
+		for _, pair := range resamplerPairs {
+			r, err := NewResampler(pair[0], pair[1], 2, quality)
+			if err != nil {
+				t.Fatalf("NewResampler(%v, %v) failed: %v", pair[0], pair[1], err)
+			}
+			amplitude, phase, thdn := resampleTone(t, r)
+			r.Close()
+
+			// Unity gain and no delay in the passband, distortion under the preset's limit
+			if math.Abs(amplitude-0.5) > 0.5*0.002 || math.Abs(phase) > 1e-3 {
+				t.Errorf("%v -> %v quality %d: expected amplitude 0.5 at phase 0, got %.5f at %.5f", pair[0], pair[1], quality, amplitude, phase)
+			}
+			if thdn > resamplerTHDN[quality] {
+				t.Errorf("%v -> %v quality %d: THD+N %.1f dB above %.0f dB", pair[0], pair[1], quality, thdn, resamplerTHDN[quality])
+			}
+			if r.Interpolated {
+				t.Errorf("%v -> %v: expected exact phases", pair[0], pair[1])
+			}
+			worst = math.Max(worst, thdn)
+		}
+		t.Logf("✅ Quality %d: THD+N at most %.1f dB over %d conversions", quality, worst, len(resamplerPairs))
+	}
+}
+
+func TestResamplerRejectsAliases(t *testing.T) {
+	// A tone above the output's Nyquist rate would fold back to 19.1 kHz; the
+	// stopband starts at 22.05 kHz and must hold it down to the preset's depth
+	depths := []float64{-55, -85, -105, -120}
+	for _, quality := range resamplerQualities {
+		depth := depths[quality]
+		r, err := NewResampler(96000, 44100, 1, quality)
+		if err != nil {
+			t.Fatalf("NewResampler failed: %v", err)
+		}
+		out, err := r.Convert(sinePlanes(1, 48000, 96000, 25000, 0.5))
+		r.Close()
+		if err != nil {
+			t.Fatalf("Convert failed: %v", err)
+		}
+		sum := 0.0
+		for _, sample := range out[1000 : len(out)-1000] {
+			sum += float64(sample) * float64(sample)
+		}
+		level := 10 * math.Log10(sum/float64(len(out)-2000)/0.125)
+		if level > depth {
+			t.Errorf("Quality %d: expected the alias below %.0f dB, got %.1f dB", quality, depth, level)
+		}
+		t.Logf("✅ Quality %d: 25 kHz at 96 kHz -> 44.1 kHz leaks %.1f dB", quality, level)
+	}
+}
+
+func TestResamplerArbitraryRatio(t *testing.T) {
+	// A varispeed-style ratio has no short exact cycle
+	r, err := NewResampler(44100, 44100*1.0137, 2, ResampleBest)
+	if err != nil {
+		t.Fatalf("NewResampler failed: %v", err)
+	}
+	defer r.Close()
+	if !r.Interpolated {
+		t.Fatal("Expected interpolated phases for a non-integer rate")
+	}
+	amplitude, phase, thdn := resampleTone(t, r)
+	if math.Abs(amplitude-0.5) > 0.5*0.002 || math.Abs(phase) > 1e-3 || thdn > -100 {
+		t.Fatalf("Expected a clean tone at amplitude 0.5, got %.5f at phase %.5f with THD+N %.1f dB", amplitude, phase, thdn)
+	}
+	t.Logf("✅ %.2f Hz -> %.2f Hz with %d interpolated phases: THD+N %.1f dB", r.InputRate, r.OutputRate, r.Phases, thdn)
+}
+
+func TestResamplerStreaming(t *testing.T) {
+	for _, pair := range [][2]float64{{44100, 48000}, {192000, 44100}, {48000, 48000 * 1.001}} {
+		r, err := NewResampler(pair[0], pair[1], 2, ResampleHigh)
+		if err != nil {
+			t.Fatalf("NewResampler failed: %v", err)
+		}
+		const frames = 20000
+		in := sinePlanes(2, frames, pair[0], 3000, 0.5)
+		whole, err := r.Convert(in)
+		if err != nil {
+			t.Fatalf("Convert failed: %v", err)
+		}
+		outFrames := len(whole) / 2
+
+		// Odd block sizes both ways, with the output filling up mid-block
+		r.Reset()
+		random := rand.New(rand.NewSource(1))
+		streamed := make([][]float32, 2)
+		collect := func(out []float32, produced int) {
+			for c := range streamed {
+				streamed[c] = append(streamed[c], out[c*len(out)/2:c*len(out)/2+produced]...)
+			}
+		}
+		for at := 0; at < frames; {
+			block := min(1+random.Intn(3000), frames-at)
+			chunk := append(append([]float32(nil), in[at:at+block]...), in[frames+at:frames+at+block]...)
+			for done := 0; done < block; {
+				part := append(append([]float32(nil), chunk[done:block]...), chunk[block+done:]...)
+				out := make([]float32, 2*(1+random.Intn(700)))
+				consumed, produced, err := r.Process(part, out)
+				if err != nil {
+					t.Fatalf("Process failed: %v", err)
+				}
+				collect(out, produced)
+				done += consumed
+			}
+			at += block
+		}
+		for {
+			out := make([]float32, 2*37)
+			produced, err := r.Drain(out)
+			if err != nil {
+				t.Fatalf("Drain failed: %v", err)
+			}
+			if produced == 0 {
+				break
+			}
+			collect(out, produced)
+		}
+		r.Close()
+
+		for c := range streamed {
+			if len(streamed[c]) != outFrames {
+				t.Fatalf("%v -> %v: expected %d frames streamed, got %d", pair[0], pair[1], outFrames, len(streamed[c]))
+			}
+			for i, sample := range streamed[c] {
+				if sample != whole[c*outFrames+i] {
+					t.Fatalf("%v -> %v: channel %d frame %d streamed as %f, converted whole as %f", pair[0], pair[1], c, i, sample, whole[c*outFrames+i])
+				}
+			}
+		}
+		t.Logf("✅ %v -> %v streamed in random blocks matches the whole conversion (%d frames)", pair[0], pair[1], outFrames)
+	}
+}
+
+func TestResamplerValidation(t *testing.T) {
+	for _, args := range []struct {
+		in, out  float64
+		channels int
+		quality  ResampleQuality
+	}{
+		{0, 48000, 2, ResampleHigh},
+		{44100, -1, 2, ResampleHigh},
+		{8000, 384000, 2, ResampleHigh},
+		{44100, 48000, 0, ResampleHigh},
+		{44100, 48000, 65, ResampleHigh},
+		{44100, 48000, 2, ResampleBest + 1},
+	} {
+		if r, err := NewResampler(args.in, args.out, args.channels, args.quality); err == nil {
+			r.Close()
+			t.Errorf("Expected NewResampler(%+v) to fail", args)
+		}
+	}
+
+	r, err := NewResampler(44100, 48000, 2, ResampleLow)
+	if err != nil {
+		t.Fatalf("NewResampler failed: %v", err)
+	}
+	if _, _, err := r.Process(make([]float32, 3), make([]float32, 4)); err == nil {
+		t.Error("Expected an error for input that is not whole planes")
+	}
+	r.Close()
+	if _, _, err := r.Process(make([]float32, 4), make([]float32, 4)); err == nil {
+		t.Error("Expected an error processing with a closed resampler")
+	}
+	t.Logf("✅ NewResampler validates its arguments (kernel %s)", r.Kernel)
+}
+
+func BenchmarkResampler(b *testing.B) {
+	// One op converts one second of stereo; Mframes/s is input frames per
+	// second of CPU, and THD+N is measured on a 1 kHz tone at -6 dBFS
+	for _, pair := range resamplerPairs {
+		for _, quality := range resamplerQualities {
+			b.Run(fmt.Sprintf("%gk-%gk/q%d", pair[0]/1000, pair[1]/1000, quality), func(b *testing.B) {
+				r, err := NewResampler(pair[0], pair[1], 2, quality)
+				if err != nil {
+					b.Fatal(err)
+				}
+				defer r.Close()
+				_, _, thdn := resampleTone(b, r)
+				// Planar blocks of 1024 frames, the way a render loop feeds it
+				const block = 1024
+				in := sinePlanes(2, int(pair[0]), pair[0], 1000, 0.5)
+				var blocks [][]float32
+				for at := 0; at+block <= len(in)/2; at += block {
+					blocks = append(blocks, append(append([]float32(nil), in[at:at+block]...), in[len(in)/2+at:len(in)/2+at+block]...))
+				}
+				out := make([]float32, 2*8*block)
+				b.SetBytes(int64(len(blocks) * block * 2 * 4))
+				b.ResetTimer()
+				for i := 0; i < b.N; i++ {
+					r.Reset()
+					for _, planes := range blocks {
+						r.Process(planes, out)
+					}
+				}
+				b.ReportMetric(float64(len(blocks)*block*b.N)/b.Elapsed().Seconds()/1e6, "Mframes/s")
+				b.ReportMetric(thdn, "THD+N_dB")
+			})
+		}
+	}
+}
+
+func TestResamplerChannelPlayback(t *testing.T) {
+	engine, cleanup := CreateTestEngine(t, DefaultTestEngineConfig())
+	sampleRate := engine.SampleRate
+	cleanup()
+	fileRate := 44100
+	if sampleRate == fileRate {
+		fileRate = 48000
+	}
+	path := writeTestPCM(t, "float", fileRate, fileRate)
+
+	// A float file at another rate than the engine plays through the channel's
+	// converter: a clean tone at every quality, cleaner the longer the filter
+	previous := 0.0
+	for _, quality := range resamplerQualities {
+		samples := BounceTestChannel(t, path, 0.75, BounceHooks{Setup: func(channel *Channel) {
+			if err := channel.SetResampleQuality(quality); err != nil {
+				t.Fatalf("SetResampleQuality(%d) failed: %v", quality, err)
+			}
+			if got, err := channel.GetResampleQuality(); err != nil || got != quality {
+				t.Fatalf("Expected quality %d back, got %d (%v)", quality, got, err)
+			}
+		}}).Samples
+		amplitude, _, thdn := sineFit(samples, float64(sampleRate), 440, sampleRate/10, len(samples)-sampleRate/10)
+		t.Logf("Quality %d: %d Hz file at %.5f, THD+N %.1f dB", quality, fileRate, amplitude, thdn)
+		if math.Abs(amplitude-0.5) > 0.001 || thdn > resamplerTHDN[quality] {
+			t.Fatalf("Quality %d: expected 440 Hz at 0.5 under %.0f dB, got %.5f at %.1f dB", quality, resamplerTHDN[quality], amplitude, thdn)
+		}
+		if quality > ResampleLow && thdn > previous {
+			t.Errorf("Quality %d: THD+N %.1f dB no better than the tier below's %.1f dB", quality, thdn, previous)
+		}
+		previous = thdn
+	}
+
+	engine, cleanup = CreateTestEngine(t, DefaultTestEngineConfig())
+	defer cleanup()
+	channel, err := engine.CreatePlaybackChannel(path)
+	if err != nil {
+		t.Fatalf("CreatePlaybackChannel failed: %v", err)
+	}
+	if quality, err := channel.GetResampleQuality(); err != nil || quality != ResampleMedium {
+		t.Errorf("Expected medium quality by default, got %d (%v)", quality, err)
+	}
+	if err := channel.SetResampleQuality(ResampleBest + 1); err == nil {
+		t.Error("Expected an unknown quality to be rejected")
+	}
+	t.Logf("✅ %d Hz file converted to %d Hz at every quality", fileRate, sampleRate)
+}
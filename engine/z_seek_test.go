@@ -0,0 +1,93 @@
+package engine
+
+import (
+	"math"
+	"testing"
+)
+
+// seekAt is a BounceHooks.Before seeking to `target` seconds before block
+// `atBlock`
+func seekAt(t *testing.T, atBlock int, target, crossfade float64) func(*Channel, int) {
+	return func(channel *Channel, block int) {
+		if block == atBlock {
+			if err := channel.Seek(target, crossfade); err != nil {
+				t.Errorf("Seek failed: %v", err)
+			}
+		}
+	}
+}
+
+// matches reports whether seeked[from:to] is reference[offset+from:offset+to]
+// up to the rounding of the time stretch and pitch shift units; one frame off
+// misses by far more
+func matches(seeked, reference []float32, from, to, offset int) bool {
+	for k := from; k < to; k++ {
+		if math.Abs(float64(seeked[k]-reference[k+offset])) > 1e-4 {
+			return false
+		}
+	}
+	return true
+}
+
+// findJump returns the player block at which seeked jumped from playing
+// reference in step to playing it from `target`, or -1. A time stretch or pitch
+// shift unit in the path pulls the player ahead of the output and smears a
+// jump over up to one analysis frame.
+func findJump(seeked, reference []float32, seekFrame, target, blockSize, settle int) int {
+	grain := 2048
+	for jump := seekFrame; jump < seekFrame+4*grain; jump += blockSize {
+		end := min(len(seeked), len(reference)-target+jump)
+		if matches(seeked, reference, grain, jump-grain, 0) && matches(seeked, reference, jump+settle, end, target-jump) {
+			return jump
+		}
+	}
+	return -1
+}
+
+// maxStep is the largest sample-to-sample change in samples[from:to]
+func maxStep(samples []float32, from, to int) float64 {
+	step := 0.0
+	for k := from + 1; k < to; k++ {
+		step = math.Max(step, math.Abs(float64(samples[k]-samples[k-1])))
+	}
+	return step
+}
+
+func TestSeekLandsOnExactFrame(t *testing.T) {
+	engine, cleanup := CreateTestEngine(t, DefaultTestEngineConfig())
+	rate, blockSize := engine.SampleRate, engine.BufferSize
+	cleanup()
+
+	// File at the engine rate, so one file frame is one output frame
+	path := WriteTestWAV(t, rate, 1.0, 441)
+	reference := BounceTestChannel(t, path, 1.0, BounceHooks{}).Samples
+	const atBlock = 20
+	seeked := BounceTestChannel(t, path, 1.0, BounceHooks{Before: seekAt(t, atBlock, 0.5, 0)}).Samples
+
+	seekFrame, target := atBlock*blockSize, rate/2
+	jump := findJump(seeked, reference, seekFrame, target, blockSize, 2048)
+	if jump < 0 {
+		t.Fatal("Output never continued from the target frame")
+	}
+	t.Logf("✅ Seek before frame %d landed on file frame %d at player frame %d", seekFrame, target, jump)
+}
+
+func TestSeekValidation(t *testing.T) {
+	engine, cleanup := CreateTestEngine(t, DefaultTestEngineConfig())
+	defer cleanup()
+	channel, err := engine.CreatePlaybackChannel(WriteTestWAV(t, 44100, 1.0, 440))
+	if err != nil {
+		t.Fatalf("CreatePlaybackChannel failed: %v", err)
+	}
+
+	for _, args := range [][2]float64{{-1, 0}, {2, 0}, {0.5, -0.01}, {0.5, 0.5}} {
+		if err := channel.Seek(args[0], args[1]); err == nil {
+			t.Errorf("Expected Seek(%v, %v) to fail", args[0], args[1])
+		}
+	}
+	// Not playing: the seek starts playback from the target
+	if err := channel.Seek(0.25, 0); err != nil {
+		t.Fatalf("Seek from stopped failed: %v", err)
+	}
+	t.Logf("✅ Seek validates its arguments and starts a stopped channel")
+}
@@ -0,0 +1,179 @@
+package engine
+
+import (
+	"fmt"
+	"io"
+	"math"
+	"testing"
+	"time"
+)
+
+func sineWindow(n int, sampleRate, frequency, amplitude float64) []float32 {
+	samples := make([]float32, n)
+	for i := range samples {
+		samples[i] = float32(amplitude * math.Sin(2*math.Pi*frequency*float64(i)/sampleRate))
+	}
+	return samples
+}
+
+// peakBin returns the index of the loudest value
+func peakBin(values []float32) int {
+	peak := 0
+	for i, v := range values {
+		if v > values[peak] {
+			peak = i
+		}
+	}
+	return peak
+}
+
+func TestSpectrumPlanLevels(t *testing.T) {
+	const rate = 48000
+
+	// A bin-centred half-scale sine reads -6.02 dB in its bin
+	plan, err := NewSpectrumPlan(nil, rate)
+	if err != nil {
+		t.Fatalf("NewSpectrumPlan failed: %v", err)
+	}
+	defer plan.Close()
+	if plan.Bins != 1024 || plan.Frequencies[100] != 100*rate/2048.0 {
+		t.Fatalf("Expected 1024 linear bins, got %d (bin 100 at %.2f Hz)", plan.Bins, plan.Frequencies[100])
+	}
+	out := make([]float32, plan.Bins)
+	if err := plan.Process(sineWindow(2048, rate, float64(plan.Frequencies[100]), 0.5), out); err != nil {
+		t.Fatalf("Process failed: %v", err)
+	}
+	if peakBin(out) != 100 || math.Abs(float64(out[100])+6.02) > 0.05 {
+		t.Errorf("Expected -6.02 dB at bin 100, got peak bin %d at %.2f dB", peakBin(out), out[100])
+	}
+	if out[400] > -90 {
+		t.Errorf("Expected leakage far from the tone below -90 dB, got %.1f", out[400])
+	}
+
+	// Third-octave bands: a 1 kHz tone reads its level in the 1 kHz band
+	octave, err := NewSpectrumPlan(&SpectrumConfig{FFTSize: 4096, Overlap: 4, Window: BlackmanHarrisWindow,
+		Scale: OctaveSpectrum, BandsPerOctave: 3, MinFrequency: 20, MaxFrequency: 20000}, rate)
+	if err != nil {
+		t.Fatalf("NewSpectrumPlan (octave) failed: %v", err)
+	}
+	defer octave.Close()
+	bands := make([]float32, octave.Bins)
+	octave.Process(sineWindow(4096, rate, 1000, 0.5), bands)
+	peak := peakBin(bands)
+	if octave.Bins != 31 || octave.Frequencies[peak] != 1000 || math.Abs(float64(bands[peak])+6.02) > 0.5 {
+		t.Errorf("Expected 31 bands peaking at 1 kHz near -6 dB, got %d bands, peak %.0f Hz at %.2f dB",
+			octave.Bins, octave.Frequencies[peak], bands[peak])
+	}
+
+	logPlan, err := NewSpectrumPlan(&SpectrumConfig{FFTSize: 2048, Overlap: 2, Scale: LogSpectrum, Bands: 48,
+		MinFrequency: 20, MaxFrequency: 20000}, rate)
+	if err != nil {
+		t.Fatalf("NewSpectrumPlan (log) failed: %v", err)
+	}
+	defer logPlan.Close()
+	for b := 1; b < logPlan.Bins; b++ {
+		if logPlan.Frequencies[b] <= logPlan.Frequencies[b-1] {
+			t.Fatalf("Band %d centre %.1f Hz not above band %d", b, logPlan.Frequencies[b], b-1)
+		}
+	}
+
+	if _, err := NewSpectrumPlan(&SpectrumConfig{FFTSize: 1000, Overlap: 4}, rate); err == nil {
+		t.Error("Expected error for a non-power-of-two FFT size")
+	}
+	t.Logf("✅ Linear, octave and log spectra read sine levels")
+}
+
+func TestTapSpectrumSnapshots(t *testing.T) {
+	engine, cleanup := CreateTestEngine(t, DefaultTestEngineConfig())
+	defer cleanup()
+
+	if _, err := engine.CreatePlaybackChannel(WriteTestWAV(t, 48000, 2.0, 1000)); err != nil {
+		t.Fatalf("CreatePlaybackChannel failed: %v", err)
+	}
+	handle, err := engine.InstallTap("spectrum", engine.GetMainMixerNode(), 0)
+	if err != nil {
+		t.Fatalf("InstallTap failed: %v", err)
+	}
+	defer handle.Remove()
+	if _, err := handle.OpenSpectrum(); err == nil {
+		t.Error("Expected error opening a spectrum before it is enabled")
+	}
+	if err := handle.EnableSpectrum(nil); err != nil {
+		t.Fatalf("EnableSpectrum failed: %v", err)
+	}
+	view, err := handle.OpenSpectrum()
+	if err != nil {
+		t.Fatalf("OpenSpectrum failed: %v", err)
+	}
+	defer view.Close()
+
+	if _, err := engine.RenderOffline(time.Second, io.Discard, nil); err != nil {
+		t.Fatalf("RenderOffline failed: %v", err)
+	}
+
+	// The worker wakes once per hop; wait for it to publish
+	var snapshot SpectrumSnapshot
+	for deadline := time.Now().Add(2 * time.Second); time.Now().Before(deadline); time.Sleep(5 * time.Millisecond) {
+		if snapshot = view.Latest(); snapshot.Seq > 0 {
+			break
+		}
+	}
+	if snapshot.Seq == 0 {
+		t.Fatal("Expected a published spectrum")
+	}
+	binHz := view.SampleRate / float64(view.FFTSize)
+	values := snapshot.Channel(0)
+	peak := peakBin(values)
+	if math.Abs(float64(view.Frequencies[peak])-1000) > binHz || math.Abs(float64(values[peak])+6.02) > 2 {
+		t.Errorf("Expected the 1 kHz tone near -6 dB, got %.1f Hz at %.2f dB", view.Frequencies[peak], values[peak])
+	}
+	if !snapshot.Valid() {
+		t.Error("Expected an intact snapshot")
+	}
+
+	peakHz := view.Frequencies[peak]
+
+	// Reconfiguring is refused while mapped, then allowed once released
+	octave := DefaultSpectrumConfig()
+	octave.Scale = OctaveSpectrum
+	if err := handle.EnableSpectrum(&octave); err == nil {
+		t.Error("Expected reconfiguration to fail while a view is open")
+	}
+	view.Close()
+	if err := handle.EnableSpectrum(&octave); err != nil {
+		t.Errorf("EnableSpectrum (octave) failed: %v", err)
+	}
+	if err := handle.DisableSpectrum(); err != nil {
+		t.Errorf("DisableSpectrum failed: %v", err)
+	}
+	t.Logf("✅ Snapshot %d peaks at %.1f Hz", snapshot.Seq, peakHz)
+}
+
+func BenchmarkSpectrum(b *testing.B) {
+	// One op is one window of one channel. %core/ch is the share of a core one
+	// channel costs at 48 kHz with the default 4x overlap.
+	const rate, overlap = 48000, 4
+	for _, size := range []int{2048, 4096} {
+		for _, scale := range []SpectrumScale{LinearSpectrum, OctaveSpectrum} {
+			name := map[SpectrumScale]string{LinearSpectrum: "linear", OctaveSpectrum: "third-octave"}[scale]
+			b.Run(fmt.Sprintf("%d/%s", size, name), func(b *testing.B) {
+				config := DefaultSpectrumConfig()
+				config.FFTSize = size
+				config.Scale = scale
+				plan, err := NewSpectrumPlan(&config, rate)
+				if err != nil {
+					b.Fatal(err)
+				}
+				defer plan.Close()
+				samples := sineWindow(size, rate, 1000, 0.5)
+				out := make([]float32, plan.Bins)
+				b.ResetTimer()
+				for i := 0; i < b.N; i++ {
+					plan.Process(samples, out)
+				}
+				windowsPerSecond := float64(rate*overlap) / float64(size)
+				b.ReportMetric(float64(b.Elapsed().Nanoseconds())/float64(b.N)*windowsPerSecond/1e7, "%core/ch")
+			})
+		}
+	}
+}
@@ -0,0 +1,226 @@
+package engine
+
+import (
+	"bytes"
+	"fmt"
+	"io"
+	"math"
+	"testing"
+	"time"
+)
+
+// drainTap appends every readable frame of channel 0 to dst
+func drainTap(t *testing.T, stream *TapStream, dst []float32) []float32 {
+	t.Helper()
+	for {
+		block := stream.Next(1024)
+		if block.Frames == 0 {
+			return dst
+		}
+		first, second := block.Channel(0)
+		dst = append(dst, first...)
+		dst = append(dst, second...)
+		if !stream.Commit(block) {
+			t.Fatalf("Block at frame %d was overwritten while reading", block.Start)
+		}
+	}
+}
+
+func TestTapStreamMatchesOfflineRender(t *testing.T) {
+	engine, cleanup := CreateTestEngine(t, DefaultTestEngineConfig())
+	defer cleanup()
+
+	path := WriteTestWAV(t, 44100, 1.0, 440)
+	if _, err := engine.CreatePlaybackChannel(path); err != nil {
+		t.Fatalf("CreatePlaybackChannel failed: %v", err)
+	}
+	if _, err := engine.InstallTap("stream-test", engine.GetMainMixerNode(), 0); err != nil {
+		t.Fatalf("InstallTap failed: %v", err)
+	}
+	defer engine.RemoveTap("stream-test")
+
+	stream, err := engine.OpenTapStream("stream-test")
+	if err != nil {
+		t.Fatalf("OpenTapStream failed: %v", err)
+	}
+	defer stream.Close()
+	if stream.Channels < 1 {
+		t.Fatalf("Expected at least one tapped channel, got %d", stream.Channels)
+	}
+
+	// Drain between blocks the way a monitoring goroutine would, then once
+	// more after the last block
+	var tapped []float32
+	var out bytes.Buffer
+	stats, err := engine.RenderOffline(time.Second, &out, &OfflineRenderOptions{
+		BeforeBlock: func(int64) { tapped = drainTap(t, stream, tapped) },
+	})
+	if err != nil {
+		t.Fatalf("RenderOffline failed: %v", err)
+	}
+	tapped = drainTap(t, stream, tapped)
+
+	if int64(len(tapped)) != stats.Frames {
+		t.Fatalf("Expected %d tapped frames, got %d", stats.Frames, len(tapped))
+	}
+	if stream.Dropped() != 0 {
+		t.Errorf("Expected no dropped frames, got %d", stream.Dropped())
+	}
+
+	// The main mixer feeds the output directly, so the tap sees the bounce
+	rendered := DecodeChannel(out.Bytes(), stats.Channels, 0)
+	for i, sample := range tapped {
+		if math.Abs(float64(sample-rendered[i])) > 1e-5 {
+			t.Fatalf("Frame %d: tapped %f, rendered %f", i, sample, rendered[i])
+		}
+	}
+	t.Logf("✅ Streamed %d frames zero-copy from the tap", len(tapped))
+}
+
+func TestTapStreamOutlivesTapRemoval(t *testing.T) {
+	engine, cleanup := CreateTestEngine(t, DefaultTestEngineConfig())
+	defer cleanup()
+
+	if _, err := engine.OpenTapStream("missing"); err == nil {
+		t.Error("Expected error opening a stream on a missing tap")
+	}
+
+	if _, err := engine.InstallTap("removed", engine.GetMainMixerNode(), 0); err != nil {
+		t.Fatalf("InstallTap failed: %v", err)
+	}
+	stream, err := engine.OpenTapStream("removed")
+	if err != nil {
+		t.Fatalf("OpenTapStream failed: %v", err)
+	}
+	if err := engine.RemoveTap("removed"); err != nil {
+		t.Fatalf("RemoveTap failed: %v", err)
+	}
+
+	// The mapping stays valid until Close; it just never advances
+	if n := stream.Available(); n != 0 {
+		t.Errorf("Expected nothing available, got %d", n)
+	}
+	block := stream.Next(256)
+	if block.Frames != 0 || !stream.Commit(block) {
+		t.Errorf("Expected an empty, intact block, got %+v", block)
+	}
+	stream.Close()
+	stream.Close()
+	if stream.Commit(block) {
+		t.Error("Expected Commit to fail after Close")
+	}
+}
+
+// tapChannels creates playback channels and taps each channel's mixer
+func tapChannels(t testing.TB, engine *Engine, count int) []string {
+	t.Helper()
+	path := WriteTestWAV(t, 44100, 0.5, 440)
+	keys := make([]string, count)
+	for i := range keys {
+		channel, err := engine.CreatePlaybackChannel(path)
+		if err != nil {
+			t.Fatalf("CreatePlaybackChannel failed: %v", err)
+		}
+		keys[i] = fmt.Sprintf("meter-%d", i)
+		if _, err := engine.InstallTap(keys[i], channel.mixerNodePtr, 0); err != nil {
+			t.Fatalf("InstallTap failed: %v", err)
+		}
+	}
+	t.Cleanup(func() {
+		for _, key := range keys {
+			engine.RemoveTap(key)
+		}
+	})
+	return keys
+}
+
+func TestTapMeterPollsInOneCall(t *testing.T) {
+	engine, cleanup := CreateTestEngine(t, DefaultTestEngineConfig())
+	defer cleanup()
+
+	keys := tapChannels(t, engine, 4)
+	if _, err := engine.RenderOffline(100*time.Millisecond, io.Discard, nil); err != nil {
+		t.Fatalf("RenderOffline failed: %v", err)
+	}
+
+	meter := NewTapMeter(append(keys, "missing")...)
+	defer meter.Close()
+	levels, err := meter.Poll()
+	if err != nil {
+		t.Fatalf("Poll failed: %v", err)
+	}
+	if len(levels) != len(keys)+1 {
+		t.Fatalf("Expected %d entries, got %d", len(keys)+1, len(levels))
+	}
+	for i, key := range keys {
+		if !levels[i].Found || levels[i].Key != key {
+			t.Errorf("Entry %d: expected found tap %q, got %+v", i, key, levels[i])
+		}
+		if levels[i].Frames == 0 || levels[i].RMS <= 0 || levels[i].RMS != levels[i].Channels[0].RMS {
+			t.Errorf("Tap %q: expected metered block, got frames %d rms %v", key, levels[i].Frames, levels[i].RMS)
+		}
+	}
+	if missing := levels[len(keys)]; missing.Found || missing.Frames != 0 {
+		t.Errorf("Expected missing tap to be reported empty, got %+v", missing)
+	}
+
+	// Every installed tap, keyed by name
+	all := NewTapMeter()
+	defer all.Close()
+	everything, err := all.Poll()
+	if err != nil {
+		t.Fatalf("Poll (all) failed: %v", err)
+	}
+	seen := map[string]bool{}
+	for _, l := range everything {
+		seen[l.Key] = l.Found && l.Frames > 0
+	}
+	for _, key := range keys {
+		if !seen[key] {
+			t.Errorf("Expected %q in all-taps poll", key)
+		}
+	}
+
+	// Steady-state polling reuses the meter's buffers
+	if allocs := testing.AllocsPerRun(100, func() { meter.Poll(); all.Poll() }); allocs != 0 {
+		t.Errorf("Expected allocation-free polling, got %.1f allocs per poll", allocs)
+	}
+	t.Logf("✅ Polled %d taps per call", len(everything))
+}
+
+func BenchmarkTapMeterPoll(b *testing.B) {
+	engine, cleanup := CreateTestEngine(b, DefaultTestEngineConfig())
+	defer cleanup()
+
+	// The engine has 8 channel buses; poll each tap 8 times for a 64-meter bridge
+	taps := tapChannels(b, engine, 8)
+	var keys []string
+	var handles []TapHandle
+	for i := 0; i < 8; i++ {
+		for _, key := range taps {
+			handle, err := LookupTap(key)
+			if err != nil {
+				b.Fatal(err)
+			}
+			keys = append(keys, key)
+			handles = append(handles, handle)
+		}
+	}
+
+	for _, bench := range []struct {
+		name  string
+		meter *TapMeter
+	}{
+		{"keys", NewTapMeter(keys...)},
+		{"handles", NewTapHandleMeter(handles...)},
+	} {
+		defer bench.meter.Close()
+		b.Run(bench.name, func(b *testing.B) {
+			for i := 0; i < b.N; i++ {
+				if _, err := bench.meter.Poll(); err != nil {
+					b.Fatal(err)
+				}
+			}
+		})
+	}
+}
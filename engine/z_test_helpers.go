@@ -1,7 +1,12 @@
 package engine
 
 import (
+	"bytes"
+	"encoding/binary"
+	"math"
 	"math/rand"
+	"os"
+	"path/filepath"
 	"testing"
 	"time"
 
@@ -26,7 +31,7 @@ func DefaultTestEngineConfig() TestEngineConfig {
 }
 
 // CreateTestEngine creates an engine with the given configuration and first available output device
-func CreateTestEngine(t *testing.T, config TestEngineConfig) (*Engine, func()) {
+func CreateTestEngine(t testing.TB, config TestEngineConfig) (*Engine, func()) {
 	audioDevices, err := devices.GetAudio()
 	if err != nil {
 		t.Fatalf("Failed to get audio devices: %v", err)
@@ -342,3 +347,104 @@ func CreateComplexTestEngine(t *testing.T, config SerializationTestConfig) (*Eng
 
 	return engine, cleanup
 }
+
+// WriteTestWAV writes a 16-bit mono sine WAV into the test's temp dir and
+// returns its path. Used where system sounds are unavailable (headless builds).
+func WriteTestWAV(t testing.TB, sampleRate int, seconds float64, frequency float64) string {
+	t.Helper()
+
+	frames := int(float64(sampleRate) * seconds)
+	data := make([]byte, 44+frames*2)
+	copy(data[0:], "RIFF")
+	binary.LittleEndian.PutUint32(data[4:], uint32(36+frames*2))
+	copy(data[8:], "WAVEfmt ")
+	binary.LittleEndian.PutUint32(data[16:], 16)
+	binary.LittleEndian.PutUint16(data[20:], 1) // PCM
+	binary.LittleEndian.PutUint16(data[22:], 1) // mono
+	binary.LittleEndian.PutUint32(data[24:], uint32(sampleRate))
+	binary.LittleEndian.PutUint32(data[28:], uint32(sampleRate*2))
+	binary.LittleEndian.PutUint16(data[32:], 2)
+	binary.LittleEndian.PutUint16(data[34:], 16)
+	copy(data[36:], "data")
+	binary.LittleEndian.PutUint32(data[40:], uint32(frames*2))
+	for i := 0; i < frames; i++ {
+		sample := 0.5 * math.Sin(2*math.Pi*frequency*float64(i)/float64(sampleRate))
+		binary.LittleEndian.PutUint16(data[44+i*2:], uint16(int16(sample*32767)))
+	}
+
+	path := filepath.Join(t.TempDir(), "sine.wav")
+	if err := os.WriteFile(path, data, 0o644); err != nil {
+		t.Fatalf("Failed to write test WAV: %v", err)
+	}
+	return path
+}
+
+// BounceHooks customise BounceTestChannel; either may be nil
+type BounceHooks struct {
+	Setup  func(channel *Channel)            // Once the channel exists, before rendering
+	Before func(channel *Channel, block int) // Ahead of every block, before the playhead is read
+}
+
+// Bounce is what BounceTestChannel rendered
+type Bounce struct {
+	Output     []byte     // Interleaved native-endian float32, as rendered
+	Channels   int        // Of Output
+	Samples    []float32  // Channel 0 of Output
+	Playheads  []Playhead // As read ahead of each block
+	LastFrame  int        // Output frame the last block started at
+	Streaming  StreamingStats
+	SampleRate int
+	BlockSize  int
+}
+
+// BounceTestChannel renders `seconds` of a fresh engine playing one channel
+// on path, for tests comparing what plays with what should
+func BounceTestChannel(t testing.TB, path string, seconds float64, hooks BounceHooks) Bounce {
+	t.Helper()
+	engine, cleanup := CreateTestEngine(t, DefaultTestEngineConfig())
+	defer cleanup()
+	channel, err := engine.CreatePlaybackChannel(path)
+	if err != nil {
+		t.Fatalf("CreatePlaybackChannel failed: %v", err)
+	}
+	if hooks.Setup != nil {
+		hooks.Setup(channel)
+	}
+
+	bounce := Bounce{SampleRate: engine.SampleRate, BlockSize: engine.BufferSize}
+	block := 0
+	opts := &OfflineRenderOptions{BeforeBlock: func(frame int64) {
+		if hooks.Before != nil {
+			hooks.Before(channel, block)
+		}
+		playhead, err := channel.Playhead()
+		if err != nil {
+			t.Fatalf("Playhead failed: %v", err)
+		}
+		bounce.Playheads = append(bounce.Playheads, playhead)
+		bounce.LastFrame = int(frame)
+		block++
+	}}
+	var out bytes.Buffer
+	stats, err := engine.RenderOffline(time.Duration(seconds*float64(time.Second)), &out, opts)
+	if err != nil {
+		t.Fatalf("RenderOffline failed: %v", err)
+	}
+	if bounce.Streaming, err = channel.StreamingStats(); err != nil {
+		t.Fatalf("StreamingStats failed: %v", err)
+	}
+	bounce.Output = out.Bytes()
+	bounce.Channels = stats.Channels
+	bounce.Samples = DecodeChannel(bounce.Output, stats.Channels, 0)
+	return bounce
+}
+
+// DecodeChannel picks one channel out of interleaved native-endian float32
+// frames, like those RenderOffline writes
+func DecodeChannel(raw []byte, channels, channel int) []float32 {
+	samples := make([]float32, len(raw)/(channels*4))
+	for i := range samples {
+		samples[i] = math.Float32frombits(binary.NativeEndian.Uint32(raw[(i*channels+channel)*4:]))
+	}
+	return samples
+}
@@ -0,0 +1,179 @@
+package engine
+
+import (
+	"fmt"
+	"io"
+	"math"
+	"math/rand"
+	"testing"
+	"time"
+)
+
+func setRate(t *testing.T, rate float32) func(*Channel) {
+	return func(channel *Channel) {
+		if err := channel.SetPlaybackRate(rate); err != nil {
+			t.Fatalf("SetPlaybackRate(%.2f) failed: %v", rate, err)
+		}
+	}
+}
+
+func TestTimeStretchKeepsPitch(t *testing.T) {
+	engine, cleanup := CreateTestEngine(t, DefaultTestEngineConfig())
+	sampleRate := float64(engine.SampleRate)
+	path := WriteTestWAV(t, engine.SampleRate, 3.0, 440)
+	cleanup()
+
+	// Fit the tone over short windows: each must be a clean 440 Hz at the
+	// rate 1 level, and the phase must not run away between them
+	const window = 1024
+	reference := 0.0
+	for _, rate := range []float32{1.0, 0.5, 0.75, 1.25} {
+		samples := BounceTestChannel(t, path, 1.0, BounceHooks{Setup: setRate(t, rate)}).Samples
+		from := len(samples) / 5
+		first, last, unwrapped := 0.0, 0.0, 0.0
+		worst := math.Inf(-1)
+		for at := from; at+window <= len(samples); at += window {
+			amplitude, phase, thdn := sineFit(samples, sampleRate, 440, at, at+window)
+			if rate == 1.0 && at == from {
+				reference = amplitude
+			}
+			if math.Abs(amplitude-reference) > 0.02*reference || thdn > -30 {
+				t.Fatalf("Rate %.2f, frame %d: expected 440 Hz at %.4f, got %.4f with THD+N %.1f dB", rate, at, reference, amplitude, thdn)
+			}
+			if at == from {
+				first, unwrapped = phase, phase
+			} else {
+				unwrapped += math.Remainder(phase-last, 2*math.Pi)
+			}
+			last = phase
+			worst = math.Max(worst, thdn)
+		}
+		seconds := float64(len(samples)-window-from) / sampleRate
+		drift := 440 + (unwrapped-first)/(2*math.Pi*seconds)
+		cents := 1200 * math.Log2(drift/440)
+		if math.Abs(cents) > 2 {
+			t.Fatalf("Rate %.2f: tone moved to %.2f Hz (%.1f cents)", rate, drift, cents)
+		}
+		// Grains join without a step steeper than the tone's own
+		if step, slope := maxStep(samples, from, len(samples)), reference*2*math.Pi*440/sampleRate; step > 1.05*slope {
+			t.Fatalf("Rate %.2f: step of %.4f, the tone's steepest is %.4f", rate, step, slope)
+		}
+		t.Logf("✅ Rate %.2f: 440 Hz held within %.2f cents, THD+N at most %.1f dB", rate, math.Abs(cents), worst)
+	}
+}
+
+func TestTimeStretchLatency(t *testing.T) {
+	engine, cleanup := CreateTestEngine(t, DefaultTestEngineConfig())
+	path := WriteTestWAV(t, engine.SampleRate, 4.0, 440)
+	cleanup()
+
+	// A new rate every block: ramping between the ends of the range, where the
+	// playhead must keep moving forward, then jumping across it at random.
+	// Starting at the slowest rate sends the first grains' searches furthest
+	// back; make test-headless-asan checks they stay within what is held.
+	ramp := func(block int) float32 {
+		step := block % 40
+		return 0.25 + 0.05*float32(min(step, 40-step))
+	}
+	random := rand.New(rand.NewSource(1))
+	worst := time.Duration(0)
+	previous := -1.0
+	samples := BounceTestChannel(t, path, 2.0, BounceHooks{Before: func(channel *Channel, block int) {
+		rate := ramp(block)
+		if block >= 80 {
+			rate = 0.25 + float32(random.Intn(21))*0.05
+		}
+		if err := channel.SetPlaybackRate(rate); err != nil {
+			t.Fatalf("SetPlaybackRate(%.2f) failed: %v", rate, err)
+		}
+		latency, err := channel.RateLatency()
+		if err != nil {
+			t.Fatalf("RateLatency failed: %v", err)
+		}
+		worst = max(worst, latency)
+		if block >= 80 {
+			return
+		}
+		playhead, err := channel.Playhead()
+		if err != nil {
+			t.Fatalf("Playhead failed: %v", err)
+		}
+		if playhead.Position < previous {
+			t.Fatalf("Block %d: playhead went back from %.5fs to %.5fs", block, previous, playhead.Position)
+		}
+		previous = playhead.Position
+	}}).Samples
+	if worst <= 0 || worst >= 50*time.Millisecond {
+		t.Fatalf("Expected the stretch to hold back under 50 ms, got %v", worst)
+	}
+	t.Logf("✅ Rate changed every block: at most %v held back over %d frames", worst, len(samples))
+}
+
+func TestTimeStretchValidation(t *testing.T) {
+	engine, cleanup := CreateTestEngine(t, DefaultTestEngineConfig())
+	defer cleanup()
+	channel, err := engine.CreatePlaybackChannel(WriteTestWAV(t, engine.SampleRate, 1.0, 440))
+	if err != nil {
+		t.Fatalf("CreatePlaybackChannel failed: %v", err)
+	}
+	if latency, err := channel.RateLatency(); err != nil || latency != 0 {
+		t.Errorf("Expected no latency before rendering, got %v, %v", latency, err)
+	}
+	for _, rate := range []float32{0.2, 1.3} {
+		if err := channel.SetPlaybackRate(rate); err == nil {
+			t.Errorf("Expected an error for rate %.2f", rate)
+		}
+	}
+
+	sampler, err := engine.CreateSamplerChannel()
+	if err != nil {
+		t.Fatalf("CreateSamplerChannel failed: %v", err)
+	}
+	if _, err := sampler.RateLatency(); err == nil {
+		t.Error("Expected an error for the rate latency of a sampler channel")
+	}
+	t.Log("✅ RateLatency and SetPlaybackRate validate the channel and rate")
+}
+
+func BenchmarkTimeStretch(b *testing.B) {
+	// A full mixer of stems at each rate; %core/voice is the share of one core
+	// each voice takes through player -> stretch -> pitch shift -> mixer, and
+	// latency_ms the most the stretch held back
+	const voices = 8
+	for _, rate := range []float32{0.5, 0.75, 1.0, 1.25} {
+		b.Run(fmt.Sprintf("rate-%.2f", rate), func(b *testing.B) {
+			engine, cleanup := CreateTestEngine(b, DefaultTestEngineConfig())
+			defer cleanup()
+			path := WriteTestWAV(b, engine.SampleRate, 12.0, 440)
+			var channels []*Channel
+			for i := 0; i < voices; i++ {
+				channel, err := engine.CreatePlaybackChannel(path)
+				if err != nil {
+					b.Fatalf("CreatePlaybackChannel failed: %v", err)
+				}
+				if err := channel.SetPlaybackRate(rate); err != nil {
+					b.Fatalf("SetPlaybackRate failed: %v", err)
+				}
+				channels = append(channels, channel)
+			}
+
+			worst := time.Duration(0)
+			opts := &OfflineRenderOptions{BeforeBlock: func(int64) {
+				if latency, err := channels[0].RateLatency(); err == nil {
+					worst = max(worst, latency)
+				}
+			}}
+			b.ResetTimer()
+			var factor float64
+			for i := 0; i < b.N; i++ {
+				stats, err := engine.RenderOffline(8*time.Second, io.Discard, opts)
+				if err != nil {
+					b.Fatalf("RenderOffline failed: %v", err)
+				}
+				factor = stats.RealtimeFactor
+			}
+			b.ReportMetric(100/factor/voices, "%core/voice")
+			b.ReportMetric(float64(worst)/float64(time.Millisecond), "latency_ms")
+		})
+	}
+}
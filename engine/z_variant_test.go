@@ -0,0 +1,192 @@
+//go:build !darwin || !cgo
+
+package engine
+
+import (
+	"math"
+	"testing"
+	"time"
+)
+
+// Variants are rendered and switched to by the headless backend only; the
+// macOS backend refuses them (see z_macos_test.go)
+
+// waitVariants polls until the channel's variants request has finished
+func waitVariants(t *testing.T, channel *Channel) VariantsStatus {
+	t.Helper()
+	deadline := time.Now().Add(30 * time.Second)
+	for {
+		status, err := channel.VariantsStatus()
+		if err != nil {
+			t.Fatalf("VariantsStatus failed: %v", err)
+		}
+		if status.Pending == 0 {
+			return status
+		}
+		if time.Now().After(deadline) {
+			t.Fatalf("Variants still pending: %+v", status)
+		}
+		time.Sleep(10 * time.Millisecond)
+	}
+}
+
+func TestVariantSwitch(t *testing.T) {
+	engine, cleanup := CreateTestEngine(t, DefaultTestEngineConfig())
+	sampleRate, blockSize := engine.SampleRate, engine.BufferSize
+	cleanup()
+	path := writeTestPCM(t, "float", sampleRate, 3*sampleRate)
+	before, err := GetVariantCacheStats()
+	if err != nil {
+		t.Fatalf("GetVariantCacheStats failed: %v", err)
+	}
+
+	// Slower and a tone up are rendered ahead; a rate change then plays the
+	// variant with both units routed around, another switches variants, and a
+	// setting nobody prepared runs the units live again
+	fade := int(math.Ceil(VariantCrossfade*float64(sampleRate)))/blockSize + 2
+	setup := func(channel *Channel) {
+		if err := channel.PrepareVariants([]Variant{{Rate: 0.75}, {Rate: 1, Pitch: 2}, {Rate: 1}}, 0); err != nil {
+			t.Fatalf("PrepareVariants failed: %v", err)
+		}
+		if status := waitVariants(t, channel); status.Requested != 2 || status.Ready != 2 || status.Failed != 0 {
+			t.Fatalf("Expected both variants ready (unity skipped), got %+v", status)
+		}
+	}
+	check := func(channel *Channel, block int, active bool, rate float64) {
+		status, err := channel.VariantsStatus()
+		if err != nil {
+			t.Fatalf("VariantsStatus failed: %v", err)
+		}
+		elision, err := channel.Elision()
+		if err != nil {
+			t.Fatalf("Elision failed: %v", err)
+		}
+		playhead, err := channel.Playhead()
+		if err != nil {
+			t.Fatalf("Playhead failed: %v", err)
+		}
+		if status.Active != active || (active && !(elision.TimeStretch && elision.PitchShift)) {
+			t.Fatalf("Block %d: expected active=%v with the units routed around, got %+v and %+v", block, active, status, elision)
+		}
+		if math.Abs(playhead.Rate-rate) > 1e-6 {
+			t.Fatalf("Block %d: expected the playhead at rate %.2f, got %.6f", block, rate, playhead.Rate)
+		}
+	}
+	samples := BounceTestChannel(t, path, 2.0, BounceHooks{Setup: setup, Before: func(channel *Channel, block int) {
+		switch block {
+		case 20:
+			if err := channel.SetPlaybackRate(0.75); err != nil {
+				t.Fatalf("SetPlaybackRate failed: %v", err)
+			}
+		case 20 + fade:
+			check(channel, block, true, 0.75)
+			if err := channel.SetPlaybackRate(1); err != nil {
+				t.Fatalf("SetPlaybackRate failed: %v", err)
+			}
+			if err := channel.SetPitch(2); err != nil {
+				t.Fatalf("SetPitch failed: %v", err)
+			}
+		case 20 + 2*fade:
+			check(channel, block, true, 1)
+			if err := channel.SetPitch(3); err != nil {
+				t.Fatalf("SetPitch failed: %v", err)
+			}
+		case 20 + 3*fade:
+			check(channel, block, false, 1)
+			if pitch, err := channel.GetPitch(); err != nil || pitch != 3 {
+				t.Fatalf("Expected the pitch as set, got %v (%v)", pitch, err)
+			}
+		}
+	}}).Samples
+
+	// The crossfades keep the 440 Hz tone continuous through every switch
+	largest, at := 0.0, 0
+	for k := 1; k < len(samples); k++ {
+		if jump := math.Abs(float64(samples[k] - samples[k-1])); jump > largest {
+			largest, at = jump, k
+		}
+	}
+	if largest > 0.1 {
+		t.Fatalf("Frame %d: expected no discontinuity, got a jump of %.4f", at, largest)
+	}
+	after, err := GetVariantCacheStats()
+	if err != nil {
+		t.Fatalf("GetVariantCacheStats failed: %v", err)
+	}
+	if after.Renders-before.Renders != 2 || after.Hits-before.Hits < 2 {
+		t.Fatalf("Expected two renders and hits on switching, got %+v after %+v", after, before)
+	}
+	t.Logf("✅ Switched to and between variants with at most %.4f between frames", largest)
+}
+
+func TestVariantCacheBudgets(t *testing.T) {
+	engine, cleanup := CreateTestEngine(t, DefaultTestEngineConfig())
+	defer cleanup()
+	defer SetVariantCache(VariantCacheOptions{BudgetBytes: DefaultVariantCacheBudget})
+	path := WriteTestWAV(t, engine.SampleRate, 1.0, 440)
+	channel, err := engine.CreatePlaybackChannel(path)
+	if err != nil {
+		t.Fatalf("CreatePlaybackChannel failed: %v", err)
+	}
+	directory := t.TempDir()
+	stats := func() VariantCacheStats {
+		stats, err := GetVariantCacheStats()
+		if err != nil {
+			t.Fatalf("GetVariantCacheStats failed: %v", err)
+		}
+		return stats
+	}
+	configure := func(options VariantCacheOptions) {
+		if err := SetVariantCache(options); err != nil {
+			t.Fatalf("SetVariantCache(%+v) failed: %v", options, err)
+		}
+	}
+	prepare := func(variants ...Variant) VariantsStatus {
+		if err := channel.PrepareVariants(variants, 2); err != nil {
+			t.Fatalf("PrepareVariants failed: %v", err)
+		}
+		return waitVariants(t, channel)
+	}
+	if err := SetVariantCache(VariantCacheOptions{BudgetBytes: 1, Directory: directory}); err == nil {
+		t.Fatal("Expected a directory without a disk budget to be rejected")
+	}
+
+	// A render is written to the directory; with memory emptied it is read
+	// back from there instead of rendered again
+	configure(VariantCacheOptions{BudgetBytes: DefaultVariantCacheBudget, Directory: directory, DiskBudgetBytes: 64 << 20})
+	start := stats()
+	if status := prepare(Variant{Rate: 0.5}); status.Ready != 1 {
+		t.Fatalf("Expected the variant ready, got %+v", status)
+	}
+	rendered := stats()
+	if rendered.Renders-start.Renders != 1 || rendered.DiskEntries != 1 || rendered.DiskBytes <= 0 {
+		t.Fatalf("Expected one render stored on disk, got %+v", rendered)
+	}
+	configure(VariantCacheOptions{BudgetBytes: 0, Directory: directory, DiskBudgetBytes: 64 << 20})
+	if emptied := stats(); emptied.Entries != emptied.InUse || emptied.Evictions <= rendered.Evictions {
+		t.Fatalf("Expected unused variants evicted from memory, got %+v", emptied)
+	}
+	configure(VariantCacheOptions{BudgetBytes: DefaultVariantCacheBudget, Directory: directory, DiskBudgetBytes: 64 << 20})
+	if status := prepare(Variant{Rate: 0.5}); status.Ready != 1 {
+		t.Fatalf("Expected the variant ready again, got %+v", status)
+	}
+	if reread := stats(); reread.DiskHits-rendered.DiskHits != 1 || reread.Renders != rendered.Renders {
+		t.Fatalf("Expected the variant read back from disk, got %+v", reread)
+	}
+
+	// A memory budget of one half-speed variant of the mono file keeps one of
+	// two, and a disk budget smaller than any entry empties the directory
+	bytes := int64(4 * 2 * engine.SampleRate) // Frames at half speed, 4 bytes each
+	configure(VariantCacheOptions{BudgetBytes: bytes, Directory: directory, DiskBudgetBytes: 64 << 20})
+	if status := prepare(Variant{Rate: 0.5}, Variant{Rate: 1, Pitch: -5}); status.Ready != 1 || status.Failed != 0 {
+		t.Fatalf("Expected one of two variants within budget, got %+v", status)
+	}
+	if trimmed := stats(); trimmed.Bytes > bytes {
+		t.Fatalf("Expected the memory budget kept, got %+v", trimmed)
+	}
+	configure(VariantCacheOptions{BudgetBytes: bytes, Directory: directory, DiskBudgetBytes: 1})
+	if emptied := stats(); emptied.DiskEntries != 0 || emptied.DiskBytes != 0 {
+		t.Fatalf("Expected the directory emptied, got %+v", emptied)
+	}
+	t.Logf("✅ Variants stored, evicted and read back within their budgets")
+}
@@ -0,0 +1,531 @@
+// Persistent analysis cache shared by both player backends.
+//
+// Entries are content addressed: "<dir>/<sha256 of the file>.cache" holds an
+// AnalysisRecord (format, duration, whole-file RMS and loudness) followed by
+// level 0 of the waveform pyramid when it has been built. Identical files
+// share one entry wherever they live. Hashing a file costs a full read, so
+// "<dir>/paths/<sha256 of the path>" remembers which hash a path had at a given
+// size and modification time; any change to either forces a rehash, and a
+// changed file simply maps to a different entry.
+//
+// Entries are written to a temporary file and renamed, so concurrent readers
+// and other processes never see a partial entry. Every hit touches the entry's
+// mtime; analysis_cache_evict drops the least recently used entries until the
+// directory is under its size cap. Records are native byte order, like the
+// .peaks sidecar.
+//
+// Header-only like peaks.h. The functions take the cache directory and do no
+// locking of their own; the backends keep the open directory and counters.
+
+#ifndef MACAUDIO_ANALYSISCACHE_H
+#define MACAUDIO_ANALYSISCACHE_H
+
+#include <dirent.h>
+#include <errno.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <sys/time.h>
+#include <unistd.h>
+
+#include "macaudio.h"
+#include "peaks.h"
+
+#define ANALYSIS_CACHE_MAGIC "MACACHE2"
+#define ANALYSIS_ALIAS_MAGIC "MAALIAS1"
+#define ANALYSIS_CACHE_HASH_LENGTH 65  // SHA-256 in hex plus NUL
+
+// AnalysisRecord.items
+#define ANALYSIS_CACHE_FORMAT 1u
+#define ANALYSIS_CACHE_RMS 2u
+#define ANALYSIS_CACHE_LOUDNESS 4u
+#define ANALYSIS_CACHE_PEAKS 8u
+
+typedef struct {
+    char magic[8];
+    uint32_t items;          // ANALYSIS_CACHE_* present
+    int32_t channelCount;
+    double sampleRate;
+    int64_t frames;
+    char format[256];        // Human readable file format
+    double rms;              // Whole file, average of the channels' RMS
+    float peak;              // Whole file, absolute sample peak of any channel (with rms)
+    LoudnessMetrics loudness;  // Whole file
+    int64_t peakEntries;     // Level-0 PeakEntry rows (channelCount each) following the record
+} AnalysisRecord;
+
+typedef struct {
+    char magic[8];
+    int64_t sourceSize;
+    int64_t sourceModified;  // Nanoseconds
+    char hash[ANALYSIS_CACHE_HASH_LENGTH];
+} AnalysisAlias;
+
+// ----------------------------------------------------------------------------
+// SHA-256 (FIPS 180-4)
+// ----------------------------------------------------------------------------
+
+typedef struct {
+    uint32_t state[8];
+    uint64_t length;
+    uint8_t block[64];
+    size_t used;
+} CacheSha256;
+
+static inline uint32_t cache_sha256_rotr(uint32_t x, int n) {
+    return (x >> n) | (x << (32 - n));
+}
+
+static inline void cache_sha256_block(CacheSha256* sha, const uint8_t* block) {
+    static const uint32_t k[64] = {
+        0x428a2f98, 0x71374491, 0xb5c0fbcf, 0xe9b5dba5, 0x3956c25b, 0x59f111f1, 0x923f82a4, 0xab1c5ed5,
+        0xd807aa98, 0x12835b01, 0x243185be, 0x550c7dc3, 0x72be5d74, 0x80deb1fe, 0x9bdc06a7, 0xc19bf174,
+        0xe49b69c1, 0xefbe4786, 0x0fc19dc6, 0x240ca1cc, 0x2de92c6f, 0x4a7484aa, 0x5cb0a9dc, 0x76f988da,
+        0x983e5152, 0xa831c66d, 0xb00327c8, 0xbf597fc7, 0xc6e00bf3, 0xd5a79147, 0x06ca6351, 0x14292967,
+        0x27b70a85, 0x2e1b2138, 0x4d2c6dfc, 0x53380d13, 0x650a7354, 0x766a0abb, 0x81c2c92e, 0x92722c85,
+        0xa2bfe8a1, 0xa81a664b, 0xc24b8b70, 0xc76c51a3, 0xd192e819, 0xd6990624, 0xf40e3585, 0x106aa070,
+        0x19a4c116, 0x1e376c08, 0x2748774c, 0x34b0bcb5, 0x391c0cb3, 0x4ed8aa4a, 0x5b9cca4f, 0x682e6ff3,
+        0x748f82ee, 0x78a5636f, 0x84c87814, 0x8cc70208, 0x90befffa, 0xa4506ceb, 0xbef9a3f7, 0xc67178f2};
+    uint32_t w[64];
+    for (int i = 0; i < 16; i++) {
+        w[i] = (uint32_t)block[4 * i] << 24 | (uint32_t)block[4 * i + 1] << 16 | (uint32_t)block[4 * i + 2] << 8 |
+               (uint32_t)block[4 * i + 3];
+    }
+    for (int i = 16; i < 64; i++) {
+        const uint32_t s0 = cache_sha256_rotr(w[i - 15], 7) ^ cache_sha256_rotr(w[i - 15], 18) ^ (w[i - 15] >> 3);
+        const uint32_t s1 = cache_sha256_rotr(w[i - 2], 17) ^ cache_sha256_rotr(w[i - 2], 19) ^ (w[i - 2] >> 10);
+        w[i] = w[i - 16] + s0 + w[i - 7] + s1;
+    }
+    uint32_t a = sha->state[0], b = sha->state[1], c = sha->state[2], d = sha->state[3];
+    uint32_t e = sha->state[4], f = sha->state[5], g = sha->state[6], h = sha->state[7];
+    for (int i = 0; i < 64; i++) {
+        const uint32_t s1 = cache_sha256_rotr(e, 6) ^ cache_sha256_rotr(e, 11) ^ cache_sha256_rotr(e, 25);
+        const uint32_t t1 = h + s1 + ((e & f) ^ (~e & g)) + k[i] + w[i];
+        const uint32_t s0 = cache_sha256_rotr(a, 2) ^ cache_sha256_rotr(a, 13) ^ cache_sha256_rotr(a, 22);
+        const uint32_t t2 = s0 + ((a & b) ^ (a & c) ^ (b & c));
+        h = g;
+        g = f;
+        f = e;
+        e = d + t1;
+        d = c;
+        c = b;
+        b = a;
+        a = t1 + t2;
+    }
+    sha->state[0] += a;
+    sha->state[1] += b;
+    sha->state[2] += c;
+    sha->state[3] += d;
+    sha->state[4] += e;
+    sha->state[5] += f;
+    sha->state[6] += g;
+    sha->state[7] += h;
+}
+
+static inline void cache_sha256_init(CacheSha256* sha) {
+    static const uint32_t initial[8] = {0x6a09e667, 0xbb67ae85, 0x3c6ef372, 0xa54ff53a,
+                                        0x510e527f, 0x9b05688c, 0x1f83d9ab, 0x5be0cd19};
+    memcpy(sha->state, initial, sizeof(initial));
+    sha->length = 0;
+    sha->used = 0;
+}
+
+static inline void cache_sha256_update(CacheSha256* sha, const void* data, size_t size) {
+    const uint8_t* bytes = (const uint8_t*)data;
+    sha->length += size;
+    if (sha->used > 0) {
+        const size_t n = size < 64 - sha->used ? size : 64 - sha->used;
+        memcpy(sha->block + sha->used, bytes, n);
+        sha->used += n;
+        bytes += n;
+        size -= n;
+        if (sha->used < 64) {
+            return;
+        }
+        cache_sha256_block(sha, sha->block);
+        sha->used = 0;
+    }
+    for (; size >= 64; bytes += 64, size -= 64) {
+        cache_sha256_block(sha, bytes);
+    }
+    memcpy(sha->block, bytes, size);
+    sha->used = size;
+}
+
+// Finish and write the digest as 64 lowercase hex digits plus NUL
+static inline void cache_sha256_hex(CacheSha256* sha, char hex[ANALYSIS_CACHE_HASH_LENGTH]) {
+    const uint64_t bits = sha->length * 8;
+    const uint8_t pad = 0x80;
+    const uint8_t zero[64] = {0};
+    cache_sha256_update(sha, &pad, 1);
+    cache_sha256_update(sha, zero, (sha->used <= 56 ? 56 : 120) - sha->used);
+    uint8_t length[8];
+    for (int i = 0; i < 8; i++) {
+        length[i] = (uint8_t)(bits >> (56 - 8 * i));
+    }
+    cache_sha256_update(sha, length, 8);
+    for (int i = 0; i < 32; i++) {
+        snprintf(hex + 2 * i, 3, "%02x", (sha->state[i / 4] >> (24 - 8 * (i % 4))) & 0xff);
+    }
+}
+
+// ----------------------------------------------------------------------------
+// Entries
+// ----------------------------------------------------------------------------
+
+static inline int64_t analysis_cache_mtime_ns(const struct stat* info) {
+#ifdef __APPLE__
+    return (int64_t)info->st_mtimespec.tv_sec * 1000000000 + info->st_mtimespec.tv_nsec;
+#else
+    return (int64_t)info->st_mtim.tv_sec * 1000000000 + info->st_mtim.tv_nsec;
+#endif
+}
+
+// malloc'd "<directory>/<name><suffix>"
+static inline char* analysis_cache_path(const char* directory, const char* name, const char* suffix) {
+    const size_t length = strlen(directory) + strlen(name) + strlen(suffix) + 2;
+    char* path = (char*)malloc(length);
+    if (path) {
+        snprintf(path, length, "%s/%s%s", directory, name, suffix);
+    }
+    return path;
+}
+
+// Create the directory and its paths/ subdirectory. Returns 0 on failure.
+static inline int analysis_cache_prepare(const char* directory) {
+    if (mkdir(directory, 0755) != 0 && errno != EEXIST) {
+        return 0;
+    }
+    char* aliases = analysis_cache_path(directory, "paths", "");
+    const int ok = aliases && (mkdir(aliases, 0755) == 0 || errno == EEXIST);
+    free(aliases);
+    return ok;
+}
+
+static inline int analysis_cache_hash_file(const char* path, char hex[ANALYSIS_CACHE_HASH_LENGTH]) {
+    FILE* file = fopen(path, "rb");
+    if (!file) {
+        return 0;
+    }
+    const size_t chunkSize = 1 << 16;
+    uint8_t* chunk = (uint8_t*)malloc(chunkSize);
+    if (!chunk) {
+        fclose(file);
+        return 0;
+    }
+    CacheSha256 sha;
+    cache_sha256_init(&sha);
+    size_t n;
+    while ((n = fread(chunk, 1, chunkSize, file)) > 0) {
+        cache_sha256_update(&sha, chunk, n);
+    }
+    const int ok = !ferror(file);
+    fclose(file);
+    free(chunk);
+    if (ok) {
+        cache_sha256_hex(&sha, hex);
+    }
+    return ok;
+}
+
+// Write `size` bytes from `data` (then, if `tail` is set, the rest of `tail`)
+// to `path` through a unique temporary file. Returns 0 on failure.
+static inline int analysis_cache_replace(const char* path, const void* data, size_t size, const void* more,
+                                         size_t moreSize, FILE* tail) {
+    const size_t length = strlen(path) + 8;
+    char* temporary = (char*)malloc(length);
+    if (!temporary) {
+        return 0;
+    }
+    snprintf(temporary, length, "%s.XXXXXX", path);
+    const int fd = mkstemp(temporary);
+    FILE* file = fd >= 0 ? fdopen(fd, "wb") : NULL;
+    if (!file) {
+        if (fd >= 0) {
+            close(fd);
+            remove(temporary);
+        }
+        free(temporary);
+        return 0;
+    }
+    int ok = fwrite(data, 1, size, file) == size && (moreSize == 0 || fwrite(more, 1, moreSize, file) == moreSize);
+    if (ok && tail) {
+        char chunk[1 << 14];
+        size_t n;
+        while (ok && (n = fread(chunk, 1, sizeof(chunk), tail)) > 0) {
+            ok = fwrite(chunk, 1, n, file) == n;
+        }
+        ok = ok && !ferror(tail);
+    }
+    ok = fclose(file) == 0 && ok;
+    ok = ok && chmod(temporary, 0644) == 0 && rename(temporary, path) == 0;
+    if (!ok) {
+        remove(temporary);
+    }
+    free(temporary);
+    return ok;
+}
+
+// Content hash of `sourcePath`, from its alias while the file's size and mtime
+// are unchanged. Without allowHash a stale or missing alias is a miss;
+// otherwise the file is hashed and the alias rewritten. Returns 0 on a miss.
+static inline int analysis_cache_key(const char* directory, const char* sourcePath, int allowHash,
+                                     char hash[ANALYSIS_CACHE_HASH_LENGTH]) {
+    struct stat info;
+    if (stat(sourcePath, &info) != 0) {
+        return 0;
+    }
+    char pathHash[ANALYSIS_CACHE_HASH_LENGTH];
+    char* resolved = realpath(sourcePath, NULL);
+    const char* aliasName = resolved ? resolved : sourcePath;
+    CacheSha256 sha;
+    cache_sha256_init(&sha);
+    cache_sha256_update(&sha, aliasName, strlen(aliasName));
+    cache_sha256_hex(&sha, pathHash);
+    free(resolved);
+    char* aliasPath = analysis_cache_path(directory, "paths/", pathHash);
+    if (!aliasPath) {
+        return 0;
+    }
+
+    AnalysisAlias alias;
+    FILE* file = fopen(aliasPath, "rb");
+    int found = file && fread(&alias, sizeof(alias), 1, file) == 1 &&
+                memcmp(alias.magic, ANALYSIS_ALIAS_MAGIC, 8) == 0 && alias.sourceSize == (int64_t)info.st_size &&
+                alias.sourceModified == analysis_cache_mtime_ns(&info) &&
+                alias.hash[ANALYSIS_CACHE_HASH_LENGTH - 1] == '\0';
+    if (file) {
+        fclose(file);
+    }
+    if (!found && allowHash && analysis_cache_hash_file(sourcePath, alias.hash)) {
+        struct stat after;
+        // A file modified while it was hashed keeps no alias
+        if (stat(sourcePath, &after) == 0 && after.st_size == info.st_size &&
+            analysis_cache_mtime_ns(&after) == analysis_cache_mtime_ns(&info)) {
+            memcpy(alias.magic, ANALYSIS_ALIAS_MAGIC, 8);
+            alias.sourceSize = (int64_t)info.st_size;
+            alias.sourceModified = analysis_cache_mtime_ns(&info);
+            analysis_cache_replace(aliasPath, &alias, sizeof(alias), NULL, 0, NULL);
+            found = 1;
+        }
+    }
+    free(aliasPath);
+    if (found) {
+        memcpy(hash, alias.hash, ANALYSIS_CACHE_HASH_LENGTH);
+    }
+    return found;
+}
+
+static inline FILE* analysis_cache_open_entry(const char* directory, const char* hash, AnalysisRecord* record,
+                                              int touch) {
+    char* path = analysis_cache_path(directory, hash, ".cache");
+    if (!path) {
+        return NULL;
+    }
+    FILE* file = fopen(path, "rb");
+    if (file && (fread(record, sizeof(*record), 1, file) != 1 || memcmp(record->magic, ANALYSIS_CACHE_MAGIC, 8) != 0 ||
+                 record->channelCount <= 0 || record->format[sizeof(record->format) - 1] != '\0')) {
+        fclose(file);
+        file = NULL;
+    }
+    if (file && touch) {
+        utimes(path, NULL);  // Most recently used
+    }
+    free(path);
+    return file;
+}
+
+// Read the record of `hash`. Returns 0 if there is none.
+static inline int analysis_cache_read(const char* directory, const char* hash, AnalysisRecord* record) {
+    FILE* file = analysis_cache_open_entry(directory, hash, record, 1);
+    if (!file) {
+        memset(record, 0, sizeof(*record));
+        return 0;
+    }
+    fclose(file);
+    return 1;
+}
+
+// Load the cached waveform pyramid of `hash`. Returns 0 (pyramid empty) if absent.
+static inline int analysis_cache_read_peaks(const char* directory, const char* hash, PeakPyramid* pyramid) {
+    memset(pyramid, 0, sizeof(*pyramid));
+    AnalysisRecord record;
+    FILE* file = analysis_cache_open_entry(directory, hash, &record, 1);
+    if (!file) {
+        return 0;
+    }
+    const int64_t entries = (record.frames + PEAKS_BASE_FRAMES - 1) / PEAKS_BASE_FRAMES;
+    if (!(record.items & ANALYSIS_CACHE_PEAKS) || record.peakEntries != entries ||
+        !peaks_init(pyramid, record.channelCount, record.sampleRate, record.frames)) {
+        fclose(file);
+        return 0;
+    }
+    const size_t count = (size_t)entries * record.channelCount;
+    const int ok = fread(pyramid->levels[0], sizeof(PeakEntry), count, file) == count;
+    fclose(file);
+    pyramid->levelLength[0] = entries;
+    pyramid->frames = record.frames;
+    if (!ok || !peaks_build_levels(pyramid)) {
+        peaks_free(pyramid);
+        return 0;
+    }
+    return 1;
+}
+
+// Merge the items of `update` (and the pyramid, if given) into the entry of
+// `hash`, keeping whatever else it already holds. Returns 0 on failure.
+static inline int analysis_cache_store(const char* directory, const char* hash, const AnalysisRecord* update,
+                                       const PeakPyramid* pyramid) {
+    AnalysisRecord record;
+    FILE* existing = analysis_cache_open_entry(directory, hash, &record, 0);
+    if (!existing || record.channelCount != update->channelCount || record.frames != update->frames) {
+        if (existing) {
+            fclose(existing);
+            existing = NULL;
+        }
+        memset(&record, 0, sizeof(record));
+    }
+    memcpy(record.magic, ANALYSIS_CACHE_MAGIC, 8);
+    record.items |= update->items | ANALYSIS_CACHE_FORMAT;
+    record.channelCount = update->channelCount;
+    record.sampleRate = update->sampleRate;
+    record.frames = update->frames;
+    memcpy(record.format, update->format, sizeof(record.format));
+    record.format[sizeof(record.format) - 1] = '\0';
+    if (update->items & ANALYSIS_CACHE_RMS) {
+        record.rms = update->rms;
+        record.peak = update->peak;
+    }
+    if (update->items & ANALYSIS_CACHE_LOUDNESS) {
+        record.loudness = update->loudness;
+    }
+
+    const void* peaks = NULL;
+    size_t peaksSize = 0;
+    if (pyramid && pyramid->levelCount > 0) {
+        record.items |= ANALYSIS_CACHE_PEAKS;
+        record.peakEntries = pyramid->levelLength[0];
+        peaks = pyramid->levels[0];
+        peaksSize = sizeof(PeakEntry) * (size_t)pyramid->levelLength[0] * pyramid->channelCount;
+        if (existing) {
+            fclose(existing);  // Old pyramid is replaced
+            existing = NULL;
+        }
+    }
+
+    char* path = analysis_cache_path(directory, hash, ".cache");
+    const int ok = path && analysis_cache_replace(path, &record, sizeof(record), peaks, peaksSize, existing);
+    if (existing) {
+        fclose(existing);
+    }
+    free(path);
+    return ok;
+}
+
+typedef struct {
+    char* name;
+    int64_t size;
+    int64_t used;
+} AnalysisCacheFile;
+
+static inline int analysis_cache_compare_used(const void* a, const void* b) {
+    const int64_t x = ((const AnalysisCacheFile*)a)->used;
+    const int64_t y = ((const AnalysisCacheFile*)b)->used;
+    return x < y ? -1 : x > y;
+}
+
+// Delete least recently used entries until the total is at most maxBytes
+// (maxBytes <= 0 removes every entry). Reports what remains and returns the
+// number of entries removed.
+static inline int analysis_cache_evict(const char* directory, int64_t maxBytes, int64_t* bytes, int* entries) {
+    *bytes = 0;
+    *entries = 0;
+    DIR* dir = opendir(directory);
+    if (!dir) {
+        return 0;
+    }
+    AnalysisCacheFile* files = NULL;
+    int count = 0, capacity = 0;
+    struct dirent* item;
+    while ((item = readdir(dir)) != NULL) {
+        const size_t length = strlen(item->d_name);
+        if (length != ANALYSIS_CACHE_HASH_LENGTH - 1 + 6 || strcmp(item->d_name + length - 6, ".cache") != 0) {
+            continue;
+        }
+        char* path = analysis_cache_path(directory, item->d_name, "");
+        struct stat info;
+        if (path && stat(path, &info) == 0) {
+            if (count == capacity) {
+                capacity = capacity ? capacity * 2 : 64;
+                AnalysisCacheFile* grown = (AnalysisCacheFile*)realloc(files, sizeof(*files) * (size_t)capacity);
+                if (!grown) {
+                    free(path);
+                    break;
+                }
+                files = grown;
+            }
+            files[count].name = path;
+            files[count].size = (int64_t)info.st_size;
+            files[count].used = analysis_cache_mtime_ns(&info);
+            *bytes += files[count].size;
+            count++;
+        } else {
+            free(path);
+        }
+    }
+    closedir(dir);
+
+    int evicted = 0;
+    if (*bytes > maxBytes && count > 0) {
+        qsort(files, (size_t)count, sizeof(*files), analysis_cache_compare_used);
+    }
+    for (int i = 0; i < count; i++) {
+        if (*bytes > maxBytes && remove(files[i].name) == 0) {
+            *bytes -= files[i].size;
+            evicted++;
+        } else {
+            (*entries)++;
+        }
+        free(files[i].name);
+    }
+    free(files);
+    return evicted;
+}
+
+// Remove aliases whose entry has been evicted
+static inline void analysis_cache_prune_aliases(const char* directory) {
+    char* aliases = analysis_cache_path(directory, "paths", "");
+    DIR* dir = aliases ? opendir(aliases) : NULL;
+    if (!dir) {
+        free(aliases);
+        return;
+    }
+    struct dirent* item;
+    while ((item = readdir(dir)) != NULL) {
+        if (item->d_name[0] == '.') {
+            continue;
+        }
+        char* aliasPath = analysis_cache_path(aliases, item->d_name, "");
+        AnalysisAlias alias;
+        FILE* file = aliasPath ? fopen(aliasPath, "rb") : NULL;
+        int keep = 0;
+        if (file) {
+            if (fread(&alias, sizeof(alias), 1, file) == 1 && alias.hash[ANALYSIS_CACHE_HASH_LENGTH - 1] == '\0') {
+                char* entry = analysis_cache_path(directory, alias.hash, ".cache");
+                keep = entry && access(entry, F_OK) == 0;
+                free(entry);
+            }
+            fclose(file);
+        }
+        if (aliasPath && !keep) {
+            remove(aliasPath);
+        }
+        free(aliasPath);
+    }
+    closedir(dir);
+    free(aliases);
+}
+
+#endif  // MACAUDIO_ANALYSISCACHE_H
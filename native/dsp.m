@@ -0,0 +1,117 @@
+#include <stdlib.h>
+#import "macaudio.h"
+#import "pitchshift.h"
+#import "resampler.h"
+
+// Standalone DSP objects behind the C ABI. None of them touch AVFoundation or
+// the engine graph: each is owned by its caller and works on planar float
+// buffers, on whatever thread the caller runs it.
+
+// Create a streaming sample-rate converter
+const char* resampler_create(double inputRate, double outputRate, int channelCount, int quality, Resampler** resampler,
+                             ResamplerInfo* info) {
+    if (!resampler || !info) {
+        return "Result pointer is null";
+    }
+
+    Resampler* created = malloc(sizeof(Resampler));
+    if (!created) {
+        return "Failed to allocate resampler";
+    }
+    const char* error = resampler_init(created, inputRate, outputRate, channelCount, quality);
+    if (error) {
+        free(created);
+        return error;
+    }
+    info->taps = created->taps;
+    info->phases = created->rows;
+    info->interpolated = created->interpolated;
+    info->kernel = resampler_kernel_label(created->kernel);
+    *resampler = created;
+    return NULL; // Success
+}
+
+// Convert planar input until it is used up or the output is full
+void resampler_process(Resampler* resampler, const float* input, int inputFrames, float* output, int outputCapacity,
+                       int* consumed, int* produced) {
+    int taken = 0, written = 0;
+    if (resampler && input && output && inputFrames >= 0 && outputCapacity >= 0) {
+        written = resampler_push(resampler, input, inputFrames, inputFrames, output, outputCapacity, outputCapacity,
+                                 &taken);
+    }
+    if (consumed) {
+        *consumed = taken;
+    }
+    if (produced) {
+        *produced = written;
+    }
+}
+
+// Flush the frames still in the filter after the last input
+void resampler_drain(Resampler* resampler, float* output, int outputCapacity, int* produced) {
+    int written = 0;
+    if (resampler && output && outputCapacity >= 0) {
+        written = resampler_finish(resampler, output, outputCapacity, outputCapacity);
+    }
+    if (produced) {
+        *produced = written;
+    }
+}
+
+void resampler_reset(Resampler* resampler) {
+    if (resampler) {
+        resampler_clear(resampler);
+    }
+}
+
+void resampler_destroy(Resampler* resampler) {
+    if (resampler) {
+        resampler_free(resampler);
+        free(resampler);
+    }
+}
+
+// Create a standalone phase vocoder pitch shifter
+const char* pitchshift_create(double sampleRate, int channelCount, const PitchShiftOptions* options,
+                              PitchShifter** shifter, PitchShiftInfo* info) {
+    if (!options || !shifter || !info) {
+        return "Options or result pointer is null";
+    }
+
+    PitchShifter* created = malloc(sizeof(PitchShifter));
+    if (!created) {
+        return "Failed to allocate pitch shifter";
+    }
+    const char* error = pitchshift_init(created, sampleRate, channelCount, options->quality, options->fftSize);
+    if (error) {
+        free(created);
+        return error;
+    }
+    created->preserveFormants = options->preserveFormants;
+    info->fftSize = created->fftSize;
+    info->hop = created->hop;
+    info->latency = created->fftSize;
+    info->kernel = resampler_kernel_label(created->kernel);
+    *shifter = created;
+    return NULL; // Success
+}
+
+// Shift planar input by `cents` into output, latency frames later
+void pitchshift_process(PitchShifter* shifter, const float* input, float* output, int frames, float cents) {
+    if (shifter && input && output && frames > 0) {
+        pitchshift_run(shifter, input, frames, output, frames, frames, cents, shifter->preserveFormants);
+    }
+}
+
+void pitchshift_reset(PitchShifter* shifter) {
+    if (shifter) {
+        pitchshift_clear(shifter);
+    }
+}
+
+void pitchshift_destroy(PitchShifter* shifter) {
+    if (shifter) {
+        pitchshift_free(shifter);
+        free(shifter);
+    }
+}
@@ -1,4 +1,5 @@
 #import <AVFoundation/AVFoundation.h>
+#import <objc/runtime.h>
 
 #ifdef __cplusplus
 extern "C" {
@@ -40,6 +41,9 @@ void audioengine_release_format(void* formatPtr);
 const char* audioengine_set_buffer_size(AudioEngine* wrapper, int bufferSize);
 const char* audioengine_set_mixer_volume(AudioEngine* wrapper, void* mixerNodePtr, float volume);
 float audioengine_get_mixer_volume(AudioEngine* wrapper, void* mixerNodePtr);
+const char* audioengine_enable_manual_rendering(AudioEngine* wrapper, double sampleRate, int channelCount, int maxFrames);
+const char* audioengine_disable_manual_rendering(AudioEngine* wrapper);
+const char* audioengine_render_offline(AudioEngine* wrapper, float* buffer, int frames, bool interleaved);
 
 // Create new AVAudioEngine
 AudioEngineResult audioengine_new() {
@@ -710,6 +714,134 @@ const char* audioengine_set_buffer_size(AudioEngine* wrapper, int bufferSize) {
     }
 }
 
+// Render buffer for manual rendering, kept on the engine so offline renders don't allocate per block
+static char kManualRenderBufferKey;
+
+// Switch the engine to offline manual rendering (engine must be stopped)
+const char* audioengine_enable_manual_rendering(AudioEngine* wrapper, double sampleRate, int channelCount, int maxFrames) {
+    @autoreleasepool {
+        if (!wrapper) {
+            return "Engine wrapper is null";
+        }
+        
+        if (!wrapper->engine) {
+            return "Engine is null";
+        }
+        
+        if (maxFrames <= 0) {
+            return "Maximum frame count must be positive";
+        }
+        
+        AVAudioEngine* engine = (__bridge AVAudioEngine*)wrapper->engine;
+        AVAudioFormat* format = [[AVAudioFormat alloc] initStandardFormatWithSampleRate:sampleRate channels:(AVAudioChannelCount)channelCount];
+        if (!format) {
+            return "Invalid manual rendering format";
+        }
+        
+        NSError* error = nil;
+        @try {
+            if (![engine enableManualRenderingMode:AVAudioEngineManualRenderingModeOffline
+                                            format:format
+                                 maximumFrameCount:(AVAudioFrameCount)maxFrames
+                                             error:&error]) {
+                return [[NSString stringWithFormat:@"Manual rendering exception: %@", error.localizedDescription] UTF8String];
+            }
+        }
+        @catch (NSException* exception) {
+            return [[NSString stringWithFormat:@"Manual rendering exception: %@", exception.reason] UTF8String];
+        }
+        
+        AVAudioPCMBuffer* buffer = [[AVAudioPCMBuffer alloc] initWithPCMFormat:engine.manualRenderingFormat
+                                                                frameCapacity:engine.manualRenderingMaximumFrameCount];
+        if (!buffer) {
+            [engine disableManualRenderingMode];
+            return "Failed to allocate manual rendering buffer";
+        }
+        objc_setAssociatedObject(engine, &kManualRenderBufferKey, buffer, OBJC_ASSOCIATION_RETAIN_NONATOMIC);
+        return NULL;  // NULL = success
+    }
+}
+
+// Return the engine to realtime (device) rendering (engine must be stopped)
+const char* audioengine_disable_manual_rendering(AudioEngine* wrapper) {
+    @autoreleasepool {
+        if (!wrapper) {
+            return "Engine wrapper is null";
+        }
+        
+        if (!wrapper->engine) {
+            return "Engine is null";
+        }
+        
+        AVAudioEngine* engine = (__bridge AVAudioEngine*)wrapper->engine;
+        @try {
+            [engine disableManualRenderingMode];
+        }
+        @catch (NSException* exception) {
+            return [[NSString stringWithFormat:@"Manual rendering exception: %@", exception.reason] UTF8String];
+        }
+        objc_setAssociatedObject(engine, &kManualRenderBufferKey, nil, OBJC_ASSOCIATION_RETAIN_NONATOMIC);
+        return NULL;  // NULL = success
+    }
+}
+
+// Pull one block from the graph in manual rendering mode
+const char* audioengine_render_offline(AudioEngine* wrapper, float* buffer, int frames, bool interleaved) {
+    if (!wrapper) {
+        return "Engine wrapper is null";
+    }
+    
+    if (!wrapper->engine) {
+        return "Engine is null";
+    }
+    
+    if (!buffer) {
+        return "Buffer is null";
+    }
+    
+    AVAudioEngine* engine = (__bridge AVAudioEngine*)wrapper->engine;
+    AVAudioPCMBuffer* renderBuffer = objc_getAssociatedObject(engine, &kManualRenderBufferKey);
+    if (!renderBuffer || !engine.isInManualRenderingMode) {
+        return "Engine is not in manual rendering mode";
+    }
+    
+    if (frames <= 0 || (AVAudioFrameCount)frames > renderBuffer.frameCapacity) {
+        return "Frame count exceeds manual rendering maximum";
+    }
+    
+    NSError* error = nil;
+    AVAudioEngineManualRenderingStatus status = [engine renderOffline:(AVAudioFrameCount)frames toBuffer:renderBuffer error:&error];
+    switch (status) {
+        case AVAudioEngineManualRenderingStatusSuccess:
+            break;
+        case AVAudioEngineManualRenderingStatusInsufficientDataFromInputNode:
+            return "Insufficient data from input node";
+        case AVAudioEngineManualRenderingStatusCannotDoInCurrentContext:
+            return "Manual rendering cannot run in the current context";
+        default:
+            return error ? [[NSString stringWithFormat:@"Offline render failed: %@", error.localizedDescription] UTF8String]
+                         : "Offline render failed";
+    }
+    
+    // Manual rendering formats are standard (deinterleaved float32)
+    const int channels = (int)renderBuffer.format.channelCount;
+    const int rendered = (int)renderBuffer.frameLength;
+    float* const* channelData = renderBuffer.floatChannelData;
+    for (int c = 0; c < channels; c++) {
+        const float* src = channelData[c];
+        for (int i = 0; i < frames; i++) {
+            const float sample = i < rendered ? src[i] : 0.0f;
+            if (interleaved) {
+                buffer[i * channels + c] = sample;
+            } else {
+                buffer[c * frames + i] = sample;
+            }
+        }
+    }
+    
+    return NULL;  // NULL = success
+}
+
 // Set volume of a specific mixer node
 const char* audioengine_set_mixer_volume(AudioEngine* wrapper, void* mixerNodePtr, float volume) {
     @autoreleasepool {
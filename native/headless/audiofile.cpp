@@ -0,0 +1,77 @@
+// Headless WAV/AIFF decoding into planar float32 (see ../pcmfile.h).
+
+#include "audiofile.hpp"
+#include "headless.hpp"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+
+namespace headless {
+
+int64_t AudioFile::read(int64_t start, int64_t frames, float* const* dest) const {
+    if (start < 0 || start >= length || frames <= 0) {
+        return 0;
+    }
+    frames = std::min(frames, length - start);
+    for (int c = 0; c < channelCount; c++) {
+        memcpy(dest[c], channels[(size_t)c].data() + start, sizeof(float) * (size_t)frames);
+    }
+    return frames;
+}
+
+const char* loadAudioFile(const char* path, AudioFile* file) {
+    PcmFile pcm;
+    if (const char* err = pcm_file_open(path, &pcm)) {
+        struct stat info;
+        if (stat(path, &info) != 0) {
+            return errorf("Cannot open %s", path);
+        }
+        return errorf("%s (headless backend reads WAV and AIFF only)", err);
+    }
+
+    file->path = path;
+    file->sampleRate = pcm.sampleRate;
+    file->channelCount = pcm.channelCount;
+    file->length = pcm.frames;
+    file->channels.assign((size_t)pcm.channelCount, std::vector<float>((size_t)pcm.frames));
+
+    // One pass front to back, converted straight from the mapping
+    std::vector<float*> planes((size_t)pcm.channelCount);
+    for (int c = 0; c < pcm.channelCount; c++) {
+        planes[(size_t)c] = file->channels[(size_t)c].data();
+    }
+    pcm_file_advise(&pcm, PCM_ACCESS_SEQUENTIAL, 0, pcm.frames);
+    pcm_file_read(&pcm, 0, pcm.frames, planes.data());
+
+    char description[160];
+    snprintf(description, sizeof(description), "%d ch, %6.0f Hz, %d-bit %s%s (%s)", pcm.channelCount,
+             pcm.sampleRate, pcm.bitsPerSample,
+             pcm.bytesPerSample == 1 || pcm.isFloat ? "" : (pcm.bigEndian ? "big-endian " : "little-endian "),
+             pcm.isFloat ? "float" : "signed integer", pcm.container);
+    file->description = description;
+    pcm_file_close(&pcm);
+    return NULL;
+}
+
+AudioFileReader::~AudioFileReader() {
+    pcm_file_close(&pcm_);
+}
+
+const char* AudioFileReader::open(const AudioFile& file) {
+    pcm_file_close(&pcm_);
+    if (const char* err = pcm_file_open(file.path.c_str(), &pcm_)) {
+        return errorf("Cannot map %s: %s", file.path.c_str(), err);
+    }
+    if (pcm_.channelCount != file.channelCount || pcm_.frames != file.length) {
+        pcm_file_close(&pcm_);
+        return errorf("%s changed since it was loaded", file.path.c_str());
+    }
+    return NULL;
+}
+
+int64_t AudioFileReader::read(int64_t start, int64_t frames, float* const* dest) {
+    return pcm_.map ? pcm_file_read(&pcm_, start, frames, dest) : 0;
+}
+
+}  // namespace headless
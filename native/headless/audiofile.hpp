@@ -0,0 +1,55 @@
+// Headless audio file reader
+//
+// Stand-in for AVAudioFile: decodes uncompressed WAV (PCM, float, extensible),
+// RF64 and AIFF/AIFC files into planar float32, the AVAudioFile processing
+// format, through the memory-mapped reader in ../pcmfile.h.
+// Compressed formats (AAC, MP3, ALAC, ...) need Core Audio and are rejected.
+
+#ifndef MACAUDIO_HEADLESS_AUDIOFILE_HPP
+#define MACAUDIO_HEADLESS_AUDIOFILE_HPP
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "../pcmfile.h"
+
+namespace headless {
+
+struct AudioFile {
+    std::string path;
+    double sampleRate = 0.0;
+    int channelCount = 0;
+    int64_t length = 0;        // Frames per channel
+    std::string description;   // Human readable file format (AVAudioFile.fileFormat description)
+    std::vector<std::vector<float>> channels;  // Planar processing-format samples
+
+    // Read `frames` frames starting at `start` into planar destinations.
+    // Returns the number of frames copied (clamped to the file length).
+    int64_t read(int64_t start, int64_t frames, float* const* dest) const;
+};
+
+// Decode `path` into `file`. Returns NULL on success or an error message.
+const char* loadAudioFile(const char* path, AudioFile* file);
+
+// Decodes frames of a loaded file straight from its memory mapping, for the
+// streaming playback I/O thread. Holds its own mapping, whose access hints
+// follow the reads; one thread at a time.
+class AudioFileReader {
+public:
+    AudioFileReader() = default;
+    ~AudioFileReader();
+    AudioFileReader(const AudioFileReader&) = delete;
+    AudioFileReader& operator=(const AudioFileReader&) = delete;
+
+    const char* open(const AudioFile& file);  // NULL on success
+    // Like AudioFile::read; returns fewer frames at the end of the file or on an I/O error.
+    int64_t read(int64_t start, int64_t frames, float* const* dest);
+
+private:
+    PcmFile pcm_{};
+};
+
+}  // namespace headless
+
+#endif  // MACAUDIO_HEADLESS_AUDIOFILE_HPP
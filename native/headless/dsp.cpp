@@ -0,0 +1,108 @@
+// Headless standalone DSP objects (resampler_*, pitchshift_*).
+//
+// Same as ../dsp.m: nothing here touches the engine graph; each object is
+// owned by its caller and works on planar float buffers.
+
+#include "../macaudio.h"
+#include "../pitchshift.h"
+#include "../resampler.h"
+
+#include <memory>
+
+extern "C" {
+
+const char* resampler_create(double inputRate, double outputRate, int channelCount, int quality, Resampler** resampler,
+                             ResamplerInfo* info) {
+    if (!resampler || !info) {
+        return "Result pointer is null";
+    }
+
+    std::unique_ptr<Resampler> created(new Resampler());
+    if (const char* err = resampler_init(created.get(), inputRate, outputRate, channelCount, quality)) {
+        return err;
+    }
+    info->taps = created->taps;
+    info->phases = created->rows;
+    info->interpolated = created->interpolated;
+    info->kernel = resampler_kernel_label(created->kernel);
+    *resampler = created.release();
+    return NULL;  // Success
+}
+
+void resampler_process(Resampler* resampler, const float* input, int inputFrames, float* output, int outputCapacity,
+                       int* consumed, int* produced) {
+    int taken = 0, written = 0;
+    if (resampler && input && output && inputFrames >= 0 && outputCapacity >= 0) {
+        written = resampler_push(resampler, input, inputFrames, inputFrames, output, outputCapacity, outputCapacity,
+                                 &taken);
+    }
+    if (consumed) {
+        *consumed = taken;
+    }
+    if (produced) {
+        *produced = written;
+    }
+}
+
+void resampler_drain(Resampler* resampler, float* output, int outputCapacity, int* produced) {
+    int written = 0;
+    if (resampler && output && outputCapacity >= 0) {
+        written = resampler_finish(resampler, output, outputCapacity, outputCapacity);
+    }
+    if (produced) {
+        *produced = written;
+    }
+}
+
+void resampler_reset(Resampler* resampler) {
+    if (resampler) {
+        resampler_clear(resampler);
+    }
+}
+
+void resampler_destroy(Resampler* resampler) {
+    if (resampler) {
+        resampler_free(resampler);
+        delete resampler;
+    }
+}
+
+const char* pitchshift_create(double sampleRate, int channelCount, const PitchShiftOptions* options,
+                              PitchShifter** shifter, PitchShiftInfo* info) {
+    if (!options || !shifter || !info) {
+        return "Options or result pointer is null";
+    }
+
+    std::unique_ptr<PitchShifter> created(new PitchShifter());
+    if (const char* err = pitchshift_init(created.get(), sampleRate, channelCount, options->quality, options->fftSize)) {
+        return err;
+    }
+    created->preserveFormants = options->preserveFormants;
+    info->fftSize = created->fftSize;
+    info->hop = created->hop;
+    info->latency = created->fftSize;
+    info->kernel = resampler_kernel_label(created->kernel);
+    *shifter = created.release();
+    return NULL;  // Success
+}
+
+void pitchshift_process(PitchShifter* shifter, const float* input, float* output, int frames, float cents) {
+    if (shifter && input && output && frames > 0) {
+        pitchshift_run(shifter, input, frames, output, frames, frames, cents, shifter->preserveFormants);
+    }
+}
+
+void pitchshift_reset(PitchShifter* shifter) {
+    if (shifter) {
+        pitchshift_clear(shifter);
+    }
+}
+
+void pitchshift_destroy(PitchShifter* shifter) {
+    if (shifter) {
+        pitchshift_free(shifter);
+        delete shifter;
+    }
+}
+
+}  // extern "C"
@@ -0,0 +1,424 @@
+// Headless audioengine_* implementation.
+
+#include "../macaudio.h"
+#include "headless.hpp"
+
+#include <cstdlib>
+
+using headless::Engine;
+using headless::Format;
+using headless::MixerNode;
+using headless::Node;
+
+static Engine* engineOf(AudioEngine* wrapper) {
+    return static_cast<Engine*>(wrapper->engine);
+}
+
+static AudioEngineResult nodeResult(Node* node, const char* error) {
+    if (!node) {
+        return (AudioEngineResult){NULL, error};
+    }
+    return (AudioEngineResult){static_cast<void*>(node), NULL};  // NULL = success
+}
+
+extern "C" {
+
+AudioEngineResult audioengine_new(void) {
+    Engine* engine = new (std::nothrow) Engine();
+    if (!engine) {
+        return (AudioEngineResult){NULL, "Audio engine creation failed"};
+    }
+
+    AudioEngine* wrapper = (AudioEngine*)malloc(sizeof(AudioEngine));
+    if (!wrapper) {
+        delete engine;
+        return (AudioEngineResult){NULL, "Memory allocation failed"};
+    }
+
+    wrapper->engine = engine;
+    return (AudioEngineResult){wrapper, NULL};  // NULL = success
+}
+
+// Prepare the engine for starting
+void audioengine_prepare(AudioEngine* wrapper) {
+    if (!wrapper || !wrapper->engine) {
+        return;
+    }
+    Engine* engine = engineOf(wrapper);
+    std::lock_guard<std::recursive_mutex> lock(engine->graphMutex);
+    engine->mainMixer();
+    engine->prepareNodes();
+}
+
+const char* audioengine_start(AudioEngine* wrapper) {
+    if (!wrapper) {
+        return "Engine wrapper is null";
+    }
+    if (!wrapper->engine) {
+        return "Engine is invalid";
+    }
+    return engineOf(wrapper)->start();  // NULL = success
+}
+
+void audioengine_stop(AudioEngine* wrapper) {
+    if (!wrapper || !wrapper->engine) {
+        return;
+    }
+    engineOf(wrapper)->stop();
+}
+
+void audioengine_pause(AudioEngine* wrapper) {
+    if (!wrapper || !wrapper->engine) {
+        return;
+    }
+    engineOf(wrapper)->pause();
+}
+
+void audioengine_reset(AudioEngine* wrapper) {
+    if (!wrapper || !wrapper->engine) {
+        return;
+    }
+    engineOf(wrapper)->reset();
+}
+
+const char* audioengine_is_running(AudioEngine* wrapper) {
+    if (!wrapper) {
+        return "Engine wrapper is null";
+    }
+    if (!wrapper->engine) {
+        return "Engine is invalid";
+    }
+    return engineOf(wrapper)->isRunning() ? NULL : "Engine is not running";  // NULL = running (success)
+}
+
+// Remove all taps installed on the engine's built-in nodes
+void audioengine_remove_taps(AudioEngine* wrapper) {
+    if (!wrapper || !wrapper->engine) {
+        return;
+    }
+    Engine* engine = engineOf(wrapper);
+    std::lock_guard<std::recursive_mutex> lock(engine->graphMutex);
+    engine->mainMixer()->removeTap(0);
+    engine->outputNode()->removeTap(0);
+    engine->inputNode()->removeTap(0);
+}
+
+AudioEngineResult audioengine_output_node(AudioEngine* wrapper) {
+    if (!wrapper) {
+        return (AudioEngineResult){NULL, "Engine wrapper is null"};
+    }
+    if (!wrapper->engine) {
+        return (AudioEngineResult){NULL, "Engine is invalid"};
+    }
+    return nodeResult(engineOf(wrapper)->outputNode(), "Output node is invalid");
+}
+
+AudioEngineResult audioengine_input_node(AudioEngine* wrapper) {
+    if (!wrapper) {
+        return (AudioEngineResult){NULL, "Engine wrapper is null"};
+    }
+    if (!wrapper->engine) {
+        return (AudioEngineResult){NULL, "Engine is invalid"};
+    }
+    return nodeResult(engineOf(wrapper)->inputNode(), "Input node is invalid");
+}
+
+AudioEngineResult audioengine_main_mixer_node(AudioEngine* wrapper) {
+    if (!wrapper) {
+        return (AudioEngineResult){NULL, "Engine wrapper is null"};
+    }
+    if (!wrapper->engine) {
+        return (AudioEngineResult){NULL, "Engine is invalid"};
+    }
+    return nodeResult(engineOf(wrapper)->mainMixer(), "Main mixer node is invalid");
+}
+
+// Create a new individual mixer node for channels. The caller owns the
+// returned reference; the engine holds its own while the node is attached.
+AudioEngineResult audioengine_create_mixer_node(AudioEngine* wrapper) {
+    if (!wrapper || !wrapper->engine) {
+        return (AudioEngineResult){NULL, "Invalid engine wrapper"};
+    }
+
+    MixerNode* mixer = new (std::nothrow) MixerNode();
+    if (!mixer) {
+        return (AudioEngineResult){NULL, "Failed to create mixer node"};
+    }
+
+    engineOf(wrapper)->attach(mixer);
+    return nodeResult(mixer, NULL);
+}
+
+void audioengine_destroy(AudioEngine* wrapper) {
+    if (!wrapper) {
+        return;
+    }
+
+    if (wrapper->engine) {
+        // Stops the render thread, removes taps and detaches every node.
+        // Nodes still referenced by players, samplers or mixers outlive the
+        // engine and simply report themselves as detached.
+        delete engineOf(wrapper);
+        wrapper->engine = NULL;
+    }
+
+    free(wrapper);
+}
+
+const char* audioengine_attach(AudioEngine* wrapper, void* nodePtr) {
+    if (!wrapper) {
+        return "Engine wrapper is null";
+    }
+    if (!wrapper->engine) {
+        return "Engine is invalid";
+    }
+    if (!nodePtr) {
+        return "Node pointer is null";
+    }
+
+    const char* err = engineOf(wrapper)->attach(static_cast<Node*>(nodePtr));
+    if (err) {
+        return headless::errorf("Attach exception: %s", err);
+    }
+    return NULL;  // NULL on success
+}
+
+const char* audioengine_detach(AudioEngine* wrapper, void* nodePtr) {
+    if (!wrapper) {
+        return "Engine wrapper is null";
+    }
+    if (!wrapper->engine) {
+        return "Engine is invalid";
+    }
+    if (!nodePtr) {
+        return "Node pointer is null";
+    }
+
+    const char* err = engineOf(wrapper)->detach(static_cast<Node*>(nodePtr));
+    if (err) {
+        return headless::errorf("Detach exception: %s", err);
+    }
+    return NULL;  // NULL on success
+}
+
+const char* audioengine_connect(AudioEngine* wrapper, void* sourcePtr, void* destPtr, int fromBus, int toBus) {
+    if (!wrapper) {
+        return "Engine wrapper is null";
+    }
+    if (!wrapper->engine) {
+        return "Engine is invalid";
+    }
+    if (!sourcePtr || !destPtr) {
+        return "Node pointers cannot be null";
+    }
+
+    const char* err = engineOf(wrapper)->connect(static_cast<Node*>(sourcePtr), static_cast<Node*>(destPtr),
+                                                 fromBus, toBus, nullptr);
+    if (err) {
+        return headless::errorf("Connect exception: %s", err);
+    }
+    return NULL;  // NULL on success
+}
+
+// The headless graph renders everything at the engine rate, so an explicit
+// connection format is validated but otherwise only informational.
+const char* audioengine_connect_with_format(AudioEngine* wrapper, void* sourcePtr, void* destPtr, int fromBus, int toBus, void* formatPtr) {
+    if (!wrapper) {
+        return "Engine wrapper is null";
+    }
+    if (!wrapper->engine) {
+        return "Engine is invalid";
+    }
+    if (!sourcePtr || !destPtr) {
+        return "Node pointers cannot be null";
+    }
+
+    const Format* format = static_cast<const Format*>(formatPtr);
+    if (format) {
+        headless::logf("Connecting with explicit format: %.0f Hz, %d channels", format->sampleRate, format->channelCount);
+    }
+    const char* err = engineOf(wrapper)->connect(static_cast<Node*>(sourcePtr), static_cast<Node*>(destPtr),
+                                                 fromBus, toBus, format);
+    if (err) {
+        return headless::errorf("Connect-with-format exception: %s", err);
+    }
+    return NULL;  // NULL on success
+}
+
+// Set pan on the main mixer node (-1.0 = hard left, 0.0 = center, 1.0 = hard right)
+void audioengine_set_mixer_pan(AudioEngine* wrapper, float pan) {
+    if (!wrapper || !wrapper->engine) {
+        return;
+    }
+    engineOf(wrapper)->mainMixer()->pan.store(pan);
+}
+
+const char* audioengine_disconnect_node_input(AudioEngine* wrapper, void* nodePtr, int inputBus) {
+    if (!wrapper) {
+        return "Engine wrapper is null";
+    }
+    if (!wrapper->engine) {
+        return "Engine is invalid";
+    }
+    if (!nodePtr) {
+        return "Node pointer is null";
+    }
+
+    Node* node = static_cast<Node*>(nodePtr);
+    if (inputBus < 0) {
+        return "Invalid input bus (must be >= 0)";
+    }
+    if (inputBus >= node->numberOfInputs()) {
+        return "Invalid input bus (exceeds node's input count)";
+    }
+
+    const char* err = engineOf(wrapper)->disconnectInput(node, inputBus);
+    if (err) {
+        return headless::errorf("Disconnect exception: %s", err);
+    }
+    return NULL;
+}
+
+const char* audioengine_disconnect_node_output(AudioEngine* wrapper, void* nodePtr, int outputBus) {
+    if (!wrapper) {
+        return "Engine wrapper is null";
+    }
+    if (!wrapper->engine) {
+        return "Engine is invalid";
+    }
+    if (!nodePtr) {
+        return "Node pointer is null";
+    }
+
+    Node* node = static_cast<Node*>(nodePtr);
+    if (outputBus < 0) {
+        return "Invalid output bus (must be >= 0)";
+    }
+    if (outputBus >= node->numberOfOutputs()) {
+        return "Invalid output bus (exceeds node's output count)";
+    }
+
+    const char* err = engineOf(wrapper)->disconnectOutput(node, outputBus);
+    if (err) {
+        return headless::errorf("Disconnect exception: %s", err);
+    }
+    return NULL;
+}
+
+AudioEngineResult audioengine_create_format(double sampleRate, int channelCount, int bitDepth) {
+    (void)bitDepth;  // Like the standard AVAudioFormat, the headless graph is always float32
+    if (sampleRate <= 0 || channelCount <= 0) {
+        return (AudioEngineResult){NULL, "Failed to create audio format"};
+    }
+
+    Format* format = new (std::nothrow) Format();
+    if (!format) {
+        return (AudioEngineResult){NULL, "Failed to create audio format"};
+    }
+    format->sampleRate = sampleRate;
+    format->channelCount = channelCount;
+    return (AudioEngineResult){format, NULL};  // NULL = success
+}
+
+void audioengine_release_format(void* formatPtr) {
+    delete static_cast<Format*>(formatPtr);
+}
+
+// Unlike a hardware device, the headless render loop honours the requested
+// block size exactly.
+const char* audioengine_set_buffer_size(AudioEngine* wrapper, int bufferSize) {
+    if (!wrapper) {
+        return "Engine wrapper is null";
+    }
+    if (!wrapper->engine) {
+        return "Engine is null";
+    }
+    if (bufferSize <= 0) {
+        return "Buffer size must be positive";
+    }
+
+    Engine* engine = engineOf(wrapper);
+    engine->setMaxFrames(bufferSize);
+    headless::logf("Buffer size set to %d frames (%.2f ms at %.0f Hz)", bufferSize,
+                   (double)bufferSize / engine->format.sampleRate * 1000.0, engine->format.sampleRate);
+    return NULL;
+}
+
+const char* audioengine_enable_manual_rendering(AudioEngine* wrapper, double sampleRate, int channelCount, int maxFrames) {
+    if (!wrapper) {
+        return "Engine wrapper is null";
+    }
+    if (!wrapper->engine) {
+        return "Engine is null";
+    }
+
+    headless::Format format;
+    format.sampleRate = sampleRate;
+    format.channelCount = channelCount;
+    const char* err = engineOf(wrapper)->enableManualRendering(format, maxFrames);
+    if (err) {
+        return headless::errorf("Manual rendering exception: %s", err);
+    }
+    headless::logf("Manual rendering enabled: %.0f Hz, %d channels, %d frames", sampleRate, channelCount, maxFrames);
+    return NULL;
+}
+
+const char* audioengine_disable_manual_rendering(AudioEngine* wrapper) {
+    if (!wrapper) {
+        return "Engine wrapper is null";
+    }
+    if (!wrapper->engine) {
+        return "Engine is null";
+    }
+
+    const char* err = engineOf(wrapper)->disableManualRendering();
+    if (err) {
+        return headless::errorf("Manual rendering exception: %s", err);
+    }
+    return NULL;
+}
+
+const char* audioengine_render_offline(AudioEngine* wrapper, float* buffer, int frames, bool interleaved) {
+    if (!wrapper) {
+        return "Engine wrapper is null";
+    }
+    if (!wrapper->engine) {
+        return "Engine is null";
+    }
+    if (!buffer) {
+        return "Buffer is null";
+    }
+    return engineOf(wrapper)->renderOffline(buffer, frames, interleaved);  // NULL = success
+}
+
+const char* audioengine_set_mixer_volume(AudioEngine* wrapper, void* mixerNodePtr, float volume) {
+    if (!wrapper) {
+        return "Engine wrapper is null";
+    }
+    if (!wrapper->engine) {
+        return "Engine is null";
+    }
+    if (!mixerNodePtr) {
+        return "Mixer node pointer is null";
+    }
+    if (volume < 0.0f || volume > 1.0f) {
+        return "Volume must be between 0.0 and 1.0";
+    }
+
+    MixerNode* mixer = dynamic_cast<MixerNode*>(static_cast<Node*>(mixerNodePtr));
+    if (!mixer) {
+        return "Failed to set mixer volume";
+    }
+    mixer->outputVolume.store(volume);
+    return NULL;  // NULL = success
+}
+
+float audioengine_get_mixer_volume(AudioEngine* wrapper, void* mixerNodePtr) {
+    if (!wrapper || !wrapper->engine || !mixerNodePtr) {
+        return 0.0f;
+    }
+    MixerNode* mixer = dynamic_cast<MixerNode*>(static_cast<Node*>(mixerNodePtr));
+    return mixer ? mixer->outputVolume.load() : 0.0f;
+}
+
+}  // extern "C"
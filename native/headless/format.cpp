@@ -0,0 +1,144 @@
+// Headless audioformat_* implementation (float32 PCM formats only).
+
+#include "../macaudio.h"
+#include "headless.hpp"
+
+#include <cstdlib>
+
+using headless::Format;
+
+static AudioFormatResult newFormat(double sampleRate, int channels, bool interleaved, const char* failure) {
+    Format* format = new (std::nothrow) Format();
+    if (!format) {
+        return (AudioFormatResult){NULL, failure};
+    }
+    format->sampleRate = sampleRate;
+    format->channelCount = channels;
+    format->interleaved = interleaved;
+
+    AudioFormat* wrapper = (AudioFormat*)malloc(sizeof(AudioFormat));
+    if (!wrapper) {
+        delete format;
+        return (AudioFormatResult){NULL, "Memory allocation failed"};
+    }
+
+    wrapper->format = format;
+    headless::logf("Created format: %.0f Hz, %d channels, %s", sampleRate, channels,
+                   interleaved ? "interleaved" : "non-interleaved");
+    return (AudioFormatResult){wrapper, NULL};  // NULL = success
+}
+
+extern "C" {
+
+// Create mono format (1 channel, non-interleaved, float32)
+AudioFormatResult audioformat_new_mono(double sampleRate) {
+    if (sampleRate <= 0) {
+        return (AudioFormatResult){NULL, "Sample rate must be positive"};
+    }
+    return newFormat(sampleRate, 1, false, "Failed to create mono audio format");
+}
+
+// Create stereo format (2 channels, non-interleaved, float32)
+AudioFormatResult audioformat_new_stereo(double sampleRate) {
+    if (sampleRate <= 0) {
+        return (AudioFormatResult){NULL, "Sample rate must be positive"};
+    }
+    return newFormat(sampleRate, 2, false, "Failed to create stereo audio format");
+}
+
+// Create format with specific channel count and interleaving
+AudioFormatResult audioformat_new_with_channels(double sampleRate, int channels, bool interleaved) {
+    if (sampleRate <= 0) {
+        return (AudioFormatResult){NULL, "Sample rate must be positive"};
+    }
+    if (channels <= 0) {
+        return (AudioFormatResult){NULL, "Channel count must be positive"};
+    }
+    return newFormat(sampleRate, channels, interleaved, "Failed to create audio format with specified channels");
+}
+
+// Create format from AudioSpec struct
+AudioFormatResult audioformat_new_from_spec(double sampleRate, int channels, bool interleaved) {
+    if (sampleRate <= 0) {
+        return (AudioFormatResult){NULL, "Sample rate must be positive"};
+    }
+    if (channels <= 0) {
+        return (AudioFormatResult){NULL, "Channel count must be positive"};
+    }
+    return newFormat(sampleRate, channels, interleaved, "Failed to create audio format from spec");
+}
+
+// Get the underlying Format pointer for engine operations
+AudioFormatResult audioformat_get_format(AudioFormat* wrapper) {
+    if (!wrapper) {
+        return (AudioFormatResult){NULL, "Format pointer is null"};
+    }
+    if (!wrapper->format) {
+        return (AudioFormatResult){NULL, "Format object is null"};
+    }
+    return (AudioFormatResult){wrapper->format, NULL};  // NULL = success
+}
+
+double audioformat_get_sample_rate(AudioFormat* wrapper) {
+    if (!wrapper || !wrapper->format) {
+        return 0.0;
+    }
+    return static_cast<Format*>(wrapper->format)->sampleRate;
+}
+
+int audioformat_get_channel_count(AudioFormat* wrapper) {
+    if (!wrapper || !wrapper->format) {
+        return 0;
+    }
+    return static_cast<Format*>(wrapper->format)->channelCount;
+}
+
+bool audioformat_is_interleaved(AudioFormat* wrapper) {
+    if (!wrapper || !wrapper->format) {
+        return false;
+    }
+    return static_cast<Format*>(wrapper->format)->interleaved;
+}
+
+// Compare two formats for equality
+const char* audioformat_is_equal(AudioFormat* wrapper1, AudioFormat* wrapper2, bool* result) {
+    if (!result) {
+        return "Result pointer is null";
+    }
+    if (!wrapper1) {
+        return "First format pointer is null";
+    }
+    if (!wrapper2) {
+        return "Second format pointer is null";
+    }
+    if (!wrapper1->format) {
+        return "First format object is null";
+    }
+    if (!wrapper2->format) {
+        return "Second format object is null";
+    }
+
+    *result = *static_cast<Format*>(wrapper1->format) == *static_cast<Format*>(wrapper2->format);
+    return NULL;  // NULL = success
+}
+
+void audioformat_log_info(AudioFormat* wrapper) {
+    if (!wrapper || !wrapper->format) {
+        headless::logf("AudioFormat: NULL");
+        return;
+    }
+    const Format* format = static_cast<Format*>(wrapper->format);
+    headless::logf("AudioFormat: %.0f Hz, %d channels, %s, float32", format->sampleRate, format->channelCount,
+                   format->interleaved ? "interleaved" : "non-interleaved");
+}
+
+void audioformat_destroy(AudioFormat* wrapper) {
+    if (!wrapper) {
+        return;
+    }
+    delete static_cast<Format*>(wrapper->format);
+    wrapper->format = NULL;
+    free(wrapper);
+}
+
+}  // extern "C"
@@ -0,0 +1,756 @@
+// Headless render graph: buffers, nodes, mixers and the engine render loop.
+
+#include "headless.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdarg>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+namespace headless {
+
+// ==============================================
+// Helpers
+// ==============================================
+
+const char* errorf(const char* fmt, ...) {
+    thread_local char message[512];
+    va_list args;
+    va_start(args, fmt);
+    vsnprintf(message, sizeof(message), fmt, args);
+    va_end(args);
+    return message;
+}
+
+void logf(const char* fmt, ...) {
+    static const bool enabled = getenv("MACAUDIO_HEADLESS_LOG") != nullptr;
+    if (!enabled) {
+        return;
+    }
+    va_list args;
+    va_start(args, fmt);
+    fputs("macaudio[headless]: ", stderr);
+    vfprintf(stderr, fmt, args);
+    fputc('\n', stderr);
+    va_end(args);
+}
+
+// Pan law shared by all mixers: unity at center, the opposite side is
+// attenuated along a quarter cosine as the pan moves away from it.
+static void panGains(float pan, float* left, float* right) {
+    pan = std::min(1.0f, std::max(-1.0f, pan));
+    *left = pan <= 0.0f ? 1.0f : cosf(pan * (float)M_PI_2);
+    *right = pan >= 0.0f ? 1.0f : cosf(-pan * (float)M_PI_2);
+}
+
+void mixInto(Buffer& dst, const Buffer& src, int frames, float gain, float pan) {
+    const int dstChannels = dst.channels();
+    const int srcChannels = src.channels();
+    if (dstChannels == 0 || srcChannels == 0 || gain == 0.0f) {
+        return;
+    }
+
+    if (dstChannels == 1) {
+        // Fold everything down to mono
+        const float g = gain / (float)srcChannels;
+        float* out = dst.channel(0);
+        for (int c = 0; c < srcChannels; c++) {
+            const float* in = src.channel(c);
+            for (int i = 0; i < frames; i++) {
+                out[i] += in[i] * g;
+            }
+        }
+        return;
+    }
+
+    float left, right;
+    panGains(pan, &left, &right);
+    left *= gain;
+    right *= gain;
+
+    if (srcChannels == 1) {
+        const float* in = src.channel(0);
+        float* outL = dst.channel(0);
+        float* outR = dst.channel(1);
+        for (int i = 0; i < frames; i++) {
+            outL[i] += in[i] * left;
+            outR[i] += in[i] * right;
+        }
+        return;
+    }
+
+    const float* inL = src.channel(0);
+    const float* inR = src.channel(1);
+    float* outL = dst.channel(0);
+    float* outR = dst.channel(1);
+    for (int i = 0; i < frames; i++) {
+        outL[i] += inL[i] * left;
+        outR[i] += inR[i] * right;
+    }
+
+    // Discrete channels beyond the stereo pair map one-to-one without panning
+    const int extra = std::min(srcChannels, dstChannels);
+    for (int c = 2; c < extra; c++) {
+        const float* in = src.channel(c);
+        float* out = dst.channel(c);
+        for (int i = 0; i < frames; i++) {
+            out[i] += in[i] * gain;
+        }
+    }
+}
+
+// ==============================================
+// Buffer
+// ==============================================
+
+void Buffer::resize(int channels, int capacity) {
+    channels = std::max(0, channels);
+    capacity = std::max(0, capacity);
+    if (channels == channels_ && capacity == capacity_) {
+        return;
+    }
+    data_.assign((size_t)channels * (size_t)capacity, 0.0f);
+    channels_ = channels;
+    capacity_ = capacity;
+}
+
+void Buffer::clear(int frames) {
+    frames = std::min(frames, capacity_);
+    for (int c = 0; c < channels_; c++) {
+        memset(channel(c), 0, sizeof(float) * (size_t)frames);
+    }
+}
+
+// ==============================================
+// Node
+// ==============================================
+
+Node::Node(const char* kind) : kind_(kind) {}
+
+Node::~Node() = default;
+
+void Node::retain() {
+    refs_.fetch_add(1, std::memory_order_relaxed);
+}
+
+void Node::release() {
+    if (refs_.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+        delete this;
+    }
+}
+
+int Node::outputChannelCount() const {
+    const Connection* conn = input(0);
+    if (conn && conn->source) {
+        return conn->source->outputChannelCount();
+    }
+    return engine ? engine->format.channelCount : kDefaultChannelCount;
+}
+
+Format Node::outputFormat(int bus) const {
+    (void)bus;
+    Format format = engine ? engine->format : Format{};
+    format.channelCount = outputChannelCount();
+    format.interleaved = false;
+    return format;
+}
+
+Format Node::inputFormat(int bus) const {
+    const Connection* conn = input(bus);
+    if (conn && conn->source) {
+        return conn->source->outputFormat(conn->sourceBus);
+    }
+    Format format = engine ? engine->format : Format{};
+    format.interleaved = false;
+    return format;
+}
+
+void Node::prepare(int maxFrames) {
+    maxFrames_ = maxFrames;
+    output_.resize(outputChannelCount(), maxFrames);
+}
+
+const Buffer& Node::pull(const RenderContext& ctx, int frames) {
+    if (frames > output_.capacity()) {
+        // Not prepared for this block size; never allocate on the render thread
+        frames = output_.capacity();
+    }
+    const Buffer* through = elide(ctx, frames);
+    elided_.store(through != nullptr, std::memory_order_relaxed);
+    if (!through) {
+        render(ctx, output_, frames);
+        through = &output_;
+    }
+    if (tap_) {
+        tap_(*through, frames, outputFormat(0), ctx.sampleTime);
+    }
+    return *through;
+}
+
+Connection* Node::input(int bus) {
+    if (bus < 0 || bus >= numberOfInputs()) {
+        return nullptr;
+    }
+    if ((size_t)bus >= inputs_.size()) {
+        inputs_.resize((size_t)bus + 1);
+    }
+    if (!inputs_[(size_t)bus]) {
+        inputs_[(size_t)bus].reset(new Connection());
+    }
+    return inputs_[(size_t)bus].get();
+}
+
+const Connection* Node::input(int bus) const {
+    if (bus < 0 || (size_t)bus >= inputs_.size()) {
+        return nullptr;
+    }
+    return inputs_[(size_t)bus].get();
+}
+
+const Buffer* Node::pullInput(const RenderContext& ctx, int bus, int frames) {
+    const Connection* conn = static_cast<const Node*>(this)->input(bus);
+    if (!conn || !conn->source) {
+        return nullptr;
+    }
+    return &conn->source->pull(ctx, frames);
+}
+
+void Node::setTap(int bus, TapBlock block) {
+    (void)bus;  // Every headless node has a single output bus
+    tap_ = std::move(block);
+}
+
+void Node::removeTap(int bus) {
+    (void)bus;
+    tap_ = nullptr;
+}
+
+bool Node::hasTap(int bus) const {
+    (void)bus;
+    return (bool)tap_;
+}
+
+// ==============================================
+// Mixers, input and output
+// ==============================================
+
+int MixerNode::outputChannelCount() const {
+    return engine ? engine->format.channelCount : kDefaultChannelCount;
+}
+
+void MixerNode::prepare(int maxFrames) {
+    Node::prepare(maxFrames);
+    histories_.resize(kMixerInputBusCount);
+    for (int bus = 0; bus < kMixerInputBusCount; bus++) {
+        const Connection* conn = static_cast<const Node*>(this)->input(bus);
+        History& history = histories_[(size_t)bus];
+        if (!conn || !conn->source || conn->delay == 0) {
+            history.ring.resize(0, 0);
+            history.delayed.resize(0, 0);
+            continue;
+        }
+        // Room for the delay and a block; a ring that keeps its size keeps
+        // its history, so a new delay reads back what was really played
+        int capacity = 1;
+        while (capacity < conn->delay + maxFrames) {
+            capacity <<= 1;
+        }
+        const int channels = conn->source->outputChannelCount();
+        if (history.ring.channels() != channels || history.ring.capacity() != capacity) {
+            history.written = 0;
+        }
+        history.ring.resize(channels, capacity);
+        history.delayed.resize(channels, maxFrames);
+    }
+}
+
+const Buffer* MixerNode::delayInput(int bus, const Buffer& in, int delay, int frames) {
+    History& history = histories_[(size_t)bus];
+    const int capacity = history.ring.capacity();
+    if (history.ring.channels() != in.channels() || capacity < delay + frames) {
+        return &in;  // Not prepared for it
+    }
+    const int mask = capacity - 1;
+    const int from = history.written - delay + capacity;
+    for (int c = 0; c < in.channels(); c++) {
+        const float* source = in.channel(c);
+        float* ring = history.ring.channel(c);
+        float* delayed = history.delayed.channel(c);
+        for (int i = 0; i < frames; i++) {
+            ring[(history.written + i) & mask] = source[i];
+        }
+        for (int i = 0; i < frames; i++) {
+            delayed[i] = ring[(from + i) & mask];
+        }
+    }
+    history.written = (history.written + frames) & mask;
+    return &history.delayed;
+}
+
+void MixerNode::render(const RenderContext& ctx, Buffer& out, int frames) {
+    out.clear(frames);
+    for (int bus = 0; bus < kMixerInputBusCount; bus++) {
+        const Connection* conn = static_cast<const Node*>(this)->input(bus);
+        if (!conn || !conn->source) {
+            continue;
+        }
+        const Buffer* in = pullInput(ctx, bus, frames);
+        if (!in) {
+            continue;
+        }
+        if (conn->delay > 0) {
+            in = delayInput(bus, *in, conn->delay, frames);
+        }
+        const Node* source = conn->source;
+        const float gain = source->volume.load(std::memory_order_relaxed) *
+                           conn->volume.load(std::memory_order_relaxed);
+        const float pan = source->pan.load(std::memory_order_relaxed) +
+                          conn->pan.load(std::memory_order_relaxed);
+        mixInto(out, *in, frames, gain, pan);
+    }
+
+    const float outputGain = outputVolume.load(std::memory_order_relaxed);
+    if (outputGain != 1.0f) {
+        for (int c = 0; c < out.channels(); c++) {
+            float* samples = out.channel(c);
+            for (int i = 0; i < frames; i++) {
+                samples[i] *= outputGain;
+            }
+        }
+    }
+}
+
+const Buffer* MixerNode::elide(const RenderContext& ctx, int frames) {
+    if (outputVolume.load(std::memory_order_relaxed) != 1.0f) {
+        return nullptr;
+    }
+    int only = -1;
+    for (int bus = 0; bus < kMixerInputBusCount; bus++) {
+        const Connection* conn = static_cast<const Node*>(this)->input(bus);
+        if (!conn || !conn->source) {
+            continue;
+        }
+        if (only >= 0) {
+            return nullptr;
+        }
+        only = bus;
+    }
+    if (only < 0) {
+        return nullptr;
+    }
+    const Connection* conn = static_cast<const Node*>(this)->input(only);
+    const Node* source = conn->source;
+    if (conn->delay != 0 ||
+        source->volume.load(std::memory_order_relaxed) * conn->volume.load(std::memory_order_relaxed) != 1.0f ||
+        source->pan.load(std::memory_order_relaxed) + conn->pan.load(std::memory_order_relaxed) != 0.0f ||
+        source->outputChannelCount() != outputChannelCount()) {
+        return nullptr;
+    }
+    return pullInput(ctx, only, frames);
+}
+
+MatrixMixerNode::MatrixMixerNode() : Node("AVAudioUnit(MatrixMixer)") {}
+
+int MatrixMixerNode::outputChannelCount() const {
+    return engine ? engine->format.channelCount : kDefaultChannelCount;
+}
+
+int MatrixMixerNode::inputChannelCount() const {
+    return inputFormat(0).channelCount;
+}
+
+std::vector<float> MatrixMixerNode::gains() const {
+    std::lock_guard<std::mutex> lock(gainsMutex_);
+    std::vector<float> result = gains_;
+    result.resize((size_t)(inputChannelCount() * outputChannelCount()), 0.0f);
+    return result;
+}
+
+bool MatrixMixerNode::setGains(const std::vector<float>& gains) {
+    if (gains.size() != (size_t)(inputChannelCount() * outputChannelCount())) {
+        return false;
+    }
+    // Render cycles hold the graph mutex, so the render copy can be swapped
+    // here. Lock order matches prepare(): graph first, then the gains.
+    std::unique_lock<std::recursive_mutex> graphLock;
+    if (engine) {
+        graphLock = std::unique_lock<std::recursive_mutex>(engine->graphMutex);
+    }
+    std::lock_guard<std::mutex> lock(gainsMutex_);
+    gains_ = gains;
+    if (engine) {
+        renderGains_ = gains_;
+    }
+    return true;
+}
+
+void MatrixMixerNode::prepare(int maxFrames) {
+    Node::prepare(maxFrames);
+    std::lock_guard<std::mutex> lock(gainsMutex_);
+    renderGains_ = gains_;
+}
+
+void MatrixMixerNode::render(const RenderContext& ctx, Buffer& out, int frames) {
+    out.clear(frames);
+    const Buffer* in = pullInput(ctx, 0, frames);
+    if (!in) {
+        return;
+    }
+
+    const int inChannels = in->channels();
+    const int outChannels = out.channels();
+    if (renderGains_.size() != (size_t)(inChannels * outChannels)) {
+        return;
+    }
+    for (int o = 0; o < outChannels; o++) {
+        float* dst = out.channel(o);
+        for (int i = 0; i < inChannels; i++) {
+            const float gain = renderGains_[(size_t)(o * inChannels + i)];
+            if (gain == 0.0f) {
+                continue;
+            }
+            const float* src = in->channel(i);
+            for (int n = 0; n < frames; n++) {
+                dst[n] += src[n] * gain;
+            }
+        }
+    }
+}
+
+void OutputNode::render(const RenderContext& ctx, Buffer& out, int frames) {
+    out.clear(frames);
+    const Buffer* in = pullInput(ctx, 0, frames);
+    if (in) {
+        // The main mixer's own pan (audioengine_set_mixer_pan) is applied here
+        const Node* source = static_cast<const Node*>(this)->input(0)->source;
+        mixInto(out, *in, frames, 1.0f, source->pan.load(std::memory_order_relaxed));
+    }
+}
+
+int InputNode::outputChannelCount() const {
+    return engine ? engine->format.channelCount : kDefaultChannelCount;
+}
+
+void InputNode::render(const RenderContext& ctx, Buffer& out, int frames) {
+    (void)ctx;
+    out.clear(frames);
+}
+
+// ==============================================
+// Engine
+// ==============================================
+
+Engine::Engine() {
+    output_ = new OutputNode();
+    input_ = new InputNode();
+    attach(output_);
+    attach(input_);
+}
+
+Engine::~Engine() {
+    stop();
+    std::lock_guard<std::recursive_mutex> lock(graphMutex);
+    while (!attached_.empty()) {
+        detach(attached_.back());
+    }
+    if (mainMixer_) {
+        mainMixer_->release();
+    }
+    output_->release();
+    input_->release();
+}
+
+MixerNode* Engine::mainMixer() {
+    std::lock_guard<std::recursive_mutex> lock(graphMutex);
+    if (!mainMixer_) {
+        // Created on first access and wired to the output, like AVAudioEngine
+        mainMixer_ = new MixerNode();
+        attach(mainMixer_);
+        connect(mainMixer_, output_, 0, 0, nullptr);
+    }
+    return mainMixer_;
+}
+
+bool Engine::isAttached(const Node* node) const {
+    return node && node->engine == this;
+}
+
+const char* Engine::attach(Node* node) {
+    if (!node) {
+        return "Node is invalid";
+    }
+    std::lock_guard<std::recursive_mutex> lock(graphMutex);
+    if (node->engine == this) {
+        return NULL;  // Already attached to this engine
+    }
+    if (node->engine) {
+        return "Node is already attached to another engine";
+    }
+    node->retain();
+    node->engine = this;
+    attached_.push_back(node);
+    node->prepare(maxFrames);
+    return NULL;
+}
+
+const char* Engine::detach(Node* node) {
+    if (!node) {
+        return "Node is invalid";
+    }
+    std::lock_guard<std::recursive_mutex> lock(graphMutex);
+    auto it = std::find(attached_.begin(), attached_.end(), node);
+    if (it == attached_.end()) {
+        return "Node is not attached to this engine";
+    }
+
+    // Drop every connection that references the node in either direction
+    for (Node* other : attached_) {
+        for (int bus = 0; bus < other->numberOfInputs(); bus++) {
+            Connection* conn = other->input(bus);
+            if (conn && (conn->source == node || other == node)) {
+                conn->source = nullptr;
+            }
+        }
+    }
+
+    attached_.erase(it);
+    node->removeTap(0);
+    node->engine = nullptr;
+    prepareNodes();
+    node->release();
+    return NULL;
+}
+
+const char* Engine::connect(Node* source, Node* dest, int fromBus, int toBus, const Format* format) {
+    std::lock_guard<std::recursive_mutex> lock(graphMutex);
+    if (!isAttached(source) || !isAttached(dest)) {
+        return "Both nodes must be attached to the engine";
+    }
+    if (fromBus < 0 || fromBus >= source->numberOfOutputs()) {
+        return errorf("Invalid output bus %d (node has %d outputs)", fromBus, source->numberOfOutputs());
+    }
+    if (toBus < 0 || toBus >= dest->numberOfInputs()) {
+        return errorf("Invalid input bus %d (node has %d inputs)", toBus, dest->numberOfInputs());
+    }
+    if (format && (format->sampleRate <= 0 || format->channelCount <= 0)) {
+        return "Invalid connection format";
+    }
+
+    // Refuse cycles: walk upstream from the source looking for the destination
+    std::vector<const Node*> pending{source};
+    while (!pending.empty()) {
+        const Node* node = pending.back();
+        pending.pop_back();
+        if (node == dest) {
+            return "Connection would create a cycle";
+        }
+        for (int bus = 0; bus < node->numberOfInputs(); bus++) {
+            const Connection* conn = node->input(bus);
+            if (conn && conn->source) {
+                pending.push_back(conn->source);
+            }
+        }
+    }
+
+    // A source output bus feeds exactly one destination (AVAudioEngine semantics)
+    disconnectOutput(source, fromBus);
+
+    Connection* conn = dest->input(toBus);
+    conn->source = source;
+    conn->sourceBus = fromBus;
+    conn->volume.store(1.0f);
+    conn->pan.store(0.0f);
+    conn->delay = 0;
+    prepareNodes();
+    return NULL;
+}
+
+const char* Engine::disconnectInput(Node* node, int bus) {
+    std::lock_guard<std::recursive_mutex> lock(graphMutex);
+    Connection* conn = node->input(bus);
+    if (!conn) {
+        return "Invalid input bus";
+    }
+    conn->source = nullptr;
+    prepareNodes();
+    return NULL;
+}
+
+const char* Engine::disconnectOutput(Node* node, int bus) {
+    std::lock_guard<std::recursive_mutex> lock(graphMutex);
+    for (Node* other : attached_) {
+        for (int i = 0; i < other->numberOfInputs(); i++) {
+            Connection* conn = other->input(i);
+            if (conn && conn->source == node && conn->sourceBus == bus) {
+                conn->source = nullptr;
+            }
+        }
+    }
+    prepareNodes();
+    return NULL;
+}
+
+void Engine::setMaxFrames(int frames) {
+    std::lock_guard<std::recursive_mutex> lock(graphMutex);
+    maxFrames = frames;
+    prepareNodes();
+}
+
+void Engine::prepareNodes() {
+    for (Node* node : attached_) {
+        node->prepare(maxFrames);
+    }
+}
+
+const char* Engine::start() {
+    if (running_.load(std::memory_order_acquire)) {
+        return NULL;
+    }
+    {
+        std::lock_guard<std::recursive_mutex> lock(graphMutex);
+        mainMixer();
+        prepareNodes();
+    }
+    running_.store(true, std::memory_order_release);
+    if (manualRendering_) {
+        logf("engine started in manual rendering mode: %.0f Hz, %d channels, %d frames", format.sampleRate,
+             format.channelCount, maxFrames);
+        return NULL;
+    }
+    renderThread_ = std::thread(&Engine::renderLoop, this);
+    logf("engine started: %.0f Hz, %d channels, %d frames", format.sampleRate, format.channelCount, maxFrames);
+    return NULL;
+}
+
+void Engine::stop() {
+    running_.store(false, std::memory_order_release);
+    if (renderThread_.joinable()) {
+        renderThread_.join();
+    }
+}
+
+void Engine::pause() {
+    stop();
+}
+
+void Engine::reset() {
+    std::lock_guard<std::recursive_mutex> lock(graphMutex);
+    for (Node* node : attached_) {
+        node->reset();
+    }
+}
+
+const Buffer& Engine::renderCycle(int frames) {
+    std::lock_guard<std::recursive_mutex> lock(graphMutex);
+    RenderContext ctx;
+    ctx.sampleTime = sampleTime_.load(std::memory_order_relaxed);
+    ctx.sampleRate = format.sampleRate;
+    const Buffer& out = output_->pull(ctx, frames);
+    sampleTime_.store(ctx.sampleTime + frames, std::memory_order_release);
+    return out;
+}
+
+const char* Engine::enableManualRendering(const Format& renderFormat, int renderMaxFrames) {
+    if (isRunning()) {
+        return "Engine must be stopped to enable manual rendering";
+    }
+    if (renderFormat.sampleRate <= 0.0 || renderFormat.channelCount <= 0) {
+        return "Invalid manual rendering format";
+    }
+    if (renderMaxFrames <= 0) {
+        return "Maximum frame count must be positive";
+    }
+
+    std::lock_guard<std::recursive_mutex> lock(graphMutex);
+    if (!manualRendering_) {
+        realtimeFormat_ = format;
+        realtimeMaxFrames_ = maxFrames;
+    }
+    manualRendering_ = true;
+    format.sampleRate = renderFormat.sampleRate;
+    format.channelCount = renderFormat.channelCount;
+    maxFrames = renderMaxFrames;
+    mainMixer();
+    prepareNodes();
+    return NULL;
+}
+
+const char* Engine::disableManualRendering() {
+    if (isRunning()) {
+        return "Engine must be stopped to disable manual rendering";
+    }
+
+    std::lock_guard<std::recursive_mutex> lock(graphMutex);
+    if (manualRendering_) {
+        manualRendering_ = false;
+        format = realtimeFormat_;
+        maxFrames = realtimeMaxFrames_;
+        prepareNodes();
+    }
+    return NULL;
+}
+
+const char* Engine::renderOffline(float* data, int frames, bool interleaved) {
+    if (!manualRendering_) {
+        return "Engine is not in manual rendering mode";
+    }
+    if (!isRunning()) {
+        return "Engine is not running";
+    }
+    if (frames <= 0 || frames > maxFrames) {
+        return errorf("Frame count %d outside 1..%d", frames, maxFrames);
+    }
+
+    std::lock_guard<std::recursive_mutex> lock(graphMutex);
+    const Buffer& out = renderCycle(frames);
+    const int channels = format.channelCount;
+    for (int c = 0; c < channels; c++) {
+        // The output node follows the engine layout; pad defensively if it does not
+        const float* src = c < out.channels() ? out.channel(c) : nullptr;
+        if (interleaved) {
+            for (int i = 0; i < frames; i++) {
+                data[(size_t)i * channels + c] = src ? src[i] : 0.0f;
+            }
+        } else {
+            float* dst = data + (size_t)c * frames;
+            for (int i = 0; i < frames; i++) {
+                dst[i] = src ? src[i] : 0.0f;
+            }
+        }
+    }
+    return NULL;
+}
+
+// The render thread plays the role of the hardware clock. MACAUDIO_HEADLESS_SPEED
+// scales it: 1 (default) paces in realtime, 4 renders four times faster than
+// realtime and 0 renders as fast as the CPU allows.
+void Engine::renderLoop() {
+    double speed = 1.0;
+    if (const char* env = getenv("MACAUDIO_HEADLESS_SPEED")) {
+        speed = std::max(0.0, atof(env));
+    }
+
+    using clock = std::chrono::steady_clock;
+    auto deadline = clock::now();
+    while (running_.load(std::memory_order_acquire)) {
+        const int frames = maxFrames;
+        renderCycle(frames);
+
+        if (speed <= 0.0) {
+            continue;
+        }
+        const auto period = std::chrono::duration_cast<clock::duration>(
+            std::chrono::duration<double>((double)frames / format.sampleRate / speed));
+        deadline += period;
+        const auto now = clock::now();
+        if (deadline < now - period * 8) {
+            deadline = now;  // Fell far behind (debugger, suspended VM); resync instead of bursting
+        }
+        std::this_thread::sleep_until(deadline);
+    }
+}
+
+}  // namespace headless
@@ -0,0 +1,684 @@
+// Headless backend internals
+//
+// A portable, device-less implementation of the C ABI in ../macaudio.h.
+// The graph mirrors the AVAudioEngine object model (engine, attached nodes,
+// bus connections, main mixer -> output node) but is rendered by pulling the
+// output node block by block, either from a paced render thread or manually.
+//
+// Object model:
+//   - Every node is reference counted; `__bridge_retained` style entry points
+//     hand out a +1 reference, `audionode_release` drops it.
+//   - The whole graph runs at the engine sample rate. Nodes only differ in
+//     channel count; mixers map channel layouts when summing.
+//   - Topology changes and render cycles are serialised by Engine::graphMutex.
+//     Parameters that change at runtime (volume, pan, rate, ...) are atomics.
+
+#ifndef MACAUDIO_HEADLESS_HPP
+#define MACAUDIO_HEADLESS_HPP
+
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "../pitchshift.h"
+#include "../playhead.h"
+#include "../wsola.h"
+
+struct StreamPool;  // ../stream.h
+
+namespace headless {
+
+constexpr double kDefaultSampleRate = 48000.0;
+constexpr int kDefaultChannelCount = 2;
+constexpr int kDefaultMaxFrames = 512;
+constexpr int kMixerInputBusCount = 64;
+
+// Format is the headless stand-in for AVAudioFormat (always float32 PCM).
+struct Format {
+    double sampleRate = kDefaultSampleRate;
+    int channelCount = kDefaultChannelCount;
+    bool interleaved = false;
+
+    bool operator==(const Format& other) const {
+        return sampleRate == other.sampleRate && channelCount == other.channelCount &&
+               interleaved == other.interleaved;
+    }
+};
+
+// Buffer is a planar float buffer with a fixed capacity. It is only ever
+// resized from control threads (under the graph mutex), never while rendering.
+class Buffer {
+public:
+    void resize(int channels, int capacity);
+    void clear(int frames);
+    float* channel(int index) { return data_.data() + (size_t)index * (size_t)capacity_; }
+    const float* channel(int index) const { return data_.data() + (size_t)index * (size_t)capacity_; }
+    int channels() const { return channels_; }
+    int capacity() const { return capacity_; }
+
+private:
+    std::vector<float> data_;
+    int channels_ = 0;
+    int capacity_ = 0;
+};
+
+struct RenderContext {
+    int64_t sampleTime = 0;  // Engine sample time of the first frame of the cycle
+    double sampleRate = kDefaultSampleRate;
+};
+
+class Engine;
+class Node;
+
+// TapBlock mirrors the AVAudioNodeTapBlock signature.
+using TapBlock = std::function<void(const Buffer& buffer, int frames, const Format& format, int64_t sampleTime)>;
+
+struct Connection {
+    Node* source = nullptr;
+    int sourceBus = 0;
+    // Per-connection mixing parameters (AVAudioMixingDestination)
+    std::atomic<float> volume{1.0f};
+    std::atomic<float> pan{0.0f};
+    // Compensating delay in frames, applied by a destination mixer; changes
+    // with the graph locked
+    int delay = 0;
+};
+
+class Node {
+public:
+    explicit Node(const char* kind);
+    virtual ~Node();
+
+    Node(const Node&) = delete;
+    Node& operator=(const Node&) = delete;
+
+    void retain();
+    void release();
+
+    const char* kind() const { return kind_; }
+    virtual int numberOfInputs() const { return 1; }
+    virtual int numberOfOutputs() const { return 1; }
+
+    // Channel count produced on the output bus. Defaults to the upstream
+    // format on input bus 0, or the engine format when unconnected.
+    virtual int outputChannelCount() const;
+    Format outputFormat(int bus) const;
+    Format inputFormat(int bus) const;
+
+    // Size internal buffers for the engine block size. Control thread only.
+    virtual void prepare(int maxFrames);
+    // Clear DSP state (AVAudioEngine reset semantics). Called with the graph locked.
+    virtual void reset() {}
+
+    // Render `frames` frames (<= maxFrames) of output bus 0. Render thread only.
+    // The returned buffer stays valid until the next pull of this node.
+    const Buffer& pull(const RenderContext& ctx, int frames);
+
+    // The mutable overload creates the bus slot on demand (graph must be locked);
+    // the const overload never allocates and is safe on the render thread.
+    Connection* input(int bus);
+    const Connection* input(int bus) const;
+
+    void setTap(int bus, TapBlock block);
+    void removeTap(int bus);
+    bool hasTap(int bus) const;
+
+    Engine* engine = nullptr;  // Set while attached
+
+    // Backing storage for audionode_*_format_for_bus results (owned by the node,
+    // like the unretained AVAudioFormat those calls return on macOS).
+    Format formatCache[2];
+
+    // AVAudioMixing: applied by the downstream mixer when this node is summed
+    std::atomic<float> volume{1.0f};
+    std::atomic<float> pan{0.0f};
+
+    // Whether the last cycle was routed around this node; any thread
+    bool isElided() const { return elided_.load(std::memory_order_relaxed); }
+
+    // Frames the output trails the input it was made from (AUAudioUnit
+    // latency); any thread
+    virtual int latency() const { return 0; }
+
+protected:
+    virtual void render(const RenderContext& ctx, Buffer& out, int frames) = 0;
+    // A node that would pass this cycle through unchanged may return its
+    // upstream buffer here instead of rendering. Render thread only.
+    virtual const Buffer* elide(const RenderContext& ctx, int frames) {
+        (void)ctx;
+        (void)frames;
+        return nullptr;
+    }
+    // Pull the node connected to `bus`; returns nullptr when unconnected.
+    const Buffer* pullInput(const RenderContext& ctx, int bus, int frames);
+    int maxFrames() const { return maxFrames_; }
+
+private:
+    const char* kind_;
+    std::atomic<int> refs_{1};
+    std::vector<std::unique_ptr<Connection>> inputs_;
+    Buffer output_;
+    int maxFrames_ = 0;
+    TapBlock tap_;
+    std::atomic<bool> elided_{false};
+};
+
+// MixerNode sums any number of input buses into the engine channel layout
+// (AVAudioMixerNode). `outputVolume` scales the summed output. A lone input at
+// unity gain and centre pan in that layout is handed on as it is. An input
+// with a compensating delay is read back through a ring of what it played.
+class MixerNode : public Node {
+public:
+    MixerNode() : Node("AVAudioMixerNode") {}
+    int numberOfInputs() const override { return kMixerInputBusCount; }
+    int outputChannelCount() const override;
+    void prepare(int maxFrames) override;
+    std::atomic<float> outputVolume{1.0f};
+
+protected:
+    void render(const RenderContext& ctx, Buffer& out, int frames) override;
+    // A single undelayed input at unity gain and centre pan, in the output layout
+    const Buffer* elide(const RenderContext& ctx, int frames) override;
+
+private:
+    struct History {
+        Buffer ring;      // The input's last frames, a power of two of them
+        Buffer delayed;   // This cycle's frames as they were `delay` ago
+        int written = 0;  // Ring position of the next frame
+    };
+    const Buffer* delayInput(int bus, const Buffer& in, int delay, int frames);
+    std::vector<History> histories_;  // By input bus, sized in prepare
+};
+
+// MatrixMixerNode applies an [output][input] gain matrix (kAudioUnitSubType_MatrixMixer).
+class MatrixMixerNode : public Node {
+public:
+    MatrixMixerNode();
+    int outputChannelCount() const override;
+    int inputChannelCount() const;
+
+    // Gains are stored row-major as gains[out * inputChannels + in].
+    std::vector<float> gains() const;
+    bool setGains(const std::vector<float>& gains);
+
+    void prepare(int maxFrames) override;
+
+protected:
+    void render(const RenderContext& ctx, Buffer& out, int frames) override;
+
+private:
+    mutable std::mutex gainsMutex_;
+    std::vector<float> gains_;
+    std::vector<float> renderGains_;
+};
+
+// OutputNode is the sink the engine pulls each cycle (AVAudioOutputNode).
+class OutputNode : public Node {
+public:
+    OutputNode() : Node("AVAudioOutputNode") {}
+
+protected:
+    void render(const RenderContext& ctx, Buffer& out, int frames) override;
+};
+
+// InputNode has no device behind it and produces silence (AVAudioInputNode).
+class InputNode : public Node {
+public:
+    InputNode() : Node("AVAudioInputNode") {}
+    int numberOfInputs() const override { return 0; }
+    int outputChannelCount() const override;
+
+protected:
+    void render(const RenderContext& ctx, Buffer& out, int frames) override;
+};
+
+struct AudioFile;
+class TimeStretchNode;
+
+// PlayerNode plays scheduled segments of a decoded file, converting from the
+// file rate to the engine rate (AVAudioPlayerNode). While streaming it reads
+// the same frames from buffers an I/O thread decodes ahead. Segments of other
+// decoded files can be queued behind them (audioplayer_queue_file), and a loop
+// region of its own file wraps in place (audioplayer_set_loop).
+// Decoded frames at a seek target, read by the render thread while the stream
+// refills behind them
+struct SeekPreroll {
+    int64_t start = 0;
+    int frames = 0;                           // Valid frames, not counting the guard frame
+    std::vector<std::vector<float>> channels;  // frames + 1 floats each
+};
+
+// Region of the player's file that playback wraps around. Frames are file
+// frames; the crossfade blends the crossfadeFrames before `start` into the
+// last ones before `end`.
+struct LoopRegion {
+    int64_t start = 0;
+    int64_t end = 0;  // 0 = no loop
+    int crossfadeFrames = 0;
+    // Streaming: decoded frames from start - crossfadeFrames on, played after
+    // each wrap while the stream refills (see SeekPreroll)
+    const SeekPreroll* preroll = nullptr;
+};
+
+// A source rate's resampler to the engine rate (native/resampler.h), applied
+// at read positions the player chooses; `window` gathers one channel's taps
+// where they run off the samples at hand.
+struct RateConverter {
+    RateConverter() = default;
+    RateConverter(const RateConverter&) = delete;
+    RateConverter& operator=(const RateConverter&) = delete;
+    ~RateConverter() { resampler_free(&resampler); }
+
+    double inputRate = 0.0;
+    double outputRate = 0.0;
+    Resampler resampler{};
+    std::vector<float> window;  // resampler.taps floats
+};
+
+class PlayerNode : public Node {
+public:
+    PlayerNode() : Node("AVAudioPlayerNode") {}
+    int numberOfInputs() const override { return 0; }
+    int outputChannelCount() const override;
+    void prepare(int maxFrames) override;
+    void reset() override;
+
+    // Everything below is called from control threads with the graph locked.
+    void setFile(const AudioFile* file);
+    // Read decoded audio from a streaming read-ahead pool instead of the file
+    // (nullptr for the file). The pool must outlive its use here.
+    void setStream(StreamPool* stream);
+    // Point the stream at the next scheduled frame; true once it is decoded
+    bool primeStream();
+    // Jump to file frame `frame` at the start of the next render block without
+    // stopping; the front segment then plays on to `end`. The old position fades
+    // out over `crossfadeFrames` engine frames. A streaming player passes the
+    // target's first decoded frames, which must stay untouched until
+    // usesPreroll() says otherwise. Returns false if nothing is scheduled or
+    // the front segment plays a queued file.
+    bool seek(int64_t frame, int64_t end, int crossfadeFrames, const SeekPreroll* preroll);
+    void cancelSeek() { seek_ = PendingSeek{}; }
+    bool usesPreroll(const SeekPreroll* preroll) const {
+        return preroll == preroll_ || preroll == seek_.preroll || preroll == loop_.preroll;
+    }
+    // Wrap from loop.end back to loop.start whenever the player's own file plays
+    // through loop.end, within the render block and without rescheduling.
+    // Applies from the next render block; end = 0 clears it.
+    void setLoop(const LoopRegion& loop);
+    const LoopRegion& loop() const { return loop_; }
+    void scheduleSegment(int64_t startFrame, int64_t frameCount, std::function<void()> completion);
+    // Queue a segment of another decoded file (outliving the segment) after
+    // everything scheduled. It starts on the frame after the previous segment
+    // ends, or fades in under its last fadeInFrames engine frames.
+    void scheduleFile(const AudioFile* file, int64_t startFrame, int64_t frameCount, int fadeInFrames,
+                      std::function<void()> completion);
+    // Drop queued-file segments that have not started, firing their completions
+    void unscheduleFiles();
+    // End the front segment at the start of the next render block, fading its
+    // continuation out over `crossfadeFrames` under the start of the next one.
+    // Returns false if nothing is scheduled.
+    bool skip(int crossfadeFrames);
+    // File of the front segment: nullptr for the player's own file or nothing
+    const AudioFile* frontFile() const { return schedule_.empty() ? nullptr : schedule_.front().file; }
+    bool hasSchedule() const { return !schedule_.empty(); }
+    bool hasQueuedFiles() const {
+        return std::any_of(schedule_.begin(), schedule_.end(), [](const Segment& segment) { return segment.file; });
+    }
+    // Read `variant`, the file rendered at `rate` (native/variant.h), in place
+    // of the player's own file from the next render block, or the file again
+    // for nullptr. Positions stay file frames: frame f plays variant frame
+    // f / rate. The variant must outlive its use here.
+    void setVariant(const AudioFile* variant, double rate);
+    const AudioFile* variant() const { return variant_; }
+    // The variant's rate, 1 while playing the file; any thread
+    double variantRate() const { return variantRate_.load(std::memory_order_relaxed); }
+    // Carry a started front segment of the player's own file on from file
+    // frame `position` (the variant crossfade of PitchShiftNode)
+    void continueFrom(double position);
+    // Read position in file frames, < 0 until the front segment starts
+    double position() const { return position_; }
+    // A file, queued file or variant at another rate than the engine is read
+    // through the resampler at this RESAMPLER_QUALITY_* tier, in real time and
+    // in manual rendering alike; medium by default
+    const char* setResamplerQuality(int quality);
+    int resamplerQuality() const { return resamplerQuality_; }
+    // Build the converter for sources at `rate` ahead of reading them
+    void prepareRate(double rate);
+    // The converter from `rate` to `engineRate`, nullptr at the engine rate or
+    // for a ratio the resampler cannot take (read by linear interpolation
+    // then); render thread
+    RateConverter* converterFor(double rate, double engineRate) const;
+    void play();
+    void pause();
+    void stop();
+    bool isPlaying() const { return playing_.load(std::memory_order_acquire); }
+
+    // Frames rendered since play() at the engine rate (AVAudioPlayerNode player time)
+    int64_t playerSampleTime() const { return playerTime_.load(std::memory_order_acquire); }
+    // File position at the end of the last render cycle; any thread
+    bool readPlayhead(PlayheadSlot* out) const { return playhead_read(&playhead_, out); }
+
+protected:
+    void render(const RenderContext& ctx, Buffer& out, int frames) override;
+
+private:
+    struct Segment {
+        int64_t start;
+        int64_t end;
+        std::function<void()> completion;
+        const AudioFile* file = nullptr;  // Queued file; nullptr plays file_
+        int fadeInFrames = 0;             // Overlap with the end of the previous segment
+    };
+
+    struct PendingSeek {
+        bool pending = false;
+        int64_t frame = 0;
+        int64_t end = 0;
+        int crossfadeFrames = 0;
+        const SeekPreroll* preroll = nullptr;
+    };
+
+    const AudioFile* sourceOf(const Segment& segment) const { return segment.file ? segment.file : file_; }
+    void completeFront();
+    void applySeek(const RenderContext& ctx);
+    void applySkip(const RenderContext& ctx);
+    void publishPlayhead(int64_t cycle, double speed, bool playing);
+    // Read the front segment from position_ into frames [first, frames) of out,
+    // stopping at `end`; returns frames written, fewer if the stream ran dry
+    int readFront(const RenderContext& ctx, Buffer& out, int first, int frames, int64_t end);
+    // Mix the next segment's fade-in over frames [first, first + count) of out
+    void mixIncoming(const RenderContext& ctx, Buffer& out, int first, int count);
+    // Mix the frames before the loop start under frames [first, first + count)
+    // of out, read from `from` on inside the loop crossfade
+    void mixLoopTail(const RenderContext& ctx, Buffer& out, int first, int count, double from);
+    // Rebuild the converters for the engine rate and the sources scheduled
+    void prepareConverters();
+    // readFront's conversion of a streaming player's own file: the frames
+    // under the taps are gathered into streamWindow_ as position_ moves on
+    int readStream(RateConverter* converter, Buffer& out, int first, int frames, int64_t end, double step);
+    // Extend streamWindow_ up to file frame `to`, compacting it to start at
+    // `from`; frames before `index` are not waited for. False if the stream ran dry
+    bool fillStreamWindow(int64_t from, int64_t to, int64_t index);
+
+    const AudioFile* file_ = nullptr;
+    StreamPool* stream_ = nullptr;
+    std::deque<Segment> schedule_;
+    double position_ = -1.0;  // Read position in file frames; < 0 until the front segment starts
+    PendingSeek seek_;
+    const SeekPreroll* preroll_ = nullptr;  // Played ahead of the stream after a seek
+    Buffer fade_;                           // The old position's continuation after a seek
+    int fadeFrames_ = 0;                    // Crossfade length; fadeDone_ of them mixed so far
+    int fadeDone_ = 0;
+    bool skip_ = false;       // End the front segment at the next block
+    int skipFadeFrames_ = 0;
+    double incoming_ = -1.0;  // Read position in the next segment while it fades in
+    int incomingDone_ = 0;    // Fade-in frames mixed so far
+    Buffer mix_;              // The next segment's (or the loop tail's) frames of the current block
+    LoopRegion loop_;
+    int64_t loops_ = 0;       // Wraps since origin_
+    std::atomic<bool> playing_{false};
+    std::atomic<int64_t> playerTime_{0};
+    PlayheadSlot playhead_{};
+    double frame_ = 0.0;   // Last read position, kept after the schedule runs out
+    double origin_ = 0.0;  // Where playback or the last seek started
+    const AudioFile* variant_ = nullptr;  // Read for the player's own file when set
+    std::atomic<double> variantRate_{1.0};
+    int resamplerQuality_ = RESAMPLER_QUALITY_MEDIUM;
+    std::vector<std::unique_ptr<RateConverter>> converters_;  // One per source rate
+    Buffer streamWindow_;         // Stream frames from streamWindowStart_ on, for readStream
+    int64_t streamWindowStart_ = 0;
+    int streamWindowFill_ = 0;
+};
+
+// PitchShiftNode changes pitch without changing duration (native/pitchshift.h),
+// in place of AVAudioUnitTimePitch behind the time stretch. Like that unit it
+// reads ahead: its first block after a shift starts pulls fftSize frames more,
+// so output frame k is still input frame k. The shift and formant switch are
+// read once per block, so they may change every block from any thread.
+// Quality and FFT size reallocate and change with the graph locked.
+//
+// At 0 cents, once the shifter has settled, the node plays out the input it
+// holds and then hands on its input buffer as it is. A new shift fades in
+// over one FFT frame from the unshifted input.
+class PitchShiftNode : public Node {
+public:
+    PitchShiftNode() : Node("MacAudioPitchShift") {}
+    ~PitchShiftNode() override;
+    void prepare(int maxFrames) override;
+    void reset() override;
+
+    std::atomic<float> pitch{0.0f};  // Cents, -2400 ... 2400
+    std::atomic<bool> preserveFormants{false};
+
+    // Called with the graph locked
+    const char* configure(int quality, int fftSize);
+    void describe(PitchShiftOptions* options, PitchShiftInfo* info) const;
+
+    // Published every cycle with `frame` = input frames pulled but not yet
+    // heard and `speed` = input frames per output frame; any thread
+    bool readLookahead(PlayheadSlot* out) const { return playhead_read(&lookahead_, out); }
+
+    // The published lookahead: fftSize while shifting, none routed around
+    int latency() const override;
+
+    // Crossfades between a player's variants and the live units, over `frames`
+    // engine frames from the next block; called with the graph locked. The
+    // node reads the variant itself for the length of the fade, and is not
+    // routed around meanwhile.
+    // fadeOutVariant: `player` has already moved on, and `variant` plays on
+    // from file frame `position` under what the units now play.
+    void fadeOutVariant(const AudioFile* variant, double rate, double position, int frames, PlayerNode* player);
+    // fadeInVariant: `variant` fades in from the frame being heard over what the
+    // units play, then the player moves onto it and both units to unity.
+    void fadeInVariant(const AudioFile* variant, double rate, int frames, PlayerNode* player,
+                       TimeStretchNode* timeStretch);
+    // Complete a fade-in at once, from where it got to, or drop a fade-out
+    void finishVariantFade();
+    // Undo a fade not yet rendered: a fade-in is dropped and the player goes
+    // back onto a fade-out's variant. Returns false if the fade was heard.
+    bool revertVariantFade();
+    // The variant the fade reads, nullptr once it is over
+    const AudioFile* fadingVariant() const { return fade_.variant; }
+    bool fadingInVariant() const { return fade_.variant && fade_.in; }
+
+protected:
+    void render(const RenderContext& ctx, Buffer& out, int frames) override;
+    const Buffer* elide(const RenderContext& ctx, int frames) override;
+
+private:
+    struct VariantFade {
+        const AudioFile* variant = nullptr;
+        double rate = 1.0;
+        double position = -1.0;  // Variant frame; < 0 until a fade-in finds the frame heard
+        int frames = 0;
+        int done = 0;
+        bool in = false;
+        PlayerNode* player = nullptr;
+        TimeStretchNode* timeStretch = nullptr;
+    };
+
+    void process(const RenderContext& ctx, Buffer& out, int frames);
+    void mixVariant(const RenderContext& ctx, Buffer& out, int frames);
+    double heardFrame(int before) const;
+    void handOff(double position);
+
+    PitchShifter shifter_{};
+    bool primed_ = false;     // Read fftSize frames ahead since the last reset
+    bool bypassing_ = false;  // Routed around: playing the held frames, then the input
+    int held_ = 0;            // Frames the shifter held when routed around
+    int drained_ = 0;         // Of those, played since
+    int quality_ = PITCH_SHIFT_QUALITY_MEDIUM;
+    int fftSize_ = 0;  // 0 for the quality's own
+    double sampleRate_ = 0.0;
+    PlayheadSlot lookahead_{};
+    VariantFade fade_;
+    Buffer variantMix_;  // The fading variant's frames of the current block
+};
+
+// TimeStretchNode changes playback rate without changing pitch (native/wsola.h).
+// It stands in front of the pitch shift unit. Instead of buffering whole
+// seconds it pulls a block only when its next grain reaches past what it
+// holds, and a rate change applies from the next grain, 10 ms later at most.
+// At rate 1 it plays out what it holds, which continues the input exactly, and
+// then hands on its input buffer as it is.
+class TimeStretchNode : public Node {
+public:
+    TimeStretchNode() : Node("MacAudioTimeStretch") {}
+    ~TimeStretchNode() override;
+    void prepare(int maxFrames) override;
+    void reset() override;
+
+    std::atomic<float> rate{1.0f};  // 0.25 ... 4, 1.0 = unchanged
+
+    // Published every cycle like PitchShiftNode::readLookahead; any thread
+    bool readLookahead(PlayheadSlot* out) const { return playhead_read(&lookahead_, out); }
+
+    // The published lookahead, which follows the grains and the rate
+    int latency() const override;
+
+protected:
+    void render(const RenderContext& ctx, Buffer& out, int frames) override;
+    const Buffer* elide(const RenderContext& ctx, int frames) override;
+
+private:
+    WsolaState wsola_{};
+    bool bypassing_ = false;  // Like PitchShiftNode's
+    int held_ = 0;
+    int drained_ = 0;
+    double sampleRate_ = 0.0;
+    PlayheadSlot lookahead_{};
+};
+
+// SamplerNode is a small polyphonic sine instrument standing in for
+// AVAudioUnitSampler's default sound.
+class SamplerNode : public Node {
+public:
+    SamplerNode() : Node("AVAudioUnitSampler") {}
+    int numberOfInputs() const override { return 0; }
+    int outputChannelCount() const override;
+    void reset() override;
+
+    // Called from control threads with the graph locked.
+    void startNote(int note, int velocity, int channel);
+    void stopNote(int note, int channel);
+
+    static constexpr int kMaxVoices = 64;
+
+protected:
+    void render(const RenderContext& ctx, Buffer& out, int frames) override;
+
+private:
+    struct Voice {
+        bool active = false;
+        bool released = false;
+        int note = 0;
+        int channel = 0;
+        double phase = 0.0;
+        double increment = 0.0;
+        float amplitude = 0.0f;
+        float envelope = 0.0f;
+        uint64_t started = 0;
+    };
+
+    Voice voices_[kMaxVoices];
+    uint64_t noteCounter_ = 0;
+};
+
+class Engine {
+public:
+    Engine();
+    ~Engine();
+
+    // Serialises topology changes against render cycles.
+    std::recursive_mutex graphMutex;
+
+    Format format;
+    int maxFrames = kDefaultMaxFrames;
+
+    MixerNode* mainMixer();
+    OutputNode* outputNode() { return output_; }
+    InputNode* inputNode() { return input_; }
+
+    bool isAttached(const Node* node) const;
+    const char* attach(Node* node);
+    const char* detach(Node* node);
+    const char* connect(Node* source, Node* dest, int fromBus, int toBus, const Format* format);
+    const char* disconnectInput(Node* node, int bus);
+    const char* disconnectOutput(Node* node, int bus);
+    void setMaxFrames(int frames);
+
+    const char* start();
+    void stop();
+    void pause();
+    void reset();
+    bool isRunning() const { return running_.load(std::memory_order_acquire); }
+
+    // Render one cycle from the output node and return its buffer, which stays
+    // valid until the next cycle. Locks the graph.
+    const Buffer& renderCycle(int frames);
+
+    // Manual rendering (AVAudioEngineManualRenderingModeOffline): the graph is
+    // reconfigured to `format`/`maxFrames` and start() spawns no render thread;
+    // the caller pulls blocks with renderOffline as fast as it likes. Only valid
+    // while stopped; disabling restores the realtime format.
+    const char* enableManualRendering(const Format& format, int maxFrames);
+    const char* disableManualRendering();
+    bool isManualRendering() const { return manualRendering_; }
+    // Render `frames` (<= maxFrames) into `data` as interleaved or planar float32.
+    const char* renderOffline(float* data, int frames, bool interleaved);
+
+    int64_t sampleTime() const { return sampleTime_.load(std::memory_order_acquire); }
+
+    // Re-size node buffers after a topology or format change. Graph must be locked.
+    void prepareNodes();
+
+private:
+    void renderLoop();
+
+    std::vector<Node*> attached_;  // Each entry holds one reference
+    MixerNode* mainMixer_ = nullptr;
+    OutputNode* output_ = nullptr;
+    InputNode* input_ = nullptr;
+
+    std::thread renderThread_;
+    std::atomic<bool> running_{false};
+    bool manualRendering_ = false;
+    Format realtimeFormat_;
+    int realtimeMaxFrames_ = kDefaultMaxFrames;
+    std::atomic<int64_t> sampleTime_{0};
+};
+
+// GraphLock holds the graph mutex of the engine a node is attached to, if any.
+// Detached nodes are never rendered, so they need no locking.
+class GraphLock {
+public:
+    explicit GraphLock(Node* node) {
+        if (node && node->engine) {
+            lock_ = std::unique_lock<std::recursive_mutex>(node->engine->graphMutex);
+        }
+    }
+
+private:
+    std::unique_lock<std::recursive_mutex> lock_;
+};
+
+// Format a message into thread-local storage so it can be returned as a
+// `const char*` error (the headless counterpart of [NSString UTF8String]).
+const char* errorf(const char* fmt, ...);
+
+// Diagnostic logging; silent unless MACAUDIO_HEADLESS_LOG is set.
+void logf(const char* fmt, ...);
+
+// Copy/sum `src` into `dst` channel layout with gain and pan applied.
+void mixInto(Buffer& dst, const Buffer& src, int frames, float gain, float pan);
+
+}  // namespace headless
+
+#endif  // MACAUDIO_HEADLESS_HPP
@@ -0,0 +1,446 @@
+// Headless audionode_*, audiomixer_* and matrixmixer_* implementation.
+
+#include "../macaudio.h"
+#include "headless.hpp"
+
+#include <algorithm>
+#include <cmath>
+
+using headless::Connection;
+using headless::GraphLock;
+using headless::MatrixMixerNode;
+using headless::MixerNode;
+using headless::Node;
+
+static Node* nodeOf(void* nodePtr) {
+    return static_cast<Node*>(nodePtr);
+}
+
+static MatrixMixerNode* matrixOf(void* unitPtr) {
+    return dynamic_cast<MatrixMixerNode*>(nodeOf(unitPtr));
+}
+
+// Validate a mixer input bus the way the AVFoundation backend does
+static const char* checkMixerBus(Node* mixer, int inputBus) {
+    if (inputBus < 0) {
+        return "Input bus number cannot be negative";
+    }
+    if (inputBus >= mixer->numberOfInputs()) {
+        return headless::errorf("Invalid input bus %d (mixer has %d inputs)", inputBus, mixer->numberOfInputs());
+    }
+    return NULL;
+}
+
+// Per-connection (source -> mixer bus) parameters, the AVAudioMixingDestination equivalent
+static Connection* destinationFor(void* sourcePtr, void* mixerPtr, int destBus, const char** err) {
+    *err = NULL;
+    if (!sourcePtr) { *err = "Source node pointer is null"; return nullptr; }
+    if (!mixerPtr)  { *err = "Mixer pointer is null"; return nullptr; }
+    if (destBus < 0) { *err = "Destination bus cannot be negative"; return nullptr; }
+
+    Node* mixer = nodeOf(mixerPtr);
+    if (!dynamic_cast<MixerNode*>(mixer)) {
+        *err = "Destination is not a mixer node";
+        return nullptr;
+    }
+    GraphLock lock(mixer);  // input() may allocate the bus slot
+    Connection* connection = destBus < mixer->numberOfInputs() ? mixer->input(destBus) : nullptr;
+    if (!connection || connection->source != nodeOf(sourcePtr)) {
+        *err = headless::errorf("No destination for mixer %p bus %d", mixerPtr, destBus);
+        return nullptr;
+    }
+    return connection;
+}
+
+// Matrix dimensions from the connected formats
+static const char* matrixSize(MatrixMixerNode* unit, int* inCh, int* outCh) {
+    *inCh = unit->inputChannelCount();
+    *outCh = unit->outputChannelCount();
+    if (*inCh == 0 || *outCh == 0) {
+        return "Zero channel count on matrix mixer";
+    }
+    return NULL;
+}
+
+extern "C" {
+
+// Generic bus operations that work on any node
+
+AudioNodeResult audionode_input_format_for_bus(void* nodePtr, int bus) {
+    if (!nodePtr) {
+        return (AudioNodeResult){NULL, "Node pointer is null"};
+    }
+    Node* node = nodeOf(nodePtr);
+    if (bus < 0) {
+        return (AudioNodeResult){NULL, "Input bus number cannot be negative"};
+    }
+    if (bus >= node->numberOfInputs()) {
+        return (AudioNodeResult){NULL, headless::errorf("Invalid input bus %d (node has %d inputs)", bus, node->numberOfInputs())};
+    }
+
+    GraphLock lock(node);
+    node->formatCache[0] = node->inputFormat(bus);
+    return (AudioNodeResult){&node->formatCache[0], NULL};
+}
+
+AudioNodeResult audionode_output_format_for_bus(void* nodePtr, int bus) {
+    if (!nodePtr) {
+        return (AudioNodeResult){NULL, "Node pointer is null"};
+    }
+    Node* node = nodeOf(nodePtr);
+    if (bus < 0) {
+        return (AudioNodeResult){NULL, "Output bus number cannot be negative"};
+    }
+    if (bus >= node->numberOfOutputs()) {
+        return (AudioNodeResult){NULL, headless::errorf("Invalid output bus %d (node has %d outputs)", bus, node->numberOfOutputs())};
+    }
+
+    GraphLock lock(node);
+    node->formatCache[1] = node->outputFormat(bus);
+    return (AudioNodeResult){&node->formatCache[1], NULL};
+}
+
+const char* audionode_get_number_of_inputs(void* nodePtr, int* result) {
+    if (!result) {
+        return "Result pointer is null";
+    }
+    if (!nodePtr) {
+        return "Node pointer is null";
+    }
+    *result = nodeOf(nodePtr)->numberOfInputs();
+    return NULL;  // Success
+}
+
+const char* audionode_get_number_of_outputs(void* nodePtr, int* result) {
+    if (!result) {
+        return "Result pointer is null";
+    }
+    if (!nodePtr) {
+        return "Node pointer is null";
+    }
+    *result = nodeOf(nodePtr)->numberOfOutputs();
+    return NULL;  // Success
+}
+
+const char* audionode_is_installed_on_engine(void* nodePtr, bool* result) {
+    if (!result) {
+        return "Result pointer is null";
+    }
+    if (!nodePtr) {
+        return "Node pointer is null";
+    }
+    *result = nodeOf(nodePtr)->engine != nullptr;
+    return NULL;  // Success
+}
+
+const char* audionode_is_elided(void* nodePtr, bool* result) {
+    if (!result) {
+        return "Result pointer is null";
+    }
+    if (!nodePtr) {
+        return "Node pointer is null";
+    }
+    *result = nodeOf(nodePtr)->isElided();
+    return NULL;  // Success
+}
+
+const char* audionode_get_latency(void* nodePtr, int* frames) {
+    if (!frames) {
+        return "Result pointer is null";
+    }
+    if (!nodePtr) {
+        return "Node pointer is null";
+    }
+    *frames = nodeOf(nodePtr)->latency();
+    return NULL;  // Success
+}
+
+const char* audionode_log_info(void* nodePtr) {
+    if (!nodePtr) {
+        return "Node pointer is null";
+    }
+    Node* node = nodeOf(nodePtr);
+    headless::logf("AudioNode Info:");
+    headless::logf("  Class: %s", node->kind());
+    headless::logf("  Inputs: %d", node->numberOfInputs());
+    headless::logf("  Outputs: %d", node->numberOfOutputs());
+    headless::logf("  Engine: %s", node->engine ? "Connected" : "Not connected");
+    return NULL;  // Success
+}
+
+const char* audionode_release(void* nodePtr) {
+    if (!nodePtr) {
+        return NULL;
+    }
+    nodeOf(nodePtr)->release();
+    return NULL;
+}
+
+// Mixer node operations
+
+AudioNodeResult audiomixer_create(void) {
+    MixerNode* mixer = new (std::nothrow) MixerNode();
+    if (!mixer) {
+        return (AudioNodeResult){NULL, "Failed to allocate AVAudioMixerNode"};
+    }
+    return (AudioNodeResult){static_cast<Node*>(mixer), NULL};
+}
+
+const char* audiomixer_set_volume(void* mixerPtr, float volume, int inputBus) {
+    if (!mixerPtr) {
+        return "Mixer pointer is null";
+    }
+    if (volume < 0.0f || volume > 1.0f) {
+        return "Volume must be between 0.0 and 1.0";
+    }
+    Node* mixer = nodeOf(mixerPtr);
+    if (const char* err = checkMixerBus(mixer, inputBus)) {
+        return err;
+    }
+    mixer->volume.store(volume);
+    return NULL;  // Success
+}
+
+const char* audiomixer_set_pan(void* mixerPtr, float pan, int inputBus) {
+    if (!mixerPtr) {
+        return "Mixer pointer is null";
+    }
+    if (pan < -1.0f || pan > 1.0f) {
+        return "Pan must be between -1.0 (left) and 1.0 (right)";
+    }
+    Node* mixer = nodeOf(mixerPtr);
+    if (const char* err = checkMixerBus(mixer, inputBus)) {
+        return err;
+    }
+    mixer->pan.store(pan);
+    return NULL;  // Success
+}
+
+const char* audiomixer_get_volume(void* mixerPtr, int inputBus, float* result) {
+    if (!result) {
+        return "Result pointer is null";
+    }
+    if (!mixerPtr) {
+        return "Mixer pointer is null";
+    }
+    Node* mixer = nodeOf(mixerPtr);
+    if (const char* err = checkMixerBus(mixer, inputBus)) {
+        return err;
+    }
+    *result = mixer->volume.load();
+    return NULL;  // Success
+}
+
+const char* audiomixer_get_pan(void* mixerPtr, int inputBus, float* result) {
+    if (!result) {
+        return "Result pointer is null";
+    }
+    if (!mixerPtr) {
+        return "Mixer pointer is null";
+    }
+    Node* mixer = nodeOf(mixerPtr);
+    if (const char* err = checkMixerBus(mixer, inputBus)) {
+        return err;
+    }
+    *result = mixer->pan.load();
+    return NULL;  // Success
+}
+
+const char* audiomixer_release(void* mixerPtr) {
+    if (!mixerPtr) {
+        return "Mixer pointer is null";
+    }
+    nodeOf(mixerPtr)->release();
+    return NULL;  // Success
+}
+
+// Per-connection mixer controls
+
+const char* audiomixer_set_input_volume_for_connection(void* sourcePtr, void* mixerPtr, int destBus, float volume) {
+    if (volume < 0.0f || volume > 1.0f) {
+        return "Volume must be between 0.0 and 1.0";
+    }
+    const char* e = NULL;
+    Connection* dest = destinationFor(sourcePtr, mixerPtr, destBus, &e);
+    if (!dest) { return e; }
+    dest->volume.store(volume);
+    return NULL;
+}
+
+const char* audiomixer_get_input_volume_for_connection(void* sourcePtr, void* mixerPtr, int destBus, float* result) {
+    if (!result) { return "Result pointer is null"; }
+    const char* e = NULL;
+    Connection* dest = destinationFor(sourcePtr, mixerPtr, destBus, &e);
+    if (!dest) { return e; }
+    *result = dest->volume.load();
+    return NULL;
+}
+
+const char* audiomixer_set_input_pan_for_connection(void* sourcePtr, void* mixerPtr, int destBus, float pan) {
+    if (pan < -1.0f || pan > 1.0f) {
+        return "Pan must be between -1.0 and 1.0";
+    }
+    const char* e = NULL;
+    Connection* dest = destinationFor(sourcePtr, mixerPtr, destBus, &e);
+    if (!dest) { return e; }
+    dest->pan.store(pan);
+    return NULL;
+}
+
+const char* audiomixer_get_input_pan_for_connection(void* sourcePtr, void* mixerPtr, int destBus, float* result) {
+    if (!result) { return "Result pointer is null"; }
+    const char* e = NULL;
+    Connection* dest = destinationFor(sourcePtr, mixerPtr, destBus, &e);
+    if (!dest) { return e; }
+    *result = dest->pan.load();
+    return NULL;
+}
+
+const char* audiomixer_set_input_delay_for_connection(void* sourcePtr, void* mixerPtr, int destBus, int frames) {
+    if (frames < 0 || frames > MIXER_MAX_INPUT_DELAY) {
+        return headless::errorf("Delay must be between 0 and %d frames", MIXER_MAX_INPUT_DELAY);
+    }
+    const char* e = NULL;
+    Connection* dest = destinationFor(sourcePtr, mixerPtr, destBus, &e);
+    if (!dest) { return e; }
+    Node* mixer = nodeOf(mixerPtr);
+    GraphLock lock(mixer);  // The mixer sizes its history of the input
+    if (dest->delay != frames) {
+        dest->delay = frames;
+        mixer->prepare(mixer->engine ? mixer->engine->maxFrames : headless::kDefaultMaxFrames);
+    }
+    return NULL;
+}
+
+const char* audiomixer_get_input_delay_for_connection(void* sourcePtr, void* mixerPtr, int destBus, int* result) {
+    if (!result) { return "Result pointer is null"; }
+    const char* e = NULL;
+    Connection* dest = destinationFor(sourcePtr, mixerPtr, destBus, &e);
+    if (!dest) { return e; }
+    GraphLock lock(nodeOf(mixerPtr));
+    *result = dest->delay;
+    return NULL;
+}
+
+// Matrix mixer operations
+
+AudioNodeResult matrixmixer_create(void) {
+    MatrixMixerNode* unit = new (std::nothrow) MatrixMixerNode();
+    if (!unit) {
+        return (AudioNodeResult){NULL, "Failed to create MatrixMixer"};
+    }
+    return (AudioNodeResult){static_cast<Node*>(unit), NULL};
+}
+
+// Configure the matrix mixer to invert polarity: diagonal gains set to -1.0
+const char* matrixmixer_configure_invert(void* unitPtr) {
+    if (!unitPtr) { return "Matrix mixer pointer is null"; }
+    MatrixMixerNode* unit = matrixOf(unitPtr);
+    if (!unit) { return "Matrix mixer formats unavailable"; }
+
+    int inCh, outCh;
+    if (const char* err = matrixSize(unit, &inCh, &outCh)) { return err; }
+    std::vector<float> gains((size_t)(inCh * outCh), 0.0f);
+    for (int i = 0; i < std::min(inCh, outCh); i++) {
+        gains[(size_t)(i * inCh + i)] = -1.0f;
+    }
+    return unit->setGains(gains) ? NULL : "Failed to set matrix levels";
+}
+
+const char* matrixmixer_set_gain(void* unitPtr, int inputChannel, int outputChannel, float gain) {
+    if (!unitPtr) { return "Matrix mixer pointer is null"; }
+    if (gain < -10.0f || gain > 10.0f) { return "Gain must be between -10.0 and 10.0"; }
+    MatrixMixerNode* unit = matrixOf(unitPtr);
+    if (!unit) { return "Matrix mixer formats unavailable"; }
+
+    int inCh, outCh;
+    if (const char* err = matrixSize(unit, &inCh, &outCh)) { return err; }
+    if (inputChannel < 0 || inputChannel >= inCh) { return "Invalid input channel"; }
+    if (outputChannel < 0 || outputChannel >= outCh) { return "Invalid output channel"; }
+
+    std::vector<float> gains = unit->gains();
+    gains[(size_t)(outputChannel * inCh + inputChannel)] = gain;
+    return unit->setGains(gains) ? NULL : "Failed to set matrix levels";
+}
+
+const char* matrixmixer_get_gain(void* unitPtr, int inputChannel, int outputChannel, float* result) {
+    if (!result) { return "Result pointer is null"; }
+    if (!unitPtr) { return "Matrix mixer pointer is null"; }
+    MatrixMixerNode* unit = matrixOf(unitPtr);
+    if (!unit) { return "Matrix mixer formats unavailable"; }
+
+    int inCh, outCh;
+    if (const char* err = matrixSize(unit, &inCh, &outCh)) { return err; }
+    if (inputChannel < 0 || inputChannel >= inCh) { return "Invalid input channel"; }
+    if (outputChannel < 0 || outputChannel >= outCh) { return "Invalid output channel"; }
+
+    *result = unit->gains()[(size_t)(outputChannel * inCh + inputChannel)];
+    return NULL;
+}
+
+const char* matrixmixer_clear_matrix(void* unitPtr) {
+    if (!unitPtr) { return "Matrix mixer pointer is null"; }
+    MatrixMixerNode* unit = matrixOf(unitPtr);
+    if (!unit) { return "Matrix mixer formats unavailable"; }
+
+    int inCh, outCh;
+    if (const char* err = matrixSize(unit, &inCh, &outCh)) { return err; }
+    return unit->setGains(std::vector<float>((size_t)(inCh * outCh), 0.0f)) ? NULL : "Failed to clear matrix";
+}
+
+const char* matrixmixer_set_identity(void* unitPtr) {
+    if (!unitPtr) { return "Matrix mixer pointer is null"; }
+    MatrixMixerNode* unit = matrixOf(unitPtr);
+    if (!unit) { return "Matrix mixer formats unavailable"; }
+
+    int inCh, outCh;
+    if (const char* err = matrixSize(unit, &inCh, &outCh)) { return err; }
+    std::vector<float> gains((size_t)(inCh * outCh), 0.0f);
+    for (int i = 0; i < std::min(inCh, outCh); i++) {
+        gains[(size_t)(i * inCh + i)] = 1.0f;
+    }
+    return unit->setGains(gains) ? NULL : "Failed to set identity matrix";
+}
+
+// Set constant power pan for a specific input channel (maintains perceived loudness)
+const char* matrixmixer_set_constant_power_pan(void* unitPtr, int inputChannel, float panPosition) {
+    if (!unitPtr) { return "Matrix mixer pointer is null"; }
+    if (panPosition < -1.0f || panPosition > 1.0f) {
+        return "Pan position must be between -1.0 (left) and 1.0 (right)";
+    }
+    MatrixMixerNode* unit = matrixOf(unitPtr);
+    if (!unit) { return "Matrix mixer formats unavailable"; }
+
+    int inCh, outCh;
+    if (const char* err = matrixSize(unit, &inCh, &outCh)) { return err; }
+    if (inputChannel < 0 || inputChannel >= inCh) { return "Invalid input channel"; }
+    if (outCh < 2) { return "Stereo output required for panning"; }
+
+    const float angle = (panPosition + 1.0f) * (float)(M_PI / 4.0);
+    std::vector<float> gains = unit->gains();
+    gains[(size_t)(0 * inCh + inputChannel)] = cosf(angle);  // Left output
+    gains[(size_t)(1 * inCh + inputChannel)] = sinf(angle);  // Right output
+    return unit->setGains(gains) ? NULL : "Failed to set matrix levels";
+}
+
+// Set linear pan for a specific input channel (simple but less accurate)
+const char* matrixmixer_set_linear_pan(void* unitPtr, int inputChannel, float panPosition) {
+    if (!unitPtr) { return "Matrix mixer pointer is null"; }
+    if (panPosition < -1.0f || panPosition > 1.0f) {
+        return "Pan position must be between -1.0 (left) and 1.0 (right)";
+    }
+    MatrixMixerNode* unit = matrixOf(unitPtr);
+    if (!unit) { return "Matrix mixer formats unavailable"; }
+
+    int inCh, outCh;
+    if (const char* err = matrixSize(unit, &inCh, &outCh)) { return err; }
+    if (inputChannel < 0 || inputChannel >= inCh) { return "Invalid input channel"; }
+    if (outCh < 2) { return "Stereo output required for panning"; }
+
+    std::vector<float> gains = unit->gains();
+    gains[(size_t)(0 * inCh + inputChannel)] = (panPosition <= 0.0f) ? 1.0f : (1.0f - panPosition);
+    gains[(size_t)(1 * inCh + inputChannel)] = (panPosition >= 0.0f) ? 1.0f : (1.0f + panPosition);
+    return unit->setGains(gains) ? NULL : "Failed to set matrix levels";
+}
+
+}  // extern "C"
@@ -0,0 +1,3631 @@
+// Headless player: PlayerNode, PitchShiftNode, TimeStretchNode and the audioplayer_* C ABI.
+
+#include "../macaudio.h"
+#include "../analysiscache.h"
+#include "../loudness.h"
+#include "../meter.h"
+#include "../pcmcache.h"
+#include "../peaks.h"
+#include "../resampler.h"
+#include "../stream.h"
+#include "../variant.h"
+#include "audiofile.hpp"
+#include "headless.hpp"
+
+#include <sys/stat.h>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <condition_variable>
+#include <cstdlib>
+#include <cstring>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace headless {
+
+// ==============================================
+// PlayerNode
+// ==============================================
+
+int PlayerNode::outputChannelCount() const {
+    if (file_) {
+        return file_->channelCount;
+    }
+    return engine ? engine->format.channelCount : kDefaultChannelCount;
+}
+
+void PlayerNode::prepare(int maxFrames) {
+    Node::prepare(maxFrames);
+    mix_.resize(outputChannelCount(), maxFrames);
+    prepareConverters();
+}
+
+void PlayerNode::reset() {
+    position_ = incoming_ = -1.0;
+    preroll_ = nullptr;
+    fadeFrames_ = fadeDone_ = 0;
+    streamWindowFill_ = 0;
+}
+
+// Converters follow the engine rate, which manual rendering may change; a
+// variant is at its file's rate and shares its converter
+void PlayerNode::prepareConverters() {
+    if (!engine) {
+        return;
+    }
+    const double rate = engine->format.sampleRate;
+    converters_.erase(std::remove_if(converters_.begin(), converters_.end(),
+                                     [rate](const std::unique_ptr<RateConverter>& converter) {
+                                         return converter->outputRate != rate;
+                                     }),
+                      converters_.end());
+    for (const Segment& segment : schedule_) {
+        if (segment.file) {
+            prepareRate(segment.file->sampleRate);
+        }
+    }
+    const RateConverter* own = nullptr;
+    if (file_) {
+        prepareRate(file_->sampleRate);
+        own = converterFor(file_->sampleRate, rate);
+    }
+    // Room for two filters' worth of the player's own file
+    const int capacity = own ? 2 * own->resampler.taps : 0;
+    if (own && (streamWindow_.channels() != file_->channelCount || streamWindow_.capacity() < capacity)) {
+        streamWindow_.resize(file_->channelCount, capacity);
+    }
+    streamWindowFill_ = 0;
+}
+
+void PlayerNode::prepareRate(double rate) {
+    if (!engine || rate == engine->format.sampleRate || converterFor(rate, engine->format.sampleRate)) {
+        return;
+    }
+    std::unique_ptr<RateConverter> converter(new RateConverter());
+    if (resampler_init(&converter->resampler, rate, engine->format.sampleRate, 1, resamplerQuality_)) {
+        return;  // Further apart than the resampler goes: interpolated linearly
+    }
+    converter->inputRate = rate;
+    converter->outputRate = engine->format.sampleRate;
+    converter->window.resize((size_t)converter->resampler.taps);
+    converters_.push_back(std::move(converter));
+}
+
+RateConverter* PlayerNode::converterFor(double rate, double engineRate) const {
+    if (rate == engineRate) {
+        return nullptr;
+    }
+    for (const std::unique_ptr<RateConverter>& converter : converters_) {
+        if (converter->inputRate == rate && converter->outputRate == engineRate) {
+            return converter.get();
+        }
+    }
+    return nullptr;
+}
+
+const char* PlayerNode::setResamplerQuality(int quality) {
+    if (quality < RESAMPLER_QUALITY_LOW || quality > RESAMPLER_QUALITY_BEST) {
+        return "Unknown resampler quality";
+    }
+    if (quality != resamplerQuality_) {
+        resamplerQuality_ = quality;
+        converters_.clear();
+        prepareConverters();
+    }
+    return NULL;
+}
+
+void PlayerNode::setFile(const AudioFile* file) {
+    stop();
+    file_ = file;
+    loop_ = LoopRegion{};  // Frames of the old file
+    setVariant(nullptr, 1.0);
+    if (engine) {
+        engine->prepareNodes();  // Channel count may have changed downstream
+    }
+}
+
+void PlayerNode::setStream(StreamPool* stream) {
+    stream_ = stream;
+    position_ = -1.0;
+    streamWindowFill_ = 0;
+    preroll_ = loop_.preroll = nullptr;
+    seek_ = PendingSeek{};
+}
+
+bool PlayerNode::primeStream() {
+    if (!stream_ || schedule_.empty() || schedule_.front().file) {
+        return true;
+    }
+    if (position_ < 0.0) {
+        position_ = origin_ = (double)schedule_.front().start;
+        loops_ = 0;
+        stream_pool_seek(stream_, schedule_.front().start);
+    }
+    return stream_pool_find(stream_, (int64_t)position_) >= 0;
+}
+
+bool PlayerNode::seek(int64_t frame, int64_t end, int crossfadeFrames, const SeekPreroll* preroll) {
+    if (schedule_.empty() || schedule_.front().file) {
+        return false;
+    }
+    // Capacity only grows, so a fade in progress keeps its tail
+    const int channels = file_ ? file_->channelCount : 0;
+    if (crossfadeFrames > 0 && (fade_.channels() != channels || fade_.capacity() < crossfadeFrames)) {
+        fade_.resize(channels, crossfadeFrames);
+        fadeFrames_ = fadeDone_ = 0;
+    }
+    seek_ = PendingSeek{true, frame, end, crossfadeFrames, preroll};
+    return true;
+}
+
+void PlayerNode::setVariant(const AudioFile* variant, double rate) {
+    variant_ = variant;
+    variantRate_.store(variant ? rate : 1.0, std::memory_order_relaxed);
+}
+
+void PlayerNode::continueFrom(double position) {
+    if (position_ >= 0.0 && !schedule_.empty() && !schedule_.front().file) {
+        position_ = std::max(position, 0.0);
+    }
+}
+
+void PlayerNode::setLoop(const LoopRegion& loop) {
+    loop_ = loop;
+}
+
+void PlayerNode::scheduleSegment(int64_t startFrame, int64_t frameCount, std::function<void()> completion) {
+    schedule_.push_back(Segment{startFrame, startFrame + frameCount, std::move(completion)});
+}
+
+void PlayerNode::scheduleFile(const AudioFile* file, int64_t startFrame, int64_t frameCount, int fadeInFrames,
+                              std::function<void()> completion) {
+    prepareRate(file->sampleRate);
+    schedule_.push_back(Segment{startFrame, startFrame + frameCount, std::move(completion), file, fadeInFrames});
+}
+
+void PlayerNode::unscheduleFiles() {
+    // The front segment stays if it has started (or is fading the next one in)
+    const size_t first = position_ >= 0.0 ? 1 : 0;
+    std::vector<std::function<void()>> completions;
+    for (size_t i = schedule_.size(); i-- > first;) {
+        if (schedule_[i].file) {
+            completions.push_back(std::move(schedule_[i].completion));
+            schedule_.erase(schedule_.begin() + (std::ptrdiff_t)i);
+        }
+    }
+    incoming_ = -1.0;  // Whatever was fading in is gone
+    for (auto it = completions.rbegin(); it != completions.rend(); ++it) {
+        if (*it) {
+            (*it)();
+        }
+    }
+}
+
+bool PlayerNode::skip(int crossfadeFrames) {
+    if (schedule_.empty()) {
+        return false;
+    }
+    const int channels = outputChannelCount();
+    if (crossfadeFrames > 0 && (fade_.channels() < channels || fade_.capacity() < crossfadeFrames)) {
+        fade_.resize(channels, std::max(fade_.capacity(), crossfadeFrames));
+        fadeFrames_ = fadeDone_ = 0;
+    }
+    skip_ = true;
+    skipFadeFrames_ = crossfadeFrames;
+    return true;
+}
+
+void PlayerNode::play() {
+    playing_.store(true, std::memory_order_release);
+}
+
+void PlayerNode::pause() {
+    playing_.store(false, std::memory_order_release);
+    publishPlayhead(playhead_.cycle, playhead_.speed, false);
+}
+
+void PlayerNode::stop() {
+    playing_.store(false, std::memory_order_release);
+    // Like AVAudioPlayerNode, stopping flushes the schedule and fires its completions
+    while (!schedule_.empty()) {
+        completeFront();
+    }
+    seek_ = PendingSeek{};
+    skip_ = false;
+    preroll_ = nullptr;
+    fadeFrames_ = fadeDone_ = 0;
+    position_ = incoming_ = -1.0;
+    frame_ = origin_ = 0.0;
+    loops_ = 0;
+    playerTime_.store(0, std::memory_order_release);
+    publishPlayhead(playhead_.cycle, playhead_.speed, false);
+}
+
+void PlayerNode::completeFront() {
+    std::function<void()> completion = std::move(schedule_.front().completion);
+    schedule_.pop_front();
+    position_ = -1.0;
+    if (incoming_ >= 0.0 && !schedule_.empty()) {
+        // Already fading in: carry on from where it got to
+        position_ = incoming_;
+        origin_ = (double)schedule_.front().start;
+        loops_ = 0;
+    }
+    incoming_ = -1.0;
+    if (completion) {
+        completion();
+    }
+}
+
+// Runs at the top of a render block: fade out what the front segment would
+// have played on, then start the next one from its beginning
+void PlayerNode::applySkip(const RenderContext& ctx) {
+    const int crossfadeFrames = skipFadeFrames_;
+    skip_ = false;
+    if (schedule_.empty()) {
+        return;
+    }
+    fadeFrames_ = fadeDone_ = 0;
+    if (crossfadeFrames > 0 && position_ >= 0.0) {
+        const AudioFile* file = sourceOf(schedule_.front());
+        fade_.clear(crossfadeFrames);
+        readFront(ctx, fade_, 0, crossfadeFrames, std::min(schedule_.front().end, file->length));
+        fadeFrames_ = crossfadeFrames;
+    }
+    incoming_ = -1.0;  // The next segment starts over rather than from mid-fade
+    completeFront();
+}
+
+// Runs at the top of a render block: keep what the old position would have
+// played for the crossfade, then move the front segment to the target
+void PlayerNode::applySeek(const RenderContext& ctx) {
+    const PendingSeek seek = seek_;
+    seek_.pending = false;
+    if (schedule_.empty()) {
+        return;
+    }
+    fadeFrames_ = fadeDone_ = 0;
+    if (schedule_.front().file) {
+        return;  // Moved on to a queued file meanwhile
+    }
+    if (seek.crossfadeFrames > 0 && position_ >= 0.0) {
+        fade_.clear(seek.crossfadeFrames);
+        readFront(ctx, fade_, 0, seek.crossfadeFrames, std::min(schedule_.front().end, file_->length));
+        fadeFrames_ = seek.crossfadeFrames;
+    }
+
+    Segment& segment = schedule_.front();
+    segment.start = seek.frame;
+    segment.end = seek.end;
+    position_ = origin_ = (double)seek.frame;
+    loops_ = 0;
+    incoming_ = -1.0;
+    preroll_ = seek.preroll;
+    if (stream_) {
+        // The I/O thread picks up where the preroll ends
+        stream_pool_restart(stream_, preroll_ ? preroll_->start + preroll_->frames : seek.frame);
+    }
+}
+
+// Read planar samples that start at file frame `base` from `position` on,
+// `step` frames per output frame, up to `end`. Samples at another rate than
+// the engine go through their converter, with frames outside the planes
+// counting as silence; otherwise neighbouring frames are interpolated
+// linearly, which only a variant's fractional positions call for.
+static int readPlanes(const std::vector<std::vector<float>>& planes, int64_t base, double& position, double step,
+                      RateConverter* converter, Buffer& out, int first, int frames, int64_t end) {
+    const int channels = std::min(out.channels(), (int)planes.size());
+    int frame = first;
+    if (converter) {
+        const Resampler* resampler = &converter->resampler;
+        const int taps = resampler->taps;
+        const int64_t size = planes.empty() ? 0 : (int64_t)planes[0].size();
+        for (; frame < frames && (int64_t)position < end; frame++) {
+            int row;
+            float t;
+            const int64_t from = resampler_locate(resampler, position, &row, &t) - base;
+            const bool inside = from >= 0 && from + taps <= size;
+            for (int c = 0; c < channels; c++) {
+                const float* samples = planes[(size_t)c].data();
+                if (!inside) {
+                    for (int k = 0; k < taps; k++) {
+                        const int64_t at = from + k;
+                        converter->window[(size_t)k] = at >= 0 && at < size ? samples[at] : 0.0f;
+                    }
+                }
+                const float* x = inside ? samples + from : converter->window.data();
+                out.channel(c)[frame] = resampler_value(resampler, x, row, t);
+            }
+            position += step;
+        }
+        return frame - first;
+    }
+    for (; frame < frames; frame++) {
+        const int64_t index = (int64_t)position;
+        if (index >= end) {
+            break;
+        }
+        const float frac = (float)(position - (double)index);
+        const int64_t offset = index - base;
+        const int64_t next = index + 1 < end ? offset + 1 : offset;
+        for (int c = 0; c < channels; c++) {
+            const float* samples = planes[(size_t)c].data();
+            out.channel(c)[frame] = samples[offset] + (samples[next] - samples[offset]) * frac;
+        }
+        position += step;
+    }
+    return frame - first;
+}
+
+int PlayerNode::readFront(const RenderContext& ctx, Buffer& out, int first, int frames, int64_t end) {
+    const Segment& segment = schedule_.front();
+    const AudioFile* file = sourceOf(segment);
+    const double step = file->sampleRate / ctx.sampleRate;
+    if (variant_ && !segment.file) {
+        // The same file frames, scaled onto the variant
+        const double rate = variantRate_.load(std::memory_order_relaxed);
+        double at = position_ / rate;
+        const int64_t stop = std::min((int64_t)ceil((double)end / rate), variant_->length);
+        const int read = readPlanes(variant_->channels, 0, at, step, converterFor(variant_->sampleRate, ctx.sampleRate),
+                                    out, first, frames, stop);
+        position_ = at * rate;
+        if (first + read < frames) {
+            position_ = std::max(position_, (double)end);  // Never short of `end` once the variant is
+        }
+        return read;
+    }
+    RateConverter* converter = converterFor(file->sampleRate, ctx.sampleRate);
+    if (!stream_ || segment.file) {
+        return readPlanes(file->channels, 0, position_, step, converter, out, first, frames, end);
+    }
+    if (converter) {
+        return readStream(converter, out, first, frames, end, step);
+    }
+
+    // Same interpolation over the seek preroll or whichever ready buffer holds the frame
+    const int channels = std::min(out.channels(), file->channelCount);
+    int frame = first;
+    const bool offline = engine && engine->isManualRendering();
+    int slot = -1;
+    for (; frame < frames; frame++) {
+        const int64_t index = (int64_t)position_;
+        if (index >= end) {
+            break;
+        }
+        const float frac = (float)(position_ - (double)index);
+        if (preroll_ && index >= preroll_->start + preroll_->frames) {
+            preroll_ = nullptr;  // Played through; the stream carries on from here
+        }
+        if (preroll_) {
+            const int64_t offset = index - preroll_->start;
+            const int64_t next = index + 1 < end ? offset + 1 : offset;
+            for (int c = 0; c < channels; c++) {
+                const float* samples = preroll_->channels[(size_t)c].data();
+                out.channel(c)[frame] = samples[offset] + (samples[next] - samples[offset]) * frac;
+            }
+            position_ += step;
+            continue;
+        }
+        if (slot < 0 || index >= stream_->slots[slot].start + stream_->slots[slot].frames) {
+            slot = stream_pool_find(stream_, index);
+            // Offline bounces have no deadline, so they wait for the I/O thread
+            for (int waited = 0; slot < 0 && offline && waited < 20000; waited++) {
+                std::this_thread::sleep_for(std::chrono::microseconds(100));
+                slot = stream_pool_find(stream_, index);
+            }
+            if (slot < 0) {
+                break;
+            }
+        }
+        const int64_t offset = index - stream_->slots[slot].start;
+        const int64_t next = index + 1 < end ? offset + 1 : offset;
+        for (int c = 0; c < channels; c++) {
+            const float* samples = stream_pool_plane(stream_, slot, c);
+            out.channel(c)[frame] = samples[offset] + (samples[next] - samples[offset]) * frac;
+        }
+        position_ += step;
+    }
+    return frame - first;
+}
+
+int PlayerNode::readStream(RateConverter* converter, Buffer& out, int first, int frames, int64_t end, double step) {
+    const Resampler* resampler = &converter->resampler;
+    const int channels = std::min(out.channels(), streamWindow_.channels());
+    int frame = first;
+    for (; frame < frames; frame++) {
+        const int64_t index = (int64_t)position_;
+        if (index >= end) {
+            break;
+        }
+        if (preroll_ && index >= preroll_->start + preroll_->frames) {
+            preroll_ = nullptr;  // Played through; the stream carries on from here
+        }
+        int row;
+        float t;
+        const int64_t from = resampler_locate(resampler, position_, &row, &t);
+        if (from < streamWindowStart_ || from > streamWindowStart_ + streamWindowFill_) {
+            streamWindowStart_ = from;  // Jumped: gather afresh
+            streamWindowFill_ = 0;
+        }
+        if (!fillStreamWindow(from, from + resampler->taps, index)) {
+            break;
+        }
+        const int64_t offset = from - streamWindowStart_;
+        for (int c = 0; c < channels; c++) {
+            out.channel(c)[frame] = resampler_value(resampler, streamWindow_.channel(c) + offset, row, t);
+        }
+        position_ += step;
+    }
+    return frame - first;
+}
+
+bool PlayerNode::fillStreamWindow(int64_t from, int64_t to, int64_t index) {
+    const int channels = streamWindow_.channels();
+    if (streamWindowStart_ + streamWindow_.capacity() < to) {
+        const int drop = (int)(from - streamWindowStart_);
+        for (int c = 0; c < channels; c++) {
+            float* window = streamWindow_.channel(c);
+            memmove(window, window + drop, (size_t)(streamWindowFill_ - drop) * sizeof(float));
+        }
+        streamWindowStart_ = from;
+        streamWindowFill_ -= drop;
+    }
+    const bool offline = engine && engine->isManualRendering();
+    while (streamWindowStart_ + streamWindowFill_ < to) {
+        const int64_t frame = streamWindowStart_ + streamWindowFill_;
+        const int fill = streamWindowFill_;
+        int count = 1;
+        if (frame < 0 || frame >= file_->length) {
+            // Silence around the file
+            count = (int)((frame < 0 ? std::min<int64_t>(to, 0) : to) - frame);
+            for (int c = 0; c < channels; c++) {
+                std::fill_n(streamWindow_.channel(c) + fill, count, 0.0f);
+            }
+        } else if (preroll_ && frame >= preroll_->start && frame < preroll_->start + preroll_->frames) {
+            count = (int)(std::min(to, preroll_->start + preroll_->frames) - frame);
+            for (int c = 0; c < channels; c++) {
+                memcpy(streamWindow_.channel(c) + fill, preroll_->channels[(size_t)c].data() + (frame - preroll_->start),
+                       (size_t)count * sizeof(float));
+            }
+        } else {
+            int slot = stream_pool_find(stream_, frame);
+            // Offline bounces have no deadline, so they wait for the I/O thread.
+            // Frames before the read position may be gone after a jump; they
+            // count as silence.
+            for (int waited = 0; slot < 0 && offline && frame >= index && waited < 20000; waited++) {
+                std::this_thread::sleep_for(std::chrono::microseconds(100));
+                slot = stream_pool_find(stream_, frame);
+            }
+            if (slot < 0 && frame >= index) {
+                return false;
+            }
+            if (slot >= 0) {
+                const StreamSlot& held = stream_->slots[slot];
+                count = (int)(std::min(to, held.start + held.frames) - frame);
+            }
+            for (int c = 0; c < channels; c++) {
+                float* window = streamWindow_.channel(c) + fill;
+                if (slot >= 0) {
+                    memcpy(window, stream_pool_plane(stream_, slot, c) + (frame - stream_->slots[slot].start),
+                           (size_t)count * sizeof(float));
+                } else {
+                    *window = 0.0f;
+                }
+            }
+        }
+        streamWindowFill_ += count;
+    }
+    return true;
+}
+
+void PlayerNode::mixIncoming(const RenderContext& ctx, Buffer& out, int first, int count) {
+    const Segment& next = schedule_[1];
+    const AudioFile* file = sourceOf(next);
+    if (incoming_ < 0.0) {
+        incoming_ = (double)next.start;
+        incomingDone_ = 0;
+    }
+    mix_.clear(first + count);
+    readPlanes(file->channels, 0, incoming_, file->sampleRate / ctx.sampleRate,
+               converterFor(file->sampleRate, ctx.sampleRate), mix_, first, first + count,
+               std::min(next.end, file->length));
+
+    // Equal-power: the front segment fades out as the next one fades in
+    const int channels = std::min(out.channels(), mix_.channels());
+    for (int c = 0; c < out.channels(); c++) {
+        float* dst = out.channel(c) + first;
+        const float* in = c < channels ? mix_.channel(c) + first : nullptr;
+        for (int i = 0; i < count; i++) {
+            const float x = std::min(((float)(incomingDone_ + i) + 0.5f) / (float)next.fadeInFrames, 1.0f) * (float)M_PI_2;
+            dst[i] = dst[i] * cosf(x) + (in ? in[i] * sinf(x) : 0.0f);
+        }
+    }
+    incomingDone_ += count;
+}
+
+void PlayerNode::mixLoopTail(const RenderContext& ctx, Buffer& out, int first, int count, double from) {
+    const double step = file_->sampleRate / ctx.sampleRate;
+    RateConverter* converter = converterFor(file_->sampleRate, ctx.sampleRate);
+    double lead = from - (double)(loop_.end - loop_.start);
+    mix_.clear(first + count);
+    const double rate = variant_ ? variantRate_.load(std::memory_order_relaxed) : 1.0;
+    if (variant_) {
+        lead /= rate;
+        readPlanes(variant_->channels, 0, lead, step, converter, mix_, first, first + count,
+                   std::min((int64_t)ceil((double)(loop_.start + 1) / rate), variant_->length));
+    } else if (loop_.preroll) {
+        readPlanes(loop_.preroll->channels, loop_.preroll->start, lead, step, converter, mix_, first, first + count,
+                   loop_.start + 1);
+    } else {
+        readPlanes(file_->channels, 0, lead, step, converter, mix_, first, first + count, loop_.start + 1);
+    }
+
+    // Equal-power over file frames, all lead-in by the time the wrap lands on the loop start
+    const double fadeFrom = (double)(loop_.end - loop_.crossfadeFrames);
+    const int channels = std::min(out.channels(), mix_.channels());
+    for (int c = 0; c < channels; c++) {
+        float* dst = out.channel(c) + first;
+        const float* in = mix_.channel(c) + first;
+        for (int i = 0; i < count; i++) {
+            const double done = (from + (double)i * step * rate - fadeFrom + 0.5) / (double)loop_.crossfadeFrames;
+            const float x = (float)std::clamp(done, 0.0, 1.0) * (float)M_PI_2;
+            dst[i] = dst[i] * cosf(x) + in[i] * sinf(x);
+        }
+    }
+}
+
+void PlayerNode::render(const RenderContext& ctx, Buffer& out, int frames) {
+    out.clear(frames);
+    if (!playing_.load(std::memory_order_acquire)) {
+        return;
+    }
+    playerTime_.fetch_add(frames, std::memory_order_acq_rel);
+    if (!file_) {
+        return;
+    }
+    if (seek_.pending) {
+        applySeek(ctx);
+    }
+    if (skip_) {
+        applySkip(ctx);
+    }
+
+    int frame = 0;
+    while (frame < frames && !schedule_.empty()) {
+        const Segment& segment = schedule_.front();
+        const AudioFile* file = sourceOf(segment);
+        const int64_t end = std::min(segment.end, file->length);
+        if (position_ < 0.0) {
+            position_ = origin_ = (double)segment.start;
+            loops_ = 0;
+            if (stream_ && !segment.file) {
+                stream_pool_seek(stream_, segment.start);
+            }
+        }
+        if ((int64_t)position_ >= end) {
+            frame_ = (double)end;
+            completeFront();
+            continue;
+        }
+        // Up to the loop end while looping (blending in the loop start's lead-in
+        // over its crossfade); otherwise a next segment with a fade-in overlaps
+        // the last of this one
+        const bool looping = loop_.end > 0 && !segment.file && (int64_t)position_ < loop_.end;
+        int64_t stop = end;
+        bool overlapping = false;
+        bool leadIn = false;
+        if (looping) {
+            const int64_t fadeFrom = loop_.end - loop_.crossfadeFrames;
+            leadIn = (int64_t)position_ >= fadeFrom;
+            stop = std::min(end, leadIn ? loop_.end : fadeFrom);
+        } else if (schedule_.size() > 1 && schedule_[1].fadeInFrames > 0) {
+            const double step = file->sampleRate / ctx.sampleRate;
+            stop = std::max(segment.start, end - (int64_t)llround(schedule_[1].fadeInFrames * step));
+            overlapping = (int64_t)position_ >= stop;
+            if (overlapping) {
+                stop = end;
+            }
+        }
+        const double from = position_;
+        const int read = readFront(ctx, out, frame, frames, stop);
+        if (overlapping) {
+            mixIncoming(ctx, out, frame, read);
+        }
+        if (leadIn) {
+            mixLoopTail(ctx, out, frame, read, from);
+        }
+        frame += read;
+        if (looping && (int64_t)position_ >= loop_.end) {
+            // Same phase past the loop start; a streaming player plays the loop
+            // preroll while the I/O thread refills from where it ends
+            const double length = (double)(loop_.end - loop_.start);
+            while ((int64_t)position_ >= loop_.end) {
+                position_ -= length;
+            }
+            loops_++;
+            if (stream_) {
+                preroll_ = loop_.preroll;
+                stream_pool_restart(stream_, preroll_ ? preroll_->start + preroll_->frames : loop_.start);
+            }
+            continue;
+        }
+        if (stream_ && !segment.file && frame < frames && (int64_t)position_ < stop) {
+            stream_pool_underrun(stream_, frames - frame);
+            break;  // Silence for the rest of the cycle; resume from here next time
+        }
+    }
+
+    // Equal-power crossfade from the pre-seek continuation into the new position
+    if (fadeDone_ < fadeFrames_) {
+        const int count = std::min(frames, fadeFrames_ - fadeDone_);
+        const int channels = std::min(out.channels(), fade_.channels());
+        for (int c = 0; c < channels; c++) {
+            float* dst = out.channel(c);
+            const float* tail = fade_.channel(c) + fadeDone_;
+            for (int i = 0; i < count; i++) {
+                const float x = ((float)(fadeDone_ + i) + 0.5f) / (float)fadeFrames_ * (float)M_PI_2;
+                dst[i] = dst[i] * sinf(x) + tail[i] * cosf(x);
+            }
+        }
+        fadeDone_ += count;
+    }
+    const AudioFile* heard = schedule_.empty() ? file_ : sourceOf(schedule_.front());
+    const double rate = variant_ && heard == file_ ? variantRate_.load(std::memory_order_relaxed) : 1.0;
+    publishPlayhead(ctx.sampleTime, heard->sampleRate / ctx.sampleRate * rate, true);
+}
+
+void PlayerNode::publishPlayhead(int64_t cycle, double speed, bool playing) {
+    if (position_ >= 0.0) {
+        frame_ = position_;
+    } else if (!schedule_.empty()) {
+        frame_ = (double)schedule_.front().start;  // Scheduled, not started yet
+    }
+    const double loopLength = loop_.end > 0 ? (double)(loop_.end - loop_.start) : 0.0;
+    playhead_publish(&playhead_, cycle, frame_, origin_, speed, loops_, (double)loop_.start, loopLength,
+                     playhead_clock_ns(), playing && !schedule_.empty());
+}
+
+// ==============================================
+// PitchShiftNode
+// ==============================================
+
+PitchShiftNode::~PitchShiftNode() {
+    pitchshift_free(&shifter_);
+}
+
+void PitchShiftNode::prepare(int maxFrames) {
+    const double sampleRate = engine ? engine->format.sampleRate : kDefaultSampleRate;
+    const bool resized = outputChannelCount() != shifter_.channelCount || sampleRate != sampleRate_;
+    Node::prepare(maxFrames);
+    variantMix_.resize(outputChannelCount(), maxFrames);
+    if (!resized) {
+        return;  // Keep DSP state across unrelated topology changes
+    }
+
+    pitchshift_free(&shifter_);
+    primed_ = false;
+    bypassing_ = false;
+    sampleRate_ = sampleRate;
+    if (const char* err = pitchshift_init(&shifter_, sampleRate, outputChannelCount(), quality_, fftSize_)) {
+        logf("Pitch shift unavailable: %s", err);
+    }
+}
+
+void PitchShiftNode::reset() {
+    finishVariantFade();
+    if (shifter_.channelCount) {
+        pitchshift_clear(&shifter_);
+    }
+    primed_ = false;
+    bypassing_ = false;
+}
+
+const char* PitchShiftNode::configure(int quality, int fftSize) {
+    const double sampleRate = engine ? engine->format.sampleRate : kDefaultSampleRate;
+    PitchShifter shifter;
+    if (const char* err = pitchshift_init(&shifter, sampleRate, std::max(outputChannelCount(), 1), quality, fftSize)) {
+        return err;
+    }
+    pitchshift_free(&shifter_);
+    shifter_ = shifter;
+    primed_ = false;
+    bypassing_ = false;
+    sampleRate_ = sampleRate;
+    quality_ = quality;
+    fftSize_ = fftSize;
+    return NULL;
+}
+
+void PitchShiftNode::describe(PitchShiftOptions* options, PitchShiftInfo* info) const {
+    int fftSize = 0;
+    int overlap = 0;
+    pitchshift_tier(quality_, &fftSize, &overlap);
+    fftSize = fftSize_ ? fftSize_ : fftSize;
+    options->quality = quality_;
+    options->fftSize = fftSize_;
+    options->preserveFormants = preserveFormants.load();
+    info->fftSize = fftSize;
+    info->hop = fftSize / overlap;
+    info->latency = fftSize;
+    info->kernel = resampler_kernel_label(shifter_.channelCount ? shifter_.kernel : resampler_pick_kernel());
+}
+
+int PitchShiftNode::latency() const {
+    PlayheadSlot slot;
+    return readLookahead(&slot) ? (int)lround(slot.frame) : 0;
+}
+
+const Buffer* PitchShiftNode::elide(const RenderContext& ctx, int frames) {
+    const Connection* conn = static_cast<const Node*>(this)->input(0);
+    if (pitch.load(std::memory_order_relaxed) != 0.0f || fade_.variant || !conn || !conn->source ||
+        shifter_.channelCount != conn->source->outputChannelCount()) {
+        return nullptr;
+    }
+    if (!bypassing_) {
+        if (primed_ && !pitchshift_is_identity(&shifter_)) {
+            return nullptr;  // Still winding down
+        }
+        bypassing_ = true;
+        held_ = primed_ ? shifter_.fftSize : 0;
+        drained_ = 0;
+    }
+    if (drained_ < held_) {
+        return nullptr;  // render() plays them first
+    }
+    playhead_publish(&lookahead_, ctx.sampleTime, 0.0, 0.0, 1.0, 0, 0.0, 0.0, playhead_clock_ns(), true);
+    return pullInput(ctx, 0, frames);
+}
+
+void PitchShiftNode::fadeOutVariant(const AudioFile* variant, double rate, double position, int frames,
+                                    PlayerNode* player) {
+    fade_ = VariantFade{variant, rate, position / rate, std::max(frames, 1), 0, false, player, nullptr};
+}
+
+void PitchShiftNode::fadeInVariant(const AudioFile* variant, double rate, int frames, PlayerNode* player,
+                                   TimeStretchNode* timeStretch) {
+    fade_ = VariantFade{variant, rate, -1.0, std::max(frames, 1), 0, true, player, timeStretch};
+}
+
+void PitchShiftNode::finishVariantFade() {
+    if (fade_.variant && fade_.in) {
+        handOff(fade_.position >= 0.0 ? fade_.position * fade_.rate : -1.0);
+    }
+    fade_ = VariantFade{};
+}
+
+bool PitchShiftNode::revertVariantFade() {
+    if (!fade_.variant || fade_.done > 0) {
+        return false;
+    }
+    if (!fade_.in) {
+        fade_.player->setVariant(fade_.variant, fade_.rate);
+    }
+    fade_ = VariantFade{};
+    return true;
+}
+
+// File frame the player's listener hears `before` output frames ahead of the
+// end of this block, from the frames both units hold
+double PitchShiftNode::heardFrame(int before) const {
+    PlayheadSlot head = {};
+    PlayheadSlot stretch = {};
+    PlayheadSlot ahead = {};
+    stretch.speed = 1.0;
+    if (!fade_.player->readPlayhead(&head)) {
+        return -1.0;
+    }
+    fade_.timeStretch->readLookahead(&stretch);
+    readLookahead(&ahead);
+    double frame = head.frame - (stretch.frame + (ahead.frame + before) * stretch.speed) * head.speed;
+    if (head.loops > 0 && head.loopLength > 0.0 && frame < head.loopStart) {
+        frame += head.loopLength;  // Still hearing the pass before the last wrap
+    }
+    return std::max(head.origin, frame);
+}
+
+// Move the player onto the faded-in variant at file frame `position` (< 0 to
+// leave it where it is) and the units to unity; both are routed around from
+// the next block, having been reset
+void PitchShiftNode::handOff(double position) {
+    const VariantFade fade = fade_;
+    fade_ = VariantFade{};
+    fade.player->setVariant(fade.variant, fade.rate);
+    if (position >= 0.0) {
+        fade.player->continueFrom(position);
+    }
+    fade.timeStretch->rate.store(1.0f, std::memory_order_relaxed);
+    fade.timeStretch->reset();
+    pitch.store(0.0f, std::memory_order_relaxed);
+    if (shifter_.channelCount) {
+        pitchshift_clear(&shifter_);
+    }
+    primed_ = false;
+    bypassing_ = false;
+}
+
+void PitchShiftNode::render(const RenderContext& ctx, Buffer& out, int frames) {
+    process(ctx, out, frames);
+    if (fade_.variant) {
+        mixVariant(ctx, out, frames);
+    }
+}
+
+// Equal-power between what the units play and the variant read here. A
+// finished fade-in plays the variant alone to the end of the block and the
+// player carries on from there.
+void PitchShiftNode::mixVariant(const RenderContext& ctx, Buffer& out, int frames) {
+    VariantFade& fade = fade_;
+    const PlayerNode* player = fade.player;
+    if (!player->isPlaying() || !player->hasSchedule() || player->frontFile()) {
+        // Nothing of the file is heard to fade against
+        if (fade.in) {
+            handOff(heardFrame(0));
+        }
+        fade_ = VariantFade{};
+        return;
+    }
+    if (fade.position < 0.0) {
+        fade.position = std::max(heardFrame(frames), 0.0) / fade.rate;  // From this block's first frame
+    }
+
+    const int count = std::min(frames, fade.frames - fade.done);
+    const int wanted = fade.in ? frames : count;
+    const double step = fade.variant->sampleRate / ctx.sampleRate;
+    const LoopRegion& loop = player->loop();
+    variantMix_.clear(wanted);
+    for (int at = 0; at < wanted;) {
+        const bool looping = loop.end > 0 && fade.position * fade.rate < (double)loop.end;
+        const int64_t end = looping ? std::min((int64_t)ceil((double)loop.end / fade.rate), fade.variant->length)
+                                    : fade.variant->length;
+        at += readPlanes(fade.variant->channels, 0, fade.position, step,
+                         player->converterFor(fade.variant->sampleRate, ctx.sampleRate), variantMix_, at, wanted, end);
+        if (at < wanted && looping) {
+            fade.position -= (double)(loop.end - loop.start) / fade.rate;  // Wrap like the player
+        } else if (at < wanted) {
+            break;  // Past the end of the variant
+        }
+    }
+
+    const int channels = std::min(out.channels(), variantMix_.channels());
+    for (int c = 0; c < channels; c++) {
+        float* dst = out.channel(c);
+        const float* in = variantMix_.channel(c);
+        for (int i = 0; i < count; i++) {
+            const float x = ((float)(fade.done + i) + 0.5f) / (float)fade.frames * (float)M_PI_2;
+            dst[i] = fade.in ? dst[i] * cosf(x) + in[i] * sinf(x) : dst[i] * sinf(x) + in[i] * cosf(x);
+        }
+        if (fade.in) {
+            memcpy(dst + count, in + count, (size_t)(frames - count) * sizeof(float));
+        }
+    }
+    fade.done += count;
+    if (fade.done >= fade.frames) {
+        if (fade.in) {
+            handOff(fade.position * fade.rate);
+        }
+        fade_ = VariantFade{};
+    }
+}
+
+void PitchShiftNode::process(const RenderContext& ctx, Buffer& out, int frames) {
+    if (!static_cast<const Node*>(this)->input(0) || !static_cast<const Node*>(this)->input(0)->source ||
+        shifter_.channelCount != out.channels()) {
+        out.clear(frames);
+        return;
+    }
+
+    const float cents = pitch.load(std::memory_order_relaxed);
+    const bool formants = preserveFormants.load(std::memory_order_relaxed);
+    auto shift = [&](int count, float by) {
+        const Buffer* in = pullInput(ctx, 0, count);
+        if (in && in->channels() == shifter_.channelCount) {
+            pitchshift_run(&shifter_, in->channel(0), in->capacity(), out.channel(0), out.capacity(), count, by,
+                           formants);
+        } else {
+            out.clear(count);
+            pitchshift_run(&shifter_, out.channel(0), out.capacity(), out.channel(0), out.capacity(), count, by,
+                           formants);
+        }
+    };
+    if (bypassing_ && cents == 0.0f) {
+        // Routed around: the held frames, then the input
+        const int count = std::min(frames, held_ - drained_);
+        pitchshift_read_held(&shifter_, drained_, out.channel(0), out.capacity(), count);
+        drained_ += count;
+        if (count < frames) {
+            const Buffer* in = pullInput(ctx, 0, frames - count);
+            for (int c = 0; c < out.channels(); c++) {
+                if (in && in->channels() == out.channels()) {
+                    memcpy(out.channel(c) + count, in->channel(c), (size_t)(frames - count) * sizeof(float));
+                } else {
+                    memset(out.channel(c) + count, 0, (size_t)(frames - count) * sizeof(float));
+                }
+            }
+        }
+        playhead_publish(&lookahead_, ctx.sampleTime, (double)(held_ - drained_), 0.0, 1.0, 0, 0.0, 0.0,
+                         playhead_clock_ns(), true);
+        return;
+    }
+    if (bypassing_) {
+        // Back in: past the held frames already played, or read ahead afresh
+        bypassing_ = false;
+        if (drained_ == held_) {
+            pitchshift_clear(&shifter_);
+            primed_ = false;
+        }
+        for (int skipped = 0; primed_ && skipped < drained_; skipped += maxFrames()) {
+            shift(std::min(maxFrames(), drained_ - skipped), 0.0f);
+        }
+    }
+    // The silence the shifter starts with is never heard, and at 0 cents the
+    // shift fades in from the unshifted input over the next frame
+    for (int primed = 0; !primed_ && primed < shifter_.fftSize; primed += maxFrames()) {
+        shift(std::min(maxFrames(), shifter_.fftSize - primed), 0.0f);
+    }
+    primed_ = true;
+    shift(frames, cents);
+
+    playhead_publish(&lookahead_, ctx.sampleTime, (double)shifter_.fftSize, 0.0, 1.0, 0, 0.0, 0.0,
+                     playhead_clock_ns(), true);
+}
+
+// ==============================================
+// TimeStretchNode
+// ==============================================
+
+TimeStretchNode::~TimeStretchNode() {
+    wsola_free(&wsola_);
+}
+
+void TimeStretchNode::prepare(int maxFrames) {
+    const double sampleRate = engine ? engine->format.sampleRate : kDefaultSampleRate;
+    const bool resized = maxFrames != this->maxFrames() || outputChannelCount() != wsola_.channelCount ||
+                         sampleRate != sampleRate_;
+    Node::prepare(maxFrames);
+    if (!resized) {
+        return;  // Keep DSP state across unrelated topology changes
+    }
+
+    wsola_free(&wsola_);
+    bypassing_ = false;
+    sampleRate_ = sampleRate;
+    if (const char* err = wsola_init(&wsola_, sampleRate, outputChannelCount(), maxFrames)) {
+        logf("Time stretch unavailable: %s", err);
+    }
+}
+
+void TimeStretchNode::reset() {
+    if (wsola_.channelCount) {
+        wsola_reset(&wsola_);
+    }
+    bypassing_ = false;
+}
+
+int TimeStretchNode::latency() const {
+    PlayheadSlot slot;
+    return readLookahead(&slot) ? (int)lround(slot.frame) : 0;
+}
+
+const Buffer* TimeStretchNode::elide(const RenderContext& ctx, int frames) {
+    const Connection* conn = static_cast<const Node*>(this)->input(0);
+    if (rate.load(std::memory_order_relaxed) != 1.0f || !conn || !conn->source ||
+        wsola_.channelCount != conn->source->outputChannelCount()) {
+        return nullptr;
+    }
+    if (!bypassing_) {
+        bypassing_ = true;
+        held_ = wsola_held(&wsola_);
+        drained_ = 0;
+    }
+    if (drained_ < held_) {
+        return nullptr;  // render() plays them first
+    }
+    playhead_publish(&lookahead_, ctx.sampleTime, 0.0, 0.0, 1.0, 0, 0.0, 0.0, playhead_clock_ns(), true);
+    return pullInput(ctx, 0, frames);
+}
+
+void TimeStretchNode::render(const RenderContext& ctx, Buffer& out, int frames) {
+    if (!static_cast<const Node*>(this)->input(0) || !static_cast<const Node*>(this)->input(0)->source ||
+        wsola_.channelCount != out.channels()) {
+        out.clear(frames);
+        return;
+    }
+
+    const double speed = (double)rate.load(std::memory_order_relaxed);
+    if (bypassing_ && speed == 1.0) {
+        // Routed around: the held frames, then the input
+        const int count = std::min(frames, held_ - drained_);
+        wsola_read_held(&wsola_, drained_, out.channel(0), out.capacity(), count);
+        drained_ += count;
+        if (count < frames) {
+            const Buffer* in = pullInput(ctx, 0, frames - count);
+            for (int c = 0; c < out.channels(); c++) {
+                if (in && in->channels() == out.channels()) {
+                    memcpy(out.channel(c) + count, in->channel(c), (size_t)(frames - count) * sizeof(float));
+                } else {
+                    memset(out.channel(c) + count, 0, (size_t)(frames - count) * sizeof(float));
+                }
+            }
+        }
+        playhead_publish(&lookahead_, ctx.sampleTime, (double)(held_ - drained_), 0.0, 1.0, 0, 0.0, 0.0,
+                         playhead_clock_ns(), true);
+        return;
+    }
+
+    // Pull a block only when the next grain reaches past what is held
+    auto fill = [&](int count, double at) {
+        while (wsola_available(&wsola_) < count) {
+            if (wsola_input_needed(&wsola_, at) == 0) {
+                wsola_synthesize(&wsola_, at);
+                continue;
+            }
+            const int chunk = maxFrames();
+            const Buffer* in = pullInput(ctx, 0, chunk);
+            if (in && in->channels() == wsola_.channelCount) {
+                wsola_write(&wsola_, in->channel(0), in->capacity(), chunk);
+            } else {
+                wsola_write(&wsola_, nullptr, 0, chunk);
+            }
+        }
+    };
+    if (bypassing_) {
+        // Back in: past the held frames already played (at rate 1 the
+        // stretcher plays exactly those), or from the input's next frame
+        bypassing_ = false;
+        if (drained_ == held_) {
+            wsola_reset(&wsola_);
+        }
+        for (int skipped = 0; drained_ < held_ && skipped < drained_; skipped += maxFrames()) {
+            const int count = std::min(maxFrames(), drained_ - skipped);
+            fill(count, 1.0);
+            wsola_read(&wsola_, out.channel(0), out.capacity(), count);
+        }
+    }
+    fill(frames, speed);
+    wsola_read(&wsola_, out.channel(0), out.capacity(), frames);
+
+    playhead_publish(&lookahead_, ctx.sampleTime, wsola_lookahead(&wsola_), 0.0, wsola_.speed, 0, 0.0, 0.0,
+                     playhead_clock_ns(), true);
+}
+
+}  // namespace headless
+
+using headless::AudioFile;
+using headless::Engine;
+using headless::GraphLock;
+using headless::Node;
+using headless::PlayerNode;
+using headless::PitchShiftNode;
+using headless::TimeStretchNode;
+
+static PlayerNode* playerNodeOf(AudioPlayer* player) {
+    return static_cast<PlayerNode*>(static_cast<Node*>(player->playerNode));
+}
+
+static PitchShiftNode* pitchShiftOf(AudioPlayer* player) {
+    return static_cast<PitchShiftNode*>(static_cast<Node*>(player->timePitchUnit));
+}
+
+static TimeStretchNode* timeStretchOf(AudioPlayer* player) {
+    return static_cast<TimeStretchNode*>(static_cast<Node*>(player->timeStretchUnit));
+}
+
+static const AudioFile* audioFileOf(AudioPlayer* player) {
+    return static_cast<const AudioFile*>(player->audioFile);
+}
+
+// Persistent analysis cache (analysiscache.h). File work runs on a copy of the
+// directory outside the lock; stores, evictions and counters are serialised by it.
+static std::mutex analysisCacheMutex;
+static std::string analysisCacheDirectory;  // Empty while closed
+static AnalysisCacheStats analysisCacheCounters = {};
+
+static std::string analysisCacheDir() {
+    std::lock_guard<std::mutex> lock(analysisCacheMutex);
+    return analysisCacheDirectory;
+}
+
+static void countAnalysisCache(bool hit) {
+    std::lock_guard<std::mutex> lock(analysisCacheMutex);
+    if (!analysisCacheDirectory.empty()) {
+        (hit ? analysisCacheCounters.hits : analysisCacheCounters.misses)++;
+    }
+}
+
+// Shared decoded audio (pcmcache.h). Files decode outside the lock; the
+// table, references and counters are serialised by it.
+static std::mutex pcmCacheMutex;
+static PcmCache pcmCache = {};
+
+// Evict unused entries until the cache is within its budget
+static void trimPcmCache() {
+    void* evicted[16];
+    int count;
+    do {
+        {
+            std::lock_guard<std::mutex> lock(pcmCacheMutex);
+            count = pcm_cache_trim(&pcmCache, evicted, 16);
+        }
+        for (int i = 0; i < count; i++) {
+            delete static_cast<AudioFile*>(evicted[i]);
+        }
+    } while (count == 16);
+}
+
+// Decode `path` into `*out`, or while the cache is on share the copy another
+// player already decoded. Release with releaseAudioFile.
+static const char* acquireAudioFile(const char* path, const AudioFile** out) {
+    int64_t size = 0;
+    int64_t modified = 0;
+    bool shared;
+    {
+        std::lock_guard<std::mutex> lock(pcmCacheMutex);
+        shared = pcmCache.stats.budgetBytes > 0 && pcm_cache_identify(path, &size, &modified);
+        if (shared) {
+            if (void* payload = pcm_cache_acquire(&pcmCache, path, size, modified, 0.0, 0)) {
+                *out = static_cast<const AudioFile*>(payload);
+                return NULL;
+            }
+        }
+    }
+
+    AudioFile* file = new (std::nothrow) AudioFile();
+    if (!file) {
+        return "Memory allocation failed";
+    }
+    if (const char* err = headless::loadAudioFile(path, file)) {
+        delete file;
+        return err;
+    }
+    *out = file;
+    if (shared) {
+        const int64_t bytes = (int64_t)file->channelCount * file->length * (int64_t)sizeof(float);
+        void* payload;
+        {
+            std::lock_guard<std::mutex> lock(pcmCacheMutex);
+            payload = pcm_cache_insert(&pcmCache, path, size, modified, 0.0, 0, file, bytes);
+        }
+        if (payload && payload != file) {
+            delete file;  // Another player cached it first
+            *out = static_cast<const AudioFile*>(payload);
+        }
+    }
+    return NULL;
+}
+
+// Drop a player's file: its reference if shared, the file itself otherwise
+static void releaseAudioFile(const AudioFile* file) {
+    if (!file) {
+        return;
+    }
+    bool shared;
+    {
+        std::lock_guard<std::mutex> lock(pcmCacheMutex);
+        shared = pcm_cache_release(&pcmCache, file);
+    }
+    if (shared) {
+        trimPcmCache();
+    } else {
+        delete file;
+    }
+}
+
+// Format fields of a loaded file as stored in its cache record
+static void describeFile(const AudioFile* file, AnalysisRecord* record) {
+    memset(record, 0, sizeof(*record));
+    record->items = ANALYSIS_CACHE_FORMAT;
+    record->channelCount = file->channelCount;
+    record->sampleRate = file->sampleRate;
+    record->frames = file->length;
+    snprintf(record->format, sizeof(record->format), "%s", file->description.c_str());
+}
+
+// Merge `update` (and a pyramid) into the entry of `path`, hashing the file if
+// its alias is stale, then evict down to the cap. `stored` receives the merged
+// record. Returns false when the cache is closed or the write failed.
+static bool storeAnalysis(const std::string& path, const AnalysisRecord* update, const PeakPyramid* pyramid,
+                          AnalysisRecord* stored) {
+    const std::string directory = analysisCacheDir();
+    char hash[ANALYSIS_CACHE_HASH_LENGTH];
+    if (directory.empty() || !analysis_cache_key(directory.c_str(), path.c_str(), 1, hash)) {
+        return false;
+    }
+    std::lock_guard<std::mutex> lock(analysisCacheMutex);
+    if (directory != analysisCacheDirectory || !analysis_cache_store(directory.c_str(), hash, update, pyramid)) {
+        return false;
+    }
+    if (stored) {
+        analysis_cache_read(directory.c_str(), hash, stored);
+    }
+    int64_t bytes;
+    int entries;
+    const int evicted = analysis_cache_evict(directory.c_str(), analysisCacheCounters.maxBytes, &bytes, &entries);
+    if (evicted > 0) {
+        analysisCacheCounters.evictions += evicted;
+        analysis_cache_prune_aliases(directory.c_str());
+    }
+    return true;
+}
+
+static AnalysisRecord* analysisOf(AudioPlayer* player) {
+    return static_cast<AnalysisRecord*>(player->analysis);
+}
+
+// Read the cached record of `path` into the player's copy. Without allowHash
+// only a fresh alias is used, so an unknown file costs a stat, not a read.
+static bool loadAnalysis(AudioPlayer* player, const std::string& path, bool allowHash) {
+    const std::string directory = analysisCacheDir();
+    char hash[ANALYSIS_CACHE_HASH_LENGTH];
+    AnalysisRecord record;
+    if (directory.empty() || !analysis_cache_key(directory.c_str(), path.c_str(), allowHash, hash) ||
+        !analysis_cache_read(directory.c_str(), hash, &record)) {
+        return false;
+    }
+    if (!player->analysis) {
+        player->analysis = malloc(sizeof(AnalysisRecord));
+        if (!player->analysis) {
+            return false;
+        }
+    }
+    *analysisOf(player) = record;
+    return true;
+}
+
+// The player's cached record if it holds `item`, looking the file up by content
+// before giving up. Counts a hit or a miss.
+static const AnalysisRecord* cachedAnalysis(AudioPlayer* player, uint32_t item) {
+    const AudioFile* file = audioFileOf(player);
+    const AnalysisRecord* record = analysisOf(player);
+    if (!(record && (record->items & item)) && loadAnalysis(player, file->path, true)) {
+        record = analysisOf(player);
+    }
+    const bool hit = record && (record->items & item);
+    countAnalysisCache(hit);
+    return hit ? record : nullptr;
+}
+
+// Store a whole-file result and refresh the player's copy
+static void rememberAnalysis(AudioPlayer* player, const AnalysisRecord* update) {
+    AnalysisRecord stored;
+    if (storeAnalysis(audioFileOf(player)->path, update, nullptr, &stored)) {
+        if (!player->analysis) {
+            player->analysis = malloc(sizeof(AnalysisRecord));
+        }
+        if (player->analysis) {
+            *analysisOf(player) = stored;
+        }
+    }
+}
+
+// Waveform overview job: one background build of the loaded file's peak
+// pyramid. The pyramid is published by `ready` and not written afterwards, so
+// queries read it without locking.
+struct PeakJob {
+    const AudioFile* file = nullptr;
+    bool persist = false;
+    bool cached = false;        // Written before ready
+    const char* error = NULL;   // Written before failed
+    std::atomic<bool> cancelled{false};
+    std::atomic<bool> ready{false};
+    std::atomic<bool> failed{false};
+    std::atomic<int64_t> progressFrames{0};
+    PeakPyramid pyramid{};
+    std::thread thread;
+
+    ~PeakJob() {
+        cancelled.store(true, std::memory_order_relaxed);
+        if (thread.joinable()) {
+            thread.join();
+        }
+        peaks_free(&pyramid);
+    }
+
+    void fail(const char* message) {
+        error = message;
+        failed.store(true, std::memory_order_release);
+    }
+};
+
+static void runPeakJob(PeakJob* job) {
+    const AudioFile* file = job->file;
+    const std::string directory = analysisCacheDir();
+    char hash[ANALYSIS_CACHE_HASH_LENGTH];
+    if (!directory.empty()) {
+        const bool hit = analysis_cache_key(directory.c_str(), file->path.c_str(), 1, hash) &&
+                         analysis_cache_read_peaks(directory.c_str(), hash, &job->pyramid);
+        countAnalysisCache(hit);
+        if (hit) {
+            job->cached = true;
+            job->progressFrames.store(file->length, std::memory_order_relaxed);
+            job->ready.store(true, std::memory_order_release);
+            return;
+        }
+    }
+
+    const std::string sidecar = file->path + ".peaks";
+    struct stat info;
+    const bool identified = stat(file->path.c_str(), &info) == 0;
+
+    if (job->persist && identified &&
+        peaks_load(&job->pyramid, sidecar.c_str(), file->channelCount, file->sampleRate, file->length,
+                   (int64_t)info.st_size, (int64_t)info.st_mtime)) {
+        job->cached = true;
+        job->progressFrames.store(file->length, std::memory_order_relaxed);
+        job->ready.store(true, std::memory_order_release);
+        return;
+    }
+
+    if (!peaks_init(&job->pyramid, file->channelCount, file->sampleRate, file->length)) {
+        job->fail("Failed to allocate peaks");
+        return;
+    }
+    // Decoded files are in memory; feed them in blocks like the AVFoundation backend reads them
+    const int64_t chunkFrames = 65536;
+    std::vector<const float*> planes((size_t)file->channelCount);
+    for (int64_t offset = 0; offset < file->length; offset += chunkFrames) {
+        if (job->cancelled.load(std::memory_order_relaxed)) {
+            return;
+        }
+        for (int c = 0; c < file->channelCount; c++) {
+            planes[(size_t)c] = file->channels[(size_t)c].data() + offset;
+        }
+        if (!peaks_add(&job->pyramid, planes.data(), (int)std::min(chunkFrames, file->length - offset))) {
+            job->fail("Failed to allocate peaks");
+            return;
+        }
+        job->progressFrames.store(job->pyramid.frames, std::memory_order_relaxed);
+    }
+    if (!peaks_finish(&job->pyramid)) {
+        job->fail("Failed to allocate peaks");
+        return;
+    }
+
+    if (job->persist && identified &&
+        !peaks_save(&job->pyramid, sidecar.c_str(), (int64_t)info.st_size, (int64_t)info.st_mtime)) {
+        headless::logf("Failed to write peaks file %s", sidecar.c_str());
+    }
+    if (!directory.empty()) {
+        AnalysisRecord record;
+        describeFile(file, &record);
+        storeAnalysis(file->path, &record, &job->pyramid, nullptr);
+    }
+    job->ready.store(true, std::memory_order_release);
+}
+
+static PeakJob* peakJobOf(AudioPlayer* player) {
+    return static_cast<PeakJob*>(player->peaks);
+}
+
+// Cancel and free the player's overview job (it belongs to the current file)
+static void stopPeaks(AudioPlayer* player) {
+    delete peakJobOf(player);
+    player->peaks = NULL;
+}
+
+// ==============================================
+// Streaming playback
+// ==============================================
+
+// Read-ahead state of a streaming player: the pool its PlayerNode reads and
+// the I/O thread filling it through its own reader. The thread runs while a
+// file is attached and is stopped before that file is replaced. Seeks decode
+// one buffer at the target through a second reader into whichever of the two
+// prerolls the node is not playing; loop regions decode their start the same
+// way into one of three (the node may hold a new one while playing the last).
+struct PlayerStream {
+    int bufferFrames = 0;  // As requested; the pool clamps them
+    int bufferCount = 0;
+    const AudioFile* file = nullptr;  // Attached file, null while stopped
+    StreamPool pool{};
+    headless::AudioFileReader reader;
+    std::thread thread;
+    std::mutex mutex;
+    std::condition_variable wake;
+    bool stopping = false;  // Guarded by mutex
+    headless::AudioFileReader seekReader;
+    headless::SeekPreroll prerolls[2];
+    headless::SeekPreroll loopPrerolls[3];
+    std::mutex seekMutex;  // One seek or loop region decodes at a time
+
+    ~PlayerStream() { stop(); }
+
+    void stop() {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            stopping = true;
+        }
+        wake.notify_all();
+        if (thread.joinable()) {
+            thread.join();
+        }
+        stream_pool_free(&pool);
+        file = nullptr;
+        stopping = false;
+    }
+};
+
+// Read `frames` frames from `start` plus a guard frame (a repeat of the last
+// one at the end of the file); a short read leaves silence
+static void readWithGuard(headless::AudioFileReader& reader, int64_t start, int frames, float* const* planes,
+                          int channelCount) {
+    const int64_t read = reader.read(start, frames + 1, planes);
+    for (int c = 0; c < channelCount; c++) {
+        float* plane = planes[c];
+        std::fill(plane + std::min<int64_t>(read, frames), plane + frames, 0.0f);
+        if (read <= frames) {
+            plane[frames] = frames > 0 ? plane[frames - 1] : 0.0f;
+        }
+    }
+}
+
+static void runStream(PlayerStream* stream) {
+    StreamPool* pool = &stream->pool;
+    const int64_t length = stream->file->length;
+    std::vector<float*> planes((size_t)pool->channelCount);
+    // The render thread never signals, so a full pool is polled a few times per buffer
+    const double bufferSeconds = (double)pool->bufferFrames / stream->file->sampleRate;
+    const auto poll = std::chrono::microseconds((int64_t)std::clamp(bufferSeconds / 4.0 * 1e6, 1000.0, 20000.0));
+
+    uint32_t generation = 0;
+    int64_t cursor = 0;
+    std::unique_lock<std::mutex> lock(stream->mutex);
+    while (!stream->stopping) {
+        int64_t frame;
+        const uint32_t requested = stream_pool_request(pool, &frame);
+        if (requested != generation) {
+            generation = requested;
+            cursor = frame;
+        }
+        const int slot = cursor < length ? stream_pool_next_slot(pool) : -1;
+        if (slot < 0) {
+            stream->wake.wait_for(lock, poll);
+            continue;
+        }
+        lock.unlock();
+
+        for (int c = 0; c < pool->channelCount; c++) {
+            planes[(size_t)c] = stream_pool_plane(pool, slot, c);
+        }
+        const int frames = (int)std::min<int64_t>(pool->bufferFrames, length - cursor);
+        readWithGuard(stream->reader, cursor, frames, planes.data(), pool->channelCount);
+        stream_pool_publish(pool, cursor, frames, generation);
+        cursor += frames;
+        lock.lock();
+    }
+}
+
+static PlayerStream* streamOf(AudioPlayer* player) {
+    return static_cast<PlayerStream*>(player->stream);
+}
+
+// Give the node its loop region; a streaming player first decodes the frames
+// around the loop start into a loop preroll the node is not using
+static void applyLoop(AudioPlayer* player, headless::LoopRegion loop) {
+    PlayerNode* node = playerNodeOf(player);
+    PlayerStream* stream = streamOf(player);
+    std::unique_lock<std::mutex> seekLock;
+    loop.preroll = nullptr;
+    if (stream && stream->file && loop.end > 0) {
+        seekLock = std::unique_lock<std::mutex>(stream->seekMutex);
+        headless::SeekPreroll* preroll = nullptr;
+        {
+            GraphLock lock(node);
+            for (headless::SeekPreroll& candidate : stream->loopPrerolls) {
+                if (!preroll && !node->usesPreroll(&candidate)) {
+                    preroll = &candidate;
+                }
+            }
+        }
+        const int64_t from = loop.start - loop.crossfadeFrames;
+        preroll->start = from;
+        preroll->frames =
+            (int)std::min<int64_t>(loop.crossfadeFrames + stream->pool.bufferFrames, stream->file->length - from);
+        preroll->channels.resize((size_t)stream->file->channelCount);
+        std::vector<float*> planes(preroll->channels.size());
+        for (size_t c = 0; c < planes.size(); c++) {
+            preroll->channels[c].resize((size_t)preroll->frames + 1);
+            planes[c] = preroll->channels[c].data();
+        }
+        readWithGuard(stream->seekReader, from, preroll->frames, planes.data(), (int)planes.size());
+        loop.preroll = preroll;
+    }
+    GraphLock lock(node);
+    node->setLoop(loop);
+}
+
+// Stop reading ahead; the player node goes back to the decoded file
+static void detachStream(AudioPlayer* player) {
+    PlayerStream* stream = streamOf(player);
+    if (!stream || !stream->file) {
+        return;
+    }
+    {
+        PlayerNode* node = playerNodeOf(player);
+        GraphLock lock(node);
+        node->stop();
+        node->setStream(nullptr);
+        player->isPlaying = false;
+    }
+    stream->stop();
+}
+
+// Start reading the loaded file ahead and point the player node at the pool
+static const char* attachStream(AudioPlayer* player) {
+    PlayerStream* stream = streamOf(player);
+    const AudioFile* file = audioFileOf(player);
+    if (!stream || !file) {
+        return NULL;
+    }
+    if (!stream_pool_init(&stream->pool, file->channelCount, stream->bufferFrames, stream->bufferCount)) {
+        return "Failed to allocate streaming buffers";
+    }
+    const char* err = stream->reader.open(*file);
+    if (!err) {
+        err = stream->seekReader.open(*file);
+    }
+    if (err) {
+        stream_pool_free(&stream->pool);
+        return err;
+    }
+    for (headless::SeekPreroll& preroll : stream->prerolls) {
+        preroll.frames = 0;
+        preroll.channels.assign((size_t)file->channelCount, std::vector<float>((size_t)stream->pool.bufferFrames + 1));
+    }
+    stream->file = file;
+    stream->thread = std::thread(runStream, stream);
+
+    PlayerNode* node = playerNodeOf(player);
+    headless::LoopRegion loop;
+    {
+        GraphLock lock(node);
+        node->stop();
+        node->setStream(&stream->pool);
+        player->isPlaying = false;
+        loop = node->loop();
+    }
+    if (loop.end > 0) {
+        applyLoop(player, loop);  // Its start is now read from the stream
+    }
+    return NULL;
+}
+
+// Wait briefly for the first scheduled frame to be decoded, so playback does
+// not start with an underrun
+static void prerollStream(AudioPlayer* player) {
+    PlayerStream* stream = streamOf(player);
+    if (!stream || !stream->file) {
+        return;
+    }
+    PlayerNode* node = playerNodeOf(player);
+    for (int waited = 0; waited < 250; waited++) {
+        {
+            GraphLock lock(node);
+            if (node->primeStream()) {
+                return;
+            }
+        }
+        stream->wake.notify_all();  // Priming may have moved the read position
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+}
+
+// ==============================================
+// Gapless queue
+// ==============================================
+
+// A queued file, scheduled on the player node as a segment of its own. The
+// render thread only flags it finished from the segment's completion; control
+// calls take finished items out and release their files, so nothing is freed
+// while rendering.
+struct QueueItem {
+    int64_t id = 0;
+    const AudioFile* file = nullptr;
+    std::atomic<bool> finished{false};
+};
+
+struct PlayerQueue {
+    std::mutex mutex;  // One control call at a time
+    std::deque<std::unique_ptr<QueueItem>> items;  // Play order
+    int64_t nextId = 1;
+    int64_t played = 0;
+};
+
+static PlayerQueue* queueOf(AudioPlayer* player) {
+    return static_cast<PlayerQueue*>(player->queue);
+}
+
+// Completion of every scheduled segment: playback has ended once none is left
+static void finishSegment(AudioPlayer* player) {
+    if (!playerNodeOf(player)->hasSchedule()) {
+        player->isPlaying = false;
+        headless::logf("Audio playback completed");
+    }
+}
+
+// Take finished items out, counting them as played or not, and collect their
+// files to release once the graph is unlocked. Needs the queue mutex and the
+// graph lock.
+static void reapQueue(PlayerQueue* queue, bool played, std::vector<const AudioFile*>& released) {
+    for (auto it = queue->items.begin(); it != queue->items.end();) {
+        if ((*it)->finished.load(std::memory_order_acquire)) {
+            released.push_back((*it)->file);
+            queue->played += played ? 1 : 0;
+            it = queue->items.erase(it);
+        } else {
+            ++it;
+        }
+    }
+}
+
+// Release what stopping or replacing the file left finished in the queue
+static void reapFinished(AudioPlayer* player) {
+    PlayerQueue* queue = queueOf(player);
+    if (!queue) {
+        return;
+    }
+    std::lock_guard<std::mutex> queueLock(queue->mutex);
+    std::vector<const AudioFile*> released;
+    {
+        GraphLock lock(playerNodeOf(player));
+        reapQueue(queue, true, released);
+    }
+    for (const AudioFile* file : released) {
+        releaseAudioFile(file);
+    }
+}
+
+// ==============================================
+// Pre-rendered variants
+// ==============================================
+
+// Process-wide variant cache (variant.h). Payloads are AudioFiles holding a
+// variant at its file's sample rate, bookkept by pcmcache.h like decoded files
+// under variant_cache_key. Disk work runs on a copy of the directory outside
+// the lock; writes, evictions and counters are serialised by it.
+static std::mutex variantCacheMutex;
+static PcmCache variantCache = [] {
+    PcmCache cache = {};
+    cache.stats.budgetBytes = VARIANT_CACHE_DEFAULT_BUDGET;
+    return cache;
+}();
+static std::string variantCacheDirectory;  // Empty for memory only
+static int64_t variantDiskBudget = 0;
+static int64_t variantDiskHits = 0;
+static int64_t variantRenders = 0;
+
+// Evict variants nobody plays until the cache is within its budget
+static void trimVariantCache() {
+    void* evicted[16];
+    int count;
+    do {
+        {
+            std::lock_guard<std::mutex> lock(variantCacheMutex);
+            count = pcm_cache_trim(&variantCache, evicted, 16);
+        }
+        for (int i = 0; i < count; i++) {
+            delete static_cast<AudioFile*>(evicted[i]);
+        }
+    } while (count == 16);
+}
+
+// Reference the cached variant of `file`, or nullptr (counted as a miss)
+static const AudioFile* acquireVariant(const AudioFile* file, const VariantParams& params) {
+    int64_t size = 0;
+    int64_t modified = 0;
+    char* key = variant_cache_key(file->path.c_str(), &params);
+    if (!key || !pcm_cache_identify(file->path.c_str(), &size, &modified)) {
+        free(key);
+        return nullptr;
+    }
+    void* payload;
+    {
+        std::lock_guard<std::mutex> lock(variantCacheMutex);
+        payload = pcm_cache_acquire(&variantCache, key, size, modified, 0.0, 0);
+    }
+    free(key);
+    return static_cast<const AudioFile*>(payload);
+}
+
+static void releaseVariant(const AudioFile* variant) {
+    bool cached;
+    {
+        std::lock_guard<std::mutex> lock(variantCacheMutex);
+        cached = pcm_cache_release(&variantCache, variant);
+    }
+    if (cached) {
+        trimVariantCache();
+    } else {
+        delete variant;
+    }
+}
+
+// One audioplayer_prepare_variants request. Workers take variants in order
+// and find each in memory, on disk or by rendering it from `file`, which the
+// player keeps until the job is destroyed.
+struct VariantJob {
+    const AudioFile* file = nullptr;
+    int64_t fileSize = 0;
+    int64_t fileModified = 0;
+    std::vector<VariantParams> params;
+    std::vector<std::string> keys;  // variant_cache_key of each
+    std::atomic<int> next{0};
+    std::atomic<int> pending{0};
+    std::atomic<int> failed{0};
+    std::atomic<bool> cancelled{false};
+    std::mutex mutex;
+    std::string error;  // First failure, guarded by mutex
+    std::vector<std::thread> workers;
+
+    ~VariantJob() {
+        cancelled.store(true, std::memory_order_relaxed);
+        for (std::thread& worker : workers) {
+            worker.join();
+        }
+    }
+
+    bool cached(int index) {
+        std::lock_guard<std::mutex> lock(variantCacheMutex);
+        return pcm_cache_index(&variantCache, keys[(size_t)index].c_str(), fileSize, fileModified, 0.0, 0) >= 0;
+    }
+};
+
+static bool variantRenderProgress(void* context, double) {
+    return !static_cast<VariantJob*>(context)->cancelled.load(std::memory_order_relaxed);
+}
+
+// Hand a finished variant to the cache, where it stays while within budget
+static void cacheVariant(VariantJob* job, int index, AudioFile* variant) {
+    const int64_t bytes = (int64_t)variant->channelCount * variant->length * (int64_t)sizeof(float);
+    void* payload;
+    {
+        std::lock_guard<std::mutex> lock(variantCacheMutex);
+        payload = pcm_cache_insert(&variantCache, job->keys[(size_t)index].c_str(), job->fileSize, job->fileModified,
+                                   0.0, 0, variant, bytes);
+    }
+    if (payload != variant) {
+        delete variant;  // Made elsewhere meanwhile, or no room in the table
+    }
+    if (payload) {
+        releaseVariant(static_cast<const AudioFile*>(payload));
+    }
+}
+
+static const char* makeVariant(VariantJob* job, int index) {
+    if (job->cached(index)) {
+        std::lock_guard<std::mutex> lock(variantCacheMutex);
+        variantCache.stats.hits++;
+        return NULL;
+    }
+    const AudioFile* file = job->file;
+    const VariantParams& params = job->params[(size_t)index];
+    std::unique_ptr<AudioFile> variant(new (std::nothrow) AudioFile());
+    if (!variant) {
+        return "Memory allocation failed";
+    }
+    variant->path = file->path;
+    variant->sampleRate = file->sampleRate;
+    variant->channelCount = file->channelCount;
+    variant->length = variant_frames(file->length, params.rate);
+    variant->description = file->description;
+    std::vector<float*> planes((size_t)file->channelCount);
+    std::vector<const float*> input((size_t)file->channelCount);
+    try {
+        variant->channels.resize((size_t)file->channelCount);
+        for (int c = 0; c < file->channelCount; c++) {
+            variant->channels[(size_t)c].resize((size_t)variant->length);
+            planes[(size_t)c] = variant->channels[(size_t)c].data();
+            input[(size_t)c] = file->channels[(size_t)c].data();
+        }
+    } catch (const std::bad_alloc&) {
+        return "Memory allocation failed";
+    }
+
+    std::string directory;
+    int64_t diskBudget;
+    {
+        std::lock_guard<std::mutex> lock(variantCacheMutex);
+        variantCache.stats.misses++;
+        directory = variantCacheDirectory;
+        diskBudget = variantDiskBudget;
+    }
+    char hash[ANALYSIS_CACHE_HASH_LENGTH];
+    const bool hashed = !directory.empty() && analysis_cache_key(directory.c_str(), file->path.c_str(), 1, hash);
+    if (hashed) {
+        VariantRecord record;
+        FILE* entry = variant_cache_open(directory.c_str(), hash, &params, &record);
+        if (entry && (record.channelCount != file->channelCount || record.sampleRate != file->sampleRate ||
+                      record.sourceFrames != file->length)) {
+            fclose(entry);
+            entry = NULL;
+        }
+        if (entry && variant_cache_read(entry, &record, planes.data())) {
+            {
+                std::lock_guard<std::mutex> lock(variantCacheMutex);
+                variantDiskHits++;
+            }
+            cacheVariant(job, index, variant.release());
+            return NULL;
+        }
+    }
+
+    if (const char* err = variant_render(input.data(), file->channelCount, file->length, file->sampleRate, &params,
+                                         planes.data(), variantRenderProgress, job)) {
+        return err;
+    }
+    if (hashed) {
+        VariantRecord record = {};
+        memcpy(record.magic, VARIANT_CACHE_MAGIC, 8);
+        record.sampleRate = file->sampleRate;
+        record.sourceFrames = file->length;
+        record.frames = variant->length;
+        record.channelCount = file->channelCount;
+        record.params = params;
+        std::lock_guard<std::mutex> lock(variantCacheMutex);
+        if (variant_cache_write(directory.c_str(), hash, &record, planes.data())) {
+            int64_t bytes;
+            int entries;
+            variant_cache_evict(directory.c_str(), diskBudget, &bytes, &entries);
+        } else {
+            headless::logf("Failed to write variant to %s", directory.c_str());
+        }
+    }
+    {
+        std::lock_guard<std::mutex> lock(variantCacheMutex);
+        variantRenders++;
+    }
+    cacheVariant(job, index, variant.release());
+    return NULL;
+}
+
+static void runVariantJob(VariantJob* job) {
+    for (int index = job->next.fetch_add(1); index < (int)job->params.size() &&
+                                             !job->cancelled.load(std::memory_order_relaxed);
+         index = job->next.fetch_add(1)) {
+        const char* err = makeVariant(job, index);
+        if (err && !job->cancelled.load(std::memory_order_relaxed)) {
+            job->failed.fetch_add(1, std::memory_order_relaxed);
+            std::lock_guard<std::mutex> lock(job->mutex);
+            if (job->error.empty()) {
+                job->error = err;
+            }
+        }
+        job->pending.fetch_sub(1, std::memory_order_release);
+    }
+}
+
+// A player's variants: the rate and pitch as last set, whatever plays them,
+// the request in progress and the cache references of every variant its nodes
+// may still be reading
+struct PlayerVariants {
+    float rate = 1.0f;
+    float cents = 0.0f;
+    std::unique_ptr<VariantJob> job;
+    std::vector<const AudioFile*> held;
+};
+
+static PlayerVariants* variantsOf(AudioPlayer* player) {
+    return static_cast<PlayerVariants*>(player->variants);
+}
+
+// The variant parameters of a rate and pitch on this player's pitch shift
+// unit. Needs the graph lock.
+static VariantParams variantParams(AudioPlayer* player, float rate, float cents) {
+    PitchShiftOptions options;
+    PitchShiftInfo info;
+    pitchShiftOf(player)->describe(&options, &info);
+    return VariantParams{rate, cents, options.quality, options.fftSize, options.preserveFormants ? 1 : 0};
+}
+
+// Take out the references the nodes no longer read, to release once the
+// graph is unlocked. Needs the graph lock.
+static void collectVariants(AudioPlayer* player, PlayerVariants* variants, std::vector<const AudioFile*>& released) {
+    const AudioFile* playing = playerNodeOf(player)->variant();
+    const AudioFile* fading = player->timePitchUnit ? pitchShiftOf(player)->fadingVariant() : nullptr;
+    for (auto it = variants->held.begin(); it != variants->held.end();) {
+        if (*it != playing && *it != fading) {
+            released.push_back(*it);
+            it = variants->held.erase(it);
+        } else {
+            ++it;
+        }
+    }
+}
+
+// Back to the live units at the rate and pitch as set, at once. Needs the graph lock.
+static void dropVariant(AudioPlayer* player, PlayerVariants* variants) {
+    if (player->timePitchUnit) {
+        PitchShiftNode* pitchShift = pitchShiftOf(player);
+        pitchShift->finishVariantFade();
+        timeStretchOf(player)->rate.store(variants->rate);
+        pitchShift->pitch.store(variants->cents);
+    }
+    playerNodeOf(player)->setVariant(nullptr, 1.0);
+}
+
+// Stop rendering, play live and let go of every variant
+static void stopVariants(AudioPlayer* player) {
+    PlayerVariants* variants = variantsOf(player);
+    if (!variants) {
+        return;
+    }
+    variants->job.reset();
+    std::vector<const AudioFile*> released;
+    {
+        GraphLock lock(playerNodeOf(player));
+        dropVariant(player, variants);
+        collectVariants(player, variants, released);
+    }
+    for (const AudioFile* variant : released) {
+        releaseVariant(variant);
+    }
+}
+
+// Play `rate` and `cents` from a cached variant of them, crossfading into it
+// while the file is heard, or else through the live units. `live` keeps to
+// the units, for files about to be queued or streamed.
+static const char* retune(AudioPlayer* player, float rate, float cents, bool live) {
+    if (!player->variants) {
+        player->variants = new (std::nothrow) PlayerVariants();
+        if (!player->variants) {
+            return "Memory allocation failed";
+        }
+    }
+    PlayerVariants* variants = variantsOf(player);
+    PlayerNode* node = playerNodeOf(player);
+    PitchShiftNode* pitchShift = pitchShiftOf(player);
+    TimeStretchNode* timeStretch = timeStretchOf(player);
+    const AudioFile* file = audioFileOf(player);
+    const PlayerStream* stream = streamOf(player);
+    std::vector<const AudioFile*> released;
+    {
+        GraphLock lock(node);
+        const VariantParams params = variantParams(player, rate, cents);
+        const AudioFile* variant = !live && file && !variant_is_identity(&params) && !(stream && stream->file) &&
+                                           !node->hasQueuedFiles()
+                                       ? acquireVariant(file, params)
+                                       : nullptr;
+        if (pitchShift->revertVariantFade()) {
+            // Set again before a frame of the last switch was heard, as after
+            // rate and pitch in a row: start over from the setting before it
+            if (node->variant()) {
+                timeStretch->rate.store(1.0f);
+                pitchShift->pitch.store(0.0f);
+            }
+        } else if (pitchShift->fadingInVariant()) {
+            pitchShift->finishVariantFade();  // The units still play the setting before
+        }
+        const AudioFile* playing = node->variant();
+        if (variant) {
+            (variant == playing ? released : variants->held).push_back(variant);
+        }
+        const double playingRate = node->variantRate();
+        const bool heard = node->isPlaying() && node->hasSchedule() && !node->frontFile() && node->position() >= 0.0;
+        const double sampleRate = node->engine ? node->engine->format.sampleRate : file ? file->sampleRate : 0.0;
+        const int fadeFrames = (int)lround(AUDIOPLAYER_VARIANT_CROSSFADE * sampleRate);
+
+        if (variant && variant != playing) {
+            if (playing && heard) {
+                pitchShift->fadeOutVariant(playing, playingRate, node->position(), fadeFrames, node);
+            }
+            if (!playing && heard) {
+                pitchShift->fadeInVariant(variant, rate, fadeFrames, node, timeStretch);  // Hands over once in
+            } else {
+                node->setVariant(variant, rate);
+                timeStretch->rate.store(1.0f);
+                pitchShift->pitch.store(0.0f);
+                if (!heard) {
+                    timeStretch->reset();
+                    pitchShift->reset();
+                }
+            }
+        } else if (!variant) {
+            if (playing && heard) {
+                pitchShift->fadeOutVariant(playing, playingRate, node->position(), fadeFrames, node);
+            }
+            node->setVariant(nullptr, 1.0);
+            timeStretch->rate.store(rate);
+            pitchShift->pitch.store(cents);
+        }
+        variants->rate = rate;
+        variants->cents = cents;
+        collectVariants(player, variants, released);
+    }
+    for (const AudioFile* done : released) {
+        releaseVariant(done);
+    }
+    return NULL;
+}
+
+// ==============================================
+// Batch file analysis
+// ==============================================
+
+// Each file reports at most once, so results fill a slot array in completion
+// order; `produced` and `consumed` index it under the mutex.
+struct FileAnalysisBatch {
+    std::vector<std::string> paths;
+    int flags = 0;
+    std::atomic<int> nextFile{0};
+    std::atomic<bool> cancelled{false};
+    std::mutex mutex;
+    std::condition_variable reported;
+    std::vector<FileAnalysisResult> results;
+    std::vector<std::string> errors;  // By file index
+    int produced = 0;
+    int consumed = 0;
+    int running = 0;  // Workers not yet finished
+    std::vector<std::thread> workers;
+};
+
+static void resultFromRecord(const AnalysisRecord* record, FileAnalysisResult* result) {
+    result->cached = true;
+    result->sampleRate = record->sampleRate;
+    result->channelCount = record->channelCount;
+    result->frames = record->frames;
+    result->rms = record->rms;
+    result->peak = record->peak;
+    result->loudness = record->loudness;
+}
+
+// Decode and measure one file into `result` (or `error`). Returns false if the
+// batch was cancelled meanwhile.
+static bool analyzeFile(FileAnalysisBatch* batch, const std::string& path, LoudnessState* state,
+                        FileAnalysisResult* result, std::string* error) {
+    const bool wantLoudness = (batch->flags & FILE_ANALYSIS_LOUDNESS) != 0;
+    const uint32_t wanted = ANALYSIS_CACHE_RMS | (wantLoudness ? ANALYSIS_CACHE_LOUDNESS : 0u);
+    const std::string directory = analysisCacheDir();
+    if (!directory.empty()) {
+        char hash[ANALYSIS_CACHE_HASH_LENGTH];
+        AnalysisRecord record;
+        const bool hit = analysis_cache_key(directory.c_str(), path.c_str(), 0, hash) &&
+                         analysis_cache_read(directory.c_str(), hash, &record) && (record.items & wanted) == wanted;
+        countAnalysisCache(hit);
+        if (hit) {
+            resultFromRecord(&record, result);
+            return true;
+        }
+    }
+
+    AudioFile file;
+    if (const char* err = headless::loadAudioFile(path.c_str(), &file)) {
+        *error = err;
+        return true;
+    }
+    if (batch->cancelled.load(std::memory_order_relaxed)) {
+        return false;
+    }
+    result->sampleRate = file.sampleRate;
+    result->channelCount = file.channelCount;
+    result->frames = file.length;
+    for (int c = 0; c < file.channelCount; c++) {
+        MeterChannelStats stats;
+        meter_channel(file.channels[(size_t)c].data(), (int)file.length, &stats);
+        result->rms += stats.rms;
+        result->peak = std::max(result->peak, stats.peak);
+    }
+    if (file.channelCount > 0) {
+        result->rms /= file.channelCount;
+    }
+
+    if (wantLoudness) {
+        loudness_init(state, file.sampleRate, file.channelCount);
+        const int64_t chunkFrames = 65536;
+        const float* planes[LOUDNESS_MAX_CHANNELS];
+        for (int64_t offset = 0; offset < file.length; offset += chunkFrames) {
+            if (batch->cancelled.load(std::memory_order_relaxed)) {
+                return false;
+            }
+            for (int c = 0; c < state->channelCount; c++) {
+                planes[c] = file.channels[(size_t)c].data() + offset;
+            }
+            loudness_process(state, planes, (int)std::min(chunkFrames, file.length - offset));
+        }
+        loudness_read(state, &result->loudness);
+    }
+
+    if (!directory.empty()) {
+        AnalysisRecord update;
+        describeFile(&file, &update);
+        update.items |= wanted;
+        update.rms = result->rms;
+        update.peak = result->peak;
+        update.loudness = result->loudness;
+        storeAnalysis(path, &update, nullptr, nullptr);
+    }
+    return true;
+}
+
+static void runFileAnalysis(FileAnalysisBatch* batch) {
+    std::unique_ptr<LoudnessState> state(new LoudnessState());
+    const int count = (int)batch->paths.size();
+    while (!batch->cancelled.load(std::memory_order_relaxed)) {
+        const int index = batch->nextFile.fetch_add(1, std::memory_order_relaxed);
+        if (index >= count) {
+            break;
+        }
+        FileAnalysisResult result;
+        memset(&result, 0, sizeof(result));
+        result.index = index;
+        result.path = batch->paths[(size_t)index].c_str();
+        std::string error;
+        if (!analyzeFile(batch, batch->paths[(size_t)index], state.get(), &result, &error)) {
+            break;
+        }
+
+        std::lock_guard<std::mutex> lock(batch->mutex);
+        if (!error.empty()) {
+            batch->errors[(size_t)index] = error;
+            result.error = batch->errors[(size_t)index].c_str();
+        }
+        batch->results[(size_t)batch->produced++] = result;
+        batch->reported.notify_all();
+    }
+
+    std::lock_guard<std::mutex> lock(batch->mutex);
+    batch->running--;
+    batch->reported.notify_all();
+}
+
+extern "C" {
+
+PlayerResult audioplayer_new(void* enginePtr) {
+    if (!enginePtr) {
+        return (PlayerResult){NULL, "Engine pointer is null"};
+    }
+
+    Engine* engine = static_cast<Engine*>(enginePtr);
+    PlayerNode* playerNode = new (std::nothrow) PlayerNode();
+    if (!playerNode) {
+        return (PlayerResult){NULL, "Failed to create player node"};
+    }
+
+    if (engine->attach(playerNode)) {
+        playerNode->release();
+        return (PlayerResult){NULL, "Failed to attach player node to engine"};
+    }
+
+    AudioPlayer* player = (AudioPlayer*)malloc(sizeof(AudioPlayer));
+    if (!player) {
+        engine->detach(playerNode);
+        playerNode->release();
+        return (PlayerResult){NULL, "Memory allocation failed"};
+    }
+
+    player->playerNode = static_cast<Node*>(playerNode);
+    player->audioFile = NULL;
+    player->engine = enginePtr;
+    player->timePitchUnit = NULL;
+    player->timeStretchUnit = NULL;
+    player->isPlaying = false;
+    player->timePitchEnabled = false;
+    player->peaks = NULL;
+    player->analysis = NULL;
+    player->stream = NULL;
+    player->decoded = NULL;  // The headless file is itself the shared payload
+    player->startFrame = 0;
+    player->queue = NULL;
+    player->loop = NULL;  // The region lives on the player node
+    player->variants = NULL;
+    player->resamplerQuality = RESAMPLER_QUALITY_MEDIUM;
+
+    headless::logf("Created audio player successfully");
+    return (PlayerResult){player, NULL};  // NULL = success
+}
+
+const char* audioplayer_load_file(AudioPlayer* player, const char* filePath) {
+    if (!player) {
+        return "Player is null";
+    }
+    if (!filePath) {
+        return "File path is null";
+    }
+
+    const AudioFile* file = nullptr;
+    if (const char* err = acquireAudioFile(filePath, &file)) {
+        headless::logf("Failed to load audio file: %s", err);
+        return "Failed to load audio file";
+    }
+
+    // The overview, variants and read-ahead belong to the previous file
+    stopPeaks(player);
+    stopVariants(player);
+    detachStream(player);
+
+    // Swap the file under the graph lock so the render thread never sees a stale pointer
+    const AudioFile* oldFile = audioFileOf(player);
+    {
+        PlayerNode* node = playerNodeOf(player);
+        GraphLock lock(node);
+        node->setFile(file);
+        player->audioFile = const_cast<AudioFile*>(file);
+        player->isPlaying = false;
+    }
+    releaseAudioFile(oldFile);
+    reapFinished(player);
+    if (const char* err = attachStream(player)) {
+        headless::logf("Streaming unavailable, playing from memory: %s", err);
+    }
+
+    // Format and earlier analysis of this content, if the cache has seen it
+    free(player->analysis);
+    player->analysis = NULL;
+    countAnalysisCache(loadAnalysis(player, file->path, false));
+
+    headless::logf("Loaded audio file: %s (%.2f seconds, %.0f Hz, %d channels)", filePath,
+                   (double)file->length / file->sampleRate, file->sampleRate, file->channelCount);
+    return NULL;  // NULL = success
+}
+
+const char* audioplayer_play(AudioPlayer* player) {
+    if (!player || !player->playerNode) {
+        return "Player or player node is null";
+    }
+    if (!player->audioFile) {
+        return "No audio file loaded";
+    }
+
+    PlayerNode* node = playerNodeOf(player);
+    player->startFrame = 0;
+    {
+        GraphLock lock(node);
+        node->scheduleSegment(0, audioFileOf(player)->length, [player]() { finishSegment(player); });
+    }
+    prerollStream(player);
+    GraphLock lock(node);
+    node->play();
+    player->isPlaying = true;
+
+    headless::logf("Started audio playback");
+    return NULL;  // NULL = success
+}
+
+// Play from a specific time (with TimePitch rate compensation)
+const char* audioplayer_play_at_time(AudioPlayer* player, double timeSeconds) {
+    if (!player || !player->playerNode) {
+        return "Player or player node is null";
+    }
+    if (!player->audioFile) {
+        return "No audio file loaded";
+    }
+    if (timeSeconds < 0.0) {
+        return "Time cannot be negative";
+    }
+
+    const AudioFile* file = audioFileOf(player);
+    const int64_t startFrame = (int64_t)(timeSeconds * file->sampleRate);
+    if (startFrame >= file->length) {
+        return "Start time is beyond file duration";
+    }
+    const int64_t remainingFrames = file->length - startFrame;
+
+    // Same source-frame budget as the AVFoundation backend: frameCount = remaining * rate
+    int64_t frameCount = remainingFrames;
+    if (player->timePitchEnabled && player->timePitchUnit) {
+        const float rate = timeStretchOf(player)->rate.load();
+        frameCount = std::min(remainingFrames, (int64_t)((double)remainingFrames * rate));
+    }
+
+    PlayerNode* node = playerNodeOf(player);
+    player->startFrame = startFrame;
+    {
+        GraphLock lock(node);
+        node->scheduleSegment(startFrame, frameCount, [player]() { finishSegment(player); });
+    }
+    prerollStream(player);
+    GraphLock lock(node);
+    node->play();
+    player->isPlaying = true;
+
+    headless::logf("Started audio playback from %.2f seconds (frameCount: %lld)", timeSeconds, (long long)frameCount);
+    return NULL;  // NULL = success
+}
+
+const char* audioplayer_pause(AudioPlayer* player) {
+    if (!player || !player->playerNode) {
+        return "Player or player node is null";
+    }
+    PlayerNode* node = playerNodeOf(player);
+    GraphLock lock(node);
+    node->pause();
+    player->isPlaying = false;
+    return NULL;  // NULL = success
+}
+
+const char* audioplayer_stop(AudioPlayer* player) {
+    if (!player || !player->playerNode) {
+        return "Player or player node is null";
+    }
+    PlayerNode* node = playerNodeOf(player);
+    GraphLock lock(node);
+    node->stop();
+    player->isPlaying = false;
+    return NULL;  // NULL = success
+}
+
+const char* audioplayer_is_playing(AudioPlayer* player, bool* result) {
+    if (!player || !result) {
+        return "Invalid parameters";
+    }
+    if (!player->playerNode) {
+        *result = false;
+        return NULL;
+    }
+    *result = playerNodeOf(player)->isPlaying() && player->isPlaying;
+    return NULL;  // NULL = success
+}
+
+const char* audioplayer_get_duration(AudioPlayer* player, double* duration) {
+    if (!player || !duration) {
+        return "Invalid parameters";
+    }
+    if (!player->audioFile) {
+        *duration = 0.0;
+        return "No audio file loaded";
+    }
+    if (const AnalysisRecord* record = analysisOf(player)) {
+        *duration = (double)record->frames / record->sampleRate;
+        return NULL;  // NULL = success
+    }
+    const AudioFile* file = audioFileOf(player);
+    *duration = (double)file->length / file->sampleRate;
+    return NULL;  // NULL = success
+}
+
+// Get current playback time (the playhead's position in the file)
+const char* audioplayer_get_current_time(AudioPlayer* player, double* currentTime) {
+    if (!player || !currentTime) {
+        return "Invalid parameters";
+    }
+    *currentTime = 0.0;
+    if (!player->playerNode || !player->audioFile) {
+        return "Player node or audio file is null";
+    }
+
+    PlayheadState state;
+    if (const char* err = audioplayer_get_playhead(player, &state)) {
+        return err;
+    }
+    *currentTime = state.position;
+    return NULL;  // NULL = success
+}
+
+// Combine the player's position with what its time stretch and pitch shift
+// units hold back. All publish from the same cycles; the units render after
+// the player, so a set is consistent once both have published the player's
+// cycle or a later one and the player has not moved on meanwhile.
+const char* audioplayer_get_playhead(AudioPlayer* player, PlayheadState* state) {
+    if (!player || !state) {
+        return "Invalid parameters";
+    }
+    memset(state, 0, sizeof(*state));
+    if (!player->playerNode || !player->audioFile) {
+        return "Player node or audio file is null";
+    }
+
+    const PlayerNode* node = playerNodeOf(player);
+    const PitchShiftNode* pitchShift =
+        player->timePitchEnabled && player->timePitchUnit ? pitchShiftOf(player) : nullptr;
+    const TimeStretchNode* timeStretch = pitchShift ? timeStretchOf(player) : nullptr;
+    if (timeStretch && !(static_cast<const Node*>(timeStretch)->input(0) &&
+                         static_cast<const Node*>(timeStretch)->input(0)->source)) {
+        timeStretch = nullptr;  // Not wired in front of the pitch shift unit
+    }
+    PlayheadSlot head = {};
+    PlayheadSlot pitch = {};
+    PlayheadSlot stretch = {};
+    stretch.speed = 1.0;
+    bool consistent = false;
+    for (int attempt = 0; attempt < 100 && !consistent; attempt++) {
+        if (!node->readPlayhead(&head)) {
+            continue;
+        }
+        if (!pitchShift) {
+            consistent = true;
+            break;
+        }
+        PlayheadSlot again;
+        consistent = pitchShift->readLookahead(&pitch) && pitch.cycle >= head.cycle &&
+                     (!timeStretch || (timeStretch->readLookahead(&stretch) && stretch.cycle >= head.cycle)) &&
+                     node->readPlayhead(&again) && again.sequence == head.sequence;
+        if (!consistent) {
+            std::this_thread::yield();
+        }
+    }
+    if (!consistent) {
+        return "Playhead is busy";
+    }
+
+    double frame = head.frame;
+    int64_t loops = head.loops;
+    if (pitchShift && head.playing) {
+        frame -= (stretch.frame + pitch.frame * stretch.speed) * head.speed;
+        if (loops > 0 && head.loopLength > 0.0 && frame < head.loopStart) {
+            frame += head.loopLength;  // Still hearing the pass before the last wrap
+            loops--;
+        }
+        if (loops == 0) {
+            frame = std::max(head.origin, frame);
+        }
+    }
+    const AudioFile* file = audioFileOf(player);
+    state->frame = (int64_t)frame;
+    state->loops = loops;
+    state->position = frame / file->sampleRate;
+    state->rate = (pitchShift ? stretch.speed * pitch.speed : 1.0) * node->variantRate();
+    state->hostTime = head.hostTime;
+    state->playing = head.playing;
+    return NULL;  // NULL = success
+}
+
+uint64_t playhead_host_time(void) {
+    return playhead_clock_ns();
+}
+
+// Seek to specific time (in place while playing, otherwise play from time)
+const char* audioplayer_seek_to_time(AudioPlayer* player, double timeSeconds) {
+    return audioplayer_seek(player, timeSeconds, 0.0);
+}
+
+// Queue the jump for the render thread; streaming players decode the target first
+const char* audioplayer_seek(AudioPlayer* player, double timeSeconds, double crossfadeSeconds) {
+    if (!player || !player->playerNode) {
+        return "Player or player node is null";
+    }
+    if (!player->audioFile) {
+        return "No audio file loaded";
+    }
+    if (timeSeconds < 0.0) {
+        return "Time cannot be negative";
+    }
+    if (!(crossfadeSeconds >= 0.0 && crossfadeSeconds <= AUDIOPLAYER_MAX_SEEK_CROSSFADE)) {
+        return "Crossfade must be between 0 and 0.1 seconds";
+    }
+    const AudioFile* file = audioFileOf(player);
+    const int64_t target = (int64_t)(timeSeconds * file->sampleRate);
+    if (target >= file->length) {
+        return "Seek time is beyond file duration";
+    }
+
+    PlayerNode* node = playerNodeOf(player);
+    PlayerStream* stream = streamOf(player);
+    headless::SeekPreroll* preroll = nullptr;
+    std::unique_lock<std::mutex> seekLock;
+    if (stream && stream->file) {
+        seekLock = std::unique_lock<std::mutex>(stream->seekMutex);
+        {
+            GraphLock lock(node);
+            node->cancelSeek();
+            preroll = node->usesPreroll(&stream->prerolls[0]) ? &stream->prerolls[1] : &stream->prerolls[0];
+        }
+        std::vector<float*> planes(preroll->channels.size());
+        for (size_t c = 0; c < planes.size(); c++) {
+            planes[c] = preroll->channels[c].data();
+        }
+        preroll->start = target;
+        preroll->frames = (int)std::min<int64_t>(stream->pool.bufferFrames, file->length - target);
+        readWithGuard(stream->seekReader, target, preroll->frames, planes.data(), (int)planes.size());
+    }
+
+    {
+        GraphLock lock(node);
+        const double sampleRate = node->engine ? node->engine->format.sampleRate : file->sampleRate;
+        const int crossfadeFrames = (int)lround(crossfadeSeconds * sampleRate);
+        if (node->frontFile()) {
+            return "Cannot seek while a queued file plays";
+        }
+        if (player->timePitchUnit) {
+            pitchShiftOf(player)->finishVariantFade();  // It would carry on from the old position
+        }
+        if (node->isPlaying() && node->seek(target, file->length, crossfadeFrames, preroll)) {
+            player->startFrame = target;
+            headless::logf("Seeking to %.3f seconds (crossfade: %d frames)", timeSeconds, crossfadeFrames);
+            return NULL;  // NULL = success
+        }
+    }
+
+    // Nothing playing to jump within: start from the target
+    seekLock = std::unique_lock<std::mutex>();
+    const char* stopResult = audioplayer_stop(player);
+    if (stopResult) {
+        return stopResult;
+    }
+    return audioplayer_play_at_time(player, timeSeconds);
+}
+
+// The region is in file frames; the node picks it up at its next render block
+const char* audioplayer_set_loop(AudioPlayer* player, int64_t startFrame, int64_t endFrame, double crossfadeSeconds) {
+    if (!player || !player->playerNode) {
+        return "Player or player node is null";
+    }
+    if (!player->audioFile) {
+        return "No audio file loaded";
+    }
+    const AudioFile* file = audioFileOf(player);
+    if (startFrame < 0 || endFrame <= startFrame || endFrame > file->length) {
+        return "Loop region must lie within the file and end after it starts";
+    }
+    if (!(crossfadeSeconds >= 0.0 && crossfadeSeconds <= AUDIOPLAYER_MAX_LOOP_CROSSFADE)) {
+        return "Crossfade must be between 0 and 10 seconds";
+    }
+    const int64_t crossfadeFrames = llround(crossfadeSeconds * file->sampleRate);
+    if (crossfadeFrames > startFrame || crossfadeFrames > endFrame - startFrame) {
+        return "Crossfade must fit before the loop start and within the loop";
+    }
+
+    headless::LoopRegion loop;
+    loop.start = startFrame;
+    loop.end = endFrame;
+    loop.crossfadeFrames = (int)crossfadeFrames;
+    applyLoop(player, loop);
+    headless::logf("Looping frames %lld to %lld (crossfade: %lld frames)", (long long)startFrame, (long long)endFrame,
+                   (long long)crossfadeFrames);
+    return NULL;  // NULL = success
+}
+
+const char* audioplayer_clear_loop(AudioPlayer* player) {
+    if (!player || !player->playerNode) {
+        return "Player or player node is null";
+    }
+    applyLoop(player, headless::LoopRegion{});
+    return NULL;  // NULL = success
+}
+
+// Decode the file now (sharing the PCM cache's copy when it is on) and
+// schedule it behind everything else, so the render thread moves into it
+// without waiting on anyone
+const char* audioplayer_queue_file(AudioPlayer* player, const char* filePath, double startSeconds,
+                                   double durationSeconds, double crossfadeSeconds, int64_t* itemId) {
+    if (!player || !player->playerNode) {
+        return "Player or player node is null";
+    }
+    if (!filePath) {
+        return "File path is null";
+    }
+    if (!player->audioFile) {
+        return "No audio file loaded";
+    }
+    if (startSeconds < 0.0) {
+        return "Time cannot be negative";
+    }
+    if (!(crossfadeSeconds >= 0.0 && crossfadeSeconds <= AUDIOPLAYER_MAX_QUEUE_CROSSFADE)) {
+        return "Crossfade must be between 0 and 10 seconds";
+    }
+    if (!player->queue) {
+        player->queue = new (std::nothrow) PlayerQueue();
+        if (!player->queue) {
+            return "Memory allocation failed";
+        }
+    }
+    PlayerQueue* queue = queueOf(player);
+    std::lock_guard<std::mutex> queueLock(queue->mutex);
+
+    const AudioFile* file = nullptr;
+    if (const char* err = acquireAudioFile(filePath, &file)) {
+        headless::logf("Failed to queue audio file: %s", err);
+        return "Failed to load audio file";
+    }
+    const int64_t start = (int64_t)(startSeconds * file->sampleRate);
+    const int64_t remaining = file->length - start;
+    const int64_t frames =
+        durationSeconds > 0.0 ? std::min(remaining, (int64_t)(durationSeconds * file->sampleRate)) : remaining;
+    std::unique_ptr<QueueItem> item(frames > 0 ? new (std::nothrow) QueueItem() : nullptr);
+    if (!item) {
+        releaseAudioFile(file);
+        return frames > 0 ? "Memory allocation failed" : "Start time is beyond file duration";
+    }
+    item->id = queue->nextId++;
+    item->file = file;
+    QueueItem* queued = item.get();
+    if (const PlayerVariants* variants = player->timePitchUnit ? variantsOf(player) : nullptr) {
+        retune(player, variants->rate, variants->cents, true);  // Queued files play through the live units
+    }
+
+    PlayerNode* node = playerNodeOf(player);
+    std::vector<const AudioFile*> released;
+    {
+        GraphLock lock(node);
+        reapQueue(queue, true, released);
+        const double sampleRate = node->engine ? node->engine->format.sampleRate : file->sampleRate;
+        const int crossfadeFrames = (int)lround(crossfadeSeconds * sampleRate);
+        node->scheduleFile(file, start, frames, crossfadeFrames, [player, queued]() {
+            queued->finished.store(true, std::memory_order_release);
+            finishSegment(player);
+        });
+        queue->items.push_back(std::move(item));
+        if (node->isPlaying()) {
+            player->isPlaying = true;  // A player that ran out carries on with this
+        }
+    }
+    for (const AudioFile* done : released) {
+        releaseAudioFile(done);
+    }
+    if (itemId) {
+        *itemId = queued->id;
+    }
+    headless::logf("Queued %s as item %lld (%lld frames, crossfade %.3f seconds)", filePath, (long long)queued->id,
+                   (long long)frames, crossfadeSeconds);
+    return NULL;  // NULL = success
+}
+
+const char* audioplayer_queue_clear(AudioPlayer* player) {
+    if (!player || !player->playerNode) {
+        return "Player or player node is null";
+    }
+    PlayerQueue* queue = queueOf(player);
+    if (!queue) {
+        return NULL;  // Nothing was ever queued
+    }
+    std::lock_guard<std::mutex> queueLock(queue->mutex);
+    std::vector<const AudioFile*> released;
+    {
+        PlayerNode* node = playerNodeOf(player);
+        GraphLock lock(node);
+        reapQueue(queue, true, released);
+        node->unscheduleFiles();
+        reapQueue(queue, false, released);
+    }
+    for (const AudioFile* file : released) {
+        releaseAudioFile(file);
+    }
+    return NULL;  // NULL = success
+}
+
+const char* audioplayer_queue_skip(AudioPlayer* player, double crossfadeSeconds) {
+    if (!player || !player->playerNode) {
+        return "Player or player node is null";
+    }
+    if (!(crossfadeSeconds >= 0.0 && crossfadeSeconds <= AUDIOPLAYER_MAX_SEEK_CROSSFADE)) {
+        return "Crossfade must be between 0 and 0.1 seconds";
+    }
+    PlayerNode* node = playerNodeOf(player);
+    GraphLock lock(node);
+    const double sampleRate = node->engine ? node->engine->format.sampleRate : headless::kDefaultSampleRate;
+    if (!node->skip((int)lround(crossfadeSeconds * sampleRate))) {
+        return "Nothing is scheduled";
+    }
+    return NULL;  // NULL = success
+}
+
+const char* audioplayer_queue_get_status(AudioPlayer* player, PlayerQueueStatus* status) {
+    if (!player || !status || !player->playerNode) {
+        return "Invalid parameters";
+    }
+    memset(status, 0, sizeof(*status));
+    PlayerQueue* queue = queueOf(player);
+    if (!queue) {
+        return NULL;  // NULL = success
+    }
+    std::lock_guard<std::mutex> queueLock(queue->mutex);
+    std::vector<const AudioFile*> released;
+    {
+        PlayerNode* node = playerNodeOf(player);
+        GraphLock lock(node);
+        reapQueue(queue, true, released);
+        // Unfinished items are in schedule order, so a queued front segment is the first
+        if (node->frontFile() && !queue->items.empty()) {
+            status->current = queue->items.front()->id;
+        }
+        status->pending = (int)queue->items.size() - (status->current ? 1 : 0);
+        status->played = queue->played;
+    }
+    for (const AudioFile* file : released) {
+        releaseAudioFile(file);
+    }
+    return NULL;  // NULL = success
+}
+
+const char* audioplayer_set_volume(AudioPlayer* player, float volume) {
+    if (!player || !player->playerNode) {
+        return "Player or player node is null";
+    }
+    if (volume < 0.0f || volume > 1.0f) {
+        return "Volume must be between 0.0 and 1.0";
+    }
+    playerNodeOf(player)->volume.store(volume);
+    return NULL;  // NULL = success
+}
+
+const char* audioplayer_get_volume(AudioPlayer* player, float* volume) {
+    if (!player || !volume) {
+        return "Invalid parameters";
+    }
+    if (!player->playerNode) {
+        *volume = 0.0f;
+        return "Player node is null";
+    }
+    *volume = playerNodeOf(player)->volume.load();
+    return NULL;  // NULL = success
+}
+
+const char* audioplayer_set_pan(AudioPlayer* player, float pan) {
+    if (!player || !player->playerNode) {
+        return "Player or player node is null";
+    }
+    if (pan < -1.0f || pan > 1.0f) {
+        return "Pan must be between -1.0 and 1.0";
+    }
+    playerNodeOf(player)->pan.store(pan);
+    return NULL;  // NULL = success
+}
+
+const char* audioplayer_get_pan(AudioPlayer* player, float* pan) {
+    if (!player || !pan) {
+        return "Invalid parameters";
+    }
+    if (!player->playerNode) {
+        *pan = 0.0f;
+        return "Player node is null";
+    }
+    *pan = playerNodeOf(player)->pan.load();
+    return NULL;  // NULL = success
+}
+
+const char* audioplayer_set_playback_rate(AudioPlayer* player, float rate) {
+    if (!player) {
+        return "Player is null";
+    }
+    if (!player->timePitchEnabled || !player->timePitchUnit) {
+        return "Time/pitch effects not enabled. Call audioplayer_enable_time_pitch_effects() first";
+    }
+    if (rate < 0.25f || rate > 4.0f) {
+        return "Playback rate must be between 0.25 and 4.0";
+    }
+    const PlayerVariants* variants = variantsOf(player);
+    return retune(player, rate, variants ? variants->cents : pitchShiftOf(player)->pitch.load(), false);
+}
+
+const char* audioplayer_get_playback_rate(AudioPlayer* player, float* rate) {
+    if (!player || !rate) {
+        return "Invalid parameters";
+    }
+    if (!player->timePitchEnabled || !player->timePitchUnit) {
+        *rate = 1.0f;
+        return "Time/pitch effects not enabled";
+    }
+    const PlayerVariants* variants = variantsOf(player);
+    *rate = variants ? variants->rate : timeStretchOf(player)->rate.load();  // The units idle under a variant
+    return NULL;  // NULL = success
+}
+
+const char* audioplayer_set_pitch(AudioPlayer* player, float pitch) {
+    if (!player) {
+        return "Player is null";
+    }
+    if (!player->timePitchEnabled || !player->timePitchUnit) {
+        return "Time/pitch effects not enabled. Call audioplayer_enable_time_pitch_effects() first";
+    }
+    if (pitch < -2400.0f || pitch > 2400.0f) {
+        return "Pitch must be between -2400 and 2400 cents";
+    }
+    const PlayerVariants* variants = variantsOf(player);
+    return retune(player, variants ? variants->rate : timeStretchOf(player)->rate.load(), pitch, false);
+}
+
+const char* audioplayer_get_pitch(AudioPlayer* player, float* pitch) {
+    if (!player || !pitch) {
+        return "Invalid parameters";
+    }
+    if (!player->timePitchEnabled || !player->timePitchUnit) {
+        *pitch = 0.0f;
+        return "Time/pitch effects not enabled";
+    }
+    const PlayerVariants* variants = variantsOf(player);
+    *pitch = variants ? variants->cents : pitchShiftOf(player)->pitch.load();
+    return NULL;  // NULL = success
+}
+
+// Detach and drop the pitch shift and time stretch units
+static void releaseTimeUnits(AudioPlayer* player) {
+    Node* units[] = {static_cast<Node*>(player->timePitchUnit), static_cast<Node*>(player->timeStretchUnit)};
+    for (Node* unit : units) {
+        if (unit && unit->engine) {
+            unit->engine->detach(unit);
+        }
+        if (unit) {
+            unit->release();
+        }
+    }
+    player->timePitchUnit = NULL;
+    player->timeStretchUnit = NULL;
+}
+
+const char* audioplayer_enable_time_pitch_effects(AudioPlayer* player) {
+    if (!player || !player->playerNode || !player->engine) {
+        return "Player, player node, or engine is null";
+    }
+    if (player->timePitchEnabled) {
+        return "Time/pitch effects are already enabled";
+    }
+
+    PitchShiftNode* timePitchUnit = new (std::nothrow) PitchShiftNode();
+    TimeStretchNode* timeStretchUnit = new (std::nothrow) TimeStretchNode();
+    if (!timePitchUnit || !timeStretchUnit) {
+        for (Node* unit : {static_cast<Node*>(timePitchUnit), static_cast<Node*>(timeStretchUnit)}) {
+            if (unit) {
+                unit->release();
+            }
+        }
+        return "Failed to create time/pitch units";
+    }
+    player->timePitchUnit = static_cast<Node*>(timePitchUnit);
+    player->timeStretchUnit = static_cast<Node*>(timeStretchUnit);
+    Engine* engine = static_cast<Engine*>(player->engine);
+    if (engine->attach(timePitchUnit) || engine->attach(timeStretchUnit)) {
+        releaseTimeUnits(player);
+        return "Failed to enable time/pitch effects";
+    }
+
+    player->timePitchEnabled = true;
+    headless::logf("Enabled time/pitch effects - ready for rate and pitch adjustments");
+    return NULL;  // NULL = success
+}
+
+const char* audioplayer_disable_time_pitch_effects(AudioPlayer* player) {
+    if (!player) {
+        return "Player is null";
+    }
+    if (!player->timePitchEnabled) {
+        return "Time/pitch effects are not enabled";
+    }
+
+    if (player->isPlaying) {
+        audioplayer_stop(player);
+    }
+
+    // The player plays its own file again, and new units start from unity
+    stopVariants(player);
+    delete variantsOf(player);
+    player->variants = NULL;
+    releaseTimeUnits(player);
+
+    player->timePitchEnabled = false;
+    headless::logf("Disabled time/pitch effects");
+    return NULL;  // NULL = success
+}
+
+const char* audioplayer_is_time_pitch_effects_enabled(AudioPlayer* player, bool* enabled) {
+    if (!player || !enabled) {
+        return "Invalid parameters";
+    }
+    *enabled = player->timePitchEnabled;
+    return NULL;  // NULL = success
+}
+
+PlayerResult audioplayer_get_time_pitch_node_ptr(AudioPlayer* player) {
+    if (!player) {
+        return (PlayerResult){NULL, "Player is null"};
+    }
+    if (!player->timePitchEnabled || !player->timePitchUnit) {
+        return (PlayerResult){NULL, "Time/pitch effects not enabled"};
+    }
+    return (PlayerResult){player->timePitchUnit, NULL};  // NULL = success
+}
+
+PlayerResult audioplayer_get_time_stretch_node_ptr(AudioPlayer* player) {
+    if (!player) {
+        return (PlayerResult){NULL, "Player is null"};
+    }
+    if (!player->timePitchEnabled || !player->timeStretchUnit) {
+        return (PlayerResult){NULL, "Time/pitch effects not enabled"};
+    }
+    return (PlayerResult){player->timeStretchUnit, NULL};  // NULL = success
+}
+
+const char* audioplayer_get_time_stretch_latency(AudioPlayer* player, double* seconds) {
+    if (!player || !seconds) {
+        return "Invalid parameters";
+    }
+    *seconds = 0.0;
+    if (!player->timePitchEnabled || !player->timeStretchUnit) {
+        return "Time/pitch effects not enabled";
+    }
+    const TimeStretchNode* timeStretch = timeStretchOf(player);
+    PlayheadSlot slot;
+    if (!timeStretch->engine || !timeStretch->readLookahead(&slot)) {
+        return NULL;  // Nothing rendered yet
+    }
+    *seconds = slot.frame / timeStretch->engine->format.sampleRate;
+    return NULL;  // NULL = success
+}
+
+const char* audioplayer_set_pitch_shift_options(AudioPlayer* player, const PitchShiftOptions* options) {
+    if (!player) {
+        return "Player is null";
+    }
+    if (!player->timePitchEnabled || !player->timePitchUnit) {
+        return "Time/pitch effects not enabled. Call audioplayer_enable_time_pitch_effects() first";
+    }
+    const PitchShiftOptions defaults = {PITCH_SHIFT_QUALITY_MEDIUM, 0, false};
+    if (!options) {
+        options = &defaults;
+    }
+
+    PitchShiftNode* node = pitchShiftOf(player);
+    GraphLock lock(node);
+    PitchShiftOptions current;
+    PitchShiftInfo info;
+    node->describe(&current, &info);
+    if (options->quality != current.quality || options->fftSize != current.fftSize) {
+        if (const char* err = node->configure(options->quality, options->fftSize)) {
+            return err;
+        }
+    }
+    node->preserveFormants.store(options->preserveFormants);
+    return NULL;  // NULL = success
+}
+
+const char* audioplayer_get_pitch_shift_options(AudioPlayer* player, PitchShiftOptions* options, PitchShiftInfo* info) {
+    if (!player || !options || !info) {
+        return "Invalid parameters";
+    }
+    if (!player->timePitchEnabled || !player->timePitchUnit) {
+        return "Time/pitch effects not enabled";
+    }
+    PitchShiftNode* node = pitchShiftOf(player);
+    GraphLock lock(node);
+    node->describe(options, info);
+    return NULL;  // NULL = success
+}
+
+const char* audioplayer_set_resampler_quality(AudioPlayer* player, int quality) {
+    if (!player || !player->playerNode) {
+        return "Player or player node is null";
+    }
+    PlayerNode* node = playerNodeOf(player);
+    GraphLock lock(node);
+    if (const char* err = node->setResamplerQuality(quality)) {
+        return err;
+    }
+    player->resamplerQuality = quality;
+    return NULL;  // NULL = success
+}
+
+const char* audioplayer_get_resampler_quality(AudioPlayer* player, int* quality) {
+    if (!player || !quality) {
+        return "Invalid parameters";
+    }
+    *quality = player->resamplerQuality;
+    return NULL;  // NULL = success
+}
+
+PlayerResult audioplayer_get_node_ptr(AudioPlayer* player) {
+    if (!player || !player->playerNode) {
+        return (PlayerResult){NULL, "Player or player node is null"};
+    }
+    return (PlayerResult){player->playerNode, NULL};  // NULL = success
+}
+
+const char* audioplayer_get_file_info(AudioPlayer* player, double* sampleRate, int* channelCount, const char** format) {
+    if (!player || !sampleRate || !channelCount || !format) {
+        return "Invalid parameters";
+    }
+    if (!player->audioFile) {
+        *sampleRate = 0.0;
+        *channelCount = 0;
+        *format = "No file loaded";
+        return "No audio file loaded";
+    }
+
+    if (const AnalysisRecord* record = analysisOf(player)) {
+        *sampleRate = record->sampleRate;
+        *channelCount = record->channelCount;
+        *format = record->format;  // Valid until the next load_file or destroy
+        return NULL;  // NULL = success
+    }
+    const AudioFile* file = audioFileOf(player);
+    *sampleRate = file->sampleRate;
+    *channelCount = file->channelCount;
+    *format = file->description.c_str();  // Valid until the next load_file or destroy
+    return NULL;  // NULL = success
+}
+
+AudioBufferMetrics audioplayer_analyze_buffer_at_time(AudioPlayer* player, double timeSeconds) {
+    AudioBufferMetrics metrics = {};
+    if (!player || !player->audioFile) {
+        metrics.error = "No audio file loaded";
+        return metrics;
+    }
+    if (timeSeconds < 0.0) {
+        metrics.error = "Invalid time parameters";
+        return metrics;
+    }
+
+    // Analyse one tap-sized buffer (1024 frames) starting at the requested time
+    const AudioFile* file = audioFileOf(player);
+    const int64_t start = (int64_t)(timeSeconds * file->sampleRate);
+    const int64_t frames = std::max<int64_t>(0, std::min<int64_t>(1024, file->length - start));
+    metrics.is_stereo = file->channelCount >= 2;
+    for (int c = 0; c < std::min(file->channelCount, 2); c++) {
+        MeterChannelStats stats;
+        meter_channel(file->channels[(size_t)c].data() + (frames > 0 ? start : 0), (int)frames, &stats);
+        if (c == 0) {
+            metrics.rms_left = stats.rms;
+            metrics.peak_left = stats.peak;
+        } else {
+            metrics.rms_right = stats.rms;
+            metrics.peak_right = stats.peak;
+        }
+    }
+    if (!metrics.is_stereo) {
+        metrics.rms_right = metrics.rms_left;
+        metrics.peak_right = metrics.peak_left;
+    }
+    return metrics;
+}
+
+void audioplayer_destroy(AudioPlayer* player) {
+    if (!player) {
+        return;
+    }
+
+    if (player->playerNode) {
+        // Flush the schedule so no completion can reach the freed wrapper
+        audioplayer_stop(player);
+    }
+
+    stopVariants(player);
+    delete variantsOf(player);
+    player->variants = NULL;
+    releaseTimeUnits(player);
+
+    detachStream(player);
+    delete streamOf(player);
+    player->stream = NULL;
+
+    // Stopping finished every queued item; nothing renders them any more
+    if (PlayerQueue* queue = queueOf(player)) {
+        for (const std::unique_ptr<QueueItem>& item : queue->items) {
+            releaseAudioFile(item->file);
+        }
+        delete queue;
+        player->queue = NULL;
+    }
+
+    if (player->playerNode) {
+        PlayerNode* playerNode = playerNodeOf(player);
+        if (playerNode->engine) {
+            playerNode->engine->detach(playerNode);
+        }
+        playerNode->setFile(nullptr);
+        playerNode->release();
+        player->playerNode = NULL;
+    }
+
+    stopPeaks(player);
+    free(player->analysis);
+    player->analysis = NULL;
+    releaseAudioFile(audioFileOf(player));
+    player->audioFile = NULL;
+    player->engine = NULL;
+    player->isPlaying = false;
+    player->timePitchEnabled = false;
+
+    headless::logf("Audio player destroyed");
+    free(player);
+}
+
+// File-based audio analysis - reads the same data that gets played
+const char* audioplayer_analyze_file_segment(AudioPlayer* player, double startTimeSeconds, double durationSeconds, double* rms, int* frameCount) {
+    if (!player || !player->audioFile) {
+        return "No audio file loaded";
+    }
+    if (startTimeSeconds < 0.0 || durationSeconds <= 0.0) {
+        return "Invalid time parameters";
+    }
+
+    const AudioFile* file = audioFileOf(player);
+    const int64_t startFrame = (int64_t)(startTimeSeconds * file->sampleRate);
+    int64_t analysisFrames = (int64_t)(durationSeconds * file->sampleRate);
+
+    if (startFrame >= file->length) {
+        *rms = 0.0;
+        *frameCount = 0;
+        return NULL;  // Valid - just past end of file
+    }
+    if (startFrame + analysisFrames > file->length) {
+        analysisFrames = file->length - startFrame;
+    }
+
+    // Whole-file results are cached by content
+    const bool wholeFile = startFrame == 0 && analysisFrames == file->length;
+    if (wholeFile) {
+        if (const AnalysisRecord* record = cachedAnalysis(player, ANALYSIS_CACHE_RMS)) {
+            *rms = record->rms;
+            *frameCount = (int)analysisFrames;
+            return NULL;  // Success
+        }
+    }
+
+    // Average of per-channel RMS, as in the AVFoundation backend
+    float calculatedRMS = 0.0f;
+    float peak = 0.0f;
+    if (analysisFrames > 0) {
+        for (int c = 0; c < file->channelCount; c++) {
+            MeterChannelStats stats;
+            meter_channel(file->channels[(size_t)c].data() + startFrame, (int)analysisFrames, &stats);
+            calculatedRMS += stats.rms;
+            peak = std::max(peak, stats.peak);
+        }
+        calculatedRMS /= (float)file->channelCount;
+    }
+
+    *rms = (double)calculatedRMS;
+    *frameCount = (int)analysisFrames;
+    if (wholeFile) {
+        AnalysisRecord update;
+        describeFile(file, &update);
+        update.items |= ANALYSIS_CACHE_RMS;
+        update.rms = *rms;
+        update.peak = peak;
+        rememberAnalysis(player, &update);
+    }
+    return NULL;  // Success
+}
+
+const char* audioplayer_analyze_loudness(AudioPlayer* player, double startTimeSeconds, double durationSeconds,
+                                         LoudnessMetrics* metrics) {
+    if (!player || !player->audioFile) {
+        return "No audio file loaded";
+    }
+    if (!metrics) {
+        return "Metrics pointer is null";
+    }
+    if (startTimeSeconds < 0.0 || durationSeconds <= 0.0) {
+        return "Invalid time parameters";
+    }
+
+    const AudioFile* file = audioFileOf(player);
+    const int64_t startFrame = std::min((int64_t)(startTimeSeconds * file->sampleRate), file->length);
+    const int64_t analysisFrames =
+        std::min((int64_t)(durationSeconds * file->sampleRate), file->length - startFrame);
+
+    // Whole-file results are cached by content
+    const bool wholeFile = startFrame == 0 && analysisFrames == file->length;
+    if (wholeFile) {
+        if (const AnalysisRecord* record = cachedAnalysis(player, ANALYSIS_CACHE_LOUDNESS)) {
+            *metrics = record->loudness;
+            return NULL;  // Success
+        }
+    }
+
+    std::unique_ptr<LoudnessState> state(new LoudnessState());
+    loudness_init(state.get(), file->sampleRate, file->channelCount);
+
+    // Decoded files are in memory; feed them in bounded blocks like the AVFoundation backend
+    const int64_t chunkFrames = 65536;
+    const float* planes[LOUDNESS_MAX_CHANNELS];
+    for (int64_t offset = 0; offset < analysisFrames; offset += chunkFrames) {
+        for (int c = 0; c < state->channelCount; c++) {
+            planes[c] = file->channels[(size_t)c].data() + startFrame + offset;
+        }
+        loudness_process(state.get(), planes, (int)std::min(chunkFrames, analysisFrames - offset));
+    }
+
+    loudness_read(state.get(), metrics);
+    if (wholeFile) {
+        AnalysisRecord update;
+        describeFile(file, &update);
+        update.items |= ANALYSIS_CACHE_LOUDNESS;
+        update.loudness = *metrics;
+        rememberAnalysis(player, &update);
+    }
+    return NULL;  // Success
+}
+
+const char* audioplayer_build_peaks(AudioPlayer* player, bool persist) {
+    if (!player || !player->audioFile) {
+        return "No audio file loaded";
+    }
+    PeakJob* existing = peakJobOf(player);
+    if (existing && !existing->failed.load(std::memory_order_acquire)) {
+        return NULL;  // Already built or building
+    }
+    stopPeaks(player);  // Retry after a failure
+
+    PeakJob* job = new (std::nothrow) PeakJob();
+    if (!job) {
+        return "Failed to allocate peaks job";
+    }
+    job->file = audioFileOf(player);
+    job->persist = persist;
+    job->thread = std::thread(runPeakJob, job);
+    player->peaks = job;
+    return NULL;
+}
+
+const char* audioplayer_get_peaks_status(AudioPlayer* player, PeaksStatus* status) {
+    if (!player || !status) {
+        return "Player or status pointer is null";
+    }
+    memset(status, 0, sizeof(*status));
+    const PeakJob* job = peakJobOf(player);
+    if (!job) {
+        return NULL;  // Not requested
+    }
+    const AudioFile* file = job->file;
+    const bool failed = job->failed.load(std::memory_order_acquire);
+    status->ready = job->ready.load(std::memory_order_acquire);
+    status->building = !failed;
+    status->cached = status->ready && job->cached;
+    status->progress = status->ready || file->length == 0
+                           ? 1.0
+                           : (double)job->progressFrames.load(std::memory_order_relaxed) / (double)file->length;
+    status->channelCount = file->channelCount;
+    status->sampleRate = file->sampleRate;
+    status->frames = file->length;
+    status->error = failed ? job->error : NULL;
+    return NULL;
+}
+
+const char* audioplayer_get_peaks(AudioPlayer* player, double startTime, double duration, int columns, PeakColumn* out,
+                                  int capacity) {
+    if (!player || !player->peaks) {
+        return "Peaks not built";
+    }
+    const PeakJob* job = peakJobOf(player);
+    if (!job->ready.load(std::memory_order_acquire)) {
+        return "Peaks not ready";
+    }
+    if (!out || columns <= 0) {
+        return "Invalid column count";
+    }
+    if (startTime < 0.0 || duration <= 0.0) {
+        return "Invalid time parameters";
+    }
+    if ((int64_t)columns * job->pyramid.channelCount > capacity) {
+        return "Output buffer too small";
+    }
+    const int64_t start = (int64_t)(startTime * job->pyramid.sampleRate);
+    const int64_t end = start + (int64_t)(duration * job->pyramid.sampleRate);
+    peaks_query_columns(&job->pyramid, start, end, columns, out);
+    return NULL;
+}
+
+const char* audioplayer_set_streaming(AudioPlayer* player, bool enabled, int bufferFrames, int bufferCount) {
+    if (!player || !player->playerNode) {
+        return "Player or player node is null";
+    }
+    if (bufferFrames < 0 || bufferCount < 0) {
+        return "Buffer sizes cannot be negative";
+    }
+    detachStream(player);
+    if (!enabled) {
+        delete streamOf(player);
+        player->stream = NULL;
+        return NULL;
+    }
+
+    if (!player->stream) {
+        player->stream = new (std::nothrow) PlayerStream();
+        if (!player->stream) {
+            return "Failed to create stream";
+        }
+    }
+    stopVariants(player);  // Streaming players run the units live
+    PlayerStream* stream = streamOf(player);
+    stream->bufferFrames = bufferFrames;
+    stream->bufferCount = bufferCount;
+    if (const char* err = attachStream(player)) {
+        delete stream;
+        player->stream = NULL;
+        return err;
+    }
+    headless::logf("Streaming enabled (%d x %d frames)", stream->pool.bufferCount, stream->pool.bufferFrames);
+    return NULL;  // NULL = success
+}
+
+const char* audioplayer_get_streaming_stats(AudioPlayer* player, StreamingStats* stats) {
+    if (!player || !stats) {
+        return "Invalid parameters";
+    }
+    memset(stats, 0, sizeof(*stats));
+    const PlayerStream* stream = streamOf(player);
+    if (stream && stream->file) {
+        stream_pool_stats(&stream->pool, stats);
+        stats->mapped = true;  // The reader always maps
+    } else if (stream) {
+        stats->enabled = true;
+        stats->bufferFrames = stream->bufferFrames;
+        stats->bufferCount = stream->bufferCount;
+        stream_pool_sanitize(&stats->bufferFrames, &stats->bufferCount);
+    }
+    return NULL;  // NULL = success
+}
+
+const char* pcm_cache_set_budget(int64_t budgetBytes) {
+    if (budgetBytes < 0) {
+        return "Budget cannot be negative";
+    }
+    {
+        std::lock_guard<std::mutex> lock(pcmCacheMutex);
+        pcmCache.stats.budgetBytes = budgetBytes;
+    }
+    trimPcmCache();
+    return NULL;  // NULL = success
+}
+
+const char* pcm_cache_get_stats(PcmCacheStats* stats) {
+    if (!stats) {
+        return "Stats pointer is null";
+    }
+    std::lock_guard<std::mutex> lock(pcmCacheMutex);
+    *stats = pcmCache.stats;
+    return NULL;  // NULL = success
+}
+
+const char* audioplayer_prepare_variants(AudioPlayer* player, const PlayerVariant* variants, int count, int workers) {
+    if (!player) {
+        return "Player is null";
+    }
+    if (!player->audioFile) {
+        return "No audio file loaded";
+    }
+    if (!player->timePitchEnabled || !player->timePitchUnit) {
+        return "Time/pitch effects not enabled. Call audioplayer_enable_time_pitch_effects() first";
+    }
+    if (count < 0 || (count > 0 && !variants)) {
+        return "Invalid variant list";
+    }
+    for (int i = 0; i < count; i++) {
+        if (!(variants[i].rate >= 0.25f && variants[i].rate <= 4.0f)) {
+            return headless::errorf("Variant %d: playback rate must be between 0.25 and 4.0", i);
+        }
+        if (!(variants[i].cents >= -2400.0f && variants[i].cents <= 2400.0f)) {
+            return headless::errorf("Variant %d: pitch must be between -2400 and 2400 cents", i);
+        }
+    }
+    if (!player->variants) {
+        player->variants = new (std::nothrow) PlayerVariants();
+        if (!player->variants) {
+            return "Memory allocation failed";
+        }
+    }
+    PlayerVariants* state = variantsOf(player);
+    state->job.reset();  // Replaced; whatever it finished stays cached
+
+    const AudioFile* file = audioFileOf(player);
+    std::unique_ptr<VariantJob> job(new (std::nothrow) VariantJob());
+    if (!job) {
+        return "Memory allocation failed";
+    }
+    if (!pcm_cache_identify(file->path.c_str(), &job->fileSize, &job->fileModified)) {
+        return "Loaded file is no longer readable";
+    }
+    job->file = file;
+    {
+        GraphLock lock(playerNodeOf(player));
+        for (int i = 0; i < count; i++) {
+            const VariantParams params = variantParams(player, variants[i].rate, variants[i].cents);
+            char* key = variant_cache_key(file->path.c_str(), &params);
+            if (!key) {
+                return "Memory allocation failed";
+            }
+            if (!variant_is_identity(&params)) {  // Unity needs no variant
+                job->params.push_back(params);
+                job->keys.emplace_back(key);
+            }
+            free(key);
+        }
+    }
+    const int jobs = (int)job->params.size();
+    job->pending.store(jobs);
+    if (workers <= 0) {
+        workers = (int)std::thread::hardware_concurrency();
+    }
+    for (int i = 0; i < std::min(std::max(workers, 1), jobs); i++) {
+        job->workers.emplace_back(runVariantJob, job.get());
+    }
+    state->job = std::move(job);
+    headless::logf("Preparing %d variants on %d workers", jobs, (int)state->job->workers.size());
+    return NULL;  // NULL = success
+}
+
+const char* audioplayer_get_variants_status(AudioPlayer* player, PlayerVariantsStatus* status) {
+    if (!player || !status) {
+        return "Player or status pointer is null";
+    }
+    memset(status, 0, sizeof(*status));
+    PlayerVariants* variants = variantsOf(player);
+    if (!variants) {
+        return NULL;  // Nothing prepared or set
+    }
+    std::vector<const AudioFile*> released;
+    {
+        GraphLock lock(playerNodeOf(player));
+        status->active = playerNodeOf(player)->variant() != nullptr;
+        collectVariants(player, variants, released);
+    }
+    for (const AudioFile* variant : released) {
+        releaseVariant(variant);
+    }
+    if (VariantJob* job = variants->job.get()) {
+        status->requested = (int)job->params.size();
+        for (int i = 0; i < status->requested; i++) {
+            status->ready += job->cached(i) ? 1 : 0;
+        }
+        status->pending = job->pending.load(std::memory_order_acquire);
+        status->failed = job->failed.load(std::memory_order_relaxed);
+        std::lock_guard<std::mutex> lock(job->mutex);
+        status->error = job->error.empty() ? NULL : job->error.c_str();
+    }
+    return NULL;  // NULL = success
+}
+
+const char* variant_cache_configure(int64_t budgetBytes, const char* directory, int64_t diskBudgetBytes) {
+    if (budgetBytes < 0 || diskBudgetBytes < 0) {
+        return "Budget cannot be negative";
+    }
+    const bool onDisk = directory && *directory;
+    if (onDisk && diskBudgetBytes <= 0) {
+        return "Disk budget must be positive";
+    }
+    if (onDisk && !analysis_cache_prepare(directory)) {
+        return headless::errorf("Failed to create variant cache at %s: %s", directory, strerror(errno));
+    }
+    {
+        std::lock_guard<std::mutex> lock(variantCacheMutex);
+        variantCache.stats.budgetBytes = budgetBytes;
+        variantCacheDirectory = onDisk ? directory : "";
+        variantDiskBudget = onDisk ? diskBudgetBytes : 0;
+        if (onDisk) {
+            int64_t bytes;
+            int entries;
+            variant_cache_evict(directory, diskBudgetBytes, &bytes, &entries);
+        }
+    }
+    trimVariantCache();
+    return NULL;  // NULL = success
+}
+
+const char* variant_cache_get_stats(VariantCacheStats* stats) {
+    if (!stats) {
+        return "Stats pointer is null";
+    }
+    memset(stats, 0, sizeof(*stats));
+    std::lock_guard<std::mutex> lock(variantCacheMutex);
+    stats->entries = variantCache.stats.entries;
+    stats->inUse = variantCache.stats.inUse;
+    stats->bytes = variantCache.stats.bytes;
+    stats->budgetBytes = variantCache.stats.budgetBytes;
+    stats->hits = variantCache.stats.hits;
+    stats->misses = variantCache.stats.misses;
+    stats->evictions = variantCache.stats.evictions;
+    stats->diskHits = variantDiskHits;
+    stats->renders = variantRenders;
+    stats->diskBudgetBytes = variantDiskBudget;
+    if (!variantCacheDirectory.empty()) {
+        variant_cache_evict(variantCacheDirectory.c_str(), INT64_MAX, &stats->diskBytes, &stats->diskEntries);  // Just sizes
+    }
+    return NULL;  // NULL = success
+}
+
+const char* analysis_cache_open(const char* directory, int64_t maxBytes) {
+    if (!directory || !*directory) {
+        return "Cache directory is empty";
+    }
+    if (maxBytes <= 0) {
+        return "Cache size cap must be positive";
+    }
+    if (!analysis_cache_prepare(directory)) {
+        return headless::errorf("Failed to create analysis cache at %s: %s", directory, strerror(errno));
+    }
+    std::lock_guard<std::mutex> lock(analysisCacheMutex);
+    analysisCacheDirectory = directory;
+    analysisCacheCounters = AnalysisCacheStats{};
+    analysisCacheCounters.maxBytes = maxBytes;
+    int64_t bytes;
+    int entries;
+    if (analysis_cache_evict(directory, maxBytes, &bytes, &entries) > 0) {
+        analysis_cache_prune_aliases(directory);
+    }
+    return NULL;
+}
+
+void analysis_cache_close(void) {
+    std::lock_guard<std::mutex> lock(analysisCacheMutex);
+    analysisCacheDirectory.clear();
+}
+
+const char* analysis_cache_get_stats(AnalysisCacheStats* stats) {
+    if (!stats) {
+        return "Stats pointer is null";
+    }
+    std::lock_guard<std::mutex> lock(analysisCacheMutex);
+    if (analysisCacheDirectory.empty()) {
+        return "Analysis cache is not open";
+    }
+    *stats = analysisCacheCounters;
+    analysis_cache_evict(analysisCacheDirectory.c_str(), INT64_MAX, &stats->bytes, &stats->entries);  // Just sizes
+    return NULL;
+}
+
+const char* analysis_cache_clear(void) {
+    std::lock_guard<std::mutex> lock(analysisCacheMutex);
+    if (analysisCacheDirectory.empty()) {
+        return "Analysis cache is not open";
+    }
+    int64_t bytes;
+    int entries;
+    analysis_cache_evict(analysisCacheDirectory.c_str(), 0, &bytes, &entries);
+    analysis_cache_prune_aliases(analysisCacheDirectory.c_str());
+    return NULL;
+}
+
+const char* file_analysis_start(const char* const* paths, int count, int workers, int flags, FileAnalysisBatch** batch) {
+    if (!batch) {
+        return "Batch pointer is null";
+    }
+    *batch = NULL;
+    if (count < 0 || (count > 0 && !paths)) {
+        return "Invalid path list";
+    }
+    for (int i = 0; i < count; i++) {
+        if (!paths[i]) {
+            return headless::errorf("Path %d is null", i);
+        }
+    }
+
+    FileAnalysisBatch* created = new FileAnalysisBatch();
+    created->paths.assign(paths, paths + count);
+    created->flags = flags;
+    created->results.resize((size_t)count);
+    created->errors.resize((size_t)count);
+    if (workers <= 0) {
+        workers = (int)std::thread::hardware_concurrency();
+    }
+    created->running = std::max(1, std::min(workers, count));
+    if (count == 0) {
+        created->running = 0;
+    }
+    for (int i = 0; i < created->running; i++) {
+        created->workers.emplace_back(runFileAnalysis, created);
+    }
+    *batch = created;
+    return NULL;
+}
+
+int file_analysis_next(FileAnalysisBatch* batch, FileAnalysisResult* results, int capacity, int timeoutMs) {
+    if (!batch) {
+        return -1;
+    }
+    std::unique_lock<std::mutex> lock(batch->mutex);
+    batch->reported.wait_for(lock, std::chrono::milliseconds(std::max(timeoutMs, 0)),
+                             [batch] { return batch->produced > batch->consumed || batch->running == 0; });
+    if (batch->produced == batch->consumed) {
+        return batch->running == 0 ? -1 : 0;
+    }
+    if (!results || capacity <= 0) {
+        return 0;
+    }
+    const int n = std::min(capacity, batch->produced - batch->consumed);
+    std::copy_n(batch->results.begin() + batch->consumed, n, results);
+    batch->consumed += n;
+    return n;
+}
+
+void file_analysis_cancel(FileAnalysisBatch* batch) {
+    if (batch) {
+        batch->cancelled.store(true, std::memory_order_relaxed);
+    }
+}
+
+void file_analysis_destroy(FileAnalysisBatch* batch) {
+    if (!batch) {
+        return;
+    }
+    file_analysis_cancel(batch);
+    for (std::thread& worker : batch->workers) {
+        worker.join();
+    }
+    delete batch;
+}
+
+}  // extern "C"
@@ -0,0 +1,226 @@
+// Headless sampler: SamplerNode and the audiosampler_* C ABI.
+
+#include "../macaudio.h"
+#include "headless.hpp"
+
+#include <cmath>
+#include <cstdlib>
+
+namespace headless {
+
+namespace {
+
+constexpr double kAttackSeconds = 0.005;
+constexpr double kReleaseSeconds = 0.120;
+
+}  // namespace
+
+int SamplerNode::outputChannelCount() const {
+    return engine ? engine->format.channelCount : kDefaultChannelCount;
+}
+
+void SamplerNode::reset() {
+    for (Voice& voice : voices_) {
+        voice.active = false;
+    }
+}
+
+void SamplerNode::startNote(int note, int velocity, int channel) {
+    if (velocity == 0) {
+        stopNote(note, channel);  // MIDI note-on with zero velocity is a note-off
+        return;
+    }
+
+    // Reuse a free voice, otherwise steal the oldest one
+    Voice* target = &voices_[0];
+    for (Voice& voice : voices_) {
+        if (!voice.active) {
+            target = &voice;
+            break;
+        }
+        if (voice.started < target->started) {
+            target = &voice;
+        }
+    }
+
+    const double sampleRate = engine ? engine->format.sampleRate : kDefaultSampleRate;
+    const double frequency = 440.0 * pow(2.0, (note - 69) / 12.0);
+    const float level = (float)velocity / 127.0f;
+
+    target->active = true;
+    target->released = false;
+    target->note = note;
+    target->channel = channel;
+    target->phase = 0.0;
+    target->increment = 2.0 * M_PI * frequency / sampleRate;
+    target->amplitude = 0.25f * level * level;
+    target->envelope = 0.0f;
+    target->started = ++noteCounter_;
+}
+
+void SamplerNode::stopNote(int note, int channel) {
+    for (Voice& voice : voices_) {
+        if (voice.active && voice.note == note && voice.channel == channel) {
+            voice.released = true;
+        }
+    }
+}
+
+void SamplerNode::render(const RenderContext& ctx, Buffer& out, int frames) {
+    out.clear(frames);
+    const float attackStep = (float)(1.0 / (kAttackSeconds * ctx.sampleRate));
+    const float releaseStep = (float)(1.0 / (kReleaseSeconds * ctx.sampleRate));
+
+    float* left = out.channel(0);
+    for (Voice& voice : voices_) {
+        if (!voice.active) {
+            continue;
+        }
+        for (int i = 0; i < frames; i++) {
+            if (voice.released) {
+                voice.envelope -= releaseStep;
+                if (voice.envelope <= 0.0f) {
+                    voice.active = false;
+                    break;
+                }
+            } else if (voice.envelope < 1.0f) {
+                voice.envelope = fminf(1.0f, voice.envelope + attackStep);
+            }
+            left[i] += (float)sin(voice.phase) * voice.amplitude * voice.envelope;
+            voice.phase += voice.increment;
+            if (voice.phase >= 2.0 * M_PI) {
+                voice.phase -= 2.0 * M_PI;
+            }
+        }
+    }
+
+    // The instrument is mono; duplicate it across the remaining channels
+    for (int c = 1; c < out.channels(); c++) {
+        float* dst = out.channel(c);
+        for (int i = 0; i < frames; i++) {
+            dst[i] = left[i];
+        }
+    }
+}
+
+}  // namespace headless
+
+using headless::Engine;
+using headless::GraphLock;
+using headless::Node;
+using headless::SamplerNode;
+
+static SamplerNode* samplerNodeOf(AudioSampler* sampler) {
+    return static_cast<SamplerNode*>(static_cast<Node*>(sampler->samplerNode));
+}
+
+extern "C" {
+
+AudioSamplerResult audiosampler_create(void* enginePtr) {
+    AudioSamplerResult result = {};
+
+    if (!enginePtr) {
+        result.error = "Engine pointer is required";
+        return result;
+    }
+
+    Engine* engine = static_cast<Engine*>(enginePtr);
+    SamplerNode* samplerNode = new (std::nothrow) SamplerNode();
+    if (!samplerNode) {
+        result.error = "Failed to create AVAudioUnitSampler";
+        return result;
+    }
+
+    engine->attach(samplerNode);
+
+    AudioSampler* wrapper = (AudioSampler*)malloc(sizeof(AudioSampler));
+    if (!wrapper) {
+        engine->detach(samplerNode);
+        samplerNode->release();
+        result.error = "Failed to allocate memory for sampler wrapper";
+        return result;
+    }
+
+    wrapper->samplerNode = static_cast<Node*>(samplerNode);
+    wrapper->engine = enginePtr;
+    wrapper->isConnected = false;
+
+    result.result = wrapper;
+    return result;
+}
+
+const char* audiosampler_start_note(AudioSampler* sampler, int note, int velocity, int channel) {
+    if (!sampler || !sampler->samplerNode) {
+        return "Invalid sampler";
+    }
+    if (note < 0 || note > 127) {
+        return "Note must be between 0 and 127";
+    }
+    if (velocity < 0 || velocity > 127) {
+        return "Velocity must be between 0 and 127";
+    }
+    if (channel < 0 || channel > 15) {
+        return "Channel must be between 0 and 15";
+    }
+
+    SamplerNode* samplerNode = samplerNodeOf(sampler);
+    GraphLock lock(samplerNode);
+    samplerNode->startNote(note, velocity, channel);
+    return NULL;  // Success
+}
+
+const char* audiosampler_stop_note(AudioSampler* sampler, int note, int channel) {
+    if (!sampler || !sampler->samplerNode) {
+        return "Invalid sampler";
+    }
+    if (note < 0 || note > 127) {
+        return "Note must be between 0 and 127";
+    }
+    if (channel < 0 || channel > 15) {
+        return "Channel must be between 0 and 15";
+    }
+
+    SamplerNode* samplerNode = samplerNodeOf(sampler);
+    GraphLock lock(samplerNode);
+    samplerNode->stopNote(note, channel);
+    return NULL;  // Success
+}
+
+const char* audiosampler_connect_to_mixer(AudioSampler* sampler, void* mixerPtr, int busIndex) {
+    if (!sampler || !sampler->samplerNode || !sampler->engine || !mixerPtr) {
+        return "Invalid parameters";
+    }
+    if (busIndex < 0) {
+        return "Bus index must be non-negative";
+    }
+
+    SamplerNode* samplerNode = samplerNodeOf(sampler);
+    if (!samplerNode->engine) {
+        return "Exception connecting sampler: sampler is not attached to an engine";
+    }
+    const char* err = samplerNode->engine->connect(samplerNode, static_cast<Node*>(mixerPtr), 0, busIndex, nullptr);
+    if (err) {
+        return headless::errorf("Exception connecting sampler: %s", err);
+    }
+    sampler->isConnected = true;
+    return NULL;  // Success
+}
+
+void audiosampler_destroy(AudioSampler* sampler) {
+    if (!sampler) {
+        return;
+    }
+
+    if (sampler->samplerNode) {
+        SamplerNode* samplerNode = samplerNodeOf(sampler);
+        if (samplerNode->engine) {
+            // Detaching also drops the connection to the mixer
+            samplerNode->engine->detach(samplerNode);
+        }
+        samplerNode->release();
+    }
+
+    free(sampler);
+}
+
+}  // extern "C"
@@ -0,0 +1,970 @@
+// Headless tap_* implementation.
+//
+// Same design as ../tap.m: every tap owns preallocated single-producer rings
+// (metrics and planar PCM). The tap block runs on the render thread and only
+// stores into its own rings, publishing with release stores; it never locks or
+// allocates. The registry mutex is taken by control/reader threads only.
+// Registered taps live in a fixed slot table addressed by TapHandle (slot
+// index plus generation), as in the AVFoundation backend. Spectrum analysis
+// runs on a per-tap worker thread that reads the PCM ring like any other reader.
+
+#include "../macaudio.h"
+#include "../loudness.h"
+#include "../meter.h"
+#include "../spectrum.h"
+#include "headless.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <condition_variable>
+#include <cstring>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+using headless::Buffer;
+using headless::Engine;
+using headless::Format;
+using headless::GraphLock;
+using headless::Node;
+
+namespace {
+
+constexpr uint64_t kMetricsRingSize = 8;  // Power of two
+constexpr int64_t kPcmRingFrames = 32768;  // Power of two, per channel
+constexpr int64_t kPcmGuardFrames = 8192;  // Headroom for a written but unpublished block
+constexpr int64_t kPcmReadableFrames = kPcmRingFrames - kPcmGuardFrames;
+
+// Spectrum worker of one tap; stopped before its analyzer is reconfigured or freed
+struct SpectrumWorker {
+    std::thread thread;
+    std::mutex mutex;
+    std::condition_variable wake;
+    bool stop = false;
+};
+
+struct TapState {
+    ~TapState();
+
+    std::string key;
+    TapHandle handle = TAP_INVALID_HANDLE;
+    Node* node = nullptr;  // Retained while the tap is registered
+    Engine* engine = nullptr;
+    int busIndex = 0;
+    double sampleRate = 0.0;
+    int channelCount = 0;
+
+    // Metrics ring: slot (n - 1) % size holds the newest of n published blocks
+    TapMetrics metrics[kMetricsRingSize] = {};
+    std::atomic<uint64_t> metricsWritten{0};
+
+    // PCM ring: channelCount planes of kPcmRingFrames floats
+    std::vector<float> pcm;
+    std::atomic<int64_t> pcmWritten{0};
+
+    // Optional EBU R128 meter, allocated on first enable and freed with the tap
+    std::unique_ptr<LoudnessState> loudnessStorage;
+    std::atomic<LoudnessState*> loudness{nullptr};
+    std::atomic<bool> loudnessEnabled{false};
+
+    // Optional spectrum analyzer, allocated on enable and fed by spectrumWorker
+    std::unique_ptr<SpectrumAnalyzer> spectrum;
+    SpectrumConfig spectrumConfig = {};
+    std::unique_ptr<SpectrumWorker> spectrumWorker;
+
+    // Zero-copy readers (tap_get_ring, tap_get_spectrum); guarded by tapsMutex
+    int ringRefs = 0;
+    int spectrumRefs = 0;
+};
+
+struct TapSlot {
+    std::unique_ptr<TapState> tap;  // Null when free
+    uint16_t generation = 0;        // Bumped on removal; never 0 once used
+};
+
+// Tap registry, mirroring the AVFoundation backend
+std::mutex tapsMutex;
+TapSlot* tapSlots = nullptr;  // TAP_MAX_TAPS slots
+int tapSlotsUsed = 0;         // One past the highest slot ever used
+std::vector<std::unique_ptr<TapState>>* mappedTaps = nullptr;  // Removed but still mapped by a reader
+
+// Render thread: publish one buffer into the tap's rings
+void processTap(TapState* tap, const Buffer& buffer, int frames, int64_t sampleTime) {
+    if (frames <= 0 || buffer.channels() == 0) {
+        return;
+    }
+
+    // Meter every channel straight into the next ring slot
+    const int channels = std::min(tap->channelCount, buffer.channels());
+    const int metered = std::min(channels, TAP_METER_MAX_CHANNELS);
+    const uint64_t written = tap->metricsWritten.load(std::memory_order_relaxed);
+    TapMetrics& slot = tap->metrics[written & (kMetricsRingSize - 1)];
+    for (int c = 0; c < metered; c++) {
+        meter_channel(buffer.channel(c), frames, &slot.channels[c]);
+    }
+    slot.channelCount = metered;
+    slot.sampleTime = sampleTime;
+    slot.hostTime = (uint64_t)std::chrono::duration_cast<std::chrono::nanoseconds>(
+                        std::chrono::steady_clock::now().time_since_epoch())
+                        .count();
+    slot.frameLength = frames;
+    slot.rms = slot.channels[0].rms;
+    slot.peak = slot.channels[0].peak;
+    tap->metricsWritten.store(written + 1, std::memory_order_release);
+
+    // PCM: keep the newest kPcmReadableFrames frames of each channel
+    const int64_t pcmWritten = tap->pcmWritten.load(std::memory_order_relaxed);
+    const int skip = frames > kPcmReadableFrames ? frames - (int)kPcmReadableFrames : 0;
+    for (int c = 0; c < channels; c++) {
+        float* plane = tap->pcm.data() + (size_t)c * kPcmRingFrames;
+        const float* src = buffer.channel(c);
+        for (int i = skip; i < frames; i++) {
+            plane[(pcmWritten + i) & (kPcmRingFrames - 1)] = src[i];
+        }
+    }
+    tap->pcmWritten.store(pcmWritten + frames, std::memory_order_release);
+
+    LoudnessState* loudness = tap->loudness.load(std::memory_order_acquire);
+    if (loudness && tap->loudnessEnabled.load(std::memory_order_relaxed)) {
+        const float* planes[LOUDNESS_MAX_CHANNELS];
+        for (int c = 0; c < loudness->channelCount && c < channels; c++) {
+            planes[c] = buffer.channel(c);
+        }
+        loudness_process(loudness, planes, frames);
+    }
+}
+
+// Copy the newest published metrics without blocking the producer. Retries if
+// the producer lapped the ring while the slot was being copied.
+void snapshotMetrics(const TapState* tap, TapMetrics* out) {
+    for (;;) {
+        const uint64_t written = tap->metricsWritten.load(std::memory_order_acquire);
+        if (written == 0) {
+            memset(out, 0, sizeof(*out));
+            return;
+        }
+        *out = tap->metrics[(written - 1) & (kMetricsRingSize - 1)];
+        std::atomic_thread_fence(std::memory_order_acquire);
+        if (tap->metricsWritten.load(std::memory_order_relaxed) - written < kMetricsRingSize - 1) {
+            return;
+        }
+    }
+}
+
+TapState* findTap(const char* tapKey) {
+    for (int i = 0; i < tapSlotsUsed; i++) {
+        TapState* tap = tapSlots[i].tap.get();
+        if (tap && tap->key == tapKey) {
+            return tap;
+        }
+    }
+    return nullptr;
+}
+
+TapState* tapFromHandle(TapHandle handle) {
+    const uint32_t index = handle & 0xFFFF;
+    if (index >= TAP_MAX_TAPS) {
+        return nullptr;
+    }
+    const TapSlot& slot = tapSlots[index];
+    return slot.generation == (uint16_t)(handle >> 16) ? slot.tap.get() : nullptr;
+}
+
+// Take a tap out of its slot and invalidate its handle. Caller holds tapsMutex.
+std::unique_ptr<TapState> unregisterTap(TapState* tap) {
+    TapSlot& slot = tapSlots[tap->handle & 0xFFFF];
+    slot.generation = slot.generation == UINT16_MAX ? 1 : slot.generation + 1;
+    return std::move(slot.tap);
+}
+
+void infoOf(const TapState* tap, TapInfo* info) {
+    info->tapPtr = (void*)tap;  // Unique while the tap is installed
+    info->handle = tap->handle;
+    info->nodePtr = tap->node;
+    info->busIndex = tap->busIndex;
+    info->isActive = true;
+    info->sampleRate = tap->sampleRate;
+    info->channelCount = tap->channelCount;
+}
+
+void readPcm(const TapState* tap, float* buffer, int maxFrames, bool interleaved, int64_t* cursor, int* framesRead) {
+    const int channels = tap->channelCount;
+    int64_t start = *cursor;
+    int frames = 0;
+    for (;;) {
+        const int64_t written = tap->pcmWritten.load(std::memory_order_acquire);
+        start = std::min(std::max(start, written - kPcmReadableFrames), written);
+        frames = (int)std::min<int64_t>(written - start, maxFrames);
+        for (int c = 0; c < channels; c++) {
+            const float* plane = tap->pcm.data() + (size_t)c * kPcmRingFrames;
+            for (int i = 0; i < frames; i++) {
+                const float sample = plane[(start + i) & (kPcmRingFrames - 1)];
+                if (interleaved) {
+                    buffer[(size_t)i * channels + c] = sample;
+                } else {
+                    buffer[(size_t)c * frames + i] = sample;
+                }
+            }
+        }
+        std::atomic_thread_fence(std::memory_order_acquire);
+        // Valid unless the producer overwrote part of [start, start + frames) meanwhile
+        if (tap->pcmWritten.load(std::memory_order_relaxed) - kPcmReadableFrames <= start) {
+            break;
+        }
+    }
+
+    *cursor = start + frames;
+    *framesRead = frames;
+}
+
+void runSpectrum(TapState* tap, SpectrumWorker* worker) {
+    // Wake about once per hop; late wakes just skip to the newest window
+    const double hopSeconds = tap->spectrum->plan.hopSize / tap->sampleRate;
+    const auto interval = std::chrono::microseconds((int64_t)(std::min(std::max(hopSeconds, 0.001), 0.05) * 1e6));
+    std::unique_lock<std::mutex> lock(worker->mutex);
+    while (!worker->stop) {
+        lock.unlock();
+        spectrum_analyzer_update(tap->spectrum.get(), tap->pcm.data(), (int)kPcmRingFrames, (int)kPcmReadableFrames,
+                                 reinterpret_cast<const int64_t*>(&tap->pcmWritten));
+        lock.lock();
+        worker->wake.wait_for(lock, interval, [worker] { return worker->stop; });
+    }
+}
+
+void startSpectrum(TapState* tap) {
+    spectrum_analyzer_start(tap->spectrum.get(), tap->pcmWritten.load(std::memory_order_acquire));
+    tap->spectrumWorker.reset(new SpectrumWorker());
+    tap->spectrumWorker->thread = std::thread(runSpectrum, tap, tap->spectrumWorker.get());
+}
+
+void stopSpectrum(TapState* tap) {
+    if (!tap->spectrumWorker) {
+        return;
+    }
+    {
+        std::lock_guard<std::mutex> lock(tap->spectrumWorker->mutex);
+        tap->spectrumWorker->stop = true;
+    }
+    tap->spectrumWorker->wake.notify_one();
+    tap->spectrumWorker->thread.join();
+    tap->spectrumWorker.reset();
+}
+
+TapState::~TapState() {
+    stopSpectrum(this);
+    if (spectrum) {
+        spectrum_analyzer_free(spectrum.get());
+    }
+}
+
+void mapRing(TapState* tap, TapRing* ring) {
+    static_assert(sizeof(std::atomic<int64_t>) == sizeof(int64_t), "write index must be a plain int64 in memory");
+    tap->ringRefs++;
+    ring->data = tap->pcm.data();
+    ring->writeIndex = reinterpret_cast<const int64_t*>(&tap->pcmWritten);
+    ring->channelCount = tap->channelCount;
+    ring->capacity = (int)kPcmRingFrames;
+    ring->readable = (int)kPcmReadableFrames;
+    ring->sampleRate = tap->sampleRate;
+    ring->handle = tap;
+}
+
+// Removing the tap under the graph lock guarantees the render thread is not
+// inside the block, so the state can be freed right after.
+void releaseTap(TapState& tap) {
+    stopSpectrum(&tap);
+    if (tap.node) {
+        GraphLock lock(tap.node);
+        tap.node->removeTap(tap.busIndex);
+        tap.node->release();
+        tap.node = nullptr;
+    }
+}
+
+// Free a removed tap, or park it until the last tap_release_ring or
+// tap_release_spectrum if a reader still maps its memory
+void retireTap(std::unique_ptr<TapState> tap) {
+    std::lock_guard<std::mutex> lock(tapsMutex);
+    if (tap->ringRefs > 0 || tap->spectrumRefs > 0) {
+        mappedTaps->push_back(std::move(tap));
+    }
+}
+
+// Drop a reader mapping; frees a parked tap after its last one. Caller holds tapsMutex.
+void unmapTap(TapState* tap) {
+    if (tap->ringRefs > 0 || tap->spectrumRefs > 0) {
+        return;
+    }
+    auto it = std::find_if(mappedTaps->begin(), mappedTaps->end(),
+                           [tap](const std::unique_ptr<TapState>& mapped) { return mapped.get() == tap; });
+    if (it != mappedTaps->end()) {
+        mappedTaps->erase(it);
+    }
+}
+
+}  // namespace
+
+extern "C" {
+
+void tap_init(void) {
+    std::lock_guard<std::mutex> lock(tapsMutex);
+    if (!tapSlots) {
+        tapSlots = new TapSlot[TAP_MAX_TAPS];
+        mappedTaps = new std::vector<std::unique_ptr<TapState>>();
+    }
+}
+
+const char* tap_install(void* enginePtr, void* nodePtr, int busIndex, const char* tapKey, TapHandle* handle) {
+    if (!enginePtr) {
+        return "Engine pointer is null";
+    }
+    if (!nodePtr) {
+        return "Node pointer is null";
+    }
+    if (!tapKey) {
+        return "Tap key is null";
+    }
+
+    tap_init();
+
+    Engine* engine = static_cast<Engine*>(enginePtr);
+    Node* node = static_cast<Node*>(nodePtr);
+
+    std::lock_guard<std::mutex> lock(tapsMutex);
+    if (findTap(tapKey)) {
+        return headless::errorf("🚨 TAP KEY COLLISION: '%s' already exists - remove existing tap first", tapKey);
+    }
+    if (!engine->isAttached(node)) {
+        return "Node is not attached to engine";
+    }
+    if (busIndex < 0 || busIndex >= node->numberOfOutputs()) {
+        return headless::errorf("Invalid bus index %d for node with %d outputs", busIndex, node->numberOfOutputs());
+    }
+
+    // Lowest free slot keeps handles dense
+    int slotIndex = 0;
+    while (slotIndex < TAP_MAX_TAPS && tapSlots[slotIndex].tap) {
+        slotIndex++;
+    }
+    if (slotIndex == TAP_MAX_TAPS) {
+        return headless::errorf("Tap table full (%d taps)", TAP_MAX_TAPS);
+    }
+
+    // All per-tap memory is allocated here, never in the block
+    std::unique_ptr<TapState> tap(new TapState());
+    TapState* state = tap.get();
+    {
+        GraphLock graphLock(node);
+        const Format format = node->outputFormat(busIndex);
+        state->key = tapKey;
+        state->engine = engine;
+        state->busIndex = busIndex;
+        state->sampleRate = format.sampleRate;
+        state->channelCount = format.channelCount;
+        state->pcm.assign((size_t)format.channelCount * kPcmRingFrames, 0.0f);
+
+        node->setTap(busIndex, [state](const Buffer& buffer, int frames, const Format&, int64_t sampleTime) {
+            processTap(state, buffer, frames, sampleTime);
+        });
+        node->retain();
+        state->node = node;
+    }
+
+    TapSlot& slot = tapSlots[slotIndex];
+    if (slot.generation == 0) {
+        slot.generation = 1;
+    }
+    state->handle = ((TapHandle)slot.generation << 16) | (TapHandle)slotIndex;
+    slot.tap = std::move(tap);
+    tapSlotsUsed = std::max(tapSlotsUsed, slotIndex + 1);
+    if (handle) {
+        *handle = state->handle;
+    }
+
+    headless::logf("tap_install: Successfully installed tap '%s' on bus %d (%.0f Hz, %d channels)", tapKey, busIndex,
+                   state->sampleRate, state->channelCount);
+    return NULL;  // Success
+}
+
+const char* tap_lookup(const char* tapKey, TapHandle* handle) {
+    if (!tapKey) {
+        return "Tap key is null";
+    }
+    if (!handle) {
+        return "Handle pointer is null";
+    }
+
+    tap_init();
+
+    std::lock_guard<std::mutex> lock(tapsMutex);
+    const TapState* tap = findTap(tapKey);
+    *handle = tap ? tap->handle : TAP_INVALID_HANDLE;
+    return tap ? NULL : "Tap not found";
+}
+
+const char* tap_remove(const char* tapKey) {
+    if (!tapKey) {
+        return "Tap key is null";
+    }
+
+    tap_init();
+
+    std::unique_ptr<TapState> tap;
+    {
+        std::lock_guard<std::mutex> lock(tapsMutex);
+        TapState* found = findTap(tapKey);
+        if (!found) {
+            return "Tap not found";
+        }
+        tap = unregisterTap(found);
+    }
+    releaseTap(*tap);
+    retireTap(std::move(tap));
+
+    headless::logf("tap_remove: Successfully removed tap '%s'", tapKey);
+    return NULL;  // Success
+}
+
+const char* tap_remove_handle(TapHandle handle) {
+    tap_init();
+
+    std::unique_ptr<TapState> tap;
+    {
+        std::lock_guard<std::mutex> lock(tapsMutex);
+        TapState* found = tapFromHandle(handle);
+        if (!found) {
+            return "Invalid or stale tap handle";
+        }
+        tap = unregisterTap(found);
+    }
+    releaseTap(*tap);
+    retireTap(std::move(tap));
+    return NULL;  // Success
+}
+
+const char* tap_get_info(const char* tapKey, TapInfo* info) {
+    if (!tapKey) {
+        return "Tap key is null";
+    }
+    if (!info) {
+        return "Info pointer is null";
+    }
+
+    tap_init();
+
+    std::lock_guard<std::mutex> lock(tapsMutex);
+    const TapState* tap = findTap(tapKey);
+    if (!tap) {
+        return "Tap not found";
+    }
+    infoOf(tap, info);
+    return NULL;  // Success
+}
+
+const char* tap_get_info_handle(TapHandle handle, TapInfo* info) {
+    if (!info) {
+        return "Info pointer is null";
+    }
+
+    tap_init();
+
+    std::lock_guard<std::mutex> lock(tapsMutex);
+    const TapState* tap = tapFromHandle(handle);
+    if (!tap) {
+        return "Invalid or stale tap handle";
+    }
+    infoOf(tap, info);
+    return NULL;  // Success
+}
+
+const char* tap_get_metrics(const char* tapKey, TapMetrics* metrics) {
+    if (!tapKey) {
+        return "Tap key is null";
+    }
+    if (!metrics) {
+        return "Metrics pointer is null";
+    }
+
+    tap_init();
+
+    std::lock_guard<std::mutex> lock(tapsMutex);
+    const TapState* tap = findTap(tapKey);
+    if (!tap) {
+        return "Tap not found";
+    }
+    snapshotMetrics(tap, metrics);
+    return NULL;  // Success
+}
+
+const char* tap_get_metrics_handle(TapHandle handle, TapMetrics* metrics) {
+    if (!metrics) {
+        return "Metrics pointer is null";
+    }
+
+    tap_init();
+
+    std::lock_guard<std::mutex> lock(tapsMutex);
+    const TapState* tap = tapFromHandle(handle);
+    if (!tap) {
+        return "Invalid or stale tap handle";
+    }
+    snapshotMetrics(tap, metrics);
+    return NULL;  // Success
+}
+
+int tap_get_metrics_batch(const char* const* tapKeys, int count, TapMetrics* metrics, bool* found) {
+    if (!tapKeys || !metrics || count <= 0) {
+        return 0;
+    }
+
+    tap_init();
+
+    int foundCount = 0;
+    std::lock_guard<std::mutex> lock(tapsMutex);
+    for (int i = 0; i < count; i++) {
+        const TapState* tap = tapKeys[i] ? findTap(tapKeys[i]) : nullptr;
+        if (tap) {
+            snapshotMetrics(tap, &metrics[i]);
+            foundCount++;
+        } else {
+            memset(&metrics[i], 0, sizeof(metrics[i]));
+        }
+        if (found) {
+            found[i] = tap != nullptr;
+        }
+    }
+    return foundCount;
+}
+
+int tap_get_metrics_handles(const TapHandle* handles, int count, TapMetrics* metrics, bool* found) {
+    if (!handles || !metrics || count <= 0) {
+        return 0;
+    }
+
+    tap_init();
+
+    int foundCount = 0;
+    std::lock_guard<std::mutex> lock(tapsMutex);
+    for (int i = 0; i < count; i++) {
+        const TapState* tap = tapFromHandle(handles[i]);
+        if (tap) {
+            snapshotMetrics(tap, &metrics[i]);
+            foundCount++;
+        } else {
+            memset(&metrics[i], 0, sizeof(metrics[i]));
+        }
+        if (found) {
+            found[i] = tap != nullptr;
+        }
+    }
+    return foundCount;
+}
+
+const char* tap_get_metrics_all(TapMetrics* metrics, TapHandle* handles, int capacity, char* keyBuffer,
+                                int keyBufferSize, int* tapCount, int* keyBytes) {
+    if (!tapCount || !keyBytes) {
+        return "Result pointer is null";
+    }
+
+    tap_init();
+
+    std::lock_guard<std::mutex> lock(tapsMutex);
+    int count = 0;
+    int bytes = 0;
+    for (int s = 0; s < tapSlotsUsed; s++) {
+        if (tapSlots[s].tap) {
+            count++;
+            bytes += (int)tapSlots[s].tap->key.size() + 1;
+        }
+    }
+    *tapCount = count;
+    *keyBytes = bytes;
+
+    if (count <= capacity && bytes <= keyBufferSize && (count == 0 || (metrics && keyBuffer))) {
+        int i = 0;
+        char* key = keyBuffer;
+        for (int s = 0; s < tapSlotsUsed; s++) {
+            const TapState* tap = tapSlots[s].tap.get();
+            if (!tap) {
+                continue;
+            }
+            if (handles) {
+                handles[i] = tap->handle;
+            }
+            snapshotMetrics(tap, &metrics[i++]);
+            memcpy(key, tap->key.c_str(), tap->key.size() + 1);
+            key += tap->key.size() + 1;
+        }
+    }
+    return NULL;  // Success
+}
+
+const char* tap_get_rms(const char* tapKey, double* result) {
+    if (!result) {
+        return "Result pointer is null";
+    }
+
+    TapMetrics metrics;
+    const char* err = tap_get_metrics(tapKey, &metrics);
+    if (err) {
+        return err;
+    }
+    *result = metrics.rms;
+    return NULL;  // Success
+}
+
+const char* tap_get_frame_count(const char* tapKey, int* result) {
+    if (!result) {
+        return "Result pointer is null";
+    }
+
+    TapMetrics metrics;
+    const char* err = tap_get_metrics(tapKey, &metrics);
+    if (err) {
+        return err;
+    }
+    *result = metrics.frameLength;
+    return NULL;  // Success
+}
+
+const char* tap_read_pcm(const char* tapKey, float* buffer, int maxFrames, bool interleaved, int64_t* cursor,
+                         int* framesRead) {
+    if (!tapKey) {
+        return "Tap key is null";
+    }
+    if (!buffer || !cursor || !framesRead) {
+        return "Result pointer is null";
+    }
+    if (maxFrames <= 0) {
+        return "Frame count must be positive";
+    }
+
+    tap_init();
+
+    std::lock_guard<std::mutex> lock(tapsMutex);
+    const TapState* tap = findTap(tapKey);
+    if (!tap) {
+        return "Tap not found";
+    }
+    readPcm(tap, buffer, maxFrames, interleaved, cursor, framesRead);
+    return NULL;  // Success
+}
+
+const char* tap_read_pcm_handle(TapHandle handle, float* buffer, int maxFrames, bool interleaved, int64_t* cursor,
+                                int* framesRead) {
+    if (!buffer || !cursor || !framesRead) {
+        return "Result pointer is null";
+    }
+    if (maxFrames <= 0) {
+        return "Frame count must be positive";
+    }
+
+    tap_init();
+
+    std::lock_guard<std::mutex> lock(tapsMutex);
+    const TapState* tap = tapFromHandle(handle);
+    if (!tap) {
+        return "Invalid or stale tap handle";
+    }
+    readPcm(tap, buffer, maxFrames, interleaved, cursor, framesRead);
+    return NULL;  // Success
+}
+
+const char* tap_get_ring(const char* tapKey, TapRing* ring) {
+    if (!tapKey) {
+        return "Tap key is null";
+    }
+    if (!ring) {
+        return "Ring pointer is null";
+    }
+
+    tap_init();
+
+    std::lock_guard<std::mutex> lock(tapsMutex);
+    TapState* tap = findTap(tapKey);
+    if (!tap) {
+        return "Tap not found";
+    }
+    mapRing(tap, ring);
+    return NULL;  // Success
+}
+
+const char* tap_get_ring_handle(TapHandle handle, TapRing* ring) {
+    if (!ring) {
+        return "Ring pointer is null";
+    }
+
+    tap_init();
+
+    std::lock_guard<std::mutex> lock(tapsMutex);
+    TapState* tap = tapFromHandle(handle);
+    if (!tap) {
+        return "Invalid or stale tap handle";
+    }
+    mapRing(tap, ring);
+    return NULL;  // Success
+}
+
+void tap_release_ring(TapRing* ring) {
+    if (!ring || !ring->handle) {
+        return;
+    }
+
+    TapState* tap = static_cast<TapState*>(ring->handle);
+    {
+        std::lock_guard<std::mutex> lock(tapsMutex);
+        tap->ringRefs--;
+        unmapTap(tap);
+    }
+    memset(ring, 0, sizeof(*ring));
+}
+
+const char* tap_remove_all(void) {
+    tap_init();
+
+    std::vector<std::unique_ptr<TapState>> removed;
+    {
+        std::lock_guard<std::mutex> lock(tapsMutex);
+        for (int s = 0; s < tapSlotsUsed; s++) {
+            if (tapSlots[s].tap) {
+                removed.push_back(unregisterTap(tapSlots[s].tap.get()));
+            }
+        }
+    }
+    for (auto& tap : removed) {
+        releaseTap(*tap);
+        retireTap(std::move(tap));
+    }
+
+    headless::logf("tap_remove_all: Cleared tap storage");
+    return NULL;  // Success
+}
+
+const char* tap_enable_loudness(TapHandle handle, bool enabled) {
+    tap_init();
+
+    std::lock_guard<std::mutex> lock(tapsMutex);
+    TapState* tap = tapFromHandle(handle);
+    if (!tap) {
+        return "Invalid or stale tap handle";
+    }
+
+    if (enabled) {
+        if (tap->loudnessStorage) {
+            loudness_request_reset(tap->loudnessStorage.get());
+        } else {
+            // Allocated here, never in the block
+            tap->loudnessStorage.reset(new LoudnessState());
+            loudness_init(tap->loudnessStorage.get(), tap->sampleRate, tap->channelCount);
+            tap->loudness.store(tap->loudnessStorage.get(), std::memory_order_release);
+        }
+    }
+    tap->loudnessEnabled.store(enabled);
+    return NULL;  // Success
+}
+
+const char* tap_reset_loudness(TapHandle handle) {
+    tap_init();
+
+    std::lock_guard<std::mutex> lock(tapsMutex);
+    TapState* tap = tapFromHandle(handle);
+    if (!tap) {
+        return "Invalid or stale tap handle";
+    }
+    if (!tap->loudnessStorage) {
+        return "Loudness metering is not enabled on this tap";
+    }
+    loudness_request_reset(tap->loudnessStorage.get());
+    return NULL;  // Success
+}
+
+const char* tap_get_loudness(TapHandle handle, LoudnessMetrics* metrics) {
+    if (!metrics) {
+        return "Metrics pointer is null";
+    }
+
+    tap_init();
+
+    std::lock_guard<std::mutex> lock(tapsMutex);
+    TapState* tap = tapFromHandle(handle);
+    if (!tap) {
+        return "Invalid or stale tap handle";
+    }
+    if (!tap->loudnessStorage || !tap->loudnessEnabled.load()) {
+        return "Loudness metering is not enabled on this tap";
+    }
+    loudness_read(tap->loudnessStorage.get(), metrics);
+    return NULL;  // Success
+}
+
+void loudness_measure_planar(const float* data, int channelCount, int frames, double sampleRate,
+                             LoudnessMetrics* metrics) {
+    if (!data || !metrics || channelCount <= 0 || frames < 0 || sampleRate <= 0.0) {
+        return;
+    }
+
+    std::unique_ptr<LoudnessState> state(new LoudnessState());
+    loudness_init(state.get(), sampleRate, channelCount);
+    const float* channels[LOUDNESS_MAX_CHANNELS];
+    for (int c = 0; c < state->channelCount; c++) {
+        channels[c] = data + (size_t)c * frames;
+    }
+    loudness_process(state.get(), channels, frames);
+    loudness_read(state.get(), metrics);
+}
+
+const char* tap_enable_spectrum(TapHandle handle, bool enabled, const SpectrumConfig* config) {
+    tap_init();
+
+    std::lock_guard<std::mutex> lock(tapsMutex);
+    TapState* tap = tapFromHandle(handle);
+    if (!tap) {
+        return "Invalid or stale tap handle";
+    }
+
+    // The worker never takes tapsMutex, so it can be joined here
+    if (!enabled) {
+        stopSpectrum(tap);
+        return NULL;  // Success
+    }
+
+    SpectrumConfig wanted;
+    spectrum_default_config(&wanted);
+    if (config) {
+        wanted = *config;
+    }
+    if (!tap->spectrum || !spectrum_config_equal(&wanted, &tap->spectrumConfig)) {
+        if (tap->spectrumRefs > 0) {
+            return "Spectrum is mapped by a reader; release it before reconfiguring";
+        }
+        std::unique_ptr<SpectrumAnalyzer> analyzer(new SpectrumAnalyzer());
+        if (const char* err = spectrum_analyzer_init(analyzer.get(), &wanted, tap->sampleRate, tap->channelCount)) {
+            return err;
+        }
+        stopSpectrum(tap);
+        if (tap->spectrum) {
+            spectrum_analyzer_free(tap->spectrum.get());
+        }
+        tap->spectrum = std::move(analyzer);
+        tap->spectrumConfig = wanted;
+    }
+    stopSpectrum(tap);
+    startSpectrum(tap);
+    return NULL;  // Success
+}
+
+const char* tap_get_spectrum(TapHandle handle, SpectrumView* view) {
+    if (!view) {
+        return "View pointer is null";
+    }
+
+    tap_init();
+
+    std::lock_guard<std::mutex> lock(tapsMutex);
+    TapState* tap = tapFromHandle(handle);
+    if (!tap) {
+        return "Invalid or stale tap handle";
+    }
+    SpectrumAnalyzer* analyzer = tap->spectrum.get();
+    if (!analyzer) {
+        return "Spectrum analysis is not enabled on this tap";
+    }
+    tap->spectrumRefs++;
+    const size_t snapshotSize = (size_t)analyzer->channelCount * analyzer->plan.binCount;
+    view->data[0] = analyzer->snapshots;
+    view->data[1] = analyzer->snapshots + snapshotSize;
+    view->positions = analyzer->positions;
+    view->published = &analyzer->published;
+    view->writing = &analyzer->writing;
+    view->frequencies = analyzer->plan.frequencies;
+    view->channelCount = analyzer->channelCount;
+    view->binCount = analyzer->plan.binCount;
+    view->fftSize = analyzer->plan.fftSize;
+    view->hopSize = analyzer->plan.hopSize;
+    view->sampleRate = tap->sampleRate;
+    view->handle = tap;
+    return NULL;  // Success
+}
+
+void tap_release_spectrum(SpectrumView* view) {
+    if (!view || !view->handle) {
+        return;
+    }
+
+    TapState* tap = static_cast<TapState*>(view->handle);
+    {
+        std::lock_guard<std::mutex> lock(tapsMutex);
+        tap->spectrumRefs--;
+        unmapTap(tap);
+    }
+    memset(view, 0, sizeof(*view));
+}
+
+const char* spectrum_plan_create(const SpectrumConfig* config, double sampleRate, SpectrumPlan** plan, int* binCount,
+                                 const float** frequencies) {
+    if (!plan || !binCount || !frequencies) {
+        return "Result pointer is null";
+    }
+
+    SpectrumConfig wanted;
+    spectrum_default_config(&wanted);
+    if (config) {
+        wanted = *config;
+    }
+    std::unique_ptr<SpectrumPlan> created(new SpectrumPlan());
+    if (const char* err = spectrum_plan_init(created.get(), &wanted, sampleRate)) {
+        return err;
+    }
+    *binCount = created->binCount;
+    *frequencies = created->frequencies;
+    *plan = created.release();
+    return NULL;  // Success
+}
+
+void spectrum_plan_process(SpectrumPlan* plan, const float* samples, float* out) {
+    if (plan && samples && out) {
+        spectrum_plan_run(plan, samples, out);
+    }
+}
+
+void spectrum_plan_destroy(SpectrumPlan* plan) {
+    if (plan) {
+        spectrum_plan_free(plan);
+        delete plan;
+    }
+}
+
+void meter_measure_planar(const float* data, int channelCount, int frames, MeterChannelStats* stats) {
+    if (!data || !stats || channelCount <= 0 || frames < 0) {
+        return;
+    }
+    for (int c = 0; c < channelCount; c++) {
+        meter_channel(data + (size_t)c * frames, frames, &stats[c]);
+    }
+}
+
+const char* meter_kernel_name(void) {
+    return meter_kernel();
+}
+
+const char* tap_get_active_count(int* result) {
+    if (!result) {
+        return "Result pointer is null";
+    }
+
+    tap_init();
+
+    std::lock_guard<std::mutex> lock(tapsMutex);
+    int count = 0;
+    for (int s = 0; s < tapSlotsUsed; s++) {
+        count += tapSlots[s].tap != nullptr;
+    }
+    *result = count;
+    return NULL;  // Success
+}
+
+}  // extern "C"
@@ -0,0 +1,397 @@
+// Streaming EBU R128 loudness meter shared by taps and file analysis (both backends).
+//
+// ITU-R BS.1770-4 K-weighting (shelf + RLB high-pass biquads, designed for the
+// actual sample rate) feeds 100 ms sub-blocks. Momentary (400 ms) and
+// short-term (3 s) loudness slide over those sub-blocks; integrated loudness
+// (absolute -70 LUFS and relative -10 LU gates) and loudness range (EBU Tech
+// 3342: -20 LU relative gate, 10th-95th percentile) come from fixed 0.1 LU
+// histograms, so memory and per-block cost stay constant however long the
+// meter runs. True peak uses the BS.1770 Annex 2 48-tap 4x polyphase
+// interpolator.
+//
+// Threading: one writer (loudness_process, the audio thread for taps) and any
+// number of readers (loudness_read). The live values go through a seqlock;
+// histogram counts are relaxed word-sized atomics. Resets are requested with
+// loudness_request_reset and carried out by the writer.
+//
+// Header-only like meter.h; uses GCC/Clang __atomic builtins so the same code
+// compiles as C (ObjC backend) and C++ (headless backend).
+
+#ifndef MACAUDIO_LOUDNESS_H
+#define MACAUDIO_LOUDNESS_H
+
+#include <math.h>
+#include <stdint.h>
+#include <string.h>
+
+#include "macaudio.h"
+
+#define LOUDNESS_MAX_CHANNELS TAP_METER_MAX_CHANNELS
+#define LOUDNESS_SUBBLOCKS 30           // 100 ms sub-blocks in the 3 s short-term window
+#define LOUDNESS_MOMENTARY_SUBBLOCKS 4  // 400 ms
+#define LOUDNESS_HISTOGRAM_BINS 1000    // 0.1 LU bins from -70 to +30 LUFS
+#define LOUDNESS_TP_TAPS 12             // Taps per polyphase branch
+
+typedef struct {
+    double b0, b1, b2, a1, a2;
+} LoudnessBiquad;
+
+// Values the writer publishes after every processed block
+typedef struct {
+    double momentary;
+    double shortTerm;
+    double maxMomentary;
+    double maxShortTerm;
+    float truePeak[LOUDNESS_MAX_CHANNELS];
+    int64_t frames;
+} LoudnessLive;
+
+typedef struct {
+    double sampleRate;
+    int channelCount;
+    double weights[LOUDNESS_MAX_CHANNELS];  // BS.1770 channel weights (0 excludes LFE)
+    LoudnessBiquad shelf;
+    LoudnessBiquad highpass;
+
+    // Writer-only state
+    double filterState[LOUDNESS_MAX_CHANNELS][4];
+    int subBlockFrames;
+    int subBlockPos;
+    double subBlockEnergy;                  // Weighted sum of squares so far
+    double subBlocks[LOUDNESS_SUBBLOCKS];   // Mean weighted energy of the newest sub-blocks
+    int subBlockIndex;
+    int64_t subBlocksSeen;
+    float tpHistory[LOUDNESS_MAX_CHANNELS][2 * LOUDNESS_TP_TAPS];  // Mirrored ring
+    int tpPos[LOUDNESS_MAX_CHANNELS];
+    LoudnessLive live;
+
+    // Shared with readers
+    uint32_t blockHistogram[LOUDNESS_HISTOGRAM_BINS];  // 400 ms gating blocks (integrated)
+    uint32_t shortHistogram[LOUDNESS_HISTOGRAM_BINS];  // 3 s windows (loudness range)
+    uint32_t seq;                                      // Seqlock over published
+    LoudnessLive published;
+    uint32_t resetRequested;
+} LoudnessState;
+
+// BS.1770-4 Annex 2 interpolation filter, one row per phase
+static const float loudness_tp_coefficients[4][LOUDNESS_TP_TAPS] = {
+    {0.0017089843750f, 0.0109863281250f, -0.0196533203125f, 0.0332031250000f, -0.0594482421875f, 0.1373291015625f,
+     0.9721679687500f, -0.1022949218750f, 0.0476074218750f, -0.0266113281250f, 0.0148925781250f, -0.0083007812500f},
+    {-0.0291748046875f, 0.0292968750000f, -0.0517578125000f, 0.0891113281250f, -0.1665039062500f, 0.4650878906250f,
+     0.7797851562500f, -0.2003173828125f, 0.1015625000000f, -0.0582275390625f, 0.0330810546875f, -0.0189208984375f},
+    {-0.0189208984375f, 0.0330810546875f, -0.0582275390625f, 0.1015625000000f, -0.2003173828125f, 0.7797851562500f,
+     0.4650878906250f, -0.1665039062500f, 0.0891113281250f, -0.0517578125000f, 0.0292968750000f, -0.0291748046875f},
+    {-0.0083007812500f, 0.0148925781250f, -0.0266113281250f, 0.0476074218750f, -0.1022949218750f, 0.9721679687500f,
+     0.1373291015625f, -0.0594482421875f, 0.0332031250000f, -0.0196533203125f, 0.0109863281250f, 0.0017089843750f},
+};
+
+static inline double loudness_lufs(double energy) {
+    if (energy <= 0.0) {
+        return LOUDNESS_SILENCE_LUFS;
+    }
+    const double lufs = -0.691 + 10.0 * log10(energy);
+    return lufs > LOUDNESS_SILENCE_LUFS ? lufs : LOUDNESS_SILENCE_LUFS;
+}
+
+// Histogram bin for a loudness value, or -1 below the absolute gate
+static inline int loudness_bin(double lufs) {
+    if (lufs < -70.0) {
+        return -1;
+    }
+    const int bin = (int)((lufs + 70.0) * 10.0);
+    return bin < LOUDNESS_HISTOGRAM_BINS ? bin : LOUDNESS_HISTOGRAM_BINS - 1;
+}
+
+static inline double loudness_bin_lufs(int bin) {
+    return -70.0 + (bin + 0.5) * 0.1;
+}
+
+static inline double loudness_bin_energy(int bin) {
+    return pow(10.0, (loudness_bin_lufs(bin) + 0.691) / 10.0);
+}
+
+static inline void loudness_histogram_add(uint32_t* histogram, double lufs) {
+    const int bin = loudness_bin(lufs);
+    if (bin >= 0) {
+        const uint32_t count = __atomic_load_n(&histogram[bin], __ATOMIC_RELAXED);
+        __atomic_store_n(&histogram[bin], count + 1, __ATOMIC_RELAXED);
+    }
+}
+
+// Clear everything measured so far (writer side)
+static inline void loudness_reset(LoudnessState* state) {
+    memset(state->filterState, 0, sizeof(state->filterState));
+    state->subBlockPos = 0;
+    state->subBlockEnergy = 0.0;
+    memset(state->subBlocks, 0, sizeof(state->subBlocks));
+    state->subBlockIndex = 0;
+    state->subBlocksSeen = 0;
+    memset(state->tpHistory, 0, sizeof(state->tpHistory));
+    memset(state->tpPos, 0, sizeof(state->tpPos));
+    memset(&state->live, 0, sizeof(state->live));
+    state->live.momentary = LOUDNESS_SILENCE_LUFS;
+    state->live.shortTerm = LOUDNESS_SILENCE_LUFS;
+    state->live.maxMomentary = LOUDNESS_SILENCE_LUFS;
+    state->live.maxShortTerm = LOUDNESS_SILENCE_LUFS;
+    for (int i = 0; i < LOUDNESS_HISTOGRAM_BINS; i++) {
+        __atomic_store_n(&state->blockHistogram[i], 0, __ATOMIC_RELAXED);
+        __atomic_store_n(&state->shortHistogram[i], 0, __ATOMIC_RELAXED);
+    }
+}
+
+// Set up a meter for `channelCount` channels at `sampleRate`. Six channels
+// are taken as 5.1 (L R C LFE Ls Rs): LFE is excluded and surrounds get +1.5 dB.
+static inline void loudness_init(LoudnessState* state, double sampleRate, int channelCount) {
+    memset(state, 0, sizeof(*state));
+    state->sampleRate = sampleRate;
+    state->channelCount = channelCount < LOUDNESS_MAX_CHANNELS ? channelCount : LOUDNESS_MAX_CHANNELS;
+    for (int c = 0; c < state->channelCount; c++) {
+        state->weights[c] = 1.0;
+    }
+    if (state->channelCount == 6) {
+        state->weights[3] = 0.0;
+        state->weights[4] = 1.41;
+        state->weights[5] = 1.41;
+    }
+
+    // Stage 1: high shelf modelling the head
+    double f0 = 1681.974450955533;
+    double gain = 3.999843853973347;
+    double q = 0.7071752369554196;
+    double k = tan(M_PI * f0 / sampleRate);
+    const double vh = pow(10.0, gain / 20.0);
+    const double vb = pow(vh, 0.4996667741545416);
+    double a0 = 1.0 + k / q + k * k;
+    state->shelf.b0 = (vh + vb * k / q + k * k) / a0;
+    state->shelf.b1 = 2.0 * (k * k - vh) / a0;
+    state->shelf.b2 = (vh - vb * k / q + k * k) / a0;
+    state->shelf.a1 = 2.0 * (k * k - 1.0) / a0;
+    state->shelf.a2 = (1.0 - k / q + k * k) / a0;
+
+    // Stage 2: RLB high-pass
+    f0 = 38.13547087602444;
+    q = 0.5003270373238773;
+    k = tan(M_PI * f0 / sampleRate);
+    a0 = 1.0 + k / q + k * k;
+    state->highpass.b0 = 1.0;
+    state->highpass.b1 = -2.0;
+    state->highpass.b2 = 1.0;
+    state->highpass.a1 = 2.0 * (k * k - 1.0) / a0;
+    state->highpass.a2 = (1.0 - k / q + k * k) / a0;
+
+    state->subBlockFrames = (int)lround(sampleRate / 10.0);
+    if (state->subBlockFrames < 1) {
+        state->subBlockFrames = 1;
+    }
+    loudness_reset(state);
+    state->published = state->live;
+}
+
+// K-weight `frames` samples of one channel and return their sum of squares
+static inline double loudness_filter(LoudnessState* state, int channel, const float* samples, int frames) {
+    const LoudnessBiquad s = state->shelf;
+    const LoudnessBiquad h = state->highpass;
+    double* z = state->filterState[channel];
+    double s1 = z[0], s2 = z[1], h1 = z[2], h2 = z[3];
+    double sum = 0.0;
+    for (int i = 0; i < frames; i++) {
+        const double x = samples[i];
+        const double y = s.b0 * x + s1;
+        s1 = s.b1 * x - s.a1 * y + s2;
+        s2 = s.b2 * x - s.a2 * y;
+        const double w = h.b0 * y + h1;
+        h1 = h.b1 * y - h.a1 * w + h2;
+        h2 = h.b2 * y - h.a2 * w;
+        sum += w * w;
+    }
+    z[0] = s1;
+    z[1] = s2;
+    z[2] = h1;
+    z[3] = h2;
+    return sum;
+}
+
+// 4x-oversampled absolute peak of `frames` samples of one channel
+static inline float loudness_true_peak(LoudnessState* state, int channel, const float* samples, int frames,
+                                       float peak) {
+    float* history = state->tpHistory[channel];
+    int pos = state->tpPos[channel];
+    for (int i = 0; i < frames; i++) {
+        pos = pos + 1 == LOUDNESS_TP_TAPS ? 0 : pos + 1;
+        history[pos] = samples[i];
+        history[pos + LOUDNESS_TP_TAPS] = samples[i];
+        // history[pos + 1 .. pos + TAPS] holds x[n - TAPS + 1] .. x[n]
+        const float* window = history + pos + 1;
+        for (int phase = 0; phase < 4; phase++) {
+            const float* coefficients = loudness_tp_coefficients[phase];
+            float y = 0.0f;
+            for (int t = 0; t < LOUDNESS_TP_TAPS; t++) {
+                y += coefficients[t] * window[LOUDNESS_TP_TAPS - 1 - t];
+            }
+            y = fabsf(y);
+            peak = y > peak ? y : peak;
+        }
+    }
+    state->tpPos[channel] = pos;
+    return peak;
+}
+
+static inline void loudness_finish_subblock(LoudnessState* state) {
+    state->subBlocks[state->subBlockIndex] = state->subBlockEnergy / state->subBlockFrames;
+    state->subBlockIndex = (state->subBlockIndex + 1) % LOUDNESS_SUBBLOCKS;
+    state->subBlocksSeen++;
+    state->subBlockEnergy = 0.0;
+    state->subBlockPos = 0;
+
+    // Newest sub-blocks end just before subBlockIndex
+    double momentary = 0.0, shortTerm = 0.0;
+    for (int i = 1; i <= LOUDNESS_SUBBLOCKS; i++) {
+        const double energy = state->subBlocks[(state->subBlockIndex - i + LOUDNESS_SUBBLOCKS) % LOUDNESS_SUBBLOCKS];
+        if (i <= LOUDNESS_MOMENTARY_SUBBLOCKS) {
+            momentary += energy;
+        }
+        shortTerm += energy;
+    }
+
+    // Gating blocks are 400 ms with 75% overlap: one per 100 ms sub-block
+    if (state->subBlocksSeen >= LOUDNESS_MOMENTARY_SUBBLOCKS) {
+        state->live.momentary = loudness_lufs(momentary / LOUDNESS_MOMENTARY_SUBBLOCKS);
+        if (state->live.momentary > state->live.maxMomentary) {
+            state->live.maxMomentary = state->live.momentary;
+        }
+        loudness_histogram_add(state->blockHistogram, state->live.momentary);
+    }
+    if (state->subBlocksSeen >= LOUDNESS_SUBBLOCKS) {
+        state->live.shortTerm = loudness_lufs(shortTerm / LOUDNESS_SUBBLOCKS);
+        if (state->live.shortTerm > state->live.maxShortTerm) {
+            state->live.maxShortTerm = state->live.shortTerm;
+        }
+        loudness_histogram_add(state->shortHistogram, state->live.shortTerm);
+    }
+}
+
+// Writer: meter one block of planar channels and publish the live values
+static inline void loudness_process(LoudnessState* state, const float* const* channels, int frames) {
+    if (__atomic_exchange_n(&state->resetRequested, 0, __ATOMIC_ACQUIRE)) {
+        loudness_reset(state);
+    }
+
+    for (int offset = 0; offset < frames;) {
+        int n = state->subBlockFrames - state->subBlockPos;
+        if (n > frames - offset) {
+            n = frames - offset;
+        }
+        for (int c = 0; c < state->channelCount; c++) {
+            if (state->weights[c] > 0.0) {
+                state->subBlockEnergy += state->weights[c] * loudness_filter(state, c, channels[c] + offset, n);
+            }
+            state->live.truePeak[c] = loudness_true_peak(state, c, channels[c] + offset, n, state->live.truePeak[c]);
+        }
+        state->subBlockPos += n;
+        offset += n;
+        if (state->subBlockPos == state->subBlockFrames) {
+            loudness_finish_subblock(state);
+        }
+    }
+    state->live.frames += frames;
+
+    const uint32_t seq = __atomic_load_n(&state->seq, __ATOMIC_RELAXED);
+    __atomic_store_n(&state->seq, seq + 1, __ATOMIC_RELAXED);
+    __atomic_thread_fence(__ATOMIC_RELEASE);
+    state->published = state->live;
+    __atomic_store_n(&state->seq, seq + 2, __ATOMIC_RELEASE);
+}
+
+// Ask the writer to start over at its next block
+static inline void loudness_request_reset(LoudnessState* state) {
+    __atomic_store_n(&state->resetRequested, 1, __ATOMIC_RELEASE);
+}
+
+// Gated mean loudness of a histogram: bins below `relativeGate` LU under the
+// absolute-gated mean are dropped. Returns the bin where gating starts via *firstBin.
+static inline double loudness_gated(const uint32_t* histogram, double relativeGate, int* firstBin, uint64_t* count) {
+    double energy = 0.0;
+    uint64_t total = 0;
+    for (int i = 0; i < LOUDNESS_HISTOGRAM_BINS; i++) {
+        const uint32_t n = __atomic_load_n(&histogram[i], __ATOMIC_RELAXED);
+        if (n) {
+            energy += n * loudness_bin_energy(i);
+            total += n;
+        }
+    }
+    *count = 0;
+    *firstBin = LOUDNESS_HISTOGRAM_BINS;
+    if (total == 0) {
+        return LOUDNESS_SILENCE_LUFS;
+    }
+
+    const int gate = loudness_bin(loudness_lufs(energy / total) + relativeGate);
+    const int start = gate < 0 ? 0 : gate;
+    energy = 0.0;
+    total = 0;
+    for (int i = start; i < LOUDNESS_HISTOGRAM_BINS; i++) {
+        const uint32_t n = __atomic_load_n(&histogram[i], __ATOMIC_RELAXED);
+        if (n) {
+            energy += n * loudness_bin_energy(i);
+            total += n;
+        }
+    }
+    *firstBin = start;
+    *count = total;
+    return total ? loudness_lufs(energy / total) : LOUDNESS_SILENCE_LUFS;
+}
+
+// Reader: snapshot everything measured since the last reset
+static inline void loudness_read(LoudnessState* state, LoudnessMetrics* out) {
+    LoudnessLive live;
+    for (;;) {
+        const uint32_t before = __atomic_load_n(&state->seq, __ATOMIC_ACQUIRE);
+        if (before & 1) {
+            continue;
+        }
+        live = state->published;
+        __atomic_thread_fence(__ATOMIC_ACQUIRE);
+        if (__atomic_load_n(&state->seq, __ATOMIC_RELAXED) == before) {
+            break;
+        }
+    }
+
+    memset(out, 0, sizeof(*out));
+    out->momentary = live.momentary;
+    out->shortTerm = live.shortTerm;
+    out->maxMomentary = live.maxMomentary;
+    out->maxShortTerm = live.maxShortTerm;
+    out->channelCount = state->channelCount;
+    out->frames = live.frames;
+    for (int c = 0; c < state->channelCount; c++) {
+        out->channelTruePeak[c] = live.truePeak[c];
+        out->truePeak = live.truePeak[c] > out->truePeak ? live.truePeak[c] : out->truePeak;
+    }
+
+    int firstBin;
+    uint64_t count;
+    out->integrated = loudness_gated(state->blockHistogram, -10.0, &firstBin, &count);
+
+    // Loudness range: spread between the 10th and 95th percentile of gated short-term values
+    loudness_gated(state->shortHistogram, -20.0, &firstBin, &count);
+    if (count > 0) {
+        const uint64_t low = (uint64_t)(0.10 * (count - 1));
+        const uint64_t high = (uint64_t)(0.95 * (count - 1));
+        int lowBin = -1, highBin = -1;
+        uint64_t seen = 0;
+        for (int i = firstBin; i < LOUDNESS_HISTOGRAM_BINS && highBin < 0; i++) {
+            seen += __atomic_load_n(&state->shortHistogram[i], __ATOMIC_RELAXED);
+            if (lowBin < 0 && seen > low) {
+                lowBin = i;
+            }
+            if (seen > high) {
+                highBin = i;
+            }
+        }
+        if (lowBin >= 0 && highBin >= 0) {
+            out->loudnessRange = loudness_bin_lufs(highBin) - loudness_bin_lufs(lowBin);
+        }
+    }
+}
+
+#endif  // MACAUDIO_LOUDNESS_H
@@ -6,6 +6,7 @@ extern "C" {
 #endif
 
 #include <stdbool.h>
+#include <stdint.h>
 
 // ==============================================
 // Common Result Structures
@@ -76,6 +77,14 @@ void audioengine_release_format(void* formatPtr);
 const char* audioengine_set_buffer_size(AudioEngine* wrapper, int bufferSize);
 void audioengine_remove_taps(AudioEngine* wrapper);
 
+// Manual (offline) rendering - the engine must be stopped to switch modes.
+// After enabling, audioengine_start arms the graph without a device and each
+// render call pulls `frames` (<= maxFrames) as float32, interleaved or planar
+// (channel-major, `frames` samples per channel).
+const char* audioengine_enable_manual_rendering(AudioEngine* wrapper, double sampleRate, int channelCount, int maxFrames);
+const char* audioengine_disable_manual_rendering(AudioEngine* wrapper);
+const char* audioengine_render_offline(AudioEngine* wrapper, float* buffer, int frames, bool interleaved);
+
 // ==============================================
 // Audio Format Structures and Functions
 // ==============================================
@@ -110,6 +119,11 @@ AudioNodeResult audionode_output_format_for_bus(void* nodePtr, int bus);
 const char* audionode_get_number_of_inputs(void* nodePtr, int* result);
 const char* audionode_get_number_of_outputs(void* nodePtr, int* result);
 const char* audionode_is_installed_on_engine(void* nodePtr, bool* result);
+// Whether the node passed its last render cycle through unchanged, routed around
+const char* audionode_is_elided(void* nodePtr, bool* result);
+// Frames the node's output trails the input it was made from: the time and
+// pitch units report what they hold, 0 while routed around
+const char* audionode_get_latency(void* nodePtr, int* frames);
 const char* audionode_log_info(void* nodePtr);
 const char* audionode_release(void* nodePtr);
 
@@ -127,6 +141,14 @@ const char* audiomixer_get_input_volume_for_connection(void* sourcePtr, void* mi
 const char* audiomixer_set_input_pan_for_connection(void* sourcePtr, void* mixerPtr, int destBus, float pan);
 const char* audiomixer_get_input_pan_for_connection(void* sourcePtr, void* mixerPtr, int destBus, float* result);
 
+// Compensating delay of one mixer input, up to MIXER_MAX_INPUT_DELAY frames.
+// On macOS a delay unit of our own goes in between on the first delay and
+// comes out again at 0; the per-connection volume and pan above carry over to
+// it and back.
+#define MIXER_MAX_INPUT_DELAY 65536
+const char* audiomixer_set_input_delay_for_connection(void* sourcePtr, void* mixerPtr, int destBus, int frames);
+const char* audiomixer_get_input_delay_for_connection(void* sourcePtr, void* mixerPtr, int destBus, int* result);
+
 // Matrix mixer operations
 AudioNodeResult matrixmixer_create(void);
 const char* matrixmixer_configure_invert(void* unitPtr);
@@ -141,9 +163,17 @@ const char* matrixmixer_set_linear_pan(void* unitPtr, int inputChannel, float pa
 // Audio Tap Functions
 // ==============================================
 
+// Taps live in a fixed table. A handle packs the slot index (low 16 bits) with
+// the slot's generation (high 16 bits): lookups are O(1) and a handle goes
+// stale when its tap is removed. 0 is never a valid handle.
+typedef uint32_t TapHandle;
+#define TAP_INVALID_HANDLE 0
+#define TAP_MAX_TAPS 256
+
 // Tap info structure
 typedef struct {
     void* tapPtr;      // Unique tap identifier
+    TapHandle handle;  // Handle of the tap
     void* nodePtr;     // AVAudioNode being tapped
     int busIndex;      // Bus index being tapped
     bool isActive;     // Whether tap is currently active
@@ -151,16 +181,232 @@ typedef struct {
     int channelCount;  // Number of channels being tapped
 } TapInfo;
 
+// Per-channel level statistics from the metering kernel (native/meter.h)
+typedef struct {
+    double sumOfSquares;
+    float rms;
+    float peak;          // Absolute peak
+    int clipCount;       // Samples with |x| >= 1.0
+} MeterChannelStats;
+
+#define TAP_METER_MAX_CHANNELS 8
+
+// Per-block tap metrics, published by the audio thread through a lock-free ring
+typedef struct {
+    int64_t sampleTime;  // Render sample time of the block's first frame
+    uint64_t hostTime;   // Host time of the block (mach ticks on macOS, steady-clock ns headless)
+    int frameLength;     // Frames in the block
+    float rms;           // RMS of channel 0
+    float peak;          // Absolute peak of channel 0
+    int channelCount;    // Valid entries in channels (up to TAP_METER_MAX_CHANNELS)
+    MeterChannelStats channels[TAP_METER_MAX_CHANNELS];
+} TapMetrics;
+
 // Tap operations
 void tap_init(void);
-const char* tap_install(void* enginePtr, void* nodePtr, int busIndex, const char* tapKey);
+const char* tap_install(void* enginePtr, void* nodePtr, int busIndex, const char* tapKey, TapHandle* handle);
+const char* tap_lookup(const char* tapKey, TapHandle* handle);
 const char* tap_remove(const char* tapKey);
 const char* tap_get_info(const char* tapKey, TapInfo* info);
 const char* tap_get_rms(const char* tapKey, double* result);
 const char* tap_get_frame_count(const char* tapKey, int* result);
+const char* tap_get_metrics(const char* tapKey, TapMetrics* metrics);
+// Batched metering: fill metrics[i] for tapKeys[i] under one lock. Missing taps
+// get zeroed metrics and found[i] = false (found may be NULL). Returns the
+// number of taps found.
+int tap_get_metrics_batch(const char* const* tapKeys, int count, TapMetrics* metrics, bool* found);
+// Metrics for every installed tap. *tapCount and *keyBytes are always set to
+// what is needed; when both fit in capacity/keyBufferSize, metrics[i] is filled,
+// as is handles[i] unless handles is NULL, and the keys are packed NUL-terminated
+// into keyBuffer in the same order.
+const char* tap_get_metrics_all(TapMetrics* metrics, TapHandle* handles, int capacity, char* keyBuffer,
+                                int keyBufferSize, int* tapCount, int* keyBytes);
+// Copy PCM published after *cursor (absolute frame index, advanced on return).
+// Frames that fell out of the tap's ring are skipped by moving the cursor forward.
+const char* tap_read_pcm(const char* tapKey, float* buffer, int maxFrames, bool interleaved, int64_t* cursor, int* framesRead);
 const char* tap_remove_all(void);
 const char* tap_get_active_count(int* result);
 
+// Handle-based variants of the calls above (no string lookups). A stale or
+// invalid handle fails with an error or reports found[i] = false.
+const char* tap_remove_handle(TapHandle handle);
+const char* tap_get_info_handle(TapHandle handle, TapInfo* info);
+const char* tap_get_metrics_handle(TapHandle handle, TapMetrics* metrics);
+int tap_get_metrics_handles(const TapHandle* handles, int count, TapMetrics* metrics, bool* found);
+const char* tap_read_pcm_handle(TapHandle handle, float* buffer, int maxFrames, bool interleaved, int64_t* cursor, int* framesRead);
+
+// Shared PCM ring of a tap for zero-copy readers. Frame f of channel c lives at
+// data[c * capacity + (f & (capacity - 1))]. `writeIndex` counts published
+// frames and is stored with release semantics; load it atomically. A reader at
+// frame f is intact while *writeIndex - readable <= f. The mapping stays valid
+// (even after tap_remove) until tap_release_ring.
+typedef struct {
+    const float* data;
+    const int64_t* writeIndex;
+    int channelCount;
+    int capacity;        // Frames per channel plane (power of two)
+    int readable;        // Maximum reader lag before frames are overwritten
+    double sampleRate;
+    void* handle;        // Opaque; pass the ring back to tap_release_ring
+} TapRing;
+
+const char* tap_get_ring(const char* tapKey, TapRing* ring);
+const char* tap_get_ring_handle(TapHandle handle, TapRing* ring);
+void tap_release_ring(TapRing* ring);
+
+// EBU R128 loudness (native/loudness.h). Loudness values are LUFS, or
+// LOUDNESS_SILENCE_LUFS while there is not enough (or only silent) audio.
+#define LOUDNESS_SILENCE_LUFS -120.0
+
+typedef struct {
+    double momentary;      // 400 ms window
+    double shortTerm;      // 3 s window
+    double integrated;     // Gated, since start/reset
+    double loudnessRange;  // LU (EBU Tech 3342)
+    double maxMomentary;
+    double maxShortTerm;
+    float truePeak;        // Highest 4x-oversampled |x| of any channel (linear)
+    int channelCount;
+    float channelTruePeak[TAP_METER_MAX_CHANNELS];
+    int64_t frames;        // Frames measured since start/reset
+} LoudnessMetrics;
+
+// Per-tap loudness meter, off by default. Enabling (again) starts from zero.
+const char* tap_enable_loudness(TapHandle handle, bool enabled);
+const char* tap_reset_loudness(TapHandle handle);
+const char* tap_get_loudness(TapHandle handle, LoudnessMetrics* metrics);
+void loudness_measure_planar(const float* data, int channelCount, int frames, double sampleRate, LoudnessMetrics* metrics);
+
+// Spectrum analysis (native/spectrum.h): windowed FFT magnitudes in dB relative
+// to full scale (a full-scale sine reads 0 dB), per FFT bin or per band.
+#define SPECTRUM_MIN_FFT 256
+#define SPECTRUM_MAX_FFT 16384
+#define SPECTRUM_FLOOR_DB -160.0f
+
+#define SPECTRUM_WINDOW_HANN 0
+#define SPECTRUM_WINDOW_BLACKMAN_HARRIS 1
+
+#define SPECTRUM_SCALE_LINEAR 0  // fftSize / 2 bins from DC
+#define SPECTRUM_SCALE_LOG 1     // bandCount log-spaced bands from minFrequency to maxFrequency
+#define SPECTRUM_SCALE_OCTAVE 2  // 1/bandsPerOctave octave bands centred on 1 kHz
+
+typedef struct {
+    int fftSize;         // Power of two, SPECTRUM_MIN_FFT..SPECTRUM_MAX_FFT
+    int overlap;         // Windows per fftSize frames: 1, 2, 4 or 8 (hop = fftSize / overlap)
+    int window;          // SPECTRUM_WINDOW_*
+    int scale;           // SPECTRUM_SCALE_*
+    int bandCount;       // SPECTRUM_SCALE_LOG
+    int bandsPerOctave;  // SPECTRUM_SCALE_OCTAVE
+    double minFrequency; // Band range (log and octave scales)
+    double maxFrequency;
+} SpectrumConfig;
+
+// Offline spectra with a reusable plan (window, twiddles and band tables are
+// computed once). process() reads fftSize samples and writes binCount values.
+typedef struct SpectrumPlan SpectrumPlan;
+const char* spectrum_plan_create(const SpectrumConfig* config, double sampleRate, SpectrumPlan** plan, int* binCount,
+                                 const float** frequencies);
+void spectrum_plan_process(SpectrumPlan* plan, const float* samples, float* out);
+void spectrum_plan_destroy(SpectrumPlan* plan);
+
+// Live spectrum of a tap, computed on a worker thread from the tap's PCM ring
+// and published into two alternating snapshots. Snapshot n (n = *published)
+// lives at data[n & 1] (channelCount planes of binCount floats) and covers the
+// fftSize frames before positions[n & 1]. A reader that loaded *published == n
+// with acquire semantics saw an intact snapshot if *writing < n + 2 after
+// reading. The mapping stays valid (even after tap_remove or reconfiguring is
+// refused) until tap_release_spectrum.
+typedef struct {
+    const float* data[2];
+    const int64_t* positions;
+    const uint64_t* published;
+    const uint64_t* writing;
+    const float* frequencies;  // Centre frequency of each bin or band (Hz)
+    int channelCount;
+    int binCount;
+    int fftSize;
+    int hopSize;
+    double sampleRate;
+    void* handle;              // Opaque; pass the view back to tap_release_spectrum
+} SpectrumView;
+
+// config may be NULL for the defaults (2048 points, 4x overlap, Hann, linear).
+// Changing the configuration fails while a view is mapped.
+const char* tap_enable_spectrum(TapHandle handle, bool enabled, const SpectrumConfig* config);
+const char* tap_get_spectrum(TapHandle handle, SpectrumView* view);
+void tap_release_spectrum(SpectrumView* view);
+
+// Metering kernel entry points (planar input: channel c starts at data + c * frames)
+void meter_measure_planar(const float* data, int channelCount, int frames, MeterChannelStats* stats);
+const char* meter_kernel_name(void);
+
+// ==============================================
+// Standalone DSP (native/dsp.m)
+// ==============================================
+
+// Sample-rate conversion (native/resampler.h): streaming polyphase windowed
+// sinc for any ratio up to 32:1 either way. Output frame j is the input at
+// j * inputRate / outputRate; the filter's own delay is compensated.
+#define RESAMPLER_QUALITY_LOW 0     // 16 taps, 60 dB stopband, passband to 0.27 of the lower rate
+#define RESAMPLER_QUALITY_MEDIUM 1  // 48 taps, 90 dB, 0.38
+#define RESAMPLER_QUALITY_HIGH 2    // 96 taps, 110 dB, 0.42
+#define RESAMPLER_QUALITY_BEST 3    // 192 taps, 130 dB, 0.45
+#define RESAMPLER_MAX_CHANNELS 64
+
+typedef struct {
+    int taps;          // Filter length in input frames
+    int phases;        // Coefficient rows
+    bool interpolated; // Rates without a short exact cycle interpolate between rows
+    const char* kernel;
+} ResamplerInfo;
+
+// Planar buffers: channel c starts at input + c * inputFrames and at
+// output + c * outputCapacity. process() stops when the input is used up
+// (*consumed == inputFrames) or the output is full; call it again with the
+// rest. drain() writes what the filter still holds after the last input and
+// sets *produced to 0 once done; reset() starts a new signal.
+typedef struct Resampler Resampler;
+const char* resampler_create(double inputRate, double outputRate, int channelCount, int quality, Resampler** resampler,
+                             ResamplerInfo* info);
+void resampler_process(Resampler* resampler, const float* input, int inputFrames, float* output, int outputCapacity,
+                       int* consumed, int* produced);
+void resampler_drain(Resampler* resampler, float* output, int outputCapacity, int* produced);
+void resampler_reset(Resampler* resampler);
+void resampler_destroy(Resampler* resampler);
+
+// Pitch shift (native/pitchshift.h): phase vocoder with phase locking and
+// optional formant preservation, up to two octaves either way. Output runs
+// fftSize frames behind the input; at 0 cents it is the input delayed.
+#define PITCH_SHIFT_QUALITY_LOW 0     // 1024-point FFT, 4x overlap
+#define PITCH_SHIFT_QUALITY_MEDIUM 1  // 2048, 4x
+#define PITCH_SHIFT_QUALITY_HIGH 2    // 2048, 8x
+#define PITCH_SHIFT_QUALITY_BEST 3    // 4096, 8x
+#define PITCH_SHIFT_MIN_FFT 512
+#define PITCH_SHIFT_MAX_FFT 8192
+#define PITCH_SHIFT_MAX_CHANNELS 64
+
+typedef struct {
+    int quality;            // PITCH_SHIFT_QUALITY_*
+    int fftSize;            // 0 for the quality's own, else a power of two in [512, 8192]
+    bool preserveFormants;  // Keep the spectral envelope in place
+} PitchShiftOptions;
+
+typedef struct {
+    int fftSize;
+    int hop;      // Frames between analyses; a new shift applies from the next one
+    int latency;  // Frames
+    const char* kernel;
+} PitchShiftInfo;
+
+// Planar buffers: channel c starts at input + c * frames and output + c * frames.
+// process() takes any number of frames and may be given a new shift each call.
+typedef struct PitchShifter PitchShifter;
+const char* pitchshift_create(double sampleRate, int channelCount, const PitchShiftOptions* options,
+                              PitchShifter** shifter, PitchShiftInfo* info);
+void pitchshift_process(PitchShifter* shifter, const float* input, float* output, int frames, float cents);
+void pitchshift_reset(PitchShifter* shifter);
+void pitchshift_destroy(PitchShifter* shifter);
+
 // ==============================================
 // Audio Player Functions
 // ==============================================
@@ -176,9 +422,19 @@ typedef struct {
     void* playerNode;   // AVAudioPlayerNode*
     void* audioFile;    // AVAudioFile*
     void* engine;       // Reference to the engine this player belongs to
-    void* timePitchUnit; // AVAudioUnitTimePitch* (nullable)
+    void* timePitchUnit; // Pitch shift unit (nullable, see audioplayer_set_pitch_shift_options)
     bool isPlaying;     // Track playing state
     bool timePitchEnabled; // Whether time/pitch effects are enabled
+    void* peaks;        // Waveform overview job (nullable, see audioplayer_build_peaks)
+    void* analysis;     // Cached analysis of the loaded file (nullable, see analysis_cache_open)
+    void* stream;       // Read-ahead state while streaming (nullable, see audioplayer_set_streaming)
+    void* decoded;      // Shared decoded PCM of the file (nullable, see pcm_cache_set_budget)
+    int64_t startFrame; // File frame the current schedule starts at (see audioplayer_get_playhead)
+    void* queue;        // Gapless queue of further files (nullable, see audioplayer_queue_file)
+    void* loop;         // Loop region (nullable, see audioplayer_set_loop)
+    void* timeStretchUnit; // WSOLA rate unit in front of timePitchUnit (nullable, see below)
+    void* variants;     // Pre-rendered rate/pitch variants (nullable, see audioplayer_prepare_variants)
+    int resamplerQuality; // RESAMPLER_QUALITY_* of file-rate conversion (see audioplayer_set_resampler_quality)
 } AudioPlayer;
 
 // Audio buffer analysis structure
@@ -215,11 +471,287 @@ const char* audioplayer_disable_time_pitch_effects(AudioPlayer* player);
 const char* audioplayer_is_time_pitch_effects_enabled(AudioPlayer* player, bool* enabled);
 PlayerResult audioplayer_get_time_pitch_node_ptr(AudioPlayer* player);
 PlayerResult audioplayer_get_node_ptr(AudioPlayer* player);
+
+// Playback rate (native/wsola.h): enabling time/pitch effects also creates a
+// time stretch unit, to be connected player -> time stretch -> pitch shift.
+// audioplayer_set_playback_rate drives it; the pitch shift unit only shifts.
+// Rate changes apply within 10 ms; latency reports the audio the unit has
+// pulled from the player but not played, under 50 ms between 0.25x and 1.25x
+// (35 ms at 1.25x in 512-frame blocks). At rate 1 the unit plays that out and
+// is then routed around, with no latency, until the rate changes.
+PlayerResult audioplayer_get_time_stretch_node_ptr(AudioPlayer* player);
+const char* audioplayer_get_time_stretch_latency(AudioPlayer* player, double* seconds);
+
+// Pitch (native/pitchshift.h): the pitch unit is a phase vocoder, and
+// audioplayer_set_pitch may change its shift every block. The options pick
+// its quality, FFT size and formant preservation (NULL restores medium
+// quality without formants) and may change while playing; a new quality or
+// FFT size restarts the unit. Its latency is info->latency frames at any
+// pitch; once it has run at 0 cents for that long it plays out what it holds
+// and is routed around until the pitch changes, when the shift fades in over
+// one FFT frame.
+const char* audioplayer_set_pitch_shift_options(AudioPlayer* player, const PitchShiftOptions* options);
+const char* audioplayer_get_pitch_shift_options(AudioPlayer* player, PitchShiftOptions* options, PitchShiftInfo* info);
+
+// File-rate conversion: a file (or queued file) at another rate than the
+// engine is converted at this RESAMPLER_QUALITY_* tier, medium by default,
+// when playing and in offline renders alike. The headless player reads it
+// through native/resampler.h and applies a new tier from the next block; the
+// macOS backend sets it on the AVAudioConverters it decodes with.
+const char* audioplayer_set_resampler_quality(AudioPlayer* player, int quality);
+const char* audioplayer_get_resampler_quality(AudioPlayer* player, int* quality);
 const char* audioplayer_get_file_info(AudioPlayer* player, double* sampleRate, int* channelCount, const char** format);
 AudioBufferMetrics audioplayer_analyze_buffer_at_time(AudioPlayer* player, double timeSeconds);
 const char* audioplayer_analyze_file_segment(AudioPlayer* player, double startTime, double duration, double* rms, int* frameCount);
+const char* audioplayer_analyze_loudness(AudioPlayer* player, double startTime, double duration, LoudnessMetrics* metrics);
 void audioplayer_destroy(AudioPlayer* player);
 
+// Waveform overview (native/peaks.h): a min/max/RMS pyramid built once per
+// loaded file on a background thread, optionally persisted next to the file as
+// "<path>.peaks" and reused while the file is unchanged. Queries read only the
+// pyramid and cost O(log n) per column.
+typedef struct {
+    float min;
+    float max;
+    float rms;
+} PeakColumn;
+
+typedef struct {
+    bool building;      // Build requested (and not failed)
+    bool ready;         // Queries can be answered
+    bool cached;        // Loaded from the .peaks file instead of decoding audio
+    double progress;    // 0..1
+    int channelCount;
+    double sampleRate;
+    int64_t frames;
+    const char* error;  // Set when the build failed
+} PeaksStatus;
+
+// Start building the current file's overview (no-op if already built or building)
+const char* audioplayer_build_peaks(AudioPlayer* player, bool persist);
+const char* audioplayer_get_peaks_status(AudioPlayer* player, PeaksStatus* status);
+// Split [startTime, startTime + duration) into `columns` spans; out receives
+// columns * channelCount entries (column-major) and must hold `capacity`.
+const char* audioplayer_get_peaks(AudioPlayer* player, double startTime, double duration, int columns, PeakColumn* out,
+                                  int capacity);
+
+// Streaming playback (native/stream.h): instead of handing the whole file to
+// the player node, an I/O thread decodes ahead into bufferCount preallocated
+// buffers of bufferFrames frames and the player only consumes buffers that are
+// ready. A render cycle that finds none plays silence and counts an underrun.
+// Offline (manual) rendering never underruns. Zero sizes pick the defaults
+// (8 x 16384 frames).
+typedef struct {
+    bool enabled;
+    int bufferFrames;
+    int bufferCount;        // Read-ahead depth
+    int ready;              // Buffers decoded and not yet played
+    int64_t decodedFrames;
+    int64_t underruns;      // Render cycles that ran out of decoded audio
+    int64_t underrunFrames; // Frames of silence they played instead
+    bool mapped;            // Decoding straight from a memory-mapped WAV/AIFF (native/pcmfile.h)
+} StreamingStats;
+
+// Turn streaming on (or resize it) or off; stops playback
+const char* audioplayer_set_streaming(AudioPlayer* player, bool enabled, int bufferFrames, int bufferCount);
+const char* audioplayer_get_streaming_stats(AudioPlayer* player, StreamingStats* stats);
+
+// Move a playing player to timeSeconds without stopping it: the jump lands on
+// exactly that file frame at the start of the next render cycle and the rest
+// of the file plays on from there, while crossfadeSeconds (0 ... 0.1) fades the
+// old position out. Streaming players decode the target before the jump, so it
+// never waits for the I/O thread. A player that is not playing starts from
+// timeSeconds instead, like audioplayer_seek_to_time (which is this with no
+// crossfade). On macOS AVAudioPlayerNode cannot drop what it has scheduled, so
+// a playing player is stopped and rescheduled from timeSeconds: it lands on
+// the same frame, but the crossfade is validated and not applied.
+#define AUDIOPLAYER_MAX_SEEK_CROSSFADE 0.1
+const char* audioplayer_seek(AudioPlayer* player, double timeSeconds, double crossfadeSeconds);
+
+// Playhead (native/playhead.h): where in its file a player is, published by
+// the render thread every cycle and read without locking. It follows the
+// start frame of play_at_time and seeks, and leaves out audio the time stretch
+// and pitch shift units have pulled but not yet played. Between cycles, the position at host time t
+// is position + (t - hostTime) / 1e9 * rate while playing.
+typedef struct {
+    double position;    // Seconds into the file of the audio being heard at hostTime
+    int64_t frame;      // The same in file frames
+    double rate;        // File seconds per second of output (the time stretch rate)
+    int64_t loops;      // Times playback wrapped around the loop region since it started or seeked
+    uint64_t hostTime;  // playhead_host_time() when `position` was current
+    bool playing;
+} PlayheadState;
+
+const char* audioplayer_get_playhead(AudioPlayer* player, PlayheadState* state);
+// Monotonic clock of PlayheadState.hostTime in nanoseconds (mach_absolute_time on macOS)
+uint64_t playhead_host_time(void);
+
+// Gapless queue: further files, or segments of them, that the player plays
+// back to back after whatever it has scheduled, with no round trip through the
+// caller. Each item is decoded when it is queued and scheduled right away, so
+// its first frame follows the previous item's last one in the same render
+// cycle. An item with crossfadeSeconds > 0 instead fades in under the last
+// crossfadeSeconds of the previous one, equal-power; macOS only splices, and
+// rejects such items. Items play into the loaded file's channel layout; the
+// playhead follows the item being played. durationSeconds <= 0 plays to the
+// end of the file. Stopping the player empties the queue.
+#define AUDIOPLAYER_MAX_QUEUE_CROSSFADE 10.0
+
+typedef struct {
+    int pending;        // Items queued and not started
+    int64_t current;    // Id of the item playing, 0 for the loaded file or nothing
+    int64_t played;     // Items finished or skipped since the player was created
+} PlayerQueueStatus;
+
+const char* audioplayer_queue_file(AudioPlayer* player, const char* filePath, double startSeconds,
+                                   double durationSeconds, double crossfadeSeconds, int64_t* itemId);
+// Drop every item that has not started
+const char* audioplayer_queue_clear(AudioPlayer* player);
+// End what is playing at the next render cycle and go on with the next item,
+// fading the old one out over crossfadeSeconds (0 ... AUDIOPLAYER_MAX_SEEK_CROSSFADE).
+// On macOS the node is flushed and rescheduled, like a seek, without the fade.
+const char* audioplayer_queue_skip(AudioPlayer* player, double crossfadeSeconds);
+const char* audioplayer_queue_get_status(AudioPlayer* player, PlayerQueueStatus* status);
+
+// Loop region: whenever the loaded file plays through endFrame, playback goes
+// on from startFrame in the same render cycle, with nothing rescheduled, for
+// as long as the region is set (queued files never loop). Frames are file
+// frames. crossfadeSeconds > 0 blends the audio leading up to startFrame into
+// the last crossfadeSeconds before endFrame, equal-power, so the wrap lands
+// on matching material; the region needs that much audio before startFrame
+// and within it. Streaming players decode the loop start when it is set, so a
+// wrap never waits for the I/O thread. PlayheadState.loops counts the wraps.
+// Loading another file clears the region.
+#define AUDIOPLAYER_MAX_LOOP_CROSSFADE 10.0
+const char* audioplayer_set_loop(AudioPlayer* player, int64_t startFrame, int64_t endFrame, double crossfadeSeconds);
+const char* audioplayer_clear_loop(AudioPlayer* player);
+
+// Persistent analysis cache (native/analysiscache.h), off until opened. While
+// open, players answer format and duration queries, whole-file RMS and
+// loudness analysis and waveform overviews from entries keyed by file content,
+// and store what they compute. The directory is kept under maxBytes by
+// evicting the least recently used entries.
+typedef struct {
+    int entries;
+    int64_t bytes;
+    int64_t maxBytes;
+    int64_t hits;       // Lookups answered from the cache since it was opened
+    int64_t misses;
+    int64_t evictions;
+} AnalysisCacheStats;
+
+const char* analysis_cache_open(const char* directory, int64_t maxBytes);
+void analysis_cache_close(void);
+const char* analysis_cache_get_stats(AnalysisCacheStats* stats);
+const char* analysis_cache_clear(void);
+
+// Shared decoded-audio cache (native/pcmcache.h), off until given a budget.
+// While on, playback channels on the same file share one read-only copy of
+// its decoded PCM, reference counted by the players using it, instead of each
+// decoding their own (streaming players keep reading ahead). Unused entries
+// are evicted, least recently used first, while the total is over
+// budgetBytes; entries in use never are. A budget of 0 turns the cache off
+// and frees every unused entry.
+typedef struct {
+    int entries;
+    int inUse;          // Entries referenced by at least one player
+    int64_t bytes;
+    int64_t budgetBytes;
+    int64_t hits;       // Loads answered from the cache
+    int64_t misses;
+    int64_t evictions;
+} PcmCacheStats;
+
+const char* pcm_cache_set_budget(int64_t budgetBytes);
+const char* pcm_cache_get_stats(PcmCacheStats* stats);
+
+// Pre-rendered rate/pitch variants (native/variant.h): the loaded file
+// rendered in the background at rate/pitch combinations a player is expected
+// to use, on up to `workers` threads (<= 0 for one per core), replacing any
+// earlier request. While a variant of the current rate, pitch and pitch shift
+// options is cached, audioplayer_set_playback_rate and audioplayer_set_pitch
+// switch to it within one render cycle, crossfading over
+// AUDIOPLAYER_VARIANT_CROSSFADE seconds, and the time and pitch units stand
+// idle (routed around); other settings run them live. Players that stream or
+// have files queued always run them live. On macOS, where the player node
+// cannot be switched onto a variant in place, audioplayer_prepare_variants
+// fails and the units always run live.
+//
+// Variants are shared by every player through a process-wide cache, keyed like
+// the decoded-audio cache plus the parameters. Variants nobody plays are
+// evicted, least recently used first, while the total is over budgetBytes
+// (VARIANT_CACHE_DEFAULT_BUDGET until configured). With a directory, rendered
+// variants are also written there by file content, read back instead of
+// rendered again, and kept under diskBudgetBytes like the analysis cache.
+#define AUDIOPLAYER_VARIANT_CROSSFADE 0.05
+#define VARIANT_CACHE_DEFAULT_BUDGET (256ll << 20)
+
+typedef struct {
+    float rate;   // 0.25 ... 4.0, as audioplayer_set_playback_rate
+    float cents;  // -2400 ... 2400, as audioplayer_set_pitch
+} PlayerVariant;
+
+typedef struct {
+    int requested;      // Variants of the last audioplayer_prepare_variants
+    int ready;          // Of those, cached in memory now
+    int pending;        // Still being loaded or rendered
+    int failed;
+    bool active;        // Playing a variant rather than running the live units
+    const char* error;  // First failure, NULL if none
+} PlayerVariantsStatus;
+
+typedef struct {
+    int entries;        // In memory
+    int inUse;          // Being played
+    int64_t bytes;
+    int64_t budgetBytes;
+    int diskEntries;
+    int64_t diskBytes;
+    int64_t diskBudgetBytes;  // 0 without a directory
+    int64_t hits;       // Switches and prepared variants found in memory
+    int64_t misses;
+    int64_t diskHits;   // Read back from the directory instead of rendered
+    int64_t renders;
+    int64_t evictions;  // From memory
+} VariantCacheStats;
+
+const char* audioplayer_prepare_variants(AudioPlayer* player, const PlayerVariant* variants, int count, int workers);
+const char* audioplayer_get_variants_status(AudioPlayer* player, PlayerVariantsStatus* status);
+// A NULL or empty directory keeps variants in memory only
+const char* variant_cache_configure(int64_t budgetBytes, const char* directory, int64_t diskBudgetBytes);
+const char* variant_cache_get_stats(VariantCacheStats* stats);
+
+// Batch file analysis: decode and meter many files on a bounded worker pool,
+// without an engine or player. Uses the analysis cache when it is open.
+// Results arrive in completion order; their strings stay valid until the
+// batch is destroyed.
+#define FILE_ANALYSIS_LOUDNESS 1  // Also measure EBU R128 loudness (about 3x the work)
+
+typedef struct {
+    int index;                 // Position in the path list
+    const char* path;
+    const char* error;         // NULL on success
+    bool cached;               // Served from the analysis cache
+    double sampleRate;
+    int channelCount;
+    int64_t frames;
+    double rms;                // Average of the channels' RMS, as audioplayer_analyze_file_segment
+    float peak;                // Absolute sample peak of any channel
+    LoudnessMetrics loudness;  // With FILE_ANALYSIS_LOUDNESS
+} FileAnalysisResult;
+
+typedef struct FileAnalysisBatch FileAnalysisBatch;
+
+// workers <= 0 uses one per core. Paths are copied.
+const char* file_analysis_start(const char* const* paths, int count, int workers, int flags, FileAnalysisBatch** batch);
+// Wait up to timeoutMs for results and copy out at most `capacity`. Returns how
+// many were copied, or -1 once every file has been reported or, after
+// file_analysis_cancel, the workers have stopped.
+int file_analysis_next(FileAnalysisBatch* batch, FileAnalysisResult* results, int capacity, int timeoutMs);
+// Stop starting files and abandon the ones in progress (they are not reported)
+void file_analysis_cancel(FileAnalysisBatch* batch);
+void file_analysis_destroy(FileAnalysisBatch* batch);  // Cancels and waits for the workers
+
 // ==============================================
 // Audio Sampler (AVAudioUnitSampler)
 // ==============================================
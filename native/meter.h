@@ -0,0 +1,208 @@
+// Vectorized metering kernel shared by taps and file analysis (both backends).
+//
+// One pass over a channel yields sum of squares, RMS, absolute peak and the
+// number of clipped samples (|x| >= 1.0). The inner loops use AVX2+FMA (picked
+// at runtime on x86), SSE2, or NEON on arm64, with a scalar fallback. Float
+// lane accumulators are folded into a double every METER_CHUNK_FRAMES frames
+// so long file segments don't lose precision.
+//
+// Header-only: everything is static inline so the ObjC (.m) and C++ headless
+// translation units each get their own copy without extra build steps.
+
+#ifndef MACAUDIO_METER_H
+#define MACAUDIO_METER_H
+
+#include <math.h>
+#include <stdint.h>
+
+#include "macaudio.h"
+
+#if defined(__x86_64__) || (defined(__i386__) && defined(__SSE2__))
+#define METER_X86 1
+#include <immintrin.h>
+#elif defined(__aarch64__) && defined(__ARM_NEON)
+#define METER_NEON 1
+#include <arm_neon.h>
+#endif
+
+#define METER_CHUNK_FRAMES 4096
+
+// Running totals for one channel; turned into MeterChannelStats at the end
+typedef struct {
+    double sumOfSquares;
+    float peak;
+    int clipCount;
+} MeterAccumulator;
+
+static inline void meter_chunk_scalar(const float* samples, int frames, MeterAccumulator* acc) {
+    float sum = 0.0f;
+    float peak = acc->peak;
+    int clips = 0;
+    for (int i = 0; i < frames; i++) {
+        const float magnitude = fabsf(samples[i]);
+        sum += samples[i] * samples[i];
+        peak = magnitude > peak ? magnitude : peak;
+        clips += magnitude >= 1.0f;
+    }
+    acc->sumOfSquares += sum;
+    acc->peak = peak;
+    acc->clipCount += clips;
+}
+
+#if METER_X86
+
+static inline void meter_chunk_sse2(const float* samples, int frames, MeterAccumulator* acc) {
+    const __m128 absMask = _mm_castsi128_ps(_mm_set1_epi32(0x7fffffff));
+    const __m128 one = _mm_set1_ps(1.0f);
+    __m128 sum0 = _mm_setzero_ps(), sum1 = _mm_setzero_ps();
+    __m128 max0 = _mm_setzero_ps(), max1 = _mm_setzero_ps();
+    __m128i clips = _mm_setzero_si128();
+
+    int i = 0;
+    for (; i + 8 <= frames; i += 8) {
+        const __m128 a = _mm_loadu_ps(samples + i);
+        const __m128 b = _mm_loadu_ps(samples + i + 4);
+        sum0 = _mm_add_ps(sum0, _mm_mul_ps(a, a));
+        sum1 = _mm_add_ps(sum1, _mm_mul_ps(b, b));
+        const __m128 absA = _mm_and_ps(a, absMask);
+        const __m128 absB = _mm_and_ps(b, absMask);
+        max0 = _mm_max_ps(max0, absA);
+        max1 = _mm_max_ps(max1, absB);
+        // Comparison lanes are all ones (-1) when clipped
+        clips = _mm_sub_epi32(clips, _mm_castps_si128(_mm_cmpge_ps(absA, one)));
+        clips = _mm_sub_epi32(clips, _mm_castps_si128(_mm_cmpge_ps(absB, one)));
+    }
+
+    float sums[4], maxes[4];
+    int32_t counts[4];
+    _mm_storeu_ps(sums, _mm_add_ps(sum0, sum1));
+    _mm_storeu_ps(maxes, _mm_max_ps(max0, max1));
+    _mm_storeu_si128((__m128i*)counts, clips);
+    acc->sumOfSquares += (double)sums[0] + sums[1] + sums[2] + sums[3];
+    for (int lane = 0; lane < 4; lane++) {
+        acc->peak = maxes[lane] > acc->peak ? maxes[lane] : acc->peak;
+        acc->clipCount += counts[lane];
+    }
+    meter_chunk_scalar(samples + i, frames - i, acc);
+}
+
+__attribute__((target("avx2,fma"))) static inline void meter_chunk_avx2(const float* samples, int frames,
+                                                                       MeterAccumulator* acc) {
+    const __m256 absMask = _mm256_castsi256_ps(_mm256_set1_epi32(0x7fffffff));
+    const __m256 one = _mm256_set1_ps(1.0f);
+    __m256 sum0 = _mm256_setzero_ps(), sum1 = _mm256_setzero_ps();
+    __m256 max0 = _mm256_setzero_ps(), max1 = _mm256_setzero_ps();
+    __m256i clips = _mm256_setzero_si256();
+
+    int i = 0;
+    for (; i + 16 <= frames; i += 16) {
+        const __m256 a = _mm256_loadu_ps(samples + i);
+        const __m256 b = _mm256_loadu_ps(samples + i + 8);
+        sum0 = _mm256_fmadd_ps(a, a, sum0);
+        sum1 = _mm256_fmadd_ps(b, b, sum1);
+        const __m256 absA = _mm256_and_ps(a, absMask);
+        const __m256 absB = _mm256_and_ps(b, absMask);
+        max0 = _mm256_max_ps(max0, absA);
+        max1 = _mm256_max_ps(max1, absB);
+        clips = _mm256_sub_epi32(clips, _mm256_castps_si256(_mm256_cmp_ps(absA, one, _CMP_GE_OQ)));
+        clips = _mm256_sub_epi32(clips, _mm256_castps_si256(_mm256_cmp_ps(absB, one, _CMP_GE_OQ)));
+    }
+
+    float sums[8], maxes[8];
+    int32_t counts[8];
+    _mm256_storeu_ps(sums, _mm256_add_ps(sum0, sum1));
+    _mm256_storeu_ps(maxes, _mm256_max_ps(max0, max1));
+    _mm256_storeu_si256((__m256i*)counts, clips);
+    double total = 0.0;
+    for (int lane = 0; lane < 8; lane++) {
+        total += sums[lane];
+        acc->peak = maxes[lane] > acc->peak ? maxes[lane] : acc->peak;
+        acc->clipCount += counts[lane];
+    }
+    acc->sumOfSquares += total;
+    meter_chunk_scalar(samples + i, frames - i, acc);
+}
+
+static inline int meter_has_avx2(void) {
+    return __builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma");
+}
+
+#elif METER_NEON
+
+static inline void meter_chunk_neon(const float* samples, int frames, MeterAccumulator* acc) {
+    const float32x4_t one = vdupq_n_f32(1.0f);
+    float32x4_t sum0 = vdupq_n_f32(0.0f), sum1 = vdupq_n_f32(0.0f);
+    float32x4_t max0 = vdupq_n_f32(0.0f), max1 = vdupq_n_f32(0.0f);
+    uint32x4_t clips = vdupq_n_u32(0);
+
+    int i = 0;
+    for (; i + 8 <= frames; i += 8) {
+        const float32x4_t a = vld1q_f32(samples + i);
+        const float32x4_t b = vld1q_f32(samples + i + 4);
+        sum0 = vfmaq_f32(sum0, a, a);
+        sum1 = vfmaq_f32(sum1, b, b);
+        const float32x4_t absA = vabsq_f32(a);
+        const float32x4_t absB = vabsq_f32(b);
+        max0 = vmaxq_f32(max0, absA);
+        max1 = vmaxq_f32(max1, absB);
+        // Comparison lanes are all ones when clipped; subtracting adds one
+        clips = vsubq_u32(clips, vcgeq_f32(absA, one));
+        clips = vsubq_u32(clips, vcgeq_f32(absB, one));
+    }
+
+    acc->sumOfSquares += (double)vaddvq_f32(vaddq_f32(sum0, sum1));
+    const float peak = vmaxvq_f32(vmaxq_f32(max0, max1));
+    acc->peak = peak > acc->peak ? peak : acc->peak;
+    acc->clipCount += (int)vaddvq_u32(clips);
+    meter_chunk_scalar(samples + i, frames - i, acc);
+}
+
+#endif
+
+// Name of the kernel meter_channel uses on this machine
+static inline const char* meter_kernel(void) {
+#if METER_X86
+    return meter_has_avx2() ? "avx2" : "sse2";
+#elif METER_NEON
+    return "neon";
+#else
+    return "scalar";
+#endif
+}
+
+// Meter one channel of `frames` contiguous samples
+static inline void meter_channel(const float* samples, int frames, MeterChannelStats* stats) {
+    MeterAccumulator acc = {0.0, 0.0f, 0};
+#if METER_X86
+    const int avx2 = meter_has_avx2();
+#endif
+    for (int offset = 0; offset < frames; offset += METER_CHUNK_FRAMES) {
+        const int chunk = frames - offset < METER_CHUNK_FRAMES ? frames - offset : METER_CHUNK_FRAMES;
+#if METER_X86
+        if (avx2) {
+            meter_chunk_avx2(samples + offset, chunk, &acc);
+        } else {
+            meter_chunk_sse2(samples + offset, chunk, &acc);
+        }
+#elif METER_NEON
+        meter_chunk_neon(samples + offset, chunk, &acc);
+#else
+        meter_chunk_scalar(samples + offset, chunk, &acc);
+#endif
+    }
+
+    stats->sumOfSquares = acc.sumOfSquares;
+    stats->rms = frames > 0 ? (float)sqrt(acc.sumOfSquares / frames) : 0.0f;
+    stats->peak = acc.peak;
+    stats->clipCount = acc.clipCount;
+}
+
+// Meter `channelCount` planar channels in one pass each
+static inline void meter_channels(const float* const* channels, int channelCount, int frames,
+                                  MeterChannelStats* stats) {
+    for (int c = 0; c < channelCount; c++) {
+        meter_channel(channels[c], frames, &stats[c]);
+    }
+}
+
+#endif  // MACAUDIO_METER_H
@@ -1,6 +1,7 @@
 #import <AVFoundation/AVFoundation.h>
 #import <Foundation/Foundation.h>
 #import <AudioToolbox/AudioToolbox.h>
+#include <stdatomic.h>
 
 #ifdef __cplusplus
 extern "C" {
@@ -18,6 +19,8 @@ AudioNodeResult audionode_output_format_for_bus(void* nodePtr, int bus);
 const char* audionode_get_number_of_inputs(void* nodePtr, int* result);
 const char* audionode_get_number_of_outputs(void* nodePtr, int* result);
 const char* audionode_is_installed_on_engine(void* nodePtr, bool* result);
+const char* audionode_is_elided(void* nodePtr, bool* result);
+const char* audionode_get_latency(void* nodePtr, int* frames);
 const char* audionode_log_info(void* nodePtr);
 AudioNodeResult audiomixer_create(void);
 const char* audiomixer_set_volume(void* mixerPtr, float volume, int inputBus);
@@ -29,6 +32,8 @@ const char* audiomixer_set_input_volume_for_connection(void* sourcePtr, void* mi
 const char* audiomixer_get_input_volume_for_connection(void* sourcePtr, void* mixerPtr, int destBus, float* result);
 const char* audiomixer_set_input_pan_for_connection(void* sourcePtr, void* mixerPtr, int destBus, float pan);
 const char* audiomixer_get_input_pan_for_connection(void* sourcePtr, void* mixerPtr, int destBus, float* result);
+const char* audiomixer_set_input_delay_for_connection(void* sourcePtr, void* mixerPtr, int destBus, int frames);
+const char* audiomixer_get_input_delay_for_connection(void* sourcePtr, void* mixerPtr, int destBus, int* result);
 const char* audionode_release(void* nodePtr);
 AudioNodeResult matrixmixer_create(void);
 const char* matrixmixer_configure_invert(void* unitPtr);
@@ -144,6 +149,51 @@ const char* audionode_is_installed_on_engine(void* nodePtr, bool* result) {
     return NULL; // Success
 }
 
+// Implemented by the units in player.m
+@protocol MacAudioElidable
+- (BOOL)isElided;
+@end
+
+const char* audionode_is_elided(void* nodePtr, bool* result) {
+    if (!result) {
+        return "Result pointer is null";
+    }
+
+    if (!nodePtr) {
+        return "Node pointer is null";
+    }
+
+    // Only our own time and pitch units route themselves around; Apple's
+    // mixers always mix
+    AVAudioNode* node = (__bridge AVAudioNode*)nodePtr;
+    *result = NO;
+    if ([node isKindOfClass:[AVAudioUnit class]]) {
+        AUAudioUnit* unit = ((AVAudioUnit*)node).AUAudioUnit;
+        if ([unit respondsToSelector:@selector(isElided)]) {
+            *result = [(id<MacAudioElidable>)unit isElided];
+        }
+    }
+    return NULL; // Success
+}
+
+const char* audionode_get_latency(void* nodePtr, int* frames) {
+    if (!frames) {
+        return "Result pointer is null";
+    }
+
+    if (!nodePtr) {
+        return "Node pointer is null";
+    }
+
+    // Players, mixers and samplers add none; an audio unit reports its own
+    AVAudioNode* node = (__bridge AVAudioNode*)nodePtr;
+    *frames = 0;
+    if ([node isKindOfClass:[AVAudioUnit class]]) {
+        *frames = (int)lround(((AVAudioUnit*)node).AUAudioUnit.latency * [node outputFormatForBus:0].sampleRate);
+    }
+    return NULL; // Success
+}
+
 const char* audionode_log_info(void* nodePtr) {
     if (!nodePtr) {
         return "Node pointer is null";
@@ -342,15 +392,45 @@ static AVAudioMixingDestination* _getDestinationFor(void* sourcePtr, void* mixer
     return dest;
 }
 
+static AVAudioUnitEffect* _delayFor(void* sourcePtr, void* mixerPtr, int destBus, const char** err);
+
+// A delay unit between source and mixer takes the source's place on the bus,
+// so its settings live on the mixer's input parameters instead. Yields the
+// parameter for a delayed connection, or the source's destination otherwise.
+static const char* _connectionControl(void* sourcePtr, void* mixerPtr, int destBus, AudioUnitParameterID address,
+                                      AUParameter** param, AVAudioMixingDestination** dest) {
+    *param = nil;
+    *dest = nil;
+    const char* e = NULL;
+    AVAudioUnitEffect* delay = _delayFor(sourcePtr, mixerPtr, destBus, &e);
+    if (e) { return e; }
+    if (!delay) {
+        *dest = _getDestinationFor(sourcePtr, mixerPtr, destBus, &e);
+        return e;
+    }
+    AVAudioMixerNode* mixer = (__bridge AVAudioMixerNode*)mixerPtr;
+    *param = [mixer.AUAudioUnit.parameterTree parameterWithID:address scope:kAudioUnitScope_Input element:destBus];
+    if (!*param) {
+        NSString* msg = [NSString stringWithFormat:@"No input parameter %d for mixer bus %d", (int)address, destBus];
+        return [msg UTF8String];
+    }
+    return NULL;
+}
+
 const char* audiomixer_set_input_volume_for_connection(void* sourcePtr, void* mixerPtr, int destBus, float volume) {
     if (volume < 0.0f || volume > 1.0f) {
         return "Volume must be between 0.0 and 1.0";
     }
-    const char* e = NULL;
-    AVAudioMixingDestination* dest = _getDestinationFor(sourcePtr, mixerPtr, destBus, &e);
-    if (!dest) { return e; }
+    AUParameter* param = nil;
+    AVAudioMixingDestination* dest = nil;
+    const char* e = _connectionControl(sourcePtr, mixerPtr, destBus, kMultiChannelMixerParam_Volume, &param, &dest);
+    if (e) { return e; }
     @try {
-        dest.volume = volume;
+        if (param) {
+            param.value = volume;
+        } else {
+            dest.volume = volume;
+        }
         NSLog(@"Set per-connection volume %.2f on bus %d", volume, destBus);
         return NULL;
     } @catch (NSException* ex) {
@@ -361,11 +441,12 @@ const char* audiomixer_set_input_volume_for_connection(void* sourcePtr, void* mi
 
 const char* audiomixer_get_input_volume_for_connection(void* sourcePtr, void* mixerPtr, int destBus, float* result) {
     if (!result) { return "Result pointer is null"; }
-    const char* e = NULL;
-    AVAudioMixingDestination* dest = _getDestinationFor(sourcePtr, mixerPtr, destBus, &e);
-    if (!dest) { return e; }
+    AUParameter* param = nil;
+    AVAudioMixingDestination* dest = nil;
+    const char* e = _connectionControl(sourcePtr, mixerPtr, destBus, kMultiChannelMixerParam_Volume, &param, &dest);
+    if (e) { return e; }
     @try {
-        *result = dest.volume;
+        *result = param ? param.value : dest.volume;
         return NULL;
     } @catch (NSException* ex) {
         NSString* msg = [NSString stringWithFormat:@"Failed to get per-connection volume: %@", ex.reason];
@@ -377,11 +458,16 @@ const char* audiomixer_set_input_pan_for_connection(void* sourcePtr, void* mixer
     if (pan < -1.0f || pan > 1.0f) {
         return "Pan must be between -1.0 and 1.0";
     }
-    const char* e = NULL;
-    AVAudioMixingDestination* dest = _getDestinationFor(sourcePtr, mixerPtr, destBus, &e);
-    if (!dest) { return e; }
+    AUParameter* param = nil;
+    AVAudioMixingDestination* dest = nil;
+    const char* e = _connectionControl(sourcePtr, mixerPtr, destBus, kMultiChannelMixerParam_Pan, &param, &dest);
+    if (e) { return e; }
     @try {
-        dest.pan = pan;
+        if (param) {
+            param.value = pan;
+        } else {
+            dest.pan = pan;
+        }
         NSLog(@"Set per-connection pan %.2f on bus %d", pan, destBus);
         return NULL;
     } @catch (NSException* ex) {
@@ -392,11 +478,12 @@ const char* audiomixer_set_input_pan_for_connection(void* sourcePtr, void* mixer
 
 const char* audiomixer_get_input_pan_for_connection(void* sourcePtr, void* mixerPtr, int destBus, float* result) {
     if (!result) { return "Result pointer is null"; }
-    const char* e = NULL;
-    AVAudioMixingDestination* dest = _getDestinationFor(sourcePtr, mixerPtr, destBus, &e);
-    if (!dest) { return e; }
+    AUParameter* param = nil;
+    AVAudioMixingDestination* dest = nil;
+    const char* e = _connectionControl(sourcePtr, mixerPtr, destBus, kMultiChannelMixerParam_Pan, &param, &dest);
+    if (e) { return e; }
     @try {
-        *result = dest.pan;
+        *result = param ? param.value : dest.pan;
         return NULL;
     } @catch (NSException* ex) {
         NSString* msg = [NSString stringWithFormat:@"Failed to get per-connection pan: %@", ex.reason];
@@ -404,6 +491,254 @@ const char* audiomixer_get_input_pan_for_connection(void* sourcePtr, void* mixer
     }
 }
 
+// -------------------------
+// Per-connection delay
+// -------------------------
+
+// Matches MIXER_MAX_INPUT_DELAY in macaudio.h
+#define MAX_INPUT_DELAY 65536
+#define DELAY_MAX_CHANNELS 8
+
+// Apple's mixers cannot delay an input, so a compensating delay is a unit of
+// our own between the source and the mixer. It keeps a ring of what it
+// passed per channel, sized for the longest delay; the delay is an atomic
+// the render block reads once per cycle.
+typedef struct {
+    _Atomic int delay;  // Frames
+    float* ring;        // capacity frames per channel
+    int capacity;       // A power of two
+    int written;        // Frames written since the last reset, modulo capacity
+    int channelCount;
+} DelayKernel;
+
+static const AudioComponentDescription delayDescription = {
+    .componentType = kAudioUnitType_Effect,
+    .componentSubType = 'cdly',
+    .componentManufacturer = 'MacA',
+    .componentFlags = 0,
+    .componentFlagsMask = 0,
+};
+
+@interface MacAudioDelayUnit : AUAudioUnit
+@property (nonatomic, readonly) DelayKernel* kernel;
+@end
+
+@implementation MacAudioDelayUnit {
+    AUAudioUnitBusArray* _inputBusArray;
+    AUAudioUnitBusArray* _outputBusArray;
+    DelayKernel* _kernel;
+}
+
+- (instancetype)initWithComponentDescription:(AudioComponentDescription)componentDescription
+                                     options:(AudioComponentInstantiationOptions)options
+                                       error:(NSError**)outError {
+    self = [super initWithComponentDescription:componentDescription options:options error:outError];
+    if (!self) {
+        return nil;
+    }
+    AVAudioFormat* format = [[AVAudioFormat alloc] initStandardFormatWithSampleRate:44100.0 channels:2];
+    AUAudioUnitBus* input = [[AUAudioUnitBus alloc] initWithFormat:format error:outError];
+    AUAudioUnitBus* output = [[AUAudioUnitBus alloc] initWithFormat:format error:outError];
+    _kernel = calloc(1, sizeof(DelayKernel));
+    if (!input || !output || !_kernel) {
+        return nil;
+    }
+    input.maximumChannelCount = DELAY_MAX_CHANNELS;
+    output.maximumChannelCount = DELAY_MAX_CHANNELS;
+    atomic_init(&_kernel->delay, 0);
+    _inputBusArray = [[AUAudioUnitBusArray alloc] initWithAudioUnit:self busType:AUAudioUnitBusTypeInput busses:@[input]];
+    _outputBusArray = [[AUAudioUnitBusArray alloc] initWithAudioUnit:self busType:AUAudioUnitBusTypeOutput busses:@[output]];
+    self.maximumFramesToRender = 4096;
+    return self;
+}
+
+- (void)dealloc {
+    if (_kernel) {
+        free(_kernel->ring);
+        free(_kernel);
+    }
+}
+
+- (AUAudioUnitBusArray*)inputBusses {
+    return _inputBusArray;
+}
+
+- (AUAudioUnitBusArray*)outputBusses {
+    return _outputBusArray;
+}
+
+- (DelayKernel*)kernel {
+    return _kernel;
+}
+
+// The delay is what the unit is for, not latency to compensate in turn
+- (NSTimeInterval)pathLatency {
+    return 0.0;
+}
+
+- (BOOL)allocateRenderResourcesAndReturnError:(NSError**)outError {
+    if (![super allocateRenderResourcesAndReturnError:outError]) {
+        return NO;
+    }
+    AVAudioFormat* format = _outputBusArray[0].format;
+    int capacity = 1;
+    while (capacity < MAX_INPUT_DELAY + (int)self.maximumFramesToRender) {
+        capacity <<= 1;
+    }
+    free(_kernel->ring);
+    _kernel->ring = calloc((size_t)capacity * format.channelCount, sizeof(float));
+    _kernel->capacity = capacity;
+    _kernel->written = 0;
+    _kernel->channelCount = (int)format.channelCount;
+    if (!_kernel->ring || _inputBusArray[0].format.channelCount != format.channelCount) {
+        if (outError) {
+            *outError = [NSError errorWithDomain:NSOSStatusErrorDomain code:kAudioUnitErr_FailedInitialization userInfo:nil];
+        }
+        [super deallocateRenderResources];
+        return NO;
+    }
+    return YES;
+}
+
+- (void)deallocateRenderResources {
+    free(_kernel->ring);
+    _kernel->ring = NULL;
+    [super deallocateRenderResources];
+}
+
+- (void)reset {
+    if (_kernel->ring) {
+        memset(_kernel->ring, 0, (size_t)_kernel->capacity * _kernel->channelCount * sizeof(float));
+    }
+    _kernel->written = 0;
+}
+
+- (AUInternalRenderBlock)internalRenderBlock {
+    DelayKernel* kernel = _kernel;
+    return ^AUAudioUnitStatus(AudioUnitRenderActionFlags* actionFlags, const AudioTimeStamp* timestamp,
+                              AUAudioFrameCount frameCount, NSInteger outputBusNumber, AudioBufferList* outputData,
+                              const AURenderEvent* realtimeEventListHead, AURenderPullInputBlock pullInputBlock) {
+        // Pull straight into the output, then swap it through the ring
+        const AUAudioUnitStatus status = pullInputBlock(actionFlags, timestamp, frameCount, 0, outputData);
+        if (status != noErr) {
+            return status;
+        }
+        const int frames = (int)frameCount;
+        const int delay = atomic_load_explicit(&kernel->delay, memory_order_relaxed);
+        const int mask = kernel->capacity - 1;
+        const int from = (kernel->written - delay + kernel->capacity) & mask;
+        for (int c = 0; c < kernel->channelCount && c < (int)outputData->mNumberBuffers; c++) {
+            float* samples = outputData->mBuffers[c].mData;
+            float* ring = kernel->ring + (size_t)c * kernel->capacity;
+            for (int i = 0; i < frames; i++) {
+                ring[(kernel->written + i) & mask] = samples[i];
+                samples[i] = ring[(from + i) & mask];
+            }
+        }
+        kernel->written = (kernel->written + frames) & mask;
+        return noErr;
+    };
+}
+
+@end
+
+static void delay_register(void) {
+    static dispatch_once_t once;
+    dispatch_once(&once, ^{
+        [AUAudioUnit registerSubclass:[MacAudioDelayUnit class]
+               asComponentDescription:delayDescription
+                                 name:@"MacAudio: Delay"
+                              version:1];
+    });
+}
+
+// The delay unit between source and mixer bus, or nil when the source is
+// connected straight to it. Fails when the bus is fed by neither.
+static AVAudioUnitEffect* _delayFor(void* sourcePtr, void* mixerPtr, int destBus, const char** err) {
+    *err = NULL;
+    if (!sourcePtr) { *err = "Source node pointer is null"; return nil; }
+    if (!mixerPtr)  { *err = "Mixer pointer is null"; return nil; }
+    if (destBus < 0) { *err = "Destination bus cannot be negative"; return nil; }
+
+    AVAudioNode* sourceNode = (__bridge AVAudioNode*)sourcePtr;
+    AVAudioMixerNode* mixer = (__bridge AVAudioMixerNode*)mixerPtr;
+    AVAudioEngine* engine = mixer.engine;
+    if (!engine) { *err = "Mixer is not attached to an engine"; return nil; }
+
+    AVAudioConnectionPoint* point = [engine inputConnectionPointForNode:mixer inputBus:destBus];
+    if (point.node == sourceNode) {
+        return nil;
+    }
+    if ([point.node isKindOfClass:[AVAudioUnitEffect class]] &&
+        [((AVAudioUnitEffect*)point.node).AUAudioUnit isKindOfClass:[MacAudioDelayUnit class]] &&
+        [engine inputConnectionPointForNode:point.node inputBus:0].node == sourceNode) {
+        return (AVAudioUnitEffect*)point.node;
+    }
+    *err = "Source is not connected to that mixer bus";
+    return nil;
+}
+
+const char* audiomixer_set_input_delay_for_connection(void* sourcePtr, void* mixerPtr, int destBus, int frames) {
+    if (frames < 0 || frames > MAX_INPUT_DELAY) {
+        NSString* msg = [NSString stringWithFormat:@"Delay must be between 0 and %d frames", MAX_INPUT_DELAY];
+        return [msg UTF8String];
+    }
+    const char* e = NULL;
+    AVAudioUnitEffect* delay = _delayFor(sourcePtr, mixerPtr, destBus, &e);
+    if (e) { return e; }
+
+    AVAudioNode* sourceNode = (__bridge AVAudioNode*)sourcePtr;
+    AVAudioMixerNode* mixer = (__bridge AVAudioMixerNode*)mixerPtr;
+    AVAudioEngine* engine = mixer.engine;
+    @try {
+        // The connection's volume and pan move with it between the source's
+        // mixing destination and the mixer's input parameters
+        float volume = 1.0f, pan = 0.0f;
+        const char* pe = NULL;
+        if (delay && frames == 0) {
+            pe = audiomixer_get_input_volume_for_connection(sourcePtr, mixerPtr, destBus, &volume);
+            if (!pe) { pe = audiomixer_get_input_pan_for_connection(sourcePtr, mixerPtr, destBus, &pan); }
+            if (pe) { return pe; }
+            AVAudioConnectionPoint* from = [engine inputConnectionPointForNode:delay inputBus:0];
+            AVAudioFormat* format = [delay outputFormatForBus:0];
+            [engine disconnectNodeInput:mixer bus:destBus];
+            [engine detachNode:delay];
+            [engine connect:sourceNode to:mixer fromBus:from.bus toBus:destBus format:format];
+        } else if (delay) {
+            atomic_store(&((MacAudioDelayUnit*)delay.AUAudioUnit).kernel->delay, frames);
+            return NULL;
+        } else if (frames > 0) {
+            pe = audiomixer_get_input_volume_for_connection(sourcePtr, mixerPtr, destBus, &volume);
+            if (!pe) { pe = audiomixer_get_input_pan_for_connection(sourcePtr, mixerPtr, destBus, &pan); }
+            if (pe) { return pe; }
+            AVAudioFormat* format = [sourceNode outputFormatForBus:0];
+            delay_register();
+            delay = [[AVAudioUnitEffect alloc] initWithAudioComponentDescription:delayDescription];
+            atomic_store(&((MacAudioDelayUnit*)delay.AUAudioUnit).kernel->delay, frames);
+            [engine attachNode:delay];
+            [engine disconnectNodeInput:mixer bus:destBus];
+            [engine connect:sourceNode to:delay fromBus:0 toBus:0 format:format];
+            [engine connect:delay to:mixer fromBus:0 toBus:destBus format:format];
+        } else {
+            return NULL;
+        }
+        pe = audiomixer_set_input_volume_for_connection(sourcePtr, mixerPtr, destBus, volume);
+        return pe ? pe : audiomixer_set_input_pan_for_connection(sourcePtr, mixerPtr, destBus, pan);
+    } @catch (NSException* ex) {
+        NSString* msg = [NSString stringWithFormat:@"Failed to set per-connection delay: %@", ex.reason];
+        return [msg UTF8String];
+    }
+}
+
+const char* audiomixer_get_input_delay_for_connection(void* sourcePtr, void* mixerPtr, int destBus, int* result) {
+    if (!result) { return "Result pointer is null"; }
+    const char* e = NULL;
+    AVAudioUnitEffect* delay = _delayFor(sourcePtr, mixerPtr, destBus, &e);
+    if (e) { return e; }
+    *result = delay ? atomic_load(&((MacAudioDelayUnit*)delay.AUAudioUnit).kernel->delay) : 0;
+    return NULL;
+}
+
 // -------------------------
 // Generic node helpers
 // -------------------------
@@ -0,0 +1,178 @@
+// Process-wide cache of decoded audio shared by playback channels, for both
+// backends.
+//
+// Channels that load the same file share one read-only copy of its decoded
+// PCM instead of decoding their own. An entry is keyed by path, the file's
+// size and modification time (an edited file is decoded again) and the format
+// it was decoded to; a zero format means the file's own. Players hold
+// references; entries nobody references stay cached, least recently used
+// first out, while the total is over the budget. Entries in use are never
+// evicted, so the total can exceed the budget while they play.
+//
+// This header keeps only the bookkeeping. The backend owns the payload (a
+// headless AudioFile, an AVAudioPCMBuffer), decodes outside its lock, and
+// holds the lock around every call here; evicted payloads are handed back to
+// be freed after it is released.
+
+#ifndef MACAUDIO_PCMCACHE_H
+#define MACAUDIO_PCMCACHE_H
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+
+#include "macaudio.h"
+
+typedef struct {
+    char* path;
+    int64_t fileSize;
+    int64_t fileModified;  // Nanoseconds
+    double sampleRate;     // Decoded format, 0 = the file's own
+    int channelCount;
+    void* payload;
+    int64_t bytes;
+    int refs;
+    uint64_t lastUse;
+} PcmCacheEntry;
+
+typedef struct {
+    PcmCacheEntry* entries;
+    int count;
+    int capacity;
+    uint64_t clock;
+    PcmCacheStats stats;  // Counters and budget; entries/inUse/bytes kept current
+} PcmCache;
+
+// Size and modification time of `path`, the file half of a key
+static inline bool pcm_cache_identify(const char* path, int64_t* size, int64_t* modified) {
+    struct stat info;
+    if (stat(path, &info) != 0) {
+        return false;
+    }
+    *size = (int64_t)info.st_size;
+#ifdef __APPLE__
+    *modified = (int64_t)info.st_mtimespec.tv_sec * 1000000000 + info.st_mtimespec.tv_nsec;
+#else
+    *modified = (int64_t)info.st_mtim.tv_sec * 1000000000 + info.st_mtim.tv_nsec;
+#endif
+    return true;
+}
+
+static inline int pcm_cache_index(const PcmCache* cache, const char* path, int64_t size, int64_t modified,
+                                  double sampleRate, int channelCount) {
+    for (int i = 0; i < cache->count; i++) {
+        const PcmCacheEntry* entry = &cache->entries[i];
+        if (entry->fileSize == size && entry->fileModified == modified && entry->sampleRate == sampleRate &&
+            entry->channelCount == channelCount && !strcmp(entry->path, path)) {
+            return i;
+        }
+    }
+    return -1;
+}
+
+// Reference the payload cached under the key, or NULL (counted as a miss)
+static inline void* pcm_cache_acquire(PcmCache* cache, const char* path, int64_t size, int64_t modified,
+                                      double sampleRate, int channelCount) {
+    const int index = pcm_cache_index(cache, path, size, modified, sampleRate, channelCount);
+    if (index < 0) {
+        cache->stats.misses++;
+        return NULL;
+    }
+    PcmCacheEntry* entry = &cache->entries[index];
+    if (entry->refs++ == 0) {
+        cache->stats.inUse++;
+    }
+    entry->lastUse = ++cache->clock;
+    cache->stats.hits++;
+    return entry->payload;
+}
+
+// Add a freshly decoded payload, referenced once. If another player cached the
+// same key meanwhile, that payload is referenced and returned instead and the
+// caller frees its own. Returns NULL if the entry table cannot grow.
+static inline void* pcm_cache_insert(PcmCache* cache, const char* path, int64_t size, int64_t modified,
+                                     double sampleRate, int channelCount, void* payload, int64_t bytes) {
+    const int index = pcm_cache_index(cache, path, size, modified, sampleRate, channelCount);
+    if (index >= 0) {
+        PcmCacheEntry* entry = &cache->entries[index];
+        if (entry->refs++ == 0) {
+            cache->stats.inUse++;
+        }
+        entry->lastUse = ++cache->clock;
+        return entry->payload;
+    }
+    if (cache->count == cache->capacity) {
+        const int capacity = cache->capacity ? cache->capacity * 2 : 16;
+        PcmCacheEntry* entries = (PcmCacheEntry*)realloc(cache->entries, (size_t)capacity * sizeof(PcmCacheEntry));
+        if (!entries) {
+            return NULL;
+        }
+        cache->entries = entries;
+        cache->capacity = capacity;
+    }
+    char* copy = strdup(path);
+    if (!copy) {
+        return NULL;
+    }
+    PcmCacheEntry* entry = &cache->entries[cache->count++];
+    entry->path = copy;
+    entry->fileSize = size;
+    entry->fileModified = modified;
+    entry->sampleRate = sampleRate;
+    entry->channelCount = channelCount;
+    entry->payload = payload;
+    entry->bytes = bytes;
+    entry->refs = 1;
+    entry->lastUse = ++cache->clock;
+    cache->stats.entries++;
+    cache->stats.inUse++;
+    cache->stats.bytes += bytes;
+    return payload;
+}
+
+// Drop one reference. Returns false if the payload is not cached (the caller
+// owns it).
+static inline bool pcm_cache_release(PcmCache* cache, const void* payload) {
+    for (int i = 0; i < cache->count; i++) {
+        PcmCacheEntry* entry = &cache->entries[i];
+        if (entry->payload == payload) {
+            if (--entry->refs == 0) {
+                cache->stats.inUse--;
+            }
+            entry->lastUse = ++cache->clock;
+            return true;
+        }
+    }
+    return false;
+}
+
+// Evict unreferenced entries, least recently used first, until the total is
+// within the budget. Up to `capacity` evicted payloads are stored in `evicted`
+// for the caller to free; returns their number.
+static inline int pcm_cache_trim(PcmCache* cache, void** evicted, int capacity) {
+    int count = 0;
+    while (count < capacity && cache->stats.bytes > cache->stats.budgetBytes) {
+        int coldest = -1;
+        for (int i = 0; i < cache->count; i++) {
+            if (cache->entries[i].refs == 0 &&
+                (coldest < 0 || cache->entries[i].lastUse < cache->entries[coldest].lastUse)) {
+                coldest = i;
+            }
+        }
+        if (coldest < 0) {
+            break;  // Everything left is in use
+        }
+        PcmCacheEntry* entry = &cache->entries[coldest];
+        evicted[count++] = entry->payload;
+        cache->stats.bytes -= entry->bytes;
+        cache->stats.entries--;
+        cache->stats.evictions++;
+        free(entry->path);
+        cache->entries[coldest] = cache->entries[--cache->count];
+    }
+    return count;
+}
+
+#endif  // MACAUDIO_PCMCACHE_H
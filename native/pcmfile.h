@@ -0,0 +1,502 @@
+// Memory-mapped PCM file reader shared by both backends.
+//
+// Parses uncompressed WAV (PCM, float, extensible), RF64/BW64 and AIFF/AIFC
+// headers, maps the file read-only and converts frames straight from the page
+// cache into planar float32: no read() copies and no decode buffer. Native
+// (little-endian) float32 data needs no conversion at all; pcm_file_samples
+// hands out a pointer into the mapping. Integer formats go through unpack
+// kernels that use SSE2 (SSSE3 for 24-bit, picked at runtime) on x86 or NEON
+// on arm64, with a scalar fallback for the rest (8-bit, big-endian, float64).
+//
+// Access hints follow the reads: contiguous reads advise sequential access and
+// prefetch ahead, a jump (scrubbing) advises random access so the kernel stops
+// reading ahead of the wrong place. A PcmFile carries that state, so one
+// thread reads it at a time; the mapping itself is immutable.
+//
+// Header-only like meter.h, so the ObjC and C++ headless translation units
+// each compile their own copy.
+
+#ifndef MACAUDIO_PCMFILE_H
+#define MACAUDIO_PCMFILE_H
+
+#include <fcntl.h>
+#include <math.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#if defined(__x86_64__) || (defined(__i386__) && defined(__SSE2__))
+#define PCM_X86 1
+#include <immintrin.h>
+#elif defined(__aarch64__) && defined(__ARM_NEON)
+#define PCM_NEON 1
+#include <arm_neon.h>
+#endif
+
+#define PCM_CHUNK_FRAMES 1024      // Frames converted per deinterleave pass
+#define PCM_SEQUENTIAL_READS 2     // Contiguous reads before advising sequential access
+#define PCM_PREFETCH_READS 4       // Reads' worth of data prefetched ahead while sequential
+
+typedef enum {
+    PCM_ACCESS_NORMAL = 0,
+    PCM_ACCESS_SEQUENTIAL,  // Playing: read ahead aggressively, drop behind
+    PCM_ACCESS_RANDOM,      // Scrubbing: no read-ahead
+} PcmAccess;
+
+typedef struct {
+    uint8_t* map;           // Whole file, NULL when closed
+    size_t mapSize;
+    const uint8_t* data;    // First frame
+    int64_t frames;
+    int channelCount;
+    double sampleRate;
+    bool isFloat;
+    bool bigEndian;
+    int bitsPerSample;
+    int bytesPerSample;     // Container width of one sample
+    int frameBytes;
+    const char* container;  // "WAVE", "RF64", "AIFF" or "AIFC"
+
+    PcmAccess access;       // Current advice
+    int64_t nextFrame;      // Where the last read ended
+    int contiguousReads;
+} PcmFile;
+
+static inline uint16_t pcm_le16(const uint8_t* p) { return (uint16_t)(p[0] | (p[1] << 8)); }
+static inline uint32_t pcm_le32(const uint8_t* p) {
+    return (uint32_t)p[0] | ((uint32_t)p[1] << 8) | ((uint32_t)p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+static inline uint64_t pcm_le64(const uint8_t* p) { return (uint64_t)pcm_le32(p) | ((uint64_t)pcm_le32(p + 4) << 32); }
+static inline uint16_t pcm_be16(const uint8_t* p) { return (uint16_t)((p[0] << 8) | p[1]); }
+static inline uint32_t pcm_be32(const uint8_t* p) {
+    return ((uint32_t)p[0] << 24) | ((uint32_t)p[1] << 16) | ((uint32_t)p[2] << 8) | (uint32_t)p[3];
+}
+
+// 80-bit IEEE 754 extended precision, used by the AIFF COMM chunk sample rate
+static inline double pcm_extended80(const uint8_t* p) {
+    const int exponent = ((p[0] & 0x7F) << 8) | p[1];
+    uint64_t mantissa = 0;
+    for (int i = 0; i < 8; i++) {
+        mantissa = (mantissa << 8) | p[2 + i];
+    }
+    if (exponent == 0 && mantissa == 0) {
+        return 0.0;
+    }
+    const double value = ldexp((double)mantissa, exponent - 16383 - 63);
+    return (p[0] & 0x80) ? -value : value;
+}
+
+// Point `file` at the sound data of `size` available bytes from `body`
+static inline void pcm_file_set_data(PcmFile* file, const uint8_t* body, uint64_t size) {
+    file->frameBytes = file->bytesPerSample * file->channelCount;
+    file->data = body;
+    file->frames = file->frameBytes > 0 ? (int64_t)(size / (uint64_t)file->frameBytes) : 0;
+}
+
+static inline const char* pcm_parse_wave(PcmFile* file, bool rf64) {
+    const uint8_t* base = file->map;
+    const size_t size = file->mapSize;
+    uint64_t dataSize64 = 0;  // From the RF64 ds64 chunk
+    bool haveFormat = false;
+    size_t offset = 12;
+    while (offset + 8 <= size) {
+        const uint8_t* chunk = base + offset;
+        const uint64_t chunkSize = pcm_le32(chunk + 4);
+        const size_t body = offset + 8;
+        if (!memcmp(chunk, "ds64", 4) && body + 16 <= size) {
+            dataSize64 = pcm_le64(base + body + 8);
+        } else if (!memcmp(chunk, "fmt ", 4) && chunkSize >= 16 && body + 16 <= size) {
+            uint16_t formatTag = pcm_le16(base + body);
+            file->channelCount = pcm_le16(base + body + 2);
+            file->sampleRate = pcm_le32(base + body + 4);
+            file->bitsPerSample = pcm_le16(base + body + 14);
+            if (formatTag == 0xFFFE && chunkSize >= 40 && body + 26 <= size) {
+                formatTag = pcm_le16(base + body + 24);  // WAVE_FORMAT_EXTENSIBLE sub-format GUID
+            }
+            if (formatTag == 1) {
+                file->isFloat = false;
+            } else if (formatTag == 3) {
+                file->isFloat = true;
+            } else {
+                return "Unsupported WAVE format tag";
+            }
+            file->bytesPerSample = (file->bitsPerSample + 7) / 8;
+            haveFormat = true;
+        } else if (!memcmp(chunk, "data", 4)) {
+            if (!haveFormat) {
+                return "WAVE data chunk precedes fmt chunk";
+            }
+            const uint64_t declared = rf64 && chunkSize == 0xFFFFFFFFu ? dataSize64 : chunkSize;
+            const uint64_t available = declared < size - body ? declared : size - body;
+            pcm_file_set_data(file, base + body, available);
+            return NULL;
+        }
+        offset = body + chunkSize + (chunkSize & 1);
+    }
+    return "WAVE file has no data chunk";
+}
+
+static inline const char* pcm_parse_aiff(PcmFile* file, bool compressed) {
+    const uint8_t* base = file->map;
+    const size_t size = file->mapSize;
+    bool haveFormat = false;
+    size_t offset = 12;
+    file->bigEndian = true;
+    while (offset + 8 <= size) {
+        const uint8_t* chunk = base + offset;
+        const uint32_t chunkSize = pcm_be32(chunk + 4);
+        const size_t body = offset + 8;
+        if (!memcmp(chunk, "COMM", 4) && body + 18 <= size) {
+            file->channelCount = pcm_be16(base + body);
+            file->bitsPerSample = pcm_be16(base + body + 6);
+            file->sampleRate = pcm_extended80(base + body + 8);
+            file->isFloat = false;
+            if (compressed && body + 22 <= size) {
+                const uint8_t* type = base + body + 18;
+                if (!memcmp(type, "sowt", 4)) {
+                    file->bigEndian = false;
+                } else if (!memcmp(type, "fl32", 4) || !memcmp(type, "FL32", 4)) {
+                    file->isFloat = true;
+                    file->bitsPerSample = 32;
+                } else if (!memcmp(type, "fl64", 4) || !memcmp(type, "FL64", 4)) {
+                    file->isFloat = true;
+                    file->bitsPerSample = 64;
+                } else if (memcmp(type, "NONE", 4) != 0) {
+                    return "Unsupported AIFC compression type";
+                }
+            }
+            file->bytesPerSample = (file->bitsPerSample + 7) / 8;
+            haveFormat = true;
+        } else if (!memcmp(chunk, "SSND", 4) && body + 8 <= size) {
+            if (!haveFormat) {
+                return "AIFF sound data precedes COMM chunk";
+            }
+            const uint32_t dataOffset = pcm_be32(base + body);
+            const size_t start = body + 8 + (size_t)dataOffset;
+            if (start > size) {
+                return "AIFF sound data is truncated";
+            }
+            const size_t declared = chunkSize >= 8 + dataOffset ? chunkSize - 8 - dataOffset : 0;
+            pcm_file_set_data(file, base + start, declared < size - start ? declared : size - start);
+            return NULL;
+        }
+        offset = body + chunkSize + (chunkSize & 1);
+    }
+    return "AIFF file has no sound data";
+}
+
+static inline void pcm_file_close(PcmFile* file) {
+    if (file->map) {
+        munmap(file->map, file->mapSize);
+    }
+    memset(file, 0, sizeof(*file));
+}
+
+// Map `path` and parse its header. Returns NULL on success or an error; the
+// file is closed on failure. Compressed files are rejected (not an error for
+// callers that fall back to a decoder).
+static inline const char* pcm_file_open(const char* path, PcmFile* file) {
+    memset(file, 0, sizeof(*file));
+    const int fd = open(path, O_RDONLY);
+    if (fd < 0) {
+        return "Cannot open file";
+    }
+    struct stat info;
+    if (fstat(fd, &info) != 0 || info.st_size < 12) {
+        close(fd);
+        return "File is too short to be audio";
+    }
+    // Private and writable: a no-copy buffer over the mapping can never fault
+    // on a stray write, and pages nobody writes stay shared with the page cache
+    void* map = mmap(NULL, (size_t)info.st_size, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (map == MAP_FAILED) {
+        return "Cannot map file";
+    }
+    file->map = (uint8_t*)map;
+    file->mapSize = (size_t)info.st_size;
+
+    const uint8_t* header = file->map;
+    const char* error;
+    if (!memcmp(header, "RIFF", 4) && !memcmp(header + 8, "WAVE", 4)) {
+        file->container = "WAVE";
+        error = pcm_parse_wave(file, false);
+    } else if ((!memcmp(header, "RF64", 4) || !memcmp(header, "BW64", 4)) && !memcmp(header + 8, "WAVE", 4)) {
+        file->container = "RF64";
+        error = pcm_parse_wave(file, true);
+    } else if (!memcmp(header, "FORM", 4) && !memcmp(header + 8, "AIFF", 4)) {
+        file->container = "AIFF";
+        error = pcm_parse_aiff(file, false);
+    } else if (!memcmp(header, "FORM", 4) && !memcmp(header + 8, "AIFC", 4)) {
+        file->container = "AIFC";
+        error = pcm_parse_aiff(file, true);
+    } else {
+        error = "Not an uncompressed WAV or AIFF file";
+    }
+    if (!error && (file->channelCount <= 0 || file->sampleRate <= 0.0)) {
+        error = "Invalid audio format";
+    }
+    if (!error && !file->isFloat && (file->bytesPerSample < 1 || file->bytesPerSample > 4)) {
+        error = "Unsupported integer sample size";
+    }
+    if (!error && file->isFloat && file->bytesPerSample != 4 && file->bytesPerSample != 8) {
+        error = "Unsupported float sample size";
+    }
+    if (error) {
+        pcm_file_close(file);
+        return error;
+    }
+    return NULL;
+}
+
+// ---- Access hints ----
+
+// Advise the whole mapping (and prefetch [start, start + frames) when sequential)
+static inline void pcm_file_advise(PcmFile* file, PcmAccess access, int64_t start, int64_t frames) {
+    if (access != file->access) {
+        const int advice = access == PCM_ACCESS_SEQUENTIAL ? POSIX_MADV_SEQUENTIAL
+                         : access == PCM_ACCESS_RANDOM     ? POSIX_MADV_RANDOM
+                                                           : POSIX_MADV_NORMAL;
+        posix_madvise(file->map, file->mapSize, advice);
+        file->access = access;
+    }
+    if (access == PCM_ACCESS_SEQUENTIAL && frames > 0 && start < file->frames) {
+        const uintptr_t page = (uintptr_t)sysconf(_SC_PAGESIZE);
+        if (start + frames > file->frames) {
+            frames = file->frames - start;
+        }
+        const uintptr_t from = (uintptr_t)(file->data + start * file->frameBytes) & ~(page - 1);
+        const uintptr_t to = (uintptr_t)(file->data + (start + frames) * file->frameBytes);
+        posix_madvise((void*)from, (size_t)(to - from), POSIX_MADV_WILLNEED);
+    }
+}
+
+// Follow a read of [start, start + frames): contiguous reads mean playback
+static inline void pcm_file_track(PcmFile* file, int64_t start, int64_t frames) {
+    file->contiguousReads = start == file->nextFrame ? file->contiguousReads + 1 : 0;
+    file->nextFrame = start + frames;
+    if (file->contiguousReads >= PCM_SEQUENTIAL_READS) {
+        pcm_file_advise(file, PCM_ACCESS_SEQUENTIAL, start + frames, frames * PCM_PREFETCH_READS);
+    } else if (file->contiguousReads == 0 && start != 0) {
+        pcm_file_advise(file, PCM_ACCESS_RANDOM, 0, 0);
+    }
+}
+
+// ---- Unpack kernels: `count` interleaved samples to float ----
+
+static inline void pcm_unpack_scalar(const PcmFile* file, const uint8_t* p, int count, float* out) {
+    const int bytes = file->bytesPerSample;
+    for (int i = 0; i < count; i++, p += bytes) {
+        if (file->isFloat) {
+            uint64_t bits = 0;
+            for (int b = 0; b < bytes; b++) {
+                bits |= (uint64_t)p[file->bigEndian ? bytes - 1 - b : b] << (8 * b);
+            }
+            if (bytes == 4) {
+                const uint32_t bits32 = (uint32_t)bits;
+                float value;
+                memcpy(&value, &bits32, sizeof(value));
+                out[i] = value;
+            } else {
+                double value;
+                memcpy(&value, &bits, sizeof(value));
+                out[i] = (float)value;
+            }
+            continue;
+        }
+        if (bytes == 1 && !file->bigEndian) {
+            out[i] = ((float)p[0] - 128.0f) / 128.0f;  // 8-bit WAV is unsigned
+            continue;
+        }
+        uint32_t raw = 0;
+        for (int b = 0; b < bytes; b++) {
+            raw |= (uint32_t)p[file->bigEndian ? bytes - 1 - b : b] << (8 * b);
+        }
+        // Sign-extend from the container width, then scale by it
+        const int shift = 32 - 8 * bytes;
+        const int32_t value = (int32_t)(raw << shift) >> shift;
+        out[i] = (float)((double)value / (double)(1u << (8 * bytes - 1)));
+    }
+}
+
+#if PCM_X86
+
+static inline int pcm_unpack_sse2(const uint8_t* p, int count, int bytes, float* out) {
+    int i = 0;
+    if (bytes == 2) {
+        const __m128 scale = _mm_set1_ps(1.0f / 32768.0f);
+        for (; i + 8 <= count; i += 8) {
+            const __m128i v = _mm_loadu_si128((const __m128i*)(p + 2 * i));
+            // Sample in the high half of each lane, then an arithmetic shift sign-extends it
+            const __m128i lo = _mm_srai_epi32(_mm_unpacklo_epi16(v, v), 16);
+            const __m128i hi = _mm_srai_epi32(_mm_unpackhi_epi16(v, v), 16);
+            _mm_storeu_ps(out + i, _mm_mul_ps(_mm_cvtepi32_ps(lo), scale));
+            _mm_storeu_ps(out + i + 4, _mm_mul_ps(_mm_cvtepi32_ps(hi), scale));
+        }
+    } else if (bytes == 4) {
+        const __m128 scale = _mm_set1_ps(1.0f / 2147483648.0f);
+        for (; i + 4 <= count; i += 4) {
+            const __m128i v = _mm_loadu_si128((const __m128i*)(p + 4 * i));
+            _mm_storeu_ps(out + i, _mm_mul_ps(_mm_cvtepi32_ps(v), scale));
+        }
+    }
+    return i;
+}
+
+__attribute__((target("ssse3"))) static inline int pcm_unpack24_ssse3(const uint8_t* p, int count, float* out) {
+    // Each 3-byte sample into the top of a 32-bit lane; scaling by 2^-31 then
+    // gives value / 2^23 exactly
+    const __m128i shuffle = _mm_setr_epi8(-1, 0, 1, 2, -1, 3, 4, 5, -1, 6, 7, 8, -1, 9, 10, 11);
+    const __m128 scale = _mm_set1_ps(1.0f / 2147483648.0f);
+    int i = 0;
+    // 16-byte loads cover four samples plus four bytes of the next
+    for (; 3 * i + 16 <= 3 * count; i += 4) {
+        const __m128i v = _mm_shuffle_epi8(_mm_loadu_si128((const __m128i*)(p + 3 * i)), shuffle);
+        _mm_storeu_ps(out + i, _mm_mul_ps(_mm_cvtepi32_ps(v), scale));
+    }
+    return i;
+}
+
+static inline int pcm_has_ssse3(void) {
+    return __builtin_cpu_supports("ssse3");
+}
+
+#elif PCM_NEON
+
+static inline int pcm_unpack_neon(const uint8_t* p, int count, int bytes, float* out) {
+    int i = 0;
+    if (bytes == 2) {
+        for (; i + 8 <= count; i += 8) {
+            const int16x8_t v = vld1q_s16((const int16_t*)(p + 2 * i));
+            vst1q_f32(out + i, vcvtq_n_f32_s32(vmovl_s16(vget_low_s16(v)), 15));
+            vst1q_f32(out + i + 4, vcvtq_n_f32_s32(vmovl_s16(vget_high_s16(v)), 15));
+        }
+    } else if (bytes == 3) {
+        for (; i + 8 <= count; i += 8) {
+            // De-interleave the three bytes of eight samples, rebuild them in the top of 32-bit lanes
+            const uint8x8x3_t v = vld3_u8(p + 3 * i);
+            const uint16x8_t low = vshll_n_u8(v.val[0], 8);
+            const uint16x8_t high = vorrq_u16(vshll_n_u8(v.val[2], 8), vmovl_u8(v.val[1]));
+            const uint32x4_t a = vorrq_u32(vshll_n_u16(vget_low_u16(high), 16), vmovl_u16(vget_low_u16(low)));
+            const uint32x4_t b = vorrq_u32(vshll_n_u16(vget_high_u16(high), 16), vmovl_u16(vget_high_u16(low)));
+            vst1q_f32(out + i, vcvtq_n_f32_s32(vreinterpretq_s32_u32(a), 31));
+            vst1q_f32(out + i + 4, vcvtq_n_f32_s32(vreinterpretq_s32_u32(b), 31));
+        }
+    } else if (bytes == 4) {
+        for (; i + 4 <= count; i += 4) {
+            vst1q_f32(out + i, vcvtq_n_f32_s32(vld1q_s32((const int32_t*)(p + 4 * i)), 31));
+        }
+    }
+    return i;
+}
+
+#endif
+
+// Name of the integer unpack kernel on this machine
+static inline const char* pcm_kernel(void) {
+#if PCM_X86
+    return pcm_has_ssse3() ? "ssse3" : "sse2";
+#elif PCM_NEON
+    return "neon";
+#else
+    return "scalar";
+#endif
+}
+
+static inline void pcm_unpack(const PcmFile* file, const uint8_t* p, int count, float* out) {
+    int done = 0;
+    if (file->isFloat && file->bytesPerSample == 4 && !file->bigEndian) {
+        memcpy(out, p, (size_t)count * sizeof(float));
+        return;
+    }
+    if (!file->isFloat && !file->bigEndian) {
+#if PCM_X86
+        if (file->bytesPerSample == 3) {
+            done = pcm_has_ssse3() ? pcm_unpack24_ssse3(p, count, out) : 0;
+        } else {
+            done = pcm_unpack_sse2(p, count, file->bytesPerSample, out);
+        }
+#elif PCM_NEON
+        done = pcm_unpack_neon(p, count, file->bytesPerSample, out);
+#endif
+    }
+    pcm_unpack_scalar(file, p + (size_t)done * (size_t)file->bytesPerSample, count - done, out + done);
+}
+
+// ---- Reading ----
+
+// Interleaved native float32 frames from `start` straight from the mapping,
+// or NULL if the file needs conversion
+static inline const float* pcm_file_samples(const PcmFile* file, int64_t start) {
+    const uint8_t* p = file->data + start * file->frameBytes;
+    if (!file->isFloat || file->bytesPerSample != 4 || file->bigEndian || ((uintptr_t)p & 3) != 0) {
+        return NULL;
+    }
+    return (const float*)(const void*)p;
+}
+
+// Read `frames` frames from `start` into planar destinations. Returns the
+// number of frames read, clamped to the file length.
+static inline int64_t pcm_file_read(PcmFile* file, int64_t start, int64_t frames, float* const* dest) {
+    if (start < 0 || start >= file->frames || frames <= 0) {
+        return 0;
+    }
+    if (frames > file->frames - start) {
+        frames = file->frames - start;
+    }
+    pcm_file_track(file, start, frames);
+
+    const int channels = file->channelCount;
+    const uint8_t* p = file->data + start * file->frameBytes;
+    if (channels == 1) {
+        for (int64_t done = 0; done < frames; done += PCM_CHUNK_FRAMES) {
+            const int chunk = (int)(frames - done < PCM_CHUNK_FRAMES ? frames - done : PCM_CHUNK_FRAMES);
+            pcm_unpack(file, p + done * file->frameBytes, chunk, dest[0] + done);
+        }
+        return frames;
+    }
+
+    // Convert a chunk of interleaved samples, then spread it over the planes
+    float scratch[PCM_CHUNK_FRAMES * 8];
+    const int chunkFrames = channels <= 8 ? PCM_CHUNK_FRAMES : (PCM_CHUNK_FRAMES * 8) / channels;
+    for (int64_t done = 0; done < frames; done += chunkFrames) {
+        const int chunk = (int)(frames - done < chunkFrames ? frames - done : chunkFrames);
+        pcm_unpack(file, p + done * file->frameBytes, chunk * channels, scratch);
+        if (channels == 2) {
+            float* left = dest[0] + done;
+            float* right = dest[1] + done;
+            int i = 0;
+#if PCM_X86
+            for (; i + 4 <= chunk; i += 4) {
+                const __m128 a = _mm_loadu_ps(scratch + 2 * i);
+                const __m128 b = _mm_loadu_ps(scratch + 2 * i + 4);
+                _mm_storeu_ps(left + i, _mm_shuffle_ps(a, b, _MM_SHUFFLE(2, 0, 2, 0)));
+                _mm_storeu_ps(right + i, _mm_shuffle_ps(a, b, _MM_SHUFFLE(3, 1, 3, 1)));
+            }
+#elif PCM_NEON
+            for (; i + 4 <= chunk; i += 4) {
+                const float32x4x2_t v = vld2q_f32(scratch + 2 * i);
+                vst1q_f32(left + i, v.val[0]);
+                vst1q_f32(right + i, v.val[1]);
+            }
+#endif
+            for (; i < chunk; i++) {
+                left[i] = scratch[2 * i];
+                right[i] = scratch[2 * i + 1];
+            }
+            continue;
+        }
+        for (int c = 0; c < channels; c++) {
+            float* plane = dest[c] + done;
+            for (int i = 0; i < chunk; i++) {
+                plane[i] = scratch[i * channels + c];
+            }
+        }
+    }
+    return frames;
+}
+
+#endif  // MACAUDIO_PCMFILE_H
@@ -0,0 +1,323 @@
+// Multi-resolution waveform overview shared by both player backends.
+//
+// Level 0 holds min, max and sum of squares for every PEAKS_BASE_FRAMES
+// frames of each channel; every level above combines pairs of the one below,
+// up to a single entry. A range query walks the levels bottom-up like a
+// segment tree and combines at most two entries per level, so any segment at
+// any zoom is answered in O(log n) without reading audio. Ranges are resolved
+// to whole level-0 blocks (about 5 ms at 48 kHz).
+//
+// Pyramids are built incrementally (peaks_add, then peaks_finish) by a
+// background job and can be persisted as "<audio file>.peaks". The sidecar
+// stores level 0 only, in native byte order, with the source file's size and
+// modification time; upper levels are rebuilt from it on load.
+//
+// Header-only like meter.h: everything is static inline so the ObjC (.m) and
+// C++ headless translation units each get their own copy.
+
+#ifndef MACAUDIO_PEAKS_H
+#define MACAUDIO_PEAKS_H
+
+#include <float.h>
+#include <math.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "macaudio.h"
+
+#define PEAKS_BASE_FRAMES 256
+#define PEAKS_MAX_LEVELS 48
+#define PEAKS_FILE_MAGIC "MAPEAKS1"
+
+typedef struct {
+    float min;
+    float max;
+    float sumOfSquares;
+} PeakEntry;
+
+typedef struct {
+    int channelCount;
+    double sampleRate;
+    int64_t frames;                         // Frames added so far
+    int levelCount;                         // Valid once finished
+    int64_t levelLength[PEAKS_MAX_LEVELS];  // Entries per channel
+    PeakEntry* levels[PEAKS_MAX_LEVELS];    // levelLength[l] * channelCount, entry i of channel c at [i * channelCount + c]
+
+    // Builder state
+    int64_t capacity;    // Level-0 entries allocated per channel
+    int blockFrames;     // Frames in the open block
+    PeakEntry* block;    // Open block, channelCount entries
+    double* blockSums;   // Its sums of squares, accumulated in double
+} PeakPyramid;
+
+// Sidecar header; followed by levelLength[0] * channelCount PeakEntry values
+typedef struct {
+    char magic[8];
+    int32_t baseFrames;
+    int32_t channelCount;
+    double sampleRate;
+    int64_t frames;
+    int64_t sourceSize;
+    int64_t sourceModified;
+} PeakFileHeader;
+
+static inline void peaks_free(PeakPyramid* pyramid) {
+    for (int l = 0; l < PEAKS_MAX_LEVELS; l++) {
+        free(pyramid->levels[l]);
+    }
+    free(pyramid->block);
+    free(pyramid->blockSums);
+    memset(pyramid, 0, sizeof(*pyramid));
+}
+
+static inline void peaks_open_block(PeakPyramid* pyramid) {
+    for (int c = 0; c < pyramid->channelCount; c++) {
+        pyramid->block[c].min = FLT_MAX;
+        pyramid->block[c].max = -FLT_MAX;
+        pyramid->blockSums[c] = 0.0;
+    }
+    pyramid->blockFrames = 0;
+}
+
+// Start an empty pyramid; expectedFrames only sizes the first allocation.
+// Returns 0 when out of memory.
+static inline int peaks_init(PeakPyramid* pyramid, int channelCount, double sampleRate, int64_t expectedFrames) {
+    memset(pyramid, 0, sizeof(*pyramid));
+    pyramid->channelCount = channelCount;
+    pyramid->sampleRate = sampleRate;
+    pyramid->capacity = expectedFrames / PEAKS_BASE_FRAMES + 1;
+    pyramid->levels[0] = (PeakEntry*)malloc(sizeof(PeakEntry) * (size_t)pyramid->capacity * channelCount);
+    pyramid->block = (PeakEntry*)malloc(sizeof(PeakEntry) * channelCount);
+    pyramid->blockSums = (double*)malloc(sizeof(double) * channelCount);
+    if (!pyramid->levels[0] || !pyramid->block || !pyramid->blockSums) {
+        peaks_free(pyramid);
+        return 0;
+    }
+    peaks_open_block(pyramid);
+    return 1;
+}
+
+static inline int peaks_seal_block(PeakPyramid* pyramid) {
+    if (pyramid->levelLength[0] == pyramid->capacity) {
+        const int64_t capacity = pyramid->capacity * 2;
+        PeakEntry* grown = (PeakEntry*)realloc(pyramid->levels[0],
+                                               sizeof(PeakEntry) * (size_t)capacity * pyramid->channelCount);
+        if (!grown) {
+            return 0;
+        }
+        pyramid->levels[0] = grown;
+        pyramid->capacity = capacity;
+    }
+    PeakEntry* entry = pyramid->levels[0] + pyramid->levelLength[0] * pyramid->channelCount;
+    for (int c = 0; c < pyramid->channelCount; c++) {
+        entry[c] = pyramid->block[c];
+        entry[c].sumOfSquares = (float)pyramid->blockSums[c];
+    }
+    pyramid->levelLength[0]++;
+    peaks_open_block(pyramid);
+    return 1;
+}
+
+// Append planar frames. Returns 0 when out of memory.
+static inline int peaks_add(PeakPyramid* pyramid, const float* const* channels, int frames) {
+    for (int offset = 0; offset < frames;) {
+        int n = PEAKS_BASE_FRAMES - pyramid->blockFrames;
+        if (n > frames - offset) {
+            n = frames - offset;
+        }
+        for (int c = 0; c < pyramid->channelCount; c++) {
+            const float* samples = channels[c] + offset;
+            float lo = pyramid->block[c].min;
+            float hi = pyramid->block[c].max;
+            float sum = 0.0f;
+            for (int i = 0; i < n; i++) {
+                const float s = samples[i];
+                lo = s < lo ? s : lo;
+                hi = s > hi ? s : hi;
+                sum += s * s;
+            }
+            pyramid->block[c].min = lo;
+            pyramid->block[c].max = hi;
+            pyramid->blockSums[c] += sum;
+        }
+        pyramid->blockFrames += n;
+        pyramid->frames += n;
+        offset += n;
+        if (pyramid->blockFrames == PEAKS_BASE_FRAMES && !peaks_seal_block(pyramid)) {
+            return 0;
+        }
+    }
+    return 1;
+}
+
+static inline void peaks_combine(PeakEntry* into, const PeakEntry* entry) {
+    into->min = entry->min < into->min ? entry->min : into->min;
+    into->max = entry->max > into->max ? entry->max : into->max;
+    into->sumOfSquares += entry->sumOfSquares;
+}
+
+// Build the upper levels from level 0. Returns 0 when out of memory.
+static inline int peaks_build_levels(PeakPyramid* pyramid) {
+    const int channels = pyramid->channelCount;
+    int l = 0;
+    while (pyramid->levelLength[l] > 1 && l + 1 < PEAKS_MAX_LEVELS) {
+        const int64_t length = (pyramid->levelLength[l] + 1) / 2;
+        PeakEntry* level = (PeakEntry*)malloc(sizeof(PeakEntry) * (size_t)length * channels);
+        if (!level) {
+            return 0;
+        }
+        const PeakEntry* below = pyramid->levels[l];
+        for (int64_t i = 0; i < length; i++) {
+            for (int c = 0; c < channels; c++) {
+                PeakEntry entry = below[2 * i * channels + c];
+                if (2 * i + 1 < pyramid->levelLength[l]) {
+                    peaks_combine(&entry, &below[(2 * i + 1) * channels + c]);
+                }
+                level[i * channels + c] = entry;
+            }
+        }
+        l++;
+        pyramid->levels[l] = level;
+        pyramid->levelLength[l] = length;
+    }
+    pyramid->levelCount = l + 1;
+    return 1;
+}
+
+// Seal the last partial block and build the upper levels
+static inline int peaks_finish(PeakPyramid* pyramid) {
+    if (pyramid->blockFrames > 0 && !peaks_seal_block(pyramid)) {
+        return 0;
+    }
+    return peaks_build_levels(pyramid);
+}
+
+// Min, max and RMS of frames [start, end) per channel (out: channelCount entries)
+static inline void peaks_query(const PeakPyramid* pyramid, int64_t start, int64_t end, PeakColumn* out) {
+    const int channels = pyramid->channelCount;
+    if (start < 0) {
+        start = 0;
+    }
+    if (end > pyramid->frames) {
+        end = pyramid->frames;
+    }
+    if (end <= start || pyramid->levelCount == 0) {
+        memset(out, 0, sizeof(PeakColumn) * channels);
+        return;
+    }
+
+    const int64_t firstBlock = start / PEAKS_BASE_FRAMES;
+    const int64_t lastBlock = (end + PEAKS_BASE_FRAMES - 1) / PEAKS_BASE_FRAMES;  // Exclusive
+    const int64_t coveredEnd = lastBlock * PEAKS_BASE_FRAMES < pyramid->frames ? lastBlock * PEAKS_BASE_FRAMES
+                                                                              : pyramid->frames;
+    const double covered = (double)(coveredEnd - firstBlock * PEAKS_BASE_FRAMES);
+
+    for (int c = 0; c < channels; c++) {
+        PeakEntry total = {FLT_MAX, -FLT_MAX, 0.0f};
+        double sum = 0.0;
+        int64_t first = firstBlock;
+        int64_t last = lastBlock;
+        for (int l = 0; first < last && l < pyramid->levelCount; l++) {
+            const PeakEntry* level = pyramid->levels[l];
+            if (first & 1) {
+                peaks_combine(&total, &level[first * channels + c]);
+                sum += level[first * channels + c].sumOfSquares;
+                first++;
+            }
+            if (last & 1) {
+                last--;
+                peaks_combine(&total, &level[last * channels + c]);
+                sum += level[last * channels + c].sumOfSquares;
+            }
+            first >>= 1;
+            last >>= 1;
+        }
+        out[c].min = total.min;
+        out[c].max = total.max;
+        out[c].rms = (float)sqrt(sum / covered);
+    }
+}
+
+// Split [start, end) into `columns` equal spans; out holds columns * channelCount entries
+static inline void peaks_query_columns(const PeakPyramid* pyramid, int64_t start, int64_t end, int columns,
+                                       PeakColumn* out) {
+    const double span = (double)(end - start) / columns;
+    for (int i = 0; i < columns; i++) {
+        const int64_t from = start + (int64_t)(span * i);
+        const int64_t to = i + 1 == columns ? end : start + (int64_t)(span * (i + 1));
+        peaks_query(pyramid, from, to, out + (size_t)i * pyramid->channelCount);
+    }
+}
+
+// Write level 0 and the source identity to `path` (via a temporary file).
+// Returns 0 on failure.
+static inline int peaks_save(const PeakPyramid* pyramid, const char* path, int64_t sourceSize,
+                             int64_t sourceModified) {
+    const size_t pathLength = strlen(path);
+    char* temporary = (char*)malloc(pathLength + 5);
+    if (!temporary) {
+        return 0;
+    }
+    memcpy(temporary, path, pathLength);
+    memcpy(temporary + pathLength, ".tmp", 5);
+
+    FILE* file = fopen(temporary, "wb");
+    if (!file) {
+        free(temporary);
+        return 0;
+    }
+    PeakFileHeader header;
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, PEAKS_FILE_MAGIC, sizeof(header.magic));
+    header.baseFrames = PEAKS_BASE_FRAMES;
+    header.channelCount = pyramid->channelCount;
+    header.sampleRate = pyramid->sampleRate;
+    header.frames = pyramid->frames;
+    header.sourceSize = sourceSize;
+    header.sourceModified = sourceModified;
+    const size_t entries = (size_t)pyramid->levelLength[0] * pyramid->channelCount;
+    int ok = fwrite(&header, sizeof(header), 1, file) == 1 &&
+             fwrite(pyramid->levels[0], sizeof(PeakEntry), entries, file) == entries;
+    ok = fclose(file) == 0 && ok;
+    ok = ok && rename(temporary, path) == 0;
+    if (!ok) {
+        remove(temporary);
+    }
+    free(temporary);
+    return ok;
+}
+
+// Load a sidecar written for this exact source. Returns 0 (leaving the
+// pyramid empty) if it is missing, stale or damaged.
+static inline int peaks_load(PeakPyramid* pyramid, const char* path, int channelCount, double sampleRate,
+                             int64_t frames, int64_t sourceSize, int64_t sourceModified) {
+    memset(pyramid, 0, sizeof(*pyramid));
+    FILE* file = fopen(path, "rb");
+    if (!file) {
+        return 0;
+    }
+    PeakFileHeader header;
+    const int64_t entries = (frames + PEAKS_BASE_FRAMES - 1) / PEAKS_BASE_FRAMES;
+    if (fread(&header, sizeof(header), 1, file) != 1 || memcmp(header.magic, PEAKS_FILE_MAGIC, 8) != 0 ||
+        header.baseFrames != PEAKS_BASE_FRAMES || header.channelCount != channelCount ||
+        header.sampleRate != sampleRate || header.frames != frames || header.sourceSize != sourceSize ||
+        header.sourceModified != sourceModified || !peaks_init(pyramid, channelCount, sampleRate, frames)) {
+        fclose(file);
+        return 0;
+    }
+    const size_t count = (size_t)entries * channelCount;
+    const int ok = fread(pyramid->levels[0], sizeof(PeakEntry), count, file) == count && fgetc(file) == EOF;
+    fclose(file);
+    pyramid->levelLength[0] = entries;
+    pyramid->frames = frames;
+    pyramid->blockFrames = 0;
+    if (!ok || !peaks_build_levels(pyramid)) {
+        peaks_free(pyramid);
+        return 0;
+    }
+    return 1;
+}
+
+#endif  // MACAUDIO_PEAKS_H
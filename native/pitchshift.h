@@ -0,0 +1,675 @@
+// Phase vocoder pitch shift, shared by both backends.
+//
+// Each channel runs a short-time Fourier transform with a periodic Hann
+// window of fftSize frames at a hop of fftSize / overlap. Every hop the newest
+// frame is analysed and its spectrum split into the regions of influence of
+// its peaks (from the lowest bin between two peaks to the next). Each region
+// moves rigidly by the whole number of bins nearest its partial's shift, so
+// the bins around a peak keep the phase relations the analysis found
+// (identity phase locking, Laroche & Dolson), and is rotated by a phase that
+// grows every hop by the partial's shift, so the partial comes out at exactly
+// ratio times its frequency, measured from its phase advance since the last
+// frame. The frame is transformed back, windowed again and overlap-added;
+// output runs fftSize frames behind the input.
+//
+// With formant preservation each bin is also scaled by the spectral envelope
+// at its destination over the envelope at its source, so a voice's resonances
+// stay put while its harmonics move. The envelope is the log magnitude with
+// each region held at its peak, smoothed by cepstral liftering at 1.5 ms:
+// smoothing the bins as they are would trace the valleys between harmonics.
+//
+// At ratio 1, once the rotations have wound back to none, the frame is
+// overlap-added as it was analysed without an FFT, so an unshifted signal
+// comes out delayed and otherwise unchanged. Once all it holds went through
+// that way, what it plays next is raw input it already has, and a caller may
+// play that and route around it (pitchshift_read_held).
+//
+// The FFT is a radix-2 complex transform of fftSize / 2 points over the
+// even/odd samples as in spectrum.h, with per-stage twiddle tables so every
+// stage whose butterflies span a vector runs on SSE2, AVX2+FMA or NEON
+// (picked like resampler.h's kernels).
+//
+// Header-only like resampler.h; builds as C (macOS backend) and C++
+// (headless). Nothing allocates after pitchshift_init.
+
+#ifndef MACAUDIO_PITCHSHIFT_H
+#define MACAUDIO_PITCHSHIFT_H
+
+#include <math.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "macaudio.h"
+#include "resampler.h"
+
+#define PITCH_SHIFT_MAX_CENTS 2400.0f
+#define PITCH_SHIFT_FORMANT_SECONDS 0.0015
+#define PITCH_SHIFT_PEAK_FLOOR 1e-8f  // Peaks count from -80 dB below the frame's loudest bin
+#define PITCH_SHIFT_UNWIND_BINS 0.05  // Frequency offset a partial may take to return to no rotation
+
+struct PitchShifter {
+    int channelCount;
+    int quality;
+    int fftSize;
+    int half;            // Complex FFT size
+    int bins;            // half + 1
+    int hop;
+    int lifter;          // Cepstral coefficients kept for the envelope
+    int kernel;          // RESAMPLER_KERNEL_* for the butterflies
+    float gain;          // 1 over the overlap-added squared windows
+    bool preserveFormants;  // The options given to pitchshift_create, for pitchshift_process
+    float* memory;       // Every float array below
+    int* bitReverse;     // half
+    int* peaks;          // Scratch, bins
+    int* bounds;         // Scratch, first bin of each peak's region, bins + 1
+    float* window;       // fftSize, periodic Hann
+    float* twiddleRe;    // half: the stage spanning s at [s, 2s), e^(-i pi k / s)
+    float* twiddleIm;
+    float* unpackRe;     // half: e^(-2 pi i k / fftSize)
+    float* unpackIm;
+    float* re;           // Scratch, half
+    float* im;
+    float* frame;        // Scratch, fftSize
+    float* spectrumRe;   // Scratch, bins
+    float* spectrumIm;
+    float* shiftedRe;
+    float* shiftedIm;
+    float* power;
+    float* envelope;     // Natural log amplitude
+    float* rotated;      // Rotation given to each bin this frame
+    float** input;       // Per channel, fftSize: the newest hop fills the end
+    float** output;      // Per channel, hop: finished output being read
+    float** overlap;     // Per channel overlap-add accumulator, fftSize
+    float** previousRe;  // Per channel spectrum of the last frame, bins
+    float** previousIm;
+    float** rotation;    // Per channel rotation of each bin last frame, bins
+    bool* analysed;      // Per channel: previous* hold the last frame
+    bool* settled;       // Per channel: no rotation left, ratio 1 may skip the FFT
+    int rover;           // Frames of the current hop taken
+    int unshifted;       // Frames run unrotated at 0 cents since the last shifted hop, up to fftSize
+};
+
+// FFT size and overlap of a PITCH_SHIFT_QUALITY_* tier
+static inline bool pitchshift_tier(int quality, int* fftSize, int* overlap) {
+    switch (quality) {
+        case PITCH_SHIFT_QUALITY_LOW:
+            *fftSize = 1024;
+            *overlap = 4;
+            return true;
+        case PITCH_SHIFT_QUALITY_MEDIUM:
+            *fftSize = 2048;
+            *overlap = 4;
+            return true;
+        case PITCH_SHIFT_QUALITY_HIGH:
+            *fftSize = 2048;
+            *overlap = 8;
+            return true;
+        case PITCH_SHIFT_QUALITY_BEST:
+            *fftSize = 4096;
+            *overlap = 8;
+            return true;
+        default:
+            return false;
+    }
+}
+
+static inline void pitchshift_free(PitchShifter* s) {
+    free(s->memory);
+    free(s->bitReverse);
+    free(s->peaks);
+    free(s->bounds);
+    free(s->input);
+    free(s->analysed);
+    memset(s, 0, sizeof(*s));
+}
+
+// Forget the signal: silence in, silence out for the next fftSize frames
+static inline void pitchshift_clear(PitchShifter* s) {
+    for (int c = 0; c < s->channelCount; c++) {
+        memset(s->input[c], 0, (size_t)s->fftSize * sizeof(float));
+        memset(s->output[c], 0, (size_t)s->hop * sizeof(float));
+        memset(s->overlap[c], 0, (size_t)s->fftSize * sizeof(float));
+        memset(s->rotation[c], 0, (size_t)s->bins * sizeof(float));
+        s->analysed[c] = false;
+        s->settled[c] = true;
+    }
+    s->rover = 0;
+    s->unshifted = s->fftSize;
+}
+
+// fftSize 0 takes the quality's own
+static inline const char* pitchshift_init(PitchShifter* s, double sampleRate, int channelCount, int quality,
+                                          int fftSize) {
+    memset(s, 0, sizeof(*s));
+    int n = 0;
+    int overlap = 0;
+    if (!(sampleRate > 0.0)) {
+        return "Sample rate must be positive";
+    }
+    if (channelCount < 1 || channelCount > PITCH_SHIFT_MAX_CHANNELS) {
+        return "Channel count must be between 1 and 64";
+    }
+    if (!pitchshift_tier(quality, &n, &overlap)) {
+        return "Unknown pitch shift quality";
+    }
+    if (fftSize != 0) {
+        if (fftSize < PITCH_SHIFT_MIN_FFT || fftSize > PITCH_SHIFT_MAX_FFT || (fftSize & (fftSize - 1)) != 0) {
+            return "FFT size must be a power of two between 512 and 8192";
+        }
+        n = fftSize;
+    }
+
+    const int half = n / 2;
+    const int bins = half + 1;
+    s->channelCount = channelCount;
+    s->quality = quality;
+    s->fftSize = n;
+    s->half = half;
+    s->bins = bins;
+    s->hop = n / overlap;
+    s->gain = 8.0f / (3.0f * (float)overlap);  // Squared periodic Hann at 4x or more sums to 3/8 per window
+    s->kernel = resampler_pick_kernel();
+    s->lifter = (int)lround(sampleRate * PITCH_SHIFT_FORMANT_SECONDS);
+    s->lifter = s->lifter < 2 ? 2 : s->lifter > half / 2 ? half / 2 : s->lifter;
+
+    const size_t shared = (size_t)2 * n + (size_t)8 * half + (size_t)7 * bins;
+    const size_t lane = (size_t)2 * n + (size_t)s->hop + (size_t)3 * bins;
+    s->memory = (float*)calloc(shared + lane * (size_t)channelCount, sizeof(float));
+    s->bitReverse = (int*)malloc((size_t)half * sizeof(int));
+    s->peaks = (int*)malloc((size_t)bins * sizeof(int));
+    s->bounds = (int*)malloc((size_t)(bins + 1) * sizeof(int));
+    s->input = (float**)malloc((size_t)channelCount * 6 * sizeof(float*));
+    s->analysed = (bool*)calloc((size_t)channelCount * 2, sizeof(bool));
+    if (!s->memory || !s->bitReverse || !s->peaks || !s->bounds || !s->input || !s->analysed) {
+        pitchshift_free(s);
+        return "Failed to allocate pitch shifter";
+    }
+
+    float* next = s->memory;
+#define PITCH_SHIFT_TAKE(field, count) (field = next, next += (count))
+    PITCH_SHIFT_TAKE(s->window, n);
+    PITCH_SHIFT_TAKE(s->frame, n);
+    PITCH_SHIFT_TAKE(s->twiddleRe, half);
+    PITCH_SHIFT_TAKE(s->twiddleIm, half);
+    PITCH_SHIFT_TAKE(s->unpackRe, half);
+    PITCH_SHIFT_TAKE(s->unpackIm, half);
+    PITCH_SHIFT_TAKE(s->re, half);
+    PITCH_SHIFT_TAKE(s->im, half);
+    next += 2 * half;  // Keeps the per-bin arrays apart from the FFT scratch
+    PITCH_SHIFT_TAKE(s->spectrumRe, bins);
+    PITCH_SHIFT_TAKE(s->spectrumIm, bins);
+    PITCH_SHIFT_TAKE(s->shiftedRe, bins);
+    PITCH_SHIFT_TAKE(s->shiftedIm, bins);
+    PITCH_SHIFT_TAKE(s->power, bins);
+    PITCH_SHIFT_TAKE(s->envelope, bins);
+    PITCH_SHIFT_TAKE(s->rotated, bins);
+    s->settled = s->analysed + channelCount;
+    s->output = s->input + channelCount;
+    s->overlap = s->output + channelCount;
+    s->previousRe = s->overlap + channelCount;
+    s->previousIm = s->previousRe + channelCount;
+    s->rotation = s->previousIm + channelCount;
+    for (int c = 0; c < channelCount; c++) {
+        PITCH_SHIFT_TAKE(s->input[c], n);
+        PITCH_SHIFT_TAKE(s->overlap[c], n);
+        PITCH_SHIFT_TAKE(s->output[c], s->hop);
+        PITCH_SHIFT_TAKE(s->previousRe[c], bins);
+        PITCH_SHIFT_TAKE(s->previousIm[c], bins);
+        PITCH_SHIFT_TAKE(s->rotation[c], bins);
+    }
+#undef PITCH_SHIFT_TAKE
+
+    for (int i = 0; i < n; i++) {
+        s->window[i] = (float)(0.5 - 0.5 * cos(2.0 * M_PI * i / n));
+    }
+    int bits = 0;
+    while ((1 << bits) < half) {
+        bits++;
+    }
+    for (int i = 0; i < half; i++) {
+        int reversed = 0;
+        for (int b = 0; b < bits; b++) {
+            reversed |= ((i >> b) & 1) << (bits - 1 - b);
+        }
+        s->bitReverse[i] = reversed;
+    }
+    for (int span = 1; span < half; span <<= 1) {
+        for (int k = 0; k < span; k++) {
+            s->twiddleRe[span + k] = (float)cos(M_PI * k / span);
+            s->twiddleIm[span + k] = (float)-sin(M_PI * k / span);
+        }
+    }
+    for (int k = 0; k < half; k++) {
+        s->unpackRe[k] = (float)cos(2.0 * M_PI * k / n);
+        s->unpackIm[k] = (float)-sin(2.0 * M_PI * k / n);
+    }
+    pitchshift_clear(s);
+    return NULL;
+}
+
+// One radix-2 stage over `half` points: butterflies `span` apart, with the
+// stage's twiddles at tw[span + k]
+static inline void pitchshift_stage_scalar(float* re, float* im, const float* twRe, const float* twIm, int half,
+                                           int span) {
+    for (int start = 0; start < half; start += 2 * span) {
+        float* ar = re + start;
+        float* ai = im + start;
+        float* br = ar + span;
+        float* bi = ai + span;
+        for (int k = 0; k < span; k++) {
+            const float wr = twRe[span + k];
+            const float wi = twIm[span + k];
+            const float tr = br[k] * wr - bi[k] * wi;
+            const float ti = br[k] * wi + bi[k] * wr;
+            br[k] = ar[k] - tr;
+            bi[k] = ai[k] - ti;
+            ar[k] += tr;
+            ai[k] += ti;
+        }
+    }
+}
+
+#if RESAMPLER_X86
+
+static inline void pitchshift_stage_sse2(float* re, float* im, const float* twRe, const float* twIm, int half,
+                                         int span) {
+    for (int start = 0; start < half; start += 2 * span) {
+        float* ar = re + start;
+        float* ai = im + start;
+        float* br = ar + span;
+        float* bi = ai + span;
+        for (int k = 0; k < span; k += 4) {
+            const __m128 wr = _mm_loadu_ps(twRe + span + k);
+            const __m128 wi = _mm_loadu_ps(twIm + span + k);
+            const __m128 xr = _mm_loadu_ps(br + k);
+            const __m128 xi = _mm_loadu_ps(bi + k);
+            const __m128 tr = _mm_sub_ps(_mm_mul_ps(xr, wr), _mm_mul_ps(xi, wi));
+            const __m128 ti = _mm_add_ps(_mm_mul_ps(xr, wi), _mm_mul_ps(xi, wr));
+            const __m128 yr = _mm_loadu_ps(ar + k);
+            const __m128 yi = _mm_loadu_ps(ai + k);
+            _mm_storeu_ps(br + k, _mm_sub_ps(yr, tr));
+            _mm_storeu_ps(bi + k, _mm_sub_ps(yi, ti));
+            _mm_storeu_ps(ar + k, _mm_add_ps(yr, tr));
+            _mm_storeu_ps(ai + k, _mm_add_ps(yi, ti));
+        }
+    }
+}
+
+__attribute__((target("avx2,fma"))) static inline void pitchshift_stage_avx2(float* re, float* im, const float* twRe,
+                                                                             const float* twIm, int half, int span) {
+    for (int start = 0; start < half; start += 2 * span) {
+        float* ar = re + start;
+        float* ai = im + start;
+        float* br = ar + span;
+        float* bi = ai + span;
+        for (int k = 0; k < span; k += 8) {
+            const __m256 wr = _mm256_loadu_ps(twRe + span + k);
+            const __m256 wi = _mm256_loadu_ps(twIm + span + k);
+            const __m256 xr = _mm256_loadu_ps(br + k);
+            const __m256 xi = _mm256_loadu_ps(bi + k);
+            const __m256 tr = _mm256_fmsub_ps(xr, wr, _mm256_mul_ps(xi, wi));
+            const __m256 ti = _mm256_fmadd_ps(xr, wi, _mm256_mul_ps(xi, wr));
+            const __m256 yr = _mm256_loadu_ps(ar + k);
+            const __m256 yi = _mm256_loadu_ps(ai + k);
+            _mm256_storeu_ps(br + k, _mm256_sub_ps(yr, tr));
+            _mm256_storeu_ps(bi + k, _mm256_sub_ps(yi, ti));
+            _mm256_storeu_ps(ar + k, _mm256_add_ps(yr, tr));
+            _mm256_storeu_ps(ai + k, _mm256_add_ps(yi, ti));
+        }
+    }
+}
+
+#elif RESAMPLER_NEON
+
+static inline void pitchshift_stage_neon(float* re, float* im, const float* twRe, const float* twIm, int half,
+                                         int span) {
+    for (int start = 0; start < half; start += 2 * span) {
+        float* ar = re + start;
+        float* ai = im + start;
+        float* br = ar + span;
+        float* bi = ai + span;
+        for (int k = 0; k < span; k += 4) {
+            const float32x4_t wr = vld1q_f32(twRe + span + k);
+            const float32x4_t wi = vld1q_f32(twIm + span + k);
+            const float32x4_t xr = vld1q_f32(br + k);
+            const float32x4_t xi = vld1q_f32(bi + k);
+            const float32x4_t tr = vfmsq_f32(vmulq_f32(xr, wr), xi, wi);
+            const float32x4_t ti = vfmaq_f32(vmulq_f32(xr, wi), xi, wr);
+            const float32x4_t yr = vld1q_f32(ar + k);
+            const float32x4_t yi = vld1q_f32(ai + k);
+            vst1q_f32(br + k, vsubq_f32(yr, tr));
+            vst1q_f32(bi + k, vsubq_f32(yi, ti));
+            vst1q_f32(ar + k, vaddq_f32(yr, tr));
+            vst1q_f32(ai + k, vaddq_f32(yi, ti));
+        }
+    }
+}
+
+#endif
+
+// In-place complex FFT of the bit-reversed re/im
+static inline void pitchshift_transform(const PitchShifter* s, float* re, float* im) {
+    for (int span = 1; span < s->half; span <<= 1) {
+#if RESAMPLER_X86
+        if (span >= 8 && s->kernel == RESAMPLER_KERNEL_AVX2) {
+            pitchshift_stage_avx2(re, im, s->twiddleRe, s->twiddleIm, s->half, span);
+            continue;
+        }
+        if (span >= 4 && s->kernel != RESAMPLER_KERNEL_SCALAR) {
+            pitchshift_stage_sse2(re, im, s->twiddleRe, s->twiddleIm, s->half, span);
+            continue;
+        }
+#elif RESAMPLER_NEON
+        if (span >= 4 && s->kernel == RESAMPLER_KERNEL_NEON) {
+            pitchshift_stage_neon(re, im, s->twiddleRe, s->twiddleIm, s->half, span);
+            continue;
+        }
+#endif
+        pitchshift_stage_scalar(re, im, s->twiddleRe, s->twiddleIm, s->half, span);
+    }
+}
+
+// fftSize real samples to bins 0 ... half
+static inline void pitchshift_forward(PitchShifter* s, const float* x, float* outRe, float* outIm) {
+    const int half = s->half;
+    float* re = s->re;
+    float* im = s->im;
+    for (int i = 0; i < half; i++) {
+        const int j = s->bitReverse[i];
+        re[j] = x[2 * i];
+        im[j] = x[2 * i + 1];
+    }
+    pitchshift_transform(s, re, im);
+
+    // X[k] = E[k] + W^k O[k] with E = (Z[k] + Z*[half - k]) / 2, O = (Z[k] - Z*[half - k]) / 2i
+    for (int k = 0; k < half; k++) {
+        const int m = (half - k) & (half - 1);
+        const float er = 0.5f * (re[k] + re[m]);
+        const float ei = 0.5f * (im[k] - im[m]);
+        const float or_ = 0.5f * (im[k] + im[m]);
+        const float oi = -0.5f * (re[k] - re[m]);
+        outRe[k] = er + s->unpackRe[k] * or_ - s->unpackIm[k] * oi;
+        outIm[k] = ei + s->unpackRe[k] * oi + s->unpackIm[k] * or_;
+    }
+    outRe[half] = re[0] - im[0];
+    outIm[half] = 0.0f;
+}
+
+// Bins 0 ... half back to fftSize real samples; the imaginary parts of DC and
+// Nyquist are ignored
+static inline void pitchshift_inverse(PitchShifter* s, const float* inRe, const float* inIm, float* x) {
+    const int half = s->half;
+    float* re = s->re;
+    float* im = s->im;
+
+    // Z[k] = E[k] + i O[k] with E = (X[k] + X*[half - k]) / 2, O = (X[k] - X*[half - k]) W^-k / 2;
+    // the inverse runs forward on the conjugate
+    for (int k = 0; k < half; k++) {
+        const float ar = inRe[k];
+        const float ai = k ? inIm[k] : 0.0f;
+        const float br = inRe[half - k];
+        const float bi = k ? -inIm[half - k] : 0.0f;
+        const float er = 0.5f * (ar + br);
+        const float ei = 0.5f * (ai + bi);
+        const float dr = 0.5f * (ar - br);
+        const float di = 0.5f * (ai - bi);
+        const float or_ = dr * s->unpackRe[k] + di * s->unpackIm[k];
+        const float oi = di * s->unpackRe[k] - dr * s->unpackIm[k];
+        const int j = s->bitReverse[k];
+        re[j] = er - oi;
+        im[j] = -(ei + or_);
+    }
+    pitchshift_transform(s, re, im);
+
+    const float scale = 1.0f / (float)half;
+    for (int i = 0; i < half; i++) {
+        x[2 * i] = re[i] * scale;
+        x[2 * i + 1] = -im[i] * scale;
+    }
+}
+
+// Natural log spectral envelope of `power` into s->envelope: the real
+// cepstrum cut after s->lifter quefrencies
+static inline void pitchshift_envelope(PitchShifter* s, const float* power) {
+    const int n = s->fftSize;
+    const int half = s->half;
+    float* logs = s->frame;
+    for (int k = 0; k <= half; k++) {
+        logs[k] = 0.5f * logf(power[k] + 1e-20f);
+    }
+    for (int k = half + 1; k < n; k++) {
+        logs[k] = logs[n - k];
+    }
+    // Even and real, so its transform is the cepstrum (times n) and real
+    float* cepstrum = s->shiftedRe;
+    float* unused = s->shiftedIm;
+    pitchshift_forward(s, logs, cepstrum, unused);
+    for (int k = 0; k <= half; k++) {
+        unused[k] = 0.0f;
+        if (k >= s->lifter) {
+            cepstrum[k] = 0.0f;
+        }
+    }
+    pitchshift_inverse(s, cepstrum, unused, logs);
+    memcpy(s->envelope, logs, (size_t)s->bins * sizeof(float));
+}
+
+// Level that overlap-adding squared Hann windows leaves of a partial running
+// `offset` bins off the frequency its frame was built at
+static inline double pitchshift_window_loss(double offset) {
+    if (fabs(offset) < 1e-6) {
+        return 1.0;
+    }
+    const double sum = 0.375 / offset - 0.25 * (1.0 / (offset - 1.0) + 1.0 / (offset + 1.0)) +
+                       0.0625 * (1.0 / (offset - 2.0) + 1.0 / (offset + 2.0));
+    return sin(M_PI * offset) / M_PI * sum / 0.375;
+}
+
+// Shift channel c's newest frame by `ratio` into its overlap-add accumulator
+static inline void pitchshift_shift_frame(PitchShifter* s, int c, double ratio, bool formants) {
+    const int n = s->fftSize;
+    const int bins = s->bins;
+    float* re = s->spectrumRe;
+    float* im = s->spectrumIm;
+    float* power = s->power;
+    for (int i = 0; i < n; i++) {
+        s->frame[i] = s->input[c][i] * s->window[i];
+    }
+    pitchshift_forward(s, s->frame, re, im);
+    float loudest = 0.0f;
+    for (int k = 0; k < bins; k++) {
+        power[k] = re[k] * re[k] + im[k] * im[k];
+        loudest = power[k] > loudest ? power[k] : loudest;
+    }
+
+    // Peaks, and each region from the lowest bin after the previous peak
+    const float threshold = loudest * PITCH_SHIFT_PEAK_FLOOR;
+    int count = 0;
+    for (int k = 1; k + 1 < bins; k++) {
+        if (power[k] > threshold && power[k] > power[k - 1] && power[k] >= power[k + 1]) {
+            s->peaks[count++] = k;
+        }
+    }
+    s->bounds[0] = 0;
+    for (int i = 1; i < count; i++) {
+        int lowest = s->peaks[i - 1] + 1;
+        for (int k = lowest + 1; k <= s->peaks[i]; k++) {
+            lowest = power[k] < power[lowest] ? k : lowest;
+        }
+        s->bounds[i] = lowest;
+    }
+    s->bounds[count] = bins;
+    if (formants) {
+        float* held = s->rotated;
+        memcpy(held, power, (size_t)bins * sizeof(float));
+        for (int i = 0; i < count; i++) {
+            for (int k = s->bounds[i]; k < s->bounds[i + 1]; k++) {
+                held[k] = power[s->peaks[i]];
+            }
+        }
+        pitchshift_envelope(s, held);
+    }
+
+    memset(s->shiftedRe, 0, (size_t)bins * sizeof(float));
+    memset(s->shiftedIm, 0, (size_t)bins * sizeof(float));
+    memset(s->rotated, 0, (size_t)bins * sizeof(float));
+    // The loudest bin shifted onto each target, whose rotation the target keeps
+    float* claimed = s->frame;
+    memset(claimed, 0, (size_t)bins * sizeof(float));
+    const double advance = 2.0 * M_PI * s->hop / n;  // Phase advance per hop of one bin's frequency
+    const float* previousRe = s->previousRe[c];
+    const float* previousIm = s->previousIm[c];
+    bool wound = false;
+    for (int i = 0; i < count; i++) {
+        const int peak = s->peaks[i];
+
+        // The partial's frequency in bins: from its phase advance, or on a
+        // first frame from the parabola through the log magnitudes
+        double frequency;
+        if (s->analysed[c]) {
+            const double crossRe = (double)re[peak] * previousRe[peak] + (double)im[peak] * previousIm[peak];
+            const double crossIm = (double)im[peak] * previousRe[peak] - (double)re[peak] * previousIm[peak];
+            double deviation = atan2(crossIm, crossRe) - advance * peak;
+            deviation -= 2.0 * M_PI * floor(deviation / (2.0 * M_PI) + 0.5);
+            frequency = peak + deviation / advance;
+        } else {
+            const double a = log(power[peak - 1] + 1e-30);
+            const double b = log(power[peak] + 1e-30);
+            const double g = log(power[peak + 1] + 1e-30);
+            const double curve = a - 2.0 * b + g;
+            frequency = peak + (curve < 0.0 ? 0.5 * (a - g) / curve : 0.0);
+        }
+
+        // The rotation holds at the middle of the frame, where the
+        // overlap-add weighs it most, so a new shift bends the phase rather
+        // than stepping it. Back at ratio 1 it winds down to none.
+        const double shift = (ratio - 1.0) * frequency;
+        const int delta = (int)lround(shift);
+        const int target = peak + delta < 0 ? 0 : peak + delta >= bins ? bins - 1 : peak + delta;
+        double theta = s->rotation[c][target];
+        if (ratio == 1.0) {
+            const double unwind = advance * PITCH_SHIFT_UNWIND_BINS;
+            theta -= theta > unwind ? unwind : theta < -unwind ? -unwind : theta;
+        } else {
+            theta += advance * shift;
+            theta -= 2.0 * M_PI * floor(theta / (2.0 * M_PI) + 0.5);
+        }
+        wound = wound || theta != 0.0;
+        // Moving delta bins turns the middle of the frame by pi * delta; the
+        // region runs (shift - delta) bins off the partial's frequency, which
+        // costs the overlap-add a little of its level, made up here
+        const double turn = theta + M_PI * delta;
+        const double level = 1.0 / pitchshift_window_loss(shift - delta);
+        const float cs = (float)(cos(turn) * level);
+        const float sn = (float)(sin(turn) * level);
+
+        const int from = s->bounds[i] + delta < 0 ? -delta : s->bounds[i];
+        const int to = s->bounds[i + 1] + delta > bins ? bins - delta : s->bounds[i + 1];
+        for (int k = from; k < to; k++) {
+            const int t = k + delta;
+            const float g = formants ? expf(s->envelope[t] - s->envelope[k]) : 1.0f;
+            s->shiftedRe[t] += g * (re[k] * cs - im[k] * sn);
+            s->shiftedIm[t] += g * (re[k] * sn + im[k] * cs);
+            if (power[k] >= claimed[t]) {
+                claimed[t] = power[k];
+                s->rotated[t] = (float)theta;
+            }
+        }
+    }
+
+    pitchshift_inverse(s, s->shiftedRe, s->shiftedIm, s->frame);
+    float* overlap = s->overlap[c];
+    for (int i = 0; i < n; i++) {
+        overlap[i] += s->frame[i] * s->window[i] * s->gain;
+    }
+    memcpy(s->previousRe[c], re, (size_t)bins * sizeof(float));
+    memcpy(s->previousIm[c], im, (size_t)bins * sizeof(float));
+    memcpy(s->rotation[c], s->rotated, (size_t)bins * sizeof(float));
+    s->analysed[c] = true;
+    s->settled[c] = ratio == 1.0 && !wound;
+}
+
+// One hop is in: shift every channel's frame and finish `hop` frames of output
+static inline void pitchshift_hop(PitchShifter* s, float cents, bool formants) {
+    const int n = s->fftSize;
+    const int hop = s->hop;
+    const double ratio = exp2((double)cents / 1200.0);
+    for (int c = 0; c < s->channelCount; c++) {
+        float* overlap = s->overlap[c];
+        if (cents == 0.0f && s->settled[c]) {
+            // Analysis and synthesis windows without the transforms between them
+            const float* x = s->input[c];
+            for (int i = 0; i < n; i++) {
+                overlap[i] += x[i] * s->window[i] * s->window[i] * s->gain;
+            }
+            s->analysed[c] = false;
+        } else {
+            pitchshift_shift_frame(s, c, ratio, formants);
+        }
+        memcpy(s->output[c], overlap, (size_t)hop * sizeof(float));
+        memmove(overlap, overlap + hop, (size_t)(n - hop) * sizeof(float));
+        memset(overlap + n - hop, 0, (size_t)hop * sizeof(float));
+        memmove(s->input[c], s->input[c] + hop, (size_t)(n - hop) * sizeof(float));
+    }
+    bool settled = cents == 0.0f;
+    for (int c = 0; c < s->channelCount; c++) {
+        settled = settled && s->settled[c];
+    }
+    s->unshifted = !settled ? 0 : s->unshifted + hop < n ? s->unshifted + hop : n;
+}
+
+// Shift `frames` planar frames (channel c at input + c * inputStride) by
+// `cents` into output, fftSize frames later; output may be the input. The
+// shift may change from call to call and applies from the next hop.
+static inline void pitchshift_run(PitchShifter* s, const float* input, int inputStride, float* output,
+                                  int outputStride, int frames, float cents, bool formants) {
+    cents = cents < -PITCH_SHIFT_MAX_CENTS ? -PITCH_SHIFT_MAX_CENTS
+                                           : cents > PITCH_SHIFT_MAX_CENTS ? PITCH_SHIFT_MAX_CENTS : cents;
+    const int n = s->fftSize;
+    const int hop = s->hop;
+    for (int done = 0; done < frames;) {
+        const int take = frames - done < hop - s->rover ? frames - done : hop - s->rover;
+        for (int c = 0; c < s->channelCount; c++) {
+            const float* from = input + (size_t)c * inputStride + done;
+            memcpy(s->input[c] + n - hop + s->rover, from, (size_t)take * sizeof(float));
+            memcpy(output + (size_t)c * outputStride + done, s->output[c] + s->rover, (size_t)take * sizeof(float));
+        }
+        s->rover += take;
+        done += take;
+        if (s->rover == hop) {
+            pitchshift_hop(s, cents, formants);
+            s->rover = 0;
+        }
+    }
+}
+
+// Whether every frame the shifter holds went through unrotated at 0 cents:
+// the next fftSize frames out are then the last fftSize frames in, so a caller
+// may play those (pitchshift_read_held) and route around the shifter
+static inline bool pitchshift_is_identity(const PitchShifter* s) {
+    return s->unshifted >= s->fftSize;
+}
+
+// Copy `frames` of the fftSize frames the shifter would play next at 0 cents,
+// from `offset` on, to planar output without running it
+static inline void pitchshift_read_held(const PitchShifter* s, int offset, float* output, int stride, int frames) {
+    const int finished = s->hop - s->rover;  // Still in output, the rest is raw input
+    if (frames <= 0) {
+        return;
+    }
+    for (int c = 0; c < s->channelCount; c++) {
+        float* dst = output + (size_t)c * stride;
+        int at = offset;
+        int done = 0;
+        if (at < finished) {
+            done = frames < finished - at ? frames : finished - at;
+            memcpy(dst, s->output[c] + s->rover + at, (size_t)done * sizeof(float));
+            at += done;
+        }
+        memcpy(dst + done, s->input[c] + (at - finished), (size_t)(frames - done) * sizeof(float));
+    }
+}
+
+#endif  // MACAUDIO_PITCHSHIFT_H
@@ -1,54 +1,2045 @@
 #import <AVFoundation/AVFoundation.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include <sys/stat.h>
+#import "macaudio.h"
+#import "analysiscache.h"
+#import "loudness.h"
+#import "meter.h"
+#import "pcmcache.h"
+#import "pcmfile.h"
+#import "peaks.h"
+#import "pitchshift.h"
+#import "playhead.h"
+#import "stream.h"
+#import "variant.h"
+#import "wsola.h"
 
 #ifdef __cplusplus
 extern "C" {
 #endif
 
-// Player result structure
+// Persistent analysis cache (analysiscache.h). File work runs on a copy of the
+// directory outside the lock; stores, evictions and counters are serialised by it.
+static pthread_mutex_t analysisCacheMutex = PTHREAD_MUTEX_INITIALIZER;
+static char* analysisCacheDirectory = NULL;  // NULL while closed
+static AnalysisCacheStats analysisCacheCounters;
+
+// malloc'd copy of the open directory, or NULL
+static char* analysis_cache_directory(void) {
+    pthread_mutex_lock(&analysisCacheMutex);
+    char* directory = analysisCacheDirectory ? strdup(analysisCacheDirectory) : NULL;
+    pthread_mutex_unlock(&analysisCacheMutex);
+    return directory;
+}
+
+static void analysis_cache_count(bool hit) {
+    pthread_mutex_lock(&analysisCacheMutex);
+    if (analysisCacheDirectory) {
+        if (hit) {
+            analysisCacheCounters.hits++;
+        } else {
+            analysisCacheCounters.misses++;
+        }
+    }
+    pthread_mutex_unlock(&analysisCacheMutex);
+}
+
+// Format fields of a loaded file as stored in its cache record
+static void analysis_describe_file(AVAudioFile* audioFile, AnalysisRecord* record) {
+    memset(record, 0, sizeof(*record));
+    record->items = ANALYSIS_CACHE_FORMAT;
+    record->channelCount = (int32_t)audioFile.processingFormat.channelCount;
+    record->sampleRate = audioFile.processingFormat.sampleRate;
+    record->frames = audioFile.length;
+    snprintf(record->format, sizeof(record->format), "%s", [[audioFile.fileFormat description] UTF8String]);
+}
+
+// Merge `update` (and a pyramid) into the entry of `path`, hashing the file if
+// its alias is stale, then evict down to the cap. `stored` receives the merged
+// record. Returns false when the cache is closed or the write failed.
+static bool analysis_cache_remember(const char* path, const AnalysisRecord* update, const PeakPyramid* pyramid,
+                                    AnalysisRecord* stored) {
+    char* directory = analysis_cache_directory();
+    char hash[ANALYSIS_CACHE_HASH_LENGTH];
+    if (!directory || !analysis_cache_key(directory, path, 1, hash)) {
+        free(directory);
+        return false;
+    }
+    pthread_mutex_lock(&analysisCacheMutex);
+    bool ok = analysisCacheDirectory && strcmp(directory, analysisCacheDirectory) == 0 &&
+              analysis_cache_store(directory, hash, update, pyramid);
+    if (ok) {
+        if (stored) {
+            analysis_cache_read(directory, hash, stored);
+        }
+        int64_t bytes;
+        int entries;
+        const int evicted = analysis_cache_evict(directory, analysisCacheCounters.maxBytes, &bytes, &entries);
+        if (evicted > 0) {
+            analysisCacheCounters.evictions += evicted;
+            analysis_cache_prune_aliases(directory);
+        }
+    }
+    pthread_mutex_unlock(&analysisCacheMutex);
+    free(directory);
+    return ok;
+}
+
+// Read the cached record of `path` into the player's copy. Without allowHash
+// only a fresh alias is used, so an unknown file costs a stat, not a read.
+static bool analysis_cache_load(AudioPlayer* player, const char* path, bool allowHash) {
+    char* directory = analysis_cache_directory();
+    char hash[ANALYSIS_CACHE_HASH_LENGTH];
+    AnalysisRecord record;
+    const bool found = directory && analysis_cache_key(directory, path, allowHash, hash) &&
+                       analysis_cache_read(directory, hash, &record);
+    free(directory);
+    if (!found) {
+        return false;
+    }
+    if (!player->analysis) {
+        player->analysis = malloc(sizeof(AnalysisRecord));
+        if (!player->analysis) {
+            return false;
+        }
+    }
+    *(AnalysisRecord*)player->analysis = record;
+    return true;
+}
+
+// The player's cached record if it holds `item`, looking the file up by content
+// before giving up. Counts a hit or a miss.
+static const AnalysisRecord* analysis_cache_lookup(AudioPlayer* player, AVAudioFile* audioFile, uint32_t item) {
+    const AnalysisRecord* record = player->analysis;
+    if (!(record && (record->items & item)) &&
+        analysis_cache_load(player, audioFile.url.fileSystemRepresentation, true)) {
+        record = player->analysis;
+    }
+    const bool hit = record && (record->items & item);
+    analysis_cache_count(hit);
+    return hit ? record : NULL;
+}
+
+// Store a whole-file result and refresh the player's copy
+static void analysis_cache_update(AudioPlayer* player, AVAudioFile* audioFile, const AnalysisRecord* update) {
+    AnalysisRecord stored;
+    if (analysis_cache_remember(audioFile.url.fileSystemRepresentation, update, NULL, &stored)) {
+        if (!player->analysis) {
+            player->analysis = malloc(sizeof(AnalysisRecord));
+        }
+        if (player->analysis) {
+            *(AnalysisRecord*)player->analysis = stored;
+        }
+    }
+}
+
+// Waveform overview job: one background build of the loaded file's peak
+// pyramid. The worker opens its own AVAudioFile so playback and analysis keep
+// their read positions. The pyramid is published by `ready` and not written
+// afterwards, so queries read it without locking.
+typedef struct {
+    PeakPyramid pyramid;
+    char* path;
+    int channelCount;
+    double sampleRate;
+    int64_t frames;
+    AnalysisRecord identity;  // Format fields for the analysis cache
+    bool persist;
+    bool cached;          // Written before ready
+    const char* error;    // Written before failed
+    _Atomic bool cancelled;
+    _Atomic bool ready;
+    _Atomic bool failed;
+    _Atomic int64_t progressFrames;
+    pthread_t thread;
+} PeakJob;
+
+static void peaks_job_fail(PeakJob* job, const char* error) {
+    job->error = error;
+    atomic_store_explicit(&job->failed, true, memory_order_release);
+}
+
+static void* peaks_job_run(void* arg) {
+    PeakJob* job = arg;
+    @autoreleasepool {
+        char* directory = analysis_cache_directory();
+        if (directory) {
+            char hash[ANALYSIS_CACHE_HASH_LENGTH];
+            const bool hit = analysis_cache_key(directory, job->path, 1, hash) &&
+                             analysis_cache_read_peaks(directory, hash, &job->pyramid);
+            free(directory);
+            analysis_cache_count(hit);
+            if (hit) {
+                job->cached = true;
+                atomic_store_explicit(&job->progressFrames, job->frames, memory_order_relaxed);
+                atomic_store_explicit(&job->ready, true, memory_order_release);
+                return NULL;
+            }
+        }
+
+        NSString* path = [NSString stringWithUTF8String:job->path];
+        NSString* sidecar = [path stringByAppendingString:@".peaks"];
+        struct stat info;
+        const bool identified = stat(job->path, &info) == 0;
+
+        if (job->persist && identified &&
+            peaks_load(&job->pyramid, sidecar.fileSystemRepresentation, job->channelCount, job->sampleRate,
+                       job->frames, (int64_t)info.st_size, (int64_t)info.st_mtime)) {
+            job->cached = true;
+            atomic_store_explicit(&job->progressFrames, job->frames, memory_order_relaxed);
+            atomic_store_explicit(&job->ready, true, memory_order_release);
+            return NULL;
+        }
+
+        NSError* error = nil;
+        AVAudioFile* audioFile = [[AVAudioFile alloc] initForReading:[NSURL fileURLWithPath:path] error:&error];
+        if (!audioFile) {
+            peaks_job_fail(job, "Failed to open audio file for peaks");
+            return NULL;
+        }
+        const AVAudioFrameCount chunkFrames = 65536;
+        AVAudioPCMBuffer* buffer = [[AVAudioPCMBuffer alloc] initWithPCMFormat:audioFile.processingFormat
+                                                                 frameCapacity:chunkFrames];
+        if (!buffer || !peaks_init(&job->pyramid, job->channelCount, job->sampleRate, job->frames)) {
+            peaks_job_fail(job, "Failed to allocate peaks");
+            return NULL;
+        }
+
+        while (job->pyramid.frames < job->frames) {
+            if (atomic_load_explicit(&job->cancelled, memory_order_relaxed)) {
+                return NULL;
+            }
+            if (![audioFile readIntoBuffer:buffer frameCount:chunkFrames error:&error] || buffer.frameLength == 0) {
+                break;
+            }
+            if (!peaks_add(&job->pyramid, (const float* const*)buffer.floatChannelData, (int)buffer.frameLength)) {
+                peaks_job_fail(job, "Failed to allocate peaks");
+                return NULL;
+            }
+            atomic_store_explicit(&job->progressFrames, job->pyramid.frames, memory_order_relaxed);
+        }
+        if (error) {
+            peaks_job_fail(job, "Failed to read audio data for peaks");
+            return NULL;
+        }
+        if (!peaks_finish(&job->pyramid)) {
+            peaks_job_fail(job, "Failed to allocate peaks");
+            return NULL;
+        }
+
+        if (job->persist && identified &&
+            !peaks_save(&job->pyramid, sidecar.fileSystemRepresentation, (int64_t)info.st_size, (int64_t)info.st_mtime)) {
+            NSLog(@"Failed to write peaks file %@", sidecar);
+        }
+        analysis_cache_remember(job->path, &job->identity, &job->pyramid, NULL);
+        atomic_store_explicit(&job->ready, true, memory_order_release);
+    }
+    return NULL;
+}
+
+// Cancel and free the player's overview job (it belongs to the current file)
+static void peaks_job_stop(AudioPlayer* player) {
+    PeakJob* job = player->peaks;
+    if (!job) {
+        return;
+    }
+    atomic_store_explicit(&job->cancelled, true, memory_order_relaxed);
+    pthread_join(job->thread, NULL);
+    peaks_free(&job->pyramid);
+    free(job->path);
+    free(job);
+    player->peaks = NULL;
+}
+
+// ==============================================
+// Streaming playback
+// ==============================================
+
+// Read-ahead state of a streaming player. AVAudioPlayerNode pulls from its
+// own schedule, so the I/O thread decodes each slot of the pool into a
+// no-copy AVAudioPCMBuffer over the slot's planes and schedules it; the
+// node's completion handlers release the slots in order. Slots hold the node's
+// output format, converting from the file's when the two differ. Uncompressed
+// WAV/AIFF in that format is unpacked straight from a memory mapping
+// (pcmfile.h) instead of through AVAudioFile, and mono float32 is scheduled
+// from the mapping itself without any copy. `mutex` orders scheduling against
+// restarts, so a slot decoded for an old position is never scheduled after
+// the node was stopped.
 typedef struct {
-    void* result;
-    const char* error;  // NULL for success, error message for failure
-} PlayerResult;
+    int bufferFrames;            // As requested; the pool clamps them
+    int bufferCount;
+    bool running;                // Pool and I/O thread exist
+    StreamPool pool;
+    AudioPlayer* player;
+    void* audioFile;             // AVAudioFile*, its own read position
+    PcmFile pcm;                 // Mapping of the same file, when `mapped`
+    bool mapped;
+    void* format;                // AVAudioFormat* of the slots
+    void* converter;             // AVAudioConverter* from the file's format (nullable)
+    void* staging;               // AVAudioPCMBuffer* of file frames for the converter (nullable)
+    void* buffers;               // NSArray<AVAudioPCMBuffer*>, one per slot
+    AudioBufferList** lists;     // Their no-copy buffer lists
+    pthread_t thread;
+    pthread_mutex_t mutex;
+    pthread_cond_t wake;
+    bool stopping;               // Guarded by mutex
+    int64_t endFrame;            // Guarded by mutex: end of the segment being played
+    _Atomic bool active;         // A segment is being played
+    _Atomic uint32_t scheduled;  // Generation of the last scheduled slot
+    _Atomic uint64_t starvedAt;  // Uptime (ns) when the node ran dry, 0 while fed
+} PlayerStream;
+
+static void player_file_done(AudioPlayer* player);  // Gapless queue, below
+
+// Completion handler of a scheduled slot; runs on an AVFoundation thread
+static void stream_slot_done(PlayerStream* stream, uint32_t generation, bool last) {
+    const bool current = generation == __atomic_load_n(&stream->pool.generation, __ATOMIC_ACQUIRE) &&
+                         atomic_load(&stream->active);
+    if (current && last) {
+        atomic_store(&stream->active, false);
+        player_file_done(stream->player);
+    } else if (current && stream_pool_ready(&stream->pool) == 1) {
+        // The node plays silence until the I/O thread schedules the next slot
+        stream_pool_underrun(&stream->pool, 0);
+        atomic_store(&stream->starvedAt, clock_gettime_nsec_np(CLOCK_UPTIME_RAW));
+    }
+    // No mutex: stop runs under it and may call handlers before it returns. A
+    // missed wakeup only costs one poll interval.
+    pthread_cond_signal(&stream->wake);
+    stream_pool_release(&stream->pool);  // Last access: teardown waits for every slot
+}
+
+// Fill `slot` from the mapping: unpacked into its planes, or for mono float32 a
+// fresh no-copy buffer over the mapped samples themselves
+static AVAudioPCMBuffer* stream_decode_mapped(PlayerStream* stream, int slot, int64_t* cursor, int64_t endFrame) {
+    NSMutableArray<AVAudioPCMBuffer*>* buffers = (__bridge NSMutableArray<AVAudioPCMBuffer*>*)stream->buffers;
+    AVAudioPCMBuffer* buffer = buffers[slot];
+    const AVAudioFrameCount frames = (AVAudioFrameCount)MIN((int64_t)stream->pool.bufferFrames, endFrame - *cursor);
+    const float* samples = stream->pcm.channelCount == 1 ? pcm_file_samples(&stream->pcm, *cursor) : NULL;
+    if (samples && frames > 0) {
+        pcm_file_track(&stream->pcm, *cursor, frames);
+        AudioBufferList* list = stream->lists[slot];
+        list->mBuffers[0].mData = (void*)samples;
+        list->mBuffers[0].mDataByteSize = (UInt32)(frames * sizeof(float));
+        AVAudioPCMBuffer* mapped = [[AVAudioPCMBuffer alloc] initWithPCMFormat:buffer.format
+                                                              bufferListNoCopy:list
+                                                                   deallocator:nil];
+        if (mapped) {
+            mapped.frameLength = frames;
+            buffers[slot] = mapped;  // The slot is free, so nothing has the old one scheduled
+            *cursor += frames;
+            return mapped;
+        }
+    }
+
+    float* planes[stream->pool.channelCount];
+    for (int c = 0; c < stream->pool.channelCount; c++) {
+        planes[c] = buffer.floatChannelData[c];
+    }
+    const int64_t read = pcm_file_read(&stream->pcm, *cursor, frames, planes);
+    for (int c = 0; c < stream->pool.channelCount; c++) {
+        memset(planes[c] + read, 0, (size_t)(frames - read) * sizeof(float));  // Short file: silence
+    }
+    buffer.frameLength = frames;
+    *cursor += frames;
+    return buffer;
+}
+
+// Decode up to one slot from `*cursor`; returns true at the end of the segment
+static bool stream_decode(PlayerStream* stream, AVAudioPCMBuffer* buffer, int64_t* cursor, int64_t endFrame) {
+    AVAudioFile* audioFile = (__bridge AVAudioFile*)stream->audioFile;
+    AVAudioConverter* converter = (__bridge AVAudioConverter*)stream->converter;
+    AVAudioPCMBuffer* staging = (__bridge AVAudioPCMBuffer*)stream->staging;
+    if (!converter) {
+        const AVAudioFrameCount frames = (AVAudioFrameCount)MIN((int64_t)buffer.frameCapacity, endFrame - *cursor);
+        NSError* error = nil;
+        audioFile.framePosition = *cursor;
+        if (![audioFile readIntoBuffer:buffer frameCount:frames error:&error]) {
+            buffer.frameLength = 0;
+        }
+        // Short read: silence rather than a stall
+        for (AVAudioChannelCount c = 0; c < buffer.format.channelCount; c++) {
+            memset(buffer.floatChannelData[c] + buffer.frameLength, 0, (frames - buffer.frameLength) * sizeof(float));
+        }
+        buffer.frameLength = frames;
+        *cursor += frames;
+        return *cursor >= endFrame;
+    }
+
+    __block int64_t input = *cursor;
+    NSError* error = nil;
+    const AVAudioConverterOutputStatus status =
+        [converter convertToBuffer:buffer error:&error withInputFromBlock:^AVAudioBuffer*(AVAudioPacketCount packets,
+                                                                                        AVAudioConverterInputStatus* inputStatus) {
+            const AVAudioFrameCount frames =
+                (AVAudioFrameCount)MIN(MIN((int64_t)packets, (int64_t)staging.frameCapacity), endFrame - input);
+            audioFile.framePosition = input;
+            if (frames == 0 || ![audioFile readIntoBuffer:staging frameCount:frames error:nil] || staging.frameLength == 0) {
+                *inputStatus = AVAudioConverterInputStatus_EndOfStream;
+                return nil;
+            }
+            input += staging.frameLength;
+            *inputStatus = AVAudioConverterInputStatus_HaveData;
+            return staging;
+        }];
+    *cursor = input;
+    return status == AVAudioConverterOutputStatus_EndOfStream || status == AVAudioConverterOutputStatus_Error;
+}
+
+static void* stream_run(void* arg) {
+    PlayerStream* stream = arg;
+    StreamPool* pool = &stream->pool;
+    AVAudioPlayerNode* playerNode = (__bridge AVAudioPlayerNode*)stream->player->playerNode;
+    NSArray<AVAudioPCMBuffer*>* buffers = (__bridge NSArray<AVAudioPCMBuffer*>*)stream->buffers;
+    // Completion handlers signal, so the poll only bounds how late a restart is noticed
+    const int64_t pollNs = 20 * NSEC_PER_MSEC;
+
+    uint32_t generation = 0;
+    int64_t cursor = 0;
+    bool finished = false;
+    @autoreleasepool {
+        pthread_mutex_lock(&stream->mutex);
+        while (!stream->stopping) {
+            int64_t frame;
+            const uint32_t requested = stream_pool_request(pool, &frame);
+            if (requested != generation) {
+                generation = requested;
+                cursor = frame;
+                finished = false;
+                [(__bridge AVAudioConverter*)stream->converter reset];
+            }
+            const int slot = atomic_load(&stream->active) && !finished ? stream_pool_next_slot(pool) : -1;
+            if (slot < 0) {
+                struct timespec deadline;
+                clock_gettime(CLOCK_REALTIME, &deadline);
+                deadline.tv_nsec += pollNs;
+                deadline.tv_sec += deadline.tv_nsec / NSEC_PER_SEC;
+                deadline.tv_nsec %= NSEC_PER_SEC;
+                pthread_cond_timedwait(&stream->wake, &stream->mutex, &deadline);
+                continue;
+            }
+            const int64_t endFrame = stream->endFrame;
+            pthread_mutex_unlock(&stream->mutex);
+
+            AVAudioPCMBuffer* buffer = buffers[slot];
+            const int64_t start = cursor;
+            bool last;
+            @autoreleasepool {
+                if (stream->mapped) {
+                    buffer = stream_decode_mapped(stream, slot, &cursor, endFrame);
+                    last = cursor >= endFrame;
+                } else {
+                    last = stream_decode(stream, buffer, &cursor, endFrame);
+                }
+            }
+
+            pthread_mutex_lock(&stream->mutex);
+            finished = last;
+            if (generation != __atomic_load_n(&pool->generation, __ATOMIC_ACQUIRE) || !atomic_load(&stream->active)) {
+                continue;  // Restarted or stopped while decoding
+            }
+            if (buffer.frameLength == 0) {
+                if (last) {
+                    atomic_store(&stream->active, false);
+                    stream->player->isPlaying = false;
+                }
+                continue;
+            }
+            const uint64_t starvedAt = atomic_exchange(&stream->starvedAt, 0);
+            if (starvedAt) {
+                const double starved = (double)(clock_gettime_nsec_np(CLOCK_UPTIME_RAW) - starvedAt) / NSEC_PER_SEC;
+                __atomic_fetch_add(&pool->underrunFrames, (int64_t)(starved * buffer.format.sampleRate), __ATOMIC_RELAXED);
+            }
+            stream_pool_publish(pool, start, (int)buffer.frameLength, generation);
+            atomic_store(&stream->scheduled, generation);
+            @try {
+                [playerNode scheduleBuffer:buffer completionHandler:^{
+                    stream_slot_done(stream, generation, last);
+                }];
+            }
+            @catch (NSException* exception) {
+                NSLog(@"Failed to schedule streaming buffer: %@", exception.reason);
+                stream_pool_release(pool);
+                atomic_store(&stream->active, false);
+            }
+        }
+        pthread_mutex_unlock(&stream->mutex);
+    }
+    return NULL;
+}
+
+// Free the buffers and the pool; the I/O thread must have stopped
+static void stream_release(PlayerStream* stream) {
+    if (stream->lists) {
+        for (int i = 0; i < stream->pool.bufferCount; i++) {
+            free(stream->lists[i]);
+        }
+        free(stream->lists);
+        stream->lists = NULL;
+    }
+    if (stream->buffers) {
+        NSArray* buffers = (__bridge_transfer NSArray*)stream->buffers;
+        buffers = nil;
+        stream->buffers = NULL;
+    }
+    if (stream->staging) {
+        AVAudioPCMBuffer* staging = (__bridge_transfer AVAudioPCMBuffer*)stream->staging;
+        staging = nil;
+        stream->staging = NULL;
+    }
+    if (stream->converter) {
+        AVAudioConverter* converter = (__bridge_transfer AVAudioConverter*)stream->converter;
+        converter = nil;
+        stream->converter = NULL;
+    }
+    if (stream->format) {
+        AVAudioFormat* format = (__bridge_transfer AVAudioFormat*)stream->format;
+        format = nil;
+        stream->format = NULL;
+    }
+    if (stream->audioFile) {
+        AVAudioFile* audioFile = (__bridge_transfer AVAudioFile*)stream->audioFile;
+        audioFile = nil;
+        stream->audioFile = NULL;
+    }
+    pcm_file_close(&stream->pcm);
+    stream->mapped = false;
+    stream_pool_free(&stream->pool);
+}
+
+// Stop reading ahead and flush the node; it goes back to scheduling the file
+static void stream_detach(AudioPlayer* player) {
+    PlayerStream* stream = player->stream;
+    if (!stream || !stream->running) {
+        return;
+    }
+    AVAudioPlayerNode* playerNode = (__bridge AVAudioPlayerNode*)player->playerNode;
+    pthread_mutex_lock(&stream->mutex);
+    stream->stopping = true;
+    atomic_store(&stream->active, false);
+    [playerNode stop];
+    pthread_cond_signal(&stream->wake);
+    pthread_mutex_unlock(&stream->mutex);
+    pthread_join(stream->thread, NULL);
+    player->isPlaying = false;
+
+    // Completion handlers of flushed buffers may still be on their way
+    for (int waited = 0; waited < 1000 && stream_pool_ready(&stream->pool) > 0; waited++) {
+        usleep(1000);
+    }
+    stream_release(stream);
+    pthread_cond_destroy(&stream->wake);
+    pthread_mutex_destroy(&stream->mutex);
+    stream->running = false;
+    stream->stopping = false;
+}
+
+// Allocate the pool and its buffers in the node's current output format and
+// start the I/O thread
+static const char* stream_attach(AudioPlayer* player) {
+    PlayerStream* stream = player->stream;
+    if (!stream || !player->audioFile) {
+        return NULL;
+    }
+    AVAudioPlayerNode* playerNode = (__bridge AVAudioPlayerNode*)player->playerNode;
+    AVAudioFile* loaded = (__bridge AVAudioFile*)player->audioFile;
+    AVAudioFormat* nodeFormat = [playerNode outputFormatForBus:0];
+    AVAudioFormat* format = [[AVAudioFormat alloc] initWithCommonFormat:AVAudioPCMFormatFloat32
+                                                             sampleRate:nodeFormat.sampleRate
+                                                               channels:nodeFormat.channelCount
+                                                            interleaved:NO];
+    if (!format) {
+        return "Unsupported player output format";
+    }
+    if (!stream_pool_init(&stream->pool, (int)format.channelCount, stream->bufferFrames, stream->bufferCount)) {
+        return "Failed to allocate streaming buffers";
+    }
+
+    NSError* error = nil;
+    AVAudioFile* audioFile = [[AVAudioFile alloc] initForReading:loaded.url error:&error];
+    if (!audioFile) {
+        stream_pool_free(&stream->pool);
+        return "Failed to open audio file for streaming";
+    }
+    stream->audioFile = (__bridge_retained void*)audioFile;
+    stream->format = (__bridge_retained void*)format;
+
+    // Uncompressed files already in the node's format skip AVAudioFile decoding
+    stream->mapped = pcm_file_open(loaded.url.fileSystemRepresentation, &stream->pcm) == NULL &&
+                     stream->pcm.sampleRate == format.sampleRate &&
+                     stream->pcm.channelCount == (int)format.channelCount && stream->pcm.frames == audioFile.length;
+    if (!stream->mapped) {
+        pcm_file_close(&stream->pcm);
+    }
+    if (!stream->mapped && ![audioFile.processingFormat isEqual:format]) {
+        AVAudioConverter* converter = [[AVAudioConverter alloc] initFromFormat:audioFile.processingFormat toFormat:format];
+        AVAudioPCMBuffer* staging = [[AVAudioPCMBuffer alloc] initWithPCMFormat:audioFile.processingFormat
+                                                                  frameCapacity:(AVAudioFrameCount)stream->pool.bufferFrames];
+        if (!converter || !staging) {
+            stream_release(stream);
+            return "Failed to create streaming converter";
+        }
+        converter.sampleRateConverterQuality = resampler_av_quality(player->resamplerQuality);
+        stream->converter = (__bridge_retained void*)converter;
+        stream->staging = (__bridge_retained void*)staging;
+    }
+
+    // One no-copy buffer over each slot's planes (the guard frame goes unused here)
+    NSMutableArray<AVAudioPCMBuffer*>* buffers = [NSMutableArray arrayWithCapacity:stream->pool.bufferCount];
+    stream->lists = calloc((size_t)stream->pool.bufferCount, sizeof(AudioBufferList*));
+    for (int i = 0; stream->lists && i < stream->pool.bufferCount; i++) {
+        AudioBufferList* list = calloc(1, offsetof(AudioBufferList, mBuffers) +
+                                              (size_t)stream->pool.channelCount * sizeof(AudioBuffer));
+        if (!list) {
+            break;
+        }
+        stream->lists[i] = list;
+        list->mNumberBuffers = (UInt32)stream->pool.channelCount;
+        for (int c = 0; c < stream->pool.channelCount; c++) {
+            list->mBuffers[c].mNumberChannels = 1;
+            list->mBuffers[c].mDataByteSize = (UInt32)(stream->pool.bufferFrames * sizeof(float));
+            list->mBuffers[c].mData = stream_pool_plane(&stream->pool, i, c);
+        }
+        AVAudioPCMBuffer* buffer = [[AVAudioPCMBuffer alloc] initWithPCMFormat:format bufferListNoCopy:list deallocator:nil];
+        if (!buffer) {
+            break;
+        }
+        [buffers addObject:buffer];
+    }
+    stream->buffers = (__bridge_retained void*)buffers;
+    if ((int)buffers.count != stream->pool.bufferCount) {
+        stream_release(stream);
+        return "Failed to allocate streaming buffers";
+    }
+
+    stream->player = player;
+    stream->stopping = false;
+    stream->endFrame = 0;
+    atomic_store(&stream->active, false);
+    atomic_store(&stream->scheduled, 0);
+    atomic_store(&stream->starvedAt, 0);
+    pthread_mutex_init(&stream->mutex, NULL);
+    pthread_cond_init(&stream->wake, NULL);
+    if (pthread_create(&stream->thread, NULL, stream_run, stream) != 0) {
+        pthread_cond_destroy(&stream->wake);
+        pthread_mutex_destroy(&stream->mutex);
+        stream_release(stream);
+        return "Failed to start streaming thread";
+    }
+    stream->running = true;
+
+    [playerNode stop];
+    player->isPlaying = false;
+    return NULL;
+}
+
+// The stream to play through, or NULL to schedule the file: offline rendering
+// pulls faster than realtime, which only the file schedule keeps up with.
+// Rebuilds the buffers if the node was reconnected in another format.
+static PlayerStream* stream_for_playback(AudioPlayer* player) {
+    PlayerStream* stream = player->stream;
+    if (!stream || !stream->running) {
+        return NULL;
+    }
+    AVAudioEngine* engine = (__bridge AVAudioEngine*)player->engine;
+    if (engine.isInManualRenderingMode) {
+        return NULL;
+    }
+    AVAudioPlayerNode* playerNode = (__bridge AVAudioPlayerNode*)player->playerNode;
+    AVAudioFormat* format = (__bridge AVAudioFormat*)stream->format;
+    AVAudioFormat* nodeFormat = [playerNode outputFormatForBus:0];
+    if (format.sampleRate != nodeFormat.sampleRate || format.channelCount != nodeFormat.channelCount) {
+        stream_detach(player);
+        const char* error = stream_attach(player);
+        if (error) {
+            NSLog(@"Streaming unavailable, playing from memory: %s", error);
+            return NULL;
+        }
+    }
+    return stream;
+}
+
+// Flush the node and decode [startFrame, endFrame) from the top, then wait
+// briefly for the first slot so playback does not start dry
+static void stream_begin(PlayerStream* stream, int64_t startFrame, int64_t endFrame) {
+    AVAudioPlayerNode* playerNode = (__bridge AVAudioPlayerNode*)stream->player->playerNode;
+    pthread_mutex_lock(&stream->mutex);
+    atomic_store(&stream->active, false);
+    [playerNode stop];
+    stream_pool_restart(&stream->pool, startFrame);
+    stream->endFrame = endFrame;
+    atomic_store(&stream->starvedAt, 0);
+    atomic_store(&stream->active, true);
+    pthread_cond_signal(&stream->wake);
+    pthread_mutex_unlock(&stream->mutex);
+
+    const uint32_t generation = __atomic_load_n(&stream->pool.generation, __ATOMIC_ACQUIRE);
+    for (int waited = 0; waited < 250 && atomic_load(&stream->scheduled) != generation; waited++) {
+        usleep(1000);
+    }
+}
+
+// Stop scheduling; the caller stops the node
+static void stream_end(AudioPlayer* player) {
+    PlayerStream* stream = player->stream;
+    if (!stream || !stream->running) {
+        return;
+    }
+    pthread_mutex_lock(&stream->mutex);
+    atomic_store(&stream->active, false);
+    pthread_mutex_unlock(&stream->mutex);
+}
+
+// ==============================================
+// Shared decoded audio
+// ==============================================
+
+// Decoded copies (pcmcache.h) are AVAudioPCMBuffers in a player node's output
+// format, so every player on the engine shares one. Players schedule no-copy
+// views of it whose deallocators hold a reference, so an evicted copy lives
+// until the node is done with it. Files decode outside the lock; the table,
+// references and counters are serialised by it.
+static pthread_mutex_t pcmCacheMutex = PTHREAD_MUTEX_INITIALIZER;
+static PcmCache pcmCache;
+
+// Evict unused copies until the cache is within its budget
+static void pcm_cache_shrink(void) {
+    void* evicted[16];
+    int count;
+    do {
+        pthread_mutex_lock(&pcmCacheMutex);
+        count = pcm_cache_trim(&pcmCache, evicted, 16);
+        pthread_mutex_unlock(&pcmCacheMutex);
+        for (int i = 0; i < count; i++) {
+            AVAudioPCMBuffer* buffer = (__bridge_transfer AVAudioPCMBuffer*)evicted[i];
+            buffer = nil;
+        }
+    } while (count == 16);
+}
+
+// AVAudioConverter quality of a RESAMPLER_QUALITY_* tier
+static AVAudioQuality resampler_av_quality(int quality) {
+    switch (quality) {
+        case RESAMPLER_QUALITY_LOW:
+            return AVAudioQualityLow;
+        case RESAMPLER_QUALITY_HIGH:
+            return AVAudioQualityHigh;
+        case RESAMPLER_QUALITY_BEST:
+            return AVAudioQualityMax;
+        default:
+            return AVAudioQualityMedium;
+    }
+}
+
+// Decode file frames [start, start + frames) into `format`, converting the
+// rate at RESAMPLER_QUALITY_* `quality`
+static AVAudioPCMBuffer* decoded_range_create(AVAudioFile* loaded, AVAudioFormat* format, AVAudioFramePosition start,
+                                              AVAudioFramePosition frames, int quality) {
+    NSError* error = nil;
+    AVAudioFile* audioFile = [[AVAudioFile alloc] initForReading:loaded.url error:&error];
+    if (!audioFile) {
+        return nil;
+    }
+    audioFile.framePosition = start;
+    __block AVAudioFramePosition remaining = frames;
+    AVAudioFormat* fileFormat = audioFile.processingFormat;
+    const double ratio = format.sampleRate / fileFormat.sampleRate;
+    AVAudioPCMBuffer* decoded =
+        [[AVAudioPCMBuffer alloc] initWithPCMFormat:format
+                                      frameCapacity:(AVAudioFrameCount)ceil((double)frames * ratio)];
+    if (!decoded) {
+        return nil;
+    }
+    if ([fileFormat isEqual:format]) {
+        return [audioFile readIntoBuffer:decoded frameCount:(AVAudioFrameCount)frames error:&error] ? decoded : nil;
+    }
+
+    AVAudioConverter* converter = [[AVAudioConverter alloc] initFromFormat:fileFormat toFormat:format];
+    AVAudioPCMBuffer* chunk = [[AVAudioPCMBuffer alloc] initWithPCMFormat:fileFormat frameCapacity:65536];
+    if (!converter || !chunk) {
+        return nil;
+    }
+    converter.sampleRateConverterQuality = resampler_av_quality(quality);
+    const AVAudioConverterOutputStatus status =
+        [converter convertToBuffer:decoded error:&error withInputFromBlock:^AVAudioBuffer*(AVAudioPacketCount packets,
+                                                                                        AVAudioConverterInputStatus* inputStatus) {
+            const AVAudioFrameCount count = (AVAudioFrameCount)MIN((AVAudioFramePosition)MIN(packets, chunk.frameCapacity), remaining);
+            if (count == 0 || ![audioFile readIntoBuffer:chunk frameCount:count error:nil] || chunk.frameLength == 0) {
+                *inputStatus = AVAudioConverterInputStatus_EndOfStream;
+                return nil;
+            }
+            remaining -= chunk.frameLength;
+            *inputStatus = AVAudioConverterInputStatus_HaveData;
+            return chunk;
+        }];
+    return status == AVAudioConverterOutputStatus_Error ? nil : decoded;
+}
+
+// Decode the whole file into `format`
+static AVAudioPCMBuffer* decoded_buffer_create(AVAudioFile* loaded, AVAudioFormat* format, int quality) {
+    return decoded_range_create(loaded, format, 0, loaded.length, quality);
+}
+
+// Drop the player's reference to its shared copy
+static void decoded_release(AudioPlayer* player) {
+    if (!player->decoded) {
+        return;
+    }
+    pthread_mutex_lock(&pcmCacheMutex);
+    const bool shared = pcm_cache_release(&pcmCache, player->decoded);
+    pthread_mutex_unlock(&pcmCacheMutex);
+    if (shared) {
+        pcm_cache_shrink();
+    } else {
+        AVAudioPCMBuffer* buffer = (__bridge_transfer AVAudioPCMBuffer*)player->decoded;
+        buffer = nil;
+    }
+    player->decoded = NULL;
+}
+
+// The shared copy of the loaded file in the node's output format, decoding it
+// if no player has yet; nil while the cache is off (schedule the file instead)
+static AVAudioPCMBuffer* decoded_for_playback(AudioPlayer* player) {
+    AVAudioPlayerNode* playerNode = (__bridge AVAudioPlayerNode*)player->playerNode;
+    AVAudioFile* loaded = (__bridge AVAudioFile*)player->audioFile;
+    AVAudioFormat* nodeFormat = [playerNode outputFormatForBus:0];
+    if (player->decoded) {
+        AVAudioPCMBuffer* held = (__bridge AVAudioPCMBuffer*)player->decoded;
+        if (held.format.sampleRate == nodeFormat.sampleRate && held.format.channelCount == nodeFormat.channelCount) {
+            return held;
+        }
+        decoded_release(player);  // Reconnected in another format
+    }
+
+    const char* path = loaded.url.fileSystemRepresentation;
+    int64_t size = 0;
+    int64_t modified = 0;
+    pthread_mutex_lock(&pcmCacheMutex);
+    const bool enabled = pcmCache.stats.budgetBytes > 0 && pcm_cache_identify(path, &size, &modified);
+    void* payload = enabled ? pcm_cache_acquire(&pcmCache, path, size, modified, nodeFormat.sampleRate,
+                                                (int)nodeFormat.channelCount)
+                            : NULL;
+    pthread_mutex_unlock(&pcmCacheMutex);
+    if (!enabled) {
+        return nil;
+    }
+
+    if (!payload) {
+        AVAudioFormat* format = [[AVAudioFormat alloc] initWithCommonFormat:AVAudioPCMFormatFloat32
+                                                                 sampleRate:nodeFormat.sampleRate
+                                                                   channels:nodeFormat.channelCount
+                                                                interleaved:NO];
+        AVAudioPCMBuffer* decoded = format ? decoded_buffer_create(loaded, format, player->resamplerQuality) : nil;
+        if (!decoded) {
+            NSLog(@"Failed to decode %s for the PCM cache, scheduling the file", path);
+            return nil;
+        }
+        void* own = (__bridge_retained void*)decoded;
+        const int64_t bytes = (int64_t)decoded.frameCapacity * (int64_t)format.channelCount * (int64_t)sizeof(float);
+        pthread_mutex_lock(&pcmCacheMutex);
+        payload = pcm_cache_insert(&pcmCache, path, size, modified, nodeFormat.sampleRate, (int)nodeFormat.channelCount,
+                                   own, bytes);
+        pthread_mutex_unlock(&pcmCacheMutex);
+        if (payload != own) {
+            decoded = (__bridge_transfer AVAudioPCMBuffer*)own;  // Another player cached it first
+            decoded = nil;
+        }
+        if (!payload) {
+            return nil;
+        }
+        pcm_cache_shrink();
+    }
+    player->decoded = payload;
+    return (__bridge AVAudioPCMBuffer*)payload;
+}
+
+// No-copy view of frames [start, start + frames) of a shared copy, keeping the
+// copy alive until the view is released
+static AVAudioPCMBuffer* decoded_view(AVAudioPCMBuffer* decoded, AVAudioFramePosition start, AVAudioFrameCount frames) {
+    const AVAudioChannelCount channels = decoded.format.channelCount;
+    AudioBufferList* list = calloc(1, offsetof(AudioBufferList, mBuffers) + channels * sizeof(AudioBuffer));
+    if (!list) {
+        return nil;
+    }
+    list->mNumberBuffers = channels;
+    for (AVAudioChannelCount c = 0; c < channels; c++) {
+        list->mBuffers[c].mNumberChannels = 1;
+        list->mBuffers[c].mDataByteSize = (UInt32)(frames * sizeof(float));
+        list->mBuffers[c].mData = decoded.floatChannelData[c] + start;
+    }
+    AVAudioPCMBuffer* view = [[AVAudioPCMBuffer alloc] initWithPCMFormat:decoded.format
+                                                        bufferListNoCopy:list
+                                                             deallocator:^(const AudioBufferList* bufferList) {
+        (void)decoded;
+        free((void*)bufferList);
+    }];
+    if (!view) {
+        free(list);
+        return nil;
+    }
+    view.frameLength = frames;
+    return view;
+}
+
+// ==============================================
+// Pre-rendered variants
+// ==============================================
+
+// Process-wide variant cache (variant.h). AVAudioPlayerNode plays from its
+// own schedule and cannot be switched onto a variant in place, so the macOS
+// backend renders none (see audioplayer_prepare_variants); the cache only
+// keeps its budgets and its directory within the disk budget, under the lock.
+static pthread_mutex_t variantCacheMutex = PTHREAD_MUTEX_INITIALIZER;
+static PcmCache variantCache = {.stats = {.budgetBytes = VARIANT_CACHE_DEFAULT_BUDGET}};
+static char* variantCacheDirectory = NULL;  // NULL for memory only
+static int64_t variantDiskBudget = 0;
+
+// Evict variants until the cache is within its budget
+static void variant_cache_shrink(void) {
+    void* evicted[16];
+    int count;
+    do {
+        pthread_mutex_lock(&variantCacheMutex);
+        count = pcm_cache_trim(&variantCache, evicted, 16);
+        pthread_mutex_unlock(&variantCacheMutex);
+        for (int i = 0; i < count; i++) {
+            free(evicted[i]);
+        }
+    } while (count == 16);
+}
+
+// ==============================================
+// Gapless queue
+// ==============================================
+
+// Queued files are decoded into the node's format when queued and handed to
+// it as buffers, which AVAudioPlayerNode plays back to back. The node cannot
+// unschedule or overlap buffers, so only the item playing and the next one are
+// handed over (completion handlers hand over the rest), a skip flushes the
+// node and hands the remaining items over again, and crossfades are not
+// applied. Completions of flushed hand-overs carry an old generation and are
+// ignored.
+typedef struct {
+    int64_t id;
+    void* buffer;         // AVAudioPCMBuffer* of the item's frames in the node's format
+    uint32_t generation;  // Of its hand-over
+    bool handed;
+    bool finished;
+} QueueEntry;
+
+typedef struct {
+    pthread_mutex_t mutex;  // Guards everything below, also against completion handlers
+    QueueEntry* items;      // Play order; finished ones until reaped
+    int count;
+    int capacity;
+    int64_t nextId;
+    int64_t played;
+    uint32_t generation;
+    bool fileDone;          // The player's own schedule has played out
+    _Atomic int inFlight;   // Hand-overs whose completion has not run
+} PlayerQueue;
+
+static int queue_unfinished(const PlayerQueue* queue) {
+    int count = 0;
+    for (int i = 0; i < queue->count; i++) {
+        count += queue->items[i].finished ? 0 : 1;
+    }
+    return count;
+}
+
+// Drop finished entries; needs the mutex
+static void queue_reap(PlayerQueue* queue) {
+    int kept = 0;
+    for (int i = 0; i < queue->count; i++) {
+        if (queue->items[i].finished) {
+            AVAudioPCMBuffer* buffer = (__bridge_transfer AVAudioPCMBuffer*)queue->items[i].buffer;
+            buffer = nil;
+        } else {
+            queue->items[kept++] = queue->items[i];
+        }
+    }
+    queue->count = kept;
+}
+
+static void queue_hand(AudioPlayer* player, PlayerQueue* queue);
+
+// Completion of a hand-over; runs on an AVFoundation thread
+static void queue_item_done(AudioPlayer* player, PlayerQueue* queue, int64_t id, uint32_t generation) {
+    pthread_mutex_lock(&queue->mutex);
+    if (generation == queue->generation) {
+        for (int i = 0; i < queue->count; i++) {
+            if (queue->items[i].id == id && !queue->items[i].finished) {
+                queue->items[i].finished = true;
+                queue->played++;
+            }
+        }
+        queue_hand(player, queue);
+        if (queue->fileDone && queue_unfinished(queue) == 0) {
+            player->isPlaying = false;
+            NSLog(@"Audio playback completed");
+        }
+    }
+    pthread_mutex_unlock(&queue->mutex);
+    atomic_fetch_sub(&queue->inFlight, 1);  // Last access: teardown waits for every hand-over
+}
+
+// Keep the first two unfinished items handed to the node; needs the mutex
+static void queue_hand(AudioPlayer* player, PlayerQueue* queue) {
+    AVAudioPlayerNode* playerNode = (__bridge AVAudioPlayerNode*)player->playerNode;
+    int handed = 0;
+    for (int i = 0; i < queue->count && handed < 2; i++) {
+        QueueEntry* entry = &queue->items[i];
+        if (entry->finished) {
+            continue;
+        }
+        if (!entry->handed) {
+            entry->handed = true;
+            entry->generation = queue->generation;
+            const int64_t id = entry->id;
+            const uint32_t generation = entry->generation;
+            atomic_fetch_add(&queue->inFlight, 1);
+            [playerNode scheduleBuffer:(__bridge AVAudioPCMBuffer*)entry->buffer
+                                atTime:nil
+                               options:0
+                completionCallbackType:AVAudioPlayerNodeCompletionDataPlayedBack
+                     completionHandler:^(AVAudioPlayerNodeCompletionCallbackType type) {
+                (void)type;
+                queue_item_done(player, queue, id, generation);
+            }];
+        }
+        handed++;
+    }
+}
+
+// Completion of the player's own schedule: playback goes on while queued
+// items remain
+static void player_file_done(AudioPlayer* player) {
+    PlayerQueue* queue = player->queue;
+    bool more = false;
+    if (queue) {
+        pthread_mutex_lock(&queue->mutex);
+        queue->fileDone = true;
+        more = queue_unfinished(queue) > 0;
+        pthread_mutex_unlock(&queue->mutex);
+    }
+    if (!more) {
+        player->isPlaying = false;
+        NSLog(@"Audio playback completed");
+    }
+}
+
+// The player's own file is scheduled again ahead of the queue
+static void player_file_started(AudioPlayer* player) {
+    PlayerQueue* queue = player->queue;
+    if (queue) {
+        pthread_mutex_lock(&queue->mutex);
+        queue->fileDone = false;
+        pthread_mutex_unlock(&queue->mutex);
+    }
+}
+
+// Flush the node without finishing the queue; hand-overs are redone by
+// queue_hand. Marks the first unfinished item finished if `skipItem` and it
+// was the one playing.
+static void queue_flush(AudioPlayer* player, bool skipItem) {
+    AVAudioPlayerNode* playerNode = (__bridge AVAudioPlayerNode*)player->playerNode;
+    PlayerQueue* queue = player->queue;
+    bool fileDone = true;
+    if (queue) {
+        pthread_mutex_lock(&queue->mutex);
+        queue->generation++;
+        fileDone = queue->fileDone;
+        pthread_mutex_unlock(&queue->mutex);
+    }
+    // Outside the mutex: stop may run completion handlers before it returns
+    [playerNode stop];
+    if (!queue) {
+        return;
+    }
+    pthread_mutex_lock(&queue->mutex);
+    bool skipped = !(skipItem && fileDone);
+    for (int i = 0; i < queue->count; i++) {
+        QueueEntry* entry = &queue->items[i];
+        if (entry->finished) {
+            continue;
+        }
+        if (!skipped) {
+            entry->finished = true;
+            queue->played++;
+            skipped = true;
+        }
+        entry->handed = false;
+    }
+    pthread_mutex_unlock(&queue->mutex);
+}
+
+// Free the queue once no completion handler can reach it
+static void queue_destroy(AudioPlayer* player) {
+    PlayerQueue* queue = player->queue;
+    if (!queue) {
+        return;
+    }
+    pthread_mutex_lock(&queue->mutex);
+    queue->generation++;
+    pthread_mutex_unlock(&queue->mutex);
+    for (int waited = 0; waited < 1000 && atomic_load(&queue->inFlight) > 0; waited++) {
+        usleep(1000);
+    }
+    for (int i = 0; i < queue->count; i++) {
+        queue->items[i].finished = true;
+    }
+    queue_reap(queue);
+    free(queue->items);
+    pthread_mutex_destroy(&queue->mutex);
+    free(queue);
+    player->queue = NULL;
+}
+
+// ==============================================
+// Loop regions
+// ==============================================
+
+// AVAudioPlayerNode loops a buffer itself (AVAudioPlayerNodeBufferLoops),
+// wrapping on its render thread, so the region is decoded into one buffer in
+// the node's format with the crossfade baked into its tail. Playback that has
+// not reached the region plays up to its start from the file first. The node
+// cannot change a looping buffer in place, so setting or clearing the region
+// while playing flushes the node and reschedules from the playhead. Streaming
+// players loop from memory too.
+typedef struct {
+    int64_t start;  // File frames
+    int64_t end;
+    int64_t crossfadeFrames;
+    void* buffer;   // AVAudioPCMBuffer* of one pass, in the node's format
+} PlayerLoop;
+
+static void loop_free(AudioPlayer* player) {
+    PlayerLoop* loop = player->loop;
+    if (!loop) {
+        return;
+    }
+    AVAudioPCMBuffer* buffer = (__bridge_transfer AVAudioPCMBuffer*)loop->buffer;
+    buffer = nil;
+    free(loop);
+    player->loop = NULL;
+}
+
+// One pass of the region: [start, end) with the crossfadeFrames before start
+// blended in equal-power under its last frames, so the wrap lands on them
+static AVAudioPCMBuffer* loop_buffer_create(AudioPlayer* player, int64_t start, int64_t end, int64_t crossfadeFrames) {
+    AVAudioPlayerNode* playerNode = (__bridge AVAudioPlayerNode*)player->playerNode;
+    AVAudioFile* audioFile = (__bridge AVAudioFile*)player->audioFile;
+    AVAudioFormat* nodeFormat = [playerNode outputFormatForBus:0];
+    AVAudioFormat* format = [[AVAudioFormat alloc] initWithCommonFormat:AVAudioPCMFormatFloat32
+                                                             sampleRate:nodeFormat.sampleRate
+                                                               channels:nodeFormat.channelCount
+                                                            interleaved:NO];
+    AVAudioPCMBuffer* region = format ? decoded_range_create(audioFile, format, start - crossfadeFrames,
+                                                             end - start + crossfadeFrames, player->resamplerQuality)
+                                      : nil;
+    if (!region) {
+        return nil;
+    }
+    const double ratio = format.sampleRate / audioFile.processingFormat.sampleRate;
+    const AVAudioFrameCount lead = (AVAudioFrameCount)MIN(llround((double)crossfadeFrames * ratio), (long long)region.frameLength);
+    const AVAudioFrameCount frames = region.frameLength - lead;
+    AVAudioPCMBuffer* pass = [[AVAudioPCMBuffer alloc] initWithPCMFormat:format frameCapacity:MAX(frames, 1u)];
+    if (!pass || frames == 0) {
+        return nil;
+    }
+    for (AVAudioChannelCount c = 0; c < format.channelCount; c++) {
+        const float* src = region.floatChannelData[c];
+        float* dst = pass.floatChannelData[c];
+        memcpy(dst, src + lead, frames * sizeof(float));
+        const AVAudioFrameCount fade = MIN(lead, frames);
+        for (AVAudioFrameCount i = 0; i < fade; i++) {
+            const float x = ((float)i + 0.5f) / (float)fade * (float)M_PI_2;
+            float* tail = dst + frames - fade + i;
+            *tail = *tail * cosf(x) + src[lead - fade + i] * sinf(x);
+        }
+    }
+    pass.frameLength = frames;
+    return pass;
+}
+
+// Schedule from file frame `from` into the loop: the file up to the region or
+// the rest of the current pass, then the pass over and over. False if `from`
+// is past the region.
+static bool loop_schedule(AudioPlayer* player, int64_t from) {
+    PlayerLoop* loop = player->loop;
+    if (!loop || from >= loop->end) {
+        return false;
+    }
+    AVAudioPlayerNode* playerNode = (__bridge AVAudioPlayerNode*)player->playerNode;
+    AVAudioFile* audioFile = (__bridge AVAudioFile*)player->audioFile;
+    AVAudioPCMBuffer* pass = (__bridge AVAudioPCMBuffer*)loop->buffer;
+    if (from < loop->start) {
+        [playerNode scheduleSegment:audioFile
+                      startingFrame:from
+                         frameCount:(AVAudioFrameCount)(loop->start - from)
+                             atTime:nil
+                  completionHandler:nil];
+    } else if (from > loop->start) {
+        const double ratio = pass.format.sampleRate / audioFile.processingFormat.sampleRate;
+        const AVAudioFramePosition offset = llround((double)(from - loop->start) * ratio);
+        AVAudioPCMBuffer* rest = offset < (AVAudioFramePosition)pass.frameLength
+                                     ? decoded_view(pass, offset, pass.frameLength - (AVAudioFrameCount)offset)
+                                     : nil;
+        if (rest) {
+            [playerNode scheduleBuffer:rest completionHandler:nil];
+        }
+    }
+    [playerNode scheduleBuffer:pass
+                        atTime:nil
+                       options:AVAudioPlayerNodeBufferLoops
+             completionHandler:^{
+        player_file_done(player);  // Only once flushed
+    }];
+    return true;
+}
+
+// Swap in a new region (NULL to clear) and reschedule a playing player from
+// its playhead, read while the old one still describes the schedule
+static const char* loop_replace(AudioPlayer* player, PlayerLoop* loop) {
+    AVAudioPlayerNode* playerNode = (__bridge AVAudioPlayerNode*)player->playerNode;
+    PlayheadState state;
+    const bool playing = player->isPlaying && playerNode.isPlaying && audioplayer_get_playhead(player, &state) == NULL;
+    loop_free(player);
+    player->loop = loop;
+    if (!playing) {
+        return NULL;
+    }
+    const char* error = audioplayer_seek(player, state.position, 0.0);
+    if (error && strcmp(error, "Cannot seek while a queued file plays") == 0) {
+        return NULL;  // The region applies once the file plays again
+    }
+    return error;
+}
+
+// ==============================================
+// Batch file analysis
+// ==============================================
+
+// Each file reports at most once, so results fill a slot array in completion
+// order; `produced` and `consumed` index it under the mutex.
+struct FileAnalysisBatch {
+    char** paths;
+    int count;
+    int flags;
+    _Atomic int nextFile;
+    _Atomic bool cancelled;
+    pthread_mutex_t mutex;
+    pthread_cond_t reported;
+    FileAnalysisResult* results;
+    char** errors;  // By file index
+    int produced;
+    int consumed;
+    int running;    // Workers not yet finished
+    int workerCount;
+    pthread_t* workers;
+};
+
+static void file_analysis_from_record(const AnalysisRecord* record, FileAnalysisResult* result) {
+    result->cached = true;
+    result->sampleRate = record->sampleRate;
+    result->channelCount = record->channelCount;
+    result->frames = record->frames;
+    result->rms = record->rms;
+    result->peak = record->peak;
+    result->loudness = record->loudness;
+}
+
+// Decode and measure one file into `result` (or a malloc'd `error`). Returns
+// false if the batch was cancelled meanwhile.
+static bool file_analysis_measure(FileAnalysisBatch* batch, const char* path, LoudnessState* state,
+                                  FileAnalysisResult* result, char** error) {
+    const bool wantLoudness = (batch->flags & FILE_ANALYSIS_LOUDNESS) != 0;
+    const uint32_t wanted = ANALYSIS_CACHE_RMS | (wantLoudness ? ANALYSIS_CACHE_LOUDNESS : 0u);
+    char* directory = analysis_cache_directory();
+    if (directory) {
+        char hash[ANALYSIS_CACHE_HASH_LENGTH];
+        AnalysisRecord record;
+        const bool hit = analysis_cache_key(directory, path, 0, hash) && analysis_cache_read(directory, hash, &record) &&
+                         (record.items & wanted) == wanted;
+        free(directory);
+        analysis_cache_count(hit);
+        if (hit) {
+            file_analysis_from_record(&record, result);
+            return true;
+        }
+    }
+
+    @autoreleasepool {
+        NSError* nsError = nil;
+        NSURL* url = [NSURL fileURLWithPath:[NSString stringWithUTF8String:path]];
+        AVAudioFile* audioFile = [[AVAudioFile alloc] initForReading:url error:&nsError];
+        if (!audioFile) {
+            *error = strdup([[NSString stringWithFormat:@"Failed to open audio file: %@", nsError.localizedDescription] UTF8String]);
+            return true;
+        }
+        AVAudioFormat* format = audioFile.processingFormat;
+        const int channels = (int)format.channelCount;
+        const AVAudioFrameCount chunkFrames = 65536;
+        AVAudioPCMBuffer* buffer = [[AVAudioPCMBuffer alloc] initWithPCMFormat:format frameCapacity:chunkFrames];
+        double* sums = calloc((size_t)channels, sizeof(double));
+        if (!buffer || !sums) {
+            free(sums);
+            *error = strdup("Failed to create analysis buffer");
+            return true;
+        }
+        result->sampleRate = format.sampleRate;
+        result->channelCount = channels;
+        result->frames = audioFile.length;
+        if (wantLoudness) {
+            loudness_init(state, format.sampleRate, channels);
+        }
+
+        int64_t frames = 0;
+        for (;;) {
+            if (atomic_load_explicit(&batch->cancelled, memory_order_relaxed)) {
+                free(sums);
+                return false;
+            }
+            if (![audioFile readIntoBuffer:buffer frameCount:chunkFrames error:&nsError] || buffer.frameLength == 0) {
+                break;
+            }
+            const int n = (int)buffer.frameLength;
+            for (int c = 0; c < channels; c++) {
+                MeterChannelStats stats;
+                meter_channel(buffer.floatChannelData[c], n, &stats);
+                sums[c] += stats.sumOfSquares;
+                result->peak = stats.peak > result->peak ? stats.peak : result->peak;
+            }
+            if (wantLoudness) {
+                loudness_process(state, (const float* const*)buffer.floatChannelData, n);
+            }
+            frames += n;
+        }
+        if (nsError) {
+            free(sums);
+            *error = strdup([[NSString stringWithFormat:@"Failed to read audio data: %@", nsError.localizedDescription] UTF8String]);
+            return true;
+        }
+        for (int c = 0; c < channels && frames > 0; c++) {
+            result->rms += sqrt(sums[c] / (double)frames) / channels;
+        }
+        free(sums);
+        if (wantLoudness) {
+            loudness_read(state, &result->loudness);
+        }
+
+        AnalysisRecord update;
+        analysis_describe_file(audioFile, &update);
+        update.items |= wanted;
+        update.rms = result->rms;
+        update.peak = result->peak;
+        update.loudness = result->loudness;
+        analysis_cache_remember(path, &update, NULL, NULL);
+    }
+    return true;
+}
+
+static void* file_analysis_run(void* arg) {
+    FileAnalysisBatch* batch = arg;
+    LoudnessState* state = malloc(sizeof(LoudnessState));
+    while (state && !atomic_load_explicit(&batch->cancelled, memory_order_relaxed)) {
+        const int index = atomic_fetch_add_explicit(&batch->nextFile, 1, memory_order_relaxed);
+        if (index >= batch->count) {
+            break;
+        }
+        FileAnalysisResult result;
+        memset(&result, 0, sizeof(result));
+        result.index = index;
+        result.path = batch->paths[index];
+        char* error = NULL;
+        if (!file_analysis_measure(batch, batch->paths[index], state, &result, &error)) {
+            break;
+        }
+
+        pthread_mutex_lock(&batch->mutex);
+        batch->errors[index] = error;
+        result.error = error;
+        batch->results[batch->produced++] = result;
+        pthread_cond_broadcast(&batch->reported);
+        pthread_mutex_unlock(&batch->mutex);
+    }
+    free(state);
+
+    pthread_mutex_lock(&batch->mutex);
+    batch->running--;
+    pthread_cond_broadcast(&batch->reported);
+    pthread_mutex_unlock(&batch->mutex);
+    return NULL;
+}
+
+static void file_analysis_free(FileAnalysisBatch* batch) {
+    for (int i = 0; i < batch->count; i++) {
+        free(batch->paths ? batch->paths[i] : NULL);
+        free(batch->errors ? batch->errors[i] : NULL);
+    }
+    free(batch->paths);
+    free(batch->errors);
+    free(batch->results);
+    free(batch->workers);
+    pthread_cond_destroy(&batch->reported);
+    pthread_mutex_destroy(&batch->mutex);
+    free(batch);
+}
+
+// ==============================================
+// Time stretch unit
+// ==============================================
+
+// Playback rate runs through wsola.h in an AUAudioUnit of our own, registered
+// in-process and hosted as an AVAudioUnitTimeEffect in front of the pitch
+// shift unit, which only shifts pitch. The render block works on
+// a C kernel it captures, so it never messages Objective-C objects. At rate 1
+// it plays out what the stretcher holds, which continues the input exactly,
+// and then pulls upstream straight into the output.
+typedef struct {
+    WsolaState wsola;
+    _Atomic float rate;
+    double sampleRate;
+    PlayheadSlot lookahead;    // Input frames held back at the end of each cycle
+    AudioBufferList* pull;     // One buffer per channel into the first planes
+    float* planes;             // Pulled input then output, maxFrames per channel
+    AudioTimeStamp inputTime;  // Sample time of the next frame pulled
+    bool bypassing;            // Routed around: playing the held frames, then the input
+    int held;                  // Frames the stretcher held when routed around
+    int drained;               // Of those, played since
+    _Atomic bool elided;       // The last cycle was the input as it is
+} TimeStretchKernel;
+
+static const AudioComponentDescription timeStretchDescription = {
+    .componentType = kAudioUnitType_FormatConverter,
+    .componentSubType = 'wsla',
+    .componentManufacturer = 'MacA',
+    .componentFlags = 0,
+    .componentFlagsMask = 0,
+};
+
+// Pull `frames` from upstream into planes `stride` apart (silence if upstream
+// fails) and move the unit's input clock on
+static void time_unit_pull(AudioBufferList* pull, AudioTimeStamp* inputTime, float* planes, int channelCount,
+                           int stride, int frames, AURenderPullInputBlock pullInputBlock) {
+    for (int c = 0; c < channelCount; c++) {
+        pull->mBuffers[c].mNumberChannels = 1;
+        pull->mBuffers[c].mDataByteSize = (UInt32)(frames * sizeof(float));
+        pull->mBuffers[c].mData = planes + (size_t)c * stride;
+    }
+    AudioUnitRenderActionFlags pullFlags = 0;
+    const bool pulled = pullInputBlock(&pullFlags, inputTime, (AUAudioFrameCount)frames, 0, pull) == noErr;
+    for (int c = 0; c < channelCount; c++) {
+        float* plane = planes + (size_t)c * stride;
+        if (!pulled) {
+            memset(plane, 0, (size_t)frames * sizeof(float));
+        } else if (pull->mBuffers[c].mData != plane) {
+            memcpy(plane, pull->mBuffers[c].mData, (size_t)frames * sizeof(float));  // Upstream's own buffers
+        }
+    }
+    inputTime->mSampleTime += frames;
+}
+
+static void time_stretch_kernel_release(TimeStretchKernel* kernel) {
+    wsola_free(&kernel->wsola);
+    free(kernel->pull);
+    free(kernel->planes);
+    kernel->pull = NULL;
+    kernel->planes = NULL;
+}
+
+static bool time_stretch_kernel_prepare(TimeStretchKernel* kernel, double sampleRate, int channelCount,
+                                        int maxFrames) {
+    time_stretch_kernel_release(kernel);
+    if (wsola_init(&kernel->wsola, sampleRate, channelCount, maxFrames)) {
+        return false;
+    }
+    kernel->sampleRate = sampleRate;
+    kernel->pull = malloc(offsetof(AudioBufferList, mBuffers) + (size_t)channelCount * sizeof(AudioBuffer));
+    kernel->planes = malloc((size_t)(2 * channelCount * maxFrames) * sizeof(float));
+    if (!kernel->pull || !kernel->planes) {
+        time_stretch_kernel_release(kernel);
+        return false;
+    }
+    kernel->pull->mNumberBuffers = (UInt32)channelCount;
+    kernel->bypassing = false;
+    memset(&kernel->inputTime, 0, sizeof(kernel->inputTime));
+    kernel->inputTime.mFlags = kAudioTimeStampSampleTimeValid;
+    return true;
+}
+
+// Synthesize until `frames` are finished, pulling whole blocks as grains need them
+static void time_stretch_kernel_fill(TimeStretchKernel* kernel, int frames, double speed,
+                                     AURenderPullInputBlock pullInputBlock) {
+    WsolaState* s = &kernel->wsola;
+    while (wsola_available(s) < frames) {
+        if (wsola_input_needed(s, speed) == 0) {
+            wsola_synthesize(s, speed);
+            continue;
+        }
+        time_unit_pull(kernel->pull, &kernel->inputTime, kernel->planes, s->channelCount, s->maxFrames, s->maxFrames,
+                       pullInputBlock);
+        wsola_write(s, kernel->planes, s->maxFrames, s->maxFrames);
+    }
+}
+
+// Pull whole blocks from upstream until the output is covered; upstream nodes
+// see the same slice size the engine renders in, or, routed around, the
+// engine's own slices
+static AUAudioUnitStatus time_stretch_kernel_render(TimeStretchKernel* kernel, AudioUnitRenderActionFlags* actionFlags,
+                                                    const AudioTimeStamp* timestamp, AUAudioFrameCount frameCount,
+                                                    AudioBufferList* outputData, AURenderPullInputBlock pullInputBlock) {
+    WsolaState* s = &kernel->wsola;
+    if (!s->channelCount || !pullInputBlock) {
+        return kAudioUnitErr_Uninitialized;
+    }
+    if ((int)frameCount > s->maxFrames) {
+        return kAudioUnitErr_TooManyFramesToProcess;
+    }
+    if (outputData->mNumberBuffers != (UInt32)s->channelCount) {
+        return kAudioUnitErr_FormatNotSupported;
+    }
+
+    const int frames = (int)frameCount;
+    const int chunk = s->maxFrames;
+    float* rendered = kernel->planes + (size_t)s->channelCount * chunk;
+    const double speed = (double)atomic_load_explicit(&kernel->rate, memory_order_relaxed);
+    double lookahead = 0.0;
+    double heard = 1.0;  // Input frames per output frame
+    if (speed == 1.0) {
+        if (!kernel->bypassing) {
+            kernel->bypassing = true;
+            kernel->held = wsola_held(s);
+            kernel->drained = 0;
+        }
+        const int count = MIN(frames, kernel->held - kernel->drained);
+        atomic_store_explicit(&kernel->elided, count == 0, memory_order_relaxed);
+        if (count == 0) {
+            // Routed around: the input as it is
+            const AUAudioUnitStatus status =
+                pullInputBlock(actionFlags, &kernel->inputTime, frameCount, 0, outputData);
+            kernel->inputTime.mSampleTime += frames;
+            playhead_publish(&kernel->lookahead, (int64_t)timestamp->mSampleTime, 0.0, 0.0, 1.0, 0, 0.0, 0.0,
+                             playhead_clock_ns(), true);
+            return status;
+        }
+        wsola_read_held(s, kernel->drained, rendered, chunk, count);
+        kernel->drained += count;
+        if (count < frames) {
+            time_unit_pull(kernel->pull, &kernel->inputTime, rendered + count, s->channelCount, chunk, frames - count,
+                           pullInputBlock);
+        }
+        lookahead = kernel->held - kernel->drained;
+    } else {
+        atomic_store_explicit(&kernel->elided, false, memory_order_relaxed);
+        if (kernel->bypassing) {
+            // Back in: past the held frames already played (at rate 1 the
+            // stretcher plays exactly those), or from the input's next frame
+            kernel->bypassing = false;
+            if (kernel->drained == kernel->held) {
+                wsola_reset(s);
+            }
+            for (int skipped = 0; kernel->drained < kernel->held && skipped < kernel->drained; skipped += chunk) {
+                const int count = MIN(chunk, kernel->drained - skipped);
+                time_stretch_kernel_fill(kernel, count, 1.0, pullInputBlock);
+                wsola_read(s, rendered, chunk, count);
+            }
+        }
+        time_stretch_kernel_fill(kernel, frames, speed, pullInputBlock);
+        wsola_read(s, rendered, chunk, frames);
+        lookahead = wsola_lookahead(s);
+        heard = s->speed;
+    }
+
+    for (int c = 0; c < s->channelCount; c++) {
+        AudioBuffer* buffer = &outputData->mBuffers[c];
+        if (!buffer->mData) {
+            buffer->mData = rendered + (size_t)c * chunk;  // Render in place
+        } else {
+            memcpy(buffer->mData, rendered + (size_t)c * chunk, (size_t)frames * sizeof(float));
+        }
+        buffer->mDataByteSize = (UInt32)(frames * sizeof(float));
+    }
+    playhead_publish(&kernel->lookahead, (int64_t)timestamp->mSampleTime, lookahead, 0.0, heard, 0, 0.0, 0.0,
+                     playhead_clock_ns(), true);
+    return noErr;
+}
+
+@interface MacAudioTimeStretchUnit : AUAudioUnit
+@property (nonatomic, readonly) TimeStretchKernel* kernel;
+@end
+
+@implementation MacAudioTimeStretchUnit {
+    AUAudioUnitBusArray* _inputBusArray;
+    AUAudioUnitBusArray* _outputBusArray;
+    TimeStretchKernel* _kernel;
+}
+
+- (instancetype)initWithComponentDescription:(AudioComponentDescription)componentDescription
+                                     options:(AudioComponentInstantiationOptions)options
+                                       error:(NSError**)outError {
+    self = [super initWithComponentDescription:componentDescription options:options error:outError];
+    if (!self) {
+        return nil;
+    }
+    AVAudioFormat* format = [[AVAudioFormat alloc] initStandardFormatWithSampleRate:44100.0 channels:2];
+    AUAudioUnitBus* input = [[AUAudioUnitBus alloc] initWithFormat:format error:outError];
+    AUAudioUnitBus* output = [[AUAudioUnitBus alloc] initWithFormat:format error:outError];
+    _kernel = calloc(1, sizeof(TimeStretchKernel));
+    if (!input || !output || !_kernel) {
+        return nil;
+    }
+    input.maximumChannelCount = WSOLA_MAX_CHANNELS;
+    output.maximumChannelCount = WSOLA_MAX_CHANNELS;
+    atomic_init(&_kernel->rate, 1.0f);
+    _inputBusArray = [[AUAudioUnitBusArray alloc] initWithAudioUnit:self busType:AUAudioUnitBusTypeInput busses:@[input]];
+    _outputBusArray = [[AUAudioUnitBusArray alloc] initWithAudioUnit:self busType:AUAudioUnitBusTypeOutput busses:@[output]];
+    self.maximumFramesToRender = 4096;
+    return self;
+}
+
+- (void)dealloc {
+    if (_kernel) {
+        time_stretch_kernel_release(_kernel);
+        free(_kernel);
+    }
+}
+
+- (AUAudioUnitBusArray*)inputBusses {
+    return _inputBusArray;
+}
+
+- (AUAudioUnitBusArray*)outputBusses {
+    return _outputBusArray;
+}
+
+- (TimeStretchKernel*)kernel {
+    return _kernel;
+}
+
+// What the unit holds back, which follows the grains and the rate; the
+// engine's latency compensation delays the other channels by it
+- (NSTimeInterval)latency {
+    PlayheadSlot slot;
+    if (!_kernel->sampleRate || !playhead_read(&_kernel->lookahead, &slot)) {
+        return 0.0;
+    }
+    return slot.frame / _kernel->sampleRate;
+}
+
+- (BOOL)allocateRenderResourcesAndReturnError:(NSError**)outError {
+    if (![super allocateRenderResourcesAndReturnError:outError]) {
+        return NO;
+    }
+    AVAudioFormat* format = _outputBusArray[0].format;
+    if (_inputBusArray[0].format.channelCount != format.channelCount ||
+        _inputBusArray[0].format.sampleRate != format.sampleRate ||
+        !time_stretch_kernel_prepare(_kernel, format.sampleRate, (int)format.channelCount,
+                                     (int)self.maximumFramesToRender)) {
+        if (outError) {
+            *outError = [NSError errorWithDomain:NSOSStatusErrorDomain code:kAudioUnitErr_FailedInitialization userInfo:nil];
+        }
+        [super deallocateRenderResources];
+        return NO;
+    }
+    return YES;
+}
+
+- (void)deallocateRenderResources {
+    time_stretch_kernel_release(_kernel);
+    [super deallocateRenderResources];
+}
+
+- (void)reset {
+    if (_kernel->wsola.channelCount) {
+        wsola_reset(&_kernel->wsola);
+    }
+    _kernel->bypassing = false;
+}
+
+- (BOOL)isElided {
+    return atomic_load_explicit(&_kernel->elided, memory_order_relaxed);
+}
+
+- (AUInternalRenderBlock)internalRenderBlock {
+    TimeStretchKernel* kernel = _kernel;
+    return ^AUAudioUnitStatus(AudioUnitRenderActionFlags* actionFlags, const AudioTimeStamp* timestamp,
+                              AUAudioFrameCount frameCount, NSInteger outputBusNumber, AudioBufferList* outputData,
+                              const AURenderEvent* realtimeEventListHead, AURenderPullInputBlock pullInputBlock) {
+        return time_stretch_kernel_render(kernel, actionFlags, timestamp, frameCount, outputData, pullInputBlock);
+    };
+}
+
+@end
+
+static void time_stretch_register(void) {
+    static dispatch_once_t once;
+    dispatch_once(&once, ^{
+        [AUAudioUnit registerSubclass:[MacAudioTimeStretchUnit class]
+               asComponentDescription:timeStretchDescription
+                                 name:@"MacAudio: Time Stretch"
+                              version:1];
+    });
+}
+
+// The player's stretch kernel, or NULL without time/pitch effects
+static TimeStretchKernel* time_stretch_kernel(AudioPlayer* player) {
+    if (!player->timePitchEnabled || !player->timeStretchUnit) {
+        return NULL;
+    }
+    AVAudioUnitTimeEffect* unit = (__bridge AVAudioUnitTimeEffect*)player->timeStretchUnit;
+    return ((MacAudioTimeStretchUnit*)unit.AUAudioUnit).kernel;
+}
 
-// Player wrapper structure
+// ==============================================
+// Pitch shift unit
+// ==============================================
+
+// Pitch runs through pitchshift.h in a second unit of our own, hosted as an
+// AVAudioUnitTimeEffect behind the time stretch in place of
+// AVAudioUnitTimePitch. Like that unit it reads ahead: its first block after a
+// reset pulls fftSize frames more, so output frame k is still input frame k.
+// The shift and formant switch are atomics the render block reads once per
+// block. New options build a shifter on the caller's thread and hand it over
+// through `pending`; the block swaps it in and leaves the old one in
+// `retired` for the next control call to free. Once it has run unshifted at
+// 0 cents for a whole frame it plays out what it holds and then pulls
+// upstream straight into the output, like the time stretch at rate 1.
 typedef struct {
-    void* playerNode;   // AVAudioPlayerNode*
-    void* audioFile;    // AVAudioFile*
-    void* engine;       // Reference to the engine this player belongs to
-    void* timePitchUnit; // AVAudioUnitTimePitch* (nullable)
-    bool isPlaying;     // Track playing state
-    bool timePitchEnabled; // Whether time/pitch effects are enabled
-} AudioPlayer;
-
-// Function declarations for dynamic library export
-PlayerResult audioplayer_new(void* enginePtr);
-const char* audioplayer_load_file(AudioPlayer* player, const char* filePath);
-const char* audioplayer_play(AudioPlayer* player);
-const char* audioplayer_play_at_time(AudioPlayer* player, double timeSeconds);
-const char* audioplayer_pause(AudioPlayer* player);
-const char* audioplayer_stop(AudioPlayer* player);
-const char* audioplayer_is_playing(AudioPlayer* player, bool* result);
-const char* audioplayer_get_duration(AudioPlayer* player, double* duration);
-const char* audioplayer_get_current_time(AudioPlayer* player, double* currentTime);
-const char* audioplayer_seek_to_time(AudioPlayer* player, double timeSeconds);
-const char* audioplayer_set_volume(AudioPlayer* player, float volume);
-const char* audioplayer_get_volume(AudioPlayer* player, float* volume);
-const char* audioplayer_set_pan(AudioPlayer* player, float pan);
-const char* audioplayer_get_pan(AudioPlayer* player, float* pan);
-const char* audioplayer_set_playback_rate(AudioPlayer* player, float rate);
-const char* audioplayer_get_playback_rate(AudioPlayer* player, float* rate);
-const char* audioplayer_set_pitch(AudioPlayer* player, float pitch);
-const char* audioplayer_get_pitch(AudioPlayer* player, float* pitch);
-const char* audioplayer_enable_time_pitch_effects(AudioPlayer* player);
-const char* audioplayer_disable_time_pitch_effects(AudioPlayer* player);
-const char* audioplayer_is_time_pitch_effects_enabled(AudioPlayer* player, bool* enabled);
-PlayerResult audioplayer_get_time_pitch_node_ptr(AudioPlayer* player);
-PlayerResult audioplayer_get_node_ptr(AudioPlayer* player);
-const char* audioplayer_get_file_info(AudioPlayer* player, double* sampleRate, int* channelCount, const char** format);
-void audioplayer_destroy(AudioPlayer* player);
+    PitchShifter* shifter;           // The render block's, NULL until allocated
+    _Atomic(PitchShifter*) pending;  // Built on a control thread, not yet taken
+    _Atomic(PitchShifter*) retired;  // Replaced by the render block, not yet freed
+    _Atomic float pitch;             // Cents
+    _Atomic bool preserveFormants;
+    int quality;                     // Options the next shifter is built with
+    int fftSize;
+    double sampleRate;
+    int channelCount;
+    PlayheadSlot lookahead;    // Input frames held back at the end of each cycle
+    AudioBufferList* pull;     // One buffer per channel into planes
+    float* planes;             // Pulled input, shifted in place, maxFrames per channel
+    int maxFrames;
+    bool primed;               // Read fftSize frames ahead since the last reset
+    AudioTimeStamp inputTime;  // Sample time of the next frame pulled
+    bool bypassing;            // Routed around: playing the held frames, then the input
+    int held;                  // Frames the shifter held when routed around
+    int drained;               // Of those, played since
+    _Atomic bool elided;       // The last cycle was the input as it is
+} PitchShiftKernel;
 
-// File-based audio analysis - reads the same data that gets played
-const char* audioplayer_analyze_file_segment(AudioPlayer* player, double startTimeSeconds, double durationSeconds, double* rms, int* frameCount);
+static const AudioComponentDescription pitchShiftDescription = {
+    .componentType = kAudioUnitType_FormatConverter,
+    .componentSubType = 'pvoc',
+    .componentManufacturer = 'MacA',
+    .componentFlags = 0,
+    .componentFlagsMask = 0,
+};
+
+static void pitch_shifter_destroy(PitchShifter* shifter) {
+    if (shifter) {
+        pitchshift_free(shifter);
+        free(shifter);
+    }
+}
+
+static const char* pitch_shifter_build(PitchShiftKernel* kernel, int quality, int fftSize, PitchShifter** shifter) {
+    *shifter = malloc(sizeof(PitchShifter));
+    if (!*shifter) {
+        return "Failed to allocate pitch shifter";
+    }
+    const double sampleRate = kernel->sampleRate > 0 ? kernel->sampleRate : 44100.0;
+    const char* error = pitchshift_init(*shifter, sampleRate, MAX(kernel->channelCount, 1), quality, fftSize);
+    if (error) {
+        free(*shifter);
+        *shifter = NULL;
+    }
+    return error;
+}
+
+static void pitch_shift_kernel_release(PitchShiftKernel* kernel) {
+    pitch_shifter_destroy(kernel->shifter);
+    pitch_shifter_destroy(atomic_exchange(&kernel->pending, NULL));
+    pitch_shifter_destroy(atomic_exchange(&kernel->retired, NULL));
+    free(kernel->pull);
+    free(kernel->planes);
+    kernel->shifter = NULL;
+    kernel->pull = NULL;
+    kernel->planes = NULL;
+    kernel->channelCount = 0;
+}
+
+static bool pitch_shift_kernel_prepare(PitchShiftKernel* kernel, double sampleRate, int channelCount, int maxFrames) {
+    pitch_shift_kernel_release(kernel);
+    kernel->sampleRate = sampleRate;
+    kernel->channelCount = channelCount;
+    kernel->maxFrames = maxFrames;
+    kernel->pull = malloc(offsetof(AudioBufferList, mBuffers) + (size_t)channelCount * sizeof(AudioBuffer));
+    kernel->planes = malloc((size_t)(channelCount * maxFrames) * sizeof(float));
+    if (!kernel->pull || !kernel->planes ||
+        pitch_shifter_build(kernel, kernel->quality, kernel->fftSize, &kernel->shifter)) {
+        pitch_shift_kernel_release(kernel);
+        return false;
+    }
+    kernel->pull->mNumberBuffers = (UInt32)channelCount;
+    kernel->primed = false;
+    kernel->bypassing = false;
+    memset(&kernel->inputTime, 0, sizeof(kernel->inputTime));
+    kernel->inputTime.mFlags = kAudioTimeStampSampleTimeValid;
+    return true;
+}
+
+// Called with the unit locked. Without render resources only the options
+// change; the shifter is built when they are allocated.
+static const char* pitch_shift_kernel_configure(PitchShiftKernel* kernel, int quality, int fftSize) {
+    pitch_shifter_destroy(atomic_exchange(&kernel->pending, NULL));  // Never taken
+    PitchShifter* shifter = NULL;
+    const char* error = pitch_shifter_build(kernel, quality, fftSize, &shifter);
+    if (error) {
+        return error;
+    }
+    kernel->quality = quality;
+    kernel->fftSize = fftSize;
+    if (!kernel->channelCount) {
+        pitch_shifter_destroy(shifter);
+        return NULL;
+    }
+    pitch_shifter_destroy(atomic_exchange(&kernel->retired, NULL));
+    atomic_store(&kernel->pending, shifter);
+    return NULL;
+}
+
+// Pull `frames` from upstream and shift them by `cents` in place in the planes
+static void pitch_shift_kernel_pull(PitchShiftKernel* kernel, int frames, float cents,
+                                    AURenderPullInputBlock pullInputBlock) {
+    PitchShifter* s = kernel->shifter;
+    const int stride = kernel->maxFrames;
+    time_unit_pull(kernel->pull, &kernel->inputTime, kernel->planes, s->channelCount, stride, frames, pullInputBlock);
+    pitchshift_run(s, kernel->planes, stride, kernel->planes, stride, frames, cents,
+                   atomic_load_explicit(&kernel->preserveFormants, memory_order_relaxed));
+}
+
+static AUAudioUnitStatus pitch_shift_kernel_render(PitchShiftKernel* kernel, AudioUnitRenderActionFlags* actionFlags,
+                                                   const AudioTimeStamp* timestamp, AUAudioFrameCount frameCount,
+                                                   AudioBufferList* outputData, AURenderPullInputBlock pullInputBlock) {
+    PitchShifter* next = atomic_exchange_explicit(&kernel->pending, NULL, memory_order_acquire);
+    if (next) {
+        atomic_store_explicit(&kernel->retired, kernel->shifter, memory_order_release);
+        kernel->shifter = next;
+        kernel->primed = false;
+        kernel->bypassing = false;
+    }
+    PitchShifter* s = kernel->shifter;
+    if (!s || !pullInputBlock) {
+        return kAudioUnitErr_Uninitialized;
+    }
+    if ((int)frameCount > kernel->maxFrames) {
+        return kAudioUnitErr_TooManyFramesToProcess;
+    }
+    if (outputData->mNumberBuffers != (UInt32)s->channelCount) {
+        return kAudioUnitErr_FormatNotSupported;
+    }
+
+    const int frames = (int)frameCount;
+    const int stride = kernel->maxFrames;
+    const float cents = atomic_load_explicit(&kernel->pitch, memory_order_relaxed);
+    double lookahead = (double)s->fftSize;
+    if (cents == 0.0f && (kernel->bypassing || !kernel->primed || pitchshift_is_identity(s))) {
+        if (!kernel->bypassing) {
+            kernel->bypassing = true;
+            kernel->held = kernel->primed ? s->fftSize : 0;
+            kernel->drained = 0;
+        }
+        const int count = MIN(frames, kernel->held - kernel->drained);
+        atomic_store_explicit(&kernel->elided, count == 0, memory_order_relaxed);
+        if (count == 0) {
+            // Routed around: the input as it is
+            const AUAudioUnitStatus status =
+                pullInputBlock(actionFlags, &kernel->inputTime, frameCount, 0, outputData);
+            kernel->inputTime.mSampleTime += frames;
+            playhead_publish(&kernel->lookahead, (int64_t)timestamp->mSampleTime, 0.0, 0.0, 1.0, 0, 0.0, 0.0,
+                             playhead_clock_ns(), true);
+            return status;
+        }
+        pitchshift_read_held(s, kernel->drained, kernel->planes, stride, count);
+        kernel->drained += count;
+        if (count < frames) {
+            time_unit_pull(kernel->pull, &kernel->inputTime, kernel->planes + count, s->channelCount, stride,
+                           frames - count, pullInputBlock);
+        }
+        lookahead = kernel->held - kernel->drained;
+    } else {
+        atomic_store_explicit(&kernel->elided, false, memory_order_relaxed);
+        if (kernel->bypassing) {
+            // Back in: past the held frames already played, or read ahead afresh
+            kernel->bypassing = false;
+            if (kernel->drained == kernel->held) {
+                pitchshift_clear(s);
+                kernel->primed = false;
+            }
+            for (int skipped = 0; kernel->primed && skipped < kernel->drained; skipped += stride) {
+                pitch_shift_kernel_pull(kernel, MIN(stride, kernel->drained - skipped), 0.0f, pullInputBlock);
+            }
+        }
+        // The silence the shifter starts with is never heard, and at 0 cents
+        // the shift fades in from the unshifted input over the next frame
+        for (int primed = 0; !kernel->primed && primed < s->fftSize; primed += stride) {
+            pitch_shift_kernel_pull(kernel, MIN(stride, s->fftSize - primed), 0.0f, pullInputBlock);
+        }
+        kernel->primed = true;
+        pitch_shift_kernel_pull(kernel, frames, cents, pullInputBlock);
+    }
+
+    for (int c = 0; c < s->channelCount; c++) {
+        AudioBuffer* buffer = &outputData->mBuffers[c];
+        if (!buffer->mData) {
+            buffer->mData = kernel->planes + (size_t)c * stride;  // Render in place
+        } else {
+            memcpy(buffer->mData, kernel->planes + (size_t)c * stride, (size_t)frames * sizeof(float));
+        }
+        buffer->mDataByteSize = (UInt32)(frames * sizeof(float));
+    }
+    playhead_publish(&kernel->lookahead, (int64_t)timestamp->mSampleTime, lookahead, 0.0, 1.0, 0, 0.0, 0.0,
+                     playhead_clock_ns(), true);
+    return noErr;
+}
+
+@interface MacAudioPitchShiftUnit : AUAudioUnit
+@property (nonatomic, readonly) PitchShiftKernel* kernel;
+@end
+
+@implementation MacAudioPitchShiftUnit {
+    AUAudioUnitBusArray* _inputBusArray;
+    AUAudioUnitBusArray* _outputBusArray;
+    PitchShiftKernel* _kernel;
+}
+
+- (instancetype)initWithComponentDescription:(AudioComponentDescription)componentDescription
+                                     options:(AudioComponentInstantiationOptions)options
+                                       error:(NSError**)outError {
+    self = [super initWithComponentDescription:componentDescription options:options error:outError];
+    if (!self) {
+        return nil;
+    }
+    AVAudioFormat* format = [[AVAudioFormat alloc] initStandardFormatWithSampleRate:44100.0 channels:2];
+    AUAudioUnitBus* input = [[AUAudioUnitBus alloc] initWithFormat:format error:outError];
+    AUAudioUnitBus* output = [[AUAudioUnitBus alloc] initWithFormat:format error:outError];
+    _kernel = calloc(1, sizeof(PitchShiftKernel));
+    if (!input || !output || !_kernel) {
+        return nil;
+    }
+    input.maximumChannelCount = PITCH_SHIFT_MAX_CHANNELS;
+    output.maximumChannelCount = PITCH_SHIFT_MAX_CHANNELS;
+    atomic_init(&_kernel->pending, NULL);
+    atomic_init(&_kernel->retired, NULL);
+    atomic_init(&_kernel->pitch, 0.0f);
+    atomic_init(&_kernel->preserveFormants, false);
+    _kernel->quality = PITCH_SHIFT_QUALITY_MEDIUM;
+    _inputBusArray = [[AUAudioUnitBusArray alloc] initWithAudioUnit:self busType:AUAudioUnitBusTypeInput busses:@[input]];
+    _outputBusArray = [[AUAudioUnitBusArray alloc] initWithAudioUnit:self busType:AUAudioUnitBusTypeOutput busses:@[output]];
+    self.maximumFramesToRender = 4096;
+    return self;
+}
+
+- (void)dealloc {
+    if (_kernel) {
+        pitch_shift_kernel_release(_kernel);
+        free(_kernel);
+    }
+}
+
+- (AUAudioUnitBusArray*)inputBusses {
+    return _inputBusArray;
+}
+
+- (AUAudioUnitBusArray*)outputBusses {
+    return _outputBusArray;
+}
+
+- (PitchShiftKernel*)kernel {
+    return _kernel;
+}
+
+// A frame comes out fftSize frames after it went in, at any pitch, or at once
+// while routed around
+- (NSTimeInterval)latency {
+    PlayheadSlot slot;
+    if (!_kernel->sampleRate || !playhead_read(&_kernel->lookahead, &slot)) {
+        return 0.0;
+    }
+    return slot.frame / _kernel->sampleRate;
+}
+
+- (BOOL)allocateRenderResourcesAndReturnError:(NSError**)outError {
+    if (![super allocateRenderResourcesAndReturnError:outError]) {
+        return NO;
+    }
+    AVAudioFormat* format = _outputBusArray[0].format;
+    BOOL prepared = NO;
+    @synchronized(self) {
+        prepared = _inputBusArray[0].format.channelCount == format.channelCount &&
+                   _inputBusArray[0].format.sampleRate == format.sampleRate &&
+                   pitch_shift_kernel_prepare(_kernel, format.sampleRate, (int)format.channelCount,
+                                              (int)self.maximumFramesToRender);
+    }
+    if (!prepared) {
+        if (outError) {
+            *outError = [NSError errorWithDomain:NSOSStatusErrorDomain code:kAudioUnitErr_FailedInitialization userInfo:nil];
+        }
+        [super deallocateRenderResources];
+        return NO;
+    }
+    return YES;
+}
+
+- (void)deallocateRenderResources {
+    @synchronized(self) {
+        pitch_shift_kernel_release(_kernel);
+    }
+    [super deallocateRenderResources];
+}
+
+- (void)reset {
+    if (_kernel->shifter) {
+        pitchshift_clear(_kernel->shifter);
+    }
+    _kernel->primed = false;
+    _kernel->bypassing = false;
+}
+
+- (BOOL)isElided {
+    return atomic_load_explicit(&_kernel->elided, memory_order_relaxed);
+}
+
+- (AUInternalRenderBlock)internalRenderBlock {
+    PitchShiftKernel* kernel = _kernel;
+    return ^AUAudioUnitStatus(AudioUnitRenderActionFlags* actionFlags, const AudioTimeStamp* timestamp,
+                              AUAudioFrameCount frameCount, NSInteger outputBusNumber, AudioBufferList* outputData,
+                              const AURenderEvent* realtimeEventListHead, AURenderPullInputBlock pullInputBlock) {
+        return pitch_shift_kernel_render(kernel, actionFlags, timestamp, frameCount, outputData, pullInputBlock);
+    };
+}
+
+@end
+
+static void pitch_shift_register(void) {
+    static dispatch_once_t once;
+    dispatch_once(&once, ^{
+        [AUAudioUnit registerSubclass:[MacAudioPitchShiftUnit class]
+               asComponentDescription:pitchShiftDescription
+                                 name:@"MacAudio: Pitch Shift"
+                              version:1];
+    });
+}
+
+// The player's pitch shift unit, or nil without time/pitch effects
+static MacAudioPitchShiftUnit* pitch_shift_unit(AudioPlayer* player) {
+    if (!player->timePitchEnabled || !player->timePitchUnit) {
+        return nil;
+    }
+    AVAudioUnitTimeEffect* unit = (__bridge AVAudioUnitTimeEffect*)player->timePitchUnit;
+    return (MacAudioPitchShiftUnit*)unit.AUAudioUnit;
+}
 
 // Create new audio player
 PlayerResult audioplayer_new(void* enginePtr) {
@@ -84,8 +2075,18 @@ PlayerResult audioplayer_new(void* enginePtr) {
         player->audioFile = NULL;
         player->engine = enginePtr;
         player->timePitchUnit = NULL;
+        player->timeStretchUnit = NULL;
         player->isPlaying = false;
         player->timePitchEnabled = false;
+        player->peaks = NULL;
+        player->variants = NULL;
+        player->analysis = NULL;
+        player->stream = NULL;
+        player->decoded = NULL;
+        player->startFrame = 0;
+        player->queue = NULL;
+        player->loop = NULL;
+        player->resamplerQuality = RESAMPLER_QUALITY_MEDIUM;
         
         NSLog(@"Created audio player successfully");
         return (PlayerResult){player, NULL};  // NULL = success
@@ -107,6 +2108,12 @@ const char* audioplayer_load_file(AudioPlayer* player, const char* filePath) {
         NSURL* fileURL = [NSURL fileURLWithPath:path];
         
         @try {
+            // The overview, read-ahead, decoded copy and loop belong to the previous file
+            peaks_job_stop(player);
+            stream_detach(player);
+            decoded_release(player);
+            loop_free(player);
+
             // Release previous audio file if it exists
             if (player->audioFile) {
                 AVAudioFile* oldFile = (__bridge_transfer AVAudioFile*)player->audioFile;
@@ -124,6 +2131,15 @@ const char* audioplayer_load_file(AudioPlayer* player, const char* filePath) {
             
             // Store the audio file
             player->audioFile = (__bridge_retained void*)audioFile;
+            const char* streamError = stream_attach(player);
+            if (streamError) {
+                NSLog(@"Streaming unavailable, playing from memory: %s", streamError);
+            }
+
+            // Format and earlier analysis of this content, if the cache has seen it
+            free(player->analysis);
+            player->analysis = NULL;
+            analysis_cache_count(analysis_cache_load(player, filePath, false));
             
             NSLog(@"Loaded audio file: %@ (%.2f seconds, %.0f Hz, %d channels)", 
                   path, 
@@ -155,10 +2171,43 @@ const char* audioplayer_play(AudioPlayer* player) {
             AVAudioPlayerNode* playerNode = (__bridge AVAudioPlayerNode*)player->playerNode;
             AVAudioFile* audioFile = (__bridge AVAudioFile*)player->audioFile;
             
+            player->startFrame = 0;
+            player_file_started(player);
+            
+            // A loop region plays from memory, streaming or not
+            if (loop_schedule(player, 0)) {
+                [playerNode play];
+                player->isPlaying = true;
+                NSLog(@"Started looping playback");
+                return NULL;  // NULL = success
+            }
+            
+            // Streaming restarts the read-ahead at the top instead
+            PlayerStream* stream = stream_for_playback(player);
+            if (stream) {
+                stream_begin(stream, 0, audioFile.length);
+                [playerNode play];
+                player->isPlaying = true;
+                NSLog(@"Started streaming playback");
+                return NULL;  // NULL = success
+            }
+            
+            // With the PCM cache on, play the decoded copy shared with other players
+            AVAudioPCMBuffer* decoded = decoded_for_playback(player);
+            AVAudioPCMBuffer* view = decoded ? decoded_view(decoded, 0, decoded.frameLength) : nil;
+            if (view) {
+                [playerNode scheduleBuffer:view completionHandler:^{
+                    player_file_done(player);
+                }];
+                [playerNode play];
+                player->isPlaying = true;
+                NSLog(@"Started audio playback from the PCM cache");
+                return NULL;  // NULL = success
+            }
+            
             // Schedule the entire file for playback
             [playerNode scheduleFile:audioFile atTime:nil completionHandler:^{
-                player->isPlaying = false;
-                NSLog(@"Audio playback completed");
+                player_file_done(player);
             }];
             
             // Start playback
@@ -204,9 +2253,9 @@ const char* audioplayer_play_at_time(AudioPlayer* player, double timeSeconds) {
             
             // CRITICAL FIX: Adjust frame count for TimePitch rate to ensure proper playback duration
             AVAudioFrameCount frameCount = remainingFrames;
-            if (player->timePitchEnabled && player->timePitchUnit) {
-                AVAudioUnitTimePitch* timePitchUnit = (__bridge AVAudioUnitTimePitch*)player->timePitchUnit;
-                float rate = timePitchUnit.rate;
+            TimeStretchKernel* timeStretch = time_stretch_kernel(player);
+            if (timeStretch) {
+                float rate = atomic_load(&timeStretch->rate);
                 
                 // CORRECT logic for scheduleSegment with TimePitch:
                 // We need to schedule the right amount of SOURCE material to get desired playback time
@@ -237,13 +2286,47 @@ const char* audioplayer_play_at_time(AudioPlayer* player, double timeSeconds) {
             }
             
             // Schedule playback from the specified frame with rate-adjusted frame count
+            player->startFrame = startFrame;
+            player_file_started(player);
+            if (loop_schedule(player, startFrame)) {
+                [playerNode play];
+                player->isPlaying = true;
+                NSLog(@"Started looping playback from %.2f seconds", timeSeconds);
+                return NULL;  // NULL = success
+            }
+            PlayerStream* stream = stream_for_playback(player);
+            if (stream) {
+                stream_begin(stream, startFrame, startFrame + frameCount);
+                [playerNode play];
+                player->isPlaying = true;
+                NSLog(@"Started streaming playback from %.2f seconds (frameCount: %u)", timeSeconds, frameCount);
+                return NULL;  // NULL = success
+            }
+            AVAudioPCMBuffer* decoded = decoded_for_playback(player);
+            if (decoded) {
+                // The copy is in the node's format, which may differ in rate from the file's
+                const double ratio = decoded.format.sampleRate / audioFile.processingFormat.sampleRate;
+                const AVAudioFramePosition start = MIN(llround((double)startFrame * ratio), (long long)decoded.frameLength);
+                const AVAudioFrameCount frames =
+                    (AVAudioFrameCount)MIN(llround((double)frameCount * ratio), (long long)decoded.frameLength - start);
+                AVAudioPCMBuffer* view = decoded_view(decoded, start, frames);
+                if (view) {
+                    [playerNode scheduleBuffer:view completionHandler:^{
+                        player_file_done(player);
+                    }];
+                    [playerNode play];
+                    player->isPlaying = true;
+                    NSLog(@"Started audio playback from %.2f seconds from the PCM cache (frameCount: %u)", timeSeconds,
+                          frames);
+                    return NULL;  // NULL = success
+                }
+            }
             [playerNode scheduleSegment:audioFile 
                             startingFrame:startFrame 
                             frameCount:frameCount 
                                 atTime:nil 
                      completionHandler:^{
-                player->isPlaying = false;
-                NSLog(@"Audio playbook completed");
+                player_file_done(player);
             }];
             
             [playerNode play];
@@ -290,6 +2373,7 @@ const char* audioplayer_stop(AudioPlayer* player) {
         
         @try {
             AVAudioPlayerNode* playerNode = (__bridge AVAudioPlayerNode*)player->playerNode;
+            stream_end(player);
             [playerNode stop];
             player->isPlaying = false;
             
@@ -337,6 +2421,12 @@ const char* audioplayer_get_duration(AudioPlayer* player, double* duration) {
         return "No audio file loaded";
     }
     
+    const AnalysisRecord* record = player->analysis;
+    if (record) {
+        *duration = (double)record->frames / record->sampleRate;
+        return NULL;  // NULL = success
+    }
+    
     @try {
         AVAudioFile* audioFile = (__bridge AVAudioFile*)player->audioFile;
         *duration = (double)audioFile.length / audioFile.processingFormat.sampleRate;
@@ -349,7 +2439,7 @@ const char* audioplayer_get_duration(AudioPlayer* player, double* duration) {
     }
 }
 
-// Get current playback time (approximation)
+// Get current playback time (the playhead's position in the file)
 const char* audioplayer_get_current_time(AudioPlayer* player, double* currentTime) {
     if (!player || !currentTime) {
         return "Invalid parameters";
@@ -357,48 +2447,377 @@ const char* audioplayer_get_current_time(AudioPlayer* player, double* currentTim
     
     *currentTime = 0.0;
     
+    PlayheadState state;
+    const char* error = audioplayer_get_playhead(player, &state);
+    if (error) {
+        return error;
+    }
+    *currentTime = state.position;
+    return NULL;  // NULL = success
+}
+
+// AVAudioPlayerNode publishes its render timestamps itself: player time counts
+// the frames it rendered since play, at its output rate. The time stretch unit
+// pulls those at `rate` and holds back its published lookahead; the pitch
+// shift unit after it holds back its own, in frames of the stretched output.
+const char* audioplayer_get_playhead(AudioPlayer* player, PlayheadState* state) {
+    if (!player || !state) {
+        return "Invalid parameters";
+    }
+    
+    memset(state, 0, sizeof(*state));
+    
     if (!player->playerNode || !player->audioFile) {
         return "Player node or audio file is null";
     }
-    
-    @try {
+    
+    @autoreleasepool {
+        @try {
+            AVAudioPlayerNode* playerNode = (__bridge AVAudioPlayerNode*)player->playerNode;
+            AVAudioFile* audioFile = (__bridge AVAudioFile*)player->audioFile;
+            const double fileRate = audioFile.processingFormat.sampleRate;
+            
+            double rate = 1.0;
+            double latency = 0.0;
+            TimeStretchKernel* timeStretch = time_stretch_kernel(player);
+            MacAudioPitchShiftUnit* pitchShiftUnit = pitch_shift_unit(player);
+            if (timeStretch && pitchShiftUnit) {
+                PlayheadSlot stretch;
+                rate = atomic_load(&timeStretch->rate);
+                latency = pitchShiftUnit.latency * rate;
+                if (timeStretch->sampleRate > 0 && playhead_read(&timeStretch->lookahead, &stretch)) {
+                    rate = stretch.speed;
+                    latency = stretch.frame / timeStretch->sampleRate + pitchShiftUnit.latency * stretch.speed;
+                }
+            }
+            
+            double frame = (double)player->startFrame;
+            uint64_t hostTime = playhead_clock_ns();
+            AVAudioTime* nodeTime = playerNode.lastRenderTime;
+            AVAudioTime* playerTime = nodeTime ? [playerNode playerTimeForNodeTime:nodeTime] : nil;
+            if (playerTime && playerTime.isSampleTimeValid && playerTime.sampleRate > 0) {
+                const double played = (double)playerTime.sampleTime / playerTime.sampleRate - latency;
+                frame += MAX(0.0, played) * fileRate;
+                if (nodeTime.isHostTimeValid) {
+                    hostTime = (uint64_t)([AVAudioTime secondsForHostTime:nodeTime.hostTime] * 1e9);
+                }
+            }
+            // Schedules from before the loop end run into the region and round it
+            const PlayerLoop* loop = player->loop;
+            if (loop && player->startFrame < loop->end && frame >= (double)loop->end) {
+                const double length = (double)(loop->end - loop->start);
+                state->loops = (int64_t)floor((frame - (double)loop->start) / length);
+                frame = (double)loop->start + fmod(frame - (double)loop->start, length);
+            }
+            frame = MIN(frame, (double)audioFile.length);
+            
+            state->frame = (int64_t)frame;
+            state->position = frame / fileRate;
+            state->rate = rate;
+            state->hostTime = hostTime;
+            state->playing = player->isPlaying && playerNode.isPlaying;
+            return NULL;  // NULL = success
+        }
+        @catch (NSException* exception) {
+            NSLog(@"Exception getting playhead: %@", exception.reason);
+            return "Failed to get playhead";
+        }
+    }
+}
+
+uint64_t playhead_host_time(void) {
+    return playhead_clock_ns();
+}
+
+// Seek to specific time (stop and play from time)
+const char* audioplayer_seek_to_time(AudioPlayer* player, double timeSeconds) {
+    @autoreleasepool {
+        if (!player) {
+            return "Player is null";
+        }
+        
+        if (timeSeconds < 0.0) {
+            return "Time cannot be negative";
+        }
+        
+        // Stop current playback
+        const char* stopResult = audioplayer_stop(player);
+        if (stopResult) {
+            return stopResult;
+        }
+        
+        // Start playback from the new time
+        return audioplayer_play_at_time(player, timeSeconds);
+    }
+}
+
+// AVAudioPlayerNode cannot drop what it has already scheduled, so here a seek
+// still flushes the node and reschedules from the target; the crossfade is
+// validated but not applied. Streaming players restart their read-ahead at the
+// target frame, which play_at_time waits for before starting the node.
+const char* audioplayer_seek(AudioPlayer* player, double timeSeconds, double crossfadeSeconds) {
+    if (!player || !player->playerNode) {
+        return "Player or player node is null";
+    }
+    if (!player->audioFile) {
+        return "No audio file loaded";
+    }
+    if (!(crossfadeSeconds >= 0.0 && crossfadeSeconds <= AUDIOPLAYER_MAX_SEEK_CROSSFADE)) {
+        return "Crossfade must be between 0 and 0.1 seconds";
+    }
+    PlayerQueue* queue = player->queue;
+    if (queue) {
+        pthread_mutex_lock(&queue->mutex);
+        const bool queuedPlays = queue->fileDone && queue_unfinished(queue) > 0;
+        pthread_mutex_unlock(&queue->mutex);
+        if (queuedPlays) {
+            return "Cannot seek while a queued file plays";
+        }
+        queue_flush(player, false);  // Keep the queue through the reschedule
+    }
+    const char* result = audioplayer_seek_to_time(player, timeSeconds);
+    if (queue) {
+        pthread_mutex_lock(&queue->mutex);
+        queue_hand(player, queue);
+        pthread_mutex_unlock(&queue->mutex);
+    }
+    return result;
+}
+
+// Decode one pass of the region now; a playing player is rescheduled from
+// its playhead (see Loop regions)
+const char* audioplayer_set_loop(AudioPlayer* player, int64_t startFrame, int64_t endFrame, double crossfadeSeconds) {
+    @autoreleasepool {
+        if (!player || !player->playerNode) {
+            return "Player or player node is null";
+        }
+        if (!player->audioFile) {
+            return "No audio file loaded";
+        }
+        AVAudioFile* audioFile = (__bridge AVAudioFile*)player->audioFile;
+        if (startFrame < 0 || endFrame <= startFrame || endFrame > audioFile.length) {
+            return "Loop region must lie within the file and end after it starts";
+        }
+        if (!(crossfadeSeconds >= 0.0 && crossfadeSeconds <= AUDIOPLAYER_MAX_LOOP_CROSSFADE)) {
+            return "Crossfade must be between 0 and 10 seconds";
+        }
+        const int64_t crossfadeFrames = llround(crossfadeSeconds * audioFile.processingFormat.sampleRate);
+        if (crossfadeFrames > startFrame || crossfadeFrames > endFrame - startFrame) {
+            return "Crossfade must fit before the loop start and within the loop";
+        }
+
+        @try {
+            AVAudioPCMBuffer* pass = loop_buffer_create(player, startFrame, endFrame, crossfadeFrames);
+            PlayerLoop* loop = calloc(1, sizeof(PlayerLoop));
+            if (!pass || !loop) {
+                free(loop);
+                return "Failed to decode the loop region";
+            }
+            loop->start = startFrame;
+            loop->end = endFrame;
+            loop->crossfadeFrames = crossfadeFrames;
+            loop->buffer = (__bridge_retained void*)pass;
+            NSLog(@"Looping frames %lld to %lld (crossfade: %lld frames)", (long long)startFrame, (long long)endFrame,
+                  (long long)crossfadeFrames);
+            return loop_replace(player, loop);
+        }
+        @catch (NSException* exception) {
+            NSLog(@"Exception setting loop: %@", exception.reason);
+            return "Failed to set loop";
+        }
+    }
+}
+
+const char* audioplayer_clear_loop(AudioPlayer* player) {
+    @autoreleasepool {
+        if (!player || !player->playerNode) {
+            return "Player or player node is null";
+        }
+        if (!player->loop) {
+            return NULL;  // NULL = success
+        }
+        @try {
+            return loop_replace(player, NULL);
+        }
+        @catch (NSException* exception) {
+            NSLog(@"Exception clearing loop: %@", exception.reason);
+            return "Failed to clear loop";
+        }
+    }
+}
+
+// Decode the item into the node's format now, so handing it over later costs
+// nothing. Items are scheduled back to back on the node, which cannot overlap
+// them, so a crossfade is refused (see Gapless queue).
+const char* audioplayer_queue_file(AudioPlayer* player, const char* filePath, double startSeconds,
+                                   double durationSeconds, double crossfadeSeconds, int64_t* itemId) {
+    @autoreleasepool {
+        if (!player || !player->playerNode) {
+            return "Player or player node is null";
+        }
+        if (!filePath) {
+            return "File path is null";
+        }
+        if (!player->audioFile) {
+            return "No audio file loaded";
+        }
+        if (startSeconds < 0.0) {
+            return "Time cannot be negative";
+        }
+        if (!(crossfadeSeconds >= 0.0 && crossfadeSeconds <= AUDIOPLAYER_MAX_QUEUE_CROSSFADE)) {
+            return "Crossfade must be between 0 and 10 seconds";
+        }
+        if (crossfadeSeconds > 0.0) {
+            return "Crossfading queued items is not supported on macOS";
+        }
+        PlayerStream* stream = player->stream;
+        if (stream && stream->running) {
+            return "Queueing needs streaming off on macOS";  // The I/O thread schedules on the node
+        }
+
+        NSError* error = nil;
+        NSURL* fileURL = [NSURL fileURLWithPath:[NSString stringWithUTF8String:filePath]];
+        AVAudioFile* audioFile = [[AVAudioFile alloc] initForReading:fileURL error:&error];
+        if (error || !audioFile) {
+            NSLog(@"Failed to queue audio file: %@", error.localizedDescription);
+            return "Failed to load audio file";
+        }
+        const double fileRate = audioFile.processingFormat.sampleRate;
+        const int64_t start = (int64_t)(startSeconds * fileRate);
+        const int64_t remaining = audioFile.length - start;
+        const int64_t frames = durationSeconds > 0.0 ? MIN(remaining, (int64_t)(durationSeconds * fileRate)) : remaining;
+        if (frames <= 0) {
+            return "Start time is beyond file duration";
+        }
+
+        AVAudioPlayerNode* playerNode = (__bridge AVAudioPlayerNode*)player->playerNode;
+        AVAudioFormat* nodeFormat = [playerNode outputFormatForBus:0];
+        AVAudioFormat* format = [[AVAudioFormat alloc] initWithCommonFormat:AVAudioPCMFormatFloat32
+                                                                 sampleRate:nodeFormat.sampleRate
+                                                                   channels:nodeFormat.channelCount
+                                                                interleaved:NO];
+        AVAudioPCMBuffer* decoded = format ? decoded_buffer_create(audioFile, format, player->resamplerQuality) : nil;
+        const double ratio = format.sampleRate / fileRate;
+        const AVAudioFramePosition first = MIN(llround((double)start * ratio), (long long)decoded.frameLength);
+        const AVAudioFrameCount count =
+            (AVAudioFrameCount)MIN(llround((double)frames * ratio), (long long)decoded.frameLength - first);
+        AVAudioPCMBuffer* view = decoded ? decoded_view(decoded, first, count) : nil;
+        if (!view) {
+            return "Failed to decode audio file";
+        }
+
+        if (!player->queue) {
+            PlayerQueue* created = calloc(1, sizeof(PlayerQueue));
+            if (!created) {
+                return "Memory allocation failed";
+            }
+            pthread_mutex_init(&created->mutex, NULL);
+            created->nextId = 1;
+            created->fileDone = !player->isPlaying;
+            player->queue = created;
+        }
+        PlayerQueue* queue = player->queue;
+        pthread_mutex_lock(&queue->mutex);
+        queue_reap(queue);
+        if (queue->count == queue->capacity) {
+            const int capacity = queue->capacity ? queue->capacity * 2 : 8;
+            QueueEntry* items = realloc(queue->items, (size_t)capacity * sizeof(QueueEntry));
+            if (!items) {
+                pthread_mutex_unlock(&queue->mutex);
+                return "Memory allocation failed";
+            }
+            queue->items = items;
+            queue->capacity = capacity;
+        }
+        const int64_t id = queue->nextId++;
+        queue->items[queue->count++] = (QueueEntry){id, (__bridge_retained void*)view, 0, false, false};
+        queue_hand(player, queue);
+        if (playerNode.isPlaying) {
+            player->isPlaying = true;  // A player that ran out carries on with this
+        }
+        pthread_mutex_unlock(&queue->mutex);
+
+        if (itemId) {
+            *itemId = id;
+        }
+        NSLog(@"Queued %s as item %lld (%lld frames)", filePath, (long long)id, (long long)frames);
+        return NULL;  // NULL = success
+    }
+}
+
+// Items already handed to the node (the one after the item playing) stay
+const char* audioplayer_queue_clear(AudioPlayer* player) {
+    if (!player || !player->playerNode) {
+        return "Player or player node is null";
+    }
+    PlayerQueue* queue = player->queue;
+    if (!queue) {
+        return NULL;  // Nothing was ever queued
+    }
+    pthread_mutex_lock(&queue->mutex);
+    for (int i = 0; i < queue->count; i++) {
+        if (!queue->items[i].handed) {
+            queue->items[i].finished = true;
+        }
+    }
+    queue_reap(queue);
+    pthread_mutex_unlock(&queue->mutex);
+    return NULL;  // NULL = success
+}
+
+// Flush the node and hand the rest of the queue over again; the crossfade is
+// validated but not applied
+const char* audioplayer_queue_skip(AudioPlayer* player, double crossfadeSeconds) {
+    @autoreleasepool {
+        if (!player || !player->playerNode) {
+            return "Player or player node is null";
+        }
+        if (!(crossfadeSeconds >= 0.0 && crossfadeSeconds <= AUDIOPLAYER_MAX_SEEK_CROSSFADE)) {
+            return "Crossfade must be between 0 and 0.1 seconds";
+        }
         AVAudioPlayerNode* playerNode = (__bridge AVAudioPlayerNode*)player->playerNode;
-        AVAudioFile* audioFile = (__bridge AVAudioFile*)player->audioFile;
-        
-        // Get the last render time (this is an approximation)
-        AVAudioTime* nodeTime = [playerNode lastRenderTime];
-        if (nodeTime && nodeTime.isSampleTimeValid) {
-            *currentTime = (double)nodeTime.sampleTime / audioFile.processingFormat.sampleRate;
+        PlayerQueue* queue = player->queue;
+        if (!player->isPlaying) {
+            return "Nothing is scheduled";
         }
-        
+        stream_end(player);
+        queue_flush(player, true);
+        bool more = false;
+        if (queue) {
+            pthread_mutex_lock(&queue->mutex);
+            queue->fileDone = true;
+            queue_hand(player, queue);
+            more = queue_unfinished(queue) > 0;
+            pthread_mutex_unlock(&queue->mutex);
+        }
+        if (more) {
+            [playerNode play];
+        }
+        player->isPlaying = more;
         return NULL;  // NULL = success
     }
-    @catch (NSException* exception) {
-        NSLog(@"Exception getting current time: %@", exception.reason);
-        return "Failed to get current time";
-    }
 }
 
-// Seek to specific time (stop and play from time)
-const char* audioplayer_seek_to_time(AudioPlayer* player, double timeSeconds) {
+const char* audioplayer_queue_get_status(AudioPlayer* player, PlayerQueueStatus* status) {
+    if (!player || !status || !player->playerNode) {
+        return "Invalid parameters";
+    }
+    memset(status, 0, sizeof(*status));
+    PlayerQueue* queue = player->queue;
+    if (!queue) {
+        return NULL;  // NULL = success
+    }
     @autoreleasepool {
-        if (!player) {
-            return "Player is null";
-        }
-        
-        if (timeSeconds < 0.0) {
-            return "Time cannot be negative";
-        }
-        
-        // Stop current playback
-        const char* stopResult = audioplayer_stop(player);
-        if (stopResult) {
-            return stopResult;
+        pthread_mutex_lock(&queue->mutex);
+        queue_reap(queue);
+        if (queue->fileDone && queue->count > 0) {
+            status->current = queue->items[0].id;
         }
-        
-        // Start playback from the new time
-        return audioplayer_play_at_time(player, timeSeconds);
+        status->pending = queue->count - (status->current ? 1 : 0);
+        status->played = queue->played;
+        pthread_mutex_unlock(&queue->mutex);
     }
+    return NULL;  // NULL = success
 }
 
 // Set volume (0.0 to 1.0)
@@ -508,8 +2927,8 @@ const char* audioplayer_set_playback_rate(AudioPlayer* player, float rate) {
     }
     
     @try {
-        AVAudioUnitTimePitch* timePitchUnit = (__bridge AVAudioUnitTimePitch*)player->timePitchUnit;
-        timePitchUnit.rate = rate;
+        // The stretch unit reads it at its next block
+        atomic_store(&time_stretch_kernel(player)->rate, rate);
         
         NSLog(@"Set playback rate to %.2f", rate);
         return NULL;  // NULL = success
@@ -532,8 +2951,7 @@ const char* audioplayer_get_playback_rate(AudioPlayer* player, float* rate) {
     }
     
     @try {
-        AVAudioUnitTimePitch* timePitchUnit = (__bridge AVAudioUnitTimePitch*)player->timePitchUnit;
-        *rate = timePitchUnit.rate;
+        *rate = atomic_load(&time_stretch_kernel(player)->rate);
         return NULL;  // NULL = success
     }
     @catch (NSException* exception) {
@@ -557,17 +2975,9 @@ const char* audioplayer_set_pitch(AudioPlayer* player, float pitch) {
         return "Pitch must be between -2400 and 2400 cents";
     }
     
-    @try {
-        AVAudioUnitTimePitch* timePitchUnit = (__bridge AVAudioUnitTimePitch*)player->timePitchUnit;
-        timePitchUnit.pitch = pitch;
-        
-        NSLog(@"Set pitch to %.2f cents", pitch);
-        return NULL;  // NULL = success
-    }
-    @catch (NSException* exception) {
-        NSLog(@"Exception setting pitch: %@", exception.reason);
-        return "Failed to set pitch";
-    }
+    // The pitch shift unit reads it at its next block; not logged, as it may change every block
+    atomic_store(&pitch_shift_unit(player).kernel->pitch, pitch);
+    return NULL;  // NULL = success
 }
 
 // Get pitch in cents
@@ -581,19 +2991,111 @@ const char* audioplayer_get_pitch(AudioPlayer* player, float* pitch) {
         return "Time/pitch effects not enabled";
     }
     
-    @try {
-        AVAudioUnitTimePitch* timePitchUnit = (__bridge AVAudioUnitTimePitch*)player->timePitchUnit;
-        *pitch = timePitchUnit.pitch;
-        return NULL;  // NULL = success
+    *pitch = atomic_load(&pitch_shift_unit(player).kernel->pitch);
+    return NULL;  // NULL = success
+}
+
+// Choose the pitch shifter's quality, FFT size and formant preservation
+const char* audioplayer_set_pitch_shift_options(AudioPlayer* player, const PitchShiftOptions* options) {
+    if (!player) {
+        return "Player is null";
     }
-    @catch (NSException* exception) {
-        NSLog(@"Exception getting pitch: %@", exception.reason);
-        *pitch = 0.0f;
-        return "Failed to get pitch";
+    
+    MacAudioPitchShiftUnit* unit = pitch_shift_unit(player);
+    if (!unit) {
+        return "Time/pitch effects not enabled. Call audioplayer_enable_time_pitch_effects() first";
+    }
+    
+    const PitchShiftOptions defaults = {PITCH_SHIFT_QUALITY_MEDIUM, 0, false};
+    if (!options) {
+        options = &defaults;
+    }
+    PitchShiftKernel* kernel = unit.kernel;
+    @synchronized(unit) {
+        if (options->quality != kernel->quality || options->fftSize != kernel->fftSize) {
+            const char* error = pitch_shift_kernel_configure(kernel, options->quality, options->fftSize);
+            if (error) {
+                return error;
+            }
+        }
+        atomic_store(&kernel->preserveFormants, options->preserveFormants);
+    }
+    return NULL;  // NULL = success
+}
+
+// Get the pitch shifter's options and the FFT they give
+const char* audioplayer_get_pitch_shift_options(AudioPlayer* player, PitchShiftOptions* options, PitchShiftInfo* info) {
+    if (!player || !options || !info) {
+        return "Invalid parameters";
+    }
+    
+    MacAudioPitchShiftUnit* unit = pitch_shift_unit(player);
+    if (!unit) {
+        return "Time/pitch effects not enabled";
+    }
+    
+    PitchShiftKernel* kernel = unit.kernel;
+    @synchronized(unit) {
+        int fftSize = 0;
+        int overlap = 0;
+        pitchshift_tier(kernel->quality, &fftSize, &overlap);
+        fftSize = kernel->fftSize ? kernel->fftSize : fftSize;
+        options->quality = kernel->quality;
+        options->fftSize = kernel->fftSize;
+        options->preserveFormants = atomic_load(&kernel->preserveFormants);
+        info->fftSize = fftSize;
+        info->hop = fftSize / overlap;
+        info->latency = fftSize;
+        info->kernel = resampler_kernel_label(resampler_pick_kernel());
+    }
+    return NULL;  // NULL = success
+}
+
+// Choose the quality of the converters that bring the file to the node's rate
+const char* audioplayer_set_resampler_quality(AudioPlayer* player, int quality) {
+    if (!player) {
+        return "Player is null";
+    }
+    if (quality < RESAMPLER_QUALITY_LOW || quality > RESAMPLER_QUALITY_BEST) {
+        return "Unknown resampler quality";
     }
+    
+    player->resamplerQuality = quality;
+    return NULL;  // NULL = success
+}
+
+const char* audioplayer_get_resampler_quality(AudioPlayer* player, int* quality) {
+    if (!player || !quality) {
+        return "Invalid parameters";
+    }
+    
+    *quality = player->resamplerQuality;
+    return NULL;  // NULL = success
 }
 
-// Enable time/pitch effects by inserting AVAudioUnitTimePitch between player and output
+// Detach and release the pitch shift and time stretch units
+static void time_units_release(AudioPlayer* player) {
+    AVAudioEngine* engine = (__bridge AVAudioEngine*)player->engine;
+    if (player->timePitchUnit) {
+        AVAudioUnitTimeEffect* timePitchUnit = (__bridge_transfer AVAudioUnitTimeEffect*)player->timePitchUnit;
+        if (engine && timePitchUnit.engine) {
+            [engine detachNode:timePitchUnit];
+        }
+        timePitchUnit = nil;
+        player->timePitchUnit = NULL;
+    }
+    if (player->timeStretchUnit) {
+        AVAudioUnitTimeEffect* timeStretchUnit = (__bridge_transfer AVAudioUnitTimeEffect*)player->timeStretchUnit;
+        if (engine && timeStretchUnit.engine) {
+            [engine detachNode:timeStretchUnit];
+        }
+        timeStretchUnit = nil;
+        player->timeStretchUnit = NULL;
+    }
+}
+
+// Enable time/pitch effects: a time stretch unit for rate in front of a pitch
+// shift unit, both attached and wired up by the caller
 const char* audioplayer_enable_time_pitch_effects(AudioPlayer* player) {
     @autoreleasepool {
         if (!player || !player->playerNode || !player->engine) {
@@ -608,17 +3110,24 @@ const char* audioplayer_enable_time_pitch_effects(AudioPlayer* player) {
             AVAudioEngine* engine = (__bridge AVAudioEngine*)player->engine;
             AVAudioPlayerNode* playerNode = (__bridge AVAudioPlayerNode*)player->playerNode;
             
-            // Create the TimePitch unit
-            AVAudioUnitTimePitch* timePitchUnit = [[AVAudioUnitTimePitch alloc] init];
-            if (!timePitchUnit) {
-                return "Failed to create TimePitch unit";
+            // Create the pitch shift unit and the time stretch unit
+            time_stretch_register();
+            pitch_shift_register();
+            AVAudioUnitTimeEffect* timePitchUnit =
+                [[AVAudioUnitTimeEffect alloc] initWithAudioComponentDescription:pitchShiftDescription];
+            AVAudioUnitTimeEffect* timeStretchUnit =
+                [[AVAudioUnitTimeEffect alloc] initWithAudioComponentDescription:timeStretchDescription];
+            if (!timePitchUnit || !timeStretchUnit) {
+                return "Failed to create time/pitch units";
             }
             
-            // Attach the TimePitch unit to the engine
+            // Attach both units to the engine
             [engine attachNode:timePitchUnit];
+            [engine attachNode:timeStretchUnit];
             
-            // Store the TimePitch unit reference
+            // Store the unit references
             player->timePitchUnit = (__bridge_retained void*)timePitchUnit;
+            player->timeStretchUnit = (__bridge_retained void*)timeStretchUnit;
             player->timePitchEnabled = true;
             
             NSLog(@"Enabled time/pitch effects - ready for rate and pitch adjustments");
@@ -626,12 +3135,13 @@ const char* audioplayer_enable_time_pitch_effects(AudioPlayer* player) {
         }
         @catch (NSException* exception) {
             NSLog(@"Exception enabling time/pitch effects: %@", exception.reason);
+            time_units_release(player);
             return "Failed to enable time/pitch effects";
         }
     }
 }
 
-// Disable time/pitch effects and remove the TimePitch unit
+// Disable time/pitch effects and remove the pitch shift and time stretch units
 const char* audioplayer_disable_time_pitch_effects(AudioPlayer* player) {
     @autoreleasepool {
         if (!player) {
@@ -648,15 +3158,8 @@ const char* audioplayer_disable_time_pitch_effects(AudioPlayer* player) {
                 audioplayer_stop(player);
             }
             
-            // Remove TimePitch unit from engine
-            if (player->timePitchUnit && player->engine) {
-                AVAudioEngine* engine = (__bridge AVAudioEngine*)player->engine;
-                AVAudioUnitTimePitch* timePitchUnit = (__bridge_transfer AVAudioUnitTimePitch*)player->timePitchUnit;
-                
-                [engine detachNode:timePitchUnit];
-                timePitchUnit = nil;
-                player->timePitchUnit = NULL;
-            }
+            // Remove the pitch shift and time stretch units from the engine
+            time_units_release(player);
             
             player->timePitchEnabled = false;
             
@@ -680,7 +3183,7 @@ const char* audioplayer_is_time_pitch_effects_enabled(AudioPlayer* player, bool*
     return NULL;  // NULL = success
 }
 
-// Get the TimePitch unit node pointer (for connecting in audio chain)
+// Get the pitch shift unit node pointer (for connecting in audio chain)
 PlayerResult audioplayer_get_time_pitch_node_ptr(AudioPlayer* player) {
     if (!player) {
         return (PlayerResult){NULL, "Player is null"};
@@ -693,6 +3196,38 @@ PlayerResult audioplayer_get_time_pitch_node_ptr(AudioPlayer* player) {
     return (PlayerResult){player->timePitchUnit, NULL};  // NULL = success
 }
 
+// Get the time stretch unit node pointer (connected between player and pitch shift unit)
+PlayerResult audioplayer_get_time_stretch_node_ptr(AudioPlayer* player) {
+    if (!player) {
+        return (PlayerResult){NULL, "Player is null"};
+    }
+    
+    if (!player->timePitchEnabled || !player->timeStretchUnit) {
+        return (PlayerResult){NULL, "Time/pitch effects not enabled"};
+    }
+    
+    return (PlayerResult){player->timeStretchUnit, NULL};  // NULL = success
+}
+
+// Get what the time stretch unit held back at the end of its last block
+const char* audioplayer_get_time_stretch_latency(AudioPlayer* player, double* seconds) {
+    if (!player || !seconds) {
+        return "Invalid parameters";
+    }
+    
+    *seconds = 0.0;
+    TimeStretchKernel* timeStretch = time_stretch_kernel(player);
+    if (!timeStretch) {
+        return "Time/pitch effects not enabled";
+    }
+    
+    PlayheadSlot slot;
+    if (timeStretch->sampleRate > 0 && playhead_read(&timeStretch->lookahead, &slot)) {
+        *seconds = slot.frame / timeStretch->sampleRate;
+    }
+    return NULL;  // NULL = success
+}
+
 // Get the player node pointer (for connecting to other nodes)
 PlayerResult audioplayer_get_node_ptr(AudioPlayer* player) {
     if (!player || !player->playerNode) {
@@ -715,6 +3250,14 @@ const char* audioplayer_get_file_info(AudioPlayer* player, double* sampleRate, i
         return "No audio file loaded";
     }
     
+    const AnalysisRecord* record = player->analysis;
+    if (record) {
+        *sampleRate = record->sampleRate;
+        *channelCount = record->channelCount;
+        *format = record->format;  // Valid until the next load_file or destroy
+        return NULL;  // NULL = success
+    }
+    
     @try {
         AVAudioFile* audioFile = (__bridge AVAudioFile*)player->audioFile;
         *sampleRate = audioFile.processingFormat.sampleRate;
@@ -748,19 +3291,19 @@ void audioplayer_destroy(AudioPlayer* player) {
             audioplayer_stop(player);
         }
         
-        // Release TimePitch unit first (if enabled)
-        if (player->timePitchUnit && player->engine) {
+        // The I/O thread schedules on the player node
+        stream_detach(player);
+        free(player->stream);
+        player->stream = NULL;
+        
+        // Release the pitch shift and time stretch units first (if enabled)
+        if (player->timePitchUnit || player->timeStretchUnit) {
             @try {
-                AVAudioEngine* engine = (__bridge AVAudioEngine*)player->engine;
-                AVAudioUnitTimePitch* timePitchUnit = (__bridge_transfer AVAudioUnitTimePitch*)player->timePitchUnit;
-                
-                [engine detachNode:timePitchUnit];
-                timePitchUnit = nil;
-                player->timePitchUnit = NULL;
-                NSLog(@"Released TimePitch unit");
+                time_units_release(player);
+                NSLog(@"Released time/pitch units");
             }
             @catch (NSException* exception) {
-                NSLog(@"Exception releasing TimePitch unit: %@", exception.reason);
+                NSLog(@"Exception releasing time/pitch units: %@", exception.reason);
             }
         }
         
@@ -784,7 +3327,15 @@ void audioplayer_destroy(AudioPlayer* player) {
             player->playerNode = NULL;
         }
         
-        // Release audio file
+        // The node is gone, so only flushed completions can still arrive
+        queue_destroy(player);
+        
+        // Release audio file, its overview, decoded copy, loop and cached analysis
+        peaks_job_stop(player);
+        decoded_release(player);
+        loop_free(player);
+        free(player->analysis);
+        player->analysis = NULL;
         if (player->audioFile) {
             AVAudioFile* audioFile = (__bridge_transfer AVAudioFile*)player->audioFile;
             audioFile = nil;
@@ -794,6 +3345,7 @@ void audioplayer_destroy(AudioPlayer* player) {
         // Clear engine reference
         player->engine = NULL;
         player->timePitchUnit = NULL;
+        player->timeStretchUnit = NULL;
         player->isPlaying = false;
         player->timePitchEnabled = false;
         
@@ -834,6 +3386,15 @@ const char* audioplayer_analyze_file_segment(AudioPlayer* player, double startTi
                 analysisFrames = (AVAudioFrameCount)(audioFile.length - startFrame);
             }
             
+            // Whole-file results are cached by content
+            const bool wholeFile = startFrame == 0 && analysisFrames == audioFile.length;
+            const AnalysisRecord* cached = wholeFile ? analysis_cache_lookup(player, audioFile, ANALYSIS_CACHE_RMS) : NULL;
+            if (cached) {
+                *rms = cached->rms;
+                *frameCount = (int)analysisFrames;
+                return NULL; // Success
+            }
+            
             // Create buffer for reading file data
             AVAudioPCMBuffer* buffer = [[AVAudioPCMBuffer alloc] initWithPCMFormat:audioFile.processingFormat frameCapacity:analysisFrames];
             if (!buffer) {
@@ -849,28 +3410,33 @@ const char* audioplayer_analyze_file_segment(AudioPlayer* player, double startTi
                 return [[NSString stringWithFormat:@"Failed to read audio data: %@", error.localizedDescription] UTF8String];
             }
             
-            // Calculate RMS from the raw audio data
+            // Calculate RMS from the raw audio data with the shared metering kernel
             float calculatedRMS = 0.0f;
+            float peak = 0.0f;
             int channels = buffer.format.channelCount;
             int frames = (int)buffer.frameLength;
             
             if (frames > 0) {
                 // Analyze all channels and average
                 for (int channel = 0; channel < channels; channel++) {
-                    float* channelData = buffer.floatChannelData[channel];
-                    float channelRMS = 0.0f;
-                    
-                    for (int i = 0; i < frames; i++) {
-                        channelRMS += channelData[i] * channelData[i];
-                    }
-                    channelRMS = sqrtf(channelRMS / frames);
-                    calculatedRMS += channelRMS;
+                    MeterChannelStats stats;
+                    meter_channel(buffer.floatChannelData[channel], frames, &stats);
+                    calculatedRMS += stats.rms;
+                    peak = stats.peak > peak ? stats.peak : peak;
                 }
                 calculatedRMS /= channels; // Average across channels
             }
             
             *rms = (double)calculatedRMS;
             *frameCount = frames;
+            if (wholeFile) {
+                AnalysisRecord update;
+                analysis_describe_file(audioFile, &update);
+                update.items |= ANALYSIS_CACHE_RMS;
+                update.rms = *rms;
+                update.peak = peak;
+                analysis_cache_update(player, audioFile, &update);
+            }
             
             return NULL; // Success
             
@@ -880,6 +3446,479 @@ const char* audioplayer_analyze_file_segment(AudioPlayer* player, double startTi
     }
 }
 
+// EBU R128 loudness of a file segment, read in chunks through the same path as playback
+const char* audioplayer_analyze_loudness(AudioPlayer* player, double startTimeSeconds, double durationSeconds, LoudnessMetrics* metrics) {
+    @autoreleasepool {
+        if (!player || !player->audioFile) {
+            return "No audio file loaded";
+        }
+        if (!metrics) {
+            return "Metrics pointer is null";
+        }
+        if (startTimeSeconds < 0.0 || durationSeconds <= 0.0) {
+            return "Invalid time parameters";
+        }
+
+        @try {
+            AVAudioFile* audioFile = (__bridge AVAudioFile*)player->audioFile;
+            AVAudioFormat* format = audioFile.processingFormat;
+            const double sampleRate = format.sampleRate;
+            const AVAudioFramePosition startFrame = (AVAudioFramePosition)(startTimeSeconds * sampleRate);
+            AVAudioFramePosition remaining = (AVAudioFramePosition)(durationSeconds * sampleRate);
+            if (startFrame + remaining > audioFile.length) {
+                remaining = audioFile.length - startFrame;
+            }
+
+            // Whole-file results are cached by content
+            const bool wholeFile = startFrame == 0 && remaining == audioFile.length;
+            const AnalysisRecord* cached =
+                wholeFile ? analysis_cache_lookup(player, audioFile, ANALYSIS_CACHE_LOUDNESS) : NULL;
+            if (cached) {
+                *metrics = cached->loudness;
+                return NULL; // Success
+            }
+
+            LoudnessState* state = malloc(sizeof(LoudnessState));
+            if (!state) {
+                return "Failed to allocate loudness meter";
+            }
+            loudness_init(state, sampleRate, (int)format.channelCount);
+
+            const AVAudioFrameCount chunkFrames = 65536;
+            AVAudioPCMBuffer* buffer = [[AVAudioPCMBuffer alloc] initWithPCMFormat:format frameCapacity:chunkFrames];
+            if (!buffer) {
+                free(state);
+                return "Failed to create analysis buffer";
+            }
+
+            audioFile.framePosition = startFrame > 0 ? startFrame : 0;
+            while (remaining > 0) {
+                const AVAudioFrameCount frames = remaining < chunkFrames ? (AVAudioFrameCount)remaining : chunkFrames;
+                NSError* error = nil;
+                if (![audioFile readIntoBuffer:buffer frameCount:frames error:&error] || buffer.frameLength == 0) {
+                    if (error) {
+                        free(state);
+                        return [[NSString stringWithFormat:@"Failed to read audio data: %@", error.localizedDescription] UTF8String];
+                    }
+                    break;
+                }
+                loudness_process(state, (const float* const*)buffer.floatChannelData, (int)buffer.frameLength);
+                remaining -= buffer.frameLength;
+            }
+
+            loudness_read(state, metrics);
+            free(state);
+            if (wholeFile) {
+                AnalysisRecord update;
+                analysis_describe_file(audioFile, &update);
+                update.items |= ANALYSIS_CACHE_LOUDNESS;
+                update.loudness = *metrics;
+                analysis_cache_update(player, audioFile, &update);
+            }
+            return NULL; // Success
+
+        } @catch (NSException* exception) {
+            return [[NSString stringWithFormat:@"Exception analyzing loudness: %@", exception.reason] UTF8String];
+        }
+    }
+}
+
+// Start the waveform overview job for the loaded file
+const char* audioplayer_build_peaks(AudioPlayer* player, bool persist) {
+    @autoreleasepool {
+        if (!player || !player->audioFile) {
+            return "No audio file loaded";
+        }
+        PeakJob* existing = player->peaks;
+        if (existing && !atomic_load_explicit(&existing->failed, memory_order_acquire)) {
+            return NULL;  // Already built or building
+        }
+        peaks_job_stop(player);  // Retry after a failure
+
+        AVAudioFile* audioFile = (__bridge AVAudioFile*)player->audioFile;
+        PeakJob* job = calloc(1, sizeof(PeakJob));
+        if (!job) {
+            return "Failed to allocate peaks job";
+        }
+        job->path = strdup(audioFile.url.fileSystemRepresentation);
+        job->channelCount = (int)audioFile.processingFormat.channelCount;
+        job->sampleRate = audioFile.processingFormat.sampleRate;
+        job->frames = audioFile.length;
+        analysis_describe_file(audioFile, &job->identity);
+        job->persist = persist;
+        if (!job->path || pthread_create(&job->thread, NULL, peaks_job_run, job) != 0) {
+            free(job->path);
+            free(job);
+            return "Failed to start peaks job";
+        }
+        player->peaks = job;
+        return NULL;
+    }
+}
+
+const char* audioplayer_get_peaks_status(AudioPlayer* player, PeaksStatus* status) {
+    if (!player || !status) {
+        return "Player or status pointer is null";
+    }
+    memset(status, 0, sizeof(*status));
+    PeakJob* job = player->peaks;
+    if (!job) {
+        return NULL;  // Not requested
+    }
+    const bool failed = atomic_load_explicit(&job->failed, memory_order_acquire);
+    status->ready = atomic_load_explicit(&job->ready, memory_order_acquire);
+    status->building = !failed;
+    status->cached = status->ready && job->cached;
+    status->progress = status->ready || job->frames == 0
+                           ? 1.0
+                           : (double)atomic_load_explicit(&job->progressFrames, memory_order_relaxed) / job->frames;
+    status->channelCount = job->channelCount;
+    status->sampleRate = job->sampleRate;
+    status->frames = job->frames;
+    status->error = failed ? job->error : NULL;
+    return NULL;
+}
+
+// Column-major min/max/RMS columns of a time range, answered from the pyramid
+const char* audioplayer_get_peaks(AudioPlayer* player, double startTime, double duration, int columns, PeakColumn* out,
+                                  int capacity) {
+    if (!player || !player->peaks) {
+        return "Peaks not built";
+    }
+    PeakJob* job = player->peaks;
+    if (!atomic_load_explicit(&job->ready, memory_order_acquire)) {
+        return "Peaks not ready";
+    }
+    if (!out || columns <= 0) {
+        return "Invalid column count";
+    }
+    if (startTime < 0.0 || duration <= 0.0) {
+        return "Invalid time parameters";
+    }
+    if ((int64_t)columns * job->channelCount > capacity) {
+        return "Output buffer too small";
+    }
+    const int64_t start = (int64_t)(startTime * job->sampleRate);
+    const int64_t end = start + (int64_t)(duration * job->sampleRate);
+    peaks_query_columns(&job->pyramid, start, end, columns, out);
+    return NULL;
+}
+
+const char* audioplayer_set_streaming(AudioPlayer* player, bool enabled, int bufferFrames, int bufferCount) {
+    @autoreleasepool {
+        if (!player || !player->playerNode) {
+            return "Player or player node is null";
+        }
+        if (bufferFrames < 0 || bufferCount < 0) {
+            return "Buffer sizes cannot be negative";
+        }
+        stream_detach(player);
+        if (!enabled) {
+            free(player->stream);
+            player->stream = NULL;
+            return NULL;
+        }
+
+        if (!player->stream) {
+            player->stream = calloc(1, sizeof(PlayerStream));
+            if (!player->stream) {
+                return "Failed to create stream";
+            }
+        }
+        PlayerStream* stream = player->stream;
+        stream->bufferFrames = bufferFrames;
+        stream->bufferCount = bufferCount;
+        const char* error = stream_attach(player);
+        if (error) {
+            free(stream);
+            player->stream = NULL;
+            return error;
+        }
+        NSLog(@"Streaming enabled (%d x %d frames)", stream->pool.bufferCount, stream->pool.bufferFrames);
+        return NULL;  // NULL = success
+    }
+}
+
+const char* audioplayer_get_streaming_stats(AudioPlayer* player, StreamingStats* stats) {
+    if (!player || !stats) {
+        return "Invalid parameters";
+    }
+    memset(stats, 0, sizeof(*stats));
+    const PlayerStream* stream = player->stream;
+    if (stream && stream->running) {
+        stream_pool_stats(&stream->pool, stats);
+        stats->mapped = stream->mapped;
+    } else if (stream) {
+        stats->enabled = true;
+        stats->bufferFrames = stream->bufferFrames;
+        stats->bufferCount = stream->bufferCount;
+        stream_pool_sanitize(&stats->bufferFrames, &stats->bufferCount);
+    }
+    return NULL;  // NULL = success
+}
+
+const char* pcm_cache_set_budget(int64_t budgetBytes) {
+    if (budgetBytes < 0) {
+        return "Budget cannot be negative";
+    }
+    pthread_mutex_lock(&pcmCacheMutex);
+    pcmCache.stats.budgetBytes = budgetBytes;
+    pthread_mutex_unlock(&pcmCacheMutex);
+    @autoreleasepool {
+        pcm_cache_shrink();
+    }
+    return NULL;  // NULL = success
+}
+
+const char* pcm_cache_get_stats(PcmCacheStats* stats) {
+    if (!stats) {
+        return "Stats pointer is null";
+    }
+    pthread_mutex_lock(&pcmCacheMutex);
+    *stats = pcmCache.stats;
+    pthread_mutex_unlock(&pcmCacheMutex);
+    return NULL;  // NULL = success
+}
+
+// A variant cannot take over from the node's schedule, so none is rendered
+const char* audioplayer_prepare_variants(AudioPlayer* player, const PlayerVariant* variants, int count, int workers) {
+    (void)variants;
+    (void)count;
+    (void)workers;
+    if (!player) {
+        return "Player is null";
+    }
+    return "Pre-rendered variants are not supported on macOS";
+}
+
+const char* audioplayer_get_variants_status(AudioPlayer* player, PlayerVariantsStatus* status) {
+    if (!player || !status) {
+        return "Player or status pointer is null";
+    }
+    memset(status, 0, sizeof(*status));
+    return NULL;  // Nothing is ever prepared
+}
+
+const char* variant_cache_configure(int64_t budgetBytes, const char* directory, int64_t diskBudgetBytes) {
+    if (budgetBytes < 0 || diskBudgetBytes < 0) {
+        return "Budget cannot be negative";
+    }
+    const bool onDisk = directory && *directory;
+    if (onDisk && diskBudgetBytes <= 0) {
+        return "Disk budget must be positive";
+    }
+    if (onDisk && !analysis_cache_prepare(directory)) {
+        return [[NSString stringWithFormat:@"Failed to create variant cache at %s: %s", directory, strerror(errno)] UTF8String];
+    }
+    char* copy = onDisk ? strdup(directory) : NULL;
+    if (onDisk && !copy) {
+        return "Failed to allocate cache directory";
+    }
+    pthread_mutex_lock(&variantCacheMutex);
+    variantCache.stats.budgetBytes = budgetBytes;
+    free(variantCacheDirectory);
+    variantCacheDirectory = copy;
+    variantDiskBudget = onDisk ? diskBudgetBytes : 0;
+    if (onDisk) {
+        int64_t bytes;
+        int entries;
+        variant_cache_evict(copy, diskBudgetBytes, &bytes, &entries);
+    }
+    pthread_mutex_unlock(&variantCacheMutex);
+    variant_cache_shrink();
+    return NULL;  // NULL = success
+}
+
+const char* variant_cache_get_stats(VariantCacheStats* stats) {
+    if (!stats) {
+        return "Stats pointer is null";
+    }
+    memset(stats, 0, sizeof(*stats));
+    pthread_mutex_lock(&variantCacheMutex);
+    stats->entries = variantCache.stats.entries;
+    stats->inUse = variantCache.stats.inUse;
+    stats->bytes = variantCache.stats.bytes;
+    stats->budgetBytes = variantCache.stats.budgetBytes;
+    stats->hits = variantCache.stats.hits;
+    stats->misses = variantCache.stats.misses;
+    stats->evictions = variantCache.stats.evictions;
+    stats->diskBudgetBytes = variantDiskBudget;
+    if (variantCacheDirectory) {
+        variant_cache_evict(variantCacheDirectory, INT64_MAX, &stats->diskBytes, &stats->diskEntries);  // Just sizes
+    }
+    pthread_mutex_unlock(&variantCacheMutex);
+    return NULL;  // NULL = success
+}
+
+// Open (or move) the process-wide analysis cache
+const char* analysis_cache_open(const char* directory, int64_t maxBytes) {
+    if (!directory || !*directory) {
+        return "Cache directory is empty";
+    }
+    if (maxBytes <= 0) {
+        return "Cache size cap must be positive";
+    }
+    if (!analysis_cache_prepare(directory)) {
+        return [[NSString stringWithFormat:@"Failed to create analysis cache at %s: %s", directory, strerror(errno)] UTF8String];
+    }
+    char* copy = strdup(directory);
+    if (!copy) {
+        return "Failed to allocate cache directory";
+    }
+    pthread_mutex_lock(&analysisCacheMutex);
+    free(analysisCacheDirectory);
+    analysisCacheDirectory = copy;
+    memset(&analysisCacheCounters, 0, sizeof(analysisCacheCounters));
+    analysisCacheCounters.maxBytes = maxBytes;
+    int64_t bytes;
+    int entries;
+    if (analysis_cache_evict(copy, maxBytes, &bytes, &entries) > 0) {
+        analysis_cache_prune_aliases(copy);
+    }
+    pthread_mutex_unlock(&analysisCacheMutex);
+    return NULL;
+}
+
+void analysis_cache_close(void) {
+    pthread_mutex_lock(&analysisCacheMutex);
+    free(analysisCacheDirectory);
+    analysisCacheDirectory = NULL;
+    pthread_mutex_unlock(&analysisCacheMutex);
+}
+
+const char* analysis_cache_get_stats(AnalysisCacheStats* stats) {
+    if (!stats) {
+        return "Stats pointer is null";
+    }
+    pthread_mutex_lock(&analysisCacheMutex);
+    if (!analysisCacheDirectory) {
+        pthread_mutex_unlock(&analysisCacheMutex);
+        return "Analysis cache is not open";
+    }
+    *stats = analysisCacheCounters;
+    analysis_cache_evict(analysisCacheDirectory, INT64_MAX, &stats->bytes, &stats->entries);  // Just sizes
+    pthread_mutex_unlock(&analysisCacheMutex);
+    return NULL;
+}
+
+const char* analysis_cache_clear(void) {
+    pthread_mutex_lock(&analysisCacheMutex);
+    if (!analysisCacheDirectory) {
+        pthread_mutex_unlock(&analysisCacheMutex);
+        return "Analysis cache is not open";
+    }
+    int64_t bytes;
+    int entries;
+    analysis_cache_evict(analysisCacheDirectory, 0, &bytes, &entries);
+    analysis_cache_prune_aliases(analysisCacheDirectory);
+    pthread_mutex_unlock(&analysisCacheMutex);
+    return NULL;
+}
+
+// Analyze files on a worker pool without an engine or player
+const char* file_analysis_start(const char* const* paths, int count, int workers, int flags, FileAnalysisBatch** batch) {
+    if (!batch) {
+        return "Batch pointer is null";
+    }
+    *batch = NULL;
+    if (count < 0 || (count > 0 && !paths)) {
+        return "Invalid path list";
+    }
+    for (int i = 0; i < count; i++) {
+        if (!paths[i]) {
+            return [[NSString stringWithFormat:@"Path %d is null", i] UTF8String];
+        }
+    }
+
+    FileAnalysisBatch* created = calloc(1, sizeof(FileAnalysisBatch));
+    if (!created) {
+        return "Failed to allocate analysis batch";
+    }
+    pthread_mutex_init(&created->mutex, NULL);
+    pthread_cond_init(&created->reported, NULL);
+    created->count = count;
+    created->flags = flags;
+    created->paths = calloc((size_t)count + 1, sizeof(char*));
+    created->errors = calloc((size_t)count + 1, sizeof(char*));
+    created->results = calloc((size_t)count + 1, sizeof(FileAnalysisResult));
+    if (workers <= 0) {
+        workers = (int)sysconf(_SC_NPROCESSORS_ONLN);
+    }
+    workers = workers < count ? workers : count;
+    workers = workers > 0 || count == 0 ? workers : 1;
+    created->workers = calloc((size_t)workers + 1, sizeof(pthread_t));
+    bool ok = created->paths && created->errors && created->results && created->workers;
+    for (int i = 0; ok && i < count; i++) {
+        ok = (created->paths[i] = strdup(paths[i])) != NULL;
+    }
+    if (!ok) {
+        file_analysis_free(created);
+        return "Failed to allocate analysis batch";
+    }
+
+    for (int i = 0; i < workers; i++) {
+        if (pthread_create(&created->workers[i], NULL, file_analysis_run, created) != 0) {
+            break;
+        }
+        created->workerCount++;
+    }
+    if (created->workerCount == 0 && count > 0) {
+        file_analysis_free(created);
+        return "Failed to start analysis workers";
+    }
+    pthread_mutex_lock(&created->mutex);
+    created->running += created->workerCount;
+    pthread_mutex_unlock(&created->mutex);
+    *batch = created;
+    return NULL;
+}
+
+int file_analysis_next(FileAnalysisBatch* batch, FileAnalysisResult* results, int capacity, int timeoutMs) {
+    if (!batch) {
+        return -1;
+    }
+    struct timespec deadline;
+    clock_gettime(CLOCK_REALTIME, &deadline);
+    const int64_t nanoseconds = deadline.tv_nsec + (int64_t)(timeoutMs > 0 ? timeoutMs : 0) * 1000000;
+    deadline.tv_sec += nanoseconds / 1000000000;
+    deadline.tv_nsec = nanoseconds % 1000000000;
+
+    pthread_mutex_lock(&batch->mutex);
+    while (batch->produced == batch->consumed && batch->running > 0) {
+        if (pthread_cond_timedwait(&batch->reported, &batch->mutex, &deadline) != 0) {
+            break;  // Timed out
+        }
+    }
+    int n;
+    if (batch->produced == batch->consumed) {
+        n = batch->running == 0 ? -1 : 0;
+    } else {
+        n = results && capacity > 0 ? batch->produced - batch->consumed : 0;
+        n = n < capacity ? n : capacity;
+        memcpy(results, batch->results + batch->consumed, sizeof(FileAnalysisResult) * (size_t)n);
+        batch->consumed += n;
+    }
+    pthread_mutex_unlock(&batch->mutex);
+    return n;
+}
+
+void file_analysis_cancel(FileAnalysisBatch* batch) {
+    if (batch) {
+        atomic_store_explicit(&batch->cancelled, true, memory_order_relaxed);
+    }
+}
+
+void file_analysis_destroy(FileAnalysisBatch* batch) {
+    if (!batch) {
+        return;
+    }
+    file_analysis_cancel(batch);
+    for (int i = 0; i < batch->workerCount; i++) {
+        pthread_join(batch->workers[i], NULL);
+    }
+    file_analysis_free(batch);
+}
+
 #ifdef __cplusplus
 }
 #endif
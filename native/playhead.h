@@ -0,0 +1,88 @@
+// Playhead snapshots published by the render thread, for both backends.
+//
+// A slot holds where a node was in its source at the end of a render cycle.
+// The render thread (or a control thread that excludes it) is the only writer;
+// any thread reads a consistent snapshot without locking through a sequence
+// counter that is odd while a publish is in progress, retrying if it changed.
+// Fields are accessed with relaxed __atomic operations so a torn read is
+// detected rather than undefined.
+//
+// Header-only like stream.h; builds as C (macOS backend) and C++ (headless).
+
+#ifndef MACAUDIO_PLAYHEAD_H
+#define MACAUDIO_PLAYHEAD_H
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <time.h>
+
+#include "macaudio.h"
+
+typedef struct {
+    uint32_t sequence;  // Odd while being written
+    int64_t cycle;      // Engine sample time of the publishing render cycle
+    double frame;       // Source frame reached at the end of the cycle
+    double origin;      // First frame of the current run (play or seek target)
+    double speed;       // Source frames per rendered frame
+    int64_t loops;      // Loop wraps since origin
+    double loopStart;   // Loop region the wraps went back to, if any
+    double loopLength;
+    uint64_t hostTime;  // playhead_clock_ns() when published
+    bool playing;
+} PlayheadSlot;
+
+// Monotonic clock of every hostTime, in nanoseconds
+static inline uint64_t playhead_clock_ns(void) {
+#ifdef __APPLE__
+    return clock_gettime_nsec_np(CLOCK_UPTIME_RAW);  // mach_absolute_time in ns
+#else
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (uint64_t)now.tv_sec * 1000000000u + (uint64_t)now.tv_nsec;
+#endif
+}
+
+static inline void playhead_publish(PlayheadSlot* slot, int64_t cycle, double frame, double origin, double speed,
+                                    int64_t loops, double loopStart, double loopLength, uint64_t hostTime,
+                                    bool playing) {
+    const uint32_t sequence = __atomic_load_n(&slot->sequence, __ATOMIC_RELAXED);
+    __atomic_store_n(&slot->sequence, sequence + 1, __ATOMIC_RELAXED);
+    __atomic_thread_fence(__ATOMIC_RELEASE);
+    __atomic_store_n(&slot->cycle, cycle, __ATOMIC_RELAXED);
+    __atomic_store(&slot->frame, &frame, __ATOMIC_RELAXED);
+    __atomic_store(&slot->origin, &origin, __ATOMIC_RELAXED);
+    __atomic_store(&slot->speed, &speed, __ATOMIC_RELAXED);
+    __atomic_store_n(&slot->loops, loops, __ATOMIC_RELAXED);
+    __atomic_store(&slot->loopStart, &loopStart, __ATOMIC_RELAXED);
+    __atomic_store(&slot->loopLength, &loopLength, __ATOMIC_RELAXED);
+    __atomic_store_n(&slot->hostTime, hostTime, __ATOMIC_RELAXED);
+    __atomic_store_n(&slot->playing, playing, __ATOMIC_RELAXED);
+    __atomic_store_n(&slot->sequence, sequence + 2, __ATOMIC_RELEASE);
+}
+
+// Copy a consistent snapshot into `out`; false if the writer kept it busy
+static inline bool playhead_read(const PlayheadSlot* slot, PlayheadSlot* out) {
+    for (int attempt = 0; attempt < 1000; attempt++) {
+        const uint32_t before = __atomic_load_n(&slot->sequence, __ATOMIC_ACQUIRE);
+        if (before & 1) {
+            continue;
+        }
+        out->cycle = __atomic_load_n(&slot->cycle, __ATOMIC_RELAXED);
+        __atomic_load(&slot->frame, &out->frame, __ATOMIC_RELAXED);
+        __atomic_load(&slot->origin, &out->origin, __ATOMIC_RELAXED);
+        __atomic_load(&slot->speed, &out->speed, __ATOMIC_RELAXED);
+        out->loops = __atomic_load_n(&slot->loops, __ATOMIC_RELAXED);
+        __atomic_load(&slot->loopStart, &out->loopStart, __ATOMIC_RELAXED);
+        __atomic_load(&slot->loopLength, &out->loopLength, __ATOMIC_RELAXED);
+        out->hostTime = __atomic_load_n(&slot->hostTime, __ATOMIC_RELAXED);
+        out->playing = __atomic_load_n(&slot->playing, __ATOMIC_RELAXED);
+        __atomic_thread_fence(__ATOMIC_ACQUIRE);
+        if (__atomic_load_n(&slot->sequence, __ATOMIC_RELAXED) == before) {
+            out->sequence = before;
+            return true;
+        }
+    }
+    return false;
+}
+
+#endif  // MACAUDIO_PLAYHEAD_H
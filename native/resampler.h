@@ -0,0 +1,514 @@
+// Polyphase windowed-sinc sample-rate converter, shared by both backends.
+//
+// The filter is a Kaiser-windowed sinc whose length and stopband come from a
+// quality preset; its cutoff sits below the lower of the two Nyquist rates so
+// the stopband starts right at it. Rates that are whole numbers with a ratio
+// of at most RESAMPLER_MAX_PHASES output frames per cycle (every pair of the
+// usual 44.1/48/88.2/96/192 kHz rates) get one coefficient row per output
+// phase; any other ratio interpolates linearly between RESAMPLER_INTERP_PHASES
+// rows. Rows are padded to a multiple of 8 taps so the dot products (AVX2+FMA
+// picked at runtime on x86, SSE2, NEON on arm64, scalar fallback) have no tail.
+//
+// Streaming: each channel keeps the input its next outputs still need, so a
+// signal may arrive in blocks of any size. The filter delay is primed with
+// silence, which makes output frame j the input at j * inputRate / outputRate;
+// drain at the end for the last frames.
+//
+// Header-only like meter.h; builds as C (macOS backend) and C++ (headless).
+
+#ifndef MACAUDIO_RESAMPLER_H
+#define MACAUDIO_RESAMPLER_H
+
+#include <math.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "macaudio.h"
+
+#if defined(__x86_64__) || (defined(__i386__) && defined(__SSE2__))
+#define RESAMPLER_X86 1
+#include <immintrin.h>
+#elif defined(__aarch64__) && defined(__ARM_NEON)
+#define RESAMPLER_NEON 1
+#include <arm_neon.h>
+#endif
+
+#define RESAMPLER_MAX_PHASES 1024     // Exact phases up to this many outputs per cycle
+#define RESAMPLER_INTERP_PHASES 512   // Rows interpolated between for other ratios
+#define RESAMPLER_BLOCK_FRAMES 2048   // Input frames taken per refill
+#define RESAMPLER_MAX_RATIO 32.0
+
+#define RESAMPLER_KERNEL_SCALAR 0
+#define RESAMPLER_KERNEL_SSE2 1
+#define RESAMPLER_KERNEL_AVX2 2
+#define RESAMPLER_KERNEL_NEON 3
+
+struct Resampler {
+    int channelCount;
+    int quality;
+    int taps;              // Per row, a multiple of 8
+    int rows;              // Exact phases, or RESAMPLER_INTERP_PHASES + 1 rows to interpolate between
+    bool interpolated;
+    int64_t upsample;      // Exact: outputs per cycle (phases)
+    int64_t downsample;    //        inputs per cycle
+    uint64_t step;         // Interpolated: input frames per output, 32.32 fixed point
+    uint64_t phase;        // Exact: 0 ... upsample - 1; interpolated: 32-bit fraction
+    float* coefficients;   // rows * taps
+    float** history;       // Per channel, `capacity` frames
+    int capacity;
+    int fill;              // Frames held
+    int position;          // First frame under the next output's taps
+    int64_t inputFrames;   // Consumed since reset
+    int64_t outputFrames;  // Produced since reset
+    double ratio;          // Output rate / input rate
+    int kernel;            // RESAMPLER_KERNEL_*
+};
+
+// Taps at the lower of the two rates and stopband attenuation of each preset
+static inline void resampler_preset(int quality, int* taps, double* attenuation) {
+    static const int presetTaps[] = {16, 48, 96, 192};
+    static const double presetAttenuation[] = {60.0, 90.0, 110.0, 130.0};
+    *taps = presetTaps[quality];
+    *attenuation = presetAttenuation[quality];
+}
+
+// Zeroth-order modified Bessel function of the first kind, by its series
+static inline double resampler_bessel_i0(double x) {
+    double sum = 1.0, term = 1.0;
+    for (int k = 1; k < 64 && term > sum * 1e-17; k++) {
+        const double half = x / (2.0 * k);
+        term *= half * half;
+        sum += term;
+    }
+    return sum;
+}
+
+// ---- Dot products over `taps` frames (a multiple of 8) ----
+
+static inline float resampler_dot_scalar(const float* x, const float* h, int taps) {
+    float sum0 = 0.0f, sum1 = 0.0f;
+    for (int k = 0; k < taps; k += 2) {
+        sum0 += x[k] * h[k];
+        sum1 += x[k + 1] * h[k + 1];
+    }
+    return sum0 + sum1;
+}
+
+// Against two rows at once, for interpolating between them
+static inline void resampler_dot2_scalar(const float* x, const float* h0, const float* h1, int taps, float* y0,
+                                         float* y1) {
+    float sum0 = 0.0f, sum1 = 0.0f;
+    for (int k = 0; k < taps; k++) {
+        sum0 += x[k] * h0[k];
+        sum1 += x[k] * h1[k];
+    }
+    *y0 = sum0;
+    *y1 = sum1;
+}
+
+#if RESAMPLER_X86
+
+static inline float resampler_hsum_sse2(__m128 v) {
+    v = _mm_add_ps(v, _mm_movehl_ps(v, v));
+    v = _mm_add_ss(v, _mm_shuffle_ps(v, v, 1));
+    return _mm_cvtss_f32(v);
+}
+
+static inline float resampler_dot_sse2(const float* x, const float* h, int taps) {
+    __m128 sum0 = _mm_setzero_ps(), sum1 = _mm_setzero_ps();
+    for (int k = 0; k < taps; k += 8) {
+        sum0 = _mm_add_ps(sum0, _mm_mul_ps(_mm_loadu_ps(x + k), _mm_loadu_ps(h + k)));
+        sum1 = _mm_add_ps(sum1, _mm_mul_ps(_mm_loadu_ps(x + k + 4), _mm_loadu_ps(h + k + 4)));
+    }
+    return resampler_hsum_sse2(_mm_add_ps(sum0, sum1));
+}
+
+static inline void resampler_dot2_sse2(const float* x, const float* h0, const float* h1, int taps, float* y0,
+                                       float* y1) {
+    __m128 sum0 = _mm_setzero_ps(), sum1 = _mm_setzero_ps();
+    for (int k = 0; k < taps; k += 4) {
+        const __m128 a = _mm_loadu_ps(x + k);
+        sum0 = _mm_add_ps(sum0, _mm_mul_ps(a, _mm_loadu_ps(h0 + k)));
+        sum1 = _mm_add_ps(sum1, _mm_mul_ps(a, _mm_loadu_ps(h1 + k)));
+    }
+    *y0 = resampler_hsum_sse2(sum0);
+    *y1 = resampler_hsum_sse2(sum1);
+}
+
+__attribute__((target("avx2,fma"))) static inline float resampler_hsum_avx2(__m256 v) {
+    return resampler_hsum_sse2(_mm_add_ps(_mm256_castps256_ps128(v), _mm256_extractf128_ps(v, 1)));
+}
+
+__attribute__((target("avx2,fma"))) static inline float resampler_dot_avx2(const float* x, const float* h, int taps) {
+    __m256 sum0 = _mm256_setzero_ps(), sum1 = _mm256_setzero_ps();
+    int k = 0;
+    for (; k + 16 <= taps; k += 16) {
+        sum0 = _mm256_fmadd_ps(_mm256_loadu_ps(x + k), _mm256_loadu_ps(h + k), sum0);
+        sum1 = _mm256_fmadd_ps(_mm256_loadu_ps(x + k + 8), _mm256_loadu_ps(h + k + 8), sum1);
+    }
+    if (k < taps) {
+        sum0 = _mm256_fmadd_ps(_mm256_loadu_ps(x + k), _mm256_loadu_ps(h + k), sum0);
+    }
+    return resampler_hsum_avx2(_mm256_add_ps(sum0, sum1));
+}
+
+__attribute__((target("avx2,fma"))) static inline void resampler_dot2_avx2(const float* x, const float* h0,
+                                                                          const float* h1, int taps, float* y0,
+                                                                          float* y1) {
+    __m256 sum0 = _mm256_setzero_ps(), sum1 = _mm256_setzero_ps();
+    for (int k = 0; k < taps; k += 8) {
+        const __m256 a = _mm256_loadu_ps(x + k);
+        sum0 = _mm256_fmadd_ps(a, _mm256_loadu_ps(h0 + k), sum0);
+        sum1 = _mm256_fmadd_ps(a, _mm256_loadu_ps(h1 + k), sum1);
+    }
+    *y0 = resampler_hsum_avx2(sum0);
+    *y1 = resampler_hsum_avx2(sum1);
+}
+
+static inline int resampler_has_avx2(void) {
+    return __builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma");
+}
+
+#elif RESAMPLER_NEON
+
+static inline float resampler_dot_neon(const float* x, const float* h, int taps) {
+    float32x4_t sum0 = vdupq_n_f32(0.0f), sum1 = vdupq_n_f32(0.0f);
+    for (int k = 0; k < taps; k += 8) {
+        sum0 = vfmaq_f32(sum0, vld1q_f32(x + k), vld1q_f32(h + k));
+        sum1 = vfmaq_f32(sum1, vld1q_f32(x + k + 4), vld1q_f32(h + k + 4));
+    }
+    return vaddvq_f32(vaddq_f32(sum0, sum1));
+}
+
+static inline void resampler_dot2_neon(const float* x, const float* h0, const float* h1, int taps, float* y0,
+                                       float* y1) {
+    float32x4_t sum0 = vdupq_n_f32(0.0f), sum1 = vdupq_n_f32(0.0f);
+    for (int k = 0; k < taps; k += 4) {
+        const float32x4_t a = vld1q_f32(x + k);
+        sum0 = vfmaq_f32(sum0, a, vld1q_f32(h0 + k));
+        sum1 = vfmaq_f32(sum1, a, vld1q_f32(h1 + k));
+    }
+    *y0 = vaddvq_f32(sum0);
+    *y1 = vaddvq_f32(sum1);
+}
+
+#endif
+
+static inline int resampler_pick_kernel(void) {
+#if RESAMPLER_X86
+    return resampler_has_avx2() ? RESAMPLER_KERNEL_AVX2 : RESAMPLER_KERNEL_SSE2;
+#elif RESAMPLER_NEON
+    return RESAMPLER_KERNEL_NEON;
+#else
+    return RESAMPLER_KERNEL_SCALAR;
+#endif
+}
+
+static inline const char* resampler_kernel_label(int kernel) {
+    static const char* labels[] = {"scalar", "sse2", "avx2", "neon"};
+    return labels[kernel];
+}
+
+static inline float resampler_dot(const Resampler* r, const float* x, const float* h) {
+    switch (r->kernel) {
+#if RESAMPLER_X86
+        case RESAMPLER_KERNEL_AVX2:
+            return resampler_dot_avx2(x, h, r->taps);
+        case RESAMPLER_KERNEL_SSE2:
+            return resampler_dot_sse2(x, h, r->taps);
+#elif RESAMPLER_NEON
+        case RESAMPLER_KERNEL_NEON:
+            return resampler_dot_neon(x, h, r->taps);
+#endif
+        default:
+            return resampler_dot_scalar(x, h, r->taps);
+    }
+}
+
+static inline void resampler_dot2(const Resampler* r, const float* x, const float* h0, const float* h1, float* y0,
+                                  float* y1) {
+    switch (r->kernel) {
+#if RESAMPLER_X86
+        case RESAMPLER_KERNEL_AVX2:
+            resampler_dot2_avx2(x, h0, h1, r->taps, y0, y1);
+            return;
+        case RESAMPLER_KERNEL_SSE2:
+            resampler_dot2_sse2(x, h0, h1, r->taps, y0, y1);
+            return;
+#elif RESAMPLER_NEON
+        case RESAMPLER_KERNEL_NEON:
+            resampler_dot2_neon(x, h0, h1, r->taps, y0, y1);
+            return;
+#endif
+        default:
+            resampler_dot2_scalar(x, h0, h1, r->taps, y0, y1);
+    }
+}
+
+// ---- Setup ----
+
+static inline void resampler_free(Resampler* r) {
+    if (r->history) {
+        for (int c = 0; c < r->channelCount; c++) {
+            free(r->history[c]);
+        }
+    }
+    free(r->history);
+    free(r->coefficients);
+    memset(r, 0, sizeof(*r));
+}
+
+// Back to the state after init: silence primed, nothing consumed
+static inline void resampler_clear(Resampler* r) {
+    for (int c = 0; c < r->channelCount; c++) {
+        memset(r->history[c], 0, (size_t)r->capacity * sizeof(float));
+    }
+    r->fill = r->taps / 2 - 1;
+    r->position = 0;
+    r->phase = 0;
+    r->inputFrames = r->outputFrames = 0;
+}
+
+static inline int64_t resampler_gcd(int64_t a, int64_t b) {
+    while (b) {
+        const int64_t t = a % b;
+        a = b;
+        b = t;
+    }
+    return a;
+}
+
+static inline const char* resampler_init(Resampler* r, double inputRate, double outputRate, int channelCount,
+                                         int quality) {
+    memset(r, 0, sizeof(*r));
+    if (!(inputRate > 0.0) || !(outputRate > 0.0)) {
+        return "Sample rates must be positive";
+    }
+    const double ratio = outputRate / inputRate;
+    if (ratio > RESAMPLER_MAX_RATIO || ratio < 1.0 / RESAMPLER_MAX_RATIO) {
+        return "Sample rates must be within a factor of 32 of each other";
+    }
+    if (channelCount < 1 || channelCount > RESAMPLER_MAX_CHANNELS) {
+        return "Channel count must be between 1 and 64";
+    }
+    if (quality < RESAMPLER_QUALITY_LOW || quality > RESAMPLER_QUALITY_BEST) {
+        return "Unknown resampler quality";
+    }
+
+    // Length and transition band (cycles per sample of the lower rate) of the
+    // preset, stretched over the input when it is the higher rate
+    int baseTaps;
+    double attenuation;
+    resampler_preset(quality, &baseTaps, &attenuation);
+    const double scale = ratio < 1.0 ? ratio : 1.0;
+    const double transition = (attenuation - 8.0) / (2.285 * 2.0 * M_PI * baseTaps);
+    const double cutoff = (0.5 - transition / 2.0) * scale;  // Cycles per input sample
+    const double beta = 0.1102 * (attenuation - 8.7);
+    int taps = (int)ceil(baseTaps / scale);
+    taps = (taps + 7) & ~7;
+
+    r->channelCount = channelCount;
+    r->quality = quality;
+    r->taps = taps;
+    r->ratio = ratio;
+    r->kernel = resampler_pick_kernel();
+    const bool whole = inputRate == floor(inputRate) && outputRate == floor(outputRate);
+    const int64_t g = whole ? resampler_gcd((int64_t)inputRate, (int64_t)outputRate) : 1;
+    if (whole && (int64_t)outputRate / g <= RESAMPLER_MAX_PHASES) {
+        r->upsample = (int64_t)outputRate / g;
+        r->downsample = (int64_t)inputRate / g;
+        r->rows = (int)r->upsample;
+    } else {
+        r->interpolated = true;
+        r->rows = RESAMPLER_INTERP_PHASES + 1;
+        r->step = (uint64_t)llround(inputRate / outputRate * 4294967296.0);
+    }
+
+    r->coefficients = (float*)calloc((size_t)r->rows * (size_t)taps, sizeof(float));
+    r->capacity = taps + RESAMPLER_BLOCK_FRAMES;
+    r->history = (float**)calloc((size_t)channelCount, sizeof(float*));
+    bool allocated = r->coefficients && r->history;
+    for (int c = 0; allocated && c < channelCount; c++) {
+        r->history[c] = (float*)malloc((size_t)r->capacity * sizeof(float));
+        allocated = r->history[c] != NULL;
+    }
+    if (!allocated) {
+        resampler_free(r);
+        return "Failed to allocate resampler";
+    }
+
+    // Row p is the filter for an output p / phases of an input frame past the
+    // centre tap, normalized to unity gain so no phase is louder than another
+    const double half = taps / 2.0;
+    const int phases = r->interpolated ? RESAMPLER_INTERP_PHASES : r->rows;
+    const double window = resampler_bessel_i0(beta);
+    for (int p = 0; p < r->rows; p++) {
+        float* row = r->coefficients + (size_t)p * taps;
+        const double offset = (double)p / phases;
+        double sum = 0.0;
+        for (int k = 0; k < taps; k++) {
+            const double u = (double)k - (half - 1.0) - offset;
+            const double x = 2.0 * cutoff * u;
+            const double sinc = fabs(x) < 1e-12 ? 1.0 : sin(M_PI * x) / (M_PI * x);
+            const double w = u / half;
+            const double kaiser = fabs(w) <= 1.0 ? resampler_bessel_i0(beta * sqrt(1.0 - w * w)) / window : 0.0;
+            const double value = 2.0 * cutoff * sinc * kaiser;
+            row[k] = (float)value;
+            sum += value;
+        }
+        for (int k = 0; k < taps; k++) {
+            row[k] = (float)(row[k] / sum);
+        }
+    }
+    resampler_clear(r);
+    return NULL;
+}
+
+// ---- Processing ----
+
+// Produce outputs while the held input covers their taps
+static inline int resampler_emit(Resampler* r, float* output, int outputStride, int first, int capacity,
+                                int64_t limit) {
+    int produced = first;
+    const int taps = r->taps;
+    while (produced < capacity && r->outputFrames < limit && r->position + taps <= r->fill) {
+        if (r->interpolated) {
+            const uint64_t scaled = (r->phase & 0xffffffffu) * RESAMPLER_INTERP_PHASES;
+            const int row = (int)(scaled >> 32);
+            const float t = (float)(scaled & 0xffffffffu) * (1.0f / 4294967296.0f);
+            const float* h0 = r->coefficients + (size_t)row * taps;
+            for (int c = 0; c < r->channelCount; c++) {
+                float y0, y1;
+                resampler_dot2(r, r->history[c] + r->position, h0, h0 + taps, &y0, &y1);
+                output[(size_t)c * outputStride + produced] = y0 + (y1 - y0) * t;
+            }
+            const uint64_t next = (r->phase & 0xffffffffu) + r->step;
+            r->position += (int)(next >> 32);
+            r->phase = next & 0xffffffffu;
+        } else {
+            const float* h = r->coefficients + (size_t)r->phase * taps;
+            for (int c = 0; c < r->channelCount; c++) {
+                output[(size_t)c * outputStride + produced] = resampler_dot(r, r->history[c] + r->position, h);
+            }
+            r->phase += (uint64_t)r->downsample;
+            r->position += (int)(r->phase / (uint64_t)r->upsample);
+            r->phase %= (uint64_t)r->upsample;
+        }
+        produced++;
+        r->outputFrames++;
+    }
+    return produced;
+}
+
+// Drop held frames no output needs any more, making room for more input
+static inline void resampler_compact(Resampler* r) {
+    const int keep = r->fill - r->position;
+    if (r->position <= 0) {
+        return;
+    }
+    if (keep > 0) {
+        for (int c = 0; c < r->channelCount; c++) {
+            memmove(r->history[c], r->history[c] + r->position, (size_t)keep * sizeof(float));
+        }
+    }
+    r->fill = keep > 0 ? keep : 0;
+    r->position = keep < 0 ? -keep : 0;  // Past the held frames when downsampling
+}
+
+// Convert planar input (channel c at input + c * inputStride) into planar
+// output (channel c at output + c * outputStride), stopping when the input is
+// used up or `capacity` frames are written. Returns the frames written;
+// *consumed is the input frames taken, which may be fewer than inputFrames
+// when the output is full.
+static inline int resampler_push(Resampler* r, const float* input, int inputStride, int inputFrames, float* output,
+                                    int outputStride, int capacity, int* consumed) {
+    int produced = 0;
+    int taken = 0;
+    for (;;) {
+        produced = resampler_emit(r, output, outputStride, produced, capacity, INT64_MAX);
+        if (produced == capacity || taken == inputFrames) {
+            break;
+        }
+        resampler_compact(r);
+        const int room = r->capacity - r->fill;
+        const int count = inputFrames - taken < room ? inputFrames - taken : room;
+        for (int c = 0; c < r->channelCount; c++) {
+            memcpy(r->history[c] + r->fill, input + (size_t)c * inputStride + taken, (size_t)count * sizeof(float));
+        }
+        r->fill += count;
+        taken += count;
+        r->inputFrames += count;
+    }
+    *consumed = taken;
+    return produced;
+}
+
+// Frames still to come once the input has ended
+static inline int64_t resampler_pending(const Resampler* r) {
+    const int64_t total = r->interpolated
+                              ? (int64_t)ceil((double)r->inputFrames * r->ratio)
+                              : (r->inputFrames * r->upsample + r->downsample - 1) / r->downsample;
+    return total > r->outputFrames ? total - r->outputFrames : 0;
+}
+
+// After the last input: write up to `capacity` of the frames the filter still
+// holds, feeding it silence. Returns the frames written; 0 once drained.
+static inline int resampler_finish(Resampler* r, float* output, int outputStride, int capacity) {
+    const int64_t limit = r->outputFrames + resampler_pending(r);
+    int produced = 0;
+    while (produced < capacity && r->outputFrames < limit) {
+        produced = resampler_emit(r, output, outputStride, produced, capacity, limit);
+        if (produced == capacity || r->outputFrames >= limit) {
+            break;
+        }
+        resampler_compact(r);
+        for (int c = 0; c < r->channelCount; c++) {
+            memset(r->history[c] + r->fill, 0, (size_t)(r->capacity - r->fill) * sizeof(float));
+        }
+        r->fill = r->capacity;
+    }
+    return produced;
+}
+
+// ---- Random access ----
+//
+// For readers that keep their own read position instead of streaming through
+// the history (the headless player, whose seeks, loops and crossfades move it
+// freely): the filter for input position `position` is applied to the taps
+// frames from the one resampler_locate returns. Exact ratios snap to their
+// nearest phase, which positions stepped by the ratio land on; others blend
+// two rows like resampler_emit.
+
+// First input frame under the taps for `position`, with the row and blend
+static inline int64_t resampler_locate(const Resampler* r, double position, int* row, float* t) {
+    int64_t index = (int64_t)floor(position);
+    const double fraction = position - (double)index;
+    if (r->interpolated) {
+        const double scaled = fraction * RESAMPLER_INTERP_PHASES;
+        *row = (int)scaled < RESAMPLER_INTERP_PHASES ? (int)scaled : RESAMPLER_INTERP_PHASES - 1;
+        *t = (float)(scaled - *row);
+    } else {
+        *row = (int)floor(fraction * r->rows + 0.5);
+        *t = 0.0f;
+        if (*row == r->rows) {
+            *row = 0;
+            index++;
+        }
+    }
+    return index - (r->taps / 2 - 1);
+}
+
+// One channel's output from the taps frames at `x`
+static inline float resampler_value(const Resampler* r, const float* x, int row, float t) {
+    const float* h = r->coefficients + (size_t)row * r->taps;
+    if (!r->interpolated) {
+        return resampler_dot(r, x, h);
+    }
+    float y0, y1;
+    resampler_dot2(r, x, h, h + r->taps, &y0, &y1);
+    return y0 + (y1 - y0) * t;
+}
+
+#endif  // MACAUDIO_RESAMPLER_H
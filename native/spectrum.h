@@ -0,0 +1,410 @@
+// FFT spectrum analysis shared by tap analyzers and offline plans (both backends).
+//
+// A SpectrumPlan precomputes everything that depends only on the configuration:
+// the window (scaled so a full-scale sine reads 0 dB), bit-reversal and twiddle
+// tables, and the bin ranges of log or fractional-octave bands. Running it is
+// a radix-2 complex FFT of fftSize / 2 points over the even/odd samples packed
+// as real/imaginary parts, unpacked into the fftSize / 2 bins of the real
+// transform, so a plan costs about half a complex FFT of the full size and
+// never allocates.
+//
+// Bands report the power of the bins they span divided by the window's
+// equivalent noise bandwidth, so a tone reads its amplitude in its band and
+// broadband noise reads its band power. Bands narrower than one bin take the
+// nearest bin.
+//
+// A SpectrumAnalyzer runs a plan over a tap's PCM ring from a worker thread
+// and publishes into two alternating snapshots (see SpectrumView in
+// macaudio.h). Only the newest hop-aligned window is analyzed on each update,
+// so a worker that wakes late catches up instead of queueing work.
+//
+// Header-only like meter.h and loudness.h; uses GCC/Clang __atomic builtins so
+// the same code compiles as C (ObjC backend) and C++ (headless backend).
+
+#ifndef MACAUDIO_SPECTRUM_H
+#define MACAUDIO_SPECTRUM_H
+
+#include <math.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "macaudio.h"
+
+#define SPECTRUM_POWER_FLOOR 1e-16f  // SPECTRUM_FLOOR_DB as power
+
+struct SpectrumPlan {
+    int fftSize;
+    int hopSize;
+    int half;        // Complex FFT size
+    int binCount;    // Output values per channel
+    int banded;
+    float* window;   // fftSize, amplitude-normalized
+    int* bitReverse; // half
+    float* twiddleRe; // half / 2: e^(-2*pi*i*k / half)
+    float* twiddleIm;
+    float* unpackRe; // half: e^(-2*pi*i*k / fftSize)
+    float* unpackIm;
+    float* re;       // Scratch, half
+    float* im;
+    float* power;    // Scratch, half bins
+    int* bandFirst;  // binCount bin ranges when banded
+    int* bandLast;   // Inclusive
+    float* frequencies;
+    float noiseBandwidth;  // Window ENBW in bins
+};
+
+typedef struct {
+    SpectrumPlan plan;
+    int channelCount;
+    float* samples;    // Scratch: one window of one channel
+    float* snapshots;  // 2 * channelCount * binCount
+
+    // Shared with readers (SpectrumView)
+    int64_t positions[2];
+    uint64_t published;
+    uint64_t writing;
+
+    int64_t nextEnd;   // Worker-only: end of the next window to analyze
+} SpectrumAnalyzer;
+
+static inline void spectrum_default_config(SpectrumConfig* config) {
+    config->fftSize = 2048;
+    config->overlap = 4;
+    config->window = SPECTRUM_WINDOW_HANN;
+    config->scale = SPECTRUM_SCALE_LINEAR;
+    config->bandCount = 64;
+    config->bandsPerOctave = 3;
+    config->minFrequency = 20.0;
+    config->maxFrequency = 20000.0;
+}
+
+static inline int spectrum_config_equal(const SpectrumConfig* a, const SpectrumConfig* b) {
+    return a->fftSize == b->fftSize && a->overlap == b->overlap && a->window == b->window && a->scale == b->scale &&
+           a->bandCount == b->bandCount && a->bandsPerOctave == b->bandsPerOctave &&
+           a->minFrequency == b->minFrequency && a->maxFrequency == b->maxFrequency;
+}
+
+static inline void spectrum_plan_free(SpectrumPlan* plan) {
+    free(plan->window);
+    free(plan->bitReverse);
+    free(plan->twiddleRe);
+    free(plan->twiddleIm);
+    free(plan->unpackRe);
+    free(plan->unpackIm);
+    free(plan->re);
+    free(plan->im);
+    free(plan->power);
+    free(plan->bandFirst);
+    free(plan->bandLast);
+    free(plan->frequencies);
+    memset(plan, 0, sizeof(*plan));
+}
+
+// Bin range of the band [low, high), or the bin nearest `centre` if the band
+// falls between bins
+static inline void spectrum_band_bins(const SpectrumPlan* plan, double binHz, double low, double high, double centre,
+                                      int* first, int* last) {
+    int lo = (int)ceil(low / binHz);
+    int hi = (int)ceil(high / binHz) - 1;
+    if (hi < lo) {
+        lo = hi = (int)floor(centre / binHz + 0.5);
+    }
+    if (lo < 1) {
+        lo = 1;
+    }
+    if (hi > plan->half - 1) {
+        hi = plan->half - 1;
+    }
+    if (hi < lo) {
+        hi = lo;
+    }
+    *first = lo;
+    *last = hi;
+}
+
+static inline const char* spectrum_plan_init(SpectrumPlan* plan, const SpectrumConfig* config, double sampleRate) {
+    memset(plan, 0, sizeof(*plan));
+    const int n = config->fftSize;
+    if (n < SPECTRUM_MIN_FFT || n > SPECTRUM_MAX_FFT || (n & (n - 1)) != 0) {
+        return "FFT size must be a power of two between 256 and 16384";
+    }
+    if (config->overlap != 1 && config->overlap != 2 && config->overlap != 4 && config->overlap != 8) {
+        return "Overlap must be 1, 2, 4 or 8";
+    }
+    if (config->window != SPECTRUM_WINDOW_HANN && config->window != SPECTRUM_WINDOW_BLACKMAN_HARRIS) {
+        return "Unknown spectrum window";
+    }
+    if (sampleRate <= 0.0) {
+        return "Sample rate must be positive";
+    }
+
+    const double nyquist = sampleRate / 2.0;
+    const double minFrequency = config->minFrequency > 0.0 ? config->minFrequency : 20.0;
+    const double maxFrequency = config->maxFrequency > 0.0 && config->maxFrequency < nyquist ? config->maxFrequency : nyquist;
+    int bands = 0;
+    switch (config->scale) {
+        case SPECTRUM_SCALE_LINEAR:
+            break;
+        case SPECTRUM_SCALE_LOG:
+            if (config->bandCount < 1 || config->bandCount > n / 2) {
+                return "Band count must be between 1 and fftSize / 2";
+            }
+            bands = config->bandCount;
+            break;
+        case SPECTRUM_SCALE_OCTAVE:
+            if (config->bandsPerOctave < 1 || config->bandsPerOctave > 48) {
+                return "Bands per octave must be between 1 and 48";
+            }
+            break;
+        default:
+            return "Unknown spectrum scale";
+    }
+    if (config->scale != SPECTRUM_SCALE_LINEAR && minFrequency >= maxFrequency) {
+        return "Band range is empty";
+    }
+
+    // Octave bands: centres 1 kHz * 2^(k / bandsPerOctave), every band that
+    // overlaps the range (so 20 Hz-20 kHz gives the 31 nominal third octaves)
+    int firstOctaveBand = 0;
+    if (config->scale == SPECTRUM_SCALE_OCTAVE) {
+        const double perOctave = config->bandsPerOctave;
+        firstOctaveBand = (int)floor(log2(minFrequency / 1000.0) * perOctave - 0.5) + 1;
+        const int lastOctaveBand = (int)ceil(log2(maxFrequency / 1000.0) * perOctave + 0.5) - 1;
+        bands = lastOctaveBand - firstOctaveBand + 1;
+        if (bands < 1) {
+            return "Band range overlaps no octave band";
+        }
+    }
+
+    const int half = n / 2;
+    plan->fftSize = n;
+    plan->hopSize = n / config->overlap;
+    plan->half = half;
+    plan->banded = bands > 0;
+    plan->binCount = bands > 0 ? bands : half;
+    plan->window = (float*)malloc(sizeof(float) * n);
+    plan->bitReverse = (int*)malloc(sizeof(int) * half);
+    plan->twiddleRe = (float*)malloc(sizeof(float) * (half / 2));
+    plan->twiddleIm = (float*)malloc(sizeof(float) * (half / 2));
+    plan->unpackRe = (float*)malloc(sizeof(float) * half);
+    plan->unpackIm = (float*)malloc(sizeof(float) * half);
+    plan->re = (float*)malloc(sizeof(float) * half);
+    plan->im = (float*)malloc(sizeof(float) * half);
+    plan->power = (float*)malloc(sizeof(float) * half);
+    plan->frequencies = (float*)malloc(sizeof(float) * plan->binCount);
+    if (bands > 0) {
+        plan->bandFirst = (int*)malloc(sizeof(int) * bands);
+        plan->bandLast = (int*)malloc(sizeof(int) * bands);
+    }
+    if (!plan->window || !plan->bitReverse || !plan->twiddleRe || !plan->twiddleIm || !plan->unpackRe ||
+        !plan->unpackIm || !plan->re || !plan->im || !plan->power || !plan->frequencies ||
+        (bands > 0 && (!plan->bandFirst || !plan->bandLast))) {
+        spectrum_plan_free(plan);
+        return "Out of memory allocating spectrum plan";
+    }
+
+    // Periodic window, scaled by 2 / sum so a sine's peak bin reads its amplitude
+    double sum = 0.0;
+    double sumOfSquares = 0.0;
+    for (int i = 0; i < n; i++) {
+        const double phase = 2.0 * M_PI * i / n;
+        double w;
+        if (config->window == SPECTRUM_WINDOW_HANN) {
+            w = 0.5 - 0.5 * cos(phase);
+        } else {
+            w = 0.35875 - 0.48829 * cos(phase) + 0.14128 * cos(2.0 * phase) - 0.01168 * cos(3.0 * phase);
+        }
+        plan->window[i] = (float)w;
+        sum += w;
+        sumOfSquares += w * w;
+    }
+    for (int i = 0; i < n; i++) {
+        plan->window[i] = (float)(plan->window[i] * 2.0 / sum);
+    }
+    plan->noiseBandwidth = (float)(n * sumOfSquares / (sum * sum));
+
+    int bits = 0;
+    while ((1 << bits) < half) {
+        bits++;
+    }
+    for (int i = 0; i < half; i++) {
+        int reversed = 0;
+        for (int b = 0; b < bits; b++) {
+            reversed |= ((i >> b) & 1) << (bits - 1 - b);
+        }
+        plan->bitReverse[i] = reversed;
+    }
+    for (int k = 0; k < half / 2; k++) {
+        plan->twiddleRe[k] = (float)cos(2.0 * M_PI * k / half);
+        plan->twiddleIm[k] = (float)-sin(2.0 * M_PI * k / half);
+    }
+    for (int k = 0; k < half; k++) {
+        plan->unpackRe[k] = (float)cos(2.0 * M_PI * k / n);
+        plan->unpackIm[k] = (float)-sin(2.0 * M_PI * k / n);
+    }
+
+    const double binHz = sampleRate / n;
+    if (config->scale == SPECTRUM_SCALE_LINEAR) {
+        for (int k = 0; k < half; k++) {
+            plan->frequencies[k] = (float)(k * binHz);
+        }
+    } else if (config->scale == SPECTRUM_SCALE_LOG) {
+        const double ratio = maxFrequency / minFrequency;
+        for (int b = 0; b < bands; b++) {
+            const double low = minFrequency * pow(ratio, (double)b / bands);
+            const double high = minFrequency * pow(ratio, (double)(b + 1) / bands);
+            const double centre = sqrt(low * high);
+            plan->frequencies[b] = (float)centre;
+            spectrum_band_bins(plan, binHz, low, high, centre, &plan->bandFirst[b], &plan->bandLast[b]);
+        }
+    } else {
+        const double perOctave = config->bandsPerOctave;
+        const double edge = pow(2.0, 0.5 / perOctave);
+        for (int b = 0; b < bands; b++) {
+            const double centre = 1000.0 * pow(2.0, (firstOctaveBand + b) / perOctave);
+            plan->frequencies[b] = (float)centre;
+            spectrum_band_bins(plan, binHz, centre / edge, centre * edge, centre, &plan->bandFirst[b],
+                               &plan->bandLast[b]);
+        }
+    }
+    return NULL;
+}
+
+// fftSize samples in, binCount dB values out
+static inline void spectrum_plan_run(SpectrumPlan* plan, const float* samples, float* out) {
+    const int half = plan->half;
+    float* re = plan->re;
+    float* im = plan->im;
+
+    // Pack even/odd windowed samples as one complex sequence, bit-reversed
+    for (int i = 0; i < half; i++) {
+        const int j = plan->bitReverse[i];
+        re[j] = samples[2 * i] * plan->window[2 * i];
+        im[j] = samples[2 * i + 1] * plan->window[2 * i + 1];
+    }
+
+    for (int size = 2; size <= half; size <<= 1) {
+        const int span = size >> 1;
+        const int step = half / size;
+        for (int start = 0; start < half; start += size) {
+            for (int k = 0; k < span; k++) {
+                const float wr = plan->twiddleRe[k * step];
+                const float wi = plan->twiddleIm[k * step];
+                const int a = start + k;
+                const int b = a + span;
+                const float tr = re[b] * wr - im[b] * wi;
+                const float ti = re[b] * wi + im[b] * wr;
+                re[b] = re[a] - tr;
+                im[b] = im[a] - ti;
+                re[a] += tr;
+                im[a] += ti;
+            }
+        }
+    }
+
+    // X[k] = E[k] + W^k O[k] with E = (Z[k] + Z*[half - k]) / 2, O = (Z[k] - Z*[half - k]) / 2i
+    for (int k = 0; k < half; k++) {
+        const int m = (half - k) & (half - 1);
+        const float er = 0.5f * (re[k] + re[m]);
+        const float ei = 0.5f * (im[k] - im[m]);
+        const float or_ = 0.5f * (im[k] + im[m]);
+        const float oi = -0.5f * (re[k] - re[m]);
+        const float xr = er + plan->unpackRe[k] * or_ - plan->unpackIm[k] * oi;
+        const float xi = ei + plan->unpackRe[k] * oi + plan->unpackIm[k] * or_;
+        plan->power[k] = xr * xr + xi * xi;
+    }
+    plan->power[0] *= 0.25f;  // DC has no mirrored half
+
+    if (!plan->banded) {
+        for (int k = 0; k < half; k++) {
+            const float p = plan->power[k] > SPECTRUM_POWER_FLOOR ? plan->power[k] : SPECTRUM_POWER_FLOOR;
+            out[k] = 10.0f * log10f(p);
+        }
+        return;
+    }
+    for (int b = 0; b < plan->binCount; b++) {
+        float p = 0.0f;
+        for (int k = plan->bandFirst[b]; k <= plan->bandLast[b]; k++) {
+            p += plan->power[k];
+        }
+        if (plan->bandLast[b] > plan->bandFirst[b]) {
+            p /= plan->noiseBandwidth;
+        }
+        out[b] = 10.0f * log10f(p > SPECTRUM_POWER_FLOOR ? p : SPECTRUM_POWER_FLOOR);
+    }
+}
+
+static inline void spectrum_analyzer_free(SpectrumAnalyzer* analyzer) {
+    spectrum_plan_free(&analyzer->plan);
+    free(analyzer->samples);
+    free(analyzer->snapshots);
+    memset(analyzer, 0, sizeof(*analyzer));
+}
+
+static inline const char* spectrum_analyzer_init(SpectrumAnalyzer* analyzer, const SpectrumConfig* config,
+                                                 double sampleRate, int channelCount) {
+    memset(analyzer, 0, sizeof(*analyzer));
+    const char* error = spectrum_plan_init(&analyzer->plan, config, sampleRate);
+    if (error) {
+        return error;
+    }
+    analyzer->channelCount = channelCount;
+    analyzer->samples = (float*)malloc(sizeof(float) * analyzer->plan.fftSize);
+    analyzer->snapshots = (float*)malloc(sizeof(float) * 2 * (size_t)channelCount * analyzer->plan.binCount);
+    if (!analyzer->samples || !analyzer->snapshots) {
+        spectrum_analyzer_free(analyzer);
+        return "Out of memory allocating spectrum analyzer";
+    }
+    for (size_t i = 0; i < 2 * (size_t)channelCount * analyzer->plan.binCount; i++) {
+        analyzer->snapshots[i] = SPECTRUM_FLOOR_DB;
+    }
+    return NULL;
+}
+
+// Start analyzing at the first full hop after `written` frames
+static inline void spectrum_analyzer_start(SpectrumAnalyzer* analyzer, int64_t written) {
+    analyzer->nextEnd = written + analyzer->plan.hopSize;
+}
+
+// Worker: analyze the newest complete hop in a planar PCM ring (see TapRing)
+// and publish it. Returns 1 if a snapshot was published.
+static inline int spectrum_analyzer_update(SpectrumAnalyzer* analyzer, const float* ring, int capacity, int readable,
+                                           const int64_t* writeIndex) {
+    SpectrumPlan* plan = &analyzer->plan;
+    const int64_t written = __atomic_load_n(writeIndex, __ATOMIC_ACQUIRE);
+    if (written < analyzer->nextEnd) {
+        return 0;
+    }
+    const int64_t end = analyzer->nextEnd + (written - analyzer->nextEnd) / plan->hopSize * plan->hopSize;
+    const int64_t start = end - plan->fftSize;
+    analyzer->nextEnd = end + plan->hopSize;
+    if (written - start > readable) {
+        return 0;  // Window already left the ring (the ring is much larger than any FFT)
+    }
+
+    const uint64_t n = __atomic_load_n(&analyzer->published, __ATOMIC_RELAXED) + 1;
+    float* snapshot = analyzer->snapshots + (size_t)(n & 1) * analyzer->channelCount * plan->binCount;
+    __atomic_store_n(&analyzer->writing, n, __ATOMIC_RELAXED);
+    __atomic_thread_fence(__ATOMIC_RELEASE);
+
+    for (int c = 0; c < analyzer->channelCount; c++) {
+        const float* plane = ring + (size_t)c * capacity;
+        for (int i = 0; i < plan->fftSize; i++) {
+            const int64_t frame = start + i;
+            analyzer->samples[i] = frame >= 0 ? plane[frame & (capacity - 1)] : 0.0f;
+        }
+        spectrum_plan_run(plan, analyzer->samples, snapshot + (size_t)c * plan->binCount);
+    }
+
+    // The producer may have lapped the window while it was copied
+    __atomic_thread_fence(__ATOMIC_ACQUIRE);
+    if (__atomic_load_n(writeIndex, __ATOMIC_RELAXED) - readable > start) {
+        return 0;
+    }
+    analyzer->positions[n & 1] = end;
+    __atomic_store_n(&analyzer->published, n, __ATOMIC_RELEASE);
+    return 1;
+}
+
+#endif  // MACAUDIO_SPECTRUM_H
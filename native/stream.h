@@ -0,0 +1,206 @@
+// Read-ahead buffer pool for streaming playback, shared by both player backends.
+//
+// A fixed pool of preallocated planar buffers ("slots") is passed from one I/O
+// thread, which decodes ahead, to one consumer, which plays the slots in order.
+// The producer fills slot `written % bufferCount` and publishes it with a
+// release store; the consumer releases slots in the same order. Neither side
+// locks or allocates, so the consumer can be the render thread.
+//
+// Every slot has room for bufferFrames frames plus one guard frame (the first
+// frame of the next slot, or a repeat of the last one at the end of the file),
+// so a reader interpolating between neighbouring frames never needs two slots.
+//
+// The consumer moves the read position with stream_pool_restart, which bumps
+// the generation; the producer starts decoding at the new frame when it next
+// checks, and slots decoded for an older generation are skipped.
+//
+// Header-only like meter.h; uses GCC/Clang __atomic builtins so the same code
+// builds as C (macOS backend) and C++ (headless backend).
+
+#ifndef MACAUDIO_STREAM_H
+#define MACAUDIO_STREAM_H
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "macaudio.h"
+
+#define STREAM_DEFAULT_BUFFER_FRAMES 16384
+#define STREAM_DEFAULT_BUFFER_COUNT 8
+#define STREAM_MIN_BUFFER_FRAMES 256
+#define STREAM_MAX_BUFFER_FRAMES (1 << 20)
+#define STREAM_MAX_BUFFER_COUNT 256
+
+typedef struct {
+    int64_t start;        // File frame of the slot's first frame
+    int frames;           // Valid frames, not counting the guard frame
+    uint32_t generation;  // Restart the slot was decoded for
+} StreamSlot;
+
+typedef struct StreamPool {
+    int channelCount;
+    int bufferFrames;
+    int bufferCount;
+    int stride;         // Floats per channel plane (bufferFrames + 1)
+    float* data;        // bufferCount slots of channelCount planes
+    StreamSlot* slots;
+
+    uint64_t written;       // Slots published (producer)
+    uint64_t consumed;      // Slots released (consumer)
+    uint32_t generation;    // Restarts requested (consumer)
+    int64_t restartFrame;   // Where the current generation starts decoding
+    int64_t position;       // First frame the current generation can still supply
+
+    int64_t decodedFrames;  // Counters, relaxed
+    int64_t underruns;
+    int64_t underrunFrames;
+} StreamPool;
+
+// Clamp requested sizes to the supported range; 0 picks the default
+static inline void stream_pool_sanitize(int* bufferFrames, int* bufferCount) {
+    if (*bufferFrames <= 0) {
+        *bufferFrames = STREAM_DEFAULT_BUFFER_FRAMES;
+    }
+    if (*bufferCount <= 0) {
+        *bufferCount = STREAM_DEFAULT_BUFFER_COUNT;
+    }
+    *bufferFrames = *bufferFrames < STREAM_MIN_BUFFER_FRAMES ? STREAM_MIN_BUFFER_FRAMES
+                  : *bufferFrames > STREAM_MAX_BUFFER_FRAMES ? STREAM_MAX_BUFFER_FRAMES : *bufferFrames;
+    *bufferCount = *bufferCount < 2 ? 2 : *bufferCount > STREAM_MAX_BUFFER_COUNT ? STREAM_MAX_BUFFER_COUNT : *bufferCount;
+}
+
+// Allocate every slot up front; decoding starts at frame 0 (generation 0)
+static inline bool stream_pool_init(StreamPool* pool, int channelCount, int bufferFrames, int bufferCount) {
+    memset(pool, 0, sizeof(*pool));
+    stream_pool_sanitize(&bufferFrames, &bufferCount);
+    if (channelCount <= 0) {
+        return false;
+    }
+    pool->channelCount = channelCount;
+    pool->bufferFrames = bufferFrames;
+    pool->bufferCount = bufferCount;
+    pool->stride = bufferFrames + 1;
+    pool->data = (float*)calloc((size_t)bufferCount * (size_t)channelCount * (size_t)pool->stride, sizeof(float));
+    pool->slots = (StreamSlot*)calloc((size_t)bufferCount, sizeof(StreamSlot));
+    if (!pool->data || !pool->slots) {
+        free(pool->data);
+        free(pool->slots);
+        memset(pool, 0, sizeof(*pool));
+        return false;
+    }
+    return true;
+}
+
+static inline void stream_pool_free(StreamPool* pool) {
+    free(pool->data);
+    free(pool->slots);
+    memset(pool, 0, sizeof(*pool));
+}
+
+// Channel plane of a slot; bufferFrames + 1 floats
+static inline float* stream_pool_plane(const StreamPool* pool, int slot, int channel) {
+    return pool->data + ((size_t)slot * (size_t)pool->channelCount + (size_t)channel) * (size_t)pool->stride;
+}
+
+// Slots decoded and not yet released (any thread)
+static inline int stream_pool_ready(const StreamPool* pool) {
+    const uint64_t consumed = __atomic_load_n(&pool->consumed, __ATOMIC_ACQUIRE);
+    return (int)(__atomic_load_n(&pool->written, __ATOMIC_ACQUIRE) - consumed);
+}
+
+// ---- Producer (I/O thread) ----
+
+// The generation to decode for and, through `frame`, where it starts
+static inline uint32_t stream_pool_request(const StreamPool* pool, int64_t* frame) {
+    const uint32_t generation = __atomic_load_n(&pool->generation, __ATOMIC_ACQUIRE);
+    *frame = __atomic_load_n(&pool->restartFrame, __ATOMIC_RELAXED);
+    return generation;
+}
+
+// Index of the next free slot, or -1 while all of them hold unplayed audio
+static inline int stream_pool_next_slot(const StreamPool* pool) {
+    const uint64_t written = __atomic_load_n(&pool->written, __ATOMIC_RELAXED);
+    if (written - __atomic_load_n(&pool->consumed, __ATOMIC_ACQUIRE) >= (uint64_t)pool->bufferCount) {
+        return -1;
+    }
+    return (int)(written % (uint64_t)pool->bufferCount);
+}
+
+// Hand the slot from stream_pool_next_slot, now holding `frames` frames from
+// `start` plus the guard frame, to the consumer
+static inline void stream_pool_publish(StreamPool* pool, int64_t start, int frames, uint32_t generation) {
+    const uint64_t written = __atomic_load_n(&pool->written, __ATOMIC_RELAXED);
+    StreamSlot* slot = &pool->slots[written % (uint64_t)pool->bufferCount];
+    slot->start = start;
+    slot->frames = frames;
+    slot->generation = generation;
+    __atomic_fetch_add(&pool->decodedFrames, (int64_t)frames, __ATOMIC_RELAXED);
+    __atomic_store_n(&pool->written, written + 1, __ATOMIC_RELEASE);
+}
+
+// ---- Consumer (render thread, or a control thread that excludes it) ----
+
+// Release the oldest published slot
+static inline void stream_pool_release(StreamPool* pool) {
+    const uint64_t consumed = __atomic_load_n(&pool->consumed, __ATOMIC_RELAXED);
+    const StreamSlot* slot = &pool->slots[consumed % (uint64_t)pool->bufferCount];
+    if (slot->generation == __atomic_load_n(&pool->generation, __ATOMIC_RELAXED)) {
+        __atomic_store_n(&pool->position, slot->start + slot->frames, __ATOMIC_RELAXED);
+    }
+    __atomic_store_n(&pool->consumed, consumed + 1, __ATOMIC_RELEASE);
+}
+
+// Decode from `frame` next, dropping whatever was read ahead
+static inline void stream_pool_restart(StreamPool* pool, int64_t frame) {
+    __atomic_store_n(&pool->position, frame, __ATOMIC_RELAXED);
+    __atomic_store_n(&pool->restartFrame, frame, __ATOMIC_RELAXED);
+    __atomic_store_n(&pool->generation, __atomic_load_n(&pool->generation, __ATOMIC_RELAXED) + 1, __ATOMIC_RELEASE);
+}
+
+// Make `frame` the next one read: keep the read-ahead if it gets there within
+// the pool, otherwise restart
+static inline void stream_pool_seek(StreamPool* pool, int64_t frame) {
+    const int64_t reach = (int64_t)pool->bufferFrames * pool->bufferCount;
+    const int64_t position = __atomic_load_n(&pool->position, __ATOMIC_RELAXED);
+    if (frame < position || frame - position >= reach) {
+        stream_pool_restart(pool, frame);
+    }
+}
+
+// Slot index holding `frame`, releasing stale and already played slots on
+// the way; -1 if it has not been decoded yet
+static inline int stream_pool_find(StreamPool* pool, int64_t frame) {
+    const uint32_t generation = __atomic_load_n(&pool->generation, __ATOMIC_RELAXED);
+    for (;;) {
+        const uint64_t consumed = __atomic_load_n(&pool->consumed, __ATOMIC_RELAXED);
+        if (consumed == __atomic_load_n(&pool->written, __ATOMIC_ACQUIRE)) {
+            return -1;
+        }
+        const int index = (int)(consumed % (uint64_t)pool->bufferCount);
+        const StreamSlot* slot = &pool->slots[index];
+        if (slot->generation == generation && frame < slot->start + slot->frames) {
+            return frame >= slot->start ? index : -1;
+        }
+        stream_pool_release(pool);
+    }
+}
+
+// Count a render cycle that came up `frames` short
+static inline void stream_pool_underrun(StreamPool* pool, int frames) {
+    __atomic_fetch_add(&pool->underruns, 1, __ATOMIC_RELAXED);
+    __atomic_fetch_add(&pool->underrunFrames, (int64_t)frames, __ATOMIC_RELAXED);
+}
+
+static inline void stream_pool_stats(const StreamPool* pool, StreamingStats* stats) {
+    stats->enabled = true;
+    stats->bufferFrames = pool->bufferFrames;
+    stats->bufferCount = pool->bufferCount;
+    stats->ready = stream_pool_ready(pool);
+    stats->decodedFrames = __atomic_load_n(&pool->decodedFrames, __ATOMIC_RELAXED);
+    stats->underruns = __atomic_load_n(&pool->underruns, __ATOMIC_RELAXED);
+    stats->underrunFrames = __atomic_load_n(&pool->underrunFrames, __ATOMIC_RELAXED);
+}
+
+#endif  // MACAUDIO_STREAM_H
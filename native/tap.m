@@ -1,49 +1,283 @@
 #import <AVFoundation/AVFoundation.h>
 #import <AudioUnit/AudioUnit.h>
 #import <Foundation/Foundation.h>
+#import <mach/mach_time.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdlib.h>
+#include <string.h>
+#import "macaudio.h"
+#import "loudness.h"
+#import "meter.h"
+#import "spectrum.h"
 
-#ifdef __cplusplus
-extern "C" {
-#endif
+// Taps are written by the tap block on the audio thread and read from Go.
+// Each tap owns preallocated single-producer rings (metrics and planar PCM);
+// the block only stores into its own rings and publishes with release
+// stores, so it never locks, allocates or messages Objective-C. The registry
+// lock below is taken by control/reader threads only.
+//
+// Registered taps live in a fixed slot table. A TapHandle is the slot index
+// plus the slot's generation, so handle lookups are O(1) without touching
+// strings, and a handle kept past tap_remove no longer matches its slot.
+//
+// Spectrum analysis runs on a per-tap pthread that reads the PCM ring like any
+// other reader, so it adds nothing to the audio thread.
 
-// Result structures for functions that return pointers/data
+#define TAP_METRICS_RING_SIZE 8      // Power of two
+#define TAP_PCM_RING_FRAMES 32768    // Power of two, per channel (~0.7 s at 48 kHz)
+#define TAP_PCM_GUARD_FRAMES 8192    // Headroom for a block the producer has written but not yet published
+#define TAP_PCM_READABLE_FRAMES (TAP_PCM_RING_FRAMES - TAP_PCM_GUARD_FRAMES)
+#define TAP_RETIRE_SECONDS 2.0       // Grace period before freeing a removed tap
+
+// Spectrum worker of one tap; stopped before its analyzer is reconfigured or freed
 typedef struct {
-    void* result;           // The actual result pointer
-    const char* error;      // NULL = success, string = error message  
-} TapResult;
+    pthread_t thread;
+    pthread_mutex_t mutex;
+    pthread_cond_t wake;
+    bool stop;
+    bool running;
+} SpectrumWorker;
+
+typedef struct TapState {
+    char* key;
+    TapHandle handle;
+    void* nodePtr;       // AVAudioNode*, retained while registered
+    int busIndex;
+    double sampleRate;
+    int channelCount;
+
+    // Metrics ring: slot (n - 1) % size holds the newest of n published blocks
+    TapMetrics metrics[TAP_METRICS_RING_SIZE];
+    _Atomic uint64_t metricsWritten;
+
+    // PCM ring: channelCount planes of TAP_PCM_RING_FRAMES floats
+    float* pcm;
+    _Atomic int64_t pcmWritten;
+
+    // Optional EBU R128 meter, allocated on first enable and freed with the tap
+    _Atomic(LoudnessState*) loudness;
+    _Atomic bool loudnessEnabled;
+
+    // Optional spectrum analyzer, allocated on enable and fed by spectrumWorker
+    SpectrumAnalyzer* spectrum;
+    SpectrumConfig spectrumConfig;
+    SpectrumWorker spectrumWorker;
+
+    _Atomic int ringRefs;      // Zero-copy readers mapping pcm (tap_get_ring)
+    _Atomic int spectrumRefs;  // Zero-copy readers mapping spectrum (tap_get_spectrum)
+    double retiredAt;
+    struct TapState* next;  // Retired list link
+} TapState;
 
-// Tap callback info structure
 typedef struct {
-    void* tapPtr;      // Unique tap identifier
-    void* nodePtr;     // AVAudioNode being tapped
-    int busIndex;      // Bus index being tapped
-    bool isActive;     // Whether tap is currently active
-    double sampleRate; // Sample rate of the tapped audio
-    int channelCount;  // Number of channels being tapped
-} TapInfo;
-
-// Function declarations for dynamic library export
-void tap_init(void);
-const char* tap_install(void* enginePtr, void* nodePtr, int busIndex, const char* tapKey);
-const char* tap_remove(const char* tapKey);
-const char* tap_get_info(const char* tapKey, TapInfo* info);
-const char* tap_get_rms(const char* tapKey, double* result);
-const char* tap_get_frame_count(const char* tapKey, int* result);
-const char* tap_remove_all(void);
-const char* tap_get_active_count(int* result);
-
-// Global tap storage (simplified for this implementation)
-static NSMutableDictionary* activeTaps = nil;
-
-// Initialize tap storage
-void tap_init() {
-    if (!activeTaps) {
-        activeTaps = [[NSMutableDictionary alloc] init];
-    }
-}
-
-// Install a tap on an AVAudioNode at the specified bus
-const char* tap_install(void* enginePtr, void* nodePtr, int busIndex, const char* tapKey) {
+    TapState* tap;        // NULL when free
+    uint16_t generation;  // Bumped on removal; never 0 once used
+} TapSlot;
+
+static pthread_mutex_t tapsMutex = PTHREAD_MUTEX_INITIALIZER;
+static TapSlot tapSlots[TAP_MAX_TAPS];
+static int tapSlotsUsed = 0;          // One past the highest slot ever used
+static TapState* retiredTaps = NULL;  // Removed, possibly still referenced by an in-flight block
+
+static double tap_now(void) {
+    return (double)clock_gettime_nsec_np(CLOCK_MONOTONIC) / 1e9;
+}
+
+static TapState* tap_find_locked(const char* tapKey) {
+    for (int i = 0; i < tapSlotsUsed; i++) {
+        TapState* tap = tapSlots[i].tap;
+        if (tap && strcmp(tap->key, tapKey) == 0) {
+            return tap;
+        }
+    }
+    return NULL;
+}
+
+static TapState* tap_from_handle_locked(TapHandle handle) {
+    const uint32_t index = handle & 0xFFFF;
+    if (index >= TAP_MAX_TAPS) {
+        return NULL;
+    }
+    const TapSlot* slot = &tapSlots[index];
+    return slot->generation == (uint16_t)(handle >> 16) ? slot->tap : NULL;
+}
+
+static void* tap_spectrum_run(void* arg) {
+    TapState* tap = arg;
+    SpectrumWorker* worker = &tap->spectrumWorker;
+
+    // Wake about once per hop; late wakes just skip to the newest window
+    double interval = tap->spectrum->plan.hopSize / tap->sampleRate;
+    interval = interval < 0.001 ? 0.001 : interval > 0.05 ? 0.05 : interval;
+
+    pthread_mutex_lock(&worker->mutex);
+    while (!worker->stop) {
+        pthread_mutex_unlock(&worker->mutex);
+        spectrum_analyzer_update(tap->spectrum, tap->pcm, TAP_PCM_RING_FRAMES, TAP_PCM_READABLE_FRAMES,
+                                 (const int64_t*)&tap->pcmWritten);
+        pthread_mutex_lock(&worker->mutex);
+
+        struct timespec deadline;
+        clock_gettime(CLOCK_REALTIME, &deadline);
+        const long nanoseconds = deadline.tv_nsec + (long)(interval * 1e9);
+        deadline.tv_sec += nanoseconds / 1000000000L;
+        deadline.tv_nsec = nanoseconds % 1000000000L;
+        if (!worker->stop) {
+            pthread_cond_timedwait(&worker->wake, &worker->mutex, &deadline);
+        }
+    }
+    pthread_mutex_unlock(&worker->mutex);
+    return NULL;
+}
+
+static bool tap_spectrum_start(TapState* tap) {
+    SpectrumWorker* worker = &tap->spectrumWorker;
+    spectrum_analyzer_start(tap->spectrum, atomic_load_explicit(&tap->pcmWritten, memory_order_acquire));
+    pthread_mutex_init(&worker->mutex, NULL);
+    pthread_cond_init(&worker->wake, NULL);
+    worker->stop = false;
+    if (pthread_create(&worker->thread, NULL, tap_spectrum_run, tap) != 0) {
+        pthread_cond_destroy(&worker->wake);
+        pthread_mutex_destroy(&worker->mutex);
+        return false;
+    }
+    worker->running = true;
+    return true;
+}
+
+// The worker never takes tapsMutex, so it can be joined while holding it
+static void tap_spectrum_stop(TapState* tap) {
+    SpectrumWorker* worker = &tap->spectrumWorker;
+    if (!worker->running) {
+        return;
+    }
+    pthread_mutex_lock(&worker->mutex);
+    worker->stop = true;
+    pthread_cond_signal(&worker->wake);
+    pthread_mutex_unlock(&worker->mutex);
+    pthread_join(worker->thread, NULL);
+    pthread_cond_destroy(&worker->wake);
+    pthread_mutex_destroy(&worker->mutex);
+    worker->running = false;
+}
+
+static void tap_free(TapState* tap) {
+    tap_spectrum_stop(tap);
+    if (tap->spectrum) {
+        spectrum_analyzer_free(tap->spectrum);
+        free(tap->spectrum);
+    }
+    free(atomic_load(&tap->loudness));
+    free(tap->pcm);
+    free(tap->key);
+    free(tap);
+}
+
+// Free retired taps whose grace period has passed and that no reader still
+// maps. Caller holds tapsMutex.
+static void tap_collect_retired_locked(void) {
+    const double now = tap_now();
+    TapState** link = &retiredTaps;
+    while (*link) {
+        TapState* tap = *link;
+        if (now - tap->retiredAt >= TAP_RETIRE_SECONDS && atomic_load(&tap->ringRefs) == 0 &&
+            atomic_load(&tap->spectrumRefs) == 0) {
+            *link = tap->next;
+            tap_free(tap);
+        } else {
+            link = &tap->next;
+        }
+    }
+}
+
+// Unlink, remove the AVFoundation tap and park the state until no block can
+// still be running on it. Caller holds tapsMutex.
+static void tap_retire_locked(TapState* tap) {
+    TapSlot* slot = &tapSlots[tap->handle & 0xFFFF];
+    slot->tap = NULL;
+    slot->generation = slot->generation == UINT16_MAX ? 1 : slot->generation + 1;
+
+    tap_spectrum_stop(tap);
+    if (tap->nodePtr) {
+        AVAudioNode* node = (__bridge_transfer AVAudioNode*)tap->nodePtr;
+        tap->nodePtr = NULL;
+        @try {
+            [node removeTapOnBus:tap->busIndex];
+        }
+        @catch (NSException* exception) {
+            NSLog(@"tap: exception removing tap '%s': %@", tap->key, exception.reason);
+        }
+    }
+
+    tap->retiredAt = tap_now();
+    tap->next = retiredTaps;
+    retiredTaps = tap;
+}
+
+// Audio thread: publish one buffer into the tap's rings
+static void tap_process(TapState* tap, AVAudioPCMBuffer* buffer, AVAudioTime* when) {
+    const int frames = (int)buffer.frameLength;
+    float* const* channelData = buffer.floatChannelData;
+    if (frames <= 0 || !channelData) {
+        return;
+    }
+
+    // Meter every channel straight into the next ring slot
+    const int channels = tap->channelCount < (int)buffer.format.channelCount ? tap->channelCount : (int)buffer.format.channelCount;
+    const int metered = channels < TAP_METER_MAX_CHANNELS ? channels : TAP_METER_MAX_CHANNELS;
+    const uint64_t written = atomic_load_explicit(&tap->metricsWritten, memory_order_relaxed);
+    TapMetrics* slot = &tap->metrics[written & (TAP_METRICS_RING_SIZE - 1)];
+    meter_channels((const float* const*)channelData, metered, frames, slot->channels);
+    slot->channelCount = metered;
+    slot->sampleTime = when.sampleTimeValid ? when.sampleTime : 0;
+    slot->hostTime = when.hostTimeValid ? when.hostTime : mach_absolute_time();
+    slot->frameLength = frames;
+    slot->rms = slot->channels[0].rms;
+    slot->peak = slot->channels[0].peak;
+    atomic_store_explicit(&tap->metricsWritten, written + 1, memory_order_release);
+
+    // PCM: keep the newest TAP_PCM_READABLE_FRAMES frames of each channel
+    const int64_t pcmWritten = atomic_load_explicit(&tap->pcmWritten, memory_order_relaxed);
+    const int skip = frames > TAP_PCM_READABLE_FRAMES ? frames - TAP_PCM_READABLE_FRAMES : 0;
+    for (int c = 0; c < channels; c++) {
+        float* plane = tap->pcm + (size_t)c * TAP_PCM_RING_FRAMES;
+        const float* src = channelData[c];
+        for (int i = skip; i < frames; i++) {
+            plane[(pcmWritten + i) & (TAP_PCM_RING_FRAMES - 1)] = src[i];
+        }
+    }
+    atomic_store_explicit(&tap->pcmWritten, pcmWritten + frames, memory_order_release);
+
+    LoudnessState* loudness = atomic_load_explicit(&tap->loudness, memory_order_acquire);
+    if (loudness && atomic_load_explicit(&tap->loudnessEnabled, memory_order_relaxed)) {
+        loudness_process(loudness, (const float* const*)channelData, frames);
+    }
+}
+
+// Copy the newest published metrics without blocking the producer. Retries if
+// the producer lapped the ring while the slot was being copied.
+static void tap_snapshot_metrics(TapState* tap, TapMetrics* out) {
+    for (;;) {
+        const uint64_t written = atomic_load_explicit(&tap->metricsWritten, memory_order_acquire);
+        if (written == 0) {
+            memset(out, 0, sizeof(*out));
+            return;
+        }
+        *out = tap->metrics[(written - 1) & (TAP_METRICS_RING_SIZE - 1)];
+        atomic_thread_fence(memory_order_acquire);
+        if (atomic_load_explicit(&tap->metricsWritten, memory_order_relaxed) - written < TAP_METRICS_RING_SIZE - 1) {
+            return;
+        }
+    }
+}
+
+// Initialize tap storage (kept for API compatibility; storage is static)
+void tap_init(void) {
+}
+
+// Install a tap on an AVAudioNode at the specified bus; *handle (optional) receives its handle
+const char* tap_install(void* enginePtr, void* nodePtr, int busIndex, const char* tapKey, TapHandle* handle) {
     if (!enginePtr) {
         return "Engine pointer is null";
     }
@@ -58,24 +292,38 @@ const char* tap_install(void* enginePtr, void* nodePtr, int busIndex, const char
 
     AVAudioEngine* engine = (__bridge AVAudioEngine*)enginePtr;
     AVAudioNode* node = (__bridge AVAudioNode*)nodePtr;
-    NSString* tapKeyString = [NSString stringWithUTF8String:tapKey];
+
+    pthread_mutex_lock(&tapsMutex);
+    tap_collect_retired_locked();
 
     // Check for key collision (strict enforcement)
-    @synchronized(activeTaps) {
-        if (activeTaps[tapKeyString]) {
-            NSString* errorMsg = [NSString stringWithFormat:@"🚨 TAP KEY COLLISION: '%s' already exists - remove existing tap first", tapKey];
-            return [errorMsg UTF8String];
-        }
+    if (tap_find_locked(tapKey)) {
+        pthread_mutex_unlock(&tapsMutex);
+        NSString* errorMsg = [NSString stringWithFormat:@"🚨 TAP KEY COLLISION: '%s' already exists - remove existing tap first", tapKey];
+        return [errorMsg UTF8String];
+    }
+
+    // Lowest free slot keeps handles dense
+    int slotIndex = 0;
+    while (slotIndex < TAP_MAX_TAPS && tapSlots[slotIndex].tap) {
+        slotIndex++;
+    }
+    if (slotIndex == TAP_MAX_TAPS) {
+        pthread_mutex_unlock(&tapsMutex);
+        NSString* errorMsg = [NSString stringWithFormat:@"Tap table full (%d taps)", TAP_MAX_TAPS];
+        return [errorMsg UTF8String];
     }
 
     @try {
         // Check if node is attached to engine
         if (![engine.attachedNodes containsObject:node]) {
+            pthread_mutex_unlock(&tapsMutex);
             return "Node is not attached to engine";
         }
 
         // Check bus validity
         if (busIndex < 0 || busIndex >= node.numberOfOutputs) {
+            pthread_mutex_unlock(&tapsMutex);
             NSString* errorMsg = [NSString stringWithFormat:@"Invalid bus index %d for node with %d outputs",
                                   busIndex, (int)node.numberOfOutputs];
             return [errorMsg UTF8String];
@@ -84,106 +332,180 @@ const char* tap_install(void* enginePtr, void* nodePtr, int busIndex, const char
         // Get the format for this bus
         AVAudioFormat* format = [node outputFormatForBus:busIndex];
         if (!format) {
+            pthread_mutex_unlock(&tapsMutex);
             NSString* errorMsg = [NSString stringWithFormat:@"No format available for bus %d", busIndex];
             return [errorMsg UTF8String];
         }
 
+        // All per-tap memory is allocated here, never in the block
+        TapState* tap = calloc(1, sizeof(TapState));
+        float* pcm = calloc((size_t)format.channelCount * TAP_PCM_RING_FRAMES, sizeof(float));
+        char* key = strdup(tapKey);
+        if (!tap || !pcm || !key) {
+            free(tap);
+            free(pcm);
+            free(key);
+            pthread_mutex_unlock(&tapsMutex);
+            return "Failed to allocate tap buffers";
+        }
+        tap->key = key;
+        tap->pcm = pcm;
+        tap->busIndex = busIndex;
+        tap->sampleRate = format.sampleRate;
+        tap->channelCount = (int)format.channelCount;
+        atomic_init(&tap->metricsWritten, 0);
+        atomic_init(&tap->pcmWritten, 0);
+        atomic_init(&tap->loudness, NULL);
+        atomic_init(&tap->loudnessEnabled, false);
+        atomic_init(&tap->ringRefs, 0);
+        atomic_init(&tap->spectrumRefs, 0);
+
         // Remove existing tap if present on this bus (safety)
         [node removeTapOnBus:busIndex];
 
-        // Install the tap with a callback that stores audio data
+        // The block captures only the C state pointer: no retain/release, no locks
+        TapState* state = tap;
         [node installTapOnBus:busIndex bufferSize:1024 format:format block:^(AVAudioPCMBuffer * _Nonnull buffer, AVAudioTime * _Nonnull when) {
-            // Store tap information for retrieval
-            @synchronized(activeTaps) {
-                NSMutableDictionary* tapData = activeTaps[tapKeyString];
-                if (!tapData) {
-                    tapData = [[NSMutableDictionary alloc] init];
-                    activeTaps[tapKeyString] = tapData;
-                }
-
-                // Store latest buffer info (we'll keep this simple for now)
-                tapData[@"frameLength"] = @(buffer.frameLength);
-                tapData[@"frameCapacity"] = @(buffer.frameCapacity);
-                tapData[@"sampleRate"] = @(format.sampleRate);
-                tapData[@"channelCount"] = @(format.channelCount);
-                tapData[@"lastUpdateTime"] = @([[NSDate date] timeIntervalSince1970]);
-
-                // Calculate RMS for monitoring (simple implementation)
-                if (buffer.frameLength > 0 && buffer.floatChannelData) {
-                    float rms = 0.0f;
-                    float* channelData = buffer.floatChannelData[0]; // Use first channel
-                    for (UInt32 i = 0; i < buffer.frameLength; i++) {
-                        rms += channelData[i] * channelData[i];
-                    }
-                    rms = sqrt(rms / buffer.frameLength);
-                    tapData[@"rms"] = @(rms);
-                }
-            }
+            tap_process(state, buffer, when);
         }];
 
-        // Store tap info
-        @synchronized(activeTaps) {
-            NSMutableDictionary* tapData = activeTaps[tapKeyString];
-            if (!tapData) {
-                tapData = [[NSMutableDictionary alloc] init];
-                activeTaps[tapKeyString] = tapData;
-            }
-
-            tapData[@"nodePtr"] = [NSValue valueWithPointer:nodePtr];
-            tapData[@"enginePtr"] = [NSValue valueWithPointer:enginePtr];
-            tapData[@"busIndex"] = @(busIndex);
-            tapData[@"isActive"] = @YES;
-            tapData[@"sampleRate"] = @(format.sampleRate);
-            tapData[@"channelCount"] = @(format.channelCount);
+        TapSlot* slot = &tapSlots[slotIndex];
+        if (slot->generation == 0) {
+            slot->generation = 1;
+        }
+        tap->handle = ((TapHandle)slot->generation << 16) | (TapHandle)slotIndex;
+        tap->nodePtr = (__bridge_retained void*)node;
+        slot->tap = tap;
+        if (slotIndex >= tapSlotsUsed) {
+            tapSlotsUsed = slotIndex + 1;
         }
+        if (handle) {
+            *handle = tap->handle;
+        }
+        pthread_mutex_unlock(&tapsMutex);
 
         NSLog(@"tap_install: Successfully installed tap '%s' on bus %d (%.0f Hz, %d channels)",
               tapKey, busIndex, format.sampleRate, (int)format.channelCount);
         return NULL; // Success
 
     } @catch (NSException* exception) {
+        pthread_mutex_unlock(&tapsMutex);
         NSString* errorMsg = [NSString stringWithFormat:@"Exception installing tap: %@", exception.reason];
         return [errorMsg UTF8String];
     }
 }
 
-// Remove a tap by key
-const char* tap_remove(const char* tapKey) {
+// Copy a tap's description. Caller holds tapsMutex.
+static void tap_info_locked(TapState* tap, TapInfo* info) {
+    info->tapPtr = tap; // Unique while the tap is installed
+    info->handle = tap->handle;
+    info->nodePtr = tap->nodePtr;
+    info->busIndex = tap->busIndex;
+    info->isActive = true;
+    info->sampleRate = tap->sampleRate;
+    info->channelCount = tap->channelCount;
+}
+
+// Copy PCM published since *cursor. Caller holds tapsMutex.
+static void tap_read_pcm_locked(TapState* tap, float* buffer, int maxFrames, bool interleaved, int64_t* cursor, int* framesRead) {
+    const int channels = tap->channelCount;
+    int64_t start = *cursor;
+    int frames = 0;
+    for (;;) {
+        const int64_t written = atomic_load_explicit(&tap->pcmWritten, memory_order_acquire);
+        if (start > written) {
+            start = written;
+        }
+        if (start < written - TAP_PCM_READABLE_FRAMES) {
+            start = written - TAP_PCM_READABLE_FRAMES;
+        }
+        frames = (int)((written - start) < maxFrames ? (written - start) : maxFrames);
+        for (int c = 0; c < channels; c++) {
+            const float* plane = tap->pcm + (size_t)c * TAP_PCM_RING_FRAMES;
+            for (int i = 0; i < frames; i++) {
+                const float sample = plane[(start + i) & (TAP_PCM_RING_FRAMES - 1)];
+                if (interleaved) {
+                    buffer[(size_t)i * channels + c] = sample;
+                } else {
+                    buffer[(size_t)c * frames + i] = sample;
+                }
+            }
+        }
+        atomic_thread_fence(memory_order_acquire);
+        // Valid unless the producer overwrote part of [start, start + frames) meanwhile
+        if (atomic_load_explicit(&tap->pcmWritten, memory_order_relaxed) - TAP_PCM_READABLE_FRAMES <= start) {
+            break;
+        }
+    }
+
+    *cursor = start + frames;
+    *framesRead = frames;
+}
+
+// Map a tap's PCM ring and take a reader reference. Caller holds tapsMutex.
+static void tap_map_ring_locked(TapState* tap, TapRing* ring) {
+    atomic_fetch_add(&tap->ringRefs, 1);
+    ring->data = tap->pcm;
+    ring->writeIndex = (const int64_t*)&tap->pcmWritten;
+    ring->channelCount = tap->channelCount;
+    ring->capacity = TAP_PCM_RING_FRAMES;
+    ring->readable = TAP_PCM_READABLE_FRAMES;
+    ring->sampleRate = tap->sampleRate;
+    ring->handle = tap;
+}
+
+// Resolve a key to its tap handle
+const char* tap_lookup(const char* tapKey, TapHandle* handle) {
     if (!tapKey) {
         return "Tap key is null";
     }
+    if (!handle) {
+        return "Handle pointer is null";
+    }
 
-    tap_init();
-
-    NSString* tapKeyString = [NSString stringWithUTF8String:tapKey];
+    pthread_mutex_lock(&tapsMutex);
+    TapState* tap = tap_find_locked(tapKey);
+    *handle = tap ? tap->handle : TAP_INVALID_HANDLE;
+    pthread_mutex_unlock(&tapsMutex);
 
-    @try {
-        @synchronized(activeTaps) {
-            NSMutableDictionary* tapData = activeTaps[tapKeyString];
-            if (!tapData) {
-                return "Tap not found";
-            }
+    return tap ? NULL : "Tap not found";
+}
 
-            // Get the node and bus from stored data
-            void* nodePtr = [[tapData objectForKey:@"nodePtr"] pointerValue];
-            int busIndex = [[tapData objectForKey:@"busIndex"] intValue];
+// Remove a tap by key
+const char* tap_remove(const char* tapKey) {
+    if (!tapKey) {
+        return "Tap key is null";
+    }
 
-            if (nodePtr) {
-                AVAudioNode* node = (__bridge AVAudioNode*)nodePtr;
-                [node removeTapOnBus:busIndex];
-            }
+    tap_init();
 
-            // Remove from our storage
-            [activeTaps removeObjectForKey:tapKeyString];
-        }
+    pthread_mutex_lock(&tapsMutex);
+    TapState* tap = tap_find_locked(tapKey);
+    if (!tap) {
+        pthread_mutex_unlock(&tapsMutex);
+        return "Tap not found";
+    }
+    tap_retire_locked(tap);
+    tap_collect_retired_locked();
+    pthread_mutex_unlock(&tapsMutex);
 
-        NSLog(@"tap_remove: Successfully removed tap '%s'", tapKey);
-        return NULL; // Success
+    NSLog(@"tap_remove: Successfully removed tap '%s'", tapKey);
+    return NULL; // Success
+}
 
-    } @catch (NSException* exception) {
-        NSString* errorMsg = [NSString stringWithFormat:@"Exception removing tap: %@", exception.reason];
-        return [errorMsg UTF8String];
+// Remove a tap by handle
+const char* tap_remove_handle(TapHandle handle) {
+    pthread_mutex_lock(&tapsMutex);
+    TapState* tap = tap_from_handle_locked(handle);
+    if (!tap) {
+        pthread_mutex_unlock(&tapsMutex);
+        return "Invalid or stale tap handle";
     }
+    tap_retire_locked(tap);
+    tap_collect_retired_locked();
+    pthread_mutex_unlock(&tapsMutex);
+
+    return NULL; // Success
 }
 
 // Get tap information and metrics
@@ -197,99 +519,562 @@ const char* tap_get_info(const char* tapKey, TapInfo* info) {
 
     tap_init();
 
-    NSString* tapKeyString = [NSString stringWithUTF8String:tapKey];
+    pthread_mutex_lock(&tapsMutex);
+    TapState* tap = tap_find_locked(tapKey);
+    if (!tap) {
+        pthread_mutex_unlock(&tapsMutex);
+        return "Tap not found";
+    }
+    tap_info_locked(tap, info);
+    pthread_mutex_unlock(&tapsMutex);
 
-    @synchronized(activeTaps) {
-        NSMutableDictionary* tapData = activeTaps[tapKeyString];
-        if (!tapData) {
-            return "Tap not found";
-        }
+    return NULL; // Success
+}
 
-        info->tapPtr = (void*)[tapKeyString hash]; // Use string hash as identifier
-        info->nodePtr = [[tapData objectForKey:@"nodePtr"] pointerValue];
-        info->busIndex = [[tapData objectForKey:@"busIndex"] intValue];
-        info->isActive = [[tapData objectForKey:@"isActive"] boolValue];
-        info->sampleRate = [[tapData objectForKey:@"sampleRate"] doubleValue];
-        info->channelCount = [[tapData objectForKey:@"channelCount"] intValue];
+const char* tap_get_info_handle(TapHandle handle, TapInfo* info) {
+    if (!info) {
+        return "Info pointer is null";
+    }
 
-        return NULL; // Success
+    pthread_mutex_lock(&tapsMutex);
+    TapState* tap = tap_from_handle_locked(handle);
+    if (!tap) {
+        pthread_mutex_unlock(&tapsMutex);
+        return "Invalid or stale tap handle";
     }
+    tap_info_locked(tap, info);
+    pthread_mutex_unlock(&tapsMutex);
+
+    return NULL; // Success
 }
 
-// Get current RMS level from tap
-const char* tap_get_rms(const char* tapKey, double* result) {
+// Get a consistent snapshot of the newest block's metrics
+const char* tap_get_metrics(const char* tapKey, TapMetrics* metrics) {
     if (!tapKey) {
         return "Tap key is null";
     }
-    if (!result) {
-        return "Result pointer is null";
+    if (!metrics) {
+        return "Metrics pointer is null";
     }
 
     tap_init();
 
-    NSString* tapKeyString = [NSString stringWithUTF8String:tapKey];
+    pthread_mutex_lock(&tapsMutex);
+    TapState* tap = tap_find_locked(tapKey);
+    if (!tap) {
+        pthread_mutex_unlock(&tapsMutex);
+        return "Tap not found";
+    }
+    tap_snapshot_metrics(tap, metrics);
+    pthread_mutex_unlock(&tapsMutex);
 
-    @synchronized(activeTaps) {
-        NSMutableDictionary* tapData = activeTaps[tapKeyString];
-        if (!tapData) {
-            return "Tap not found";
+    return NULL; // Success
+}
+
+const char* tap_get_metrics_handle(TapHandle handle, TapMetrics* metrics) {
+    if (!metrics) {
+        return "Metrics pointer is null";
+    }
+
+    pthread_mutex_lock(&tapsMutex);
+    TapState* tap = tap_from_handle_locked(handle);
+    if (!tap) {
+        pthread_mutex_unlock(&tapsMutex);
+        return "Invalid or stale tap handle";
+    }
+    tap_snapshot_metrics(tap, metrics);
+    pthread_mutex_unlock(&tapsMutex);
+
+    return NULL; // Success
+}
+
+// Fill metrics for a set of taps under a single lock acquisition
+int tap_get_metrics_batch(const char* const* tapKeys, int count, TapMetrics* metrics, bool* found) {
+    if (!tapKeys || !metrics || count <= 0) {
+        return 0;
+    }
+
+    tap_init();
+
+    int foundCount = 0;
+    pthread_mutex_lock(&tapsMutex);
+    for (int i = 0; i < count; i++) {
+        TapState* tap = tapKeys[i] ? tap_find_locked(tapKeys[i]) : NULL;
+        if (tap) {
+            tap_snapshot_metrics(tap, &metrics[i]);
+            foundCount++;
+        } else {
+            memset(&metrics[i], 0, sizeof(metrics[i]));
+        }
+        if (found) {
+            found[i] = tap != NULL;
         }
+    }
+    pthread_mutex_unlock(&tapsMutex);
+
+    return foundCount;
+}
+
+int tap_get_metrics_handles(const TapHandle* handles, int count, TapMetrics* metrics, bool* found) {
+    if (!handles || !metrics || count <= 0) {
+        return 0;
+    }
 
-        NSNumber* rms = tapData[@"rms"];
-        if (rms) {
-            *result = [rms doubleValue];
+    int foundCount = 0;
+    pthread_mutex_lock(&tapsMutex);
+    for (int i = 0; i < count; i++) {
+        TapState* tap = tap_from_handle_locked(handles[i]);
+        if (tap) {
+            tap_snapshot_metrics(tap, &metrics[i]);
+            foundCount++;
         } else {
-            *result = 0.0;
+            memset(&metrics[i], 0, sizeof(metrics[i]));
+        }
+        if (found) {
+            found[i] = tap != NULL;
+        }
+    }
+    pthread_mutex_unlock(&tapsMutex);
+
+    return foundCount;
+}
+
+// Fill metrics and packed keys for every installed tap
+const char* tap_get_metrics_all(TapMetrics* metrics, TapHandle* handles, int capacity, char* keyBuffer,
+                                int keyBufferSize, int* tapCount, int* keyBytes) {
+    if (!tapCount || !keyBytes) {
+        return "Result pointer is null";
+    }
+
+    tap_init();
+
+    pthread_mutex_lock(&tapsMutex);
+    int count = 0;
+    int bytes = 0;
+    for (int s = 0; s < tapSlotsUsed; s++) {
+        if (tapSlots[s].tap) {
+            count++;
+            bytes += (int)strlen(tapSlots[s].tap->key) + 1;
+        }
+    }
+    *tapCount = count;
+    *keyBytes = bytes;
+
+    if (count <= capacity && bytes <= keyBufferSize && (count == 0 || (metrics && keyBuffer))) {
+        int i = 0;
+        char* key = keyBuffer;
+        for (int s = 0; s < tapSlotsUsed; s++) {
+            TapState* tap = tapSlots[s].tap;
+            if (!tap) {
+                continue;
+            }
+            if (handles) {
+                handles[i] = tap->handle;
+            }
+            tap_snapshot_metrics(tap, &metrics[i++]);
+            const size_t length = strlen(tap->key) + 1;
+            memcpy(key, tap->key, length);
+            key += length;
         }
     }
+    pthread_mutex_unlock(&tapsMutex);
 
     return NULL; // Success
 }
 
+// Get current RMS level from tap
+const char* tap_get_rms(const char* tapKey, double* result) {
+    if (!result) {
+        return "Result pointer is null";
+    }
+
+    TapMetrics metrics;
+    const char* err = tap_get_metrics(tapKey, &metrics);
+    if (err) {
+        return err;
+    }
+    *result = metrics.rms;
+    return NULL; // Success
+}
+
 // Get frame count from last buffer
 const char* tap_get_frame_count(const char* tapKey, int* result) {
+    if (!result) {
+        return "Result pointer is null";
+    }
+
+    TapMetrics metrics;
+    const char* err = tap_get_metrics(tapKey, &metrics);
+    if (err) {
+        return err;
+    }
+    *result = metrics.frameLength;
+    return NULL; // Success
+}
+
+// Copy PCM published since *cursor. Frames older than the ring are skipped
+// (the cursor jumps forward); on return *cursor is advanced past the copied frames.
+const char* tap_read_pcm(const char* tapKey, float* buffer, int maxFrames, bool interleaved, int64_t* cursor, int* framesRead) {
     if (!tapKey) {
         return "Tap key is null";
     }
-    if (!result) {
+    if (!buffer || !cursor || !framesRead) {
         return "Result pointer is null";
     }
+    if (maxFrames <= 0) {
+        return "Frame count must be positive";
+    }
 
     tap_init();
 
-    NSString* tapKeyString = [NSString stringWithUTF8String:tapKey];
+    pthread_mutex_lock(&tapsMutex);
+    TapState* tap = tap_find_locked(tapKey);
+    if (!tap) {
+        pthread_mutex_unlock(&tapsMutex);
+        return "Tap not found";
+    }
+    tap_read_pcm_locked(tap, buffer, maxFrames, interleaved, cursor, framesRead);
+    pthread_mutex_unlock(&tapsMutex);
 
-    @synchronized(activeTaps) {
-        NSMutableDictionary* tapData = activeTaps[tapKeyString];
-        if (!tapData) {
-            return "Tap not found";
-        }
+    return NULL; // Success
+}
 
-        NSNumber* frameLength = tapData[@"frameLength"];
-        if (frameLength) {
-            *result = [frameLength intValue];
-        } else {
-            *result = 0;
-        }
+const char* tap_read_pcm_handle(TapHandle handle, float* buffer, int maxFrames, bool interleaved, int64_t* cursor, int* framesRead) {
+    if (!buffer || !cursor || !framesRead) {
+        return "Result pointer is null";
+    }
+    if (maxFrames <= 0) {
+        return "Frame count must be positive";
+    }
+
+    pthread_mutex_lock(&tapsMutex);
+    TapState* tap = tap_from_handle_locked(handle);
+    if (!tap) {
+        pthread_mutex_unlock(&tapsMutex);
+        return "Invalid or stale tap handle";
+    }
+    tap_read_pcm_locked(tap, buffer, maxFrames, interleaved, cursor, framesRead);
+    pthread_mutex_unlock(&tapsMutex);
+
+    return NULL; // Success
+}
+
+// Map a tap's PCM ring for zero-copy reading; pair with tap_release_ring
+const char* tap_get_ring(const char* tapKey, TapRing* ring) {
+    if (!tapKey) {
+        return "Tap key is null";
+    }
+    if (!ring) {
+        return "Ring pointer is null";
     }
 
+    tap_init();
+
+    pthread_mutex_lock(&tapsMutex);
+    TapState* tap = tap_find_locked(tapKey);
+    if (!tap) {
+        pthread_mutex_unlock(&tapsMutex);
+        return "Tap not found";
+    }
+    tap_map_ring_locked(tap, ring);
+    pthread_mutex_unlock(&tapsMutex);
+
     return NULL; // Success
 }
 
+const char* tap_get_ring_handle(TapHandle handle, TapRing* ring) {
+    if (!ring) {
+        return "Ring pointer is null";
+    }
+
+    pthread_mutex_lock(&tapsMutex);
+    TapState* tap = tap_from_handle_locked(handle);
+    if (!tap) {
+        pthread_mutex_unlock(&tapsMutex);
+        return "Invalid or stale tap handle";
+    }
+    tap_map_ring_locked(tap, ring);
+    pthread_mutex_unlock(&tapsMutex);
+
+    return NULL; // Success
+}
+
+// Drop a mapping from tap_get_ring; the ring is freed once its tap is removed
+void tap_release_ring(TapRing* ring) {
+    if (!ring || !ring->handle) {
+        return;
+    }
+
+    TapState* tap = ring->handle;
+    pthread_mutex_lock(&tapsMutex);
+    atomic_fetch_sub(&tap->ringRefs, 1);
+    tap_collect_retired_locked();
+    pthread_mutex_unlock(&tapsMutex);
+
+    memset(ring, 0, sizeof(*ring));
+}
+
 // Remove all taps (cleanup)
 const char* tap_remove_all(void) {
     tap_init();
 
-    @synchronized(activeTaps) {
-        // We can't easily remove all taps without keeping engine reference
-        // So we'll just clear our storage
-        [activeTaps removeAllObjects];
-        NSLog(@"tap_remove_all: Cleared tap storage");
+    pthread_mutex_lock(&tapsMutex);
+    for (int s = 0; s < tapSlotsUsed; s++) {
+        if (tapSlots[s].tap) {
+            tap_retire_locked(tapSlots[s].tap);
+        }
     }
+    tap_collect_retired_locked();
+    pthread_mutex_unlock(&tapsMutex);
 
+    NSLog(@"tap_remove_all: Cleared tap storage");
     return NULL; // Success
 }
 
+// Turn the tap's loudness meter on or off; turning it on starts a fresh measurement
+const char* tap_enable_loudness(TapHandle handle, bool enabled) {
+    pthread_mutex_lock(&tapsMutex);
+    TapState* tap = tap_from_handle_locked(handle);
+    if (!tap) {
+        pthread_mutex_unlock(&tapsMutex);
+        return "Invalid or stale tap handle";
+    }
+
+    if (enabled) {
+        LoudnessState* loudness = atomic_load(&tap->loudness);
+        if (loudness) {
+            loudness_request_reset(loudness);
+        } else {
+            // Allocated here, never in the block
+            loudness = malloc(sizeof(LoudnessState));
+            if (!loudness) {
+                pthread_mutex_unlock(&tapsMutex);
+                return "Failed to allocate loudness meter";
+            }
+            loudness_init(loudness, tap->sampleRate, tap->channelCount);
+            atomic_store_explicit(&tap->loudness, loudness, memory_order_release);
+        }
+    }
+    atomic_store(&tap->loudnessEnabled, enabled);
+    pthread_mutex_unlock(&tapsMutex);
+
+    return NULL; // Success
+}
+
+// Restart the tap's loudness measurement (integrated, range, maxima, true peak)
+const char* tap_reset_loudness(TapHandle handle) {
+    pthread_mutex_lock(&tapsMutex);
+    TapState* tap = tap_from_handle_locked(handle);
+    LoudnessState* loudness = tap ? atomic_load(&tap->loudness) : NULL;
+    if (loudness) {
+        loudness_request_reset(loudness);
+    }
+    pthread_mutex_unlock(&tapsMutex);
+
+    if (!tap) {
+        return "Invalid or stale tap handle";
+    }
+    return loudness ? NULL : "Loudness metering is not enabled on this tap";
+}
+
+// Snapshot the tap's loudness meter
+const char* tap_get_loudness(TapHandle handle, LoudnessMetrics* metrics) {
+    if (!metrics) {
+        return "Metrics pointer is null";
+    }
+
+    pthread_mutex_lock(&tapsMutex);
+    TapState* tap = tap_from_handle_locked(handle);
+    LoudnessState* loudness = tap && atomic_load(&tap->loudnessEnabled) ? atomic_load(&tap->loudness) : NULL;
+    if (loudness) {
+        loudness_read(loudness, metrics);
+    }
+    pthread_mutex_unlock(&tapsMutex);
+
+    if (!tap) {
+        return "Invalid or stale tap handle";
+    }
+    return loudness ? NULL : "Loudness metering is not enabled on this tap";
+}
+
+// Start, reconfigure or stop the tap's spectrum analyzer (config NULL for defaults)
+const char* tap_enable_spectrum(TapHandle handle, bool enabled, const SpectrumConfig* config) {
+    pthread_mutex_lock(&tapsMutex);
+    TapState* tap = tap_from_handle_locked(handle);
+    if (!tap) {
+        pthread_mutex_unlock(&tapsMutex);
+        return "Invalid or stale tap handle";
+    }
+    if (!enabled) {
+        tap_spectrum_stop(tap);
+        pthread_mutex_unlock(&tapsMutex);
+        return NULL; // Success
+    }
+
+    SpectrumConfig wanted;
+    spectrum_default_config(&wanted);
+    if (config) {
+        wanted = *config;
+    }
+    if (!tap->spectrum || !spectrum_config_equal(&wanted, &tap->spectrumConfig)) {
+        if (atomic_load(&tap->spectrumRefs) > 0) {
+            pthread_mutex_unlock(&tapsMutex);
+            return "Spectrum is mapped by a reader; release it before reconfiguring";
+        }
+        SpectrumAnalyzer* analyzer = malloc(sizeof(SpectrumAnalyzer));
+        if (!analyzer) {
+            pthread_mutex_unlock(&tapsMutex);
+            return "Failed to allocate spectrum analyzer";
+        }
+        const char* error = spectrum_analyzer_init(analyzer, &wanted, tap->sampleRate, tap->channelCount);
+        if (error) {
+            free(analyzer);
+            pthread_mutex_unlock(&tapsMutex);
+            return error;
+        }
+        tap_spectrum_stop(tap);
+        if (tap->spectrum) {
+            spectrum_analyzer_free(tap->spectrum);
+            free(tap->spectrum);
+        }
+        tap->spectrum = analyzer;
+        tap->spectrumConfig = wanted;
+    }
+    tap_spectrum_stop(tap);
+    const bool started = tap_spectrum_start(tap);
+    pthread_mutex_unlock(&tapsMutex);
+
+    return started ? NULL : "Failed to start spectrum worker";
+}
+
+// Map the tap's spectrum snapshots for zero-copy reading; pair with tap_release_spectrum
+const char* tap_get_spectrum(TapHandle handle, SpectrumView* view) {
+    if (!view) {
+        return "View pointer is null";
+    }
+
+    pthread_mutex_lock(&tapsMutex);
+    TapState* tap = tap_from_handle_locked(handle);
+    if (!tap) {
+        pthread_mutex_unlock(&tapsMutex);
+        return "Invalid or stale tap handle";
+    }
+    SpectrumAnalyzer* analyzer = tap->spectrum;
+    if (!analyzer) {
+        pthread_mutex_unlock(&tapsMutex);
+        return "Spectrum analysis is not enabled on this tap";
+    }
+    atomic_fetch_add(&tap->spectrumRefs, 1);
+    const size_t snapshotSize = (size_t)analyzer->channelCount * analyzer->plan.binCount;
+    view->data[0] = analyzer->snapshots;
+    view->data[1] = analyzer->snapshots + snapshotSize;
+    view->positions = analyzer->positions;
+    view->published = &analyzer->published;
+    view->writing = &analyzer->writing;
+    view->frequencies = analyzer->plan.frequencies;
+    view->channelCount = analyzer->channelCount;
+    view->binCount = analyzer->plan.binCount;
+    view->fftSize = analyzer->plan.fftSize;
+    view->hopSize = analyzer->plan.hopSize;
+    view->sampleRate = tap->sampleRate;
+    view->handle = tap;
+    pthread_mutex_unlock(&tapsMutex);
+
+    return NULL; // Success
+}
+
+// Drop a mapping from tap_get_spectrum; the analyzer is freed with its tap
+void tap_release_spectrum(SpectrumView* view) {
+    if (!view || !view->handle) {
+        return;
+    }
+
+    TapState* tap = view->handle;
+    pthread_mutex_lock(&tapsMutex);
+    atomic_fetch_sub(&tap->spectrumRefs, 1);
+    tap_collect_retired_locked();
+    pthread_mutex_unlock(&tapsMutex);
+
+    memset(view, 0, sizeof(*view));
+}
+
+// Create a reusable offline spectrum plan (config NULL for defaults)
+const char* spectrum_plan_create(const SpectrumConfig* config, double sampleRate, SpectrumPlan** plan, int* binCount,
+                                 const float** frequencies) {
+    if (!plan || !binCount || !frequencies) {
+        return "Result pointer is null";
+    }
+
+    SpectrumConfig wanted;
+    spectrum_default_config(&wanted);
+    if (config) {
+        wanted = *config;
+    }
+    SpectrumPlan* created = malloc(sizeof(SpectrumPlan));
+    if (!created) {
+        return "Failed to allocate spectrum plan";
+    }
+    const char* error = spectrum_plan_init(created, &wanted, sampleRate);
+    if (error) {
+        free(created);
+        return error;
+    }
+    *binCount = created->binCount;
+    *frequencies = created->frequencies;
+    *plan = created;
+    return NULL; // Success
+}
+
+// Spectrum of one window of fftSize samples
+void spectrum_plan_process(SpectrumPlan* plan, const float* samples, float* out) {
+    if (plan && samples && out) {
+        spectrum_plan_run(plan, samples, out);
+    }
+}
+
+void spectrum_plan_destroy(SpectrumPlan* plan) {
+    if (plan) {
+        spectrum_plan_free(plan);
+        free(plan);
+    }
+}
+
+// Measure the loudness of planar float data in one pass
+void loudness_measure_planar(const float* data, int channelCount, int frames, double sampleRate, LoudnessMetrics* metrics) {
+    if (!data || !metrics || channelCount <= 0 || frames < 0 || sampleRate <= 0.0) {
+        return;
+    }
+
+    LoudnessState* state = malloc(sizeof(LoudnessState));
+    if (!state) {
+        memset(metrics, 0, sizeof(*metrics));
+        return;
+    }
+    loudness_init(state, sampleRate, channelCount);
+    const float* channels[LOUDNESS_MAX_CHANNELS];
+    for (int c = 0; c < state->channelCount; c++) {
+        channels[c] = data + (size_t)c * frames;
+    }
+    loudness_process(state, channels, frames);
+    loudness_read(state, metrics);
+    free(state);
+}
+
+// Meter planar float data with the shared kernel
+void meter_measure_planar(const float* data, int channelCount, int frames, MeterChannelStats* stats) {
+    if (!data || !stats || channelCount <= 0 || frames < 0) {
+        return;
+    }
+    for (int c = 0; c < channelCount; c++) {
+        meter_channel(data + (size_t)c * frames, frames, &stats[c]);
+    }
+}
+
+// Name of the kernel selected for this CPU ("avx2", "sse2", "neon" or "scalar")
+const char* meter_kernel_name(void) {
+    return meter_kernel();
+}
+
 // Get number of active taps
 const char* tap_get_active_count(int* result) {
     if (!result) {
@@ -298,13 +1083,13 @@ const char* tap_get_active_count(int* result) {
 
     tap_init();
 
-    @synchronized(activeTaps) {
-        *result = (int)[activeTaps count];
+    pthread_mutex_lock(&tapsMutex);
+    int count = 0;
+    for (int s = 0; s < tapSlotsUsed; s++) {
+        count += tapSlots[s].tap != NULL;
     }
+    pthread_mutex_unlock(&tapsMutex);
 
+    *result = count;
     return NULL; // Success
 }
-
-#ifdef __cplusplus
-}
-#endif
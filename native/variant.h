@@ -0,0 +1,326 @@
+// Pre-rendered rate/pitch variants, shared by both player backends.
+//
+// A variant is a whole file rendered offline at one playback rate and pitch
+// shift: the WSOLA time stretch (wsola.h) at the rate, then the phase vocoder
+// (pitchshift.h) at the shift, both at the file's own sample rate, with the
+// shifter's fftSize frames of latency read ahead and flushed with silence.
+// Frame k of a variant plays the file near frame k * rate, so a player moves
+// between the file and its variants by scaling its position.
+//
+// The backends keep variants in memory with pcmcache.h, under the file's key
+// with the parameters appended (variant_cache_key). On disk,
+// "<dir>/<sha256 of the file>-<parameters>.variant" holds a VariantRecord and
+// then the planar samples, written through a temporary file and renamed like
+// analysis cache entries. Every hit touches the entry's mtime;
+// variant_cache_evict drops the least recently used entries until the
+// directory is under its size cap. The directory keeps its own paths/ aliases
+// (analysis_cache_key), so it is best kept apart from the analysis cache's,
+// whose alias pruning knows only .cache entries.
+//
+// Header-only like analysiscache.h; no locking of its own.
+
+#ifndef MACAUDIO_VARIANT_H
+#define MACAUDIO_VARIANT_H
+
+#include <math.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "analysiscache.h"
+#include "pitchshift.h"
+#include "wsola.h"
+
+#define VARIANT_CACHE_MAGIC "MAVARNT1"
+#define VARIANT_RENDER_BLOCK 4096
+
+typedef struct {
+    float rate;   // WSOLA_MIN_RATE ... WSOLA_MAX_RATE
+    float cents;  // -PITCH_SHIFT_MAX_CENTS ... PITCH_SHIFT_MAX_CENTS
+    int quality;  // PITCH_SHIFT_QUALITY_*, like the player's pitch shift unit
+    int fftSize;  // 0 for the quality's own
+    int preserveFormants;
+} VariantParams;
+
+typedef struct {
+    char magic[8];  // VARIANT_CACHE_MAGIC
+    double sampleRate;
+    int64_t sourceFrames;  // Frames of the file it was rendered from
+    int64_t frames;        // Frames per channel that follow
+    int32_t channelCount;
+    VariantParams params;
+} VariantRecord;
+
+// Return false to cancel; `done` runs from 0 to 1
+typedef bool (*VariantProgress)(void* context, double done);
+
+static inline bool variant_is_identity(const VariantParams* params) {
+    return params->rate == 1.0f && params->cents == 0.0f;
+}
+
+static inline int64_t variant_frames(int64_t sourceFrames, float rate) {
+    return (int64_t)ceil((double)sourceFrames / (double)rate);
+}
+
+// Memory cache key: the file's path with the parameters appended (malloc'd)
+static inline char* variant_cache_key(const char* path, const VariantParams* params) {
+    const size_t length = strlen(path) + 96;
+    char* key = (char*)malloc(length);
+    if (key) {
+        snprintf(key, length, "%s\n%.9g\n%.9g\n%d\n%d\n%d", path, params->rate, params->cents, params->quality,
+                 params->fftSize, params->preserveFormants);
+    }
+    return key;
+}
+
+// ----------------------------------------------------------------------------
+// Rendering
+// ----------------------------------------------------------------------------
+
+// Render `sourceFrames` planar frames of `input` into variant_frames() frames
+// of planar `output` (which may not be the input). Returns NULL on success.
+static inline const char* variant_render(const float* const* input, int channelCount, int64_t sourceFrames,
+                                         double sampleRate, const VariantParams* params, float* const* output,
+                                         VariantProgress progress, void* context) {
+    const int64_t frames = variant_frames(sourceFrames, params->rate);
+    const int block = VARIANT_RENDER_BLOCK;
+    float* scratch = (float*)calloc((size_t)channelCount * block, sizeof(float));
+    if (!scratch) {
+        return "Failed to allocate variant scratch";
+    }
+    const bool stretching = params->rate != 1.0f;
+    const bool shifting = params->cents != 0.0f;
+    const double stages = (stretching ? 1.0 : 0.0) + (shifting ? 1.0 : 0.0);
+
+    // Time stretch, fed a block at a time like the live unit, then silence
+    if (stretching) {
+        WsolaState wsola;
+        const char* err = wsola_init(&wsola, sampleRate, channelCount, block);
+        if (err) {
+            free(scratch);
+            return err;
+        }
+        int64_t written = 0;
+        for (int64_t done = 0; done < frames;) {
+            const int count = frames - done < block ? (int)(frames - done) : block;
+            while (wsola_available(&wsola) < count) {
+                if (wsola_input_needed(&wsola, params->rate) == 0) {
+                    wsola_synthesize(&wsola, params->rate);
+                } else if (written < sourceFrames) {
+                    const int take = sourceFrames - written < block ? (int)(sourceFrames - written) : block;
+                    for (int c = 0; c < channelCount; c++) {
+                        memcpy(scratch + (size_t)c * block, input[c] + written, (size_t)take * sizeof(float));
+                        memset(scratch + (size_t)c * block + take, 0, (size_t)(block - take) * sizeof(float));
+                    }
+                    wsola_write(&wsola, scratch, block, block);
+                    written += take;
+                } else {
+                    wsola_write(&wsola, NULL, 0, block);
+                }
+            }
+            wsola_read(&wsola, scratch, block, count);
+            for (int c = 0; c < channelCount; c++) {
+                memcpy(output[c] + done, scratch + (size_t)c * block, (size_t)count * sizeof(float));
+            }
+            done += count;
+            if (progress && !progress(context, (double)done / (double)frames / stages)) {
+                wsola_free(&wsola);
+                free(scratch);
+                return "Cancelled";
+            }
+        }
+        wsola_free(&wsola);
+    } else {
+        for (int c = 0; c < channelCount; c++) {
+            memcpy(output[c], input[c], (size_t)frames * sizeof(float));
+        }
+    }
+
+    // Pitch shift in place: output frame k is written once input frame k +
+    // fftSize has been read, and the last fftSize frames are flushed with silence
+    if (shifting) {
+        PitchShifter shifter;
+        const char* err = pitchshift_init(&shifter, sampleRate, channelCount, params->quality, params->fftSize);
+        if (err) {
+            free(scratch);
+            return err;
+        }
+        const int64_t latency = shifter.fftSize;
+        for (int64_t read = 0; read < frames + latency;) {
+            const int count = frames + latency - read < block ? (int)(frames + latency - read) : block;
+            const int available = read < frames ? (frames - read < count ? (int)(frames - read) : count) : 0;
+            for (int c = 0; c < channelCount; c++) {
+                float* plane = scratch + (size_t)c * block;
+                memcpy(plane, output[c] + read, (size_t)available * sizeof(float));
+                memset(plane + available, 0, (size_t)(count - available) * sizeof(float));
+            }
+            pitchshift_run(&shifter, scratch, block, scratch, block, count, params->cents,
+                           params->preserveFormants != 0);
+            for (int i = 0; i < count; i++) {
+                const int64_t at = read + i - latency;
+                if (at < 0 || at >= frames) {
+                    continue;
+                }
+                for (int c = 0; c < channelCount; c++) {
+                    output[c][at] = scratch[(size_t)c * block + i];
+                }
+            }
+            read += count;
+            const double done = (double)(read < frames ? read : frames) / (double)frames;
+            if (progress && !progress(context, (stages - 1.0 + done) / stages)) {
+                pitchshift_free(&shifter);
+                free(scratch);
+                return "Cancelled";
+            }
+        }
+        pitchshift_free(&shifter);
+    }
+    free(scratch);
+    return NULL;
+}
+
+// ----------------------------------------------------------------------------
+// Disk entries
+// ----------------------------------------------------------------------------
+
+static inline uint32_t variant_float_bits(float value) {
+    uint32_t bits;
+    memcpy(&bits, &value, sizeof(bits));
+    return bits;
+}
+
+// malloc'd path of the entry for `params` of the file with content `hash`
+static inline char* variant_cache_path(const char* directory, const char* hash, const VariantParams* params) {
+    char suffix[96];
+    snprintf(suffix, sizeof(suffix), "-%08x-%08x-%d-%d-%d.variant", variant_float_bits(params->rate),
+             variant_float_bits(params->cents), params->quality, params->fftSize, params->preserveFormants);
+    return analysis_cache_path(directory, hash, suffix);
+}
+
+// Open the entry and read its record, positioned at the samples. Returns NULL
+// on a miss or a record that does not match.
+static inline FILE* variant_cache_open(const char* directory, const char* hash, const VariantParams* params,
+                                       VariantRecord* record) {
+    char* path = variant_cache_path(directory, hash, params);
+    if (!path) {
+        return NULL;
+    }
+    FILE* file = fopen(path, "rb");
+    if (file && (fread(record, sizeof(*record), 1, file) != 1 || memcmp(record->magic, VARIANT_CACHE_MAGIC, 8) != 0 ||
+                 memcmp(&record->params, params, sizeof(*params)) != 0 || record->channelCount <= 0 ||
+                 record->frames != variant_frames(record->sourceFrames, params->rate))) {
+        fclose(file);
+        file = NULL;
+    }
+    if (file) {
+        utimes(path, NULL);  // Most recently used
+    }
+    free(path);
+    return file;
+}
+
+// Read the planar samples after the record and close the file. Returns 0 on
+// a short read.
+static inline int variant_cache_read(FILE* file, const VariantRecord* record, float* const* planes) {
+    int ok = 1;
+    for (int c = 0; ok && c < record->channelCount; c++) {
+        ok = fread(planes[c], sizeof(float), (size_t)record->frames, file) == (size_t)record->frames;
+    }
+    fclose(file);
+    return ok;
+}
+
+// Write an entry through a unique temporary file. Returns 0 on failure.
+static inline int variant_cache_write(const char* directory, const char* hash, const VariantRecord* record,
+                                      const float* const* planes) {
+    char* path = variant_cache_path(directory, hash, &record->params);
+    const size_t length = path ? strlen(path) + 8 : 0;
+    char* temporary = path ? (char*)malloc(length) : NULL;
+    if (!temporary) {
+        free(path);
+        return 0;
+    }
+    snprintf(temporary, length, "%s.XXXXXX", path);
+    const int fd = mkstemp(temporary);
+    FILE* file = fd >= 0 ? fdopen(fd, "wb") : NULL;
+    int ok = file != NULL;
+    if (!file && fd >= 0) {
+        close(fd);
+    }
+    ok = ok && fwrite(record, sizeof(*record), 1, file) == 1;
+    for (int c = 0; ok && c < record->channelCount; c++) {
+        ok = fwrite(planes[c], sizeof(float), (size_t)record->frames, file) == (size_t)record->frames;
+    }
+    if (file) {
+        ok = fclose(file) == 0 && ok;
+    }
+    ok = ok && chmod(temporary, 0644) == 0 && rename(temporary, path) == 0;
+    if (!ok && fd >= 0) {
+        remove(temporary);
+    }
+    free(temporary);
+    free(path);
+    return ok;
+}
+
+// Delete least recently used entries until the total is at most maxBytes
+// (maxBytes <= 0 removes every entry), like analysis_cache_evict. Reports what
+// remains and returns the number of entries removed.
+static inline int variant_cache_evict(const char* directory, int64_t maxBytes, int64_t* bytes, int* entries) {
+    *bytes = 0;
+    *entries = 0;
+    DIR* dir = opendir(directory);
+    if (!dir) {
+        return 0;
+    }
+    AnalysisCacheFile* files = NULL;
+    int count = 0, capacity = 0;
+    struct dirent* item;
+    while ((item = readdir(dir)) != NULL) {
+        const size_t length = strlen(item->d_name);
+        if (length <= 8 || strcmp(item->d_name + length - 8, ".variant") != 0) {
+            continue;
+        }
+        char* path = analysis_cache_path(directory, item->d_name, "");
+        struct stat info;
+        if (path && stat(path, &info) == 0) {
+            if (count == capacity) {
+                capacity = capacity ? capacity * 2 : 64;
+                AnalysisCacheFile* grown = (AnalysisCacheFile*)realloc(files, sizeof(*files) * (size_t)capacity);
+                if (!grown) {
+                    free(path);
+                    break;
+                }
+                files = grown;
+            }
+            files[count].name = path;
+            files[count].size = (int64_t)info.st_size;
+            files[count].used = analysis_cache_mtime_ns(&info);
+            *bytes += files[count].size;
+            count++;
+        } else {
+            free(path);
+        }
+    }
+    closedir(dir);
+
+    int evicted = 0;
+    if (*bytes > maxBytes && count > 0) {
+        qsort(files, (size_t)count, sizeof(*files), analysis_cache_compare_used);
+    }
+    for (int i = 0; i < count; i++) {
+        if (*bytes > maxBytes && remove(files[i].name) == 0) {
+            *bytes -= files[i].size;
+            evicted++;
+        } else {
+            (*entries)++;
+        }
+        free(files[i].name);
+    }
+    free(files);
+    return evicted;
+}
+
+#endif  // MACAUDIO_VARIANT_H
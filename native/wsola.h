@@ -0,0 +1,372 @@
+// WSOLA time stretch, shared by both backends.
+//
+// Waveform-similarity overlap-add: the output is a sum of Hann windowed
+// grains, 2 * hop frames long at 50% overlap. Grain g is centred on output
+// frame g * hop and on input frame a_g + d_g, where a_g - a_{g-1} = hop * rate
+// for the rate at that grain, so the rate may change from grain to grain.
+// The offset d_g (at most `tolerance` either way) is where the grain's first
+// half best matches the continuation of the previous grain, by normalized
+// cross-correlation of the channel mixdown: periodic material joins in phase
+// instead of smearing. At rate 1 the continuation itself is taken and the
+// output reproduces the input exactly.
+//
+// The stretcher needs input only up to the end of its next grain, so after a
+// read it holds at most hop * (1 + rate) + tolerance frames it has not played
+// (27 ms at 1.25x with the 10 ms hop), plus whatever block of input overshot
+// that. Output frame m plays the input near a(m) with nothing else delayed.
+//
+// Per block, on the render thread (nothing allocates after init):
+//     while (wsola_available(s) < frames) {
+//         if (wsola_input_needed(s, rate) > 0) wsola_write(s, <up to maxFrames frames>, n);
+//         else wsola_synthesize(s, rate);
+//     }
+//     wsola_read(s, out, frames);
+//
+// Header-only like resampler.h, whose dot products it shares; builds as C
+// (macOS backend) and C++ (headless).
+
+#ifndef MACAUDIO_WSOLA_H
+#define MACAUDIO_WSOLA_H
+
+#include <math.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "resampler.h"
+
+#define WSOLA_HOP_SECONDS 0.010
+#define WSOLA_TOLERANCE_SECONDS 0.004
+#define WSOLA_MIN_RATE 0.25
+#define WSOLA_MAX_RATE 4.0
+#define WSOLA_MAX_CHANNELS 64
+
+typedef struct {
+    int channelCount;
+    int maxFrames;
+    int hop;             // Synthesis hop, a multiple of 8; grains are twice as long
+    int tolerance;       // Furthest a grain moves from its nominal position
+    int capacity;        // Input frames held at most
+    int kernel;          // RESAMPLER_KERNEL_* for the similarity search
+    float* window;       // Periodic Hann, 2 * hop
+    float** input;       // Per channel; input[c][0] is stream frame inputStart
+    float* mono;         // Mixdown of input for the similarity search
+    double* energy;      // Prefix sums of the mixdown's energy over a search
+    float** overlap;     // Per channel overlap-add accumulator, 2 * hop
+    float** ready;       // Per channel finished output, hop + maxFrames
+    double* centres;     // a_g of the last `history` grains, by g % history
+    int history;         // Grains the finished output can span, plus one
+    int64_t inputStart;  // Stream frame 0 is the first frame written
+    int inputCount;
+    int readyCount;
+    int64_t grains;      // Synthesized since reset
+    double centre;       // a_g of the last grain
+    int64_t start;       // Stream frame the last grain started at
+    double speed;        // Rate of the last grain
+} WsolaState;
+
+static inline void wsola_free(WsolaState* s) {
+    for (int c = 0; c < s->channelCount; c++) {
+        if (s->input) {
+            free(s->input[c]);
+        }
+        if (s->overlap) {
+            free(s->overlap[c]);
+        }
+        if (s->ready) {
+            free(s->ready[c]);
+        }
+    }
+    free(s->input);
+    free(s->overlap);
+    free(s->ready);
+    free(s->window);
+    free(s->mono);
+    free(s->energy);
+    free(s->centres);
+    memset(s, 0, sizeof(*s));
+}
+
+// Forget the stream; the next frame written is stream frame 0. The first
+// grain reads the `hop` frames of silence before it, and the second's search
+// may reach `tolerance` frames further back at low rates.
+static inline void wsola_reset(WsolaState* s) {
+    for (int c = 0; c < s->channelCount; c++) {
+        memset(s->input[c], 0, (size_t)s->capacity * sizeof(float));
+        memset(s->overlap[c], 0, (size_t)(2 * s->hop) * sizeof(float));
+    }
+    memset(s->mono, 0, (size_t)s->capacity * sizeof(float));
+    s->inputStart = -(int64_t)(s->hop + s->tolerance);
+    s->inputCount = s->hop + s->tolerance;
+    s->readyCount = 0;
+    s->grains = 0;
+    s->centre = 0.0;
+    s->start = 0;
+    s->speed = 1.0;
+}
+
+static inline const char* wsola_init(WsolaState* s, double sampleRate, int channelCount, int maxFrames) {
+    memset(s, 0, sizeof(*s));
+    if (!(sampleRate > 0.0)) {
+        return "Sample rate must be positive";
+    }
+    if (channelCount < 1 || channelCount > WSOLA_MAX_CHANNELS) {
+        return "Channel count must be between 1 and 64";
+    }
+    if (maxFrames < 1) {
+        return "Block size must be positive";
+    }
+
+    s->channelCount = channelCount;
+    s->maxFrames = maxFrames;
+    s->hop = ((int)lround(sampleRate * WSOLA_HOP_SECONDS) + 7) & ~7;
+    s->tolerance = (int)lround(sampleRate * WSOLA_TOLERANCE_SECONDS);
+    // From the oldest frame the next grain can reach to the end of it, and a
+    // block written past that
+    s->capacity = 3 * s->hop + 2 * s->tolerance + (int)ceil(s->hop * WSOLA_MAX_RATE) + maxFrames + 4;
+    s->kernel = resampler_pick_kernel();
+    s->history = maxFrames / s->hop + 3;
+
+    const int grain = 2 * s->hop;
+    s->window = (float*)malloc((size_t)grain * sizeof(float));
+    s->mono = (float*)malloc((size_t)s->capacity * sizeof(float));
+    s->energy = (double*)malloc((size_t)(2 * s->tolerance + s->hop + 2) * sizeof(double));
+    s->input = (float**)calloc((size_t)channelCount, sizeof(float*));
+    s->overlap = (float**)calloc((size_t)channelCount, sizeof(float*));
+    s->ready = (float**)calloc((size_t)channelCount, sizeof(float*));
+    s->centres = (double*)malloc((size_t)s->history * sizeof(double));
+    bool allocated = s->window && s->mono && s->energy && s->input && s->overlap && s->ready && s->centres;
+    for (int c = 0; allocated && c < channelCount; c++) {
+        s->input[c] = (float*)malloc((size_t)s->capacity * sizeof(float));
+        s->overlap[c] = (float*)malloc((size_t)grain * sizeof(float));
+        s->ready[c] = (float*)malloc((size_t)(s->hop + maxFrames) * sizeof(float));
+        allocated = s->input[c] && s->overlap[c] && s->ready[c];
+    }
+    if (!allocated) {
+        wsola_free(s);
+        return "Failed to allocate time stretch";
+    }
+
+    // Periodic Hann windows at 50% overlap sum to exactly 1
+    for (int n = 0; n < grain; n++) {
+        s->window[n] = (float)(0.5 - 0.5 * cos(2.0 * M_PI * n / grain));
+    }
+    wsola_reset(s);
+    return NULL;
+}
+
+static inline float wsola_dot(const WsolaState* s, const float* x, const float* y) {
+    switch (s->kernel) {
+#if RESAMPLER_X86
+        case RESAMPLER_KERNEL_AVX2:
+            return resampler_dot_avx2(x, y, s->hop);
+        case RESAMPLER_KERNEL_SSE2:
+            return resampler_dot_sse2(x, y, s->hop);
+#elif RESAMPLER_NEON
+        case RESAMPLER_KERNEL_NEON:
+            return resampler_dot_neon(x, y, s->hop);
+#endif
+        default:
+            return resampler_dot_scalar(x, y, s->hop);
+    }
+}
+
+static inline double wsola_clamp_rate(double rate) {
+    return rate < WSOLA_MIN_RATE ? WSOLA_MIN_RATE : rate > WSOLA_MAX_RATE ? WSOLA_MAX_RATE : rate;
+}
+
+// Nominal input centre of the next grain
+static inline double wsola_next_centre(const WsolaState* s, double rate) {
+    return s->grains ? s->centre + s->hop * wsola_clamp_rate(rate) : 0.0;
+}
+
+// Input frames still to write before the next grain can be synthesized
+static inline int wsola_input_needed(const WsolaState* s, double rate) {
+    const int64_t reach = s->grains ? s->tolerance : 0;
+    const int64_t end = (int64_t)llround(wsola_next_centre(s, rate)) + s->hop + reach;
+    const int64_t missing = end - (s->inputStart + s->inputCount);
+    return missing > 0 ? (int)missing : 0;
+}
+
+// Append `frames` planar frames (channel c at input + c * stride, or silence
+// for NULL), at most maxFrames while wsola_input_needed is positive. Returns
+// the frames taken.
+static inline int wsola_write(WsolaState* s, const float* input, int stride, int frames) {
+    // Drop what neither the next grain's candidates nor its template reach:
+    // at any rate the next nominal start is past floor(centre) - hop
+    const int64_t earliest = (int64_t)floor(s->centre) - s->hop - s->tolerance;
+    const int64_t keepFrom = s->grains ? (s->start + s->hop < earliest ? s->start + s->hop : earliest) : s->inputStart;
+    const int drop = (int)(keepFrom - s->inputStart);
+    if (drop > 0 && drop <= s->inputCount) {
+        const size_t kept = (size_t)(s->inputCount - drop);
+        for (int c = 0; c < s->channelCount; c++) {
+            memmove(s->input[c], s->input[c] + drop, kept * sizeof(float));
+        }
+        memmove(s->mono, s->mono + drop, kept * sizeof(float));
+        s->inputStart += drop;
+        s->inputCount -= drop;
+    }
+
+    const int room = s->capacity - s->inputCount;
+    const int count = frames < room ? frames : room;
+    float* mono = s->mono + s->inputCount;
+    memset(mono, 0, (size_t)count * sizeof(float));
+    for (int c = 0; c < s->channelCount; c++) {
+        float* dst = s->input[c] + s->inputCount;
+        if (input) {
+            memcpy(dst, input + (size_t)c * stride, (size_t)count * sizeof(float));
+            for (int i = 0; i < count; i++) {
+                mono[i] += dst[i];
+            }
+        } else {
+            memset(dst, 0, (size_t)count * sizeof(float));
+        }
+    }
+    s->inputCount += count;
+    return count;
+}
+
+// Stream frame within +-tolerance of `nominal` where a grain's first half
+// best continues the previous grain, whose continuation starts at `natural`
+static inline int64_t wsola_search(WsolaState* s, int64_t natural, int64_t nominal) {
+    const int span = 2 * s->tolerance;
+    const int length = s->hop;
+    const float* candidates = s->mono + (nominal - s->tolerance - s->inputStart);
+    const float* continuation = s->mono + (natural - s->inputStart);
+
+    double* energy = s->energy;
+    energy[0] = 0.0;
+    for (int i = 0; i < span + length; i++) {
+        energy[i + 1] = energy[i] + (double)candidates[i] * candidates[i];
+    }
+    double reference = 0.0;
+    for (int i = 0; i < length; i++) {
+        reference += (double)continuation[i] * continuation[i];
+    }
+    const int64_t naturalOffset = natural - (nominal - s->tolerance);
+    if (reference < 1e-12) {
+        // Nothing to match: stay as close to the continuation as allowed
+        return nominal - s->tolerance + (naturalOffset < 0 ? 0 : naturalOffset > span ? span : naturalOffset);
+    }
+
+    // Every 4th offset, then every offset around the best of those
+    int best = s->tolerance;
+    double bestScore = -INFINITY;
+    for (int pass = 0; pass < 2; pass++) {
+        const int from = pass ? (best > 3 ? best - 3 : 0) : 0;
+        const int to = pass ? (best + 3 < span ? best + 3 : span) : span;
+        const int step = pass ? 1 : 4;
+        for (int d = from; d <= to; d += step) {
+            const double correlation = wsola_dot(s, continuation, candidates + d);
+            const double score = correlation / sqrt(energy[d + length] - energy[d] + 1e-9 * reference);
+            if (score > bestScore) {
+                bestScore = score;
+                best = d;
+            }
+        }
+    }
+    return nominal - s->tolerance + best;
+}
+
+// Overlap-add the next grain, finishing `hop` frames of output
+static inline void wsola_synthesize(WsolaState* s, double rate) {
+    rate = wsola_clamp_rate(rate);
+    const double centre = wsola_next_centre(s, rate);
+    const int64_t nominal = (int64_t)llround(centre) - s->hop;
+    int64_t start = nominal;
+    if (s->grains) {
+        const int64_t natural = s->start + s->hop;
+        const bool reachable = natural >= nominal - s->tolerance && natural <= nominal + s->tolerance;
+        start = rate == 1.0 && reachable ? natural : wsola_search(s, natural, nominal);
+    }
+
+    const int grain = 2 * s->hop;
+    const int offset = (int)(start - s->inputStart);
+    for (int c = 0; c < s->channelCount; c++) {
+        const float* src = s->input[c] + offset;
+        float* acc = s->overlap[c];
+        for (int n = 0; n < grain; n++) {
+            acc[n] += src[n] * s->window[n];
+        }
+        // The first half is complete (the very first grain's lies before frame 0)
+        if (s->grains) {
+            memcpy(s->ready[c] + s->readyCount, acc, (size_t)s->hop * sizeof(float));
+        }
+        memmove(acc, acc + s->hop, (size_t)s->hop * sizeof(float));
+        memset(acc + s->hop, 0, (size_t)s->hop * sizeof(float));
+    }
+    if (s->grains) {
+        s->readyCount += s->hop;
+    }
+    s->centres[s->grains % s->history] = centre;
+    s->centre = centre;
+    s->start = start;
+    s->speed = rate;
+    s->grains++;
+}
+
+static inline int wsola_available(const WsolaState* s) {
+    return s->readyCount;
+}
+
+// Move `frames` (at most wsola_available) finished frames to planar output
+static inline void wsola_read(WsolaState* s, float* output, int stride, int frames) {
+    for (int c = 0; c < s->channelCount; c++) {
+        memcpy(output + (size_t)c * stride, s->ready[c], (size_t)frames * sizeof(float));
+        memmove(s->ready[c], s->ready[c] + frames, (size_t)(s->readyCount - frames) * sizeof(float));
+    }
+    s->readyCount -= frames;
+}
+
+// At rate 1 every grain continues the last one, so the output from the next
+// frame on is what is finished, then the input from the end of the last
+// grain's first half: wsola_held frames in all, which a caller may play
+// (wsola_read_held) and route around the stretcher
+static inline int wsola_held(const WsolaState* s) {
+    if (!s->grains) {
+        return 0;
+    }
+    return s->readyCount + (int)(s->inputStart + s->inputCount - (s->start + s->hop));
+}
+
+// Copy `frames` of those, from `offset` on, to planar output without using them up
+static inline void wsola_read_held(const WsolaState* s, int offset, float* output, int stride, int frames) {
+    const int pending = (int)(s->start + s->hop - s->inputStart);
+    if (frames <= 0) {
+        return;
+    }
+    for (int c = 0; c < s->channelCount; c++) {
+        float* dst = output + (size_t)c * stride;
+        int at = offset;
+        int done = 0;
+        if (at < s->readyCount) {
+            done = frames < s->readyCount - at ? frames : s->readyCount - at;
+            memcpy(dst, s->ready[c] + at, (size_t)done * sizeof(float));
+            at += done;
+        }
+        memcpy(dst + done, s->input[c] + pending + (at - s->readyCount), (size_t)(frames - done) * sizeof(float));
+    }
+}
+
+// Input frames written but not yet heard: the next frame read plays the input
+// around stream frame (frames written) - wsola_lookahead. Output between the
+// centres of grains g - 1 and g plays the input between their nominal
+// centres, so this moves smoothly as grains shift to match and rates change.
+static inline double wsola_lookahead(const WsolaState* s) {
+    const double written = (double)(s->inputStart + s->inputCount);
+    if (s->grains < 2) {
+        return written - s->centre;
+    }
+    int64_t g = s->grains - 1;
+    double behind = (double)s->readyCount;
+    while (behind > s->hop && g > 1) {
+        behind -= s->hop;
+        g--;
+    }
+    const double to = s->centres[g % s->history];
+    const double from = s->centres[(g - 1) % s->history];
+    return written - (to - behind * (to - from) / s->hop);
+}
+
+#endif  // MACAUDIO_WSOLA_H
@@ -0,0 +1,123 @@
+//go:build darwin && cgo
+
+package plugins
+
+/*
+#cgo CFLAGS: -x objective-c
+#cgo LDFLAGS: -framework Foundation -framework AudioToolbox -framework AVFoundation -framework AudioUnit
+#include "native/plugins.m"
+#include <stdlib.h>
+#include <string.h>
+
+// Declare the functions so CGO can find them
+char *QuickScanAudioUnits(void);
+// 4-arg version: name == nil/empty => suite mode (all matches)
+char *IntrospectAudioUnits(const char *type, const char *subtype, const char *manufacturerID, const char *name);
+void SetVerboseLogging(int enabled);
+// Timeout setters (configured from Go)
+void SetPresetLoadingTimeout(double seconds);
+void SetProcessUpdateTimeout(double seconds);
+void SetTotalTimeout(double seconds);
+*/
+import "C"
+import (
+	"encoding/json"
+	"fmt"
+	"unsafe"
+)
+
+// Timeout configuration (seconds). These feed through to the native layer.
+// Use small values to speed up development scans; larger for stability.
+func SetPresetLoadingTimeout(seconds float64) { C.SetPresetLoadingTimeout(C.double(seconds)) }
+func SetProcessUpdateTimeout(seconds float64) { C.SetProcessUpdateTimeout(C.double(seconds)) }
+func SetTotalTimeout(seconds float64)         { C.SetTotalTimeout(C.double(seconds)) }
+
+// List returns a quick enumeration of all available AudioUnit plugins (no parameters)
+// List performs a fast enumeration of installed AudioUnit plugins without
+// instantiating them. It returns PluginInfo entries that can be filtered and
+// later introspected individually.
+func List() (PluginInfos, error) {
+	cPluginList := C.QuickScanAudioUnits()
+	if cPluginList == nil {
+		return nil, fmt.Errorf("failed to scan AudioUnit plugins")
+	}
+	defer C.free(unsafe.Pointer(cPluginList))
+
+	jsonData := C.GoString(cPluginList)
+
+	// JSON logging when enabled (follows devices pattern)
+	logJSON("QuickScan", jsonData)
+
+	var response QuickScanResponse
+	if err := json.Unmarshal([]byte(jsonData), &response); err != nil {
+		return nil, fmt.Errorf("failed to parse plugin list data: %v", err)
+	}
+
+	// Check for success status (like devices pattern)
+	if !response.Success {
+		errorMsg := response.Error
+		if errorMsg == "" {
+			errorMsg = "unknown error"
+		}
+		return nil, fmt.Errorf("plugin scan failed: %s (code: %d)", errorMsg, response.ErrorCode)
+	}
+
+	return PluginInfos(response.Plugins), nil
+}
+
+// cStringOrNil returns nil for empty strings (used to signal suite mode for name)
+func cStringOrNil(s string) *C.char {
+	if s == "" {
+		return nil
+	}
+	return C.CString(s)
+}
+
+// introspect is the omnipotent internal function: name == "" ⇒ suite; name set ⇒ single
+func introspect(pluginType, subtype, manufacturerID, name string) ([]*Plugin, error) {
+	cType := cStringOrNil(pluginType)
+	cSubtype := cStringOrNil(subtype)
+	cMan := cStringOrNil(manufacturerID)
+	cName := cStringOrNil(name)
+
+	if cType != nil {
+		defer C.free(unsafe.Pointer(cType))
+	}
+	if cSubtype != nil {
+		defer C.free(unsafe.Pointer(cSubtype))
+	}
+	if cMan != nil {
+		defer C.free(unsafe.Pointer(cMan))
+	}
+	if cName != nil {
+		defer C.free(unsafe.Pointer(cName))
+	}
+
+	cResult := C.IntrospectAudioUnits(cType, cSubtype, cMan, cName)
+	if cResult == nil {
+		return nil, fmt.Errorf("failed to introspect plugins")
+	}
+	defer C.free(unsafe.Pointer(cResult))
+
+	jsonData := C.GoString(cResult)
+
+	// JSON logging when enabled
+	logJSON(fmt.Sprintf("Introspect[%s:%s:%s:%s]", pluginType, subtype, manufacturerID, name), jsonData)
+
+	// Parse JSON into pluginResult struct (like devices pattern)
+	var result pluginResult
+	if err := json.Unmarshal([]byte(jsonData), &result); err != nil {
+		return nil, fmt.Errorf("failed to parse plugin result data: %v", err)
+	}
+
+	// Check for success status (like devices pattern)
+	if !result.Success {
+		errorMsg := result.Error
+		if errorMsg == "" {
+			errorMsg = "unknown error"
+		}
+		return nil, fmt.Errorf("plugin introspection failed: %s (code: %d)", errorMsg, result.ErrorCode)
+	}
+
+	return result.Plugins, nil
+}
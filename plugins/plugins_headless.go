@@ -0,0 +1,24 @@
+//go:build !darwin || !cgo
+
+package plugins
+
+import "fmt"
+
+// AudioUnits only exist on macOS. The headless backend hosts no plugins, so
+// the scan is empty and introspection always fails.
+
+// Timeout setters are accepted for API compatibility and ignored.
+func SetPresetLoadingTimeout(seconds float64) {}
+func SetProcessUpdateTimeout(seconds float64) {}
+func SetTotalTimeout(seconds float64)         {}
+
+// List returns an empty plugin list; AudioUnits are unavailable headless
+func List() (PluginInfos, error) {
+	logJSON("QuickScan", `{"success":true,"plugins":[]}`)
+	return PluginInfos{}, nil
+}
+
+// introspect always fails without AudioUnit hosting
+func introspect(pluginType, subtype, manufacturerID, name string) ([]*Plugin, error) {
+	return nil, fmt.Errorf("plugin introspection failed: AudioUnits are not available in the headless backend (code: %d)", ErrCodeNotFound)
+}